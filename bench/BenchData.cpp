@@ -0,0 +1,298 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "BenchData.h"
+
+#include <Saba/Base/BufferedWriter.h>
+#include <Saba/Base/File.h>
+#include <Saba/Base/Log.h>
+#include <Saba/Base/Path.h>
+#include <Saba/Model/MMD/MMDGenerator.h>
+#include <Saba/Model/MMD/VMDFile.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+namespace saba
+{
+	namespace bench
+	{
+		namespace
+		{
+			PMXGenerateParam MakePMXParam(const BenchModelDesc& desc)
+			{
+				PMXGenerateParam param;
+				param.m_vertexCount = desc.m_vertexCount;
+				param.m_boneCount = desc.m_boneCount;
+				for (int i = 0; i < 5; i++)
+				{
+					param.m_weightRatio[i] = int(desc.m_weightType) == i ? 1.0f : 0.0f;
+				}
+				param.m_positionMorphCount = desc.m_morphCount;
+				param.m_morphVertexCount = desc.m_morphVertexCount;
+				param.m_ikChainCount = desc.m_ikChainCount;
+				param.m_rigidbodyCount = desc.m_rigidbodyCount;
+				return param;
+			}
+
+			bool WritePMX(const std::string& filepath, const BenchModelDesc& desc)
+			{
+				PMXFile pmx;
+				return GeneratePMXFile(&pmx, MakePMXParam(desc)) && WritePMXFile(&pmx, filepath.c_str());
+			}
+
+			bool WriteVMD(const std::string& filepath, const BenchModelDesc& model, const BenchAnimDesc& anim)
+			{
+				PMXFile pmx;
+				if (!GeneratePMXFile(&pmx, MakePMXParam(model)))
+				{
+					return false;
+				}
+
+				VMDGenerateParam param;
+				param.m_frameCount = anim.m_frameCount;
+				param.m_nodeKeyInterval = std::max(anim.m_keyInterval, 1u);
+				param.m_morphKeyInterval = param.m_nodeKeyInterval;
+				VMDFile vmd;
+				return GenerateVMDFile(&vmd, pmx, param) && WriteVMDFile(&vmd, filepath.c_str());
+			}
+
+			bool WriteVPD(const std::string& filepath, const BenchModelDesc& model)
+			{
+				PMXFile pmx;
+				if (!GeneratePMXFile(&pmx, MakePMXParam(model)))
+				{
+					return false;
+				}
+
+				std::string text = "Vocaloid Pose Data file\r\n\r\nbench.osm;\t\t// 親ファイル名\r\n";
+				text += std::to_string(pmx.m_bones.size()) + ";\t\t\t\t// 総ポーズボーン数\r\n\r\n";
+				char buf[256];
+				for (size_t i = 0; i < pmx.m_bones.size(); i++)
+				{
+					float angle = float(i) * 0.01f;
+					snprintf(buf, sizeof(buf),
+						"Bone%d{%s\r\n  %f,%f,%f;\t\t\t\t// trans x,y,z\r\n  %f,%f,%f,%f;\t\t// Quaternion x,y,z,w\r\n}\r\n\r\n",
+						int(i), pmx.m_bones[i].m_name.c_str(),
+						0.1f * float(i % 7), -0.25f, 1.5f,
+						std::sin(angle), 0.0f, 0.0f, std::cos(angle));
+					text += buf;
+				}
+				for (size_t i = 0; i < pmx.m_morphs.size(); i++)
+				{
+					snprintf(buf, sizeof(buf), "Morph%d{%s\r\n  %f;\r\n}\r\n\r\n",
+						int(i), pmx.m_morphs[i].m_name.c_str(), float(i % 10) * 0.1f);
+					text += buf;
+				}
+
+				File file;
+				return file.Create(filepath) && file.Write(text.data(), text.size());
+			}
+
+			bool WriteOBJ(const std::string& filepath, uint32_t gridSize, uint32_t materialCount)
+			{
+				materialCount = std::max(materialCount, 1u);
+				std::string mtlName = PathUtil::GetFilenameWithoutExt(filepath) + ".mtl";
+				{
+					std::string mtl;
+					for (uint32_t i = 0; i < materialCount; i++)
+					{
+						mtl += "newmtl mat" + std::to_string(i) + "\n";
+						mtl += "Kd 0.8 0.8 0.8\nKa 0.2 0.2 0.2\nKs 0 0 0\nNs 10\nd 1\n\n";
+					}
+					File file;
+					std::string mtlPath = PathUtil::Combine(PathUtil::GetDirectoryName(filepath), mtlName);
+					if (!file.Create(mtlPath) || !file.Write(mtl.data(), mtl.size()))
+					{
+						return false;
+					}
+				}
+
+				BufferedWriter writer;
+				if (!writer.Open(filepath))
+				{
+					return false;
+				}
+				writer.WriteString("# saba bench stage\nmtllib " + mtlName + "\no stage\n");
+				const uint32_t lineCount = gridSize + 1;
+				const float scale = 100.0f / float(gridSize);
+				for (uint32_t y = 0; y < lineCount; y++)
+				{
+					for (uint32_t x = 0; x < lineCount; x++)
+					{
+						float px = float(x) * scale;
+						float pz = float(y) * scale;
+						float py = std::sin(px * 0.3f) * std::cos(pz * 0.2f);
+						writer.WriteString("v ");
+						writer.WriteFloat(px);
+						writer.WriteChar(' ');
+						writer.WriteFloat(py);
+						writer.WriteChar(' ');
+						writer.WriteFloat(pz);
+						writer.WriteString("\nvt ");
+						writer.WriteFloat(float(x) / float(gridSize));
+						writer.WriteChar(' ');
+						writer.WriteFloat(float(y) / float(gridSize));
+						writer.WriteString("\nvn ");
+						writer.WriteFloat(-std::cos(px * 0.3f) * 0.3f);
+						writer.WriteString(" 1 ");
+						writer.WriteFloat(std::sin(pz * 0.2f) * 0.2f);
+						writer.WriteChar('\n');
+					}
+				}
+				uint32_t material = uint32_t(-1);
+				for (uint32_t y = 0; y < gridSize; y++)
+				{
+					uint32_t rowMaterial = y * materialCount / gridSize;
+					if (rowMaterial != material)
+					{
+						material = rowMaterial;
+						writer.WriteString("usemtl mat" + std::to_string(material) + "\n");
+					}
+					for (uint32_t x = 0; x < gridSize; x++)
+					{
+						uint32_t v[4] = {
+							y * lineCount + x + 1,
+							y * lineCount + x + 2,
+							(y + 1) * lineCount + x + 2,
+							(y + 1) * lineCount + x + 1,
+						};
+						writer.WriteChar('f');
+						for (auto vi : v)
+						{
+							writer.WriteChar(' ');
+							writer.WriteUInt(vi);
+							writer.WriteChar('/');
+							writer.WriteUInt(vi);
+							writer.WriteChar('/');
+							writer.WriteUInt(vi);
+						}
+						writer.WriteChar('\n');
+					}
+				}
+				return writer.Close() && !writer.IsBad();
+			}
+
+			std::string MakeModelName(const BenchModelDesc& desc)
+			{
+				std::stringstream ss;
+				ss << "saba_bench_v" << desc.m_vertexCount
+					<< "_b" << desc.m_boneCount
+					<< "_w" << int(desc.m_weightType)
+					<< "_m" << desc.m_morphCount << "x" << desc.m_morphVertexCount
+					<< "_ik" << desc.m_ikChainCount
+					<< "_rb" << desc.m_rigidbodyCount;
+				return ss.str();
+			}
+
+			/*
+				同じプロセス内では一度だけ生成する.
+				(前回の実行で残ったファイルは生成方法が変わっている可能性があるので使わない)
+			*/
+			template <typename Func>
+			std::string GetGeneratedFile(const std::string& filename, Func&& generate)
+			{
+				static std::mutex generatedMutex;
+				static std::set<std::string> generated;
+
+				std::string filepath = PathUtil::Combine(PathUtil::GetCWD(), filename);
+				std::lock_guard<std::mutex> lock(generatedMutex);
+				if (generated.find(filepath) != generated.end())
+				{
+					return filepath;
+				}
+				if (!generate(filepath))
+				{
+					SABA_ERROR("Failed to generate bench data. [{}]", filepath);
+					return "";
+				}
+				generated.insert(filepath);
+				return filepath;
+			}
+		}
+
+		std::string GetBenchPMXFile(const BenchModelDesc& desc)
+		{
+			return GetGeneratedFile(
+				MakeModelName(desc) + ".pmx",
+				[&desc](const std::string& filepath) { return WritePMX(filepath, desc); }
+			);
+		}
+
+		std::string GetBenchVMDFile(const BenchModelDesc& model, const BenchAnimDesc& anim)
+		{
+			std::stringstream ss;
+			ss << MakeModelName(model) << "_f" << anim.m_frameCount << "_k" << anim.m_keyInterval << ".vmd";
+			return GetGeneratedFile(
+				ss.str(),
+				[&model, &anim](const std::string& filepath) { return WriteVMD(filepath, model, anim); }
+			);
+		}
+
+		std::string GetBenchVPDFile(const BenchModelDesc& model)
+		{
+			return GetGeneratedFile(
+				MakeModelName(model) + ".vpd",
+				[&model](const std::string& filepath) { return WriteVPD(filepath, model); }
+			);
+		}
+
+		std::string GetBenchOBJFile(uint32_t gridSize, uint32_t materialCount)
+		{
+			std::stringstream ss;
+			ss << "saba_bench_stage_g" << gridSize << "_m" << materialCount << ".obj";
+			return GetGeneratedFile(
+				ss.str(),
+				[gridSize, materialCount](const std::string& filepath) { return WriteOBJ(filepath, gridSize, materialCount); }
+			);
+		}
+
+		std::shared_ptr<PMXModel> LoadBenchModel(const BenchModelDesc& desc)
+		{
+			std::string filepath = GetBenchPMXFile(desc);
+			if (filepath.empty())
+			{
+				return nullptr;
+			}
+
+			auto model = std::make_shared<PMXModel>();
+			if (!model->Load(filepath, PathUtil::GetCWD()))
+			{
+				SABA_ERROR("Failed to load bench model. [{}]", filepath);
+				return nullptr;
+			}
+			model->InitializeAnimation();
+			return model;
+		}
+
+		std::unique_ptr<VMDAnimation> LoadBenchAnimation(std::shared_ptr<PMXModel> model, const BenchModelDesc& desc, const BenchAnimDesc& anim)
+		{
+			std::string filepath = GetBenchVMDFile(desc, anim);
+			if (filepath.empty())
+			{
+				return nullptr;
+			}
+
+			VMDFile vmd;
+			if (!ReadVMDFile(&vmd, filepath.c_str()))
+			{
+				return nullptr;
+			}
+
+			std::unique_ptr<VMDAnimation> vmdAnim(new VMDAnimation());
+			if (!vmdAnim->Create(model) || !vmdAnim->Add(vmd))
+			{
+				SABA_ERROR("Failed to create bench animation. [{}]", filepath);
+				return nullptr;
+			}
+			vmdAnim->SyncPhysics(0);
+			return vmdAnim;
+		}
+	}
+}
@@ -0,0 +1,59 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_BENCH_BENCHDATA_H_
+#define SABA_BENCH_BENCHDATA_H_
+
+#include <Saba/Model/MMD/PMXFile.h>
+#include <Saba/Model/MMD/PMXModel.h>
+#include <Saba/Model/MMD/VMDAnimation.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace saba
+{
+	namespace bench
+	{
+		/*
+			ベンチマーク用に機械的に生成するモデル (GeneratePMXFile で生成する).
+			すべての頂点を m_weightType で、すべてのモーフを頂点モーフで作る.
+		*/
+		struct BenchModelDesc
+		{
+			uint32_t		m_vertexCount = 10000;
+			uint32_t		m_boneCount = 128;
+			PMXVertexWeight	m_weightType = PMXVertexWeight::BDEF4;
+			uint32_t		m_morphCount = 16;
+			uint32_t		m_morphVertexCount = 500;	//!< 頂点モーフ 1 つあたりの頂点数
+			uint32_t		m_ikChainCount = 2;
+			uint32_t		m_rigidbodyCount = 16;		//!< 半分を物理演算にして、隣同士をジョイントでつなぐ
+		};
+
+		struct BenchAnimDesc
+		{
+			uint32_t	m_frameCount = 600;
+			uint32_t	m_keyInterval = 5;	//!< キーを打つ間隔 (フレーム)
+		};
+
+		/*
+			desc から PMX / VMD を生成して、カレントディレクトリに書き出す.
+			同じ設定のファイルはプロセス内で一度だけ生成する. 失敗した場合は空文字列.
+		*/
+		std::string GetBenchPMXFile(const BenchModelDesc& desc);
+		std::string GetBenchVMDFile(const BenchModelDesc& model, const BenchAnimDesc& anim);
+		// すべてのボーン、モーフを含む VPD (MMD が書き出すものと同じ書式)
+		std::string GetBenchVPDFile(const BenchModelDesc& model);
+		// gridSize x gridSize の四角形で作った起伏のある地面 (ステージ相当) の OBJ / MTL. 行ごとに材質を切り替える
+		std::string GetBenchOBJFile(uint32_t gridSize, uint32_t materialCount);
+
+		// 生成したモデルを読み込み、アニメーションを初期化する. 失敗した場合は nullptr
+		std::shared_ptr<PMXModel> LoadBenchModel(const BenchModelDesc& desc);
+		std::unique_ptr<VMDAnimation> LoadBenchAnimation(std::shared_ptr<PMXModel> model, const BenchModelDesc& desc, const BenchAnimDesc& anim);
+	}
+}
+
+#endif // !SABA_BENCH_BENCHDATA_H_
@@ -0,0 +1,214 @@
+﻿#include <benchmark/benchmark.h>
+
+#include "BenchData.h"
+
+#include <Saba/Base/File.h>
+#include <Saba/Model/MeshUtil.h>
+#include <Saba/Model/MMD/PMXCache.h>
+#include <Saba/Model/MMD/PMXFile.h>
+#include <Saba/Model/MMD/PMXModel.h>
+#include <Saba/Model/MMD/VMDFile.h>
+#include <Saba/Model/MMD/VPDFile.h>
+
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	int64_t GetFileSize(const std::string& filepath)
+	{
+		saba::File file;
+		if (!file.Open(filepath))
+		{
+			return 0;
+		}
+		return int64_t(file.GetSize());
+	}
+}
+
+static void BM_ReadPMXFile(benchmark::State& state)
+{
+	saba::bench::BenchModelDesc desc;
+	desc.m_vertexCount = uint32_t(state.range(0));
+	auto filepath = saba::bench::GetBenchPMXFile(desc);
+	if (filepath.empty())
+	{
+		state.SkipWithError("Failed to generate PMX.");
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		saba::PMXFile pmx;
+		if (!saba::ReadPMXFile(&pmx, filepath.c_str()))
+		{
+			state.SkipWithError("ReadPMXFile failed.");
+			break;
+		}
+		benchmark::DoNotOptimize(pmx.m_vertices.data());
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * GetFileSize(filepath));
+}
+BENCHMARK(BM_ReadPMXFile)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_ReadVMDFile(benchmark::State& state)
+{
+	saba::bench::BenchModelDesc model;
+	model.m_boneCount = uint32_t(state.range(0));
+	saba::bench::BenchAnimDesc anim;
+	anim.m_keyInterval = uint32_t(state.range(1));
+	auto filepath = saba::bench::GetBenchVMDFile(model, anim);
+	if (filepath.empty())
+	{
+		state.SkipWithError("Failed to generate VMD.");
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		saba::VMDFile vmd;
+		if (!saba::ReadVMDFile(&vmd, filepath.c_str()))
+		{
+			state.SkipWithError("ReadVMDFile failed.");
+			break;
+		}
+		benchmark::DoNotOptimize(vmd.m_motions.data());
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * GetFileSize(filepath));
+}
+BENCHMARK(BM_ReadVMDFile)->Args({ 128, 5 })->Args({ 128, 1 })->Args({ 512, 1 })->Unit(benchmark::kMillisecond);
+
+static void BM_ReadVPDFile(benchmark::State& state)
+{
+	saba::bench::BenchModelDesc model;
+	model.m_boneCount = uint32_t(state.range(0));
+	auto filepath = saba::bench::GetBenchVPDFile(model);
+	if (filepath.empty())
+	{
+		state.SkipWithError("Failed to generate VPD.");
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		saba::VPDFile vpd;
+		if (!saba::ReadVPDFile(&vpd, filepath.c_str()))
+		{
+			state.SkipWithError("ReadVPDFile failed.");
+			break;
+		}
+		benchmark::DoNotOptimize(vpd.m_bones.data());
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * GetFileSize(filepath));
+}
+BENCHMARK(BM_ReadVPDFile)->Arg(128)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+static void BM_PMXModelLoad(benchmark::State& state)
+{
+	saba::bench::BenchModelDesc desc;
+	desc.m_vertexCount = uint32_t(state.range(0));
+	auto filepath = saba::bench::GetBenchPMXFile(desc);
+	if (filepath.empty())
+	{
+		state.SkipWithError("Failed to generate PMX.");
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		saba::PMXModel model;
+		if (!model.Load(filepath, ""))
+		{
+			state.SkipWithError("PMXModel::Load failed.");
+			break;
+		}
+		benchmark::DoNotOptimize(model.GetUpdatePositions());
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * desc.m_vertexCount);
+}
+BENCHMARK(BM_PMXModelLoad)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+// 材質ごとにインデックスを頂点キャッシュ向けに並べ替える (ACMR は 16 頂点の FIFO キャッシュで計算する)
+static void BM_PMXVertexCacheOptimize(benchmark::State& state)
+{
+	saba::bench::BenchModelDesc desc;
+	desc.m_vertexCount = uint32_t(state.range(0));
+	auto filepath = saba::bench::GetBenchPMXFile(desc);
+	if (filepath.empty())
+	{
+		state.SkipWithError("Failed to generate PMX.");
+		return;
+	}
+
+	saba::PMXModel model;
+	if (!model.Load(filepath, ""))
+	{
+		state.SkipWithError("PMXModel::Load failed.");
+		return;
+	}
+	std::vector<uint32_t> srcIndices(model.GetIndexCount());
+	for (size_t i = 0; i < srcIndices.size(); i++)
+	{
+		switch (model.GetIndexElementSize())
+		{
+		case 1: srcIndices[i] = ((const uint8_t*)model.GetIndices())[i]; break;
+		case 2: srcIndices[i] = ((const uint16_t*)model.GetIndices())[i]; break;
+		case 4: srcIndices[i] = ((const uint32_t*)model.GetIndices())[i]; break;
+		}
+	}
+
+	std::vector<uint32_t> indices;
+	for (auto _ : state)
+	{
+		indices = srcIndices;
+		saba::VertexCacheOptimizer optimizer(model.GetVertexCount());
+		for (size_t i = 0; i < model.GetSubMeshCount(); i++)
+		{
+			const auto& subMesh = model.GetSubMeshes()[i];
+			optimizer.Optimize(&indices[subMesh.m_beginIndex], subMesh.m_vertexCount);
+		}
+		benchmark::DoNotOptimize(indices.data());
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(srcIndices.size() / 3));
+	state.counters["acmr_before"] = saba::ComputeACMR(srcIndices.data(), srcIndices.size(), model.GetVertexCount());
+	state.counters["acmr_after"] = saba::ComputeACMR(indices.data(), indices.size(), model.GetVertexCount());
+}
+BENCHMARK(BM_PMXVertexCacheOptimize)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+static void BM_PMXModelLoadCached(benchmark::State& state)
+{
+	saba::bench::BenchModelDesc desc;
+	desc.m_vertexCount = uint32_t(state.range(0));
+	auto filepath = saba::bench::GetBenchPMXFile(desc);
+	if (filepath.empty())
+	{
+		state.SkipWithError("Failed to generate PMX.");
+		return;
+	}
+
+	// 最初の読み込みでキャッシュを作っておく
+	{
+		saba::PMXModel model;
+		model.EnableCache(true);
+		if (!model.Load(filepath, ""))
+		{
+			state.SkipWithError("PMXModel::Load failed.");
+			return;
+		}
+	}
+
+	for (auto _ : state)
+	{
+		saba::PMXModel model;
+		model.EnableCache(true);
+		if (!model.Load(filepath, ""))
+		{
+			state.SkipWithError("PMXModel::Load failed.");
+			break;
+		}
+		benchmark::DoNotOptimize(model.GetUpdatePositions());
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * desc.m_vertexCount);
+	std::remove(saba::GetPMXCachePath(filepath).c_str());
+}
+BENCHMARK(BM_PMXModelLoadCached)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
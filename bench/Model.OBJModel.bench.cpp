@@ -0,0 +1,38 @@
+﻿#include <benchmark/benchmark.h>
+
+#include "BenchData.h"
+
+#include <Saba/Base/File.h>
+#include <Saba/Model/OBJ/OBJModel.h>
+
+static void BM_OBJModelLoad(benchmark::State& state)
+{
+	auto filepath = saba::bench::GetBenchOBJFile(uint32_t(state.range(0)), 16);
+	if (filepath.empty())
+	{
+		state.SkipWithError("Failed to generate OBJ.");
+		return;
+	}
+
+	int64_t fileSize = 0;
+	{
+		saba::File file;
+		if (file.Open(filepath))
+		{
+			fileSize = int64_t(file.GetSize());
+		}
+	}
+
+	for (auto _ : state)
+	{
+		saba::OBJModel model;
+		if (!model.Load(filepath.c_str()))
+		{
+			state.SkipWithError("OBJModel::Load failed.");
+			break;
+		}
+		benchmark::DoNotOptimize(model.GetMesh().m_indices.data());
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * fileSize);
+}
+BENCHMARK(BM_OBJModelLoad)->Arg(256)->Arg(1024)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,240 @@
+﻿#include <benchmark/benchmark.h>
+
+#include "BenchData.h"
+
+#include <Saba/Model/MMD/PMXModel.h>
+#include <Saba/Model/MMD/VMDAnimation.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace
+{
+	struct AnimatedModel
+	{
+		std::shared_ptr<saba::PMXModel>		m_model;
+		std::unique_ptr<saba::VMDAnimation>	m_vmdAnim;
+		float	m_frame = 0;
+		float	m_frameCount = 0;
+
+		bool Setup(const saba::bench::BenchModelDesc& desc)
+		{
+			saba::bench::BenchAnimDesc anim;
+			m_frameCount = float(anim.m_frameCount);
+			m_model = saba::bench::LoadBenchModel(desc);
+			if (m_model == nullptr)
+			{
+				return false;
+			}
+			m_vmdAnim = saba::bench::LoadBenchAnimation(m_model, desc, anim);
+			return m_vmdAnim != nullptr;
+		}
+
+		// 次のフレームの VMD を評価する (モーフとノードのパラメータを更新する)
+		void Evaluate()
+		{
+			m_model->BeginAnimation();
+			m_vmdAnim->Evaluate(m_frame);
+			m_frame += 1.0f;
+			if (m_frame > m_frameCount)
+			{
+				m_frame = 0;
+			}
+		}
+	};
+}
+
+static void BM_UpdateMorphAnimation(benchmark::State& state)
+{
+	saba::bench::BenchModelDesc desc;
+	desc.m_vertexCount = 100000;
+	desc.m_morphCount = uint32_t(state.range(0));
+	desc.m_morphVertexCount = uint32_t(state.range(1));
+	AnimatedModel model;
+	if (!model.Setup(desc))
+	{
+		state.SkipWithError("Failed to setup.");
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		model.Evaluate();
+		state.ResumeTiming();
+
+		model.m_model->UpdateMorphAnimation();
+
+		state.PauseTiming();
+		model.m_model->EndAnimation();
+		state.ResumeTiming();
+	}
+}
+BENCHMARK(BM_UpdateMorphAnimation)->Args({ 16, 500 })->Args({ 64, 2000 })->Unit(benchmark::kMicrosecond);
+
+/*
+	Arg 0 : ボーン数
+	Arg 1 : IK の数
+*/
+static void BM_UpdateNodeAnimation(benchmark::State& state)
+{
+	saba::bench::BenchModelDesc desc;
+	desc.m_vertexCount = 1000;
+	desc.m_boneCount = uint32_t(state.range(0));
+	desc.m_ikChainCount = uint32_t(state.range(1));
+	AnimatedModel model;
+	if (!model.Setup(desc))
+	{
+		state.SkipWithError("Failed to setup.");
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		model.Evaluate();
+		model.m_model->UpdateMorphAnimation();
+		state.ResumeTiming();
+
+		model.m_model->UpdateNodeAnimation(false);
+		model.m_model->UpdateNodeAnimation(true);
+
+		state.PauseTiming();
+		model.m_model->EndAnimation();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * desc.m_boneCount);
+}
+BENCHMARK(BM_UpdateNodeAnimation)
+	->Args({ 128, 0 })->Args({ 128, 2 })->Args({ 512, 2 })->Args({ 512, 16 })
+	->Unit(benchmark::kMicrosecond);
+
+static void BM_UpdatePhysicsAnimation(benchmark::State& state)
+{
+	saba::bench::BenchModelDesc desc;
+	desc.m_vertexCount = 1000;
+	desc.m_boneCount = 256;
+	desc.m_rigidbodyCount = uint32_t(state.range(0));
+	AnimatedModel model;
+	if (!model.Setup(desc))
+	{
+		state.SkipWithError("Failed to setup.");
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		model.Evaluate();
+		model.m_model->UpdateMorphAnimation();
+		model.m_model->UpdateNodeAnimation(false);
+		state.ResumeTiming();
+
+		model.m_model->UpdatePhysicsAnimation(1.0f / 30.0f);
+
+		state.PauseTiming();
+		model.m_model->UpdateNodeAnimation(true);
+		model.m_model->EndAnimation();
+		state.ResumeTiming();
+	}
+}
+BENCHMARK(BM_UpdatePhysicsAnimation)->Arg(16)->Arg(64)->Arg(200)->Unit(benchmark::kMicrosecond);
+
+/*
+	Arg 0 : PMXVertexWeight (0:BDEF1 1:BDEF2 2:BDEF4 3:SDEF 4:QDEF)
+	Arg 1 : SetParallelUpdateHint に渡すスレッド数
+*/
+static void BM_PMXModelUpdate(benchmark::State& state)
+{
+	saba::bench::BenchModelDesc desc;
+	desc.m_vertexCount = 200000;
+	desc.m_weightType = saba::PMXVertexWeight(state.range(0));
+	AnimatedModel model;
+	if (!model.Setup(desc))
+	{
+		state.SkipWithError("Failed to setup.");
+		return;
+	}
+	model.m_model->SetParallelUpdateHint(uint32_t(state.range(1)));
+
+	// スキニングだけを計測するので、ポーズは一度だけ更新する
+	model.Evaluate();
+	model.m_model->UpdateAllAnimation(nullptr, 0, 0);
+	model.m_model->EndAnimation();
+
+	for (auto _ : state)
+	{
+		model.m_model->Update();
+		benchmark::DoNotOptimize(model.m_model->GetUpdatePositions());
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * desc.m_vertexCount);
+}
+BENCHMARK(BM_PMXModelUpdate)
+	->ArgsProduct({ { 0, 1, 2, 3, 4 }, { 1, 2, 4, 8 } })
+	->ArgNames({ "weight", "threads" })
+	->Unit(benchmark::kMicrosecond)
+	->UseRealTime();
+
+/*
+	バックエンドのインターリーブされた頂点バッファに書き込むまでの時間
+	Arg 0 : 0 = Update() の結果をコピーする, 1 = Update(MMDVertexSink) で直接書き込む
+*/
+static void BM_PMXModelUpdateToVertexBuffer(benchmark::State& state)
+{
+	struct Vertex
+	{
+		glm::vec3	m_position;
+		glm::vec3	m_normal;
+		glm::vec2	m_uv;
+	};
+
+	saba::bench::BenchModelDesc desc;
+	desc.m_vertexCount = 200000;
+	AnimatedModel model;
+	if (!model.Setup(desc))
+	{
+		state.SkipWithError("Failed to setup.");
+		return;
+	}
+	model.m_model->SetParallelUpdateHint(1);
+
+	model.Evaluate();
+	model.m_model->UpdateAllAnimation(nullptr, 0, 0);
+	model.m_model->EndAnimation();
+
+	const size_t vtxCount = model.m_model->GetVertexCount();
+	std::vector<Vertex> vertexBuffer(vtxCount);
+	saba::MMDVertexSink sink;
+	sink.m_positions = { vertexBuffer.data(), offsetof(Vertex, m_position), sizeof(Vertex) };
+	sink.m_normals = { vertexBuffer.data(), offsetof(Vertex, m_normal), sizeof(Vertex) };
+	sink.m_uvs = { vertexBuffer.data(), offsetof(Vertex, m_uv), sizeof(Vertex) };
+	const bool direct = state.range(0) != 0;
+	for (auto _ : state)
+	{
+		if (direct)
+		{
+			model.m_model->Update(sink);
+		}
+		else
+		{
+			model.m_model->Update();
+			const glm::vec3* positions = model.m_model->GetUpdatePositions();
+			const glm::vec3* normals = model.m_model->GetUpdateNormals();
+			const glm::vec2* uvs = model.m_model->GetUpdateUVs();
+			for (size_t i = 0; i < vtxCount; i++)
+			{
+				vertexBuffer[i].m_position = positions[i];
+				vertexBuffer[i].m_normal = normals[i];
+				vertexBuffer[i].m_uv = uvs[i];
+			}
+		}
+		benchmark::DoNotOptimize(vertexBuffer.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * desc.m_vertexCount);
+}
+BENCHMARK(BM_PMXModelUpdateToVertexBuffer)
+	->Arg(0)->Arg(1)
+	->ArgName("direct")
+	->Unit(benchmark::kMicrosecond)
+	->UseRealTime();
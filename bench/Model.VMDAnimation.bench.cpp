@@ -0,0 +1,147 @@
+﻿#include <benchmark/benchmark.h>
+
+#include "BenchData.h"
+
+#include <Saba/Base/ThreadPool.h>
+#include <Saba/Model/MMD/MMDFileString.h>
+#include <Saba/Model/MMD/VMDAnimation.h>
+#include <Saba/Model/MMD/VMDFile.h>
+
+#include <map>
+#include <string>
+
+static void BM_VMDAnimationAdd(benchmark::State& state)
+{
+	saba::bench::BenchModelDesc model;
+	model.m_vertexCount = 1000;
+	model.m_boneCount = uint32_t(state.range(0));
+	saba::bench::BenchAnimDesc anim;
+	anim.m_keyInterval = uint32_t(state.range(1));
+
+	auto pmxModel = saba::bench::LoadBenchModel(model);
+	auto filepath = saba::bench::GetBenchVMDFile(model, anim);
+	saba::VMDFile vmd;
+	if (pmxModel == nullptr || filepath.empty() || !saba::ReadVMDFile(&vmd, filepath.c_str()))
+	{
+		state.SkipWithError("Failed to setup.");
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		saba::VMDAnimation vmdAnim;
+		vmdAnim.Create(pmxModel);
+		if (!vmdAnim.Add(vmd))
+		{
+			state.SkipWithError("VMDAnimation::Add failed.");
+			break;
+		}
+		benchmark::DoNotOptimize(vmdAnim.GetMaxKeyTime());
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(vmd.m_motions.size() + vmd.m_morphs.size()));
+}
+BENCHMARK(BM_VMDAnimationAdd)->Args({ 128, 5 })->Args({ 512, 1 })->Unit(benchmark::kMillisecond);
+
+/*
+	VMDAnimation::Add のキーの名前からノードを探す部分.
+	Arg 0 : 0 : キーごとに UTF-8 に変換して std::map で探す (以前の Add)
+	        1 : 変換前の名前で MMDFileStringMap から探す (名前ごとに一度だけ変換する)
+*/
+static void BM_VMDKeyNameLookup(benchmark::State& state)
+{
+	saba::bench::BenchModelDesc model;
+	model.m_vertexCount = 1000;
+	model.m_boneCount = 512;
+	saba::bench::BenchAnimDesc anim;
+	anim.m_keyInterval = 1;
+
+	auto pmxModel = saba::bench::LoadBenchModel(model);
+	auto filepath = saba::bench::GetBenchVMDFile(model, anim);
+	saba::VMDFile vmd;
+	if (pmxModel == nullptr || filepath.empty() || !saba::ReadVMDFile(&vmd, filepath.c_str()))
+	{
+		state.SkipWithError("Failed to setup.");
+		return;
+	}
+
+	const bool intern = state.range(0) != 0;
+	for (auto _ : state)
+	{
+		size_t found = 0;
+		if (intern)
+		{
+			saba::MMDFileStringMap<15, saba::MMDNode*> nameTable;
+			for (const auto& motion : vmd.m_motions)
+			{
+				auto it = nameTable.find(motion.m_boneName);
+				if (it == nameTable.end())
+				{
+					auto* node = pmxModel->GetNodeManager()->GetMMDNode(motion.m_boneName.ToUtf8String());
+					it = nameTable.emplace(motion.m_boneName, node).first;
+				}
+				found += it->second != nullptr ? 1 : 0;
+			}
+		}
+		else
+		{
+			std::map<std::string, saba::MMDNode*> nameMap;
+			for (const auto& motion : vmd.m_motions)
+			{
+				std::string name = motion.m_boneName.ToUtf8String();
+				auto it = nameMap.find(name);
+				if (it == nameMap.end())
+				{
+					auto* node = pmxModel->GetNodeManager()->GetMMDNode(name);
+					it = nameMap.emplace(name, node).first;
+				}
+				found += it->second != nullptr ? 1 : 0;
+			}
+		}
+		benchmark::DoNotOptimize(found);
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(vmd.m_motions.size()));
+}
+BENCHMARK(BM_VMDKeyNameLookup)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+/*
+	Arg 0 : ボーン数
+	Arg 1 : 並列評価に使うスレッド数 (0 : 直列)
+*/
+static void BM_VMDAnimationEvaluate(benchmark::State& state)
+{
+	saba::bench::BenchModelDesc model;
+	model.m_vertexCount = 1000;
+	model.m_boneCount = uint32_t(state.range(0));
+	saba::bench::BenchAnimDesc anim;
+
+	auto pmxModel = saba::bench::LoadBenchModel(model);
+	auto vmdAnim = pmxModel != nullptr ? saba::bench::LoadBenchAnimation(pmxModel, model, anim) : nullptr;
+	if (vmdAnim == nullptr)
+	{
+		state.SkipWithError("Failed to setup.");
+		return;
+	}
+
+	std::unique_ptr<saba::ThreadPool> pool;
+	if (state.range(1) != 0)
+	{
+		pool.reset(new saba::ThreadPool(size_t(state.range(1))));
+		vmdAnim->SetParallelEvaluate(pool.get(), 0);
+	}
+
+	float frame = 0;
+	for (auto _ : state)
+	{
+		vmdAnim->Evaluate(frame);
+		frame += 1.0f;
+		if (frame > float(anim.m_frameCount))
+		{
+			frame = 0;
+		}
+	}
+	state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(vmdAnim->GetNodeControllerCount()));
+}
+BENCHMARK(BM_VMDAnimationEvaluate)
+	->Args({ 128, 0 })->Args({ 512, 0 })->Args({ 2048, 0 })
+	->Args({ 2048, 2 })->Args({ 2048, 4 })
+	->Unit(benchmark::kMicrosecond);
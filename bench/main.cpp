@@ -0,0 +1,18 @@
+﻿#include <benchmark/benchmark.h>
+
+#include <Saba/Base/Log.h>
+
+int main(int argc, char** argv)
+{
+	// 生成したモデルの読み込みで出る警告 (SDEF の使用など) は計測の邪魔になるので抑える
+	saba::Singleton<saba::Logger>::Get()->GetLogger()->set_level(spdlog::level::err);
+
+	::benchmark::Initialize(&argc, argv);
+	if (::benchmark::ReportUnrecognizedArguments(argc, argv))
+	{
+		return 1;
+	}
+	::benchmark::RunSpecifiedBenchmarks();
+	::benchmark::Shutdown();
+	return 0;
+}
@@ -6,6 +6,7 @@
 
 #include <thread>
 #include <atomic>
+#include <cstddef>
 #include <memory>
 #include <vector>
 #include <string>
@@ -915,9 +916,6 @@ void Model::UpdateAnimation(const AppContext& appContext)
 
 void Model::Update(const AppContext& appContext)
 {
-	m_mmdModel->Update();
-
-	size_t vtxCount = m_mmdModel->GetVertexCount();
 	HRESULT hr;
 	D3D11_MAPPED_SUBRESOURCE mapRes;
 	hr = m_context->Map(m_vertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapRes);
@@ -925,16 +923,12 @@ void Model::Update(const AppContext& appContext)
 	{
 		return;
 	}
-	Vertex* vertices = (Vertex*)mapRes.pData;
-	const glm::vec3* positions = m_mmdModel->GetUpdatePositions();
-	const glm::vec3* normals = m_mmdModel->GetUpdateNormals();
-	const glm::vec2* uvs = m_mmdModel->GetUpdateUVs();
-	for (size_t i = 0; i < vtxCount; i++)
-	{
-		vertices[i].m_position = positions[i];
-		vertices[i].m_normal = normals[i];
-		vertices[i].m_uv = uvs[i];
-	}
+	// Skinning writes directly into the mapped vertex buffer
+	saba::MMDVertexSink sink;
+	sink.m_positions = { mapRes.pData, offsetof(Vertex, m_position), sizeof(Vertex) };
+	sink.m_normals = { mapRes.pData, offsetof(Vertex, m_normal), sizeof(Vertex) };
+	sink.m_uvs = { mapRes.pData, offsetof(Vertex, m_uv), sizeof(Vertex) };
+	m_mmdModel->Update(sink);
 	m_context->Unmap(m_vertexBuffer.Get(), 0);
 }
 
@@ -849,15 +849,24 @@ void Model::UpdateAnimation(const AppContext& appContext)
 
 void Model::Update(const AppContext& appContext)
 {
-	m_mmdModel->Update();
-
 	size_t vtxCount = m_mmdModel->GetVertexCount();
-	glBindBuffer(GL_ARRAY_BUFFER, m_posVBO);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec3) * vtxCount, m_mmdModel->GetUpdatePositions());
-	glBindBuffer(GL_ARRAY_BUFFER, m_norVBO);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec3) * vtxCount, m_mmdModel->GetUpdateNormals());
-	glBindBuffer(GL_ARRAY_BUFFER, m_uvVBO);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec2) * vtxCount, m_mmdModel->GetUpdateUVs());
+	auto mapVBO = [vtxCount](GLuint vbo, size_t elementSize)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		return glMapBufferRange(GL_ARRAY_BUFFER, 0, elementSize * vtxCount, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	};
+
+	// Skinning writes directly into the mapped VBOs
+	saba::MMDVertexSink sink;
+	sink.m_positions.m_data = mapVBO(m_posVBO, sizeof(glm::vec3));
+	sink.m_normals.m_data = mapVBO(m_norVBO, sizeof(glm::vec3));
+	sink.m_uvs.m_data = mapVBO(m_uvVBO, sizeof(glm::vec2));
+	m_mmdModel->Update(sink);
+	for (GLuint vbo : { m_posVBO, m_norVBO, m_uvVBO })
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
@@ -15,6 +15,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <cstddef>
 #include <memory>
 #include <map>
 #include <type_traits>
@@ -3402,10 +3403,6 @@ void Model::Update(AppContext& appContext)
 	auto device = appContext.m_device;
 
 	size_t vtxCount = m_mmdModel->GetVertexCount();
-	m_mmdModel->Update();
-	const glm::vec3* position = m_mmdModel->GetUpdatePositions();
-	const glm::vec3* normal = m_mmdModel->GetUpdateNormals();
-	const glm::vec2* uv = m_mmdModel->GetUpdateUVs();
 
 	// Update vertices
 
@@ -3424,17 +3421,12 @@ void Model::Update(AppContext& appContext)
 		std::cout << "Failed to map memory.\n";
 		return;
 	}
-	auto v = static_cast<Vertex*>(vbStMem);
-	for (size_t i = 0; i < vtxCount; i++)
-	{
-		v->m_position = *position;
-		v->m_normal = *normal;
-		v->m_uv = *uv;
-		v++;
-		position++;
-		normal++;
-		uv++;
-	}
+	// Skinning writes directly into the staging buffer
+	saba::MMDVertexSink sink;
+	sink.m_positions = { vbStMem, offsetof(Vertex, m_position), sizeof(Vertex) };
+	sink.m_normals = { vbStMem, offsetof(Vertex, m_normal), sizeof(Vertex) };
+	sink.m_uvs = { vbStMem, offsetof(Vertex, m_uv), sizeof(Vertex) };
+	m_mmdModel->Update(sink);
 	device.unmapMemory(vbStBuf->m_memory);
 
 	if (!vbStBuf->CopyBuffer(appContext, res.m_modelResource.m_vertexBuffer.m_buffer, memSize))
@@ -0,0 +1,111 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/BufferedWriter.h>
+#include <Saba/Base/File.h>
+#include <Saba/Base/Path.h>
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+namespace
+{
+	std::string FormatFloatString(float value)
+	{
+		char buf[32];
+		saba::FormatFloat(buf, value);
+		return buf;
+	}
+
+	std::string SnprintfString(float value)
+	{
+		char buf[32];
+		snprintf(buf, sizeof(buf), "%g", value);
+		return buf;
+	}
+}
+
+TEST(BaseTest, FormatFloat)
+{
+	EXPECT_EQ("0", FormatFloatString(0.0f));
+	EXPECT_EQ("-0", FormatFloatString(-0.0f));
+	EXPECT_EQ("1", FormatFloatString(1.0f));
+	EXPECT_EQ("-1.5", FormatFloatString(-1.5f));
+	EXPECT_EQ("0.1", FormatFloatString(0.1f));
+	EXPECT_EQ("123456", FormatFloatString(123456.0f));
+	EXPECT_EQ("1e+06", FormatFloatString(1000000.0f));
+	EXPECT_EQ("1e-05", FormatFloatString(0.00001f));
+	EXPECT_EQ("10", FormatFloatString(9.9999996f));
+	EXPECT_EQ("inf", FormatFloatString(INFINITY));
+
+	// %g と同じ表記になることを確認
+	std::mt19937 rnd(12345);
+	std::uniform_real_distribution<float> dist(-1000.0f, 1000.0f);
+	std::uniform_real_distribution<float> distSmall(-1.0f, 1.0f);
+	int mismatchCount = 0;
+	for (int i = 0; i < 10000; i++)
+	{
+		float values[] = { dist(rnd), distSmall(rnd), distSmall(rnd) * 0.001f };
+		for (float value : values)
+		{
+			if (FormatFloatString(value) != SnprintfString(value))
+			{
+				// 丸めの境界だけは一致しない場合がある
+				float diff = std::abs(std::stof(FormatFloatString(value)) - std::stof(SnprintfString(value)));
+				EXPECT_LE(diff, std::abs(value) * 1.0e-5f);
+				mismatchCount++;
+			}
+		}
+	}
+	EXPECT_LT(mismatchCount, 10);
+}
+
+TEST(BaseTest, FormatUInt)
+{
+	char buf[16];
+	EXPECT_EQ(1, saba::FormatUInt(buf, 0));
+	EXPECT_STREQ("0", buf);
+	EXPECT_EQ(10, saba::FormatUInt(buf, 4294967295u));
+	EXPECT_STREQ("4294967295", buf);
+}
+
+TEST(BaseTest, BufferedWriter)
+{
+	// 書き込みサイズの計測
+	{
+		saba::BufferedWriter writer(64);
+		writer.OpenNull();
+		for (int i = 0; i < 100; i++)
+		{
+			writer.WriteString("v ");
+			writer.WriteFloat(1.25f);
+			writer.WriteChar('\n');
+		}
+		writer.WriteValue(uint32_t(1));
+		EXPECT_EQ(100 * 7 + 4, writer.GetWrittenSize());
+		EXPECT_TRUE(writer.Close());
+	}
+
+	// ファイルに書き込んだ内容を確認
+	{
+		std::string path = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "buffered_writer_test.txt");
+		saba::BufferedWriter writer(64);
+		ASSERT_TRUE(writer.Open(path));
+		std::string expected;
+		for (uint32_t i = 0; i < 100; i++)
+		{
+			writer.WriteUInt(i);
+			writer.WriteChar(' ');
+			expected += std::to_string(i) + " ";
+		}
+		EXPECT_TRUE(writer.Close());
+
+		saba::File file;
+		ASSERT_TRUE(file.Open(path));
+		std::vector<char> data;
+		EXPECT_TRUE(file.ReadAll(&data));
+		file.Close();
+		EXPECT_EQ(expected, std::string(data.begin(), data.end()));
+		remove(path.c_str());
+	}
+}
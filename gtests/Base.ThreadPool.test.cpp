@@ -0,0 +1,88 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/ThreadPool.h>
+
+#include <atomic>
+
+TEST(BaseTest, ThreadPool)
+{
+	saba::ThreadPool pool(4);
+	EXPECT_EQ(4, pool.GetThreadCount());
+
+	// 戻り値を future で受け取れることを確認
+	auto future = pool.Enqueue([]() { return 42; });
+	EXPECT_EQ(42, future.get());
+
+	// 全てのタスクが一度ずつ実行されることを確認
+	std::atomic<int> counter(0);
+	std::vector<std::future<void>> futures;
+	for (int i = 0; i < 100; i++)
+	{
+		futures.emplace_back(pool.Enqueue([&counter]() { counter++; }));
+	}
+	for (auto& f : futures)
+	{
+		f.wait();
+	}
+	EXPECT_EQ(100, counter.load());
+	EXPECT_EQ(0, pool.GetPendingTaskCount());
+}
+
+TEST(BaseTest, ThreadPoolDestroy)
+{
+	// 破棄時にキューに残っているタスクも実行されることを確認
+	std::atomic<int> counter(0);
+	{
+		saba::ThreadPool pool(1);
+		for (int i = 0; i < 10; i++)
+		{
+			pool.Enqueue([&counter]() { counter++; });
+		}
+	}
+	EXPECT_EQ(10, counter.load());
+}
+
+TEST(BaseTest, ThreadPoolParallelFor)
+{
+	saba::ThreadPool pool(4);
+
+	// 全ての要素が一度ずつ処理されることを確認
+	std::vector<std::atomic<int>> counts(1000);
+	for (auto& count : counts)
+	{
+		count = 0;
+	}
+	pool.ParallelFor(counts.size(), 7, [&counts](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			counts[i]++;
+		}
+	});
+	for (const auto& count : counts)
+	{
+		EXPECT_EQ(1, count.load());
+	}
+
+	// ワーカーが埋まっていても呼び出し元で処理が終わることを確認
+	std::atomic<bool> release(false);
+	std::vector<std::future<void>> blockers;
+	for (size_t i = 0; i < pool.GetThreadCount(); i++)
+	{
+		blockers.emplace_back(pool.Enqueue([&release]()
+		{
+			while (!release.load())
+			{
+				std::this_thread::yield();
+			}
+		}));
+	}
+	std::atomic<size_t> total(0);
+	pool.ParallelFor(100, 10, [&total](size_t begin, size_t end) { total += end - begin; });
+	EXPECT_EQ(100, total.load());
+	release = true;
+	for (auto& blocker : blockers)
+	{
+		blocker.wait();
+	}
+}
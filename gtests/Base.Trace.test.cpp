@@ -0,0 +1,86 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/Trace.h>
+#include <Saba/Base/File.h>
+#include <Saba/Base/Path.h>
+
+#include <nlohmann/json.hpp>
+
+#include <cstdio>
+#include <set>
+#include <string>
+#include <thread>
+
+TEST(BaseTest, Trace)
+{
+	saba::Trace::Enable(false);
+	saba::Trace::Clear();
+
+	// 無効の場合は記録しない
+	{
+		SABA_TRACE_SCOPE("Disabled");
+	}
+	EXPECT_EQ(0, saba::Trace::GetEventCount());
+
+	saba::Trace::Enable(true);
+	saba::Trace::SetThreadName("Main \"Thread\"");
+	{
+		SABA_TRACE_SCOPE("Outer");
+		{
+			SABA_TRACE_SCOPE("Inner");
+		}
+	}
+	std::thread worker([]()
+	{
+		saba::Trace::SetThreadName("Worker");
+		SABA_TRACE_SCOPE("WorkerScope");
+	});
+	worker.join();
+	saba::Trace::Enable(false);
+	EXPECT_EQ(3, saba::Trace::GetEventCount());
+
+	std::string path = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "trace_test.json");
+	EXPECT_TRUE(saba::Trace::WriteChromeTrace(path));
+
+	saba::TextFileReader reader(path);
+	std::string text = reader.ReadAll();
+	reader.Close();
+	remove(path.c_str());
+
+	auto trace = nlohmann::json::parse(text);
+	ASSERT_TRUE(trace["traceEvents"].is_array());
+
+	std::set<std::string> threadNames;
+	std::set<std::string> eventNames;
+	int mainTid = -1;
+	int outerTid = -2;
+	for (const auto& ev : trace["traceEvents"])
+	{
+		std::string ph = ev["ph"];
+		if (ph == "M")
+		{
+			threadNames.insert(ev["args"]["name"].get<std::string>());
+			if (ev["args"]["name"] == "Main \"Thread\"")
+			{
+				mainTid = ev["tid"];
+			}
+		}
+		else
+		{
+			EXPECT_EQ("X", ph);
+			EXPECT_GE(ev["dur"].get<double>(), 0.0);
+			eventNames.insert(ev["name"].get<std::string>());
+			if (ev["name"] == "Outer")
+			{
+				outerTid = ev["tid"];
+			}
+		}
+	}
+	EXPECT_EQ(1, threadNames.count("Main \"Thread\""));
+	EXPECT_EQ(1, threadNames.count("Worker"));
+	EXPECT_EQ(mainTid, outerTid);
+	EXPECT_EQ(std::set<std::string>({ "Outer", "Inner", "WorkerScope" }), eventNames);
+
+	saba::Trace::Clear();
+	EXPECT_EQ(0, saba::Trace::GetEventCount());
+}
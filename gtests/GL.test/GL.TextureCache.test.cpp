@@ -0,0 +1,64 @@
+﻿#include <Saba/GL/GLTextureCache.h>
+#include <Saba/Base/Path.h>
+
+#include <gtest/gtest.h>
+
+#define __u8(x) u8 ## x
+#define _u8(x)	__u8(x)
+
+TEST(GLTest, TextureCacheTest)
+{
+	std::string dataPath = _u8(TEST_DATA_PATH);
+	dataPath = saba::PathUtil::Combine(dataPath, "Image");
+
+	saba::GLTextureCache cache;
+	auto pngPath = saba::PathUtil::Combine(dataPath, "test.png");
+	auto jpgPath = saba::PathUtil::Combine(dataPath, "test.jpg");
+
+	{
+		// 同じファイルは同じテクスチャを返す
+		auto tex1 = cache.Get(pngPath);
+		EXPECT_NE(0, tex1.Get());
+		auto tex2 = cache.Get(saba::PathUtil::Combine(dataPath, "./../Image/test.png"));
+		EXPECT_EQ(tex1.Get(), tex2.Get());
+		EXPECT_TRUE(cache.Contains(pngPath));
+
+		// オプションが違えば別のテクスチャ
+		auto tex3 = cache.Get(pngPath, false);
+		EXPECT_NE(tex1.Get(), tex3.Get());
+
+		auto stats = cache.GetStats();
+		EXPECT_EQ(1, stats.m_hitCount);
+		EXPECT_EQ(2, stats.m_missCount);
+		EXPECT_EQ(2, stats.m_textureCount);
+		EXPECT_NE(0, stats.m_memorySize);
+
+		// 参照されているテクスチャは予算を超えても破棄しない
+		cache.SetMemoryBudget(0);
+		EXPECT_EQ(2, cache.GetStats().m_textureCount);
+		EXPECT_EQ(0, cache.GetStats().m_evictCount);
+	}
+
+	// 参照がなくなったので破棄される
+	cache.Evict();
+	auto stats = cache.GetStats();
+	EXPECT_EQ(0, stats.m_textureCount);
+	EXPECT_EQ(0, stats.m_memorySize);
+	EXPECT_EQ(2, stats.m_evictCount);
+
+	// 古いものから破棄される
+	cache.SetMemoryBudget(64 * 64 * 3 * 2);
+	cache.Get(pngPath, false);
+	cache.Get(jpgPath, false);
+	cache.Get(pngPath, false);
+	cache.Get(saba::PathUtil::Combine(dataPath, "test.bmp"), false);
+	EXPECT_TRUE(cache.Contains(pngPath, false));
+	EXPECT_FALSE(cache.Contains(jpgPath, false));
+
+	// 読み込めないファイルはキャッシュしない
+	auto errorTex = cache.Get(saba::PathUtil::Combine(dataPath, "error.png"));
+	EXPECT_EQ(0, errorTex.Get());
+
+	cache.Clear();
+	EXPECT_EQ(0, cache.GetStats().m_textureCount);
+}
@@ -0,0 +1,222 @@
+﻿#include <Saba/GL/GLTextureTranscoder.h>
+#include <Saba/Base/File.h>
+#include <Saba/Base/Path.h>
+
+#include <gtest/gtest.h>
+
+#include <tinyddsloader.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define __u8(x) u8 ## x
+#define _u8(x)	__u8(x)
+
+namespace
+{
+	saba::TextureImage MakeTestImage(int width, int height, bool alpha)
+	{
+		saba::TextureImage image;
+		image.m_format = alpha ? saba::TextureImage::Format::R8G8B8A8 : saba::TextureImage::Format::R8G8B8;
+		image.m_width = width;
+		image.m_height = height;
+		size_t pixelSize = alpha ? 4 : 3;
+		image.m_data.resize(size_t(width) * size_t(height) * pixelSize);
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				uint8_t* pixel = &image.m_data[(size_t(y) * width + x) * pixelSize];
+				pixel[0] = uint8_t(x * 255 / width);
+				pixel[1] = uint8_t(y * 255 / height);
+				pixel[2] = 128;
+				if (alpha)
+				{
+					pixel[3] = uint8_t((x + y) % 2 == 0 ? 255 : 64);
+				}
+			}
+		}
+		return image;
+	}
+
+	bool CopyFile(const std::string& src, const std::string& dst)
+	{
+		std::vector<char> data;
+		saba::File file;
+		if (!file.Open(src) || !file.ReadAll(&data))
+		{
+			return false;
+		}
+		file.Close();
+		return file.Create(dst) && file.Write(data.data(), data.size());
+	}
+
+	// 無圧縮の 24 bit TGA を書き出す
+	bool WriteTGA(const std::string& filename, int width, int height)
+	{
+		std::vector<uint8_t> data(18 + size_t(width) * size_t(height) * 3, 128);
+		memset(data.data(), 0, 18);
+		data[2] = 2;
+		data[12] = uint8_t(width & 0xFF);
+		data[13] = uint8_t(width >> 8);
+		data[14] = uint8_t(height & 0xFF);
+		data[15] = uint8_t(height >> 8);
+		data[16] = 24;
+		saba::File file;
+		return file.Create(filename) && file.Write(data.data(), data.size());
+	}
+
+	std::vector<uint8_t> ReadFile(const std::string& filename)
+	{
+		std::vector<uint8_t> data;
+		saba::File file;
+		if (file.Open(filename))
+		{
+			file.ReadAll(&data);
+		}
+		return data;
+	}
+}
+
+TEST(GLTest, TextureCompressTest)
+{
+	// 不透明な画像は BC1
+	{
+		saba::TextureImage dds;
+		ASSERT_TRUE(saba::CompressTextureImage(MakeTestImage(64, 32, false), saba::TextureCompression::Auto, &dds));
+		EXPECT_EQ(saba::TextureImage::Format::DDS, dds.m_format);
+
+		tinyddsloader::DDSFile ddsFile;
+		ASSERT_EQ(tinyddsloader::Result::Success, ddsFile.Load(std::move(dds.m_data)));
+		EXPECT_EQ(tinyddsloader::DDSFile::DXGIFormat::BC1_UNorm, ddsFile.GetFormat());
+		EXPECT_EQ(64u, ddsFile.GetWidth());
+		EXPECT_EQ(32u, ddsFile.GetHeight());
+		EXPECT_EQ(7u, ddsFile.GetMipCount());
+		EXPECT_TRUE(ddsFile.Flip());
+	}
+
+	// 透明なピクセルを持つ画像は BC3
+	{
+		saba::TextureImage dds;
+		ASSERT_TRUE(saba::CompressTextureImage(MakeTestImage(30, 16, true), saba::TextureCompression::Auto, &dds));
+
+		tinyddsloader::DDSFile ddsFile;
+		ASSERT_EQ(tinyddsloader::Result::Success, ddsFile.Load(std::move(dds.m_data)));
+		EXPECT_EQ(tinyddsloader::DDSFile::DXGIFormat::BC3_UNorm, ddsFile.GetFormat());
+		EXPECT_EQ(30u, ddsFile.GetWidth());
+		EXPECT_EQ(16u, ddsFile.GetHeight());
+		EXPECT_EQ(5u, ddsFile.GetMipCount());
+	}
+
+	// 高さが 2 のべき乗でない画像と HDR は変換しない
+	{
+		saba::TextureImage dds;
+		EXPECT_FALSE(saba::CompressTextureImage(MakeTestImage(64, 48, false), saba::TextureCompression::Auto, &dds));
+
+		saba::TextureImage hdr;
+		hdr.m_format = saba::TextureImage::Format::R32G32B32F;
+		hdr.m_width = 4;
+		hdr.m_height = 4;
+		hdr.m_data.resize(sizeof(float) * 3 * 16);
+		EXPECT_FALSE(saba::CompressTextureImage(hdr, saba::TextureCompression::Auto, &dds));
+	}
+}
+
+TEST(GLTest, TextureTranscodeFileTest)
+{
+	std::string dataPath = _u8(TEST_DATA_PATH);
+	dataPath = saba::PathUtil::Combine(dataPath, "Image");
+
+	// テストデータのディレクトリに変換したファイルを作らないようにコピーする
+	auto imagePath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_transcode.png");
+	auto ddsPath = saba::GetCompressedTexturePath(imagePath);
+	ASSERT_TRUE(CopyFile(saba::PathUtil::Combine(dataPath, "test.png"), imagePath));
+	std::remove(ddsPath.c_str());
+
+	// 最初は変換して保存し、次からは保存したファイルを読み込む
+	std::vector<uint8_t> firstData;
+	for (int i = 0; i < 2; i++)
+	{
+		saba::TextureImage image;
+		ASSERT_TRUE(saba::LoadTextureImageFromFileCompressed(&image, imagePath));
+		EXPECT_EQ(saba::TextureImage::Format::DDS, image.m_format);
+		saba::FileStatus status;
+		ASSERT_TRUE(saba::GetFileStatus(ddsPath, &status));
+		EXPECT_EQ(int64_t(image.m_data.size()), status.m_size);
+		if (i == 0)
+		{
+			firstData = image.m_data;
+		}
+		else
+		{
+			EXPECT_EQ(firstData, image.m_data);
+		}
+	}
+	EXPECT_EQ(saba::TranscodeResult::Succeeded, saba::TranscodeTextureFile(imagePath));
+	EXPECT_EQ(firstData, ReadFile(ddsPath));
+
+	// 変換済みのファイルと形式が違う場合は変換し直す
+	{
+		tinyddsloader::DDSFile ddsFile;
+		ASSERT_EQ(tinyddsloader::Result::Success, ddsFile.Load(std::vector<uint8_t>(firstData)));
+		auto format = ddsFile.GetFormat();
+		auto other = format == tinyddsloader::DDSFile::DXGIFormat::BC1_UNorm ?
+			saba::TextureCompression::BC3 : saba::TextureCompression::BC1;
+		EXPECT_EQ(saba::TranscodeResult::Succeeded, saba::TranscodeTextureFile(imagePath, other));
+		ASSERT_EQ(tinyddsloader::Result::Success, ddsFile.Load(ReadFile(ddsPath)));
+		EXPECT_NE(format, ddsFile.GetFormat());
+		EXPECT_EQ(saba::TranscodeResult::Succeeded, saba::TranscodeTextureFile(imagePath, saba::TextureCompression::Auto));
+		ASSERT_EQ(tinyddsloader::Result::Success, ddsFile.Load(ReadFile(ddsPath)));
+		EXPECT_NE(format, ddsFile.GetFormat());
+	}
+
+	// 元の画像が変わったら変換し直す
+	ASSERT_TRUE(CopyFile(saba::PathUtil::Combine(dataPath, "test.jpg"), imagePath));
+	{
+		saba::TextureImage image;
+		ASSERT_TRUE(saba::LoadTextureImageFromFileCompressed(&image, imagePath));
+		EXPECT_EQ(saba::TextureImage::Format::DDS, image.m_format);
+		EXPECT_NE(firstData, image.m_data);
+	}
+
+	// 壊れたファイルは使わない
+	{
+		saba::File file;
+		ASSERT_TRUE(file.Create(ddsPath));
+		ASSERT_TRUE(file.Write(firstData.data(), firstData.size() / 2));
+	}
+	{
+		saba::TextureImage image;
+		ASSERT_TRUE(saba::LoadTextureImageFromFileCompressed(&image, imagePath));
+		tinyddsloader::DDSFile ddsFile;
+		EXPECT_EQ(tinyddsloader::Result::Success, ddsFile.Load(std::move(image.m_data)));
+	}
+
+	// DDS は変換しない
+	{
+		auto srcDDSPath = saba::PathUtil::Combine(dataPath, "test.dds");
+		saba::TextureImage image;
+		ASSERT_TRUE(saba::LoadTextureImageFromFileCompressed(&image, srcDDSPath));
+		EXPECT_EQ(saba::TextureImage::Format::DDS, image.m_format);
+		saba::FileStatus status;
+		EXPECT_FALSE(saba::GetFileStatus(saba::GetCompressedTexturePath(srcDDSPath), &status));
+		EXPECT_EQ(saba::TranscodeResult::Skipped, saba::TranscodeTextureFile(srcDDSPath));
+	}
+
+	// 高さが 2 のべき乗でない画像は変換せずにスキップする
+	{
+		auto tgaPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_transcode.tga");
+		ASSERT_TRUE(WriteTGA(tgaPath, 64, 48));
+		EXPECT_EQ(saba::TranscodeResult::Skipped, saba::TranscodeTextureFile(tgaPath));
+		saba::FileStatus status;
+		EXPECT_FALSE(saba::GetFileStatus(saba::GetCompressedTexturePath(tgaPath), &status));
+		std::remove(tgaPath.c_str());
+	}
+
+	// 見つからない画像は失敗
+	EXPECT_EQ(saba::TranscodeResult::Failed, saba::TranscodeTextureFile(imagePath + ".notfound.png"));
+
+	std::remove(imagePath.c_str());
+	std::remove(ddsPath.c_str());
+}
@@ -1,8 +1,12 @@
 ﻿#include <Saba/GL/GLTextureUtil.h>
+#include <Saba/Base/File.h>
 #include <Saba/Base/Path.h>
 
 #include <gtest/gtest.h>
 
+#include <cstdio>
+#include <vector>
+
 #define __u8(x) u8 ## x
 #define _u8(x)	__u8(x)
 
@@ -74,3 +78,74 @@ TEST(GLTest, TextureTest)
 	}
 #endif // defined(NDEBUG)
 }
+
+TEST(GLTest, TextureImageCacheTest)
+{
+	std::string dataPath = _u8(TEST_DATA_PATH);
+	dataPath = saba::PathUtil::Combine(dataPath, "Image");
+
+	// テストデータのディレクトリにキャッシュを作らないようにコピーする
+	auto imagePath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_texture.png");
+	auto cachePath = saba::GetTextureImageCachePath(imagePath);
+	{
+		std::vector<char> data;
+		saba::File file;
+		ASSERT_TRUE(file.Open(saba::PathUtil::Combine(dataPath, "test.png")));
+		ASSERT_TRUE(file.ReadAll(&data));
+		file.Close();
+		ASSERT_TRUE(file.Create(imagePath));
+		ASSERT_TRUE(file.Write(data.data(), data.size()));
+	}
+	std::remove(cachePath.c_str());
+
+	saba::TextureImage expected;
+	ASSERT_TRUE(saba::LoadTextureImageFromFile(&expected, imagePath));
+
+	// 最初はデコードしてキャッシュを作り、次からはキャッシュから読み込む
+	for (int i = 0; i < 2; i++)
+	{
+		saba::TextureImage image;
+		ASSERT_TRUE(saba::LoadTextureImageFromFileCached(&image, imagePath));
+		EXPECT_EQ(expected.m_format, image.m_format);
+		EXPECT_EQ(expected.m_width, image.m_width);
+		EXPECT_EQ(expected.m_height, image.m_height);
+		EXPECT_EQ(expected.m_data, image.m_data);
+		saba::FileStatus status;
+		EXPECT_TRUE(saba::GetFileStatus(cachePath, &status));
+	}
+
+	// オプションが違う場合はデコードし直す
+	{
+		saba::TextureImage expectedRGBA;
+		ASSERT_TRUE(saba::LoadTextureImageFromFile(&expectedRGBA, imagePath, true));
+		saba::TextureImage image;
+		ASSERT_TRUE(saba::LoadTextureImageFromFileCached(&image, imagePath, true));
+		EXPECT_EQ(expectedRGBA.m_format, image.m_format);
+		EXPECT_EQ(expectedRGBA.m_data, image.m_data);
+	}
+
+	// 壊れたキャッシュは使わない
+	{
+		saba::File file;
+		ASSERT_TRUE(file.Create(cachePath));
+		ASSERT_TRUE(file.Write("SPTC", 4));
+	}
+	{
+		saba::TextureImage image;
+		ASSERT_TRUE(saba::LoadTextureImageFromFileCached(&image, imagePath));
+		EXPECT_EQ(expected.m_data, image.m_data);
+	}
+
+	// DDS はキャッシュしない
+	{
+		auto ddsPath = saba::PathUtil::Combine(dataPath, "test.dds");
+		saba::TextureImage image;
+		ASSERT_TRUE(saba::LoadTextureImageFromFileCached(&image, ddsPath));
+		EXPECT_EQ(saba::TextureImage::Format::DDS, image.m_format);
+		saba::FileStatus status;
+		EXPECT_FALSE(saba::GetFileStatus(saba::GetTextureImageCachePath(ddsPath), &status));
+	}
+
+	std::remove(imagePath.c_str());
+	std::remove(cachePath.c_str());
+}
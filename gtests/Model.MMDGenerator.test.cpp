@@ -0,0 +1,212 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/Path.h>
+#include <Saba/Model/MMD/MMDGenerator.h>
+#include <Saba/Model/MMD/PMXFile.h>
+#include <Saba/Model/MMD/PMXModel.h>
+#include <Saba/Model/MMD/VMDAnimation.h>
+#include <Saba/Model/MMD/VMDFile.h>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+namespace
+{
+	saba::PMXGenerateParam MakeSmallParam(uint8_t encode)
+	{
+		saba::PMXGenerateParam param;
+		param.m_vertexCount = 320;
+		param.m_boneCount = 24;
+		param.m_materialCount = 2;
+		for (auto& ratio : param.m_weightRatio)
+		{
+			ratio = 1.0f;
+		}
+		param.m_positionMorphCount = 2;
+		param.m_uvMorphCount = 1;
+		param.m_boneMorphCount = 1;
+		param.m_materialMorphCount = 1;
+		param.m_groupMorphCount = 1;
+		param.m_morphVertexCount = 20;
+		param.m_rigidbodyCount = 4;
+		param.m_encode = encode;
+		return param;
+	}
+
+	void CheckRoundTrip(uint8_t encode, const std::string& filepath)
+	{
+		saba::PMXFile pmx;
+		ASSERT_TRUE(saba::GeneratePMXFile(&pmx, MakeSmallParam(encode)));
+		ASSERT_TRUE(saba::WritePMXFile(&pmx, filepath.c_str()));
+
+		saba::PMXFile readPMX;
+		ASSERT_TRUE(saba::ReadPMXFile(&readPMX, filepath.c_str()));
+		std::remove(filepath.c_str());
+
+		EXPECT_EQ(encode, readPMX.m_header.m_encode);
+		EXPECT_EQ(pmx.m_info.m_modelName, readPMX.m_info.m_modelName);
+
+		ASSERT_EQ(pmx.m_vertices.size(), readPMX.m_vertices.size());
+		bool usedWeights[5] = {};
+		for (size_t vi = 0; vi < pmx.m_vertices.size(); vi++)
+		{
+			const auto& v0 = pmx.m_vertices[vi];
+			const auto& v1 = readPMX.m_vertices[vi];
+			ASSERT_EQ(v0.m_weightType, v1.m_weightType);
+			usedWeights[int(v0.m_weightType)] = true;
+			EXPECT_EQ(v0.m_position, v1.m_position);
+			EXPECT_EQ(v0.m_boneIndices[0], v1.m_boneIndices[0]);
+			// BDEF1 のウェイトはファイルに含まれない
+			if (v0.m_weightType != saba::PMXVertexWeight::BDEF1)
+			{
+				EXPECT_EQ(v0.m_boneWeights[0], v1.m_boneWeights[0]);
+			}
+			if (v0.m_weightType == saba::PMXVertexWeight::BDEF4 ||
+				v0.m_weightType == saba::PMXVertexWeight::QDEF)
+			{
+				for (int i = 0; i < 4; i++)
+				{
+					EXPECT_EQ(v0.m_boneIndices[i], v1.m_boneIndices[i]);
+					EXPECT_EQ(v0.m_boneWeights[i], v1.m_boneWeights[i]);
+				}
+			}
+			if (v0.m_weightType == saba::PMXVertexWeight::SDEF)
+			{
+				EXPECT_EQ(v0.m_sdefC, v1.m_sdefC);
+				EXPECT_EQ(v0.m_sdefR0, v1.m_sdefR0);
+				EXPECT_EQ(v0.m_sdefR1, v1.m_sdefR1);
+			}
+		}
+		for (bool used : usedWeights)
+		{
+			EXPECT_TRUE(used);
+		}
+
+		ASSERT_EQ(pmx.m_faces.size(), readPMX.m_faces.size());
+		for (size_t fi = 0; fi < pmx.m_faces.size(); fi++)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				EXPECT_EQ(pmx.m_faces[fi].m_vertices[i], readPMX.m_faces[fi].m_vertices[i]);
+			}
+		}
+
+		ASSERT_EQ(pmx.m_materials.size(), readPMX.m_materials.size());
+		EXPECT_EQ(pmx.m_materials[1].m_numFaceVertices, readPMX.m_materials[1].m_numFaceVertices);
+		EXPECT_EQ(-1, readPMX.m_materials[0].m_textureIndex);
+
+		ASSERT_EQ(pmx.m_bones.size(), readPMX.m_bones.size());
+		for (size_t bi = 0; bi < pmx.m_bones.size(); bi++)
+		{
+			const auto& b0 = pmx.m_bones[bi];
+			const auto& b1 = readPMX.m_bones[bi];
+			EXPECT_EQ(b0.m_name, b1.m_name);
+			EXPECT_EQ(b0.m_parentBoneIndex, b1.m_parentBoneIndex);
+			EXPECT_EQ(b0.m_boneFlag, b1.m_boneFlag);
+			EXPECT_EQ(b0.m_ikLinks.size(), b1.m_ikLinks.size());
+			if (!b0.m_ikLinks.empty())
+			{
+				EXPECT_EQ(b0.m_ikTargetBoneIndex, b1.m_ikTargetBoneIndex);
+				EXPECT_EQ(b0.m_ikLinks[0].m_limitMin, b1.m_ikLinks[0].m_limitMin);
+			}
+		}
+
+		ASSERT_EQ(pmx.m_morphs.size(), readPMX.m_morphs.size());
+		for (size_t mi = 0; mi < pmx.m_morphs.size(); mi++)
+		{
+			const auto& m0 = pmx.m_morphs[mi];
+			const auto& m1 = readPMX.m_morphs[mi];
+			EXPECT_EQ(m0.m_name, m1.m_name);
+			EXPECT_EQ(m0.m_morphType, m1.m_morphType);
+			EXPECT_EQ(m0.m_positionMorph.size(), m1.m_positionMorph.size());
+			EXPECT_EQ(m0.m_uvMorph.size(), m1.m_uvMorph.size());
+			EXPECT_EQ(m0.m_boneMorph.size(), m1.m_boneMorph.size());
+			EXPECT_EQ(m0.m_materialMorph.size(), m1.m_materialMorph.size());
+			EXPECT_EQ(m0.m_groupMorph.size(), m1.m_groupMorph.size());
+		}
+
+		EXPECT_EQ(pmx.m_displayFrames.size(), readPMX.m_displayFrames.size());
+		EXPECT_EQ(pmx.m_rigidbodies.size(), readPMX.m_rigidbodies.size());
+		EXPECT_EQ(pmx.m_joints.size(), readPMX.m_joints.size());
+	}
+}
+
+TEST(ModelTest, MMDGeneratorPMXRoundTrip)
+{
+	CheckRoundTrip(1, "saba_gtest_generated_utf8.pmx");
+	CheckRoundTrip(0, "saba_gtest_generated_utf16.pmx");
+}
+
+TEST(ModelTest, MMDGeneratorPMXIndexSize)
+{
+	const std::string pmxPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_index_size.pmx");
+
+	// ボーンのインデックスは符号付きなので、128 以上は 2 バイトにする
+	auto param = MakeSmallParam(1);
+	param.m_boneCount = 200;
+	saba::PMXFile pmx;
+	ASSERT_TRUE(saba::GeneratePMXFile(&pmx, param));
+	EXPECT_EQ(2, pmx.m_header.m_vertexIndexSize);
+	EXPECT_EQ(2, pmx.m_header.m_boneIndexSize);
+	EXPECT_EQ(1, pmx.m_header.m_materialIndexSize);
+	ASSERT_TRUE(saba::WritePMXFile(&pmx, pmxPath.c_str()));
+
+	saba::PMXFile readPMX;
+	ASSERT_TRUE(saba::ReadPMXFile(&readPMX, pmxPath.c_str()));
+	ASSERT_EQ(pmx.m_bones.size(), readPMX.m_bones.size());
+	for (size_t bi = 0; bi < pmx.m_bones.size(); bi++)
+	{
+		EXPECT_EQ(pmx.m_bones[bi].m_parentBoneIndex, readPMX.m_bones[bi].m_parentBoneIndex);
+	}
+
+	// 収まらないインデックスは切り捨てずに失敗する
+	pmx.m_header.m_boneIndexSize = 1;
+	EXPECT_FALSE(saba::WritePMXFile(&pmx, pmxPath.c_str()));
+	pmx.m_header.m_boneIndexSize = 2;
+	pmx.m_header.m_vertexIndexSize = 1;
+	EXPECT_FALSE(saba::WritePMXFile(&pmx, pmxPath.c_str()));
+
+	std::remove(pmxPath.c_str());
+}
+
+TEST(ModelTest, MMDGeneratorVMDRoundTrip)
+{
+	const std::string pmxPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_generated.pmx");
+	const std::string vmdPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_generated.vmd");
+
+	saba::PMXFile pmx;
+	ASSERT_TRUE(saba::GeneratePMXFile(&pmx, MakeSmallParam(1)));
+	ASSERT_TRUE(saba::WritePMXFile(&pmx, pmxPath.c_str()));
+
+	saba::VMDGenerateParam vmdParam;
+	vmdParam.m_frameCount = 60;
+	vmdParam.m_nodeKeyInterval = 10;
+	vmdParam.m_morphKeyInterval = 20;
+	vmdParam.m_ikKeyInterval = 30;
+	saba::VMDFile vmd;
+	ASSERT_TRUE(saba::GenerateVMDFile(&vmd, pmx, vmdParam));
+	ASSERT_TRUE(saba::WriteVMDFile(&vmd, vmdPath.c_str()));
+
+	saba::VMDFile readVMD;
+	ASSERT_TRUE(saba::ReadVMDFile(&readVMD, vmdPath.c_str()));
+	EXPECT_EQ(pmx.m_bones.size() * 7, readVMD.m_motions.size());
+	EXPECT_EQ(pmx.m_morphs.size() * 4, readVMD.m_morphs.size());
+	ASSERT_EQ(3u, readVMD.m_iks.size());
+	EXPECT_EQ(2u, readVMD.m_iks[0].m_ikInfos.size());
+	EXPECT_EQ(0, readVMD.m_iks[1].m_ikInfos[0].m_enable);
+	ASSERT_EQ(vmd.m_motions.size(), readVMD.m_motions.size());
+	EXPECT_EQ(vmd.m_motions[1].m_boneName.ToString(), readVMD.m_motions[1].m_boneName.ToString());
+	EXPECT_EQ(vmd.m_motions[1].m_quaternion, readVMD.m_motions[1].m_quaternion);
+	EXPECT_EQ(vmd.m_motions[1].m_interpolation, readVMD.m_motions[1].m_interpolation);
+
+	// 生成したファイルがそのままモデル、アニメーションとして読めること
+	auto model = std::make_shared<saba::PMXModel>();
+	EXPECT_TRUE(model->Load(pmxPath, saba::PathUtil::GetCWD()));
+	saba::VMDAnimation anim;
+	EXPECT_TRUE(anim.Create(model));
+	EXPECT_TRUE(anim.Add(readVMD));
+
+	std::remove(pmxPath.c_str());
+	std::remove(vmdPath.c_str());
+}
@@ -0,0 +1,298 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/Path.h>
+#include <Saba/Model/MMD/MMDGenerator.h>
+#include <Saba/Model/MMD/MMDIkSolver.h>
+#include <Saba/Model/MMD/PMXModel.h>
+#include <Saba/Model/MMD/VMDAnimation.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+	struct LegModel
+	{
+		saba::MMDNode	m_root;
+		saba::MMDNode	m_hip;
+		saba::MMDNode	m_knee;
+		saba::MMDNode	m_ankle;
+		saba::MMDNode	m_ik;
+
+		LegModel()
+		{
+			m_root.AddChild(&m_hip);
+			m_hip.AddChild(&m_knee);
+			m_knee.AddChild(&m_ankle);
+			m_root.AddChild(&m_ik);
+
+			m_hip.SetTranslate(glm::vec3(1.0f, 10.0f, 0.0f));
+			m_knee.SetTranslate(glm::vec3(0.0f, -4.5f, -0.2f));
+			m_ankle.SetTranslate(glm::vec3(0.0f, -4.0f, 0.3f));
+			m_hip.EnableIK(true);
+			m_knee.EnableIK(true);
+		}
+
+		void SetupSolver(saba::MMDIkSolver* solver)
+		{
+			solver->SetIKNode(&m_ik);
+			solver->SetTargetNode(&m_ankle);
+			solver->AddIKChain(&m_knee, true);
+			solver->AddIKChain(&m_hip);
+			solver->SetIterateCount(40);
+			solver->SetLimitAngle(glm::radians(114.5916f));
+			solver->SetupSolveMode();
+		}
+	};
+}
+
+TEST(ModelTest, MMDIkSolverTwoBone)
+{
+	LegModel leg;
+	saba::MMDIkSolver solver;
+	leg.SetupSolver(&solver);
+	// デフォルトは CCD
+	EXPECT_FALSE(solver.IsTwoBoneSolve());
+
+	solver.EnableTwoBoneSolve(true);
+	EXPECT_TRUE(solver.IsTwoBoneSolve());
+
+	// ターゲットがひざの子でない場合は CCD
+	saba::MMDNode other;
+	saba::MMDIkSolver otherSolver;
+	otherSolver.SetIKNode(&leg.m_ik);
+	otherSolver.SetTargetNode(&other);
+	otherSolver.AddIKChain(&leg.m_knee, true);
+	otherSolver.AddIKChain(&leg.m_hip);
+	otherSolver.EnableTwoBoneSolve(true);
+	otherSolver.SetupSolveMode();
+	EXPECT_FALSE(otherSolver.IsTwoBoneSolve());
+}
+
+TEST(ModelTest, MMDIkSolverTwoBoneMotion)
+{
+	saba::PMXGenerateParam param;
+	param.m_vertexCount = 100;
+	param.m_boneCount = 16;
+	param.m_positionMorphCount = 0;
+	param.m_rigidbodyCount = 0;
+	param.m_ikChainCount = 2;
+	saba::PMXFile pmx;
+	ASSERT_TRUE(saba::GeneratePMXFile(&pmx, param));
+	const std::string pmxPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_two_bone.pmx");
+	ASSERT_TRUE(saba::WritePMXFile(&pmx, pmxPath.c_str()));
+
+	saba::VMDGenerateParam vmdParam;
+	vmdParam.m_frameCount = 300;
+	vmdParam.m_morphKeyInterval = 0;
+	saba::VMDFile vmd;
+	ASSERT_TRUE(saba::GenerateVMDFile(&vmd, pmx, vmdParam));
+
+	// 生成した脚のモーションを CCD と解析解で再生して、フレームごとのポーズを比べる
+	struct Result
+	{
+		std::vector<glm::mat4>	m_transforms;
+		std::vector<glm::quat>	m_kneeRotates;
+		uint32_t				m_iterateCount = 0;
+	};
+	std::vector<size_t> legIndices;
+	for (size_t bi = 0; bi < pmx.m_bones.size(); bi++)
+	{
+		if (pmx.m_bones[bi].m_name.compare(0, 4, "leg_") == 0)
+		{
+			legIndices.push_back(bi);
+		}
+	}
+	ASSERT_EQ(2u, legIndices.size());
+	auto play = [&](bool twoBone, Result* result)
+	{
+		auto model = std::make_shared<saba::PMXModel>();
+		ASSERT_TRUE(model->Load(pmxPath, saba::PathUtil::GetCWD()));
+		saba::VMDAnimation anim;
+		ASSERT_TRUE(anim.Create(model));
+		ASSERT_TRUE(anim.Add(vmd));
+		auto ikMan = model->GetIKManager();
+		ASSERT_EQ(2u, ikMan->GetIKSolverCount());
+		for (size_t i = 0; i < ikMan->GetIKSolverCount(); i++)
+		{
+			ikMan->GetMMDIKSolver(i)->EnableTwoBoneSolve(twoBone);
+			ASSERT_EQ(twoBone, ikMan->GetMMDIKSolver(i)->IsTwoBoneSolve());
+		}
+		auto nodeMan = model->GetNodeManager();
+		for (uint32_t frame = 0; frame <= vmdParam.m_frameCount; frame++)
+		{
+			model->BeginAnimation();
+			model->UpdateAllAnimation(&anim, float(frame), 0);
+			model->EndAnimation();
+			for (size_t i = 0; i < ikMan->GetIKSolverCount(); i++)
+			{
+				result->m_iterateCount += ikMan->GetMMDIKSolver(i)->GetLastIterateCount();
+			}
+			for (size_t ni = 0; ni < nodeMan->GetNodeCount(); ni++)
+			{
+				result->m_transforms.push_back(nodeMan->GetMMDNode(ni)->GetGlobalTransform());
+			}
+			for (size_t leg : legIndices)
+			{
+				auto knee = nodeMan->GetMMDNode(leg + 1);
+				result->m_kneeRotates.push_back(knee->GetIKRotate() * knee->AnimateRotate());
+			}
+		}
+	};
+	Result ccd;
+	Result twoBone;
+	play(false, &ccd);
+	play(true, &twoBone);
+	std::remove(pmxPath.c_str());
+	ASSERT_EQ(ccd.m_transforms.size(), twoBone.m_transforms.size());
+
+	const size_t nodeCount = pmx.m_bones.size();
+	// PMX の回転制限は読み込み時に符号を反転する
+	const auto& kneeLink = pmx.m_bones[legIndices[0] + 3].m_ikLinks[0];
+	const float kneeLimitMin = -kneeLink.m_limitMax.x;
+	const float kneeLimitMax = -kneeLink.m_limitMin.x;
+	for (uint32_t frame = 0; frame <= vmdParam.m_frameCount; frame++)
+	{
+		const glm::mat4* ccdNodes = &ccd.m_transforms[frame * nodeCount];
+		const glm::mat4* nodes = &twoBone.m_transforms[frame * nodeCount];
+		auto pos = [](const glm::mat4& m) { return glm::vec3(m[3]); };
+		for (size_t bi = 0; bi < nodeCount; bi++)
+		{
+			// IK のチェイン以外は CCD と同じ
+			bool isChain = std::any_of(legIndices.begin(), legIndices.end(), [bi](size_t leg) { return bi >= leg && bi < leg + 3; });
+			if (!isChain)
+			{
+				EXPECT_EQ(ccdNodes[bi], nodes[bi]);
+			}
+		}
+		for (size_t li = 0; li < legIndices.size(); li++)
+		{
+			const size_t leg = legIndices[li];
+			const glm::vec3 hip = pos(nodes[leg]);
+			const glm::vec3 ankle = pos(nodes[leg + 2]);
+			const glm::vec3 ik = pos(nodes[leg + 3]);
+			EXPECT_EQ(hip, pos(ccdNodes[leg]));
+
+			// ひざは X 軸だけを制限の範囲内で回転する
+			const glm::quat& kneeRot = twoBone.m_kneeRotates[frame * legIndices.size() + li];
+			EXPECT_NEAR(0.0f, kneeRot.y, 1.0e-5f);
+			EXPECT_NEAR(0.0f, kneeRot.z, 1.0e-5f);
+			float kneeAngle = 2.0f * std::atan2(kneeRot.x, kneeRot.w);
+			EXPECT_GE(kneeAngle, kneeLimitMin - 1.0e-5f);
+			EXPECT_LE(kneeAngle, kneeLimitMax + 1.0e-5f);
+
+			// ひざが制限に掛からない (届く範囲の) 場合、足首は IK の位置に一致する
+			if (kneeAngle > kneeLimitMin + 1.0e-4f && kneeAngle < kneeLimitMax - 1.0e-4f)
+			{
+				EXPECT_NEAR(0.0f, glm::length(ankle - ik), 1.0e-5f) << "frame " << frame << " leg " << li;
+			}
+			EXPECT_LE(glm::length(ankle - ik), glm::length(pos(ccdNodes[leg + 2]) - ik) + 1.0e-5f);
+
+			// ひざの向き (足から足首の軸周りのひねり) は CCD と一致する
+			auto kneeDir = [&](const glm::mat4* n)
+			{
+				glm::vec3 axis = glm::normalize(pos(n[leg + 2]) - pos(n[leg]));
+				glm::vec3 dir = pos(n[leg + 1]) - pos(n[leg]);
+				return glm::normalize(dir - axis * glm::dot(axis, dir));
+			};
+			EXPECT_NEAR(1.0f, glm::dot(kneeDir(ccdNodes), kneeDir(nodes)), 2.0e-6f) << "frame " << frame << " leg " << li;
+		}
+	}
+	EXPECT_LT(twoBone.m_iterateCount * 4, ccd.m_iterateCount);
+}
+
+TEST(ModelTest, MMDIkSolverWarmStart)
+{
+	// 髪などの回転制限のないチェイン
+	saba::MMDNode root;
+	saba::MMDNode bones[3];
+	saba::MMDNode tip;
+	saba::MMDNode ik;
+	saba::MMDNode* parent = &root;
+	for (auto& bone : bones)
+	{
+		parent->AddChild(&bone);
+		bone.SetTranslate(glm::vec3(0, -2.0f, 0.1f));
+		bone.EnableIK(true);
+		parent = &bone;
+	}
+	bones[0].SetTranslate(glm::vec3(0, 10.0f, 0));
+	parent->AddChild(&tip);
+	tip.SetTranslate(glm::vec3(0, -2.0f, 0));
+	root.AddChild(&ik);
+
+	saba::MMDIkSolver solver;
+	solver.SetIKNode(&ik);
+	solver.SetTargetNode(&tip);
+	solver.AddIKChain(&bones[2]);
+	solver.AddIKChain(&bones[1]);
+	solver.AddIKChain(&bones[0]);
+	solver.SetIterateCount(40);
+	solver.SetLimitAngle(glm::radians(57.29578f));
+	solver.SetupSolveMode();
+	EXPECT_FALSE(solver.IsTwoBoneSolve());
+
+	// 少しずつ動く IK を解く
+	auto solveFrames = [&](uint32_t* iterateCount, float* maxDist)
+	{
+		*iterateCount = 0;
+		*maxDist = 0;
+		for (int frame = 0; frame < 60; frame++)
+		{
+			float t = float(frame) / 30.0f;
+			ik.SetAnimationTranslate(glm::vec3(1.5f * std::sin(t), 5.5f + 0.5f * std::cos(t), 1.0f + 0.5f * t));
+			saba::MMDNode* nodes[] = { &root, &bones[0], &bones[1], &bones[2], &tip, &ik };
+			for (auto node : nodes)
+			{
+				node->SetIKRotate(glm::quat(1, 0, 0, 0));
+				node->UpdateLocalTransform();
+			}
+			root.UpdateGlobalTransform();
+
+			solver.Solve();
+			*iterateCount += solver.GetLastIterateCount();
+			*maxDist = std::max(*maxDist, solver.GetLastDistance());
+		}
+	};
+
+	// 許容値がデフォルト (0) のままでも、ウォームスタートは反復回数が少なくなる
+	EXPECT_EQ(0.0f, solver.GetTolerance());
+	uint32_t coldDefaultIterateCount;
+	float coldDefaultMaxDist;
+	solveFrames(&coldDefaultIterateCount, &coldDefaultMaxDist);
+	solver.EnableWarmStart(true);
+	uint32_t warmDefaultIterateCount;
+	float warmDefaultMaxDist;
+	solveFrames(&warmDefaultIterateCount, &warmDefaultMaxDist);
+	EXPECT_LT(warmDefaultIterateCount, coldDefaultIterateCount);
+	EXPECT_LE(warmDefaultMaxDist, 1.0e-2f);
+	solver.EnableWarmStart(false);
+
+	solver.SetTolerance(1.0e-3f);
+	uint32_t coldIterateCount;
+	float coldMaxDist;
+	solveFrames(&coldIterateCount, &coldMaxDist);
+	EXPECT_FALSE(solver.IsEnabledWarmStart());
+	EXPECT_LE(coldMaxDist, 1.0e-2f);
+
+	solver.EnableWarmStart(true);
+	uint32_t warmIterateCount;
+	float warmMaxDist;
+	solveFrames(&warmIterateCount, &warmMaxDist);
+	EXPECT_LT(warmIterateCount, coldIterateCount);
+	EXPECT_LE(warmMaxDist, 1.0e-2f);
+
+	// 同じ状態で解いた場合は反復しない
+	solver.SetTolerance(1.0e-2f);
+	solver.Solve();
+	EXPECT_EQ(0u, solver.GetLastIterateCount());
+	EXPECT_LE(solver.GetLastDistance(), 1.0e-2f);
+
+	// 無効にした IK は解かない
+	solver.Enable(false);
+	solver.Solve();
+	EXPECT_EQ(0u, solver.GetLastIterateCount());
+}
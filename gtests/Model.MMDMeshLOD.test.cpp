@@ -0,0 +1,196 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Model/MMD/MMDMeshLOD.h>
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <vector>
+#include <glm/geometric.hpp>
+
+namespace
+{
+	// (n + 1) x (n + 1) 頂点の XY 平面のグリッド
+	struct GridMesh
+	{
+		size_t	m_n;
+		std::vector<glm::vec3>					m_positions;
+		std::vector<saba::MMDLODVertexWeight>	m_weights;
+		std::vector<uint32_t>					m_indices;
+		std::vector<saba::MMDSubMesh>			m_subMeshes;
+
+		explicit GridMesh(size_t n, size_t splitX = 0)
+			: m_n(n)
+		{
+			for (size_t y = 0; y <= n; y++)
+			{
+				for (size_t x = 0; x <= n; x++)
+				{
+					m_positions.emplace_back(float(x), float(y), 0.0f);
+					saba::MMDLODVertexWeight weight = { { 0, -1, -1, -1 }, { 1.0f, 0.0f, 0.0f, 0.0f } };
+					m_weights.push_back(weight);
+				}
+			}
+
+			// splitX より左と右を別のサブメッシュにする
+			for (int sub = 0; sub < (splitX == 0 ? 1 : 2); sub++)
+			{
+				saba::MMDSubMesh subMesh;
+				subMesh.m_beginIndex = int(m_indices.size());
+				subMesh.m_materialID = sub;
+				for (size_t y = 0; y < n; y++)
+				{
+					for (size_t x = 0; x < n; x++)
+					{
+						if (splitX != 0 && (x < splitX) != (sub == 0))
+						{
+							continue;
+						}
+						uint32_t v0 = Index(x, y);
+						uint32_t v1 = Index(x + 1, y);
+						uint32_t v2 = Index(x + 1, y + 1);
+						uint32_t v3 = Index(x, y + 1);
+						m_indices.insert(m_indices.end(), { v0, v1, v2, v0, v2, v3 });
+					}
+				}
+				subMesh.m_vertexCount = int(m_indices.size()) - subMesh.m_beginIndex;
+				m_subMeshes.push_back(subMesh);
+			}
+		}
+
+		uint32_t Index(size_t x, size_t y) const { return uint32_t(y * (m_n + 1) + x); }
+
+		bool Build(float ratio, saba::MMDMeshLOD* lod) const
+		{
+			return saba::BuildMMDMeshLOD(
+				m_positions.data(), m_weights.data(), m_positions.size(),
+				m_indices.data(), m_subMeshes.data(), m_subMeshes.size(),
+				ratio, lod
+			);
+		}
+	};
+
+	float SignedArea(const GridMesh& mesh, const uint32_t* tri)
+	{
+		const auto& p0 = mesh.m_positions[tri[0]];
+		const auto& p1 = mesh.m_positions[tri[1]];
+		const auto& p2 = mesh.m_positions[tri[2]];
+		return glm::cross(p1 - p0, p2 - p0).z * 0.5f;
+	}
+
+	void CheckLOD(const GridMesh& mesh, const saba::MMDMeshLOD& lod)
+	{
+		ASSERT_EQ(0, lod.m_indices.size() % 3);
+		std::set<uint32_t> referenced;
+		for (auto idx : lod.m_indices)
+		{
+			ASSERT_LT(idx, mesh.m_positions.size());
+			referenced.insert(idx);
+		}
+		EXPECT_EQ(std::vector<uint32_t>(referenced.begin(), referenced.end()), lod.m_vertices);
+
+		// サブメッシュは隙間なく並ぶ
+		ASSERT_EQ(mesh.m_subMeshes.size(), lod.m_subMeshes.size());
+		int beginIndex = 0;
+		for (size_t i = 0; i < lod.m_subMeshes.size(); i++)
+		{
+			EXPECT_EQ(mesh.m_subMeshes[i].m_materialID, lod.m_subMeshes[i].m_materialID);
+			EXPECT_EQ(beginIndex, lod.m_subMeshes[i].m_beginIndex);
+			beginIndex += lod.m_subMeshes[i].m_vertexCount;
+		}
+		EXPECT_EQ(int(lod.m_indices.size()), beginIndex);
+
+		// 平面なので、面が裏返らず穴も開かなければ面積は変わらない
+		float area = 0.0f;
+		for (size_t i = 0; i < lod.m_indices.size(); i += 3)
+		{
+			float triArea = SignedArea(mesh, &lod.m_indices[i]);
+			EXPECT_GT(triArea, 0.0f);
+			area += triArea;
+		}
+		EXPECT_NEAR(float(mesh.m_n * mesh.m_n), area, 1.0e-3f);
+	}
+}
+
+TEST(ModelTest, MMDMeshLODReduce)
+{
+	GridMesh mesh(16);
+	saba::MMDMeshLOD lod;
+	ASSERT_TRUE(mesh.Build(0.25f, &lod));
+	CheckLOD(mesh, lod);
+
+	size_t triCount = mesh.m_indices.size() / 3;
+	size_t lodTriCount = lod.m_indices.size() / 3;
+	EXPECT_LT(lodTriCount, triCount / 2);
+
+	// 境界の頂点は残る
+	for (size_t i = 0; i <= mesh.m_n; i++)
+	{
+		for (auto v : { mesh.Index(i, 0), mesh.Index(i, mesh.m_n), mesh.Index(0, i), mesh.Index(mesh.m_n, i) })
+		{
+			EXPECT_TRUE(std::binary_search(lod.m_vertices.begin(), lod.m_vertices.end(), v));
+		}
+	}
+
+	// 比率 1 なら何もしない
+	saba::MMDMeshLOD fullLOD;
+	ASSERT_TRUE(mesh.Build(1.0f, &fullLOD));
+	EXPECT_EQ(mesh.m_indices.size(), fullLOD.m_indices.size());
+}
+
+TEST(ModelTest, MMDMeshLODBoneWeight)
+{
+	// 列ごとに別のボーンにすると、縦方向にしか縮約できない
+	GridMesh mesh(16);
+	for (size_t y = 0; y <= mesh.m_n; y++)
+	{
+		for (size_t x = 0; x <= mesh.m_n; x++)
+		{
+			mesh.m_weights[mesh.Index(x, y)].m_boneIndex[0] = int32_t(x % 2);
+		}
+	}
+
+	saba::MMDMeshLOD lod;
+	ASSERT_TRUE(mesh.Build(0.25f, &lod));
+	CheckLOD(mesh, lod);
+	EXPECT_LT(lod.m_indices.size(), mesh.m_indices.size());
+
+	for (size_t i = 0; i < lod.m_indices.size(); i += 3)
+	{
+		float minX = mesh.m_positions[lod.m_indices[i]].x;
+		float maxX = minX;
+		for (size_t j = 1; j < 3; j++)
+		{
+			minX = std::min(minX, mesh.m_positions[lod.m_indices[i + j]].x);
+			maxX = std::max(maxX, mesh.m_positions[lod.m_indices[i + j]].x);
+		}
+		EXPECT_LE(maxX - minX, 1.0f);
+	}
+}
+
+TEST(ModelTest, MMDMeshLODSubMesh)
+{
+	GridMesh mesh(16, 8);
+	saba::MMDMeshLOD lod;
+	ASSERT_TRUE(mesh.Build(0.25f, &lod));
+	CheckLOD(mesh, lod);
+	EXPECT_LT(lod.m_indices.size(), mesh.m_indices.size());
+
+	// サブメッシュの三角形は元の範囲から出ない
+	for (size_t sub = 0; sub < lod.m_subMeshes.size(); sub++)
+	{
+		const auto& subMesh = lod.m_subMeshes[sub];
+		for (int i = 0; i < subMesh.m_vertexCount; i++)
+		{
+			float x = mesh.m_positions[lod.m_indices[subMesh.m_beginIndex + i]].x;
+			if (sub == 0)
+			{
+				EXPECT_LE(x, 8.0f);
+			}
+			else
+			{
+				EXPECT_GE(x, 8.0f);
+			}
+		}
+	}
+}
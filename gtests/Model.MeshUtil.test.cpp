@@ -0,0 +1,295 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/File.h>
+#include <Saba/Base/Path.h>
+#include <Saba/Model/MeshUtil.h>
+#include <Saba/Model/MMD/MMDGenerator.h>
+#include <Saba/Model/MMD/PMXCache.h>
+#include <Saba/Model/MMD/PMXFile.h>
+#include <Saba/Model/MMD/PMXModel.h>
+#include <Saba/Model/OBJ/OBJModel.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// size x size のグリッド (三角形の順番はシャッフルする)
+	std::vector<uint32_t> MakeGridIndices(uint32_t size, uint32_t seed)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (uint32_t y = 0; y < size; y++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				uint32_t v0 = y * (size + 1) + x;
+				uint32_t v1 = v0 + 1;
+				uint32_t v2 = v0 + size + 1;
+				uint32_t v3 = v2 + 1;
+				triangles.push_back({ { v0, v2, v1 } });
+				triangles.push_back({ { v1, v2, v3 } });
+			}
+		}
+		std::mt19937 rand(seed);
+		std::shuffle(triangles.begin(), triangles.end(), rand);
+
+		std::vector<uint32_t> indices;
+		for (const auto& tri : triangles)
+		{
+			indices.insert(indices.end(), tri.begin(), tri.end());
+		}
+		return indices;
+	}
+
+	// 三角形の集合 (頂点の回転は区別しない) として比較するために並べ替える
+	std::vector<std::array<uint32_t, 3>> SortTriangles(const uint32_t* indices, size_t indexCount)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			std::array<uint32_t, 3> tri = { { indices[i], indices[i + 1], indices[i + 2] } };
+			std::rotate(tri.begin(), std::min_element(tri.begin(), tri.end()), tri.end());
+			triangles.push_back(tri);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	std::vector<uint32_t> GetPMXIndices(const saba::PMXModel& model)
+	{
+		std::vector<uint32_t> indices(model.GetIndexCount());
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			switch (model.GetIndexElementSize())
+			{
+			case 1: indices[i] = ((const uint8_t*)model.GetIndices())[i]; break;
+			case 2: indices[i] = ((const uint16_t*)model.GetIndices())[i]; break;
+			case 4: indices[i] = ((const uint32_t*)model.GetIndices())[i]; break;
+			}
+		}
+		return indices;
+	}
+}
+
+TEST(MeshUtilTest, VertexCacheOptimizerTest)
+{
+	const uint32_t size = 32;
+	const size_t vertexCount = (size + 1) * (size + 1);
+	auto indices = MakeGridIndices(size, 1);
+	auto optimized = indices;
+
+	saba::VertexCacheOptimizer optimizer(vertexCount);
+	optimizer.Optimize(optimized.data(), optimized.size());
+
+	// 三角形の向きと集合は変わらない
+	EXPECT_EQ(SortTriangles(indices.data(), indices.size()), SortTriangles(optimized.data(), optimized.size()));
+
+	float acmr = saba::ComputeACMR(indices.data(), indices.size(), vertexCount);
+	float optimizedACMR = saba::ComputeACMR(optimized.data(), optimized.size(), vertexCount);
+	EXPECT_GT(acmr, 2.0f);
+	EXPECT_LT(optimizedACMR, 1.0f);
+
+	// 同じインスタンスで別の範囲を処理しても結果は同じ
+	auto optimized2 = indices;
+	optimizer.Optimize(optimized2.data(), 0);
+	optimizer.Optimize(optimized2.data(), optimized2.size());
+	EXPECT_EQ(optimized, optimized2);
+}
+
+TEST(MeshUtilTest, BuildIndexedMeshTest)
+{
+	// 2 つの材質の四角形 (角の位置は共有し、片方だけ法線が違う)
+	std::vector<glm::vec3> positions = {
+		glm::vec3(0, 0, 0), glm::vec3(1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(1, 1, 0),
+		glm::vec3(1, 0, 0),	// 値が同じ位置
+	};
+	std::vector<glm::vec3> normals = { glm::vec3(0, 0, 1), glm::vec3(0, 1, 0) };
+	std::vector<glm::vec2> uvs = { glm::vec2(0, 0), glm::vec2(1, 1) };
+
+	std::vector<saba::MeshFace> faces;
+	auto addFace = [&faces](int p0, int p1, int p2, int n, int uv, int material)
+	{
+		saba::MeshFace face;
+		face.m_position[0] = p0;
+		face.m_position[1] = p1;
+		face.m_position[2] = p2;
+		for (int i = 0; i < 3; i++)
+		{
+			face.m_normal[i] = n;
+			face.m_uv[i] = uv;
+		}
+		face.m_material = material;
+		faces.push_back(face);
+	};
+	addFace(0, 1, 2, 0, 0, 1);
+	addFace(0, 1, 2, 1, 0, 0);
+	addFace(4, 3, 2, 0, 0, 1);
+	addFace(1, 3, 2, -1, -1, 0);
+
+	saba::IndexedMesh mesh;
+	ASSERT_TRUE(saba::BuildIndexedMesh(
+		positions.data(), positions.size(),
+		normals.data(), normals.size(),
+		uvs.data(), uvs.size(),
+		faces.data(), faces.size(),
+		&mesh));
+
+	// 材質 1 の 2 つの三角形は 4 頂点、材質 0 の 2 つの三角形は 3 + 3 頂点 (法線が違う)
+	EXPECT_EQ(10u, mesh.m_positions.size());
+	EXPECT_EQ(mesh.m_positions.size(), mesh.m_normals.size());
+	EXPECT_EQ(mesh.m_positions.size(), mesh.m_uvs.size());
+	ASSERT_EQ(12u, mesh.m_indices.size());
+	ASSERT_EQ(2u, mesh.m_subMeshes.size());
+	EXPECT_EQ(0, mesh.m_subMeshes[0].m_material);
+	EXPECT_EQ(0u, mesh.m_subMeshes[0].m_beginIndex);
+	EXPECT_EQ(6u, mesh.m_subMeshes[0].m_indexCount);
+	EXPECT_EQ(1, mesh.m_subMeshes[1].m_material);
+	EXPECT_EQ(6u, mesh.m_subMeshes[1].m_beginIndex);
+	EXPECT_EQ(6u, mesh.m_subMeshes[1].m_indexCount);
+
+	// 頂点は参照順に並ぶ
+	uint32_t nextIndex = 0;
+	for (auto vi : mesh.m_indices)
+	{
+		EXPECT_LE(vi, nextIndex);
+		if (vi == nextIndex)
+		{
+			nextIndex++;
+		}
+	}
+
+	// 元の面と同じ三角形になっている
+	auto findTriangle = [&mesh](const saba::IndexedMesh::SubMesh& subMesh, glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 n)
+	{
+		for (uint32_t i = 0; i < subMesh.m_indexCount; i += 3)
+		{
+			const uint32_t* tri = &mesh.m_indices[subMesh.m_beginIndex + i];
+			for (int r = 0; r < 3; r++)
+			{
+				if (mesh.m_positions[tri[r]] == p0 &&
+					mesh.m_positions[tri[(r + 1) % 3]] == p1 &&
+					mesh.m_positions[tri[(r + 2) % 3]] == p2 &&
+					mesh.m_normals[tri[r]] == n)
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	};
+	EXPECT_TRUE(findTriangle(mesh.m_subMeshes[1], positions[0], positions[1], positions[2], normals[0]));
+	EXPECT_TRUE(findTriangle(mesh.m_subMeshes[1], positions[1], positions[3], positions[2], normals[0]));
+	EXPECT_TRUE(findTriangle(mesh.m_subMeshes[0], positions[0], positions[1], positions[2], normals[1]));
+	EXPECT_TRUE(findTriangle(mesh.m_subMeshes[0], positions[1], positions[3], positions[2], glm::vec3(0)));
+
+	// 範囲外のインデックス
+	faces[2].m_normal[1] = 2;
+	EXPECT_FALSE(saba::BuildIndexedMesh(
+		positions.data(), positions.size(),
+		normals.data(), normals.size(),
+		uvs.data(), uvs.size(),
+		faces.data(), faces.size(),
+		&mesh));
+}
+
+TEST(MeshUtilTest, OBJModelTest)
+{
+	auto objPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_mesh.obj");
+	{
+		// 面ごとに頂点を持つ 2x2 のグリッド
+		std::string obj = "vn 0 0 1\nvt 0 0\n";
+		for (int y = 0; y < 3; y++)
+		{
+			for (int x = 0; x < 3; x++)
+			{
+				obj += "v " + std::to_string(x) + " " + std::to_string(y) + " 0\n";
+			}
+		}
+		for (int y = 0; y < 2; y++)
+		{
+			for (int x = 0; x < 2; x++)
+			{
+				int v0 = y * 3 + x + 1;
+				auto corner = [](int v) { return std::to_string(v) + "/1/1"; };
+				obj += "f " + corner(v0) + " " + corner(v0 + 1) + " " + corner(v0 + 3) + "\n";
+				obj += "f " + corner(v0 + 1) + " " + corner(v0 + 4) + " " + corner(v0 + 3) + "\n";
+			}
+		}
+		saba::File file;
+		ASSERT_TRUE(file.Create(objPath));
+		ASSERT_TRUE(file.Write(obj.data(), obj.size()));
+	}
+
+	saba::OBJModel objModel;
+	ASSERT_TRUE(objModel.Load(objPath.c_str()));
+	const auto& mesh = objModel.GetMesh();
+	EXPECT_EQ(24u, objModel.GetFaces().size() * 3);
+	EXPECT_EQ(9u, mesh.m_positions.size());
+	EXPECT_EQ(24u, mesh.m_indices.size());
+	ASSERT_EQ(1u, mesh.m_subMeshes.size());
+	EXPECT_EQ(24u, mesh.m_subMeshes[0].m_indexCount);
+
+	std::remove(objPath.c_str());
+}
+
+TEST(MeshUtilTest, PMXVertexCacheOptimizationTest)
+{
+	saba::PMXGenerateParam param;
+	param.m_vertexCount = 2000;
+	param.m_boneCount = 16;
+	param.m_materialCount = 3;
+	param.m_rigidbodyCount = 0;
+
+	saba::PMXFile pmx;
+	ASSERT_TRUE(saba::GeneratePMXFile(&pmx, param));
+	auto pmxPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_vcache.pmx");
+	auto cachePath = saba::GetPMXCachePath(pmxPath);
+	ASSERT_TRUE(saba::WritePMXFile(&pmx, pmxPath.c_str()));
+	std::remove(cachePath.c_str());
+
+	saba::PMXModel model;
+	ASSERT_TRUE(model.Load(pmxPath, saba::PathUtil::GetCWD()));
+	auto indices = GetPMXIndices(model);
+
+	// キャッシュを作ってから、並べ替えを有効にして読み込む (キャッシュは作り直される)
+	std::vector<uint32_t> optimized;
+	for (int useCache = 0; useCache < 2; useCache++)
+	{
+		saba::PMXModel cachedModel;
+		cachedModel.EnableCache(true);
+		cachedModel.EnableVertexCacheOptimization(useCache == 1);
+		ASSERT_TRUE(cachedModel.Load(pmxPath, saba::PathUtil::GetCWD()));
+		if (useCache == 1)
+		{
+			optimized = GetPMXIndices(cachedModel);
+		}
+	}
+	ASSERT_EQ(indices.size(), optimized.size());
+	EXPECT_NE(indices, optimized);
+	{
+		saba::PMXModel cachedModel;
+		cachedModel.EnableCache(true);
+		cachedModel.EnableVertexCacheOptimization(true);
+		ASSERT_TRUE(cachedModel.Load(pmxPath, saba::PathUtil::GetCWD()));
+		EXPECT_EQ(optimized, GetPMXIndices(cachedModel));
+	}
+
+	// 材質の範囲の中で並べ替える
+	for (size_t i = 0; i < model.GetSubMeshCount(); i++)
+	{
+		const auto& subMesh = model.GetSubMeshes()[i];
+		const uint32_t* src = &indices[subMesh.m_beginIndex];
+		const uint32_t* dst = &optimized[subMesh.m_beginIndex];
+		EXPECT_EQ(SortTriangles(src, subMesh.m_vertexCount), SortTriangles(dst, subMesh.m_vertexCount));
+		EXPECT_LE(
+			saba::ComputeACMR(dst, subMesh.m_vertexCount, model.GetVertexCount()),
+			saba::ComputeACMR(src, subMesh.m_vertexCount, model.GetVertexCount()));
+	}
+
+	std::remove(pmxPath.c_str());
+	std::remove(cachePath.c_str());
+}
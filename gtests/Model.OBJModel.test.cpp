@@ -0,0 +1,192 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/File.h>
+#include <Saba/Base/Path.h>
+#include <Saba/Model/OBJ/OBJModel.h>
+
+#include <cstdio>
+#include <string>
+
+namespace
+{
+	bool WriteTextFile(const std::string& filepath, const std::string& text)
+	{
+		saba::File file;
+		return file.Create(filepath) && file.Write(text.data(), text.size());
+	}
+
+	std::string GetTestPath(const char* filename)
+	{
+		return saba::PathUtil::Combine(saba::PathUtil::GetCWD(), filename);
+	}
+}
+
+TEST(OBJModelTest, ReadTest)
+{
+	auto objPath = GetTestPath("saba_gtest_obj.obj");
+	auto mtlPath = GetTestPath("saba_gtest_obj.mtl");
+	ASSERT_TRUE(WriteTextFile(mtlPath,
+		"newmtl red\r\n"
+		"Kd 1 0 0\r\n"
+		"Ns 8\r\n"
+		"map_Kd red.png\r\n"
+		"newmtl green\r\n"
+		"Kd 0 1 0\r\n"
+	));
+	ASSERT_TRUE(WriteTextFile(objPath,
+		"# comment\r\n"
+		"mtllib missing.mtl saba_gtest_obj.mtl\r\n"
+		"o test\r\n"
+		"v 0 0 0\r\n"
+		"v 1.5 0 0 1.0\r\n"
+		"v 1.5 2 0\r\n"
+		"v 0 2 -1e1\r\n"
+		"vt 0 0\r\n"
+		"vt 1 0.25\r\n"
+		"vn 0 0 1\r\n"
+		"f 1 2 3\r\n"
+		"usemtl green\r\n"
+		"g quad\r\n"
+		"f 1/1/1 2/2/1 3/2/1 4/1/1\r\n"
+		"usemtl red\r\n"
+		"s off\r\n"
+		"f -4//-1 -3//-1 -2//-1\r\n"
+		"usemtl unknown\r\n"
+		"f 2/1 3/2 4/2\r\n"
+	));
+
+	saba::OBJModel model;
+	ASSERT_TRUE(model.Load(objPath.c_str()));
+
+	ASSERT_EQ(4u, model.GetPositions().size());
+	EXPECT_EQ(glm::vec3(1.5f, 0, 0), model.GetPositions()[1]);
+	EXPECT_EQ(glm::vec3(0, 2, -10), model.GetPositions()[3]);
+	ASSERT_EQ(2u, model.GetUVs().size());
+	EXPECT_EQ(glm::vec2(1, 0.75f), model.GetUVs()[1]);
+	ASSERT_EQ(1u, model.GetNormals().size());
+	EXPECT_EQ(glm::vec3(0, 0, -10), model.GetBBoxMin());
+	EXPECT_EQ(glm::vec3(1.5f, 2, 0), model.GetBBoxMax());
+
+	// red, green, 材質が無い面用
+	const auto& materials = model.GetMaterials();
+	ASSERT_EQ(3u, materials.size());
+	EXPECT_EQ("red", materials[0].m_name);
+	EXPECT_EQ(glm::vec3(1, 0, 0), materials[0].m_diffuse);
+	EXPECT_FLOAT_EQ(8.0f, materials[0].m_specularPower);
+	EXPECT_EQ("red.png", saba::PathUtil::GetFilename(materials[0].m_diffuseTex));
+	EXPECT_EQ("green", materials[1].m_name);
+	EXPECT_EQ(glm::vec3(0.5f), materials[2].m_diffuse);
+
+	// 四角形は扇形に 2 つの三角形になる
+	const auto& faces = model.GetFaces();
+	ASSERT_EQ(5u, faces.size());
+	const int expected[5][3][3] = {
+		// position, uv, normal
+		{ { 0, 1, 2 }, { -1, -1, -1 }, { -1, -1, -1 } },
+		{ { 0, 1, 2 }, { 0, 1, 1 }, { 0, 0, 0 } },
+		{ { 0, 2, 3 }, { 0, 1, 0 }, { 0, 0, 0 } },
+		{ { 0, 1, 2 }, { -1, -1, -1 }, { 0, 0, 0 } },
+		{ { 1, 2, 3 }, { 0, 1, 1 }, { -1, -1, -1 } },
+	};
+	const int expectedMaterials[5] = { 2, 1, 1, 0, 2 };
+	for (size_t i = 0; i < faces.size(); i++)
+	{
+		for (int vi = 0; vi < 3; vi++)
+		{
+			EXPECT_EQ(expected[i][0][vi], faces[i].m_position[vi]) << "face " << i;
+			EXPECT_EQ(expected[i][1][vi], faces[i].m_uv[vi]) << "face " << i;
+			EXPECT_EQ(expected[i][2][vi], faces[i].m_normal[vi]) << "face " << i;
+		}
+		EXPECT_EQ(expectedMaterials[i], faces[i].m_material) << "face " << i;
+	}
+	EXPECT_EQ(3u, model.GetMesh().m_subMeshes.size());
+
+	std::remove(objPath.c_str());
+	std::remove(mtlPath.c_str());
+}
+
+TEST(OBJModelTest, LargeFileTest)
+{
+	// 複数のチャンクに分けて読まれる大きさにする
+	auto objPath = GetTestPath("saba_gtest_obj_large.obj");
+	auto mtlPath = GetTestPath("saba_gtest_obj_large.mtl");
+	const int quadCount = 40000;
+	const int materialCount = 7;
+	{
+		std::string mtl;
+		for (int i = 0; i < materialCount; i++)
+		{
+			mtl += "newmtl mat" + std::to_string(i) + "\n";
+		}
+		ASSERT_TRUE(WriteTextFile(mtlPath, mtl));
+
+		std::string obj = "mtllib saba_gtest_obj_large.mtl\n";
+		for (int i = 0; i < quadCount; i++)
+		{
+			if (i % 1000 == 0)
+			{
+				obj += "usemtl mat" + std::to_string(i / 1000 % materialCount) + "\n";
+			}
+			obj += "v " + std::to_string(i) + " 0 0\nv " + std::to_string(i) + " 1 0\n";
+			obj += "v " + std::to_string(i) + " 1 1\nv " + std::to_string(i) + " 0 1\n";
+			obj += "vt 0.5 0.5\nvn 1 0 0\n";
+			obj += "f -4/-1/-1 -3/-1/-1 -2/-1/-1 -1/-1/-1\n";
+		}
+		ASSERT_GT(obj.size(), 2u * 1024 * 1024);
+		ASSERT_TRUE(WriteTextFile(objPath, obj));
+	}
+
+	saba::OBJModel model;
+	ASSERT_TRUE(model.Load(objPath.c_str()));
+	ASSERT_EQ(size_t(quadCount * 4), model.GetPositions().size());
+	ASSERT_EQ(size_t(quadCount), model.GetUVs().size());
+	ASSERT_EQ(size_t(quadCount), model.GetNormals().size());
+	ASSERT_EQ(size_t(quadCount * 2), model.GetFaces().size());
+	EXPECT_EQ(size_t(materialCount), model.GetMaterials().size());
+
+	const auto& faces = model.GetFaces();
+	for (int i = 0; i < quadCount; i++)
+	{
+		const auto& face0 = faces[i * 2];
+		const auto& face1 = faces[i * 2 + 1];
+		ASSERT_EQ(i * 4, face0.m_position[0]);
+		ASSERT_EQ(i * 4 + 2, face0.m_position[2]);
+		ASSERT_EQ(i * 4 + 3, face1.m_position[2]);
+		ASSERT_EQ(i, face1.m_uv[1]);
+		ASSERT_EQ(i, face1.m_normal[2]);
+		ASSERT_EQ(i / 1000 % materialCount, face0.m_material);
+		ASSERT_EQ(face0.m_material, face1.m_material);
+		ASSERT_EQ(glm::vec3(float(i), 1, 1), model.GetPositions()[face0.m_position[2]]);
+	}
+
+	std::remove(objPath.c_str());
+	std::remove(mtlPath.c_str());
+}
+
+TEST(OBJModelTest, ReadErrorTest)
+{
+	auto objPath = GetTestPath("saba_gtest_obj_error.obj");
+	saba::OBJModel model;
+	EXPECT_FALSE(model.Load(objPath.c_str()));
+
+	const char* invalidTexts[] = {
+		"v 0 0 0\nv 1 0 0\nv 0 x 0\nf 1 2 3\n",
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 0\n",
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 -4\n",
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n",
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3/1\n",
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3a\n",
+	};
+	for (auto text : invalidTexts)
+	{
+		ASSERT_TRUE(WriteTextFile(objPath, text));
+		EXPECT_FALSE(model.Load(objPath.c_str())) << text;
+	}
+
+	// 空のファイルは空のモデルになる
+	ASSERT_TRUE(WriteTextFile(objPath, ""));
+	EXPECT_TRUE(model.Load(objPath.c_str()));
+	EXPECT_TRUE(model.GetFaces().empty());
+
+	std::remove(objPath.c_str());
+}
@@ -0,0 +1,297 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/File.h>
+#include <Saba/Base/Path.h>
+#include <Saba/Model/MMD/MMDGenerator.h>
+#include <Saba/Model/MMD/PMXCache.h>
+#include <Saba/Model/MMD/PMXFile.h>
+#include <Saba/Model/MMD/PMXModel.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	bool WriteGeneratedPMX(const std::string& filepath, uint32_t seed)
+	{
+		saba::PMXGenerateParam param;
+		param.m_vertexCount = 640;
+		param.m_boneCount = 24;
+		param.m_materialCount = 2;
+		param.m_positionMorphCount = 2;
+		param.m_uvMorphCount = 1;
+		param.m_boneMorphCount = 1;
+		param.m_materialMorphCount = 1;
+		param.m_groupMorphCount = 1;
+		param.m_morphVertexCount = 20;
+		param.m_rigidbodyCount = 4;
+		param.m_seed = seed;
+
+		saba::PMXFile pmx;
+		return saba::GeneratePMXFile(&pmx, param) && saba::WritePMXFile(&pmx, filepath.c_str());
+	}
+
+	std::shared_ptr<saba::PMXModel> LoadModel(const std::string& filepath, bool useCache, bool shareCache = false)
+	{
+		auto model = std::make_shared<saba::PMXModel>();
+		model->EnableCache(useCache);
+		model->EnableSharedCache(shareCache);
+		if (!model->Load(filepath, saba::PathUtil::GetCWD()))
+		{
+			return nullptr;
+		}
+		return model;
+	}
+
+	void ExpectSameModel(saba::PMXModel* expected, saba::PMXModel* actual)
+	{
+		ASSERT_EQ(expected->GetVertexCount(), actual->GetVertexCount());
+		size_t vertexCount = expected->GetVertexCount();
+		EXPECT_EQ(0, memcmp(expected->GetPositions(), actual->GetPositions(), sizeof(glm::vec3) * vertexCount));
+		EXPECT_EQ(0, memcmp(expected->GetNormals(), actual->GetNormals(), sizeof(glm::vec3) * vertexCount));
+		EXPECT_EQ(0, memcmp(expected->GetUVs(), actual->GetUVs(), sizeof(glm::vec2) * vertexCount));
+
+		ASSERT_EQ(expected->GetIndexElementSize(), actual->GetIndexElementSize());
+		ASSERT_EQ(expected->GetIndexCount(), actual->GetIndexCount());
+		EXPECT_EQ(0, memcmp(expected->GetIndices(), actual->GetIndices(), expected->GetIndexElementSize() * expected->GetIndexCount()));
+		EXPECT_EQ(expected->GetBBoxMin(), actual->GetBBoxMin());
+		EXPECT_EQ(expected->GetBBoxMax(), actual->GetBBoxMax());
+
+		ASSERT_EQ(expected->GetSubMeshCount(), actual->GetSubMeshCount());
+		ASSERT_EQ(expected->GetMaterialCount(), actual->GetMaterialCount());
+		for (size_t i = 0; i < expected->GetMaterialCount(); i++)
+		{
+			EXPECT_EQ(expected->GetSubMeshes()[i].m_vertexCount, actual->GetSubMeshes()[i].m_vertexCount);
+			EXPECT_EQ(expected->GetMaterials()[i].m_diffuse, actual->GetMaterials()[i].m_diffuse);
+			EXPECT_EQ(expected->GetMaterials()[i].m_toonTexture, actual->GetMaterials()[i].m_toonTexture);
+		}
+
+		auto expectedNodes = expected->GetNodeManager();
+		auto actualNodes = actual->GetNodeManager();
+		ASSERT_EQ(expectedNodes->GetNodeCount(), actualNodes->GetNodeCount());
+		for (size_t i = 0; i < expectedNodes->GetNodeCount(); i++)
+		{
+			auto expectedNode = expectedNodes->GetMMDNode(i);
+			auto actualNode = actualNodes->GetMMDNode(i);
+			EXPECT_EQ(expectedNode->GetName(), actualNode->GetName());
+			EXPECT_EQ(expectedNode->GetGlobalTransform(), actualNode->GetGlobalTransform());
+		}
+		EXPECT_EQ(expected->GetIKManager()->GetIKSolverCount(), actual->GetIKManager()->GetIKSolverCount());
+
+		auto expectedMorphs = expected->GetMorphManager();
+		auto actualMorphs = actual->GetMorphManager();
+		ASSERT_EQ(expectedMorphs->GetMorphCount(), actualMorphs->GetMorphCount());
+		for (size_t i = 0; i < expectedMorphs->GetMorphCount(); i++)
+		{
+			EXPECT_EQ(expectedMorphs->GetMorph(i)->GetName(), actualMorphs->GetMorph(i)->GetName());
+		}
+		EXPECT_EQ(expected->GetPhysicsManager()->GetRigidBodys()->size(), actual->GetPhysicsManager()->GetRigidBodys()->size());
+		EXPECT_EQ(expected->GetPhysicsManager()->GetJoints()->size(), actual->GetPhysicsManager()->GetJoints()->size());
+
+		// モーフを適用した結果も一致すること
+		for (size_t i = 0; i < expectedMorphs->GetMorphCount(); i++)
+		{
+			expectedMorphs->GetMorph(i)->SetWeight(1.0f);
+			actualMorphs->GetMorph(i)->SetWeight(1.0f);
+		}
+		expected->UpdateAllAnimation(nullptr, 0, 0);
+		actual->UpdateAllAnimation(nullptr, 0, 0);
+		expected->Update();
+		actual->Update();
+		EXPECT_EQ(0, memcmp(expected->GetUpdatePositions(), actual->GetUpdatePositions(), sizeof(glm::vec3) * vertexCount));
+		EXPECT_EQ(0, memcmp(expected->GetUpdateUVs(), actual->GetUpdateUVs(), sizeof(glm::vec2) * vertexCount));
+	}
+
+	// 要素サイズと要素数 (0 なら問わない) が一致するセクションの offset バイト目を書き換える
+	bool CorruptCacheSection(const std::string& cachePath, size_t elementSize, size_t count, size_t offset, const void* value, size_t valueSize)
+	{
+		std::vector<char> data;
+		saba::File file;
+		if (!file.Open(cachePath) || !file.ReadAll(&data))
+		{
+			return false;
+		}
+		file.Close();
+
+		saba::PMXCacheHeader header;
+		memcpy(&header, data.data(), sizeof(header));
+		const saba::PMXCacheSection* found = nullptr;
+		for (uint32_t i = 0; i < header.m_sectionCount; i++)
+		{
+			saba::PMXCacheSection section;
+			memcpy(&section, data.data() + sizeof(header) + sizeof(section) * i, sizeof(section));
+			if (section.m_elementSize == elementSize && section.m_count != 0 && (count == 0 || section.m_count == count))
+			{
+				if (found != nullptr)
+				{
+					return false;
+				}
+				found = reinterpret_cast<const saba::PMXCacheSection*>(data.data() + sizeof(header) + sizeof(section) * i);
+			}
+		}
+		if (found == nullptr || offset + valueSize > found->m_elementSize * found->m_count)
+		{
+			return false;
+		}
+		memcpy(data.data() + found->m_offset + offset, value, valueSize);
+
+		return file.Create(cachePath) && file.Write(data.data(), data.size());
+	}
+}
+
+TEST(ModelTest, PMXCacheLoad)
+{
+	const std::string pmxPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_cache.pmx");
+	const std::string cachePath = saba::GetPMXCachePath(pmxPath);
+	std::remove(cachePath.c_str());
+	ASSERT_TRUE(WriteGeneratedPMX(pmxPath, 0));
+
+	auto model = LoadModel(pmxPath, false);
+	ASSERT_NE(nullptr, model);
+	saba::FileStatus status;
+	EXPECT_FALSE(saba::GetFileStatus(cachePath, &status));
+
+	// 最初の読み込みでキャッシュを作り、次からはキャッシュから読み込む
+	auto cookedModel = LoadModel(pmxPath, true);
+	ASSERT_NE(nullptr, cookedModel);
+	ASSERT_TRUE(saba::GetFileStatus(cachePath, &status));
+
+	saba::PMXCacheReader reader;
+	EXPECT_TRUE(reader.Open(cachePath, pmxPath));
+	reader.Close();
+
+	auto cachedModel = LoadModel(pmxPath, true);
+	ASSERT_NE(nullptr, cachedModel);
+	ExpectSameModel(model.get(), cachedModel.get());
+
+	std::remove(pmxPath.c_str());
+	std::remove(cachePath.c_str());
+}
+
+TEST(ModelTest, PMXCacheInvalidate)
+{
+	const std::string pmxPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_cache_invalidate.pmx");
+	const std::string cachePath = saba::GetPMXCachePath(pmxPath);
+	ASSERT_TRUE(WriteGeneratedPMX(pmxPath, 0));
+	ASSERT_NE(nullptr, LoadModel(pmxPath, true));
+
+	// 内容が変わったファイルに置き換えると、キャッシュは使わない
+	ASSERT_TRUE(WriteGeneratedPMX(pmxPath, 1));
+	saba::PMXCacheReader reader;
+	EXPECT_FALSE(reader.Open(cachePath, pmxPath));
+
+	auto model = LoadModel(pmxPath, false);
+	auto recookedModel = LoadModel(pmxPath, true);
+	ASSERT_NE(nullptr, model);
+	ASSERT_NE(nullptr, recookedModel);
+	ExpectSameModel(model.get(), recookedModel.get());
+	EXPECT_TRUE(reader.Open(cachePath, pmxPath));
+	reader.Close();
+
+	// 壊れたキャッシュは読み込まない
+	{
+		std::vector<char> data;
+		saba::File file;
+		ASSERT_TRUE(file.Open(cachePath));
+		ASSERT_TRUE(file.ReadAll(&data));
+		file.Close();
+		data.resize(data.size() / 2);
+		ASSERT_TRUE(file.Create(cachePath));
+		ASSERT_TRUE(file.Write(data.data(), data.size()));
+	}
+	EXPECT_FALSE(reader.Open(cachePath, pmxPath));
+	auto sourceModel = LoadModel(pmxPath, false);
+	auto fallbackModel = LoadModel(pmxPath, true);
+	ASSERT_NE(nullptr, sourceModel);
+	ASSERT_NE(nullptr, fallbackModel);
+	ExpectSameModel(sourceModel.get(), fallbackModel.get());
+
+	std::remove(pmxPath.c_str());
+	std::remove(cachePath.c_str());
+}
+
+TEST(ModelTest, PMXCacheOutOfRange)
+{
+	const std::string pmxPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_cache_range.pmx");
+	const std::string cachePath = saba::GetPMXCachePath(pmxPath);
+	ASSERT_TRUE(WriteGeneratedPMX(pmxPath, 0));
+	auto sourceModel = LoadModel(pmxPath, false);
+	ASSERT_NE(nullptr, sourceModel);
+
+	// 範囲外を参照するキャッシュは読み込まずに PMX から読み直す
+	const int32_t badIndex = 0x7fffffff;
+	const uint32_t badVertexIndex = 0xffffffff;
+	const size_t vertexCount = sourceModel->GetVertexCount();
+	const size_t indexSize = sourceModel->GetIndexElementSize();
+	const size_t indexCount = sourceModel->GetIndexCount();
+	ASSERT_LE(vertexCount, size_t(1) << (indexSize * 8 - 1));
+	struct Corruption
+	{
+		size_t		m_elementSize;
+		size_t		m_count;
+		size_t		m_offset;
+		const void*	m_value;
+		size_t		m_valueSize;
+	};
+	const Corruption corruptions[] =
+	{
+		// 頂点のボーン番号
+		{ sizeof(saba::PMXModel::VertexBoneInfo), vertexCount, offsetof(saba::PMXModel::VertexBoneInfo, m_boneIndex), &badIndex, sizeof(badIndex) },
+		// インデックスバッファの頂点番号
+		{ 1, indexSize * indexCount, indexSize, &badVertexIndex, indexSize },
+		// 材質モーフの材質番号
+		{ sizeof(saba::PMXMorph::MaterialMorph), 0, offsetof(saba::PMXMorph::MaterialMorph, m_materialIndex), &badIndex, sizeof(badIndex) },
+	};
+	for (const auto& corruption : corruptions)
+	{
+		std::remove(cachePath.c_str());
+		ASSERT_NE(nullptr, LoadModel(pmxPath, true));
+		ASSERT_TRUE(CorruptCacheSection(cachePath, corruption.m_elementSize, corruption.m_count, corruption.m_offset, corruption.m_value, corruption.m_valueSize));
+
+		// ExpectSameModel はモーフを適用するので、読み込み直したモデルと比べる
+		auto expectedModel = LoadModel(pmxPath, false);
+		auto fallbackModel = LoadModel(pmxPath, true);
+		ASSERT_NE(nullptr, expectedModel);
+		ASSERT_NE(nullptr, fallbackModel);
+		ExpectSameModel(expectedModel.get(), fallbackModel.get());
+	}
+
+	std::remove(pmxPath.c_str());
+	std::remove(cachePath.c_str());
+}
+
+TEST(ModelTest, PMXCacheShare)
+{
+	const std::string pmxPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_cache_share.pmx");
+	const std::string cachePath = saba::GetPMXCachePath(pmxPath);
+	std::remove(cachePath.c_str());
+	ASSERT_TRUE(WriteGeneratedPMX(pmxPath, 0));
+
+	// キャッシュを作った時は自分で持つ
+	auto cookedModel = LoadModel(pmxPath, true, true);
+	ASSERT_NE(nullptr, cookedModel);
+	EXPECT_FALSE(cookedModel->IsSharingCache());
+
+	auto sharedModel = LoadModel(pmxPath, true, true);
+	ASSERT_NE(nullptr, sharedModel);
+	EXPECT_TRUE(sharedModel->IsSharingCache());
+	auto model = LoadModel(pmxPath, false);
+	ASSERT_NE(nullptr, model);
+	EXPECT_FALSE(model->IsSharingCache());
+
+	// 参照中にキャッシュが作り直されても、読み込んだデータは変わらない
+	ASSERT_TRUE(WriteGeneratedPMX(pmxPath, 1));
+	ASSERT_NE(nullptr, LoadModel(pmxPath, true, true));
+	ExpectSameModel(model.get(), sharedModel.get());
+
+	sharedModel->Destroy();
+	EXPECT_FALSE(sharedModel->IsSharingCache());
+	EXPECT_EQ(0u, sharedModel->GetVertexCount());
+
+	std::remove(pmxPath.c_str());
+	std::remove(cachePath.c_str());
+}
@@ -0,0 +1,292 @@
+﻿#define GLM_ENABLE_EXPERIMENTAL
+#include <gtest/gtest.h>
+
+#include <Saba/Base/Path.h>
+#include <Saba/Model/MMD/MMDGenerator.h>
+#include <Saba/Model/MMD/PMXFile.h>
+#include <Saba/Model/MMD/PMXModel.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtx/dual_quaternion.hpp>
+
+namespace
+{
+	// バックエンドの頂点バッファを想定した、インターリーブされた頂点 (後ろに余分な要素を持つ)
+	struct InterleavedVertex
+	{
+		glm::vec3	m_position;
+		glm::vec2	m_uv;
+		glm::vec3	m_normal;
+		float		m_extra;
+	};
+
+	saba::MMDVertexSink MakeSink(std::vector<InterleavedVertex>* vertices)
+	{
+		saba::MMDVertexSink sink;
+		sink.m_positions = { vertices->data(), offsetof(InterleavedVertex, m_position), sizeof(InterleavedVertex) };
+		sink.m_normals = { vertices->data(), offsetof(InterleavedVertex, m_normal), sizeof(InterleavedVertex) };
+		sink.m_uvs = { vertices->data(), offsetof(InterleavedVertex, m_uv), sizeof(InterleavedVertex) };
+		return sink;
+	}
+
+	void PoseModel(saba::PMXModel* model, float t)
+	{
+		auto nodes = model->GetNodeManager();
+		for (size_t i = 0; i < nodes->GetNodeCount(); i++)
+		{
+			auto node = nodes->GetMMDNode(i);
+			node->SetAnimationRotate(glm::angleAxis(t * float(i % 5) * 0.1f, glm::normalize(glm::vec3(1, float(i % 3), 0.5f))));
+			node->SetAnimationTranslate(glm::vec3(0, t * float(i % 2) * 0.1f, 0));
+		}
+		auto morphs = model->GetMorphManager();
+		for (size_t i = 0; i < morphs->GetMorphCount(); i++)
+		{
+			morphs->GetMorph(i)->SetWeight(t);
+		}
+		model->UpdateMorphAnimation();
+		model->UpdateNodeAnimation(false);
+		model->UpdateNodeAnimation(true);
+	}
+
+	bool SameVec3(const glm::vec3& a, const glm::vec3& b)
+	{
+		return memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+	}
+
+	bool SameVec2(const glm::vec2& a, const glm::vec2& b)
+	{
+		return memcmp(&a, &b, sizeof(glm::vec2)) == 0;
+	}
+
+	// mmd_skinning.glsl と同じ計算
+	void SkinVertex(
+		const saba::MMDSkinningVertex&	vtx,
+		const saba::MMDSkinningData&	data,
+		const glm::vec3&				position,
+		const glm::vec3&				normal,
+		glm::vec3*						outPosition,
+		glm::vec3*						outNormal
+	)
+	{
+		const glm::mat4* m = data.m_transforms;
+		switch (vtx.m_type)
+		{
+		case saba::MMDSkinningVertex::Type::SDEF:
+		{
+			const auto i0 = vtx.m_boneIndex[0];
+			const auto i1 = vtx.m_boneIndex[1];
+			const auto w0 = vtx.m_boneWeight[0];
+			const auto w1 = vtx.m_boneWeight[1];
+			const auto q = glm::slerp(glm::quat_cast(m[i0]), glm::quat_cast(m[i1]), w1);
+			const auto rot = glm::mat3_cast(q);
+			*outPosition = rot * (position - vtx.m_sdefC) +
+				glm::vec3(m[i0] * glm::vec4(vtx.m_sdefR0, 1)) * w0 +
+				glm::vec3(m[i1] * glm::vec4(vtx.m_sdefR1, 1)) * w1;
+			*outNormal = rot * normal;
+			return;
+		}
+		case saba::MMDSkinningVertex::Type::DualQuaternion:
+		{
+			glm::dualquat dq[4];
+			float w[4];
+			for (int bi = 0; bi < 4; bi++)
+			{
+				dq[bi] = glm::normalize(glm::dualquat_cast(glm::mat3x4(glm::transpose(m[vtx.m_boneIndex[bi]]))));
+				w[bi] = vtx.m_boneWeight[bi];
+				if (glm::dot(dq[0].real, dq[bi].real) < 0)
+				{
+					w[bi] = -w[bi];
+				}
+			}
+			auto blend = glm::normalize(w[0] * dq[0] + w[1] * dq[1] + w[2] * dq[2] + w[3] * dq[3]);
+			glm::mat4 bm = glm::transpose(glm::mat3x4_cast(blend));
+			*outPosition = glm::vec3(bm * glm::vec4(position, 1));
+			*outNormal = glm::normalize(glm::mat3(bm) * normal);
+			return;
+		}
+		default:
+		{
+			glm::mat4 bm(0);
+			for (int bi = 0; bi < 4; bi++)
+			{
+				bm += m[vtx.m_boneIndex[bi]] * vtx.m_boneWeight[bi];
+			}
+			*outPosition = glm::vec3(bm * glm::vec4(position, 1));
+			*outNormal = glm::normalize(glm::mat3(bm) * normal);
+			return;
+		}
+		}
+	}
+}
+
+TEST(ModelTest, PMXModelUpdateSink)
+{
+	saba::PMXGenerateParam param;
+	param.m_vertexCount = 6000;
+	param.m_boneCount = 32;
+	param.m_materialCount = 2;
+	// BDEF1, BDEF2, BDEF4, SDEF, QDEF をすべて含める
+	param.m_weightRatio[0] = 0.2f;
+	param.m_weightRatio[1] = 0.2f;
+	param.m_weightRatio[2] = 0.2f;
+	param.m_weightRatio[3] = 0.2f;
+	param.m_weightRatio[4] = 0.2f;
+	param.m_positionMorphCount = 2;
+	param.m_uvMorphCount = 1;
+	param.m_morphVertexCount = 100;
+	param.m_rigidbodyCount = 0;
+
+	saba::PMXFile pmx;
+	ASSERT_TRUE(saba::GeneratePMXFile(&pmx, param));
+	auto pmxPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_update_sink.pmx");
+	ASSERT_TRUE(saba::WritePMXFile(&pmx, pmxPath.c_str()));
+
+	saba::PMXModel model;
+	model.SetLODHint(2);
+	ASSERT_TRUE(model.Load(pmxPath, saba::PathUtil::GetCWD()));
+	model.SetParallelUpdateHint(4);
+	model.InitializeAnimation();
+
+	const size_t vertexCount = model.GetVertexCount();
+	PoseModel(&model, 1.0f);
+	model.Update();
+	const std::vector<glm::vec3> positions(model.GetUpdatePositions(), model.GetUpdatePositions() + vertexCount);
+	const std::vector<glm::vec3> normals(model.GetUpdateNormals(), model.GetUpdateNormals() + vertexCount);
+	const std::vector<glm::vec2> uvs(model.GetUpdateUVs(), model.GetUpdateUVs() + vertexCount);
+
+	// Update() と同じ結果を、指定したレイアウトで書き込む
+	const InterleavedVertex sentinel = { glm::vec3(-1), glm::vec2(-1), glm::vec3(-1), 123.0f };
+	std::vector<InterleavedVertex> vertices(vertexCount, sentinel);
+	model.Update(MakeSink(&vertices));
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		ASSERT_TRUE(SameVec3(positions[i], vertices[i].m_position)) << i;
+		ASSERT_TRUE(SameVec3(normals[i], vertices[i].m_normal)) << i;
+		ASSERT_TRUE(SameVec2(uvs[i], vertices[i].m_uv)) << i;
+		ASSERT_EQ(123.0f, vertices[i].m_extra) << i;
+	}
+
+	// 内部のバッファは更新しない
+	PoseModel(&model, 0.5f);
+	model.Update(MakeSink(&vertices));
+	EXPECT_EQ(0, memcmp(positions.data(), model.GetUpdatePositions(), sizeof(glm::vec3) * vertexCount));
+
+	// nullptr の要素は書き込まない. stride 0 は詰めて並べる
+	std::vector<glm::vec3> packedPositions(vertexCount, glm::vec3(-1));
+	saba::MMDVertexSink positionSink;
+	positionSink.m_positions.m_data = packedPositions.data();
+	model.Update(positionSink);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		ASSERT_TRUE(SameVec3(vertices[i].m_position, packedPositions[i])) << i;
+	}
+
+	// LOD は参照する頂点だけを書き込む
+	ASSERT_EQ(2u, model.GetLODCount());
+	model.SetLOD(1, true);
+	model.Update();
+	std::vector<InterleavedVertex> lodVertices(vertexCount, sentinel);
+	model.Update(MakeSink(&lodVertices));
+	std::vector<char> lodUsed(vertexCount, 0);
+	for (auto vi : model.GetMeshLOD(1)->m_vertices)
+	{
+		lodUsed[vi] = 1;
+	}
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		if (lodUsed[i] != 0)
+		{
+			ASSERT_TRUE(SameVec3(model.GetUpdatePositions()[i], lodVertices[i].m_position)) << i;
+			ASSERT_TRUE(SameVec3(model.GetUpdateNormals()[i], lodVertices[i].m_normal)) << i;
+		}
+		else
+		{
+			ASSERT_TRUE(SameVec3(sentinel.m_position, lodVertices[i].m_position)) << i;
+		}
+	}
+
+	std::remove(pmxPath.c_str());
+}
+
+TEST(ModelTest, PMXModelSkinningData)
+{
+	saba::PMXGenerateParam param;
+	param.m_vertexCount = 3000;
+	param.m_boneCount = 32;
+	param.m_materialCount = 1;
+	param.m_weightRatio[0] = 0.2f;
+	param.m_weightRatio[1] = 0.2f;
+	param.m_weightRatio[2] = 0.2f;
+	param.m_weightRatio[3] = 0.2f;
+	param.m_weightRatio[4] = 0.2f;
+	param.m_positionMorphCount = 2;
+	param.m_uvMorphCount = 1;
+	param.m_morphVertexCount = 100;
+	param.m_rigidbodyCount = 0;
+
+	saba::PMXFile pmx;
+	ASSERT_TRUE(saba::GeneratePMXFile(&pmx, param));
+	auto pmxPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_skinning.pmx");
+	ASSERT_TRUE(saba::WritePMXFile(&pmx, pmxPath.c_str()));
+
+	saba::PMXModel model;
+	ASSERT_TRUE(model.Load(pmxPath, saba::PathUtil::GetCWD()));
+	model.InitializeAnimation();
+
+	const size_t vertexCount = model.GetVertexCount();
+	std::vector<saba::MMDSkinningVertex> skinningVertices(vertexCount);
+	model.GetSkinningVertices(skinningVertices.data());
+
+	model.BeginAnimation();
+	PoseModel(&model, 1.0f);
+	model.EndAnimation();
+	model.Update();
+
+	// ボーンの変形行列とモーフの移動量から、Update() と同じ頂点を求められる
+	saba::MMDSkinningData data;
+	model.UpdateSkinning(&data);
+	ASSERT_EQ(model.GetNodeManager()->GetNodeCount(), data.m_transformCount);
+	ASSERT_NE(nullptr, data.m_morphUVs);
+	ASSERT_LT(data.m_morphBegin, data.m_morphEnd);
+	ASSERT_LE(data.m_morphEnd, vertexCount);
+	size_t typeCounts[3] = { 0 };
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		if (i < data.m_morphBegin || i >= data.m_morphEnd)
+		{
+			ASSERT_EQ(glm::vec3(0), data.m_morphPositions[i]) << i;
+			ASSERT_EQ(glm::vec4(0), data.m_morphUVs[i]) << i;
+		}
+		const auto& vtx = skinningVertices[i];
+		typeCounts[int(vtx.m_type)]++;
+		glm::vec3 position;
+		glm::vec3 normal;
+		SkinVertex(vtx, data, model.GetPositions()[i] + data.m_morphPositions[i], model.GetNormals()[i], &position, &normal);
+		ASSERT_NEAR(0.0f, glm::length(position - model.GetUpdatePositions()[i]), 1.0e-4f) << i;
+		ASSERT_NEAR(0.0f, glm::length(normal - model.GetUpdateNormals()[i]), 1.0e-4f) << i;
+		glm::vec2 uv = model.GetUVs()[i] + glm::vec2(data.m_morphUVs[i]);
+		ASSERT_EQ(uv, model.GetUpdateUVs()[i]) << i;
+	}
+	EXPECT_NE(0u, typeCounts[int(saba::MMDSkinningVertex::Type::Linear)]);
+	EXPECT_NE(0u, typeCounts[int(saba::MMDSkinningVertex::Type::SDEF)]);
+	EXPECT_NE(0u, typeCounts[int(saba::MMDSkinningVertex::Type::DualQuaternion)]);
+
+	// モーフを使わない場合は、前回の移動量を 0 に戻して範囲を空にする
+	model.BeginAnimation();
+	PoseModel(&model, 0.0f);
+	model.EndAnimation();
+	model.UpdateSkinning(&data);
+	EXPECT_EQ(data.m_morphBegin, data.m_morphEnd);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		ASSERT_EQ(glm::vec3(0), data.m_morphPositions[i]) << i;
+		ASSERT_EQ(glm::vec4(0), data.m_morphUVs[i]) << i;
+	}
+
+	std::remove(pmxPath.c_str());
+}
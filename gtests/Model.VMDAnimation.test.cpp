@@ -0,0 +1,325 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/Path.h>
+#include <Saba/Base/ThreadPool.h>
+#include <Saba/Model/MMD/MMDGenerator.h>
+#include <Saba/Model/MMD/PMXModel.h>
+#include <Saba/Model/MMD/VMDAnimation.h>
+#include <Saba/Model/MMD/VMDAnimationCommon.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	saba::VMDNodeAnimationKey MakeKey(int32_t time)
+	{
+		saba::VMDMotion motion;
+		motion.m_frame = uint32_t(time);
+		motion.m_translate = glm::vec3(float(time), 0, 0);
+		motion.m_quaternion = glm::quat(1, 0, 0, 0);
+		for (size_t i = 0; i < motion.m_interpolation.size(); i++)
+		{
+			motion.m_interpolation[i] = uint8_t(i);
+		}
+		saba::VMDNodeAnimationKey key;
+		key.Set(motion);
+		return key;
+	}
+}
+
+TEST(ModelTest, VMDNodeKeyStore)
+{
+	saba::VMDNodeKeyStore keys;
+	EXPECT_TRUE(keys.IsEmpty());
+
+	const int32_t times[] = { 30, 0, 10, 20 };
+	for (auto time : times)
+	{
+		keys.Add(MakeKey(time));
+	}
+	keys.Sort();
+	keys.ShrinkToFit();
+	ASSERT_EQ(4, keys.GetKeyCount());
+
+	// 時間順に並び、値も一緒に並び替えられることを確認
+	for (size_t i = 0; i < keys.GetKeyCount(); i++)
+	{
+		EXPECT_EQ(int32_t(i * 10), keys.GetTimes()[i]);
+		EXPECT_EQ(float(i * 10), keys.GetTranslate(i).x);
+		EXPECT_EQ(int32_t(i * 10), keys.GetKey(i).m_time);
+	}
+
+	// 補間パラメータは x1, y1, x2, y2 の順で保持する
+	const auto& ip = keys.GetInterpolation(0);
+	const uint8_t rotCp[] = { 3, 7, 11, 15 };
+	for (int i = 0; i < 4; i++)
+	{
+		EXPECT_EQ(rotCp[i], ip.m_cp[saba::VMDNodeInterpolation::Rotate * 4 + i]);
+	}
+	auto bezier = ip.GetBezier(saba::VMDNodeInterpolation::TranslateY);
+	EXPECT_EQ(1.0f / 127.0f, bezier.m_cp1.x);
+	EXPECT_EQ(5.0f / 127.0f, bezier.m_cp1.y);
+	EXPECT_EQ(9.0f / 127.0f, bezier.m_cp2.x);
+	EXPECT_EQ(13.0f / 127.0f, bezier.m_cp2.y);
+
+	EXPECT_EQ(size_t(4 * 48), keys.GetMemorySize());
+}
+
+TEST(ModelTest, FindBoundKeyIndex)
+{
+	const std::vector<int32_t> times = { 0, 10, 20, 30 };
+
+	// 開始位置に関係なく同じ結果になることを確認
+	for (size_t startIdx = 0; startIdx < times.size(); startIdx++)
+	{
+		EXPECT_EQ(0, saba::FindBoundKeyIndex(times, -1, startIdx));
+		EXPECT_EQ(1, saba::FindBoundKeyIndex(times, 0, startIdx));
+		EXPECT_EQ(2, saba::FindBoundKeyIndex(times, 15, startIdx));
+		EXPECT_EQ(3, saba::FindBoundKeyIndex(times, 29, startIdx));
+		EXPECT_EQ(4, saba::FindBoundKeyIndex(times, 30, startIdx));
+		EXPECT_EQ(4, saba::FindBoundKeyIndex(times, 100, startIdx));
+	}
+	EXPECT_EQ(0, saba::FindBoundKeyIndex(std::vector<int32_t>(), 0, 0));
+}
+
+TEST(ModelTest, VMDControllerSample)
+{
+	saba::VMDNodeController nodeCtrl;
+	nodeCtrl.AddKey(MakeKey(10));
+	nodeCtrl.AddKey(MakeKey(0));
+	nodeCtrl.SortKeys();
+
+	// ノードが無くても評価できることを確認
+	size_t keyHint = 0;
+	glm::vec3 vt;
+	glm::quat q;
+	nodeCtrl.Sample(0.0f, &vt, &q, &keyHint);
+	EXPECT_NEAR(0.0f, vt.x, 0.01f);
+	nodeCtrl.Sample(20.0f, &vt, &q, &keyHint);
+	EXPECT_EQ(10.0f, vt.x);
+	nodeCtrl.Sample(5.0f, &vt, &q, &keyHint);
+	EXPECT_LT(0.0f, vt.x);
+	EXPECT_GT(10.0f, vt.x);
+	EXPECT_EQ(1, keyHint);
+
+	saba::VMDMorphController morphCtrl;
+	morphCtrl.AddKey(saba::VMDMorphAnimationKey{ 0, 0.0f });
+	morphCtrl.AddKey(saba::VMDMorphAnimationKey{ 10, 1.0f });
+	morphCtrl.SortKeys();
+	keyHint = 0;
+	EXPECT_FLOAT_EQ(0.5f, morphCtrl.Sample(5.0f, &keyHint));
+	EXPECT_FLOAT_EQ(1.0f, morphCtrl.Sample(30.0f, &keyHint));
+
+	saba::VMDIKController ikCtrl;
+	ikCtrl.AddKey(saba::VMDIKAnimationKey{ 0, true });
+	ikCtrl.AddKey(saba::VMDIKAnimationKey{ 10, false });
+	ikCtrl.SortKeys();
+	keyHint = 0;
+	EXPECT_TRUE(ikCtrl.Sample(5.0f, &keyHint));
+	EXPECT_FALSE(ikCtrl.Sample(10.0f, &keyHint));
+}
+
+TEST(ModelTest, MMDFileStringMap)
+{
+	saba::MMDFileStringHash<15> hash;
+	saba::MMDFileString<15> a;
+	saba::MMDFileString<15> b;
+	// FNV-1a のハッシュ値が同じになる名前
+	a.Set("b997969");
+	b.Set("b1003506");
+	ASSERT_EQ(hash(a), hash(b));
+
+	// 終端文字より後ろのバイトは比較しない
+	saba::MMDFileString<15> c;
+	c.Set("b997969");
+	c.m_buffer[10] = 'x';
+	EXPECT_EQ(hash(a), hash(c));
+
+	saba::MMDFileStringMap<15, int> map;
+	map.emplace(a, 1);
+	map.emplace(b, 2);
+	map.emplace(c, 3);
+	ASSERT_EQ(2, map.size());
+	EXPECT_EQ(1, map.find(c)->second);
+	EXPECT_EQ(2, map.find(b)->second);
+}
+
+TEST(ModelTest, VMDAnimationAddInternedNames)
+{
+	// ハッシュ値が同じ名前、前方が同じ名前、バッファを使い切る名前
+	const std::vector<std::string> names = {
+		"b997969",
+		"b1003506",
+		"arm",
+		"arm2",
+		"0123456789abcd",
+		"0123456789abce",
+		"0123456789abcde",
+	};
+
+	saba::PMXGenerateParam param;
+	param.m_vertexCount = 100;
+	param.m_boneCount = 16;
+	param.m_positionMorphCount = uint32_t(names.size());
+	param.m_morphVertexCount = 10;
+	param.m_ikChainCount = 0;
+	param.m_rigidbodyCount = 0;
+	saba::PMXFile pmx;
+	ASSERT_TRUE(saba::GeneratePMXFile(&pmx, param));
+	ASSERT_LT(names.size(), pmx.m_bones.size());
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		pmx.m_bones[i + 1].m_name = names[i];
+		pmx.m_morphs[i].m_name = names[i];
+	}
+	auto pmxPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_names.pmx");
+	ASSERT_TRUE(saba::WritePMXFile(&pmx, pmxPath.c_str()));
+
+	auto model = std::make_shared<saba::PMXModel>();
+	ASSERT_TRUE(model->Load(pmxPath, saba::PathUtil::GetCWD()));
+
+	// 名前ごとに 2 つずつキーを打つ (2 つ目は終端文字より後ろにごみがある)
+	saba::VMDFile vmd;
+	for (int k = 0; k < 2; k++)
+	{
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			saba::VMDMotion motion;
+			motion.m_boneName.Set(names[i].c_str());
+			if (k == 1 && names[i].size() < 14)
+			{
+				motion.m_boneName.m_buffer[14] = 'x';
+			}
+			motion.m_frame = uint32_t(k * 10);
+			motion.m_translate = glm::vec3(float(i), 0, 0);
+			motion.m_quaternion = glm::quat(1, 0, 0, 0);
+			motion.m_interpolation.fill(20);
+			vmd.m_motions.push_back(motion);
+
+			saba::VMDMorph morph;
+			morph.m_blendShapeName = motion.m_boneName;
+			morph.m_frame = motion.m_frame;
+			morph.m_weight = float(i);
+			vmd.m_morphs.push_back(morph);
+		}
+	}
+
+	saba::VMDAnimation anim;
+	ASSERT_TRUE(anim.Create(model));
+	ASSERT_TRUE(anim.Add(vmd));
+
+	// 名前ごとに別のコントローラーになり、キーは名前が一致するものだけを持つ
+	ASSERT_EQ(names.size(), anim.GetNodeControllerCount());
+	ASSERT_EQ(names.size(), anim.GetMorphControllerCount());
+	for (size_t i = 0; i < anim.GetNodeControllerCount(); i++)
+	{
+		const auto* ctrl = anim.GetNodeController(i);
+		ASSERT_NE(nullptr, ctrl->GetNode());
+		const auto& keys = ctrl->GetKeys();
+		ASSERT_EQ(2, keys.GetKeyCount()) << ctrl->GetNode()->GetName();
+		const auto& name = names[size_t(keys.GetTranslate(0).x)];
+		EXPECT_EQ(name, ctrl->GetNode()->GetName());
+		EXPECT_EQ(keys.GetTranslate(0), keys.GetTranslate(1)) << name;
+	}
+	for (size_t i = 0; i < anim.GetMorphControllerCount(); i++)
+	{
+		const auto* ctrl = anim.GetMorphController(i);
+		ASSERT_NE(nullptr, ctrl->GetMorph());
+		const auto& keys = ctrl->GetKeys();
+		ASSERT_EQ(2, keys.size()) << ctrl->GetMorph()->GetName();
+		const auto& name = names[size_t(keys[0].m_weight)];
+		EXPECT_EQ(name, ctrl->GetMorph()->GetName());
+		EXPECT_EQ(keys[0].m_weight, keys[1].m_weight) << name;
+	}
+
+	std::remove(pmxPath.c_str());
+}
+
+TEST(ModelTest, VMDAnimationParallelEvaluate)
+{
+	saba::PMXGenerateParam param;
+	param.m_vertexCount = 100;
+	param.m_boneCount = 16;
+	param.m_positionMorphCount = 4;
+	param.m_morphVertexCount = 10;
+	param.m_rigidbodyCount = 0;
+	saba::PMXFile pmx;
+	ASSERT_TRUE(saba::GeneratePMXFile(&pmx, param));
+	auto pmxPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_parallel.pmx");
+	ASSERT_TRUE(saba::WritePMXFile(&pmx, pmxPath.c_str()));
+	saba::VMDGenerateParam vmdParam;
+	vmdParam.m_frameCount = 120;
+	vmdParam.m_ikKeyInterval = 30;
+	saba::VMDFile vmd;
+	ASSERT_TRUE(saba::GenerateVMDFile(&vmd, pmx, vmdParam));
+
+	auto model = std::make_shared<saba::PMXModel>();
+	ASSERT_TRUE(model->Load(pmxPath, saba::PathUtil::GetCWD()));
+	saba::VMDAnimation anim;
+	ASSERT_TRUE(anim.Create(model));
+	ASSERT_TRUE(anim.Add(vmd));
+	const size_t ctrlCount = anim.GetNodeControllerCount() + anim.GetIKControllerCount() + anim.GetMorphControllerCount();
+	ASSERT_LT(ctrlCount, size_t(saba::VMDAnimation::DefaultParallelEvaluateThreshold));
+
+	// 実際に並列に評価した場合だけ true になる
+	anim.Evaluate(10.0f);
+	EXPECT_FALSE(anim.WasLastEvaluateParallel());
+
+	saba::ThreadPool pool(2);
+	anim.SetParallelEvaluate(&pool);
+	anim.Evaluate(10.0f);
+	EXPECT_FALSE(anim.WasLastEvaluateParallel());
+
+	anim.SetParallelEvaluate(&pool, ctrlCount);
+	anim.Evaluate(10.0f);
+	EXPECT_TRUE(anim.WasLastEvaluateParallel());
+
+	saba::ThreadPool singlePool(1);
+	anim.SetParallelEvaluate(&singlePool, 0);
+	anim.Evaluate(10.0f);
+	EXPECT_FALSE(anim.WasLastEvaluateParallel());
+
+	// 並列に評価した結果が直列に評価した結果と一致する
+	auto serialModel = std::make_shared<saba::PMXModel>();
+	ASSERT_TRUE(serialModel->Load(pmxPath, saba::PathUtil::GetCWD()));
+	saba::VMDAnimation serialAnim;
+	ASSERT_TRUE(serialAnim.Create(serialModel));
+	ASSERT_TRUE(serialAnim.Add(vmd));
+
+	anim.SetParallelEvaluate(&pool, ctrlCount);
+	auto nodeMan = model->GetNodeManager();
+	auto serialNodeMan = serialModel->GetNodeManager();
+	auto morphMan = model->GetMorphManager();
+	auto serialMorphMan = serialModel->GetMorphManager();
+	ASSERT_EQ(serialNodeMan->GetNodeCount(), nodeMan->GetNodeCount());
+	ASSERT_EQ(serialMorphMan->GetMorphCount(), morphMan->GetMorphCount());
+	for (float frame = 0.0f; frame <= float(vmdParam.m_frameCount); frame += 2.5f)
+	{
+		model->BeginAnimation();
+		model->UpdateAllAnimation(&anim, frame, 0);
+		model->EndAnimation();
+		EXPECT_TRUE(anim.WasLastEvaluateParallel());
+
+		serialModel->BeginAnimation();
+		serialModel->UpdateAllAnimation(&serialAnim, frame, 0);
+		serialModel->EndAnimation();
+		EXPECT_FALSE(serialAnim.WasLastEvaluateParallel());
+
+		for (size_t i = 0; i < nodeMan->GetNodeCount(); i++)
+		{
+			const auto* node = nodeMan->GetMMDNode(i);
+			const auto* serialNode = serialNodeMan->GetMMDNode(i);
+			EXPECT_EQ(serialNode->GetLocalTransform(), node->GetLocalTransform()) << frame << " " << node->GetName();
+			EXPECT_EQ(serialNode->GetGlobalTransform(), node->GetGlobalTransform()) << frame << " " << node->GetName();
+		}
+		for (size_t i = 0; i < morphMan->GetMorphCount(); i++)
+		{
+			EXPECT_EQ(serialMorphMan->GetMorph(i)->GetWeight(), morphMan->GetMorph(i)->GetWeight()) << frame << " " << morphMan->GetMorph(i)->GetName();
+		}
+	}
+
+	std::remove(pmxPath.c_str());
+}
@@ -0,0 +1,329 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/Path.h>
+#include <Saba/Model/MMD/MMDGenerator.h>
+#include <Saba/Model/MMD/PMXModel.h>
+#include <Saba/Model/MMD/VMDAnimationBlender.h>
+
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <glm/gtc/quaternion.hpp>
+
+namespace
+{
+	/*
+		ボーン : bone_1 の子は bone_3, bone_4. bone_2 は bone_1 の兄弟
+		モーフ : vmorph_0, vmorph_1
+	*/
+	std::shared_ptr<saba::PMXModel> LoadBlenderModel()
+	{
+		saba::PMXGenerateParam param;
+		param.m_vertexCount = 100;
+		param.m_boneCount = 8;
+		param.m_positionMorphCount = 2;
+		param.m_morphVertexCount = 10;
+		param.m_ikChainCount = 0;
+		param.m_rigidbodyCount = 0;
+		saba::PMXFile pmx;
+		auto pmxPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_blender.pmx");
+		if (!saba::GeneratePMXFile(&pmx, param) || !saba::WritePMXFile(&pmx, pmxPath.c_str()))
+		{
+			return nullptr;
+		}
+
+		// 読み込んだ後はファイルを使わないので消しておく
+		auto model = std::make_shared<saba::PMXModel>();
+		bool loaded = model->Load(pmxPath, saba::PathUtil::GetCWD());
+		std::remove(pmxPath.c_str());
+		if (!loaded)
+		{
+			return nullptr;
+		}
+		model->InitializeAnimation();
+		return model;
+	}
+
+	struct NodeKey
+	{
+		glm::vec3	m_translate;
+		glm::quat	m_rotate;
+	};
+
+	// 値が変化しない (キーが 1 つだけの) クリップ
+	std::shared_ptr<saba::VMDAnimation> MakeClip(
+		std::shared_ptr<saba::MMDModel>			model,
+		const std::map<std::string, NodeKey>&	nodeKeys,
+		const std::map<std::string, float>&		morphKeys
+	)
+	{
+		saba::VMDFile vmd;
+		for (const auto& nodeKey : nodeKeys)
+		{
+			saba::VMDMotion motion;
+			motion.m_boneName.Set(nodeKey.first.c_str());
+			motion.m_frame = 0;
+			motion.m_translate = nodeKey.second.m_translate;
+			motion.m_quaternion = nodeKey.second.m_rotate;
+			motion.m_interpolation.fill(20);
+			vmd.m_motions.push_back(motion);
+		}
+		for (const auto& morphKey : morphKeys)
+		{
+			saba::VMDMorph morph;
+			morph.m_blendShapeName.Set(morphKey.first.c_str());
+			morph.m_frame = 0;
+			morph.m_weight = morphKey.second;
+			vmd.m_morphs.push_back(morph);
+		}
+
+		auto anim = std::make_shared<saba::VMDAnimation>();
+		if (!anim->Create(model) || !anim->Add(vmd))
+		{
+			return nullptr;
+		}
+		return anim;
+	}
+
+	glm::quat RotateX(float angle)
+	{
+		return glm::angleAxis(angle, glm::vec3(1, 0, 0));
+	}
+
+	void ExpectTranslate(const glm::vec3& expected, const saba::MMDNode* node)
+	{
+		const auto& t = node->GetAnimationTranslate();
+		EXPECT_NEAR(expected.x, t.x, 1.0e-5f) << node->GetName();
+		EXPECT_NEAR(expected.y, t.y, 1.0e-5f) << node->GetName();
+		EXPECT_NEAR(expected.z, t.z, 1.0e-5f) << node->GetName();
+	}
+
+	// angle は VMD 上の X 軸回りの角度 (読み込み時に Z を反転するので、モデル上は -angle になる)
+	void ExpectRotateX(float angle, const saba::MMDNode* node)
+	{
+		// q と -q は同じ回転
+		auto expected = RotateX(-angle);
+		EXPECT_NEAR(1.0f, std::abs(glm::dot(expected, node->GetAnimationRotate())), 1.0e-5f) << node->GetName();
+	}
+}
+
+TEST(ModelTest, VMDAnimationBlenderCrossFade)
+{
+	auto model = LoadBlenderModel();
+	ASSERT_NE(nullptr, model);
+	auto node = model->GetNodeManager()->GetMMDNode("bone_1");
+	auto morph = model->GetMorphManager()->GetMorph("vmorph_0");
+	ASSERT_NE(nullptr, node);
+	ASSERT_NE(nullptr, morph);
+
+	auto clipA = MakeClip(model, { { "bone_1", { glm::vec3(1, 0, 0), RotateX(0.2f) } } }, { { "vmorph_0", 0.2f } });
+	auto clipB = MakeClip(model, { { "bone_1", { glm::vec3(3, 0, 0), RotateX(1.0f) } } }, { { "vmorph_0", 1.0f } });
+	ASSERT_NE(nullptr, clipA);
+	ASSERT_NE(nullptr, clipB);
+
+	saba::VMDAnimationBlender blender;
+	ASSERT_TRUE(blender.Create(model));
+	size_t layer = blender.AddLayer();
+	blender.Play(layer, clipA);
+	blender.Update(0.0f);
+	blender.Evaluate();
+	EXPECT_FALSE(blender.IsFading(layer));
+	ExpectTranslate(glm::vec3(1, 0, 0), node);
+	ExpectRotateX(0.2f, node);
+	EXPECT_FLOAT_EQ(0.2f, morph->GetWeight());
+
+	// fadeTime の 0, 1/2, 1 で A -> B に補間する
+	blender.Play(layer, clipB, 1.0f);
+	blender.Update(0.0f);
+	blender.Evaluate();
+	EXPECT_TRUE(blender.IsFading(layer));
+	ExpectTranslate(glm::vec3(1, 0, 0), node);
+	ExpectRotateX(0.2f, node);
+	EXPECT_FLOAT_EQ(0.2f, morph->GetWeight());
+
+	blender.Update(0.5f);
+	blender.Evaluate();
+	EXPECT_TRUE(blender.IsFading(layer));
+	ExpectTranslate(glm::vec3(2, 0, 0), node);
+	ExpectRotateX(0.6f, node);
+	EXPECT_FLOAT_EQ(0.6f, morph->GetWeight());
+
+	blender.Update(0.5f);
+	blender.Evaluate();
+	EXPECT_FALSE(blender.IsFading(layer));
+	ExpectTranslate(glm::vec3(3, 0, 0), node);
+	ExpectRotateX(1.0f, node);
+	EXPECT_FLOAT_EQ(1.0f, morph->GetWeight());
+}
+
+TEST(ModelTest, VMDAnimationBlenderFadeInOut)
+{
+	auto model = LoadBlenderModel();
+	ASSERT_NE(nullptr, model);
+	auto node = model->GetNodeManager()->GetMMDNode("bone_1");
+	auto morph = model->GetMorphManager()->GetMorph("vmorph_0");
+	auto clip = MakeClip(model, { { "bone_1", { glm::vec3(2, 0, 0), RotateX(1.0f) } } }, { { "vmorph_0", 1.0f } });
+	ASSERT_NE(nullptr, clip);
+
+	saba::VMDAnimationBlender blender;
+	ASSERT_TRUE(blender.Create(model));
+	size_t layer = blender.AddLayer();
+
+	// 何も再生していないレイヤーはレストポーズからフェードする
+	blender.Play(layer, clip, 1.0f);
+	blender.Update(0.0f);
+	blender.Evaluate();
+	EXPECT_TRUE(blender.IsFading(layer));
+	ExpectTranslate(glm::vec3(0), node);
+	ExpectRotateX(0.0f, node);
+	EXPECT_FLOAT_EQ(0.0f, morph->GetWeight());
+
+	blender.Update(0.5f);
+	blender.Evaluate();
+	ExpectTranslate(glm::vec3(1, 0, 0), node);
+	ExpectRotateX(0.5f, node);
+	EXPECT_FLOAT_EQ(0.5f, morph->GetWeight());
+
+	blender.Update(0.5f);
+	blender.Evaluate();
+	EXPECT_FALSE(blender.IsFading(layer));
+	ExpectTranslate(glm::vec3(2, 0, 0), node);
+	EXPECT_FLOAT_EQ(1.0f, morph->GetWeight());
+
+	// Stop はレストポーズへフェードし、終わった後はノードを変更しない
+	blender.Stop(layer, 1.0f);
+	blender.Update(0.5f);
+	blender.Evaluate();
+	EXPECT_TRUE(blender.IsFading(layer));
+	ExpectTranslate(glm::vec3(1, 0, 0), node);
+	ExpectRotateX(0.5f, node);
+	EXPECT_FLOAT_EQ(0.5f, morph->GetWeight());
+
+	blender.Update(0.5f);
+	EXPECT_FALSE(blender.IsFading(layer));
+	node->SetAnimationTranslate(glm::vec3(5, 0, 0));
+	blender.Evaluate();
+	ExpectTranslate(glm::vec3(5, 0, 0), node);
+
+	// fadeTime が 0 の場合はすぐに切り替わる
+	blender.Play(layer, clip);
+	blender.Update(0.0f);
+	blender.Evaluate();
+	ExpectTranslate(glm::vec3(2, 0, 0), node);
+	blender.Stop(layer);
+	EXPECT_FALSE(blender.IsFading(layer));
+	node->SetAnimationTranslate(glm::vec3(5, 0, 0));
+	blender.Evaluate();
+	ExpectTranslate(glm::vec3(5, 0, 0), node);
+}
+
+TEST(ModelTest, VMDAnimationBlenderMask)
+{
+	auto model = LoadBlenderModel();
+	ASSERT_NE(nullptr, model);
+	auto nodeMan = model->GetNodeManager();
+	auto node1 = nodeMan->GetMMDNode("bone_1");
+	auto node2 = nodeMan->GetMMDNode("bone_2");
+	auto node3 = nodeMan->GetMMDNode("bone_3");
+	ASSERT_NE(nullptr, node1);
+	ASSERT_NE(nullptr, node2);
+	ASSERT_NE(nullptr, node3);
+	ASSERT_EQ(node1, node3->GetParent());
+	ASSERT_EQ(node1->GetParent(), node2->GetParent());
+	auto morph0 = model->GetMorphManager()->GetMorph("vmorph_0");
+	auto morph1 = model->GetMorphManager()->GetMorph("vmorph_1");
+
+	const NodeKey keyA = { glm::vec3(1, 0, 0), RotateX(0.2f) };
+	const NodeKey keyB = { glm::vec3(3, 0, 0), RotateX(1.0f) };
+	auto clipA = MakeClip(model,
+		{ { "bone_1", keyA }, { "bone_2", keyA }, { "bone_3", keyA } },
+		{ { "vmorph_0", 0.2f }, { "vmorph_1", 0.2f } }
+	);
+	auto clipB = MakeClip(model,
+		{ { "bone_1", keyB }, { "bone_2", keyB }, { "bone_3", keyB } },
+		{ { "vmorph_0", 1.0f }, { "vmorph_1", 1.0f } }
+	);
+	ASSERT_NE(nullptr, clipA);
+	ASSERT_NE(nullptr, clipB);
+
+	saba::VMDAnimationBlender blender;
+	ASSERT_TRUE(blender.Create(model));
+	size_t base = blender.AddLayer();
+	size_t upper = blender.AddLayer();
+	blender.Play(base, clipA);
+	blender.Play(upper, clipB);
+
+	// 子ノードを含めない
+	blender.SetLayerNodeMask(upper, { "bone_1" }, false);
+	blender.SetLayerMorphMask(upper, { "vmorph_1" });
+	blender.Evaluate();
+	ExpectTranslate(keyB.m_translate, node1);
+	ExpectTranslate(keyA.m_translate, node2);
+	ExpectTranslate(keyA.m_translate, node3);
+	EXPECT_FLOAT_EQ(0.2f, morph0->GetWeight());
+	EXPECT_FLOAT_EQ(1.0f, morph1->GetWeight());
+
+	// 子ノードを含める
+	blender.SetLayerNodeMask(upper, { "bone_1" }, true);
+	blender.Evaluate();
+	ExpectTranslate(keyB.m_translate, node1);
+	ExpectTranslate(keyA.m_translate, node2);
+	ExpectTranslate(keyB.m_translate, node3);
+
+	// ノードごとの重み
+	blender.SetLayerNodeMaskWeight(upper, "bone_3", 0.5f);
+	blender.Evaluate();
+	ExpectTranslate(glm::vec3(2, 0, 0), node3);
+	ExpectRotateX(0.6f, node3);
+
+	blender.ClearLayerMask(upper);
+	blender.Evaluate();
+	ExpectTranslate(keyB.m_translate, node2);
+	EXPECT_FLOAT_EQ(1.0f, morph0->GetWeight());
+}
+
+TEST(ModelTest, VMDAnimationBlenderAdditive)
+{
+	auto model = LoadBlenderModel();
+	ASSERT_NE(nullptr, model);
+	auto node = model->GetNodeManager()->GetMMDNode("bone_1");
+	auto morph = model->GetMorphManager()->GetMorph("vmorph_0");
+	auto clipA = MakeClip(model, { { "bone_1", { glm::vec3(1, 0, 0), RotateX(0.2f) } } }, { { "vmorph_0", 0.2f } });
+	auto clipB = MakeClip(model, { { "bone_1", { glm::vec3(2, 0, 0), RotateX(1.0f) } } }, { { "vmorph_0", 0.6f } });
+	ASSERT_NE(nullptr, clipA);
+	ASSERT_NE(nullptr, clipB);
+
+	saba::VMDAnimationBlender blender;
+	ASSERT_TRUE(blender.Create(model));
+	size_t base = blender.AddLayer();
+	size_t upper = blender.AddLayer(saba::VMDAnimationBlender::BlendMode::Override, 0.5f);
+	blender.Play(base, clipA);
+	blender.Play(upper, clipB);
+
+	// Override : 下のレイヤーとの補間
+	blender.Evaluate();
+	ExpectTranslate(glm::vec3(1.5f, 0, 0), node);
+	ExpectRotateX(0.6f, node);
+	EXPECT_FLOAT_EQ(0.4f, morph->GetWeight());
+
+	// Additive : 下のレイヤーへの加算
+	blender.SetLayerBlendMode(upper, saba::VMDAnimationBlender::BlendMode::Additive);
+	blender.Evaluate();
+	ExpectTranslate(glm::vec3(2, 0, 0), node);
+	ExpectRotateX(0.7f, node);
+	EXPECT_FLOAT_EQ(0.5f, morph->GetWeight());
+
+	// レイヤーの重みのフェード
+	blender.SetLayerWeight(upper, 1.0f, 1.0f);
+	EXPECT_TRUE(blender.IsFading(upper));
+	blender.Update(0.5f);
+	EXPECT_FLOAT_EQ(0.75f, blender.GetLayerWeight(upper));
+	blender.Update(0.5f);
+	EXPECT_FALSE(blender.IsFading(upper));
+	blender.Evaluate();
+	ExpectTranslate(glm::vec3(3, 0, 0), node);
+	ExpectRotateX(1.2f, node);
+	EXPECT_FLOAT_EQ(0.8f, morph->GetWeight());
+}
@@ -0,0 +1,245 @@
+﻿#include <gtest/gtest.h>
+
+#include <Saba/Base/File.h>
+#include <Saba/Base/Path.h>
+#include <Saba/Model/MMD/MMDGenerator.h>
+#include <Saba/Model/MMD/MMDPoseLibrary.h>
+#include <Saba/Model/MMD/PMXFile.h>
+#include <Saba/Model/MMD/PMXModel.h>
+#include <Saba/Model/MMD/VPDFile.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// "センター" (Shift-JIS)
+	const char SjisCenter[] = "\x83\x5A\x83\x93\x83\x5E\x81\x5B";
+
+	std::string MakeVPDText()
+	{
+		std::string text;
+		text += "Vocaloid Pose Data file\r\n";
+		text += "\r\n";
+		text += "miku.osm;\t\t// 親ファイル名\r\n";
+		text += "2;\t\t\t\t// 総ポーズボーン数\r\n";
+		text += "\r\n";
+		text += "Bone0{";
+		text += SjisCenter;
+		text += "\r\n";
+		text += "  0.500000,-1.250000,2.000000;\t\t\t\t// trans x,y,z\r\n";
+		text += "  0.000000,0.707107,0.000000,0.707107;\t\t// Quaternion x,y,z,w\r\n";
+		text += "}\r\n";
+		text += "\r\n";
+		text += "Bone1{head\r\n";
+		text += "  0, 0, 0;\r\n";
+		text += "  1.5e-1, -2E-1, 0.25, 9.25e-01;\r\n";
+		text += "}\r\n";
+		text += "\r\n";
+		text += "Morph0{smile\r\n";
+		text += "  0.750000;\r\n";
+		text += "}\r\n";
+		return text;
+	}
+
+	bool ReadVPDText(saba::VPDFile* vpd, const std::string& text)
+	{
+		return saba::ReadVPDFile(vpd, text.data(), text.size());
+	}
+}
+
+TEST(VPDFileTest, ReadTest)
+{
+	saba::VPDFile vpd;
+	ASSERT_TRUE(ReadVPDText(&vpd, MakeVPDText()));
+
+	ASSERT_EQ(2u, vpd.m_bones.size());
+	EXPECT_EQ(u8"センター", vpd.m_bones[0].m_boneName);
+	EXPECT_FLOAT_EQ(0.5f, vpd.m_bones[0].m_translate.x);
+	EXPECT_FLOAT_EQ(-1.25f, vpd.m_bones[0].m_translate.y);
+	EXPECT_FLOAT_EQ(2.0f, vpd.m_bones[0].m_translate.z);
+	EXPECT_FLOAT_EQ(0.0f, vpd.m_bones[0].m_quaternion.x);
+	EXPECT_FLOAT_EQ(0.707107f, vpd.m_bones[0].m_quaternion.y);
+	EXPECT_FLOAT_EQ(0.0f, vpd.m_bones[0].m_quaternion.z);
+	EXPECT_FLOAT_EQ(0.707107f, vpd.m_bones[0].m_quaternion.w);
+
+	EXPECT_EQ("head", vpd.m_bones[1].m_boneName);
+	EXPECT_FLOAT_EQ(0.15f, vpd.m_bones[1].m_quaternion.x);
+	EXPECT_FLOAT_EQ(-0.2f, vpd.m_bones[1].m_quaternion.y);
+	EXPECT_FLOAT_EQ(0.25f, vpd.m_bones[1].m_quaternion.z);
+	EXPECT_FLOAT_EQ(0.925f, vpd.m_bones[1].m_quaternion.w);
+
+	ASSERT_EQ(1u, vpd.m_morphs.size());
+	EXPECT_EQ("smile", vpd.m_morphs[0].m_morphName);
+	EXPECT_FLOAT_EQ(0.75f, vpd.m_morphs[0].m_weight);
+
+	// 改行が LF だけでも読める
+	std::string lfText = MakeVPDText();
+	lfText.erase(std::remove(lfText.begin(), lfText.end(), '\r'), lfText.end());
+	saba::VPDFile lfVpd;
+	ASSERT_TRUE(ReadVPDText(&lfVpd, lfText));
+	ASSERT_EQ(2u, lfVpd.m_bones.size());
+	EXPECT_EQ(vpd.m_bones[0].m_boneName, lfVpd.m_bones[0].m_boneName);
+	EXPECT_EQ(vpd.m_bones[1].m_quaternion, lfVpd.m_bones[1].m_quaternion);
+}
+
+TEST(VPDFileTest, ReadErrorTest)
+{
+	saba::VPDFile vpd;
+	EXPECT_FALSE(saba::ReadVPDFile(&vpd, "", 0));
+	EXPECT_FALSE(ReadVPDText(&vpd, "Vocaloid Motion Data 0002\r\n"));
+
+	// ボーンのインデックスが範囲外
+	{
+		std::string text = MakeVPDText();
+		text.replace(text.find("Bone1"), 5, "Bone2");
+		EXPECT_FALSE(ReadVPDText(&vpd, text));
+	}
+
+	// 値が足りない
+	{
+		std::string text = MakeVPDText();
+		text.replace(text.find("0.25, "), 6, "");
+		EXPECT_FALSE(ReadVPDText(&vpd, text));
+	}
+
+	// 途中で終わっている
+	{
+		std::string text = MakeVPDText();
+		text.resize(text.find("Morph0") + 12);
+		EXPECT_FALSE(ReadVPDText(&vpd, text));
+	}
+}
+
+TEST(VPDFileTest, PoseLibraryTest)
+{
+	saba::VPDFile vpd1;
+	ASSERT_TRUE(ReadVPDText(&vpd1, MakeVPDText()));
+	saba::VPDFile vpd2 = vpd1;
+	vpd2.m_bones.resize(1);
+	vpd2.m_bones[0].m_boneName = "head";
+	vpd2.m_morphs[0].m_weight = 0.25f;
+
+	saba::MMDPoseLibrary library;
+	EXPECT_EQ(0u, library.AddPose("pose1", vpd1));
+	EXPECT_EQ(1u, library.AddPose("pose2", vpd2));
+	// 名前はポーズ間で共有される
+	EXPECT_EQ(2u, library.GetBoneNames().size());
+	EXPECT_EQ(1u, library.GetMorphNames().size());
+
+	auto libPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_pose.splb");
+	ASSERT_TRUE(library.Save(libPath.c_str()));
+
+	saba::MMDPoseLibrary loaded;
+	ASSERT_TRUE(loaded.Load(libPath.c_str()));
+	ASSERT_EQ(2u, loaded.GetPoseCount());
+	EXPECT_EQ(0u, loaded.FindPose("pose1"));
+	EXPECT_EQ(1u, loaded.FindPose("pose2"));
+	EXPECT_TRUE(saba::MMDPoseLibrary::NPos == loaded.FindPose("pose3"));
+
+	const saba::VPDFile* expected[] = { &vpd1, &vpd2 };
+	for (size_t poseIdx = 0; poseIdx < 2; poseIdx++)
+	{
+		saba::VPDFile vpd;
+		ASSERT_TRUE(loaded.GetPose(poseIdx, &vpd));
+		ASSERT_EQ(expected[poseIdx]->m_bones.size(), vpd.m_bones.size());
+		for (size_t i = 0; i < vpd.m_bones.size(); i++)
+		{
+			EXPECT_EQ(expected[poseIdx]->m_bones[i].m_boneName, vpd.m_bones[i].m_boneName);
+			EXPECT_EQ(expected[poseIdx]->m_bones[i].m_translate, vpd.m_bones[i].m_translate);
+			EXPECT_EQ(expected[poseIdx]->m_bones[i].m_quaternion, vpd.m_bones[i].m_quaternion);
+		}
+		ASSERT_EQ(expected[poseIdx]->m_morphs.size(), vpd.m_morphs.size());
+		EXPECT_EQ(expected[poseIdx]->m_morphs[0].m_morphName, vpd.m_morphs[0].m_morphName);
+		EXPECT_EQ(expected[poseIdx]->m_morphs[0].m_weight, vpd.m_morphs[0].m_weight);
+	}
+
+	// 壊れたファイルは読まない
+	{
+		std::vector<char> data;
+		saba::File file;
+		ASSERT_TRUE(file.Open(libPath));
+		ASSERT_TRUE(file.ReadAll(&data));
+		file.Close();
+		ASSERT_TRUE(file.Create(libPath));
+		ASSERT_TRUE(file.Write(data.data(), data.size() - 4));
+		file.Close();
+
+		saba::MMDPoseLibrary broken;
+		EXPECT_FALSE(broken.Load(libPath.c_str()));
+	}
+
+	std::remove(libPath.c_str());
+}
+
+TEST(VPDFileTest, LoadPoseTest)
+{
+	saba::PMXGenerateParam param;
+	param.m_vertexCount = 320;
+	param.m_boneCount = 16;
+	param.m_materialCount = 1;
+	param.m_positionMorphCount = 2;
+	param.m_morphVertexCount = 10;
+	param.m_rigidbodyCount = 0;
+
+	saba::PMXFile pmx;
+	ASSERT_TRUE(saba::GeneratePMXFile(&pmx, param));
+	auto pmxPath = saba::PathUtil::Combine(saba::PathUtil::GetCWD(), "saba_gtest_pose.pmx");
+	ASSERT_TRUE(saba::WritePMXFile(&pmx, pmxPath.c_str()));
+
+	// モデルのボーンとモーフを使ったポーズ (モデルに無い名前も混ぜる)
+	saba::VPDFile vpd;
+	for (size_t i = 0; i < pmx.m_bones.size(); i += 2)
+	{
+		saba::VPDBone bone;
+		bone.m_boneName = pmx.m_bones[i].m_name;
+		bone.m_translate = glm::vec3(float(i) * 0.1f, 0.5f, -0.25f);
+		bone.m_quaternion = glm::normalize(glm::quat(1.0f, 0.1f * float(i), 0.2f, 0.0f));
+		vpd.m_bones.push_back(bone);
+	}
+	vpd.m_bones.push_back(saba::VPDBone{ "unknown bone", glm::vec3(1), glm::quat() });
+	vpd.m_morphs.push_back(saba::VPDMorph{ pmx.m_morphs[0].m_name, 0.5f });
+	vpd.m_morphs.push_back(saba::VPDMorph{ "unknown morph", 1.0f });
+
+	saba::MMDPoseLibrary library;
+	library.AddPose("pose", vpd);
+
+	saba::PMXModel vpdModel;
+	saba::PMXModel libModel;
+	ASSERT_TRUE(vpdModel.Load(pmxPath, saba::PathUtil::GetCWD()));
+	ASSERT_TRUE(libModel.Load(pmxPath, saba::PathUtil::GetCWD()));
+	vpdModel.InitializeAnimation();
+	libModel.InitializeAnimation();
+
+	saba::MMDPoseLibrary::Binding binding;
+	library.Bind(&libModel, &binding);
+	EXPECT_EQ(nullptr, binding.m_nodes.back());
+	EXPECT_EQ(nullptr, binding.m_morphs.back());
+
+	vpdModel.LoadPose(vpd, 1);
+	libModel.LoadPose(library, 0, binding, 1);
+
+	auto vpdNodes = vpdModel.GetNodeManager();
+	auto libNodes = libModel.GetNodeManager();
+	ASSERT_EQ(vpdNodes->GetNodeCount(), libNodes->GetNodeCount());
+	for (size_t i = 0; i < vpdNodes->GetNodeCount(); i++)
+	{
+		auto vpdNode = vpdNodes->GetMMDNode(i);
+		auto libNode = libNodes->GetMMDNode(i);
+		EXPECT_EQ(vpdNode->GetAnimationTranslate(), libNode->GetAnimationTranslate());
+		EXPECT_EQ(vpdNode->GetAnimationRotate(), libNode->GetAnimationRotate());
+	}
+	auto vpdMorphs = vpdModel.GetMorphManager();
+	auto libMorphs = libModel.GetMorphManager();
+	ASSERT_EQ(vpdMorphs->GetMorphCount(), libMorphs->GetMorphCount());
+	for (size_t i = 0; i < vpdMorphs->GetMorphCount(); i++)
+	{
+		EXPECT_EQ(vpdMorphs->GetMorph(i)->GetWeight(), libMorphs->GetMorph(i)->GetWeight());
+	}
+	EXPECT_FLOAT_EQ(0.5f, libMorphs->GetMorph(0)->GetWeight());
+
+	std::remove(pmxPath.c_str());
+}
@@ -4,7 +4,11 @@
 //
 
 #include <Saba/Base/UnicodeUtil.h>
+#include <Saba/Base/BufferedWriter.h>
+#include <Saba/Base/File.h>
 #include <Saba/Base/Path.h>
+#include <Saba/Base/ThreadPool.h>
+#include <Saba/Base/Time.h>
 #include <Saba/Model/MMD/MMDModel.h>
 #include <Saba/Model/MMD/PMDModel.h>
 #include <Saba/Model/MMD/PMXModel.h>
@@ -12,8 +16,14 @@
 #include <Saba/Model/MMD/VMDAnimation.h>
 #include <Saba/Model/MMD/VPDFile.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <future>
 #include <iostream>
-#include <fstream>
+#include <limits>
+#include <sstream>
 #include <vector>
 #include <string>
 #include <memory>
@@ -21,6 +31,894 @@
 void Usage()
 {
 	std::cout << "mmd2obj <pmd/pmx file> [-vmd <vmd file>] [-t <animation time (sec)>] [-vpd <vpd file>]\n";
+	std::cout << "        [-range <start (sec)> <end (sec)> <step (sec)>] [-o <output file>] [-mtl <output mtl file>]\n";
+	std::cout << "        [-format <obj|ply|glb|pcache>] [-bench]\n";
+	std::cout << "  -range  : Export multiple frames. Physics is simulated continuously.\n";
+	std::cout << "  -o      : Output file name. For obj/ply in -range mode, one %d or %0Nd is replaced by the frame number.\n";
+	std::cout << "            Without it, _%05d is added before the extension.\n";
+	std::cout << "            (default: output.<ext>, -range: output_%05d.<ext>)\n";
+	std::cout << "  -format : obj    : Wavefront OBJ + MTL (ASCII, one file per frame)\n";
+	std::cout << "            ply    : Binary PLY (one file per frame)\n";
+	std::cout << "            glb    : glTF binary. All frames in one file, switched by animation.\n";
+	std::cout << "            pcache : Raw position cache. All frames in one file.\n";
+	std::cout << "  -bench  : Print timings of VMD loading, export and serialization of each format.\n";
+}
+
+namespace
+{
+	// Topology shared by all frames.
+	struct MeshTopology
+	{
+		std::vector<uint32_t>			m_indices;
+		std::vector<saba::MMDSubMesh>	m_subMeshes;
+		std::vector<saba::MMDMaterial>	m_materials;
+		std::vector<glm::vec2>			m_uvs;		//!< Rest UVs. (UV morphs are not applied)
+	};
+
+	// Vertices of one frame.
+	struct MeshFrame
+	{
+		std::string				m_filepath;	//!< Empty : Benchmark (discard output).
+		size_t					m_frameIndex;
+		double					m_time;
+		std::vector<glm::vec3>	m_positions;
+		std::vector<glm::vec3>	m_normals;
+		std::vector<glm::vec2>	m_uvs;
+	};
+
+	struct ExportOption
+	{
+		std::string	m_outputPath;	//!< Empty : Benchmark (discard output).
+		std::string	m_mtlPath;
+		size_t		m_frameCount;
+	};
+
+	bool CopyTopology(const saba::MMDModel* mmdModel, MeshTopology* topology)
+	{
+		// Copy vertex indices.
+		auto& indices = topology->m_indices;
+		indices.resize(mmdModel->GetIndexCount());
+		if (mmdModel->GetIndexElementSize() == 1)
+		{
+			const uint8_t* mmdIndices = (const uint8_t*)mmdModel->GetIndices();
+			std::copy(mmdIndices, mmdIndices + indices.size(), indices.begin());
+		}
+		else if (mmdModel->GetIndexElementSize() == 2)
+		{
+			const uint16_t* mmdIndices = (const uint16_t*)mmdModel->GetIndices();
+			std::copy(mmdIndices, mmdIndices + indices.size(), indices.begin());
+		}
+		else if (mmdModel->GetIndexElementSize() == 4)
+		{
+			const uint32_t* mmdIndices = (const uint32_t*)mmdModel->GetIndices();
+			std::copy(mmdIndices, mmdIndices + indices.size(), indices.begin());
+		}
+		else
+		{
+			return false;
+		}
+
+		const saba::MMDSubMesh* subMeshes = mmdModel->GetSubMeshes();
+		topology->m_subMeshes.assign(subMeshes, subMeshes + mmdModel->GetSubMeshCount());
+		const saba::MMDMaterial* materials = mmdModel->GetMaterials();
+		topology->m_materials.assign(materials, materials + mmdModel->GetMaterialCount());
+		const glm::vec2* uvs = mmdModel->GetUVs();
+		topology->m_uvs.assign(uvs, uvs + mmdModel->GetVertexCount());
+		return true;
+	}
+
+	void CopyFrame(const saba::MMDModel* mmdModel, MeshFrame* frame)
+	{
+		size_t vtxCount = mmdModel->GetVertexCount();
+		const glm::vec3* positions = mmdModel->GetUpdatePositions();
+		const glm::vec3* normals = mmdModel->GetUpdateNormals();
+		const glm::vec2* uvs = mmdModel->GetUpdateUVs();
+		frame->m_positions.assign(positions, positions + vtxCount);
+		frame->m_normals.assign(normals, normals + vtxCount);
+		frame->m_uvs.assign(uvs, uvs + vtxCount);
+	}
+
+	bool OpenWriter(saba::BufferedWriter& writer, const std::string& filepath)
+	{
+		if (filepath.empty())
+		{
+			writer.OpenNull();
+			return true;
+		}
+		if (!writer.Open(filepath))
+		{
+			std::cout << "Failed to open file. [" << filepath << "]\n";
+			return false;
+		}
+		return true;
+	}
+
+	class MeshWriter
+	{
+	public:
+		MeshWriter() : m_writtenSize(0) {}
+		virtual ~MeshWriter() = default;
+
+		// Called once before the first frame.
+		virtual bool Begin(std::shared_ptr<const MeshTopology> topology, const ExportOption& option) = 0;
+		// Called on worker threads.
+		// Sequential writers receive frames in order on a single thread.
+		virtual bool WriteFrame(const MeshFrame& frame) = 0;
+		virtual bool End() = 0;
+		// True : Writes all frames to one file.
+		virtual bool IsSequential() const = 0;
+
+		uint64_t GetWrittenSize() const { return m_writtenSize; }
+
+	protected:
+		std::atomic<uint64_t>	m_writtenSize;
+	};
+
+	// ASCII OBJ. One file per frame.
+	class OBJWriter : public MeshWriter
+	{
+	public:
+		bool Begin(std::shared_ptr<const MeshTopology> topology, const ExportOption& option) override
+		{
+			m_topology = topology;
+			m_mtlFilename = saba::PathUtil::GetFilename(option.m_mtlPath);
+			if (option.m_outputPath.empty())
+			{
+				return true;
+			}
+			return WriteMTLFile(option.m_mtlPath);
+		}
+
+		bool WriteFrame(const MeshFrame& frame) override
+		{
+			saba::BufferedWriter writer;
+			if (!OpenWriter(writer, frame.m_filepath))
+			{
+				return false;
+			}
+			writer.WriteString("# mmmd2obj\n");
+			writer.WriteString("mtllib ");
+			writer.WriteString(m_mtlFilename);
+			writer.WriteChar('\n');
+
+			// Write positions.
+			for (const auto& pos : frame.m_positions)
+			{
+				writer.WriteString("v ");
+				writer.WriteFloat(pos.x);
+				writer.WriteChar(' ');
+				writer.WriteFloat(pos.y);
+				writer.WriteChar(' ');
+				writer.WriteFloat(pos.z);
+				writer.WriteChar('\n');
+			}
+			for (const auto& nor : frame.m_normals)
+			{
+				writer.WriteString("vn ");
+				writer.WriteFloat(nor.x);
+				writer.WriteChar(' ');
+				writer.WriteFloat(nor.y);
+				writer.WriteChar(' ');
+				writer.WriteFloat(nor.z);
+				writer.WriteChar('\n');
+			}
+			for (const auto& uv : frame.m_uvs)
+			{
+				writer.WriteString("vt ");
+				writer.WriteFloat(uv.x);
+				writer.WriteChar(' ');
+				writer.WriteFloat(uv.y);
+				writer.WriteChar('\n');
+			}
+
+			// Write faces.
+			const auto& indices = m_topology->m_indices;
+			for (const auto& subMesh : m_topology->m_subMeshes)
+			{
+				writer.WriteString("\nusemtl ");
+				writer.WriteUInt(uint32_t(subMesh.m_materialID));
+				writer.WriteChar('\n');
+
+				for (int j = 0; j < subMesh.m_vertexCount; j += 3)
+				{
+					auto vtxIdx = subMesh.m_beginIndex + j;
+					writer.WriteString("f");
+					for (int k = 0; k < 3; k++)
+					{
+						auto vi = indices[vtxIdx + k] + 1;
+						writer.WriteChar(' ');
+						writer.WriteUInt(vi);
+						writer.WriteChar('/');
+						writer.WriteUInt(vi);
+						writer.WriteChar('/');
+						writer.WriteUInt(vi);
+					}
+					writer.WriteChar('\n');
+				}
+			}
+			m_writtenSize += writer.GetWrittenSize();
+			return writer.Close();
+		}
+
+		bool End() override { return true; }
+		bool IsSequential() const override { return false; }
+
+	private:
+		bool WriteMTLFile(const std::string& mtlPath)
+		{
+			saba::BufferedWriter writer;
+			if (!OpenWriter(writer, mtlPath))
+			{
+				return false;
+			}
+
+			writer.WriteString("# mmmd2obj\n");
+			for (size_t i = 0; i < m_topology->m_materials.size(); i++)
+			{
+				const auto& m = m_topology->m_materials[i];
+				writer.WriteString("newmtl ");
+				writer.WriteUInt(uint32_t(i));
+				writer.WriteChar('\n');
+
+				const std::pair<const char*, glm::vec3> colors[] = {
+					{ "Ka ", m.m_ambient },
+					{ "Kd ", m.m_diffuse },
+					{ "Ks ", m.m_specular },
+				};
+				for (const auto& color : colors)
+				{
+					writer.WriteString(color.first);
+					writer.WriteFloat(color.second.r);
+					writer.WriteChar(' ');
+					writer.WriteFloat(color.second.g);
+					writer.WriteChar(' ');
+					writer.WriteFloat(color.second.b);
+					writer.WriteChar('\n');
+				}
+				writer.WriteString("d ");
+				writer.WriteFloat(m.m_alpha);
+				writer.WriteChar('\n');
+				writer.WriteString("map_Kd ");
+				writer.WriteString(saba::PathUtil::GetFilename(m.m_texture));
+				writer.WriteString("\n\n");
+			}
+			return writer.Close();
+		}
+
+	private:
+		std::shared_ptr<const MeshTopology>	m_topology;
+		std::string							m_mtlFilename;
+	};
+
+	// Binary little endian PLY. One file per frame.
+	class PLYWriter : public MeshWriter
+	{
+	public:
+		bool Begin(std::shared_ptr<const MeshTopology> topology, const ExportOption&) override
+		{
+			// Faces are the same in all frames. Serialize them once.
+			const auto& indices = topology->m_indices;
+			size_t faceCount = 0;
+			m_faces.clear();
+			for (const auto& subMesh : topology->m_subMeshes)
+			{
+				for (int j = 0; j + 2 < subMesh.m_vertexCount; j += 3)
+				{
+					const uint8_t count = 3;
+					const uint32_t* face = &indices[subMesh.m_beginIndex + j];
+					m_faces.push_back(char(count));
+					m_faces.insert(m_faces.end(), (const char*)face, (const char*)(face + 3));
+					faceCount++;
+				}
+			}
+			m_faceCount = faceCount;
+			return true;
+		}
+
+		bool WriteFrame(const MeshFrame& frame) override
+		{
+			saba::BufferedWriter writer;
+			if (!OpenWriter(writer, frame.m_filepath))
+			{
+				return false;
+			}
+			writer.WriteString("ply\nformat binary_little_endian 1.0\ncomment mmd2obj\nelement vertex ");
+			writer.WriteUInt(uint32_t(frame.m_positions.size()));
+			writer.WriteString(
+				"\nproperty float x\nproperty float y\nproperty float z"
+				"\nproperty float nx\nproperty float ny\nproperty float nz"
+				"\nproperty float s\nproperty float t"
+				"\nelement face ");
+			writer.WriteUInt(uint32_t(m_faceCount));
+			writer.WriteString("\nproperty list uchar uint vertex_indices\nend_header\n");
+
+			for (size_t i = 0; i < frame.m_positions.size(); i++)
+			{
+				const float vtx[8] = {
+					frame.m_positions[i].x, frame.m_positions[i].y, frame.m_positions[i].z,
+					frame.m_normals[i].x, frame.m_normals[i].y, frame.m_normals[i].z,
+					frame.m_uvs[i].x, frame.m_uvs[i].y,
+				};
+				writer.WriteArray(vtx, 8);
+			}
+			writer.Write(m_faces.data(), m_faces.size());
+			m_writtenSize += writer.GetWrittenSize();
+			return writer.Close();
+		}
+
+		bool End() override { return true; }
+		bool IsSequential() const override { return false; }
+
+	private:
+		std::vector<char>	m_faces;
+		size_t				m_faceCount = 0;
+	};
+
+	/*
+		Raw position cache. All frames are written to one file.
+		header : "SBPC" uint32(version = 1) uint32(vertex count) uint32(frame count)
+		frame  : float(time) vec3[vertex count](positions)
+	*/
+	class PositionCacheWriter : public MeshWriter
+	{
+	public:
+		bool Begin(std::shared_ptr<const MeshTopology> topology, const ExportOption& option) override
+		{
+			if (!OpenWriter(m_writer, option.m_outputPath))
+			{
+				return false;
+			}
+			m_writer.Write("SBPC", 4);
+			m_writer.WriteValue(uint32_t(1));
+			m_writer.WriteValue(uint32_t(topology->m_uvs.size()));
+			m_writer.WriteValue(uint32_t(option.m_frameCount));
+			m_writtenSize += m_writer.GetWrittenSize();
+			return true;
+		}
+
+		bool WriteFrame(const MeshFrame& frame) override
+		{
+			uint64_t prevSize = m_writer.GetWrittenSize();
+			m_writer.WriteValue(float(frame.m_time));
+			m_writer.WriteArray(frame.m_positions.data(), frame.m_positions.size());
+			m_writtenSize += m_writer.GetWrittenSize() - prevSize;
+			return !m_writer.IsBad();
+		}
+
+		bool End() override
+		{
+			return m_writer.Close();
+		}
+
+		bool IsSequential() const override { return true; }
+
+	private:
+		saba::BufferedWriter	m_writer;
+	};
+
+	/*
+		glTF binary (GLB). All frames are written to one file.
+		Indices and UVs are stored once, positions and normals per frame.
+		UVs of a frame are stored only when UV morphs change them.
+		Each frame is a node, and a STEP scale animation shows one node at a time.
+		The BIN chunk is streamed to a temporary file and joined at End().
+	*/
+	class GLBWriter : public MeshWriter
+	{
+	public:
+		bool Begin(std::shared_ptr<const MeshTopology> topology, const ExportOption& option) override
+		{
+			m_topology = topology;
+			m_outputPath = option.m_outputPath;
+			m_binPath = m_outputPath.empty() ? "" : m_outputPath + ".bin.tmp";
+			if (!OpenWriter(m_bin, m_binPath))
+			{
+				return false;
+			}
+
+			m_bin.WriteArray(topology->m_indices.data(), topology->m_indices.size());
+			m_uvOffset = m_bin.GetWrittenSize();
+			WriteUVs(topology->m_uvs);
+			m_frames.clear();
+			return true;
+		}
+
+		bool WriteFrame(const MeshFrame& frame) override
+		{
+			FrameInfo info;
+			info.m_time = frame.m_time;
+			info.m_positionOffset = m_bin.GetWrittenSize();
+			m_bin.WriteArray(frame.m_positions.data(), frame.m_positions.size());
+			info.m_normalOffset = m_bin.GetWrittenSize();
+			m_bin.WriteArray(frame.m_normals.data(), frame.m_normals.size());
+			info.m_uvOffset = m_uvOffset;
+			if (frame.m_uvs != m_topology->m_uvs)
+			{
+				info.m_uvOffset = m_bin.GetWrittenSize();
+				WriteUVs(frame.m_uvs);
+			}
+			info.m_min = glm::vec3(std::numeric_limits<float>::max());
+			info.m_max = glm::vec3(-std::numeric_limits<float>::max());
+			for (const auto& pos : frame.m_positions)
+			{
+				info.m_min = glm::min(info.m_min, pos);
+				info.m_max = glm::max(info.m_max, pos);
+			}
+			m_frames.push_back(info);
+			return !m_bin.IsBad();
+		}
+
+		bool End() override;
+		bool IsSequential() const override { return true; }
+
+	private:
+		struct FrameInfo
+		{
+			double		m_time;
+			uint64_t	m_positionOffset;
+			uint64_t	m_normalOffset;
+			uint64_t	m_uvOffset;
+			glm::vec3	m_min;
+			glm::vec3	m_max;
+		};
+
+		std::string BuildJSON(uint64_t animOffset) const;
+
+		void WriteUVs(const std::vector<glm::vec2>& uvs)
+		{
+			for (const auto& uv : uvs)
+			{
+				// glTF uses the top-left origin.
+				m_bin.WriteValue(glm::vec2(uv.x, 1.0f - uv.y));
+			}
+		}
+
+	private:
+		std::shared_ptr<const MeshTopology>	m_topology;
+		std::string				m_outputPath;
+		std::string				m_binPath;
+		saba::BufferedWriter	m_bin;
+		uint64_t				m_uvOffset = 0;
+		std::vector<FrameInfo>	m_frames;
+	};
+
+	void AppendFloat(std::string& str, float value)
+	{
+		char buf[32];
+		saba::FormatFloat(buf, value);
+		str += buf;
+	}
+
+	void AppendVec3(std::string& str, const glm::vec3& v)
+	{
+		str += "[";
+		AppendFloat(str, v.x);
+		str += ",";
+		AppendFloat(str, v.y);
+		str += ",";
+		AppendFloat(str, v.z);
+		str += "]";
+	}
+
+	// Keys of the visibility animation of frame i. (hide -> show -> hide)
+	size_t AnimationKeyCount(size_t frameIdx, size_t frameCount)
+	{
+		return 1 + (frameIdx != 0 ? 1 : 0) + (frameIdx + 1 != frameCount ? 1 : 0);
+	}
+
+	std::string GLBWriter::BuildJSON(uint64_t animOffset) const
+	{
+		const size_t vtxCount = m_topology->m_uvs.size();
+		const size_t frameCount = m_frames.size();
+		const bool animation = frameCount > 1;
+		const auto& subMeshes = m_topology->m_subMeshes;
+		auto toStr = [](uint64_t v) { return std::to_string(v); };
+
+		std::string bufferViews;
+		std::string accessors;
+		size_t bufferViewCount = 0;
+		size_t accessorCount = 0;
+		auto addBufferView = [&](uint64_t offset, uint64_t length, int target)
+		{
+			bufferViews += bufferViewCount == 0 ? "" : ",";
+			bufferViews += "{\"buffer\":0,\"byteOffset\":" + toStr(offset) + ",\"byteLength\":" + toStr(length);
+			if (target != 0)
+			{
+				bufferViews += ",\"target\":" + toStr(target);
+			}
+			bufferViews += "}";
+			return bufferViewCount++;
+		};
+		auto addAccessor = [&](size_t view, uint64_t offset, int componentType, uint64_t count, const char* type, const std::string& minMax)
+		{
+			accessors += accessorCount == 0 ? "" : ",";
+			accessors += "{\"bufferView\":" + toStr(view) + ",\"byteOffset\":" + toStr(offset) +
+				",\"componentType\":" + toStr(componentType) + ",\"count\":" + toStr(count) +
+				",\"type\":\"" + type + "\"" + minMax + "}";
+			return accessorCount++;
+		};
+
+		// Static data.
+		size_t indexView = addBufferView(0, m_uvOffset, 34963);
+		std::vector<size_t> indexAccessors(subMeshes.size());
+		for (size_t i = 0; i < subMeshes.size(); i++)
+		{
+			indexAccessors[i] = addAccessor(indexView, subMeshes[i].m_beginIndex * 4, 5125,
+				subMeshes[i].m_vertexCount, "SCALAR", "");
+		}
+		size_t uvView = addBufferView(m_uvOffset, vtxCount * sizeof(glm::vec2), 34962);
+		size_t uvAccessor = addAccessor(uvView, 0, 5126, vtxCount, "VEC2", "");
+
+		// Frames.
+		std::string meshes;
+		std::string nodes;
+		std::string sceneNodes;
+		for (size_t i = 0; i < frameCount; i++)
+		{
+			const auto& frame = m_frames[i];
+			size_t posView = addBufferView(frame.m_positionOffset, vtxCount * sizeof(glm::vec3), 34962);
+			std::string minMax = ",\"min\":";
+			AppendVec3(minMax, frame.m_min);
+			minMax += ",\"max\":";
+			AppendVec3(minMax, frame.m_max);
+			size_t posAccessor = addAccessor(posView, 0, 5126, vtxCount, "VEC3", minMax);
+			size_t norView = addBufferView(frame.m_normalOffset, vtxCount * sizeof(glm::vec3), 34962);
+			size_t norAccessor = addAccessor(norView, 0, 5126, vtxCount, "VEC3", "");
+			size_t frameUVAccessor = uvAccessor;
+			if (frame.m_uvOffset != m_uvOffset)
+			{
+				size_t frameUVView = addBufferView(frame.m_uvOffset, vtxCount * sizeof(glm::vec2), 34962);
+				frameUVAccessor = addAccessor(frameUVView, 0, 5126, vtxCount, "VEC2", "");
+			}
+
+			meshes += i == 0 ? "{\"primitives\":[" : ",{\"primitives\":[";
+			bool firstPrim = true;
+			for (size_t j = 0; j < subMeshes.size(); j++)
+			{
+				if (subMeshes[j].m_vertexCount == 0)
+				{
+					continue;
+				}
+				meshes += firstPrim ? "" : ",";
+				meshes += "{\"attributes\":{\"POSITION\":" + toStr(posAccessor) +
+					",\"NORMAL\":" + toStr(norAccessor) +
+					",\"TEXCOORD_0\":" + toStr(frameUVAccessor) +
+					"},\"indices\":" + toStr(indexAccessors[j]) +
+					",\"material\":" + toStr(subMeshes[j].m_materialID) + "}";
+				firstPrim = false;
+			}
+			meshes += "]}";
+
+			nodes += i == 0 ? "" : ",";
+			nodes += "{\"name\":\"frame" + toStr(i) + "\",\"mesh\":" + toStr(i);
+			if (animation && i != 0)
+			{
+				nodes += ",\"scale\":[0,0,0]";
+			}
+			nodes += "}";
+			sceneNodes += (i == 0 ? "" : ",") + toStr(i);
+		}
+
+		// Animation. Node i is visible in [time(i), time(i + 1)).
+		std::string animations;
+		if (animation)
+		{
+			std::string samplers;
+			std::string channels;
+			uint64_t offset = animOffset;
+			const float startTime = float(m_frames[0].m_time);
+			for (size_t i = 0; i < frameCount; i++)
+			{
+				size_t keyCount = AnimationKeyCount(i, frameCount);
+				size_t timeView = addBufferView(offset, keyCount * sizeof(float), 0);
+				float lastTime = float(m_frames[std::min(i + 1, frameCount - 1)].m_time) - startTime;
+				std::string timeMinMax = ",\"min\":[0],\"max\":[";
+				AppendFloat(timeMinMax, lastTime);
+				timeMinMax += "]";
+				size_t timeAccessor = addAccessor(timeView, 0, 5126, keyCount, "SCALAR", timeMinMax);
+				offset += keyCount * sizeof(float);
+				size_t scaleView = addBufferView(offset, keyCount * sizeof(glm::vec3), 0);
+				size_t scaleAccessor = addAccessor(scaleView, 0, 5126, keyCount, "VEC3", "");
+				offset += keyCount * sizeof(glm::vec3);
+
+				samplers += i == 0 ? "" : ",";
+				samplers += "{\"input\":" + toStr(timeAccessor) + ",\"output\":" + toStr(scaleAccessor) + ",\"interpolation\":\"STEP\"}";
+				channels += i == 0 ? "" : ",";
+				channels += "{\"sampler\":" + toStr(i) + ",\"target\":{\"node\":" + toStr(i) + ",\"path\":\"scale\"}}";
+			}
+			animations = ",\"animations\":[{\"name\":\"mmd2obj\",\"samplers\":[" + samplers + "],\"channels\":[" + channels + "]}]";
+		}
+
+		// Materials.
+		std::string materials;
+		for (size_t i = 0; i < m_topology->m_materials.size(); i++)
+		{
+			const auto& m = m_topology->m_materials[i];
+			materials += i == 0 ? "{" : ",{";
+			materials += "\"name\":\"" + toStr(i) + "\",\"pbrMetallicRoughness\":{\"baseColorFactor\":[";
+			AppendFloat(materials, m.m_diffuse.r);
+			materials += ",";
+			AppendFloat(materials, m.m_diffuse.g);
+			materials += ",";
+			AppendFloat(materials, m.m_diffuse.b);
+			materials += ",";
+			AppendFloat(materials, m.m_alpha);
+			materials += "],\"metallicFactor\":0,\"roughnessFactor\":1}";
+			materials += m.m_bothFace ? ",\"doubleSided\":true" : "";
+			materials += m.m_alpha < 1.0f ? ",\"alphaMode\":\"BLEND\"" : "";
+			materials += "}";
+		}
+
+		std::string json = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"mmd2obj\"}";
+		json += ",\"scene\":0,\"scenes\":[{\"nodes\":[" + sceneNodes + "]}]";
+		json += ",\"nodes\":[" + nodes + "]";
+		json += ",\"meshes\":[" + meshes + "]";
+		json += ",\"materials\":[" + materials + "]";
+		json += ",\"buffers\":[{\"byteLength\":" + toStr(m_bin.GetWrittenSize()) + "}]";
+		json += ",\"bufferViews\":[" + bufferViews + "]";
+		json += ",\"accessors\":[" + accessors + "]";
+		json += animations;
+		json += "}";
+		return json;
+	}
+
+	bool GLBWriter::End()
+	{
+		// Append the visibility animation.
+		uint64_t animOffset = m_bin.GetWrittenSize();
+		const size_t frameCount = m_frames.size();
+		if (frameCount > 1)
+		{
+			const float startTime = float(m_frames[0].m_time);
+			for (size_t i = 0; i < frameCount; i++)
+			{
+				std::vector<float> times;
+				std::vector<glm::vec3> scales;
+				if (i != 0)
+				{
+					times.push_back(0.0f);
+					scales.push_back(glm::vec3(0));
+				}
+				times.push_back(float(m_frames[i].m_time) - startTime);
+				scales.push_back(glm::vec3(1));
+				if (i + 1 != frameCount)
+				{
+					times.push_back(float(m_frames[i + 1].m_time) - startTime);
+					scales.push_back(glm::vec3(0));
+				}
+				m_bin.WriteArray(times.data(), times.size());
+				m_bin.WriteArray(scales.data(), scales.size());
+			}
+		}
+		std::string json = BuildJSON(animOffset);
+		uint64_t binSize = m_bin.GetWrittenSize();
+		if (!m_bin.Close())
+		{
+			return false;
+		}
+
+		while (json.size() % 4 != 0)
+		{
+			json += ' ';
+		}
+		uint64_t binChunkSize = (binSize + 3) & ~uint64_t(3);
+		uint64_t totalSize = 12 + 8 + json.size() + 8 + binChunkSize;
+		if (totalSize > 0xFFFFFFFFull)
+		{
+			std::cout << "GLB file is too large.\n";
+			return false;
+		}
+
+		saba::BufferedWriter glb;
+		if (!OpenWriter(glb, m_outputPath))
+		{
+			return false;
+		}
+		glb.WriteValue(uint32_t(0x46546C67));	// "glTF"
+		glb.WriteValue(uint32_t(2));
+		glb.WriteValue(uint32_t(totalSize));
+		glb.WriteValue(uint32_t(json.size()));
+		glb.WriteValue(uint32_t(0x4E4F534A));	// "JSON"
+		glb.WriteString(json);
+		glb.WriteValue(uint32_t(binChunkSize));
+		glb.WriteValue(uint32_t(0x004E4942));	// "BIN"
+
+		if (!m_binPath.empty())
+		{
+			saba::File binFile;
+			if (!binFile.Open(m_binPath))
+			{
+				return false;
+			}
+			std::vector<char> buf(1024 * 1024);
+			uint64_t remain = binSize;
+			while (remain != 0)
+			{
+				size_t readSize = size_t(std::min<uint64_t>(remain, buf.size()));
+				if (!binFile.Read(buf.data(), readSize))
+				{
+					return false;
+				}
+				glb.Write(buf.data(), readSize);
+				remain -= readSize;
+			}
+			binFile.Close();
+			remove(m_binPath.c_str());
+		}
+		else
+		{
+			// Benchmark : The BIN chunk was only counted.
+			m_writtenSize += binSize;
+		}
+		for (uint64_t i = binSize; i < binChunkSize; i++)
+		{
+			glb.WriteChar('\0');
+		}
+		m_writtenSize += glb.GetWrittenSize();
+		return glb.Close();
+	}
+
+	std::unique_ptr<MeshWriter> CreateMeshWriter(const std::string& format)
+	{
+		if (format == "obj") { return std::make_unique<OBJWriter>(); }
+		if (format == "ply") { return std::make_unique<PLYWriter>(); }
+		if (format == "glb") { return std::make_unique<GLBWriter>(); }
+		if (format == "pcache") { return std::make_unique<PositionCacheWriter>(); }
+		return nullptr;
+	}
+
+	// Output file name of each frame in -range mode : prefix + zero padded frame number + suffix.
+	struct FramePathPattern
+	{
+		std::string	m_prefix;
+		std::string	m_suffix;
+		size_t		m_width;
+	};
+
+	/*
+		Accepts exactly one "%d" or "%0Nd" directive ("%%" is a literal '%').
+		If there is no directive, "_%05d" is inserted before the extension.
+	*/
+	bool ParseFramePathPattern(const std::string& path, FramePathPattern* pattern)
+	{
+		std::string prefix;
+		std::string suffix;
+		std::string* out = &prefix;
+		bool found = false;
+		size_t width = 0;
+		for (size_t i = 0; i < path.size(); i++)
+		{
+			if (path[i] != '%')
+			{
+				out->push_back(path[i]);
+				continue;
+			}
+			i++;
+			if (i < path.size() && path[i] == '%')
+			{
+				out->push_back('%');
+				continue;
+			}
+			if (found)
+			{
+				return false;
+			}
+			if (i < path.size() && path[i] == '0')
+			{
+				i++;
+				size_t digitBegin = i;
+				while (i < path.size() && path[i] >= '0' && path[i] <= '9')
+				{
+					i++;
+				}
+				if (i == digitBegin || i - digitBegin > 2)
+				{
+					return false;
+				}
+				width = std::stoul(path.substr(digitBegin, i - digitBegin));
+			}
+			if (i >= path.size() || path[i] != 'd')
+			{
+				return false;
+			}
+			found = true;
+			out = &suffix;
+		}
+
+		if (!found)
+		{
+			auto ext = saba::PathUtil::GetExt(saba::PathUtil::GetFilename(prefix));
+			size_t extPos = ext.empty() ? prefix.size() : prefix.size() - ext.size() - 1;
+			suffix = prefix.substr(extPos);
+			prefix = prefix.substr(0, extPos) + "_";
+			width = 5;
+		}
+		pattern->m_prefix = std::move(prefix);
+		pattern->m_suffix = std::move(suffix);
+		pattern->m_width = width;
+		return true;
+	}
+
+	std::string MakeFramePath(const FramePathPattern& pattern, size_t frameIndex)
+	{
+		std::string number = std::to_string(frameIndex);
+		if (number.size() < pattern.m_width)
+		{
+			number.insert(0, pattern.m_width - number.size(), '0');
+		}
+		return pattern.m_prefix + number + pattern.m_suffix;
+	}
+
+	// Serializes the same frame repeatedly without writing files and reports MB/s.
+	void BenchmarkMeshWriters(std::shared_ptr<const MeshTopology> topology, const MeshFrame& srcFrame)
+	{
+		const int BenchFrameCount = 10;
+		MeshFrame frame = srcFrame;
+		frame.m_filepath.clear();
+
+		auto report = [](const char* name, uint64_t size, double sec)
+		{
+			double mb = double(size) / (1024.0 * 1024.0);
+			std::cout << "  " << name << " : " << mb << " MB, " << sec * 1000.0 << " ms, " << mb / sec << " MB/s\n";
+		};
+
+		std::cout << "Writer benchmark (" << BenchFrameCount << " frames, " << frame.m_positions.size() << " vertices)\n";
+		for (const char* format : { "obj", "ply", "glb", "pcache" })
+		{
+			auto writer = CreateMeshWriter(format);
+			ExportOption option;
+			option.m_frameCount = BenchFrameCount;
+			double start = saba::GetTime();
+			writer->Begin(topology, option);
+			for (int i = 0; i < BenchFrameCount; i++)
+			{
+				frame.m_frameIndex = i;
+				frame.m_time = i / 30.0;
+				writer->WriteFrame(frame);
+			}
+			writer->End();
+			report(format, writer->GetWrittenSize(), saba::GetTime() - start);
+		}
+
+		// Previous implementation (std::ostream <<) for comparison.
+		{
+			double start = saba::GetTime();
+			uint64_t size = 0;
+			for (int i = 0; i < BenchFrameCount; i++)
+			{
+				std::ostringstream objFile;
+				for (const auto& pos : frame.m_positions)
+				{
+					objFile << "v " << pos.x << " " << pos.y << " " << pos.z << "\n";
+				}
+				for (const auto& nor : frame.m_normals)
+				{
+					objFile << "vn " << nor.x << " " << nor.y << " " << nor.z << "\n";
+				}
+				for (const auto& uv : frame.m_uvs)
+				{
+					objFile << "vt " << uv.x << " " << uv.y << "\n";
+				}
+				for (const auto& subMesh : topology->m_subMeshes)
+				{
+					objFile << "\nusemtl " << subMesh.m_materialID << "\n";
+					for (int j = 0; j < subMesh.m_vertexCount; j += 3)
+					{
+						auto vtxIdx = subMesh.m_beginIndex + j;
+						auto vi0 = topology->m_indices[vtxIdx + 0] + 1;
+						auto vi1 = topology->m_indices[vtxIdx + 1] + 1;
+						auto vi2 = topology->m_indices[vtxIdx + 2] + 1;
+						objFile << "f "
+							<< vi0 << "/" << vi0 << "/" << vi0 << " "
+							<< vi1 << "/" << vi1 << "/" << vi1 << " "
+							<< vi2 << "/" << vi2 << "/" << vi2 << "\n";
+					}
+				}
+				size += objFile.str().size();
+			}
+			report("obj (ostream)", size, saba::GetTime() - start);
+		}
+	}
 }
 
 bool MMD2Obj(const std::vector<std::string>& args)
@@ -36,6 +934,14 @@ bool MMD2Obj(const std::vector<std::string>& args)
 	std::vector<std::string> vmdPaths;
 	std::string vpdPath;
 	double	animTime = 0.0;
+	bool	rangeMode = false;
+	double	rangeStart = 0.0;
+	double	rangeEnd = 0.0;
+	double	rangeStep = 1.0 / 30.0;
+	std::string outputPath;
+	std::string mtlPath = "output.mtl";
+	std::string format = "obj";
+	bool	bench = false;
 
 	for (size_t i = 2; i < args.size(); i++)
 	{
@@ -78,12 +984,103 @@ bool MMD2Obj(const std::vector<std::string>& args)
 				return false;
 			}
 		}
+		else if (args[i] == "-range")
+		{
+			if (i + 3 < args.size())
+			{
+				rangeMode = true;
+				rangeStart = std::stod(args[i + 1]);
+				rangeEnd = std::stod(args[i + 2]);
+				rangeStep = std::stod(args[i + 3]);
+				i += 3;
+				if (rangeStep <= 0.0 || rangeEnd < rangeStart)
+				{
+					std::cout << "Invalid range.\n";
+					return false;
+				}
+			}
+			else
+			{
+				Usage();
+				return false;
+			}
+		}
+		else if (args[i] == "-o")
+		{
+			i++;
+			if (i < args.size())
+			{
+				outputPath = args[i];
+			}
+			else
+			{
+				Usage();
+				return false;
+			}
+		}
+		else if (args[i] == "-mtl")
+		{
+			i++;
+			if (i < args.size())
+			{
+				mtlPath = args[i];
+			}
+			else
+			{
+				Usage();
+				return false;
+			}
+		}
+		else if (args[i] == "-format")
+		{
+			i++;
+			if (i < args.size())
+			{
+				format = args[i];
+			}
+			else
+			{
+				Usage();
+				return false;
+			}
+		}
+		else if (args[i] == "-bench")
+		{
+			bench = true;
+		}
 		else
 		{
 			Usage();
 			return false;
 		}
 	}
+	auto meshWriter = CreateMeshWriter(format);
+	if (meshWriter == nullptr)
+	{
+		std::cout << "Unsupported format : " << format << "\n";
+		return false;
+	}
+	const bool multiFile = !meshWriter->IsSequential();
+	if (outputPath.empty())
+	{
+		outputPath = (rangeMode && multiFile ? "output_%05d." : "output.") + format;
+	}
+	// Frames of one file per frame formats are written in parallel, so each frame needs its own file.
+	FramePathPattern framePathPattern;
+	if (rangeMode && multiFile)
+	{
+		if (!ParseFramePathPattern(outputPath, &framePathPattern))
+		{
+			std::cout << "Invalid output file pattern : " << outputPath << "\n";
+			std::cout << "Use one %d or %0Nd for the frame number.\n";
+			return false;
+		}
+	}
+	if (!rangeMode)
+	{
+		rangeStart = animTime;
+		rangeEnd = animTime;
+	}
 
 	// Load model.
 	std::shared_ptr<saba::MMDModel> mmdModel;
@@ -126,16 +1123,58 @@ bool MMD2Obj(const std::vector<std::string>& args)
 	for (const auto& vmdPath : vmdPaths)
 	{
 		saba::VMDFile vmdFile;
+		double readStart = saba::GetTime();
 		if (!saba::ReadVMDFile(&vmdFile, vmdPath.c_str()))
 		{
 			std::cout << "Failed to read VMD file.\n";
 			return false;
 		}
+		double addStart = saba::GetTime();
 		if (!vmdAnim->Add(vmdFile))
 		{
 			std::cout << "Failed to add VMDAnimation.\n";
 			return false;
 		}
+		if (bench)
+		{
+			double addEnd = saba::GetTime();
+			std::cout << "VMD : " << vmdPath << "\n";
+			std::cout << "  read : " << (addStart - readStart) * 1000.0 << " ms\n";
+			std::cout << "  add  : " << (addEnd - addStart) * 1000.0 << " ms"
+				<< " (motion " << vmdFile.m_motions.size()
+				<< ", morph " << vmdFile.m_morphs.size()
+				<< ", ik " << vmdFile.m_iks.size() << ")\n";
+		}
+	}
+
+	if (bench && useVMDAnimation)
+	{
+		auto usage = vmdAnim->GetMemoryUsage();
+		std::cout << "VMD keys : node " << usage.m_nodeKeyCount << " (" << usage.m_nodeKeyMemory << " bytes)"
+			<< ", ik " << usage.m_ikKeyCount << " (" << usage.m_ikKeyMemory << " bytes)"
+			<< ", morph " << usage.m_morphKeyCount << " (" << usage.m_morphKeyMemory << " bytes)"
+			<< ", total " << usage.GetTotalMemory() << " bytes\n";
+
+		// Sample every frame without touching the model.
+		std::vector<float> times(size_t(vmdAnim->GetMaxKeyTime()) + 1);
+		for (size_t i = 0; i < times.size(); i++)
+		{
+			times[i] = float(i);
+		}
+		std::vector<glm::vec3> translates(times.size() * vmdAnim->GetNodeControllerCount());
+		std::vector<glm::quat> rotates(times.size() * vmdAnim->GetNodeControllerCount());
+		std::vector<float> morphWeights(times.size() * vmdAnim->GetMorphControllerCount());
+		std::vector<uint8_t> ikEnables(times.size() * vmdAnim->GetIKControllerCount());
+		saba::ThreadPool evalPool;
+		for (saba::ThreadPool* pool : { (saba::ThreadPool*)nullptr, &evalPool })
+		{
+			double evalStart = saba::GetTime();
+			vmdAnim->EvaluatePoses(times.data(), times.size(),
+				translates.data(), rotates.data(), morphWeights.data(), ikEnables.data(), pool);
+			std::cout << "EvaluatePoses (" << times.size() << " frames, "
+				<< (pool != nullptr ? pool->GetThreadCount() : 1) << " threads) : "
+				<< (saba::GetTime() - evalStart) * 1000.0 << " ms\n";
+		}
 	}
 
 	// Load pose.
@@ -163,7 +1202,7 @@ bool MMD2Obj(const std::vector<std::string>& args)
 		mmdModel->InitializeAnimation();
 		if (useVMDAnimation)
 		{
-			vmdAnim->SyncPhysics((float)animTime * 30.0f);
+			vmdAnim->SyncPhysics((float)rangeStart * 30.0f);
 		}
 		else
 		{
@@ -171,133 +1210,95 @@ bool MMD2Obj(const std::vector<std::string>& args)
 		}
 	}
 
-	// Update animation(animation loop).
+	auto topology = std::make_shared<MeshTopology>();
+	if (!CopyTopology(mmdModel.get(), topology.get()))
+	{
+		return false;
+	}
+
+	size_t frameCount = size_t((rangeEnd - rangeStart) / rangeStep + 1.0e-6) + 1;
+	ExportOption exportOption;
+	exportOption.m_outputPath = outputPath;
+	exportOption.m_mtlPath = mtlPath;
+	exportOption.m_frameCount = frameCount;
+	if (!meshWriter->Begin(topology, exportOption))
+	{
+		return false;
+	}
+
+	// Write files on worker threads while the next frame is simulated.
+	// Single file formats use one worker to keep the frame order.
+	saba::ThreadPool pool(multiFile ? 0 : 1);
+	const size_t maxPendingFrames = pool.GetThreadCount() * 2;
+	std::deque<std::future<bool>> pendingWrites;
+	bool writeSucceeded = true;
+	auto waitWrite = [&pendingWrites, &writeSucceeded]()
+	{
+		writeSucceeded = pendingWrites.front().get() && writeSucceeded;
+		pendingWrites.pop_front();
+	};
+
+	MeshWriter* writer = meshWriter.get();
+	std::shared_ptr<MeshFrame> lastFrame;
+	double exportStart = saba::GetTime();
+	for (size_t frameIdx = 0; frameIdx < frameCount; frameIdx++)
 	{
+		double frameTime = rangeStart + rangeStep * double(frameIdx);
+		// The first frame uses the same elapsed time as the single frame mode.
+		float physicsElapsed = frameIdx == 0 ? 1.0f / 60.0f : (float)rangeStep;
+
 		// Update animation.
 		mmdModel->BeginAnimation();
 		if (useVMDAnimation)
 		{
-			mmdModel->UpdateAllAnimation(vmdAnim.get(), (float)animTime * 30.0f, 1.0f / 60.0f);
+			mmdModel->UpdateAllAnimation(vmdAnim.get(), (float)frameTime * 30.0f, physicsElapsed);
 		}
 		else
 		{
-			mmdModel->UpdateAllAnimation(nullptr, 0, 1.0f / 60.0f);
+			mmdModel->UpdateAllAnimation(nullptr, 0, physicsElapsed);
 		}
 		mmdModel->EndAnimation();
 
 		// Update vertices.
 		mmdModel->Update();
-	}
 
-	// Output OBJ file.
-	std::ofstream objFile;
-	objFile.open("output.obj");
-	if (!objFile.is_open())
-	{
-		std::cout << "Failed to open OBJ file.\n";
-		return false;
-	}
-	objFile << "# mmmd2obj\n";
-	objFile << "mtllib output.mtl\n";
-
-	// Write positions.
-	size_t vtxCount = mmdModel->GetVertexCount();
-	const glm::vec3* positions = mmdModel->GetUpdatePositions();
-	for (size_t i = 0; i < vtxCount; i++)
-	{
-		objFile << "v " << positions[i].x << " " << positions[i].y << " " << positions[i].z << "\n";
-	}
-	const glm::vec3* normals = mmdModel->GetUpdateNormals();
-	for (size_t i = 0; i < vtxCount; i++)
-	{
-		objFile << "vn " << normals[i].x << " " << normals[i].y << " " << normals[i].z << "\n";
-	}
-	const glm::vec2* uvs = mmdModel->GetUpdateUVs();
-	for (size_t i = 0; i < vtxCount; i++)
-	{
-		objFile << "vt " << uvs[i].x << " " << uvs[i].y << "\n";
-	}
+		auto frame = std::make_shared<MeshFrame>();
+		frame->m_filepath = rangeMode && multiFile ? MakeFramePath(framePathPattern, frameIdx) : outputPath;
+		frame->m_frameIndex = frameIdx;
+		frame->m_time = frameTime;
+		CopyFrame(mmdModel.get(), frame.get());
+		lastFrame = frame;
 
-	// Copy vertex indices.
-	std::vector<size_t> indices(mmdModel->GetIndexCount());
-	if (mmdModel->GetIndexElementSize() == 1)
-	{
-		uint8_t* mmdIndices = (uint8_t*)mmdModel->GetIndices();
-		for (size_t i = 0; i < indices.size(); i++)
+		if (pendingWrites.size() >= maxPendingFrames)
 		{
-			indices[i] = mmdIndices[i];
+			waitWrite();
 		}
-	}
-	else if (mmdModel->GetIndexElementSize() == 2)
-	{
-		uint16_t* mmdIndices = (uint16_t*)mmdModel->GetIndices();
-		for (size_t i = 0; i < indices.size(); i++)
-		{
-			indices[i] = mmdIndices[i];
-		}
-	}
-	else if (mmdModel->GetIndexElementSize() == 4)
-	{
-		uint32_t* mmdIndices = (uint32_t*)mmdModel->GetIndices();
-		for (size_t i = 0; i < indices.size(); i++)
+		pendingWrites.emplace_back(pool.Enqueue([frame, writer]()
 		{
-			indices[i] = mmdIndices[i];
-		}
-	}
-	else
-	{
-		return false;
-	}
+			return writer->WriteFrame(*frame);
+		}));
 
-	// Write faces.
-	size_t subMeshCount = mmdModel->GetSubMeshCount();
-	const saba::MMDSubMesh* subMeshes = mmdModel->GetSubMeshes();
-	for (size_t i = 0; i < subMeshCount; i++)
-	{
-		objFile << "\n";
-		objFile << "usemtl " << subMeshes[i].m_materialID << "\n";
-
-		for (size_t j = 0; j < subMeshes[i].m_vertexCount; j += 3)
+		if (rangeMode)
 		{
-			auto vtxIdx = subMeshes[i].m_beginIndex + j;
-			auto vi0 = indices[vtxIdx + 0] + 1;
-			auto vi1 = indices[vtxIdx + 1] + 1;
-			auto vi2 = indices[vtxIdx + 2] + 1;
-			objFile << "f "
-				<< vi0 << "/" << vi0 << "/" << vi0 << " "
-				<< vi1 << "/" << vi1 << "/" << vi1 << " "
-				<< vi2 << "/" << vi2 << "/" << vi2 << "\n";
+			std::cout << "Frame " << frameIdx + 1 << "/" << frameCount << " : " << frame->m_filepath << "\n";
 		}
 	}
-	objFile.close();
-
-	// Write materials.
-	std::ofstream mtlFile;
-	mtlFile.open("output.mtl");
-	if (!mtlFile.is_open())
+	while (!pendingWrites.empty())
 	{
-		std::cout << "Failed to open MTL file.\n";
-		return false;
+		waitWrite();
 	}
+	writeSucceeded = meshWriter->End() && writeSucceeded;
 
-	objFile << "# mmmd2obj\n";
-	size_t materialCount = mmdModel->GetMaterialCount();
-	const saba::MMDMaterial* materials = mmdModel->GetMaterials();
-	for (size_t i = 0; i < materialCount; i++)
+	if (bench)
 	{
-		const auto& m = materials[i];
-		mtlFile << "newmtl " << i << "\n";
-
-		mtlFile << "Ka " << m.m_ambient.r << " " << m.m_ambient.g << " " << m.m_ambient.b << "\n";
-		mtlFile << "Kd " << m.m_diffuse.r << " " << m.m_diffuse.g << " " << m.m_diffuse.b << "\n";
-		mtlFile << "Ks " << m.m_specular.r << " " << m.m_specular.g << " " << m.m_specular.b << "\n";
-		mtlFile << "d " << m.m_alpha << "\n";
-		mtlFile << "map_Kd " << saba::PathUtil::GetFilename(m.m_texture) << "\n";
-		mtlFile << "\n";
+		double exportSec = saba::GetTime() - exportStart;
+		double mb = double(meshWriter->GetWrittenSize()) / (1024.0 * 1024.0);
+		std::cout << "Export : " << frameCount << " frames, " << exportSec * 1000.0 << " ms, "
+			<< mb << " MB, " << mb / exportSec << " MB/s\n";
+		BenchmarkMeshWriters(topology, *lastFrame);
 	}
-	mtlFile.close();
 
-	return true;
+	return writeSucceeded;
 }
 
 #if _WIN32
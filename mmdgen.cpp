@@ -0,0 +1,186 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include <Saba/Model/MMD/MMDGenerator.h>
+#include <Saba/Model/MMD/PMXFile.h>
+#include <Saba/Model/MMD/VMDFile.h>
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+void Usage()
+{
+	std::cout << "mmdgen [-o <output pmx file>] [-vmd <output vmd file>] [-seed <seed>] [-utf16]\n";
+	std::cout << "       [-vertex <count>] [-bone <count>] [-material <count>] [-weight <bdef1> <bdef2> <bdef4> <sdef> <qdef>]\n";
+	std::cout << "       [-morph <count>] [-uvMorph <count>] [-boneMorph <count>] [-materialMorph <count>] [-groupMorph <count>]\n";
+	std::cout << "       [-morphVertex <count>] [-ik <count>] [-ikIteration <count>] [-rigidbody <count>]\n";
+	std::cout << "       [-frame <count>] [-key <interval>] [-keyRatio <ratio>] [-morphKey <interval>] [-ikKey <interval>]\n";
+	std::cout << "  -o       : Output PMX file name. (default: generated.pmx)\n";
+	std::cout << "  -vmd     : Also generate a VMD animation for the generated model.\n";
+	std::cout << "  -weight  : Ratio of each skinning type.\n";
+	std::cout << "  -bone    : Bone count including IK chains (4 bones per chain).\n";
+	std::cout << "  -key     : Bone key interval in frames. (0: no bone keys)\n";
+	std::cout << "  -ikKey   : Interval of IK enable/disable keys. (0: no IK keys)\n";
+}
+
+namespace
+{
+	bool ReadArg(const std::vector<std::string>& args, size_t* i, uint32_t* value)
+	{
+		(*i)++;
+		if (*i >= args.size())
+		{
+			return false;
+		}
+		*value = uint32_t(std::stoul(args[*i]));
+		return true;
+	}
+
+	bool ReadArg(const std::vector<std::string>& args, size_t* i, float* value)
+	{
+		(*i)++;
+		if (*i >= args.size())
+		{
+			return false;
+		}
+		*value = std::stof(args[*i]);
+		return true;
+	}
+
+	bool ReadArg(const std::vector<std::string>& args, size_t* i, std::string* value)
+	{
+		(*i)++;
+		if (*i >= args.size())
+		{
+			return false;
+		}
+		*value = args[*i];
+		return true;
+	}
+}
+
+bool MMDGen(const std::vector<std::string>& args)
+{
+	saba::PMXGenerateParam pmxParam;
+	saba::VMDGenerateParam vmdParam;
+	std::string pmxPath = "generated.pmx";
+	std::string vmdPath;
+	uint32_t ikIterationCount = uint32_t(pmxParam.m_ikIterationCount);
+
+	const std::map<std::string, uint32_t*> uintOptions = {
+		{ "-seed", &pmxParam.m_seed },
+		{ "-vertex", &pmxParam.m_vertexCount },
+		{ "-bone", &pmxParam.m_boneCount },
+		{ "-material", &pmxParam.m_materialCount },
+		{ "-morph", &pmxParam.m_positionMorphCount },
+		{ "-uvMorph", &pmxParam.m_uvMorphCount },
+		{ "-boneMorph", &pmxParam.m_boneMorphCount },
+		{ "-materialMorph", &pmxParam.m_materialMorphCount },
+		{ "-groupMorph", &pmxParam.m_groupMorphCount },
+		{ "-morphVertex", &pmxParam.m_morphVertexCount },
+		{ "-ik", &pmxParam.m_ikChainCount },
+		{ "-ikIteration", &ikIterationCount },
+		{ "-rigidbody", &pmxParam.m_rigidbodyCount },
+		{ "-frame", &vmdParam.m_frameCount },
+		{ "-key", &vmdParam.m_nodeKeyInterval },
+		{ "-morphKey", &vmdParam.m_morphKeyInterval },
+		{ "-ikKey", &vmdParam.m_ikKeyInterval },
+	};
+
+	for (size_t i = 1; i < args.size(); i++)
+	{
+		bool ok = true;
+		auto uintOption = uintOptions.find(args[i]);
+		if (uintOption != uintOptions.end())
+		{
+			ok = ReadArg(args, &i, uintOption->second);
+		}
+		else if (args[i] == "-o")
+		{
+			ok = ReadArg(args, &i, &pmxPath);
+		}
+		else if (args[i] == "-vmd")
+		{
+			ok = ReadArg(args, &i, &vmdPath);
+		}
+		else if (args[i] == "-utf16")
+		{
+			pmxParam.m_encode = 0;
+		}
+		else if (args[i] == "-weight")
+		{
+			for (auto& ratio : pmxParam.m_weightRatio)
+			{
+				ok = ok && ReadArg(args, &i, &ratio);
+			}
+		}
+		else if (args[i] == "-keyRatio")
+		{
+			ok = ReadArg(args, &i, &vmdParam.m_nodeKeyRatio);
+		}
+		else
+		{
+			ok = false;
+		}
+
+		if (!ok)
+		{
+			Usage();
+			return false;
+		}
+	}
+	pmxParam.m_ikIterationCount = int32_t(ikIterationCount);
+	vmdParam.m_seed = pmxParam.m_seed;
+
+	saba::PMXFile pmx;
+	if (!saba::GeneratePMXFile(&pmx, pmxParam) || !saba::WritePMXFile(&pmx, pmxPath.c_str()))
+	{
+		std::cout << "Failed to generate PMX file.\n";
+		return false;
+	}
+	std::cout << pmxPath << " : "
+		<< pmx.m_vertices.size() << " vertices, "
+		<< pmx.m_faces.size() << " faces, "
+		<< pmx.m_bones.size() << " bones, "
+		<< pmx.m_morphs.size() << " morphs, "
+		<< pmx.m_rigidbodies.size() << " rigidbodies\n";
+
+	if (!vmdPath.empty())
+	{
+		saba::VMDFile vmd;
+		if (!saba::GenerateVMDFile(&vmd, pmx, vmdParam) || !saba::WriteVMDFile(&vmd, vmdPath.c_str()))
+		{
+			std::cout << "Failed to generate VMD file.\n";
+			return false;
+		}
+		std::cout << vmdPath << " : "
+			<< vmd.m_motions.size() << " bone keys, "
+			<< vmd.m_morphs.size() << " morph keys, "
+			<< vmd.m_iks.size() << " ik keys\n";
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> args(argv, argv + argc);
+	try
+	{
+		if (!MMDGen(args))
+		{
+			return 1;
+		}
+	}
+	catch (const std::exception&)
+	{
+		Usage();
+		return 1;
+	}
+	return 0;
+}
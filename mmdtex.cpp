@@ -0,0 +1,172 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include <Saba/Base/Path.h>
+#include <Saba/Base/Singleton.h>
+#include <Saba/Base/ThreadPool.h>
+#include <Saba/Base/Time.h>
+#include <Saba/GL/GLTextureTranscoder.h>
+#include <Saba/Model/MMD/PMDFile.h>
+#include <Saba/Model/MMD/PMXFile.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+void Usage()
+{
+	std::cout << "mmdtex <pmx/pmd/image file>... [-bc1 | -bc3]\n";
+	std::cout << "  Transcode textures to mipmapped BC1/BC3 DDS (<texture>.saba.dds).\n";
+	std::cout << "  For PMX/PMD files, all textures referenced by the model are transcoded.\n";
+	std::cout << "  Up-to-date files are kept. If the existing file has a different format, it is transcoded again.\n";
+	std::cout << "  Textures that can not be compressed (DDS, HDR, height is not a power of two) are skipped.\n";
+	std::cout << "  -bc1 : Always use BC1. (default: BC3 if the texture has transparent pixels)\n";
+	std::cout << "  -bc3 : Always use BC3.\n";
+}
+
+namespace
+{
+	void AddTexture(std::vector<std::string>* textures, const std::string& dirPath, const std::string& texName)
+	{
+		if (texName.empty())
+		{
+			return;
+		}
+		std::string texPath = dirPath.empty() ? texName : saba::PathUtil::Normalize(saba::PathUtil::Combine(dirPath, texName));
+		if (std::find(textures->begin(), textures->end(), texPath) == textures->end())
+		{
+			textures->push_back(texPath);
+		}
+	}
+
+	bool CollectTextures(const std::string& filepath, std::vector<std::string>* textures)
+	{
+		std::string ext = saba::PathUtil::GetExt(filepath);
+		std::string dirPath = saba::PathUtil::GetDirectoryName(filepath);
+		if (ext == "pmx")
+		{
+			saba::PMXFile pmx;
+			if (!saba::ReadPMXFile(&pmx, filepath.c_str()))
+			{
+				std::cout << "Failed to read PMX file. [" << filepath << "]\n";
+				return false;
+			}
+			for (const auto& tex : pmx.m_textures)
+			{
+				AddTexture(textures, dirPath, tex.m_textureName);
+			}
+		}
+		else if (ext == "pmd")
+		{
+			saba::PMDFile pmd;
+			if (!saba::ReadPMDFile(&pmd, filepath.c_str()))
+			{
+				std::cout << "Failed to read PMD file. [" << filepath << "]\n";
+				return false;
+			}
+			// "tex.bmp*sphere.sph" の形式
+			for (const auto& mat : pmd.m_materials)
+			{
+				std::string texName = mat.m_textureName.ToUtf8String();
+				size_t asterPos = texName.find_first_of('*');
+				if (asterPos == std::string::npos)
+				{
+					AddTexture(textures, dirPath, texName);
+				}
+				else
+				{
+					AddTexture(textures, dirPath, texName.substr(0, asterPos));
+					AddTexture(textures, dirPath, texName.substr(asterPos + 1));
+				}
+			}
+		}
+		else
+		{
+			AddTexture(textures, "", filepath);
+		}
+		return true;
+	}
+}
+
+bool MMDTex(const std::vector<std::string>& args)
+{
+	saba::TextureCompression compression = saba::TextureCompression::Auto;
+	std::vector<std::string> textures;
+	for (size_t i = 1; i < args.size(); i++)
+	{
+		if (args[i] == "-bc1")
+		{
+			compression = saba::TextureCompression::BC1;
+		}
+		else if (args[i] == "-bc3")
+		{
+			compression = saba::TextureCompression::BC3;
+		}
+		else if (!args[i].empty() && args[i][0] == '-')
+		{
+			Usage();
+			return false;
+		}
+		else if (!CollectTextures(args[i], &textures))
+		{
+			return false;
+		}
+	}
+	if (textures.empty())
+	{
+		Usage();
+		return false;
+	}
+
+	// テクスチャごとに並列に変換する (ブロックの圧縮も同じスレッドプールで並列化される)
+	std::vector<saba::TranscodeResult> results(textures.size());
+	double startTime = saba::GetTime();
+	saba::Singleton<saba::ThreadPool>::Get()->ParallelFor(textures.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			results[i] = saba::TranscodeTextureFile(textures[i], compression);
+		}
+	});
+	double elapsed = saba::GetTime() - startTime;
+
+	size_t skipCount = 0;
+	size_t failCount = 0;
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		if (results[i] == saba::TranscodeResult::Succeeded)
+		{
+			std::cout << saba::GetCompressedTexturePath(textures[i]) << "\n";
+		}
+		else if (results[i] == saba::TranscodeResult::Skipped)
+		{
+			std::cout << "Skipped : " << textures[i] << "\n";
+			skipCount++;
+		}
+		else
+		{
+			std::cout << "Failed : " << textures[i] << "\n";
+			failCount++;
+		}
+	}
+	std::cout << textures.size() - skipCount - failCount << " / " << textures.size() << " textures";
+	if (skipCount != 0)
+	{
+		std::cout << ", " << skipCount << " skipped";
+	}
+	std::cout << " (" << elapsed * 1000.0 << " ms)\n";
+	return failCount == 0;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> args(argv, argv + argc);
+	if (!MMDTex(args))
+	{
+		return 1;
+	}
+	return 0;
+}
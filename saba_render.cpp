@@ -0,0 +1,553 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+/*
+	ウィンドウを作らずに MMD モデルを描画し、連番画像か RAW 映像として書き出す.
+
+	saba_render -model <pmx/pmd> [-motion <vmd>] [-model ...]
+		[-size 1280x720] [-fps 30] [-frames N | -duration sec] [-msaa 4] [-shadow 1024]
+		[-bg r,g,b] [-resource dir] [-cache 0|1|share] [-textureCompress 0|1] (-out frames/%05d.png | -raw <file or ->)
+
+	-motion は直前の -model に設定する.
+	-raw は上の行から並べた RGBA をそのまま書き出す. (ffmpeg -f rawvideo -pix_fmt rgba -s WxH -r fps -i -)
+	-cache 1 は PMX の変換済みキャッシュとデコード済みのテクスチャをモデルの隣に保存し、次回から読み込む.
+	-cache share は PMX の変換済みキャッシュをマップしたまま参照するので、
+	同じモデルを読み込む複数のプロセスで頂点データなどのメモリを共有する.
+	-textureCompress 1 はテクスチャをミップマップ付きの BC1 / BC3 に変換して <texture>.saba.dds に保存し、それを使う.
+	EGL (Mesa の surfaceless プラットフォーム) でコンテキストを作るので GPU が無くても llvmpipe で動作する.
+*/
+
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <GL/gl3w.h>
+
+#include <Saba/Base/Log.h>
+#include <Saba/Base/Singleton.h>
+#include <Saba/Base/ThreadPool.h>
+#include <Saba/Base/Time.h>
+#include <Saba/Viewer/OffscreenRenderer.h>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include <spdlog/sinks/stdout_sinks.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <string>
+#include <vector>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+namespace
+{
+	struct RenderParameter
+	{
+		struct Input
+		{
+			bool		m_motion;
+			std::string	m_filepath;
+		};
+		std::vector<Input>	m_inputs;
+		saba::OffscreenRenderer::InitializeParameter	m_initParam;
+		double		m_fps = 30.0;
+		int			m_frames = 0;		//!< 0 : VMD の長さ
+		double		m_duration = 0.0;
+		glm::vec3	m_bgColor = glm::vec3(1.0f);
+		std::string	m_outputPath;		//!< 連番画像 (printf 形式)
+		std::string	m_rawPath;			//!< RAW 映像 ("-" : 標準出力)
+	};
+
+	// snprintf に渡すので、変換指定は %d か %0Nd の 1 つだけ許す (%% は可)
+	bool IsValidFramePathFormat(const std::string& format)
+	{
+		bool found = false;
+		for (size_t i = 0; i < format.size(); i++)
+		{
+			if (format[i] != '%')
+			{
+				continue;
+			}
+			i++;
+			if (i < format.size() && format[i] == '%')
+			{
+				continue;
+			}
+			if (found)
+			{
+				return false;
+			}
+			if (i < format.size() && format[i] == '0')
+			{
+				i++;
+				size_t digitBegin = i;
+				while (i < format.size() && format[i] >= '0' && format[i] <= '9')
+				{
+					i++;
+				}
+				if (i == digitBegin || i - digitBegin > 2)
+				{
+					return false;
+				}
+			}
+			if (i >= format.size() || format[i] != 'd')
+			{
+				return false;
+			}
+			found = true;
+		}
+		return found;
+	}
+
+	bool ParseArgs(int argc, char** argv, RenderParameter* param)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc)
+			{
+				SABA_ERROR("Missing value. [{}]", arg);
+				return false;
+			}
+			std::string value = argv[++i];
+			try
+			{
+				if (arg == "-model" || arg == "-motion")
+				{
+					param->m_inputs.push_back(RenderParameter::Input{ arg == "-motion", value });
+				}
+				else if (arg == "-size")
+				{
+					if (sscanf(value.c_str(), "%dx%d", &param->m_initParam.m_width, &param->m_initParam.m_height) != 2)
+					{
+						SABA_ERROR("Invalid size. [{}]", value);
+						return false;
+					}
+				}
+				else if (arg == "-fps")
+				{
+					param->m_fps = std::stod(value);
+				}
+				else if (arg == "-frames")
+				{
+					param->m_frames = std::stoi(value);
+				}
+				else if (arg == "-duration")
+				{
+					param->m_duration = std::stod(value);
+				}
+				else if (arg == "-msaa")
+				{
+					param->m_initParam.m_msaaCount = std::stoi(value);
+				}
+				else if (arg == "-shadow")
+				{
+					param->m_initParam.m_shadowMapSize = std::stoi(value);
+				}
+				else if (arg == "-bg")
+				{
+					auto& bg = param->m_bgColor;
+					if (sscanf(value.c_str(), "%f,%f,%f", &bg.r, &bg.g, &bg.b) != 3)
+					{
+						SABA_ERROR("Invalid color. [{}]", value);
+						return false;
+					}
+				}
+				else if (arg == "-resource")
+				{
+					param->m_initParam.m_resourceDir = value;
+				}
+				else if (arg == "-cache")
+				{
+					if (value != "0" && value != "1" && value != "share")
+					{
+						SABA_ERROR("Invalid value. [{} {}] Use 0, 1 or share.", arg, value);
+						return false;
+					}
+					param->m_initParam.m_modelCache = value != "0";
+					param->m_initParam.m_shareModelCache = value == "share";
+					param->m_initParam.m_textureDiskCache = param->m_initParam.m_modelCache;
+				}
+				else if (arg == "-textureCompress")
+				{
+					param->m_initParam.m_textureCompression = std::stoi(value) != 0;
+				}
+				else if (arg == "-out")
+				{
+					param->m_outputPath = value;
+				}
+				else if (arg == "-raw")
+				{
+					param->m_rawPath = value;
+				}
+				else
+				{
+					SABA_ERROR("Unknown arg. [{}]", arg);
+					return false;
+				}
+			}
+			catch (std::exception& e)
+			{
+				SABA_ERROR("Invalid value. [{} {}] {}", arg, value, e.what());
+				return false;
+			}
+		}
+
+		if (param->m_inputs.empty() || param->m_inputs[0].m_motion)
+		{
+			SABA_ERROR("-model is required.");
+			return false;
+		}
+		if (param->m_outputPath.empty() == param->m_rawPath.empty())
+		{
+			SABA_ERROR("Specify either -out or -raw.");
+			return false;
+		}
+		if (!param->m_outputPath.empty() && !IsValidFramePathFormat(param->m_outputPath))
+		{
+			SABA_ERROR("Invalid -out. Use one %d or %0Nd for the frame number. [{}]", param->m_outputPath);
+			return false;
+		}
+		if (param->m_fps <= 0.0)
+		{
+			SABA_ERROR("Invalid fps. [{}]", param->m_fps);
+			return false;
+		}
+		return true;
+	}
+
+	class HeadlessContext
+	{
+	public:
+		~HeadlessContext()
+		{
+			if (m_display != EGL_NO_DISPLAY)
+			{
+				eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+				if (m_surface != EGL_NO_SURFACE)
+				{
+					eglDestroySurface(m_display, m_surface);
+				}
+				if (m_context != EGL_NO_CONTEXT)
+				{
+					eglDestroyContext(m_display, m_context);
+				}
+				eglTerminate(m_display);
+			}
+		}
+
+		bool Create()
+		{
+			// surfaceless プラットフォームが使えない場合は既定のディスプレイを使う
+			auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+			if (getPlatformDisplay != nullptr)
+			{
+				m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+			}
+			if (m_display == EGL_NO_DISPLAY)
+			{
+				m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+			}
+			EGLint major, minor;
+			if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, &major, &minor))
+			{
+				SABA_ERROR("Failed to initialize EGL display.");
+				m_display = EGL_NO_DISPLAY;
+				return false;
+			}
+			SABA_INFO("EGL {}.{} [{}]", major, minor, eglQueryString(m_display, EGL_VENDOR));
+
+			if (!eglBindAPI(EGL_OPENGL_API))
+			{
+				SABA_ERROR("Failed to bind OpenGL API.");
+				return false;
+			}
+
+			const EGLint configAttribs[] = {
+				EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+				EGL_RED_SIZE, 8,
+				EGL_GREEN_SIZE, 8,
+				EGL_BLUE_SIZE, 8,
+				EGL_NONE
+			};
+			EGLConfig config;
+			EGLint configCount = 0;
+			if (!eglChooseConfig(m_display, configAttribs, &config, 1, &configCount) || configCount == 0)
+			{
+				SABA_ERROR("Failed to choose EGL config.");
+				return false;
+			}
+
+			const EGLint contextAttribs[] = {
+				EGL_CONTEXT_MAJOR_VERSION, 3,
+				EGL_CONTEXT_MINOR_VERSION, 2,
+				EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+				EGL_NONE
+			};
+			m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, contextAttribs);
+			if (m_context == EGL_NO_CONTEXT)
+			{
+				SABA_ERROR("Failed to create EGL context.");
+				return false;
+			}
+
+			// 描画先は FBO なので、surfaceless が使えない場合だけ 1x1 の pbuffer を作る
+			if (!eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context))
+			{
+				const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+				m_surface = eglCreatePbufferSurface(m_display, config, pbufferAttribs);
+				if (m_surface == EGL_NO_SURFACE ||
+					!eglMakeCurrent(m_display, m_surface, m_surface, m_context))
+				{
+					SABA_ERROR("Failed to make EGL context current.");
+					return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		EGLDisplay	m_display = EGL_NO_DISPLAY;
+		EGLSurface	m_surface = EGL_NO_SURFACE;
+		EGLContext	m_context = EGL_NO_CONTEXT;
+	};
+
+	/*
+		連番画像の書き出し.
+		PNG のエンコードはスレッドプールで行い、描画と並行させる.
+	*/
+	class ImageSequenceWriter
+	{
+	public:
+		explicit ImageSequenceWriter(const std::string& pathFormat)
+			: m_pathFormat(pathFormat)
+			, m_maxPendingCount(std::max(saba::Singleton<saba::ThreadPool>::Get()->GetThreadCount() * 2, size_t(1)))
+			, m_success(true)
+		{
+		}
+
+		void Write(const uint8_t* rgba, int width, int height, size_t frame)
+		{
+			while (m_pending.size() >= m_maxPendingCount)
+			{
+				Wait();
+			}
+
+			// 上の行から並べる
+			auto image = std::make_shared<std::vector<uint8_t>>(size_t(width) * size_t(height) * 4);
+			size_t stride = size_t(width) * 4;
+			for (int y = 0; y < height; y++)
+			{
+				memcpy(image->data() + stride * y, rgba + stride * (height - y - 1), stride);
+			}
+
+			char path[1024];
+			snprintf(path, sizeof(path), m_pathFormat.c_str(), int(frame));
+			std::string filepath = path;
+			auto pool = saba::Singleton<saba::ThreadPool>::Get();
+			m_pending.emplace_back(pool->Enqueue([image, filepath, width, height, stride]()
+			{
+				if (stbi_write_png(filepath.c_str(), width, height, 4, image->data(), int(stride)) == 0)
+				{
+					SABA_WARN("Failed to write image. [{}]", filepath);
+					return false;
+				}
+				return true;
+			}));
+		}
+
+		bool Finish()
+		{
+			while (!m_pending.empty())
+			{
+				Wait();
+			}
+			return m_success;
+		}
+
+	private:
+		void Wait()
+		{
+			m_success = m_pending.front().get() && m_success;
+			m_pending.pop_front();
+		}
+
+	private:
+		std::string		m_pathFormat;
+		size_t			m_maxPendingCount;
+		std::deque<std::future<bool>>	m_pending;
+		bool			m_success;
+	};
+
+	class RawVideoWriter
+	{
+	public:
+		RawVideoWriter()
+			: m_fp(nullptr)
+			, m_success(true)
+		{
+		}
+
+		~RawVideoWriter()
+		{
+			Close();
+		}
+
+		bool Open(const std::string& filepath)
+		{
+			m_fp = filepath == "-" ? stdout : fopen(filepath.c_str(), "wb");
+			if (m_fp == nullptr)
+			{
+				SABA_ERROR("Failed to open. [{}]", filepath);
+				return false;
+			}
+			return true;
+		}
+
+		void Write(const uint8_t* rgba, int width, int height)
+		{
+			size_t stride = size_t(width) * 4;
+			for (int y = height - 1; y >= 0; y--)
+			{
+				if (fwrite(rgba + stride * y, 1, stride, m_fp) != stride)
+				{
+					m_success = false;
+				}
+			}
+		}
+
+		bool Close()
+		{
+			if (m_fp != nullptr)
+			{
+				fflush(m_fp);
+				if (m_fp != stdout)
+				{
+					fclose(m_fp);
+				}
+				m_fp = nullptr;
+			}
+			return m_success;
+		}
+
+	private:
+		FILE*	m_fp;
+		bool	m_success;
+	};
+
+	int Render(const RenderParameter& param)
+	{
+		HeadlessContext headlessContext;
+		if (!headlessContext.Create())
+		{
+			return -1;
+		}
+		// gl3w は libGL.so.1 から関数を取得する. (libglvnd なら EGL のコンテキストでも使える)
+		if (gl3wInit() != 0 || !gl3wIsSupported(3, 2))
+		{
+			SABA_ERROR("Failed to initialize gl3w.");
+			return -1;
+		}
+		SABA_INFO("GL Renderer : {}", (const char*)glGetString(GL_RENDERER));
+
+		saba::OffscreenRenderer renderer;
+		if (!renderer.Initialize(param.m_initParam))
+		{
+			return -1;
+		}
+		renderer.SetFPS(param.m_fps);
+		renderer.SetBGColor(param.m_bgColor);
+		for (const auto& input : param.m_inputs)
+		{
+			bool loaded = input.m_motion ?
+				renderer.LoadAnimation(input.m_filepath) :
+				renderer.LoadModel(input.m_filepath);
+			if (!loaded)
+			{
+				SABA_ERROR("Failed to load. [{}]", input.m_filepath);
+				renderer.Uninitialize();
+				return -1;
+			}
+		}
+
+		size_t frameCount = size_t(param.m_frames);
+		if (frameCount == 0)
+		{
+			double duration = param.m_duration > 0.0 ? param.m_duration : renderer.GetAnimationLength();
+			frameCount = size_t(duration * param.m_fps) + 1;
+		}
+
+		ImageSequenceWriter imageWriter(param.m_outputPath);
+		RawVideoWriter rawWriter;
+		bool raw = !param.m_rawPath.empty();
+		if (raw)
+		{
+			if (!rawWriter.Open(param.m_rawPath))
+			{
+				renderer.Uninitialize();
+				return -1;
+			}
+			renderer.SetFrameCallback([&rawWriter](const uint8_t* rgba, int w, int h, size_t)
+			{
+				rawWriter.Write(rgba, w, h);
+			});
+		}
+		else
+		{
+			renderer.SetFrameCallback([&imageWriter](const uint8_t* rgba, int w, int h, size_t frame)
+			{
+				imageWriter.Write(rgba, w, h, frame);
+			});
+		}
+
+		SABA_INFO("Render {} frames ({} x {}, {} fps)",
+			frameCount, param.m_initParam.m_width, param.m_initParam.m_height, param.m_fps);
+		double startTime = saba::GetTime();
+		for (size_t frame = 0; frame < frameCount; frame++)
+		{
+			renderer.RenderFrame();
+		}
+		renderer.Finish();
+		bool success = raw ? rawWriter.Close() : imageWriter.Finish();
+		double renderTime = saba::GetTime() - startTime;
+		SABA_INFO("Render time : {} s ({} ms / frame)", renderTime, renderTime * 1000.0 / double(frameCount));
+
+		renderer.Uninitialize();
+		return success ? 0 : -1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	RenderParameter param;
+	if (!ParseArgs(argc, argv, &param))
+	{
+		return -1;
+	}
+
+	if (param.m_rawPath == "-")
+	{
+		// 標準出力は映像に使うので、ログは標準エラーに出す
+		auto logger = saba::Singleton<saba::Logger>::Get();
+		auto sinks = logger->GetLogger()->sinks();
+		for (const auto& sink : sinks)
+		{
+			logger->RemoveSink(sink.get());
+		}
+		logger->AddSink<spdlog::sinks::stderr_sink_mt>();
+	}
+
+	auto ret = Render(param);
+	saba::SingletonFinalizer::Finalize();
+	return ret;
+}
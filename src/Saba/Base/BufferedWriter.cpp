@@ -0,0 +1,228 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "BufferedWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace saba
+{
+	BufferedWriter::BufferedWriter(size_t bufferSize)
+		: m_open(false)
+		, m_null(false)
+		, m_badFlag(false)
+		, m_buffer(bufferSize < 64 ? 64 : bufferSize)
+		, m_bufferPos(0)
+		, m_writtenSize(0)
+	{
+	}
+
+	BufferedWriter::~BufferedWriter()
+	{
+		Close();
+	}
+
+	bool BufferedWriter::Open(const std::string & filepath)
+	{
+		Close();
+		if (!m_file.Create(filepath))
+		{
+			return false;
+		}
+		m_open = true;
+		m_null = false;
+		m_badFlag = false;
+		m_bufferPos = 0;
+		m_writtenSize = 0;
+		return true;
+	}
+
+	void BufferedWriter::OpenNull()
+	{
+		Close();
+		m_open = true;
+		m_null = true;
+		m_badFlag = false;
+		m_bufferPos = 0;
+		m_writtenSize = 0;
+	}
+
+	bool BufferedWriter::Close()
+	{
+		if (!m_open)
+		{
+			return !m_badFlag;
+		}
+		Flush();
+		if (!m_null)
+		{
+			m_badFlag = m_badFlag || m_file.IsBad();
+			m_file.Close();
+		}
+		m_open = false;
+		return !m_badFlag;
+	}
+
+	bool BufferedWriter::Flush()
+	{
+		if (m_bufferPos != 0 && !m_null)
+		{
+			if (!m_file.Write(m_buffer.data(), m_bufferPos))
+			{
+				m_badFlag = true;
+			}
+		}
+		m_bufferPos = 0;
+		return !m_badFlag;
+	}
+
+	void BufferedWriter::Write(const void * data, size_t size)
+	{
+		m_writtenSize += size;
+		const char* src = (const char*)data;
+		while (size != 0)
+		{
+			if (m_bufferPos == m_buffer.size())
+			{
+				Flush();
+			}
+			size_t copySize = std::min(size, m_buffer.size() - m_bufferPos);
+			memcpy(m_buffer.data() + m_bufferPos, src, copySize);
+			m_bufferPos += copySize;
+			src += copySize;
+			size -= copySize;
+		}
+	}
+
+	void BufferedWriter::WriteChar(char ch)
+	{
+		if (m_bufferPos == m_buffer.size())
+		{
+			Flush();
+		}
+		m_buffer[m_bufferPos] = ch;
+		m_bufferPos++;
+		m_writtenSize++;
+	}
+
+	void BufferedWriter::WriteString(const char * str)
+	{
+		Write(str, strlen(str));
+	}
+
+	void BufferedWriter::WriteString(const std::string & str)
+	{
+		Write(str.c_str(), str.size());
+	}
+
+	void BufferedWriter::WriteUInt(uint32_t value)
+	{
+		char buf[16];
+		size_t len = FormatUInt(buf, value);
+		Write(buf, len);
+	}
+
+	void BufferedWriter::WriteFloat(float value)
+	{
+		char buf[32];
+		size_t len = FormatFloat(buf, value);
+		Write(buf, len);
+	}
+
+	namespace
+	{
+		const double Pow10Table[] = {
+			1.0, 1.0e1, 1.0e2, 1.0e3, 1.0e4,
+			1.0e5, 1.0e6, 1.0e7, 1.0e8, 1.0e9,
+		};
+
+		const uint64_t UPow10Table[] = {
+			1ull, 10ull, 100ull, 1000ull, 10000ull,
+			100000ull, 1000000ull, 10000000ull, 100000000ull, 1000000000ull,
+		};
+
+		size_t FormatUInt64(char* buffer, uint64_t value)
+		{
+			char tmp[24];
+			size_t len = 0;
+			do
+			{
+				tmp[len] = char('0' + value % 10);
+				value /= 10;
+				len++;
+			} while (value != 0);
+			for (size_t i = 0; i < len; i++)
+			{
+				buffer[i] = tmp[len - i - 1];
+			}
+			buffer[len] = '\0';
+			return len;
+		}
+	}
+
+	size_t FormatUInt(char * buffer, uint32_t value)
+	{
+		return FormatUInt64(buffer, value);
+	}
+
+	size_t FormatFloat(char * buffer, float value)
+	{
+		const double absValue = std::fabs(double(value));
+
+		// %g が固定小数点で表記する範囲 [1e-4, 1e6) 以外は snprintf に任せる
+		if (!std::isfinite(value) ||
+			(absValue != 0.0 && (absValue < 1.0e-4 || absValue >= 999999.5)))
+		{
+			int len = snprintf(buffer, 32, "%g", value);
+			return len < 0 ? 0 : size_t(len);
+		}
+
+		size_t pos = 0;
+		if (std::signbit(value))
+		{
+			buffer[pos++] = '-';
+		}
+		if (absValue == 0.0)
+		{
+			buffer[pos++] = '0';
+			buffer[pos] = '\0';
+			return pos;
+		}
+
+		// 有効桁数 6 桁になるように小数点以下の桁数を決める
+		// exponent = floor(log10(absValue)) (-4 - 5)
+		int exponent = -4;
+		while (exponent < 5 && absValue >= Pow10Table[exponent + 5] * 1.0e-4)
+		{
+			exponent++;
+		}
+		int decimals = 5 - exponent;
+
+		uint64_t scaled = uint64_t(absValue * Pow10Table[decimals] + 0.5);
+		uint64_t intPart = scaled / UPow10Table[decimals];
+		uint64_t fracPart = scaled % UPow10Table[decimals];
+
+		pos += FormatUInt64(buffer + pos, intPart);
+		if (fracPart != 0)
+		{
+			buffer[pos++] = '.';
+			for (int i = decimals - 1; i >= 0; i--)
+			{
+				buffer[pos + i] = char('0' + fracPart % 10);
+				fracPart /= 10;
+			}
+			pos += decimals;
+			while (buffer[pos - 1] == '0')
+			{
+				pos--;
+			}
+		}
+		buffer[pos] = '\0';
+		return pos;
+	}
+}
@@ -0,0 +1,81 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_BASE_BUFFEREDWRITER_H_
+#define SABA_BASE_BUFFEREDWRITER_H_
+
+#include "File.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace saba
+{
+	/*
+		バッファリングしてファイルに書き込む.
+		OpenNull で開いた場合は書き込んだサイズだけを数える. (ベンチマーク用)
+		バイナリ値はホストのバイトオーダー (リトルエンディアン前提) で書き込む.
+	*/
+	class BufferedWriter
+	{
+	public:
+		explicit BufferedWriter(size_t bufferSize = 1024 * 1024);
+		~BufferedWriter();
+
+		BufferedWriter(const BufferedWriter&) = delete;
+		BufferedWriter& operator = (const BufferedWriter&) = delete;
+
+		bool Open(const std::string& filepath);
+		void OpenNull();
+		bool Close();
+		bool IsOpen() const { return m_open; }
+		bool IsBad() const { return m_badFlag; }
+
+		void Write(const void* data, size_t size);
+
+		template <typename T>
+		void WriteValue(const T& value)
+		{
+			Write(&value, sizeof(T));
+		}
+
+		template <typename T>
+		void WriteArray(const T* values, size_t count)
+		{
+			Write(values, sizeof(T) * count);
+		}
+
+		// テキスト出力
+		void WriteChar(char ch);
+		void WriteString(const char* str);
+		void WriteString(const std::string& str);
+		void WriteUInt(uint32_t value);
+		void WriteFloat(float value);
+
+		bool Flush();
+
+		uint64_t GetWrittenSize() const { return m_writtenSize; }
+
+	private:
+		File				m_file;
+		bool				m_open;
+		bool				m_null;
+		bool				m_badFlag;
+		std::vector<char>	m_buffer;
+		size_t				m_bufferPos;
+		uint64_t			m_writtenSize;
+	};
+
+	/*
+		%g (6 桁) と同じ表記で float を文字列にする.
+		固定小数点で表せる範囲は snprintf を使わずに変換する.
+		buffer には 32 文字以上必要. 戻り値は書き込んだ文字数 (終端を含まない).
+	*/
+	size_t FormatFloat(char* buffer, float value);
+	size_t FormatUInt(char* buffer, uint32_t value);
+}
+
+#endif // !SABA_BASE_BUFFEREDWRITER_H_
@@ -8,6 +8,15 @@
 
 #include <iterator>
 
+#if _WIN32
+#include <Windows.h>
+#else // _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
 namespace saba
 {
 	File::File()
@@ -332,5 +341,159 @@ namespace saba
 		}
 		return m_file.IsEOF();
 	}
-}
 
+	MappedFile::MappedFile()
+		: m_isOpen(false)
+		, m_data(nullptr)
+		, m_size(0)
+#if _WIN32
+		, m_fileHandle(nullptr)
+		, m_mappingHandle(nullptr)
+#endif // _WIN32
+	{
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	bool MappedFile::Open(const char* filepath)
+	{
+		Close();
+#if _WIN32
+		std::wstring wFilepath;
+		if (!TryToWString(filepath, wFilepath))
+		{
+			return false;
+		}
+		HANDLE fileHandle = CreateFileW(
+			wFilepath.c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_DELETE,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL,
+			nullptr
+		);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(fileHandle, &fileSize))
+		{
+			CloseHandle(fileHandle);
+			return false;
+		}
+		m_fileHandle = fileHandle;
+		m_size = size_t(fileSize.QuadPart);
+		if (m_size != 0)
+		{
+			m_mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (m_mappingHandle == nullptr)
+			{
+				Close();
+				return false;
+			}
+			m_data = (const uint8_t*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+			if (m_data == nullptr)
+			{
+				Close();
+				return false;
+			}
+		}
+#else // _WIN32
+		int fd = open(filepath, O_RDONLY);
+		if (fd == -1)
+		{
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0)
+		{
+			close(fd);
+			return false;
+		}
+		m_size = size_t(st.st_size);
+		if (m_size != 0)
+		{
+			void* data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+			if (data == MAP_FAILED)
+			{
+				close(fd);
+				m_size = 0;
+				return false;
+			}
+			m_data = (const uint8_t*)data;
+		}
+		// マップした領域はファイルを閉じても有効
+		close(fd);
+#endif // _WIN32
+		m_isOpen = true;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+#if _WIN32
+		if (m_data != nullptr)
+		{
+			UnmapViewOfFile(m_data);
+		}
+		if (m_mappingHandle != nullptr)
+		{
+			CloseHandle(m_mappingHandle);
+			m_mappingHandle = nullptr;
+		}
+		if (m_fileHandle != nullptr)
+		{
+			CloseHandle(m_fileHandle);
+			m_fileHandle = nullptr;
+		}
+#else // _WIN32
+		if (m_data != nullptr)
+		{
+			munmap((void*)m_data, m_size);
+		}
+#endif // _WIN32
+		m_data = nullptr;
+		m_size = 0;
+		m_isOpen = false;
+	}
+
+	bool GetFileStatus(const char* filepath, FileStatus* status)
+	{
+		if (status == nullptr)
+		{
+			return false;
+		}
+#if _WIN32
+		std::wstring wFilepath;
+		if (!TryToWString(filepath, wFilepath))
+		{
+			return false;
+		}
+		WIN32_FILE_ATTRIBUTE_DATA attr;
+		if (!GetFileAttributesExW(wFilepath.c_str(), GetFileExInfoStandard, &attr))
+		{
+			return false;
+		}
+		status->m_size = (int64_t(attr.nFileSizeHigh) << 32) | int64_t(attr.nFileSizeLow);
+		status->m_lastWriteTime = (int64_t(attr.ftLastWriteTime.dwHighDateTime) << 32) | int64_t(attr.ftLastWriteTime.dwLowDateTime);
+#else // _WIN32
+		struct stat st;
+		if (stat(filepath, &st) != 0)
+		{
+			return false;
+		}
+		status->m_size = int64_t(st.st_size);
+#if __APPLE__
+		status->m_lastWriteTime = int64_t(st.st_mtimespec.tv_sec) * 1000000000 + int64_t(st.st_mtimespec.tv_nsec);
+#else // __APPLE__
+		status->m_lastWriteTime = int64_t(st.st_mtim.tv_sec) * 1000000000 + int64_t(st.st_mtim.tv_nsec);
+#endif // __APPLE__
+#endif // _WIN32
+		return true;
+	}
+}
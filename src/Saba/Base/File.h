@@ -134,6 +134,46 @@ namespace saba
 	private:
 		saba::File	m_file;
 	};
+
+	/*
+		読み込み専用でメモリにマップする.
+		同じファイルをマップしたプロセス同士はページキャッシュを共有する.
+	*/
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator = (const MappedFile&) = delete;
+
+		bool Open(const char* filepath);
+		bool Open(const std::string& filepath) { return Open(filepath.c_str()); }
+		void Close();
+		bool IsOpen() const { return m_isOpen; }
+
+		const uint8_t* GetData() const { return m_data; }
+		size_t GetSize() const { return m_size; }
+
+	private:
+		bool			m_isOpen;
+		const uint8_t*	m_data;
+		size_t			m_size;
+#if _WIN32
+		void*			m_fileHandle;
+		void*			m_mappingHandle;
+#endif // _WIN32
+	};
+
+	struct FileStatus
+	{
+		int64_t	m_size;
+		int64_t	m_lastWriteTime;	//!< 比較にのみ使う (単位は環境による)
+	};
+
+	bool GetFileStatus(const char* filepath, FileStatus* status);
+	inline bool GetFileStatus(const std::string& filepath, FileStatus* status) { return GetFileStatus(filepath.c_str(), status); }
 }
 
 #endif // !BASE_FILE_H_
@@ -0,0 +1,139 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "NumberParser.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+namespace saba
+{
+	const char* ParseInt(const char* first, const char* last, int* value)
+	{
+		const char* p = first;
+		bool negative = false;
+		if (p != last && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			p++;
+		}
+		if (p == last || !IsDigit(*p))
+		{
+			return nullptr;
+		}
+		const int64_t limit = int64_t(std::numeric_limits<int>::max()) + (negative ? 1 : 0);
+		int64_t result = 0;
+		while (p != last && IsDigit(*p))
+		{
+			result = result * 10 + (*p - '0');
+			if (result > limit)
+			{
+				return nullptr;
+			}
+			p++;
+		}
+		*value = int(negative ? -result : result);
+		return p;
+	}
+
+	const char* ParseFloat(const char* first, const char* last, float* value)
+	{
+		const char* p = first;
+		bool negative = false;
+		if (p != last && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			p++;
+		}
+
+		// 19 桁までは整数で受け取り、最後に 10 のべき乗で割る
+		uint64_t mantissa = 0;
+		int digitCount = 0;
+		int exponent = 0;
+		bool hasDigit = false;
+		while (p != last && IsDigit(*p))
+		{
+			if (digitCount < 19)
+			{
+				mantissa = mantissa * 10 + uint64_t(*p - '0');
+				digitCount += mantissa != 0 ? 1 : 0;
+			}
+			else
+			{
+				exponent++;
+			}
+			hasDigit = true;
+			p++;
+		}
+		if (p != last && *p == '.')
+		{
+			p++;
+			while (p != last && IsDigit(*p))
+			{
+				if (digitCount < 19)
+				{
+					mantissa = mantissa * 10 + uint64_t(*p - '0');
+					digitCount += mantissa != 0 ? 1 : 0;
+					exponent--;
+				}
+				hasDigit = true;
+				p++;
+			}
+		}
+		if (!hasDigit)
+		{
+			return nullptr;
+		}
+		if (p != last && (*p == 'e' || *p == 'E'))
+		{
+			const char* expPos = p + 1;
+			bool expNegative = false;
+			if (expPos != last && (*expPos == '-' || *expPos == '+'))
+			{
+				expNegative = *expPos == '-';
+				expPos++;
+			}
+			if (expPos != last && IsDigit(*expPos))
+			{
+				int exp = 0;
+				while (expPos != last && IsDigit(*expPos))
+				{
+					exp = std::min(exp * 10 + (*expPos - '0'), 10000);
+					expPos++;
+				}
+				exponent += expNegative ? -exp : exp;
+				p = expPos;
+			}
+		}
+
+		static const double pow10[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+			1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+		};
+		double result;
+		if (mantissa == 0)
+		{
+			result = 0.0;
+		}
+		else if (-22 <= exponent && exponent <= 22)
+		{
+			result = exponent < 0 ?
+				double(mantissa) / pow10[-exponent] :
+				double(mantissa) * pow10[exponent];
+		}
+		else
+		{
+			// 桁の大きい値はめったに無いので strtod に任せる
+			std::string str(first, p);
+			result = std::strtod(str.c_str(), nullptr);
+			negative = false;
+		}
+		*value = float(negative ? -result : result);
+		return p;
+	}
+}
@@ -0,0 +1,25 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_BASE_NUMBERPARSER_H_
+#define SABA_BASE_NUMBERPARSER_H_
+
+namespace saba
+{
+	/*
+		[first, last) の先頭から数値を読む (std::from_chars 相当).
+		前の空白は読み飛ばさない. 成功すると読み終えた位置、失敗すると nullptr を返す.
+		ロケールに依存せず、文字列を作らないので大きなテキストファイルの読み込みに使う.
+	*/
+	const char* ParseInt(const char* first, const char* last, int* value);
+	const char* ParseFloat(const char* first, const char* last, float* value);
+
+	inline bool IsDigit(char ch)
+	{
+		return '0' <= ch && ch <= '9';
+	}
+}
+
+#endif // !SABA_BASE_NUMBERPARSER_H_
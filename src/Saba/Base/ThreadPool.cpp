@@ -0,0 +1,132 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace saba
+{
+	ThreadPool::ThreadPool(size_t threadCount)
+		: m_stop(false)
+	{
+		if (threadCount == 0)
+		{
+			threadCount = std::thread::hardware_concurrency();
+			if (threadCount == 0)
+			{
+				threadCount = 1;
+			}
+		}
+
+		m_threads.reserve(threadCount);
+		for (size_t i = 0; i < threadCount; i++)
+		{
+			m_threads.emplace_back([this]() { Worker(); });
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_cv.notify_all();
+		for (auto& thread : m_threads)
+		{
+			thread.join();
+		}
+	}
+
+	void ThreadPool::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& func)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+		grainSize = std::max(grainSize, size_t(1));
+		const size_t chunkCount = (count + grainSize - 1) / grainSize;
+		if (chunkCount == 1)
+		{
+			func(0, count);
+			return;
+		}
+
+		// 遅れて開始したワーカーも参照するので共有する
+		struct State
+		{
+			std::atomic<size_t>	m_next;
+			std::atomic<size_t>	m_done;
+		};
+		auto state = std::make_shared<State>();
+		state->m_next = 0;
+		state->m_done = 0;
+		const std::function<void(size_t, size_t)>* funcPtr = &func;
+		auto run = [state, funcPtr, count, grainSize, chunkCount]()
+		{
+			size_t chunkIdx;
+			while ((chunkIdx = state->m_next.fetch_add(1)) < chunkCount)
+			{
+				size_t begin = chunkIdx * grainSize;
+				size_t end = std::min(begin + grainSize, count);
+				(*funcPtr)(begin, end);
+				state->m_done.fetch_add(1);
+			}
+		};
+
+		const size_t workerCount = std::min(m_threads.size(), chunkCount - 1);
+		for (size_t i = 0; i < workerCount; i++)
+		{
+			Push(run);
+		}
+		run();
+
+		// 実行中の分割が終わるのを待つ
+		while (state->m_done.load() < chunkCount)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	size_t ThreadPool::GetPendingTaskCount() const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_tasks.size();
+	}
+
+	void ThreadPool::Push(std::function<void()> task)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_tasks.emplace_back(std::move(task));
+		}
+		m_cv.notify_one();
+	}
+
+	void ThreadPool::Worker()
+	{
+		Trace::SetThreadName("ThreadPool Worker");
+
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cv.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+				// 終了時も積まれているタスクは実行しきる
+				if (m_tasks.empty())
+				{
+					return;
+				}
+				task = std::move(m_tasks.front());
+				m_tasks.pop_front();
+			}
+			task();
+		}
+	}
+}
@@ -0,0 +1,71 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_BASE_THREADPOOL_H_
+#define SABA_BASE_THREADPOOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace saba
+{
+	/*
+		固定数のワーカースレッドでタスクを実行する.
+		プロセス全体で共有する場合は Singleton<ThreadPool>::Get() を使う.
+		タスク内から同じプールのタスク完了を待つとデッドロックするので注意.
+	*/
+	class ThreadPool
+	{
+	public:
+		// threadCount が 0 の場合、ハードウェアスレッド数を使う
+		explicit ThreadPool(size_t threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator = (const ThreadPool&) = delete;
+
+		template <typename Func>
+		std::future<typename std::result_of<Func()>::type> Enqueue(Func&& func)
+		{
+			using ResultType = typename std::result_of<Func()>::type;
+			auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Func>(func));
+			auto future = task->get_future();
+			Push([task]() { (*task)(); });
+			return future;
+		}
+
+		/*
+			[0, count) を grainSize ごとに分割し func(begin, end) を並列に実行する.
+			呼び出したスレッドも処理に参加し、ワーカーが開始していない分割は呼び出し元が処理する.
+			そのため、プールが他のタスクで埋まっていても待たされない.
+		*/
+		void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& func);
+
+		size_t GetThreadCount() const { return m_threads.size(); }
+
+		// キューに積まれているが未実行のタスク数
+		size_t GetPendingTaskCount() const;
+
+	private:
+		void Push(std::function<void()> task);
+		void Worker();
+
+	private:
+		std::vector<std::thread>			m_threads;
+		std::deque<std::function<void()>>	m_tasks;
+		mutable std::mutex					m_mutex;
+		std::condition_variable				m_cv;
+		bool								m_stop;
+	};
+}
+
+#endif // !SABA_BASE_THREADPOOL_H_
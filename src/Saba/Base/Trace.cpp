@@ -0,0 +1,277 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "Trace.h"
+#include "BufferedWriter.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace saba
+{
+	std::atomic<bool> Trace::s_enabled(false);
+
+	namespace
+	{
+		struct TraceEvent
+		{
+			const char*	m_name;
+			uint64_t	m_begin;
+			uint64_t	m_end;
+		};
+
+		struct ThreadBuffer
+		{
+			std::mutex				m_mutex;
+			std::vector<TraceEvent>	m_events;
+			size_t					m_next = 0;		//!< 次に書き込む位置
+			size_t					m_count = 0;
+			uint32_t				m_threadID = 0;
+			std::string				m_threadName;
+			bool					m_inUse = false;
+		};
+
+		/*
+			終了したスレッドのバッファは次に記録を始めるスレッドが引き継ぐ.
+			(std::async のように毎回スレッドを作る場合でもバッファが増え続けないようにする)
+		*/
+		struct TraceRegistry
+		{
+			std::mutex									m_mutex;
+			std::vector<std::shared_ptr<ThreadBuffer>>	m_buffers;
+			std::atomic<size_t>							m_bufferSize{ 64 * 1024 };
+		};
+
+		TraceRegistry& GetRegistry()
+		{
+			static TraceRegistry registry;
+			return registry;
+		}
+
+		const std::chrono::steady_clock::time_point TraceBaseTime = std::chrono::steady_clock::now();
+
+		class ThreadBufferHolder
+		{
+		public:
+			~ThreadBufferHolder()
+			{
+				if (m_buffer != nullptr)
+				{
+					auto& registry = GetRegistry();
+					std::lock_guard<std::mutex> lock(registry.m_mutex);
+					m_buffer->m_inUse = false;
+				}
+			}
+
+			ThreadBuffer* Get()
+			{
+				if (m_buffer == nullptr)
+				{
+					auto& registry = GetRegistry();
+					std::lock_guard<std::mutex> lock(registry.m_mutex);
+					auto freeIt = std::find_if(
+						registry.m_buffers.begin(),
+						registry.m_buffers.end(),
+						[](const std::shared_ptr<ThreadBuffer>& buffer) { return !buffer->m_inUse; }
+					);
+					if (freeIt != registry.m_buffers.end())
+					{
+						m_buffer = *freeIt;
+						std::lock_guard<std::mutex> bufferLock(m_buffer->m_mutex);
+						m_buffer->m_threadName.clear();
+					}
+					else
+					{
+						m_buffer = std::make_shared<ThreadBuffer>();
+						m_buffer->m_threadID = uint32_t(registry.m_buffers.size() + 1);
+						registry.m_buffers.push_back(m_buffer);
+					}
+					m_buffer->m_inUse = true;
+				}
+				return m_buffer.get();
+			}
+
+		private:
+			std::shared_ptr<ThreadBuffer>	m_buffer;
+		};
+
+		ThreadBuffer* GetThreadBuffer()
+		{
+			thread_local ThreadBufferHolder holder;
+			return holder.Get();
+		}
+
+		void WriteJsonString(BufferedWriter& writer, const char* str)
+		{
+			writer.WriteChar('"');
+			for (const char* ch = str; *ch != '\0'; ch++)
+			{
+				if (*ch == '"' || *ch == '\\')
+				{
+					writer.WriteChar('\\');
+					writer.WriteChar(*ch);
+				}
+				else if ((unsigned char)(*ch) < 0x20)
+				{
+					writer.WriteChar(' ');
+				}
+				else
+				{
+					writer.WriteChar(*ch);
+				}
+			}
+			writer.WriteChar('"');
+		}
+
+		// ナノ秒をマイクロ秒 (小数点以下 3 桁) で書く
+		void WriteMicroSec(BufferedWriter& writer, uint64_t ns)
+		{
+			char buf[32];
+			int len = snprintf(buf, sizeof(buf), "%llu.%03u",
+				(unsigned long long)(ns / 1000), unsigned(ns % 1000));
+			writer.Write(buf, size_t(len));
+		}
+	}
+
+	void Trace::Enable(bool enable)
+	{
+		s_enabled.store(enable, std::memory_order_relaxed);
+	}
+
+	void Trace::SetBufferSize(size_t eventCount)
+	{
+		GetRegistry().m_bufferSize = std::max(eventCount, size_t(1));
+	}
+
+	void Trace::Clear()
+	{
+		auto& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.m_mutex);
+		for (auto& buffer : registry.m_buffers)
+		{
+			std::lock_guard<std::mutex> bufferLock(buffer->m_mutex);
+			buffer->m_next = 0;
+			buffer->m_count = 0;
+		}
+	}
+
+	size_t Trace::GetEventCount()
+	{
+		auto& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.m_mutex);
+		size_t count = 0;
+		for (auto& buffer : registry.m_buffers)
+		{
+			std::lock_guard<std::mutex> bufferLock(buffer->m_mutex);
+			count += buffer->m_count;
+		}
+		return count;
+	}
+
+	void Trace::SetThreadName(const std::string& name)
+	{
+		auto buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock(buffer->m_mutex);
+		buffer->m_threadName = name;
+	}
+
+	uint64_t Trace::GetTimestamp()
+	{
+		auto elapsed = std::chrono::steady_clock::now() - TraceBaseTime;
+		return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+	}
+
+	void Trace::AddEvent(const char* name, uint64_t begin, uint64_t end)
+	{
+		auto buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock(buffer->m_mutex);
+		if (buffer->m_events.empty())
+		{
+			// 実際に記録するまでバッファは確保しない
+			buffer->m_events.resize(GetRegistry().m_bufferSize);
+		}
+		buffer->m_events[buffer->m_next] = TraceEvent{ name, begin, end };
+		buffer->m_next = (buffer->m_next + 1) % buffer->m_events.size();
+		buffer->m_count = std::min(buffer->m_count + 1, buffer->m_events.size());
+	}
+
+	bool Trace::WriteChromeTrace(const std::string& filepath)
+	{
+		BufferedWriter writer;
+		if (!writer.Open(filepath))
+		{
+			SABA_WARN("Failed to open trace file. [{}]", filepath);
+			return false;
+		}
+
+		writer.WriteString("{\"traceEvents\":[\n");
+		bool first = true;
+		auto beginEvent = [&writer, &first]()
+		{
+			if (!first)
+			{
+				writer.WriteString(",\n");
+			}
+			first = false;
+		};
+
+		auto& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.m_mutex);
+		std::vector<TraceEvent> events;
+		for (auto& buffer : registry.m_buffers)
+		{
+			std::string threadName;
+			{
+				std::lock_guard<std::mutex> bufferLock(buffer->m_mutex);
+				size_t bufferSize = std::max(buffer->m_events.size(), size_t(1));
+				size_t start = (buffer->m_next + bufferSize - buffer->m_count) % bufferSize;
+				events.clear();
+				for (size_t i = 0; i < buffer->m_count; i++)
+				{
+					events.push_back(buffer->m_events[(start + i) % bufferSize]);
+				}
+				threadName = buffer->m_threadName;
+			}
+			if (threadName.empty())
+			{
+				threadName = "Thread " + std::to_string(buffer->m_threadID);
+			}
+
+			beginEvent();
+			writer.WriteString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+			writer.WriteUInt(buffer->m_threadID);
+			writer.WriteString(",\"args\":{\"name\":");
+			WriteJsonString(writer, threadName.c_str());
+			writer.WriteString("}}");
+
+			for (const auto& ev : events)
+			{
+				beginEvent();
+				writer.WriteString("{\"name\":");
+				WriteJsonString(writer, ev.m_name);
+				writer.WriteString(",\"ph\":\"X\",\"pid\":1,\"tid\":");
+				writer.WriteUInt(buffer->m_threadID);
+				writer.WriteString(",\"ts\":");
+				WriteMicroSec(writer, ev.m_begin);
+				writer.WriteString(",\"dur\":");
+				WriteMicroSec(writer, ev.m_end >= ev.m_begin ? ev.m_end - ev.m_begin : 0);
+				writer.WriteChar('}');
+			}
+		}
+		writer.WriteString("\n],\"displayTimeUnit\":\"ms\"}\n");
+
+		if (!writer.Close())
+		{
+			SABA_WARN("Failed to write trace file. [{}]", filepath);
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,78 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_BASE_TRACE_H_
+#define SABA_BASE_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace saba
+{
+	/*
+		区間の計測 (トレース)
+		SABA_TRACE_SCOPE("name") でスコープの開始と終了の時刻を記録する.
+		記録はスレッドごとのリングバッファに書き込み、一杯になると古いものから上書きする.
+		無効の場合、SABA_TRACE_SCOPE のコストはフラグの確認だけ.
+
+		name には文字列リテラルなど、WriteChromeTrace まで有効な文字列を渡すこと.
+	*/
+	class Trace
+	{
+	public:
+		static void Enable(bool enable);
+		static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+		// スレッドごとに保持するイベント数 (まだ記録していないバッファから適用する)
+		static void SetBufferSize(size_t eventCount);
+		static void Clear();
+		static size_t GetEventCount();
+
+		// 現在のスレッドの表示名
+		static void SetThreadName(const std::string& name);
+
+		// トレースの基準時刻からの経過時間 (ナノ秒)
+		static uint64_t GetTimestamp();
+		static void AddEvent(const char* name, uint64_t begin, uint64_t end);
+
+		// Chrome のトレース形式 (JSON) で書き出す. chrome://tracing や Perfetto で開ける.
+		static bool WriteChromeTrace(const std::string& filepath);
+
+	private:
+		static std::atomic<bool>	s_enabled;
+	};
+
+	class TraceScope
+	{
+	public:
+		explicit TraceScope(const char* name)
+			: m_name(Trace::IsEnabled() ? name : nullptr)
+			, m_begin(m_name != nullptr ? Trace::GetTimestamp() : 0)
+		{
+		}
+
+		~TraceScope()
+		{
+			if (m_name != nullptr)
+			{
+				Trace::AddEvent(m_name, m_begin, Trace::GetTimestamp());
+			}
+		}
+
+		TraceScope(const TraceScope&) = delete;
+		TraceScope& operator = (const TraceScope&) = delete;
+
+	private:
+		const char*	m_name;
+		uint64_t	m_begin;
+	};
+}
+
+#define SABA_TRACE_CONCAT_IMPL(a, b) a##b
+#define SABA_TRACE_CONCAT(a, b) SABA_TRACE_CONCAT_IMPL(a, b)
+#define SABA_TRACE_SCOPE(name) saba::TraceScope SABA_TRACE_CONCAT(sabaTraceScope, __LINE__)(name)
+
+#endif // !SABA_BASE_TRACE_H_
@@ -12,6 +12,8 @@
 #include "SjisToUnicode.h"
 
 #include <string>
+#include <cstring>
+#include <unordered_map>
 
 
 namespace saba
@@ -61,6 +63,49 @@ namespace saba
 		return file.Read(str->m_buffer, Size);
 	}
 
+	template <size_t Size>
+	bool Write(const MMDFileString<Size>& str, File& file)
+	{
+		return file.Write(str.m_buffer, Size);
+	}
+
+	/*
+		終端文字までの生のバイト列 (SJIS) で比較する.
+		同じ名前を何度も変換しないように、変換前の文字列をキーにする場合に使う.
+	*/
+	template <size_t Size>
+	struct MMDFileStringHash
+	{
+		size_t operator()(const MMDFileString<Size>& str) const
+		{
+			// FNV-1a
+			uint32_t hash = 2166136261u;
+			for (size_t i = 0; i < Size && str.m_buffer[i] != '\0'; i++)
+			{
+				hash ^= uint8_t(str.m_buffer[i]);
+				hash *= 16777619u;
+			}
+			return hash;
+		}
+	};
+
+	template <size_t Size>
+	struct MMDFileStringEqual
+	{
+		bool operator()(const MMDFileString<Size>& a, const MMDFileString<Size>& b) const
+		{
+			return strncmp(a.m_buffer, b.m_buffer, Size) == 0;
+		}
+	};
+
+	template <size_t Size, typename T>
+	using MMDFileStringMap = std::unordered_map<
+		MMDFileString<Size>,
+		T,
+		MMDFileStringHash<Size>,
+		MMDFileStringEqual<Size>
+	>;
+
 	template<size_t Size>
 	inline std::string MMDFileString<Size>::ToUtf8String() const
 	{
@@ -0,0 +1,591 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "MMDGenerator.h"
+
+#include <Saba/Base/Log.h>
+#include <Saba/Base/Trace.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+
+namespace saba
+{
+	namespace
+	{
+		const uint32_t CircleVertexCount = 32;
+		const float ModelHeight = 20.0f;
+		const float ModelRadius = 2.0f;
+		const float Pi = 3.14159265f;
+
+		// 頂点インデックスは符号なし
+		uint8_t GetVertexIndexSize(size_t count)
+		{
+			if (count < 0xFF)
+			{
+				return 1;
+			}
+			else if (count < 0xFFFF)
+			{
+				return 2;
+			}
+			return 4;
+		}
+
+		// 頂点以外のインデックスは符号付き (-1 はなし) なので、int8_t, int16_t に収まる数にする
+		uint8_t GetIndexSize(size_t count)
+		{
+			if (count <= 0x7F)
+			{
+				return 1;
+			}
+			else if (count <= 0x7FFF)
+			{
+				return 2;
+			}
+			return 4;
+		}
+
+		PMXBoneFlags MakeBoneFlags(bool ik)
+		{
+			uint16_t flags =
+				uint16_t(PMXBoneFlags::AllowRotate) |
+				uint16_t(PMXBoneFlags::AllowTranslate) |
+				uint16_t(PMXBoneFlags::Visible) |
+				uint16_t(PMXBoneFlags::AllowControl);
+			if (ik)
+			{
+				flags |= uint16_t(PMXBoneFlags::IK);
+			}
+			return PMXBoneFlags(flags);
+		}
+
+		PMXBone MakeBone(const std::string& name, const glm::vec3& position, int32_t parent)
+		{
+			PMXBone bone = {};
+			bone.m_name = name;
+			bone.m_englishName = name;
+			bone.m_position = position;
+			bone.m_parentBoneIndex = parent;
+			bone.m_deformDepth = 0;
+			bone.m_boneFlag = MakeBoneFlags(false);
+			bone.m_positionOffset = glm::vec3(0, -1, 0);
+			bone.m_linkBoneIndex = -1;
+			bone.m_appendBoneIndex = -1;
+			bone.m_ikTargetBoneIndex = -1;
+			return bone;
+		}
+
+		void GenerateBones(PMXFile* pmx, const PMXGenerateParam& param)
+		{
+			auto& bones = pmx->m_bones;
+			bones.push_back(MakeBone("center", glm::vec3(0, ModelHeight * 0.5f, 0), -1));
+
+			uint32_t legBoneCount = param.m_ikChainCount * 4;
+			uint32_t bodyCount = param.m_boneCount > legBoneCount + 1 ? param.m_boneCount - legBoneCount - 1 : 0;
+			for (uint32_t i = 0; i < bodyCount; i++)
+			{
+				float t = float(i) / float(bodyCount);
+				float angle = float(i) * 2.4f;
+				glm::vec3 pos(std::cos(angle) * ModelRadius * 0.5f, ModelHeight * (1.0f - t), std::sin(angle) * ModelRadius * 0.5f);
+				int32_t parent = i == 0 ? 0 : int32_t(1 + (i - 1) / 2);
+				bones.push_back(MakeBone("bone_" + std::to_string(i), pos, parent));
+			}
+
+			for (uint32_t ci = 0; ci < param.m_ikChainCount; ci++)
+			{
+				float x = (float(ci) - float(param.m_ikChainCount - 1) * 0.5f) * 0.5f;
+				std::string index = std::to_string(ci);
+				int32_t leg = int32_t(bones.size());
+				bones.push_back(MakeBone("leg_" + index, glm::vec3(x, 8.0f, 0), 0));
+				bones.push_back(MakeBone("knee_" + index, glm::vec3(x, 4.5f, -0.2f), leg));
+				bones.push_back(MakeBone("ankle_" + index, glm::vec3(x, 1.0f, 0), leg + 1));
+
+				PMXBone ik = MakeBone("legIK_" + index, glm::vec3(x, 1.0f, 0), 0);
+				ik.m_boneFlag = MakeBoneFlags(true);
+				ik.m_ikTargetBoneIndex = leg + 2;
+				ik.m_ikIterationCount = param.m_ikIterationCount;
+				ik.m_ikLimit = 2.0f;
+				// 膝は X 軸の回転だけに制限する
+				PMXIKLink knee = {};
+				knee.m_ikBoneIndex = leg + 1;
+				knee.m_enableLimit = 1;
+				knee.m_limitMin = glm::vec3(-Pi, 0, 0);
+				knee.m_limitMax = glm::vec3(-0.008f, 0, 0);
+				PMXIKLink thigh = {};
+				thigh.m_ikBoneIndex = leg;
+				thigh.m_enableLimit = 0;
+				ik.m_ikLinks.push_back(knee);
+				ik.m_ikLinks.push_back(thigh);
+				bones.push_back(ik);
+			}
+		}
+
+		void GenerateMesh(PMXFile* pmx, const PMXGenerateParam& param, std::mt19937& rand)
+		{
+			std::vector<int32_t> skinBones;
+			for (size_t bi = 0; bi < pmx->m_bones.size(); bi++)
+			{
+				if (((uint16_t)pmx->m_bones[bi].m_boneFlag & (uint16_t)PMXBoneFlags::IK) == 0)
+				{
+					skinBones.push_back(int32_t(bi));
+				}
+			}
+
+			float ratioSum = 0;
+			for (float ratio : param.m_weightRatio)
+			{
+				ratioSum += std::max(ratio, 0.0f);
+			}
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			auto selectWeightType = [&]()
+			{
+				if (ratioSum <= 0)
+				{
+					return PMXVertexWeight::BDEF2;
+				}
+				float r = unit(rand) * ratioSum;
+				for (int i = 0; i < 5; i++)
+				{
+					r -= std::max(param.m_weightRatio[i], 0.0f);
+					if (r < 0)
+					{
+						return PMXVertexWeight(i);
+					}
+				}
+				return PMXVertexWeight::BDEF1;
+			};
+
+			// 円柱状に並べる
+			uint32_t vertexCount = std::max(param.m_vertexCount, CircleVertexCount * 2);
+			uint32_t rowCount = vertexCount / CircleVertexCount;
+			pmx->m_vertices.resize(vertexCount);
+			for (uint32_t vi = 0; vi < vertexCount; vi++)
+			{
+				uint32_t col = vi % CircleVertexCount;
+				uint32_t row = vi / CircleVertexCount;
+				float u = float(col) / float(CircleVertexCount);
+				float v = float(row) / float(std::max(rowCount - 1, 1u));
+				float angle = u * 2.0f * Pi;
+				glm::vec3 normal(std::cos(angle), 0, std::sin(angle));
+
+				auto& vertex = pmx->m_vertices[vi];
+				vertex = {};
+				vertex.m_position = normal * ModelRadius + glm::vec3(0, ModelHeight * (1.0f - v), 0);
+				vertex.m_normal = normal;
+				vertex.m_uv = glm::vec2(u, v);
+				vertex.m_edgeMag = 1.0f;
+
+				size_t skinIdx = std::min(size_t(v * float(skinBones.size())), skinBones.size() - 1);
+				for (size_t i = 0; i < 4; i++)
+				{
+					vertex.m_boneIndices[i] = skinBones[(skinIdx + i) % skinBones.size()];
+				}
+
+				vertex.m_weightType = selectWeightType();
+				float w = unit(rand);
+				switch (vertex.m_weightType)
+				{
+				case PMXVertexWeight::BDEF1:
+					vertex.m_boneWeights[0] = 1.0f;
+					break;
+				case PMXVertexWeight::BDEF2:
+					vertex.m_boneWeights[0] = w;
+					break;
+				case PMXVertexWeight::BDEF4:
+				case PMXVertexWeight::QDEF:
+					vertex.m_boneWeights[0] = w * 0.5f;
+					vertex.m_boneWeights[1] = (1.0f - w) * 0.5f;
+					vertex.m_boneWeights[2] = 0.3f;
+					vertex.m_boneWeights[3] = 0.2f;
+					break;
+				case PMXVertexWeight::SDEF:
+				{
+					vertex.m_boneWeights[0] = w;
+					const auto& p0 = pmx->m_bones[vertex.m_boneIndices[0]].m_position;
+					const auto& p1 = pmx->m_bones[vertex.m_boneIndices[1]].m_position;
+					vertex.m_sdefC = (p0 + p1) * 0.5f;
+					vertex.m_sdefR0 = p0;
+					vertex.m_sdefR1 = p1;
+					break;
+				}
+				}
+			}
+
+			for (uint32_t row = 0; row + 1 < rowCount; row++)
+			{
+				for (uint32_t col = 0; col < CircleVertexCount; col++)
+				{
+					uint32_t v0 = row * CircleVertexCount + col;
+					uint32_t v1 = row * CircleVertexCount + (col + 1) % CircleVertexCount;
+					uint32_t v2 = v0 + CircleVertexCount;
+					uint32_t v3 = v1 + CircleVertexCount;
+					pmx->m_faces.push_back(PMXFace{ { v0, v2, v1 } });
+					pmx->m_faces.push_back(PMXFace{ { v1, v2, v3 } });
+				}
+			}
+
+			// 面を材質の数で等分する
+			uint32_t materialCount = std::max(param.m_materialCount, 1u);
+			size_t faceCount = pmx->m_faces.size();
+			for (uint32_t mi = 0; mi < materialCount; mi++)
+			{
+				size_t beginFace = faceCount * mi / materialCount;
+				size_t endFace = faceCount * (mi + 1) / materialCount;
+
+				PMXMaterial mat = {};
+				mat.m_name = "material_" + std::to_string(mi);
+				mat.m_englishName = mat.m_name;
+				float hue = float(mi) / float(materialCount);
+				mat.m_diffuse = glm::vec4(0.5f + 0.5f * std::cos(hue * 2.0f * Pi), 0.7f, 0.5f + 0.5f * std::sin(hue * 2.0f * Pi), 1.0f);
+				mat.m_specular = glm::vec3(0.1f);
+				mat.m_specularPower = 5.0f;
+				mat.m_ambient = glm::vec3(0.4f);
+				mat.m_drawMode = PMXDrawModeFlags(
+					uint8_t(PMXDrawModeFlags::GroundShadow) |
+					uint8_t(PMXDrawModeFlags::CastSelfShadow) |
+					uint8_t(PMXDrawModeFlags::RecieveSelfShadow) |
+					uint8_t(PMXDrawModeFlags::DrawEdge)
+				);
+				mat.m_edgeColor = glm::vec4(0, 0, 0, 1);
+				mat.m_edgeSize = 1.0f;
+				mat.m_textureIndex = -1;
+				mat.m_sphereTextureIndex = -1;
+				mat.m_sphereMode = PMXSphereMode::None;
+				mat.m_toonMode = PMXToonMode::Common;
+				mat.m_toonTextureIndex = 0;
+				mat.m_numFaceVertices = int32_t((endFace - beginFace) * 3);
+				pmx->m_materials.push_back(mat);
+			}
+		}
+
+		PMXMorph MakeMorph(const std::string& name, PMXMorphType type)
+		{
+			PMXMorph morph;
+			morph.m_name = name;
+			morph.m_englishName = name;
+			morph.m_controlPanel = 4;
+			morph.m_morphType = type;
+			return morph;
+		}
+
+		void GenerateMorphs(PMXFile* pmx, const PMXGenerateParam& param, std::mt19937& rand)
+		{
+			const uint32_t vertexCount = uint32_t(pmx->m_vertices.size());
+			const uint32_t morphVertexCount = std::min(param.m_morphVertexCount, vertexCount);
+			std::uniform_int_distribution<uint32_t> vertexDist(0, vertexCount - 1);
+			std::uniform_int_distribution<uint32_t> boneDist(0, uint32_t(pmx->m_bones.size() - 1));
+
+			for (uint32_t mi = 0; mi < param.m_positionMorphCount; mi++)
+			{
+				auto morph = MakeMorph("vmorph_" + std::to_string(mi), PMXMorphType::Position);
+				uint32_t start = vertexDist(rand);
+				glm::vec3 offset(0, 0.01f * float(mi % 16 + 1), 0);
+				for (uint32_t i = 0; i < morphVertexCount; i++)
+				{
+					morph.m_positionMorph.push_back(PMXMorph::PositionMorph{ int32_t((start + i) % vertexCount), offset });
+				}
+				pmx->m_morphs.push_back(std::move(morph));
+			}
+
+			for (uint32_t mi = 0; mi < param.m_uvMorphCount; mi++)
+			{
+				auto morph = MakeMorph("uvmorph_" + std::to_string(mi), PMXMorphType::UV);
+				uint32_t start = vertexDist(rand);
+				for (uint32_t i = 0; i < morphVertexCount; i++)
+				{
+					morph.m_uvMorph.push_back(PMXMorph::UVMorph{ int32_t((start + i) % vertexCount), glm::vec4(0.1f, 0, 0, 0) });
+				}
+				pmx->m_morphs.push_back(std::move(morph));
+			}
+
+			for (uint32_t mi = 0; mi < param.m_boneMorphCount; mi++)
+			{
+				auto morph = MakeMorph("bmorph_" + std::to_string(mi), PMXMorphType::Bone);
+				for (int i = 0; i < 4; i++)
+				{
+					PMXMorph::BoneMorph data;
+					data.m_boneIndex = int32_t(boneDist(rand));
+					data.m_position = glm::vec3(0, 0.1f, 0);
+					data.m_quaternion = glm::angleAxis(0.2f, glm::vec3(1, 0, 0));
+					morph.m_boneMorph.push_back(data);
+				}
+				pmx->m_morphs.push_back(std::move(morph));
+			}
+
+			for (uint32_t mi = 0; mi < param.m_materialMorphCount; mi++)
+			{
+				auto morph = MakeMorph("mmorph_" + std::to_string(mi), PMXMorphType::Material);
+				PMXMorph::MaterialMorph data;
+				data.m_materialIndex = int32_t(mi % pmx->m_materials.size());
+				data.m_opType = PMXMorph::MaterialMorph::OpType::Mul;
+				data.m_diffuse = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+				data.m_specular = glm::vec3(1);
+				data.m_specularPower = 1.0f;
+				data.m_ambient = glm::vec3(1);
+				data.m_edgeColor = glm::vec4(1);
+				data.m_edgeSize = 1.0f;
+				data.m_textureFactor = glm::vec4(1);
+				data.m_sphereTextureFactor = glm::vec4(1);
+				data.m_toonTextureFactor = glm::vec4(1);
+				morph.m_materialMorph.push_back(data);
+				pmx->m_morphs.push_back(std::move(morph));
+			}
+
+			const uint32_t baseMorphCount = uint32_t(pmx->m_morphs.size());
+			for (uint32_t mi = 0; baseMorphCount != 0 && mi < param.m_groupMorphCount; mi++)
+			{
+				auto morph = MakeMorph("gmorph_" + std::to_string(mi), PMXMorphType::Group);
+				for (uint32_t i = 0; i < std::min(4u, baseMorphCount); i++)
+				{
+					int32_t morphIndex = int32_t((mi * 4 + i) % baseMorphCount);
+					morph.m_groupMorph.push_back(PMXMorph::GroupMorph{ morphIndex, 0.5f });
+				}
+				pmx->m_morphs.push_back(std::move(morph));
+			}
+		}
+
+		void GenerateDisplayFrames(PMXFile* pmx)
+		{
+			using TargetType = PMXDispalyFrame::TargetType;
+
+			PMXDispalyFrame root;
+			root.m_name = "Root";
+			root.m_englishName = "Root";
+			root.m_flag = PMXDispalyFrame::FrameType::SpecialFrame;
+			root.m_targets.push_back(PMXDispalyFrame::Target{ TargetType::BoneIndex, 0 });
+			pmx->m_displayFrames.push_back(root);
+
+			PMXDispalyFrame exp;
+			exp.m_name = "Exp";
+			exp.m_englishName = "Exp";
+			exp.m_flag = PMXDispalyFrame::FrameType::SpecialFrame;
+			for (size_t mi = 0; mi < pmx->m_morphs.size(); mi++)
+			{
+				exp.m_targets.push_back(PMXDispalyFrame::Target{ TargetType::MorphIndex, int32_t(mi) });
+			}
+			pmx->m_displayFrames.push_back(exp);
+
+			PMXDispalyFrame bone;
+			bone.m_name = "Bone";
+			bone.m_englishName = "Bone";
+			bone.m_flag = PMXDispalyFrame::FrameType::DefaultFrame;
+			for (size_t bi = 1; bi < pmx->m_bones.size(); bi++)
+			{
+				bone.m_targets.push_back(PMXDispalyFrame::Target{ TargetType::BoneIndex, int32_t(bi) });
+			}
+			pmx->m_displayFrames.push_back(bone);
+		}
+
+		void GeneratePhysics(PMXFile* pmx, const PMXGenerateParam& param)
+		{
+			// IK の脚以外のボーンに剛体を付ける
+			std::vector<int32_t> bodyBones;
+			for (size_t bi = 0; bi < pmx->m_bones.size(); bi++)
+			{
+				if (pmx->m_bones[bi].m_name.compare(0, 5, "bone_") == 0)
+				{
+					bodyBones.push_back(int32_t(bi));
+				}
+			}
+			if (bodyBones.empty())
+			{
+				bodyBones.push_back(0);
+			}
+
+			uint32_t rbCount = param.m_rigidbodyCount;
+			uint32_t staticCount = (rbCount + 1) / 2;
+			for (uint32_t ri = 0; ri < rbCount; ri++)
+			{
+				int32_t boneIndex = bodyBones[ri % bodyBones.size()];
+				PMXRigidbody rb = {};
+				rb.m_name = "rigidbody_" + std::to_string(ri);
+				rb.m_englishName = rb.m_name;
+				rb.m_boneIndex = boneIndex;
+				rb.m_group = uint8_t(ri % 16);
+				rb.m_collisionGroup = uint16_t(0xFFFF & ~(1 << rb.m_group));
+				rb.m_shape = PMXRigidbody::Shape(ri % 3);
+				rb.m_shapeSize = glm::vec3(0.3f, 0.3f, 0.3f);
+				rb.m_translate = pmx->m_bones[boneIndex].m_position;
+				rb.m_rotate = glm::vec3(0);
+				rb.m_mass = 1.0f;
+				rb.m_translateDimmer = 0.5f;
+				rb.m_rotateDimmer = 0.5f;
+				rb.m_repulsion = 0.0f;
+				rb.m_friction = 0.5f;
+				rb.m_op = ri < staticCount ? PMXRigidbody::Operation::Static : PMXRigidbody::Operation::Dynamic;
+				pmx->m_rigidbodies.push_back(rb);
+			}
+
+			for (uint32_t ri = std::max(staticCount, 1u); ri < rbCount; ri++)
+			{
+				PMXJoint joint = {};
+				joint.m_name = "joint_" + std::to_string(ri);
+				joint.m_englishName = joint.m_name;
+				joint.m_type = PMXJoint::JointType::SpringDOF6;
+				joint.m_rigidbodyAIndex = int32_t(ri - 1);
+				joint.m_rigidbodyBIndex = int32_t(ri);
+				joint.m_translate = pmx->m_rigidbodies[ri].m_translate;
+				joint.m_rotate = glm::vec3(0);
+				joint.m_translateLowerLimit = glm::vec3(0);
+				joint.m_translateUpperLimit = glm::vec3(0);
+				joint.m_rotateLowerLimit = glm::vec3(-0.5f);
+				joint.m_rotateUpperLimit = glm::vec3(0.5f);
+				joint.m_springTranslateFactor = glm::vec3(0);
+				joint.m_springRotateFactor = glm::vec3(0);
+				pmx->m_joints.push_back(joint);
+			}
+		}
+	}
+
+	bool GeneratePMXFile(PMXFile* pmx, const PMXGenerateParam& param)
+	{
+		SABA_TRACE_SCOPE("GeneratePMXFile");
+
+		if (param.m_encode > 1)
+		{
+			SABA_ERROR("Unknown PMX encode. [{}]", param.m_encode);
+			return false;
+		}
+
+		*pmx = PMXFile();
+		std::mt19937 rand(param.m_seed);
+
+		pmx->m_info.m_modelName = "generated";
+		pmx->m_info.m_englishModelName = "generated";
+		pmx->m_info.m_comment = "Generated by saba.";
+		pmx->m_info.m_englishComment = "Generated by saba.";
+
+		GenerateBones(pmx, param);
+		GenerateMesh(pmx, param, rand);
+		GenerateMorphs(pmx, param, rand);
+		GenerateDisplayFrames(pmx);
+		GeneratePhysics(pmx, param);
+
+		auto& header = pmx->m_header;
+		header.m_magic.Set("PMX ");
+		header.m_version = 2.0f;
+		header.m_dataSize = 8;
+		header.m_encode = param.m_encode;
+		header.m_addUVNum = 0;
+		header.m_vertexIndexSize = GetVertexIndexSize(pmx->m_vertices.size());
+		header.m_textureIndexSize = GetIndexSize(pmx->m_textures.size());
+		header.m_materialIndexSize = GetIndexSize(pmx->m_materials.size());
+		header.m_boneIndexSize = GetIndexSize(pmx->m_bones.size());
+		header.m_morphIndexSize = GetIndexSize(pmx->m_morphs.size());
+		header.m_rigidbodyIndexSize = GetIndexSize(pmx->m_rigidbodies.size());
+
+		return true;
+	}
+
+	bool GenerateVMDFile(VMDFile* vmd, const PMXFile& pmx, const VMDGenerateParam& param)
+	{
+		SABA_TRACE_SCOPE("GenerateVMDFile");
+
+		for (const auto& bone : pmx.m_bones)
+		{
+			if (bone.m_name.size() > 15)
+			{
+				SABA_ERROR("Bone name is too long for VMD. [{}]", bone.m_name);
+				return false;
+			}
+		}
+
+		*vmd = VMDFile();
+		std::mt19937 rand(param.m_seed);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		vmd->m_header.m_header.Set("Vocaloid Motion Data 0002");
+		vmd->m_header.m_modelName.Set(pmx.m_info.m_modelName.c_str());
+
+		// 補間パラメータ (4 チャンネル分の x1, y1, x2, y2 を繰り返す)
+		std::array<uint8_t, 64> interpolation;
+		const uint8_t cp[] = { 64, 0, 64, 127 };
+		for (size_t i = 0; i < interpolation.size(); i++)
+		{
+			interpolation[i] = cp[(i % 16) / 4];
+		}
+
+		if (param.m_nodeKeyInterval != 0)
+		{
+			for (size_t bi = 0; bi < pmx.m_bones.size(); bi++)
+			{
+				if (unit(rand) >= param.m_nodeKeyRatio)
+				{
+					continue;
+				}
+
+				const auto& bone = pmx.m_bones[bi];
+				bool isIK = ((uint16_t)bone.m_boneFlag & (uint16_t)PMXBoneFlags::IK) != 0;
+				glm::vec3 axis = glm::normalize(glm::vec3(unit(rand), unit(rand), unit(rand)) + glm::vec3(0.1f));
+				float phaseOffset = unit(rand) * 2.0f * Pi;
+				for (uint32_t frame = 0; frame <= param.m_frameCount; frame += param.m_nodeKeyInterval)
+				{
+					float phase = float(frame) * 0.1f + phaseOffset;
+					VMDMotion motion;
+					motion.m_boneName.Set(bone.m_name.c_str());
+					motion.m_frame = frame;
+					motion.m_translate = glm::vec3(0);
+					motion.m_quaternion = glm::quat(1, 0, 0, 0);
+					if (isIK)
+					{
+						motion.m_translate = glm::vec3(0, 1.0f + std::sin(phase), std::cos(phase));
+					}
+					else
+					{
+						motion.m_quaternion = glm::angleAxis(std::sin(phase) * 0.3f, axis);
+					}
+					motion.m_interpolation = interpolation;
+					vmd->m_motions.push_back(motion);
+				}
+			}
+		}
+
+		if (param.m_morphKeyInterval != 0)
+		{
+			for (size_t mi = 0; mi < pmx.m_morphs.size(); mi++)
+			{
+				for (uint32_t frame = 0; frame <= param.m_frameCount; frame += param.m_morphKeyInterval)
+				{
+					VMDMorph morph;
+					morph.m_blendShapeName.Set(pmx.m_morphs[mi].m_name.c_str());
+					morph.m_frame = frame;
+					morph.m_weight = std::sin(float(frame) * 0.05f + float(mi)) * 0.5f + 0.5f;
+					vmd->m_morphs.push_back(morph);
+				}
+			}
+		}
+
+		if (param.m_ikKeyInterval != 0)
+		{
+			bool enable = true;
+			for (uint32_t frame = 0; frame <= param.m_frameCount; frame += param.m_ikKeyInterval)
+			{
+				VMDIk ik;
+				ik.m_frame = frame;
+				ik.m_show = 1;
+				for (const auto& bone : pmx.m_bones)
+				{
+					if ((uint16_t)bone.m_boneFlag & (uint16_t)PMXBoneFlags::IK)
+					{
+						VMDIkInfo info;
+						info.m_name.Set(bone.m_name.c_str());
+						info.m_enable = enable ? 1 : 0;
+						ik.m_ikInfos.push_back(info);
+					}
+				}
+				vmd->m_iks.push_back(ik);
+				enable = !enable;
+			}
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,62 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_MODEL_MMD_MMDGENERATOR_H_
+#define SABA_MODEL_MMD_MMDGENERATOR_H_
+
+#include "PMXFile.h"
+#include "VMDFile.h"
+
+#include <cstdint>
+
+namespace saba
+{
+	/*
+		負荷試験用のモデルを機械的に生成する.
+		ボーンは center を根にした二分木に並べ、脚 (3 ボーン + IK ボーン) を m_ikChainCount 組追加する.
+		頂点は格子状に並べ、高さに応じて近くのボーンへウェイトを割り当てる.
+		名前はすべて ASCII なので、そのまま VMD のボーン名、モーフ名に使える.
+	*/
+	struct PMXGenerateParam
+	{
+		uint32_t	m_vertexCount = 10000;
+		uint32_t	m_boneCount = 128;		//!< IK の脚を含むボーン数
+		uint32_t	m_materialCount = 1;
+
+		// スキニング方式の比率 (PMXVertexWeight の順). 合計が 0 の場合は BDEF2 のみ
+		float		m_weightRatio[5] = { 0.2f, 0.5f, 0.2f, 0.1f, 0.0f };
+
+		uint32_t	m_positionMorphCount = 16;
+		uint32_t	m_uvMorphCount = 0;
+		uint32_t	m_boneMorphCount = 0;
+		uint32_t	m_materialMorphCount = 0;
+		uint32_t	m_groupMorphCount = 0;		//!< 他のモーフを 4 つずつまとめる
+		uint32_t	m_morphVertexCount = 500;	//!< 頂点、UV モーフ 1 つあたりの頂点数
+
+		uint32_t	m_ikChainCount = 2;
+		int32_t		m_ikIterationCount = 40;
+
+		uint32_t	m_rigidbodyCount = 16;		//!< 前半はボーン追従、後半は物理演算. 物理演算の剛体は直前の剛体とジョイントでつなぐ
+
+		uint8_t		m_encode = 1;				//!< 0:UTF16 1:UTF8
+		uint32_t	m_seed = 0;
+	};
+
+	struct VMDGenerateParam
+	{
+		uint32_t	m_frameCount = 600;
+		uint32_t	m_nodeKeyInterval = 5;		//!< 0 : ノードのキーを作らない
+		float		m_nodeKeyRatio = 1.0f;		//!< キーを打つボーンの割合
+		uint32_t	m_morphKeyInterval = 5;		//!< 0 : モーフのキーを作らない
+		uint32_t	m_ikKeyInterval = 0;		//!< IK の有効、無効を切り替える間隔. 0 : IK のキーを作らない
+		uint32_t	m_seed = 0;
+	};
+
+	bool GeneratePMXFile(PMXFile* pmx, const PMXGenerateParam& param);
+	// pmx のボーン、モーフに対するアニメーションを生成する
+	bool GenerateVMDFile(VMDFile* vmd, const PMXFile& pmx, const VMDGenerateParam& param);
+}
+
+#endif // !SABA_MODEL_MMD_MMDGENERATOR_H_
@@ -5,12 +5,20 @@
 
 #include "MMDIkSolver.h"
 
+#include <Saba/Base/Trace.h>
+
 #include <algorithm>
 #include <functional>
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace saba
 {
+	namespace
+	{
+		// ウォームスタートで SetTolerance が 0 の場合の許容値 (チェインの長さに対する比率)
+		const float DefaultWarmStartToleranceRatio = 1.0e-3f;
+	}
+
 	MMDIkSolver::MMDIkSolver()
 		: m_ikNode(nullptr)
 		, m_ikTarget(nullptr)
@@ -18,6 +26,14 @@ namespace saba
 		, m_limitAngle(glm::pi<float>() * 2.0f)
 		, m_enable(true)
 		, m_baseAnimEnable(true)
+		, m_isTwoBoneChain(false)
+		, m_enableTwoBoneSolve(false)
+		, m_enableWarmStart(false)
+		, m_hasWarmStart(false)
+		, m_tolerance(0)
+		, m_solveTolerance(0)
+		, m_lastIterateCount(0)
+		, m_lastDistance(0)
 	{
 	}
 
@@ -32,6 +48,9 @@ namespace saba
 			chain.m_limitMax = glm::vec3(glm::radians(180.0f), 0, 0);
 		}
 		chain.m_saveIKRot = glm::quat(1, 0, 0, 0);
+		chain.m_warmRotate = glm::quat(1, 0, 0, 0);
+		chain.m_warmPrevAngle = glm::vec3(0);
+		chain.m_warmPlaneModeAngle = 0;
 		AddIKChain(std::move(chain));
 	}
 
@@ -48,6 +67,9 @@ namespace saba
 		chain.m_limitMin = limixMin;
 		chain.m_limitMax = limitMax;
 		chain.m_saveIKRot = glm::quat(1, 0, 0, 0);
+		chain.m_warmRotate = glm::quat(1, 0, 0, 0);
+		chain.m_warmPrevAngle = glm::vec3(0);
+		chain.m_warmPlaneModeAngle = 0;
 		AddIKChain(std::move(chain));
 	}
 
@@ -56,31 +78,151 @@ namespace saba
 		m_chains.emplace_back(chain);
 	}
 
+	void MMDIkSolver::SetupSolveMode()
+	{
+		m_isTwoBoneChain = false;
+		if (m_ikNode == nullptr || m_ikTarget == nullptr || m_chains.size() != 2)
+		{
+			return;
+		}
+
+		// chain[0] : ひざ (X 軸のみ回転), chain[1] : 足 (制限なし)
+		const auto& kneeChain = m_chains[0];
+		const auto& hipChain = m_chains[1];
+		if (!kneeChain.m_enableAxisLimit || hipChain.m_enableAxisLimit)
+		{
+			return;
+		}
+		if (kneeChain.m_limitMin.y != 0 || kneeChain.m_limitMax.y != 0 ||
+			kneeChain.m_limitMin.z != 0 || kneeChain.m_limitMax.z != 0 ||
+			kneeChain.m_limitMin.x >= kneeChain.m_limitMax.x)
+		{
+			return;
+		}
+		// 足 -> ひざ -> ターゲット (足首) が直接の親子になっていること
+		if (m_ikTarget->GetParent() != kneeChain.m_node ||
+			kneeChain.m_node->GetParent() != hipChain.m_node)
+		{
+			return;
+		}
+		m_isTwoBoneChain = true;
+	}
+
 	void MMDIkSolver::Solve()
 	{
+		m_lastIterateCount = 0;
 		if (!m_enable)
 		{
+			m_hasWarmStart = false;
 			return;
 		}
-		// Initialize IKChain
+
+		SABA_TRACE_SCOPE("MMDIkSolver::Solve");
+
+		// 許容値が 0 だとウォームスタートの結果がほぼ必ず初期状態からも解き直しになるため、小さな許容値を使う
+		m_solveTolerance = m_tolerance;
+		if (m_enableWarmStart && m_tolerance <= 0)
+		{
+			m_solveTolerance = CalcChainLength() * DefaultWarmStartToleranceRatio;
+		}
+
+		if (m_enableWarmStart && m_hasWarmStart)
+		{
+			InitializeChains(true);
+			float dist = CalcDistance();
+			if (dist > m_solveTolerance)
+			{
+				dist = SolveIteration(dist);
+			}
+			if (dist <= m_solveTolerance)
+			{
+				EndSolve();
+				return;
+			}
+
+			/*
+				収束しなかった場合は前回の解から局所解に陥っている可能性があるため、
+				初期状態からも解いて良いほうを使う.
+			*/
+			SaveWarmStart();
+			InitializeChains(false);
+			if (SolveCold() > dist)
+			{
+				for (auto& chain : m_chains)
+				{
+					chain.m_node->SetIKRotate(chain.m_warmRotate * glm::inverse(chain.m_node->AnimateRotate()));
+					chain.m_prevAngle = chain.m_warmPrevAngle;
+					chain.m_planeModeAngle = chain.m_warmPlaneModeAngle;
+					chain.m_node->UpdateLocalTransform();
+					chain.m_node->UpdateGlobalTransform();
+				}
+			}
+		}
+		else
+		{
+			InitializeChains(false);
+			SolveCold();
+		}
+		EndSolve();
+	}
+
+	void MMDIkSolver::InitializeChains(bool warmStart)
+	{
 		for (auto& chain : m_chains)
 		{
-			chain.m_prevAngle = glm::vec3(0);
-			chain.m_node->SetIKRotate(glm::quat(1, 0, 0, 0));
-			chain.m_planeModeAngle = 0;
+			if (warmStart)
+			{
+				chain.m_node->SetIKRotate(chain.m_warmRotate * glm::inverse(chain.m_node->AnimateRotate()));
+				chain.m_prevAngle = chain.m_warmPrevAngle;
+				chain.m_planeModeAngle = chain.m_warmPlaneModeAngle;
+			}
+			else
+			{
+				chain.m_prevAngle = glm::vec3(0);
+				chain.m_node->SetIKRotate(glm::quat(1, 0, 0, 0));
+				chain.m_planeModeAngle = 0;
+			}
 
 			chain.m_node->UpdateLocalTransform();
 			chain.m_node->UpdateGlobalTransform();
 		}
+	}
+
+	float MMDIkSolver::SolveCold()
+	{
+		if (m_solveTolerance > 0)
+		{
+			float dist = CalcDistance();
+			if (dist <= m_solveTolerance)
+			{
+				return dist;
+			}
+		}
+
+		if (IsTwoBoneSolve() && SolveTwoBone())
+		{
+			m_lastIterateCount++;
+			return CalcDistance();
+		}
+
+		return SolveIteration(std::numeric_limits<float>::max());
+	}
+
+	float MMDIkSolver::SolveIteration(float initDist)
+	{
+		// 初期状態より悪くなった場合は初期状態に戻す
+		float maxDist = initDist;
+		for (auto& chain : m_chains)
+		{
+			chain.m_saveIKRot = chain.m_node->GetIKRotate();
+		}
 
-		float maxDist = std::numeric_limits<float>::max();
 		for (uint32_t i = 0; i < m_iterateCount; i++)
 		{
 			SolveCore(i);
+			m_lastIterateCount++;
 
-			auto targetPos = glm::vec3(m_ikTarget->GetGlobalTransform()[3]);
-			auto ikPos = glm::vec3(m_ikNode->GetGlobalTransform()[3]);
-			float dist = glm::length(targetPos - ikPos);
+			float dist = CalcDistance();
 			if (dist < maxDist)
 			{
 				maxDist = dist;
@@ -88,6 +230,10 @@ namespace saba
 				{
 					chain.m_saveIKRot = chain.m_node->GetIKRotate();
 				}
+				if (dist <= m_solveTolerance)
+				{
+					break;
+				}
 			}
 			else
 			{
@@ -100,6 +246,44 @@ namespace saba
 				break;
 			}
 		}
+		return CalcDistance();
+	}
+
+	float MMDIkSolver::CalcDistance() const
+	{
+		auto targetPos = glm::vec3(m_ikTarget->GetGlobalTransform()[3]);
+		auto ikPos = glm::vec3(m_ikNode->GetGlobalTransform()[3]);
+		return glm::length(targetPos - ikPos);
+	}
+
+	float MMDIkSolver::CalcChainLength() const
+	{
+		float length = 0;
+		auto pos = glm::vec3(m_ikTarget->GetGlobalTransform()[3]);
+		for (const auto& chain : m_chains)
+		{
+			auto chainPos = glm::vec3(chain.m_node->GetGlobalTransform()[3]);
+			length += glm::length(pos - chainPos);
+			pos = chainPos;
+		}
+		return length;
+	}
+
+	void MMDIkSolver::SaveWarmStart()
+	{
+		for (auto& chain : m_chains)
+		{
+			chain.m_warmRotate = chain.m_node->GetIKRotate() * chain.m_node->AnimateRotate();
+			chain.m_warmPrevAngle = chain.m_prevAngle;
+			chain.m_warmPlaneModeAngle = chain.m_planeModeAngle;
+		}
+	}
+
+	void MMDIkSolver::EndSolve()
+	{
+		m_lastDistance = CalcDistance();
+		SaveWarmStart();
+		m_hasWarmStart = true;
 	}
 
 	namespace
@@ -467,5 +651,100 @@ namespace saba
 		chain.m_node->UpdateLocalTransform();
 		chain.m_node->UpdateGlobalTransform();
 	}
-}
 
+	bool MMDIkSolver::SolveTwoBone()
+	{
+		auto& kneeChain = m_chains[0];
+		auto& hipChain = m_chains[1];
+		MMDNode* kneeNode = kneeChain.m_node;
+		MMDNode* hipNode = hipChain.m_node;
+
+		// 足の座標系で計算する
+		auto invHip = glm::inverse(hipNode->GetGlobalTransform());
+		auto ikPos = glm::vec3(invHip * m_ikNode->GetGlobalTransform()[3]);
+		auto kneePos = glm::vec3(kneeNode->GetLocalTransform()[3]);
+		auto targetPos = glm::vec3(m_ikTarget->GetLocalTransform()[3]);
+
+		/*
+			ひざの X 軸回転を angle とすると、足からターゲットまでの距離は
+			|kneePos + rotX(angle) * targetPos| となる.
+			これが足から IK までの距離 ikDist と等しくなる angle を求める.
+			a * cos(angle) + b * sin(angle) = c
+		*/
+		const float ikDist = glm::length(ikPos);
+		const float a = kneePos.y * targetPos.y + kneePos.z * targetPos.z;
+		const float b = kneePos.z * targetPos.y - kneePos.y * targetPos.z;
+		const float c = (ikDist * ikDist - glm::dot(kneePos, kneePos) - glm::dot(targetPos, targetPos)) * 0.5f
+			- kneePos.x * targetPos.x;
+		const float r = std::sqrt(a * a + b * b);
+		if (r < 1.0e-6f || ikDist < 1.0e-6f)
+		{
+			// ひざの回転で距離が変わらない場合は CCD で解く
+			return false;
+		}
+
+		const float phi = std::atan2(b, a);
+		const float alpha = std::acos(glm::clamp(c / r, -1.0f, 1.0f));
+		const float limitMin = kneeChain.m_limitMin.x;
+		const float limitMax = kneeChain.m_limitMax.x;
+		const float limitCenter = (limitMin + limitMax) * 0.5f;
+
+		// 2 つの解のうち、制限内で距離の誤差が小さいものを選ぶ
+		float kneeAngle = glm::clamp(0.0f, limitMin, limitMax);
+		float minErr = std::numeric_limits<float>::max();
+		const float candidates[] = { phi + alpha, phi - alpha };
+		for (float candidate : candidates)
+		{
+			for (int i = -1; i <= 1; i++)
+			{
+				float angle = glm::clamp(candidate + glm::two_pi<float>() * float(i), limitMin, limitMax);
+				float s = std::sin(angle);
+				float co = std::cos(angle);
+				auto rotTargetPos = glm::vec3(
+					targetPos.x,
+					targetPos.y * co - targetPos.z * s,
+					targetPos.y * s + targetPos.z * co
+				);
+				float err = std::abs(glm::length(kneePos + rotTargetPos) - ikDist);
+				if (err < minErr - 1.0e-6f ||
+					(err < minErr + 1.0e-6f && std::abs(angle - limitCenter) < std::abs(kneeAngle - limitCenter)))
+				{
+					minErr = std::min(err, minErr);
+					kneeAngle = angle;
+				}
+			}
+		}
+
+		/*
+			ひざの向き (足のひねり) は解が一つに決まらないため、
+			CCD を 1 回だけ行って CCD と同じ向きに寄せてから解析解を適用する.
+			足の回転で足から IK までの距離は変わらないので ikDist はそのまま使える.
+		*/
+		SolveCore(0);
+		invHip = glm::inverse(hipNode->GetGlobalTransform());
+		ikPos = glm::vec3(invHip * m_ikNode->GetGlobalTransform()[3]);
+
+		auto kneeRot = glm::rotate(glm::quat(1, 0, 0, 0), kneeAngle, glm::vec3(1, 0, 0));
+		kneeNode->SetIKRotate(kneeRot * glm::inverse(kneeNode->AnimateRotate()));
+		kneeNode->UpdateLocalTransform();
+		kneeNode->UpdateGlobalTransform();
+		kneeChain.m_planeModeAngle = kneeAngle;
+
+		// ターゲットが IK の方向を向くように足を回転させる
+		auto hipTargetPos = glm::vec3(invHip * m_ikTarget->GetGlobalTransform()[3]);
+		if (glm::length(hipTargetPos) > 1.0e-6f)
+		{
+			auto rot = RotateFromTo(hipTargetPos, ikPos);
+			auto hipRot = hipNode->GetIKRotate() * hipNode->AnimateRotate() * rot;
+			hipNode->SetIKRotate(hipRot * glm::inverse(hipNode->AnimateRotate()));
+			hipNode->UpdateLocalTransform();
+			hipNode->UpdateGlobalTransform();
+		}
+
+		for (auto& chain : m_chains)
+		{
+			chain.m_saveIKRot = chain.m_node->GetIKRotate();
+		}
+		return true;
+	}
+}
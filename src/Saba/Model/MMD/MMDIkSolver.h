@@ -48,6 +48,39 @@ namespace saba
 			const glm::vec3& limitMax
 		);
 
+		/*
+			チェインの構成を調べて解法を選ぶ. チェインを追加した後に呼ぶ.
+			EnableTwoBoneSolve(true) の場合、ひざ (X 軸のみの回転制限) + 足 の 2 リンクのチェインは解析的に解き、
+			それ以外は CCD で解く.
+		*/
+		void SetupSolveMode();
+		/*
+			2 リンクのチェインを解析的に解く (デフォルトは無効).
+			足首の位置は CCD 以上に IK に近づくが、ひざの曲げ方や足のひねりは CCD と一致するとは限らない.
+			ビューアーでは setMMDConfig -ikTwoBone で有効にする.
+		*/
+		void EnableTwoBoneSolve(bool enable) { m_enableTwoBoneSolve = enable; }
+		bool IsTwoBoneSolve() const { return m_isTwoBoneChain && m_enableTwoBoneSolve; }
+
+		/*
+			前回の Solve の結果を初期値にして解く.
+			連続したフレームを再生する場合は少ない反復回数で収束する.
+			距離が許容値以下にならなかった場合は初期状態からも解く.
+			SetTolerance が 0 の場合はチェインの長さの 1/1000 を許容値にする.
+		*/
+		void EnableWarmStart(bool enable) { m_enableWarmStart = enable; m_hasWarmStart = false; }
+		bool IsEnabledWarmStart() const { return m_enableWarmStart; }
+		// 再生位置を飛ばした場合などに呼ぶ
+		void ClearWarmStart() { m_hasWarmStart = false; }
+
+		// ターゲットと IK の距離がこの値以下になったら反復を打ち切る (0 : 無効)
+		void SetTolerance(float tolerance) { m_tolerance = tolerance; }
+		float GetTolerance() const { return m_tolerance; }
+
+		// 直前の Solve の反復回数とターゲットと IK の距離
+		uint32_t GetLastIterateCount() const { return m_lastIterateCount; }
+		float GetLastDistance() const { return m_lastDistance; }
+
 		void Solve();
 
 		void SaveBaseAnimation() { m_baseAnimEnable = m_enable; }
@@ -65,11 +98,22 @@ namespace saba
 			glm::vec3	m_prevAngle;
 			glm::quat	m_saveIKRot;
 			float		m_planeModeAngle;
+			// 前回の解 (m_warmRotate は IKRotate * AnimateRotate)
+			glm::quat	m_warmRotate;
+			glm::vec3	m_warmPrevAngle;
+			float		m_warmPlaneModeAngle;
 		};
 
 	private:
 		void AddIKChain(IKChain&& chain);
 		void SolveCore(uint32_t iteration);
+		void InitializeChains(bool warmStart);
+		float SolveCold();
+		float SolveIteration(float initDist);
+		float CalcDistance() const;
+		float CalcChainLength() const;
+		void SaveWarmStart();
+		void EndSolve();
 
 		enum class SolveAxis {
 			X,
@@ -77,6 +121,7 @@ namespace saba
 			Z,
 		};
 		void SolvePlane(uint32_t iteration, size_t chainIdx, SolveAxis solveAxis);
+		bool SolveTwoBone();
 
 	private:
 		std::vector<IKChain>	m_chains;
@@ -86,6 +131,14 @@ namespace saba
 		float		m_limitAngle;
 		bool		m_enable;
 		bool		m_baseAnimEnable;
+		bool		m_isTwoBoneChain;
+		bool		m_enableTwoBoneSolve;
+		bool		m_enableWarmStart;
+		bool		m_hasWarmStart;
+		float		m_tolerance;
+		float		m_solveTolerance;	//!< Solve 中に使う許容値
+		uint32_t	m_lastIterateCount;
+		float		m_lastDistance;
 
 	};
 }
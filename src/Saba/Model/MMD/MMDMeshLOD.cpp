@@ -0,0 +1,361 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "MMDMeshLOD.h"
+
+#include <Saba/Base/Log.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+namespace saba
+{
+	namespace
+	{
+		// ウェイトの差 (0 - 2) がこれより大きい頂点どうしは縮約しない
+		const float MaxWeightDiff = 0.3f;
+		const int MaxPassCount = 32;
+
+		struct Collapse
+		{
+			float		m_cost;
+			uint32_t	m_from;
+			uint32_t	m_to;
+		};
+
+		float GetBoneWeight(const MMDLODVertexWeight& w, int32_t boneIndex)
+		{
+			float weight = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				if (w.m_boneIndex[i] == boneIndex)
+				{
+					weight += w.m_boneWeight[i];
+				}
+			}
+			return weight;
+		}
+
+		float CalcWeightDiff(const MMDLODVertexWeight& w0, const MMDLODVertexWeight& w1)
+		{
+			float diff = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				auto boneIndex = w0.m_boneIndex[i];
+				if (boneIndex == -1 || w0.m_boneWeight[i] == 0)
+				{
+					continue;
+				}
+				// 同じボーンが複数回出てくる場合は最初の 1 回だけ数える
+				bool found = false;
+				for (int j = 0; j < i; j++)
+				{
+					found = found || w0.m_boneIndex[j] == boneIndex;
+				}
+				if (!found)
+				{
+					diff += std::abs(GetBoneWeight(w0, boneIndex) - GetBoneWeight(w1, boneIndex));
+				}
+			}
+			for (int i = 0; i < 4; i++)
+			{
+				auto boneIndex = w1.m_boneIndex[i];
+				if (boneIndex == -1 || w1.m_boneWeight[i] == 0)
+				{
+					continue;
+				}
+				bool found = false;
+				for (int j = 0; j < i; j++)
+				{
+					found = found || w1.m_boneIndex[j] == boneIndex;
+				}
+				if (!found && GetBoneWeight(w0, boneIndex) == 0)
+				{
+					diff += GetBoneWeight(w1, boneIndex);
+				}
+			}
+			return diff;
+		}
+
+		glm::vec3 CalcTriangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+		{
+			return glm::cross(p1 - p0, p2 - p0);
+		}
+	}
+
+	bool BuildMMDMeshLOD(
+		const glm::vec3*			positions,
+		const MMDLODVertexWeight*	weights,
+		size_t						vertexCount,
+		const uint32_t*				indices,
+		const MMDSubMesh*			subMeshes,
+		size_t						subMeshCount,
+		float						triangleRatio,
+		MMDMeshLOD*					lod
+	)
+	{
+		if (lod == nullptr)
+		{
+			return false;
+		}
+		lod->m_indices.clear();
+		lod->m_subMeshes.clear();
+		lod->m_vertices.clear();
+
+		// 三角形とサブメッシュの対応
+		std::vector<uint32_t> tris;
+		std::vector<uint32_t> triSubMesh;
+		for (size_t subMeshIdx = 0; subMeshIdx < subMeshCount; subMeshIdx++)
+		{
+			const auto& subMesh = subMeshes[subMeshIdx];
+			for (int i = 0; i + 2 < subMesh.m_vertexCount; i += 3)
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					auto vi = indices[subMesh.m_beginIndex + i + j];
+					if (vi >= vertexCount)
+					{
+						SABA_WARN("BuildMMDMeshLOD: Invalid index. [{}]", vi);
+						return false;
+					}
+					tris.push_back(vi);
+				}
+				triSubMesh.push_back(uint32_t(subMeshIdx));
+			}
+		}
+
+		const size_t triCount = triSubMesh.size();
+		std::vector<uint8_t> triAlive(triCount, 1);
+		size_t aliveTriCount = triCount;
+		const size_t targetTriCount = size_t(float(triCount) * glm::clamp(triangleRatio, 0.0f, 1.0f));
+
+		std::vector<uint32_t> vtxTriOffsets(vertexCount + 1);
+		std::vector<uint32_t> vtxTris;
+		std::vector<uint8_t> locked(vertexCount);
+		std::vector<uint8_t> touched(vertexCount);
+		std::vector<int32_t> vtxSubMesh(vertexCount);
+		std::unordered_map<uint64_t, uint32_t> edgeCounts;
+		std::vector<Collapse> collapses;
+
+		for (int pass = 0; pass < MaxPassCount && aliveTriCount > targetTriCount; pass++)
+		{
+			// 頂点 -> 三角形
+			std::fill(vtxTriOffsets.begin(), vtxTriOffsets.end(), 0);
+			for (size_t t = 0; t < triCount; t++)
+			{
+				if (!triAlive[t]) { continue; }
+				for (int j = 0; j < 3; j++)
+				{
+					vtxTriOffsets[tris[t * 3 + j] + 1]++;
+				}
+			}
+			for (size_t vi = 0; vi < vertexCount; vi++)
+			{
+				vtxTriOffsets[vi + 1] += vtxTriOffsets[vi];
+			}
+			vtxTris.resize(vtxTriOffsets[vertexCount]);
+			{
+				std::vector<uint32_t> fill(vtxTriOffsets.begin(), vtxTriOffsets.end() - 1);
+				for (size_t t = 0; t < triCount; t++)
+				{
+					if (!triAlive[t]) { continue; }
+					for (int j = 0; j < 3; j++)
+					{
+						vtxTris[fill[tris[t * 3 + j]]++] = uint32_t(t);
+					}
+				}
+			}
+
+			// 境界の頂点、複数のサブメッシュで使われている頂点は固定する
+			std::fill(locked.begin(), locked.end(), 0);
+			std::fill(vtxSubMesh.begin(), vtxSubMesh.end(), -1);
+			edgeCounts.clear();
+			for (size_t t = 0; t < triCount; t++)
+			{
+				if (!triAlive[t]) { continue; }
+				for (int j = 0; j < 3; j++)
+				{
+					uint32_t v0 = tris[t * 3 + j];
+					uint32_t v1 = tris[t * 3 + (j + 1) % 3];
+					uint64_t key = (uint64_t(std::min(v0, v1)) << 32) | std::max(v0, v1);
+					edgeCounts[key]++;
+
+					if (vtxSubMesh[v0] == -1)
+					{
+						vtxSubMesh[v0] = int32_t(triSubMesh[t]);
+					}
+					else if (vtxSubMesh[v0] != int32_t(triSubMesh[t]))
+					{
+						locked[v0] = 1;
+					}
+				}
+			}
+			for (const auto& edgeCount : edgeCounts)
+			{
+				if (edgeCount.second != 2)
+				{
+					locked[uint32_t(edgeCount.first >> 32)] = 1;
+					locked[uint32_t(edgeCount.first & 0xFFFFFFFF)] = 1;
+				}
+			}
+
+			// 縮約の候補
+			collapses.clear();
+			for (const auto& edgeCount : edgeCounts)
+			{
+				if (edgeCount.second != 2)
+				{
+					continue;
+				}
+				uint32_t v0 = uint32_t(edgeCount.first >> 32);
+				uint32_t v1 = uint32_t(edgeCount.first & 0xFFFFFFFF);
+				float weightDiff = 0;
+				if (weights != nullptr)
+				{
+					weightDiff = CalcWeightDiff(weights[v0], weights[v1]);
+					if (weightDiff > MaxWeightDiff)
+					{
+						continue;
+					}
+				}
+				auto d = positions[v0] - positions[v1];
+				float cost = glm::dot(d, d) * (1.0f + weightDiff * 4.0f);
+				if (!locked[v0])
+				{
+					collapses.push_back(Collapse{ cost, v0, v1 });
+				}
+				if (!locked[v1])
+				{
+					collapses.push_back(Collapse{ cost, v1, v0 });
+				}
+			}
+			if (collapses.empty())
+			{
+				break;
+			}
+			std::sort(
+				collapses.begin(),
+				collapses.end(),
+				[](const Collapse& a, const Collapse& b)
+				{
+					if (a.m_cost != b.m_cost) { return a.m_cost < b.m_cost; }
+					if (a.m_from != b.m_from) { return a.m_from < b.m_from; }
+					return a.m_to < b.m_to;
+				}
+			);
+
+			// 1 回のパスでは、縮約した頂点の周りの頂点は動かさない
+			std::fill(touched.begin(), touched.end(), 0);
+			size_t collapseCount = 0;
+			for (const auto& collapse : collapses)
+			{
+				if (aliveTriCount <= targetTriCount)
+				{
+					break;
+				}
+				const uint32_t from = collapse.m_from;
+				const uint32_t to = collapse.m_to;
+				if (touched[from] || touched[to])
+				{
+					continue;
+				}
+
+				// 面が裏返る、または潰れる場合は縮約しない
+				bool valid = true;
+				size_t removeCount = 0;
+				for (uint32_t ti = vtxTriOffsets[from]; ti < vtxTriOffsets[from + 1] && valid; ti++)
+				{
+					uint32_t t = vtxTris[ti];
+					const uint32_t* tri = &tris[t * 3];
+					if (tri[0] == to || tri[1] == to || tri[2] == to)
+					{
+						removeCount++;
+						continue;
+					}
+					glm::vec3 p[3];
+					glm::vec3 newP[3];
+					for (int j = 0; j < 3; j++)
+					{
+						p[j] = positions[tri[j]];
+						newP[j] = tri[j] == from ? positions[to] : p[j];
+					}
+					auto n0 = CalcTriangleNormal(p[0], p[1], p[2]);
+					auto n1 = CalcTriangleNormal(newP[0], newP[1], newP[2]);
+					float len0 = glm::length(n0);
+					float len1 = glm::length(n1);
+					if (len1 <= len0 * 1.0e-3f || glm::dot(n0, n1) < 0.5f * len0 * len1)
+					{
+						valid = false;
+					}
+				}
+				if (!valid || removeCount == 0)
+				{
+					continue;
+				}
+
+				for (uint32_t ti = vtxTriOffsets[from]; ti < vtxTriOffsets[from + 1]; ti++)
+				{
+					uint32_t t = vtxTris[ti];
+					uint32_t* tri = &tris[t * 3];
+					for (int j = 0; j < 3; j++)
+					{
+						touched[tri[j]] = 1;
+					}
+					if (tri[0] == to || tri[1] == to || tri[2] == to)
+					{
+						triAlive[t] = 0;
+						aliveTriCount--;
+					}
+					else
+					{
+						for (int j = 0; j < 3; j++)
+						{
+							if (tri[j] == from)
+							{
+								tri[j] = to;
+							}
+						}
+					}
+				}
+				collapseCount++;
+			}
+			if (collapseCount == 0)
+			{
+				break;
+			}
+		}
+
+		// サブメッシュごとにまとめる (三角形はサブメッシュ順に並んでいる)
+		std::vector<uint8_t> used(vertexCount);
+		size_t t = 0;
+		for (size_t subMeshIdx = 0; subMeshIdx < subMeshCount; subMeshIdx++)
+		{
+			MMDSubMesh subMesh;
+			subMesh.m_beginIndex = int(lod->m_indices.size());
+			subMesh.m_materialID = subMeshes[subMeshIdx].m_materialID;
+			for (; t < triCount && triSubMesh[t] == subMeshIdx; t++)
+			{
+				if (!triAlive[t]) { continue; }
+				for (int j = 0; j < 3; j++)
+				{
+					lod->m_indices.push_back(tris[t * 3 + j]);
+					used[tris[t * 3 + j]] = 1;
+				}
+			}
+			subMesh.m_vertexCount = int(lod->m_indices.size()) - subMesh.m_beginIndex;
+			lod->m_subMeshes.push_back(subMesh);
+		}
+		for (size_t vi = 0; vi < vertexCount; vi++)
+		{
+			if (used[vi])
+			{
+				lod->m_vertices.push_back(uint32_t(vi));
+			}
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,43 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_MODEL_MMD_MMDMESHLOD_H_
+#define SABA_MODEL_MMD_MMDMESHLOD_H_
+
+#include "MMDModel.h"
+
+#include <cstdint>
+#include <glm/vec3.hpp>
+
+namespace saba
+{
+	// 頂点のボーンウェイト (未使用のボーンは -1)
+	struct MMDLODVertexWeight
+	{
+		int32_t	m_boneIndex[4];
+		float	m_boneWeight[4];
+	};
+
+	/*
+		エッジの縮約で三角形を減らした LOD を作る.
+		頂点は隣の頂点に寄せるだけなので、頂点バッファは元のメッシュと共有できる.
+		- 境界 (UV の継ぎ目、サブメッシュの境目を含む) の頂点は動かさない
+		- ボーンウェイトが大きく異なる頂点どうしは縮約しない
+		- 面が裏返る縮約は行わない
+		triangleRatio : 残す三角形の割合の目安 (縮約できる辺が無くなった場合はそれより多く残る)
+	*/
+	bool BuildMMDMeshLOD(
+		const glm::vec3*			positions,
+		const MMDLODVertexWeight*	weights,
+		size_t						vertexCount,
+		const uint32_t*				indices,
+		const MMDSubMesh*			subMeshes,
+		size_t						subMeshCount,
+		float						triangleRatio,
+		MMDMeshLOD*					lod
+	);
+}
+
+#endif // !SABA_MODEL_MMD_MMDMESHLOD_H_
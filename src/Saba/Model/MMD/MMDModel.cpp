@@ -170,6 +170,82 @@ namespace saba
 	}
 
 	void MMDModel::LoadPose(const VPDFile & vpd, int frameCount)
+	{
+		std::vector<PoseNode> poses;
+		for (const auto& bone : vpd.m_bones)
+		{
+			auto nodeIdx = GetNodeManager()->FindNodeIndex(bone.m_boneName);
+			if (MMDNodeManager::NPos != nodeIdx)
+			{
+				PoseNode pose;
+				pose.m_node = GetNodeManager()->GetMMDNode(nodeIdx);
+				pose.m_translate = bone.m_translate;
+				pose.m_rotate = bone.m_quaternion;
+				poses.push_back(pose);
+			}
+		}
+
+		std::vector<PoseMorph> morphs;
+		for (const auto& vpdMorph : vpd.m_morphs)
+		{
+			auto morphIdx = GetMorphManager()->FindMorphIndex(vpdMorph.m_morphName);
+			if (MMDMorphManager::NPos != morphIdx)
+			{
+				PoseMorph morph;
+				morph.m_morph = GetMorphManager()->GetMorph(morphIdx);
+				morph.m_weight = vpdMorph.m_weight;
+				morphs.push_back(morph);
+			}
+		}
+
+		LoadPose(poses, morphs, frameCount);
+	}
+
+	void MMDModel::LoadPose(const MMDPoseLibrary & library, size_t poseIndex, const MMDPoseLibrary::Binding & binding, int frameCount)
+	{
+		if (poseIndex >= library.GetPoseCount())
+		{
+			SABA_WARN("Pose index is out of range. [{}]", poseIndex);
+			return;
+		}
+
+		// 名前は Bind で解決済みなので、インデックスで引くだけ
+		const auto& pose = library.GetPose(poseIndex);
+		std::vector<PoseNode> poses;
+		poses.reserve(pose.m_boneKeyCount);
+		const auto* boneKeys = library.GetBoneKeys(pose);
+		for (uint32_t i = 0; i < pose.m_boneKeyCount; i++)
+		{
+			const auto& key = boneKeys[i];
+			if (key.m_nameIndex < binding.m_nodes.size() && binding.m_nodes[key.m_nameIndex] != nullptr)
+			{
+				PoseNode poseNode;
+				poseNode.m_node = binding.m_nodes[key.m_nameIndex];
+				poseNode.m_translate = key.m_translate;
+				poseNode.m_rotate = key.m_quaternion;
+				poses.push_back(poseNode);
+			}
+		}
+
+		std::vector<PoseMorph> morphs;
+		morphs.reserve(pose.m_morphKeyCount);
+		const auto* morphKeys = library.GetMorphKeys(pose);
+		for (uint32_t i = 0; i < pose.m_morphKeyCount; i++)
+		{
+			const auto& key = morphKeys[i];
+			if (key.m_nameIndex < binding.m_morphs.size() && binding.m_morphs[key.m_nameIndex] != nullptr)
+			{
+				PoseMorph poseMorph;
+				poseMorph.m_morph = binding.m_morphs[key.m_nameIndex];
+				poseMorph.m_weight = key.m_weight;
+				morphs.push_back(poseMorph);
+			}
+		}
+
+		LoadPose(poses, morphs, frameCount);
+	}
+
+	void MMDModel::LoadPose(const std::vector<PoseNode>& poses, const std::vector<PoseMorph>& morphs, int frameCount)
 	{
 		struct Pose
 		{
@@ -179,20 +255,17 @@ namespace saba
 			glm::quat	m_beginRotate;
 			glm::quat	m_endRotate;
 		};
-		std::vector<Pose> poses;
-		for (const auto& bone : vpd.m_bones)
+		std::vector<Pose> nodePoses;
+		nodePoses.reserve(poses.size());
+		for (const auto& src : poses)
 		{
-			auto nodeIdx = GetNodeManager()->FindNodeIndex(bone.m_boneName);
-			if (MMDNodeManager::NPos != nodeIdx)
-			{
-				Pose pose;
-				pose.m_node = GetNodeManager()->GetMMDNode(bone.m_boneName);
-				pose.m_beginTranslate = pose.m_node->GetAnimationTranslate();
-				pose.m_endTranslate = bone.m_translate * glm::vec3(1, 1, -1);
-				pose.m_beginRotate = pose.m_node->GetAnimationRotate();
-				pose.m_endRotate = InvZ(bone.m_quaternion);
-				poses.emplace_back(std::move(pose));
-			}
+			Pose pose;
+			pose.m_node = src.m_node;
+			pose.m_beginTranslate = pose.m_node->GetAnimationTranslate();
+			pose.m_endTranslate = src.m_translate * glm::vec3(1, 1, -1);
+			pose.m_beginRotate = pose.m_node->GetAnimationRotate();
+			pose.m_endRotate = InvZ(src.m_rotate);
+			nodePoses.push_back(pose);
 		}
 
 		struct Morph
@@ -201,18 +274,15 @@ namespace saba
 			float		m_beginWeight;
 			float		m_endWeight;
 		};
-		std::vector<Morph> morphs;
-		for (const auto& vpdMorph : vpd.m_morphs)
+		std::vector<Morph> morphPoses;
+		morphPoses.reserve(morphs.size());
+		for (const auto& src : morphs)
 		{
-			auto morphIdx = GetMorphManager()->FindMorphIndex(vpdMorph.m_morphName);
-			if (MMDMorphManager::NPos != morphIdx)
-			{
-				Morph morph;
-				morph.m_morph = GetMorphManager()->GetMorph(vpdMorph.m_morphName);
-				morph.m_beginWeight = morph.m_morph->GetWeight();
-				morph.m_endWeight = vpdMorph.m_weight;
-				morphs.emplace_back(std::move(morph));
-			}
+			Morph morph;
+			morph.m_morph = src.m_morph;
+			morph.m_beginWeight = morph.m_morph->GetWeight();
+			morph.m_endWeight = src.m_weight;
+			morphPoses.push_back(morph);
 		}
 
 		// Physicsを反映する
@@ -222,7 +292,7 @@ namespace saba
 
 			// evaluate
 			float w = float(1 + i) / float(frameCount);
-			for (auto& pose : poses)
+			for (auto& pose : nodePoses)
 			{
 				auto t = glm::mix(pose.m_beginTranslate, pose.m_endTranslate, w);
 				auto q = glm::slerp(pose.m_beginRotate, pose.m_endRotate, w);
@@ -230,7 +300,7 @@ namespace saba
 				pose.m_node->SetAnimationRotate(q);
 			}
 
-			for (auto& morph : morphs)
+			for (auto& morph : morphPoses)
 			{
 				auto weight = glm::mix(morph.m_beginWeight, morph.m_endWeight, w);
 				morph.m_morph->SetWeight(weight);
@@ -9,6 +9,7 @@
 #include "MMDNode.h"
 #include "MMDIkSolver.h"
 #include "MMDMorph.h"
+#include "MMDPoseLibrary.h"
 
 #include <vector>
 #include <string>
@@ -17,6 +18,8 @@
 #include <memory>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
 
 namespace saba
 {
@@ -120,6 +123,91 @@ namespace saba
 		int	m_materialID;
 	};
 
+	// 三角形を減らしたメッシュ. 頂点は元のメッシュと共有する
+	struct MMDMeshLOD
+	{
+		std::vector<uint32_t>	m_indices;
+		std::vector<MMDSubMesh>	m_subMeshes;	//!< m_beginIndex は m_indices の位置
+		std::vector<uint32_t>	m_vertices;		//!< m_indices が参照する頂点 (昇順)
+	};
+
+	/*
+		Update(const MMDVertexSink&) の書き込み先.
+		頂点 i は m_data + m_offset + m_stride * i に書き込む. m_data が nullptr の場合は書き込まない.
+		m_stride が 0 の場合は要素の大きさ (詰めて並べる) とする.
+		float として書き込むので、m_data, m_offset, m_stride は 4 バイト境界にそろえる.
+	*/
+	struct MMDVertexStream
+	{
+		void*	m_data = nullptr;
+		size_t	m_offset = 0;
+		size_t	m_stride = 0;
+	};
+
+	struct MMDVertexSink
+	{
+		MMDVertexStream	m_positions;	//!< glm::vec3
+		MMDVertexStream	m_normals;		//!< glm::vec3
+		MMDVertexStream	m_uvs;			//!< glm::vec2
+	};
+
+	// MMDVertexStream へ書き込む (Update の実装用)
+	class MMDVertexStreamWriter
+	{
+	public:
+		MMDVertexStreamWriter(const MMDVertexStream& stream, size_t elementSize)
+			: m_data(stream.m_data != nullptr ? (uint8_t*)stream.m_data + stream.m_offset : nullptr)
+			, m_stride(stream.m_stride != 0 ? stream.m_stride : elementSize)
+		{
+		}
+
+		template <typename T>
+		void Write(size_t index, const T& value) const
+		{
+			if (m_data != nullptr)
+			{
+				*reinterpret_cast<T*>(m_data + m_stride * index) = value;
+			}
+		}
+
+	private:
+		uint8_t*	m_data;
+		size_t		m_stride;
+	};
+
+	/*
+		GPU スキニング用の頂点ごとのボーンの情報 (モデルを読み込んだ後は変わらない).
+		使わないボーンはインデックス 0、ウェイト 0 にする.
+	*/
+	struct MMDSkinningVertex
+	{
+		enum class Type : int32_t
+		{
+			Linear,			//!< BDEF1, BDEF2, BDEF4
+			SDEF,			//!< m_boneIndex[0, 1] と m_sdef* を使う
+			DualQuaternion,	//!< QDEF
+		};
+
+		int32_t		m_boneIndex[4];
+		float		m_boneWeight[4];
+		Type		m_type;
+		glm::vec3	m_sdefC;
+		glm::vec3	m_sdefR0;
+		glm::vec3	m_sdefR1;
+	};
+
+	// UpdateSkinning の結果 (次にアニメーションを更新するまで有効)
+	struct MMDSkinningData
+	{
+		const glm::mat4*	m_transforms = nullptr;		//!< ボーンの変形行列 (ノードの数)
+		size_t				m_transformCount = 0;
+		const glm::vec3*	m_morphPositions = nullptr;	//!< モーフによる位置の移動量 (頂点の数)
+		const glm::vec4*	m_morphUVs = nullptr;		//!< モーフによる UV の移動量 (xy を使う. nullptr : UV モーフ無し)
+		// モーフの移動量が 0 でない可能性のある頂点の範囲 [m_morphBegin, m_morphEnd)
+		size_t				m_morphBegin = 0;
+		size_t				m_morphEnd = 0;
+	};
+
 	class VMDAnimation;
 
 	class MMDModel
@@ -174,10 +262,38 @@ namespace saba
 		virtual void UpdatePhysicsAnimation(float elapsed) = 0;
 		// 頂点を更新する
 		virtual void Update() = 0;
+		/*
+			頂点を更新して、結果を sink に直接書き込む (マップした GPU バッファやステージングバッファ向け).
+			GetUpdatePositions/Normals/UVs の内容は更新されない.
+			LOD を選択している場合は、LOD が参照する頂点だけを書き込む.
+		*/
+		virtual void Update(const MMDVertexSink& sink) = 0;
 		virtual void SetParallelUpdateHint(uint32_t parallelCount) = 0;
 
+		/*
+			GPU スキニング用.
+			GetSkinningVertices は頂点の数だけ vertices に書き込む.
+			UpdateSkinning は Update の代わりに呼び、ボーンの変形行列とモーフの移動量だけを更新する (頂点は更新しない).
+			スキニングの計算は Update と同じ (GetPositions + m_morphPositions をボーンで変形する).
+		*/
+		virtual void GetSkinningVertices(MMDSkinningVertex* vertices) const = 0;
+		virtual void UpdateSkinning(MMDSkinningData* data) = 0;
+
+		/*
+			LOD (0 : 元のメッシュ)
+			Update は選択した LOD が参照する頂点だけを更新する.
+			approximateSkinning が true の場合は BDEF2 で近似してスキニングする.
+		*/
+		virtual size_t GetLODCount() const { return 1; }
+		virtual const MMDMeshLOD* GetMeshLOD(size_t /*lod*/) const { return nullptr; }
+		virtual void SetLOD(size_t /*lod*/, bool /*approximateSkinning*/) {}
+		virtual size_t GetLOD() const { return 0; }
+		virtual bool IsApproximateSkinning() const { return false; }
+
 		void UpdateAllAnimation(VMDAnimation* vmdAnim, float vmdFrame, float physicsElapsed);
 		void LoadPose(const VPDFile& vpd, int frameCount = 30);
+		// binding は library.Bind(this, &binding) で作ったもの
+		void LoadPose(const MMDPoseLibrary& library, size_t poseIndex, const MMDPoseLibrary::Binding& binding, int frameCount = 30);
 
 	protected:
 		template <typename NodeType>
@@ -326,6 +442,22 @@ namespace saba
 		private:
 			std::vector<MorphPtr>	m_morphs;
 		};
+
+	private:
+		struct PoseNode
+		{
+			MMDNode*	m_node;
+			glm::vec3	m_translate;
+			glm::quat	m_rotate;
+		};
+
+		struct PoseMorph
+		{
+			MMDMorph*	m_morph;
+			float		m_weight;
+		};
+
+		void LoadPose(const std::vector<PoseNode>& poses, const std::vector<PoseMorph>& morphs, int frameCount);
 	};
 }
 
@@ -0,0 +1,415 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "MMDPoseLibrary.h"
+#include "MMDModel.h"
+
+#include <Saba/Base/File.h>
+#include <Saba/Base/Log.h>
+
+#include <cstring>
+
+namespace saba
+{
+	namespace
+	{
+		const char PoseLibraryMagic[4] = { 'S', 'P', 'L', 'B' };
+		const uint32_t PoseLibraryVersion = 1;
+
+		/*
+			Header
+			FileString[boneNameCount + morphNameCount + poseCount] (ボーン名、モーフ名、ポーズ名の順)
+			FilePose[poseCount]
+			FileBoneKey[boneKeyCount]
+			FileMorphKey[morphKeyCount]
+			char[stringSize]
+		*/
+		struct FileHeader
+		{
+			char		m_magic[4];		//!< "SPLB"
+			uint32_t	m_version;
+			uint32_t	m_boneNameCount;
+			uint32_t	m_morphNameCount;
+			uint32_t	m_poseCount;
+			uint32_t	m_boneKeyCount;
+			uint32_t	m_morphKeyCount;
+			uint32_t	m_stringSize;
+		};
+
+		struct FileString
+		{
+			uint32_t	m_offset;
+			uint32_t	m_length;
+		};
+
+		struct FilePose
+		{
+			uint32_t	m_boneKeyOffset;
+			uint32_t	m_boneKeyCount;
+			uint32_t	m_morphKeyOffset;
+			uint32_t	m_morphKeyCount;
+		};
+
+		struct FileBoneKey
+		{
+			uint32_t	m_nameIndex;
+			float		m_translate[3];
+			float		m_quaternion[4];	//!< x, y, z, w
+		};
+
+		struct FileMorphKey
+		{
+			uint32_t	m_nameIndex;
+			float		m_weight;
+		};
+
+		template <typename T>
+		bool ReadArray(const uint8_t** cur, const uint8_t* end, size_t count, const T** data)
+		{
+			if (size_t(end - *cur) / sizeof(T) < count)
+			{
+				return false;
+			}
+			*data = reinterpret_cast<const T*>(*cur);
+			*cur += sizeof(T) * count;
+			return true;
+		}
+
+		template <typename T>
+		bool WriteArray(File& file, const std::vector<T>& data)
+		{
+			return data.empty() || file.Write(data.data(), data.size());
+		}
+
+		bool ReadStrings(const FileString* strings, size_t count, const char* stringData, size_t stringSize, std::vector<std::string>* names)
+		{
+			names->resize(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				const auto& str = strings[i];
+				if (str.m_offset > stringSize || str.m_length > stringSize - str.m_offset)
+				{
+					return false;
+				}
+				(*names)[i].assign(stringData + str.m_offset, str.m_length);
+			}
+			return true;
+		}
+	}
+
+	void MMDPoseLibrary::Clear()
+	{
+		m_boneNames.clear();
+		m_morphNames.clear();
+		m_poses.clear();
+		m_boneKeys.clear();
+		m_morphKeys.clear();
+		m_boneNameIndices.clear();
+		m_morphNameIndices.clear();
+	}
+
+	uint32_t MMDPoseLibrary::AddName(const std::string& name, std::vector<std::string>* names, std::unordered_map<std::string, uint32_t>* nameIndices)
+	{
+		auto findIt = nameIndices->find(name);
+		if (findIt != nameIndices->end())
+		{
+			return findIt->second;
+		}
+		uint32_t index = uint32_t(names->size());
+		names->push_back(name);
+		nameIndices->emplace(name, index);
+		return index;
+	}
+
+	void MMDPoseLibrary::RebuildNameIndices()
+	{
+		m_boneNameIndices.clear();
+		for (size_t i = 0; i < m_boneNames.size(); i++)
+		{
+			m_boneNameIndices.emplace(m_boneNames[i], uint32_t(i));
+		}
+		m_morphNameIndices.clear();
+		for (size_t i = 0; i < m_morphNames.size(); i++)
+		{
+			m_morphNameIndices.emplace(m_morphNames[i], uint32_t(i));
+		}
+	}
+
+	size_t MMDPoseLibrary::AddPose(const std::string& name, const VPDFile& vpd)
+	{
+		Pose pose;
+		pose.m_name = name;
+		pose.m_boneKeyOffset = uint32_t(m_boneKeys.size());
+		pose.m_boneKeyCount = uint32_t(vpd.m_bones.size());
+		pose.m_morphKeyOffset = uint32_t(m_morphKeys.size());
+		pose.m_morphKeyCount = uint32_t(vpd.m_morphs.size());
+
+		for (const auto& bone : vpd.m_bones)
+		{
+			BoneKey key;
+			key.m_nameIndex = AddName(bone.m_boneName, &m_boneNames, &m_boneNameIndices);
+			key.m_translate = bone.m_translate;
+			key.m_quaternion = bone.m_quaternion;
+			m_boneKeys.push_back(key);
+		}
+		for (const auto& morph : vpd.m_morphs)
+		{
+			MorphKey key;
+			key.m_nameIndex = AddName(morph.m_morphName, &m_morphNames, &m_morphNameIndices);
+			key.m_weight = morph.m_weight;
+			m_morphKeys.push_back(key);
+		}
+
+		m_poses.emplace_back(std::move(pose));
+		return m_poses.size() - 1;
+	}
+
+	bool MMDPoseLibrary::GetPose(size_t poseIndex, VPDFile * vpd) const
+	{
+		if (poseIndex >= m_poses.size())
+		{
+			return false;
+		}
+
+		const auto& pose = m_poses[poseIndex];
+		vpd->m_bones.resize(pose.m_boneKeyCount);
+		const BoneKey* boneKeys = GetBoneKeys(pose);
+		for (uint32_t i = 0; i < pose.m_boneKeyCount; i++)
+		{
+			auto& bone = vpd->m_bones[i];
+			bone.m_boneName = m_boneNames[boneKeys[i].m_nameIndex];
+			bone.m_translate = boneKeys[i].m_translate;
+			bone.m_quaternion = boneKeys[i].m_quaternion;
+		}
+		vpd->m_morphs.resize(pose.m_morphKeyCount);
+		const MorphKey* morphKeys = GetMorphKeys(pose);
+		for (uint32_t i = 0; i < pose.m_morphKeyCount; i++)
+		{
+			auto& morph = vpd->m_morphs[i];
+			morph.m_morphName = m_morphNames[morphKeys[i].m_nameIndex];
+			morph.m_weight = morphKeys[i].m_weight;
+		}
+		return true;
+	}
+
+	size_t MMDPoseLibrary::FindPose(const std::string & name) const
+	{
+		for (size_t i = 0; i < m_poses.size(); i++)
+		{
+			if (m_poses[i].m_name == name)
+			{
+				return i;
+			}
+		}
+		return NPos;
+	}
+
+	void MMDPoseLibrary::Bind(MMDModel * model, Binding * binding) const
+	{
+		auto nodeMan = model->GetNodeManager();
+		binding->m_nodes.resize(m_boneNames.size());
+		for (size_t i = 0; i < m_boneNames.size(); i++)
+		{
+			auto nodeIdx = nodeMan->FindNodeIndex(m_boneNames[i]);
+			binding->m_nodes[i] = nodeIdx != MMDNodeManager::NPos ? nodeMan->GetMMDNode(nodeIdx) : nullptr;
+		}
+
+		auto morphMan = model->GetMorphManager();
+		binding->m_morphs.resize(m_morphNames.size());
+		for (size_t i = 0; i < m_morphNames.size(); i++)
+		{
+			auto morphIdx = morphMan->FindMorphIndex(m_morphNames[i]);
+			binding->m_morphs[i] = morphIdx != MMDMorphManager::NPos ? morphMan->GetMorph(morphIdx) : nullptr;
+		}
+	}
+
+	bool MMDPoseLibrary::Load(const char * filename)
+	{
+		Clear();
+
+		MappedFile file;
+		if (!file.Open(filename))
+		{
+			SABA_WARN("Pose Library File Open Fail. {}", filename);
+			return false;
+		}
+
+		const uint8_t* cur = file.GetData();
+		const uint8_t* end = cur + file.GetSize();
+		const FileHeader* header;
+		if (!ReadArray(&cur, end, 1, &header) ||
+			memcmp(header->m_magic, PoseLibraryMagic, sizeof(PoseLibraryMagic)) != 0 ||
+			header->m_version != PoseLibraryVersion)
+		{
+			SABA_WARN("Pose Library File Format Error. {}", filename);
+			return false;
+		}
+
+		const FileString* strings;
+		const FilePose* poses;
+		const FileBoneKey* boneKeys;
+		const FileMorphKey* morphKeys;
+		const char* stringData;
+		size_t stringCount = size_t(header->m_boneNameCount) + header->m_morphNameCount + header->m_poseCount;
+		if (!ReadArray(&cur, end, stringCount, &strings) ||
+			!ReadArray(&cur, end, header->m_poseCount, &poses) ||
+			!ReadArray(&cur, end, header->m_boneKeyCount, &boneKeys) ||
+			!ReadArray(&cur, end, header->m_morphKeyCount, &morphKeys) ||
+			!ReadArray(&cur, end, header->m_stringSize, &stringData))
+		{
+			SABA_WARN("Pose Library File Size Error. {}", filename);
+			return false;
+		}
+
+		std::vector<std::string> poseNames;
+		if (!ReadStrings(strings, header->m_boneNameCount, stringData, header->m_stringSize, &m_boneNames) ||
+			!ReadStrings(strings + header->m_boneNameCount, header->m_morphNameCount, stringData, header->m_stringSize, &m_morphNames) ||
+			!ReadStrings(strings + header->m_boneNameCount + header->m_morphNameCount, header->m_poseCount, stringData, header->m_stringSize, &poseNames))
+		{
+			SABA_WARN("Pose Library File String Error. {}", filename);
+			Clear();
+			return false;
+		}
+
+		m_poses.resize(header->m_poseCount);
+		for (size_t i = 0; i < m_poses.size(); i++)
+		{
+			const auto& src = poses[i];
+			if (src.m_boneKeyOffset > header->m_boneKeyCount ||
+				src.m_boneKeyCount > header->m_boneKeyCount - src.m_boneKeyOffset ||
+				src.m_morphKeyOffset > header->m_morphKeyCount ||
+				src.m_morphKeyCount > header->m_morphKeyCount - src.m_morphKeyOffset)
+			{
+				SABA_WARN("Pose Library File Pose Error. {}", filename);
+				Clear();
+				return false;
+			}
+			auto& dst = m_poses[i];
+			dst.m_name = std::move(poseNames[i]);
+			dst.m_boneKeyOffset = src.m_boneKeyOffset;
+			dst.m_boneKeyCount = src.m_boneKeyCount;
+			dst.m_morphKeyOffset = src.m_morphKeyOffset;
+			dst.m_morphKeyCount = src.m_morphKeyCount;
+		}
+
+		m_boneKeys.resize(header->m_boneKeyCount);
+		for (size_t i = 0; i < m_boneKeys.size(); i++)
+		{
+			const auto& src = boneKeys[i];
+			if (src.m_nameIndex >= m_boneNames.size())
+			{
+				SABA_WARN("Pose Library File Bone Error. {}", filename);
+				Clear();
+				return false;
+			}
+			auto& dst = m_boneKeys[i];
+			dst.m_nameIndex = src.m_nameIndex;
+			dst.m_translate = glm::vec3(src.m_translate[0], src.m_translate[1], src.m_translate[2]);
+			dst.m_quaternion = glm::quat(src.m_quaternion[3], src.m_quaternion[0], src.m_quaternion[1], src.m_quaternion[2]);
+		}
+
+		m_morphKeys.resize(header->m_morphKeyCount);
+		for (size_t i = 0; i < m_morphKeys.size(); i++)
+		{
+			const auto& src = morphKeys[i];
+			if (src.m_nameIndex >= m_morphNames.size())
+			{
+				SABA_WARN("Pose Library File Morph Error. {}", filename);
+				Clear();
+				return false;
+			}
+			m_morphKeys[i].m_nameIndex = src.m_nameIndex;
+			m_morphKeys[i].m_weight = src.m_weight;
+		}
+
+		RebuildNameIndices();
+		return true;
+	}
+
+	bool MMDPoseLibrary::Save(const char * filename) const
+	{
+		std::vector<FileString> strings;
+		std::vector<char> stringData;
+		auto addString = [&strings, &stringData](const std::string& str)
+		{
+			FileString fileStr;
+			fileStr.m_offset = uint32_t(stringData.size());
+			fileStr.m_length = uint32_t(str.size());
+			stringData.insert(stringData.end(), str.begin(), str.end());
+			strings.push_back(fileStr);
+		};
+		for (const auto& name : m_boneNames)
+		{
+			addString(name);
+		}
+		for (const auto& name : m_morphNames)
+		{
+			addString(name);
+		}
+		for (const auto& pose : m_poses)
+		{
+			addString(pose.m_name);
+		}
+
+		std::vector<FilePose> poses(m_poses.size());
+		for (size_t i = 0; i < m_poses.size(); i++)
+		{
+			poses[i].m_boneKeyOffset = m_poses[i].m_boneKeyOffset;
+			poses[i].m_boneKeyCount = m_poses[i].m_boneKeyCount;
+			poses[i].m_morphKeyOffset = m_poses[i].m_morphKeyOffset;
+			poses[i].m_morphKeyCount = m_poses[i].m_morphKeyCount;
+		}
+
+		std::vector<FileBoneKey> boneKeys(m_boneKeys.size());
+		for (size_t i = 0; i < m_boneKeys.size(); i++)
+		{
+			const auto& src = m_boneKeys[i];
+			auto& dst = boneKeys[i];
+			dst.m_nameIndex = src.m_nameIndex;
+			dst.m_translate[0] = src.m_translate.x;
+			dst.m_translate[1] = src.m_translate.y;
+			dst.m_translate[2] = src.m_translate.z;
+			dst.m_quaternion[0] = src.m_quaternion.x;
+			dst.m_quaternion[1] = src.m_quaternion.y;
+			dst.m_quaternion[2] = src.m_quaternion.z;
+			dst.m_quaternion[3] = src.m_quaternion.w;
+		}
+
+		std::vector<FileMorphKey> morphKeys(m_morphKeys.size());
+		for (size_t i = 0; i < m_morphKeys.size(); i++)
+		{
+			morphKeys[i].m_nameIndex = m_morphKeys[i].m_nameIndex;
+			morphKeys[i].m_weight = m_morphKeys[i].m_weight;
+		}
+
+		FileHeader header;
+		memcpy(header.m_magic, PoseLibraryMagic, sizeof(PoseLibraryMagic));
+		header.m_version = PoseLibraryVersion;
+		header.m_boneNameCount = uint32_t(m_boneNames.size());
+		header.m_morphNameCount = uint32_t(m_morphNames.size());
+		header.m_poseCount = uint32_t(m_poses.size());
+		header.m_boneKeyCount = uint32_t(boneKeys.size());
+		header.m_morphKeyCount = uint32_t(morphKeys.size());
+		header.m_stringSize = uint32_t(stringData.size());
+
+		File file;
+		if (!file.Create(filename))
+		{
+			SABA_WARN("Pose Library File Create Fail. {}", filename);
+			return false;
+		}
+		if (!file.Write(&header) ||
+			!WriteArray(file, strings) ||
+			!WriteArray(file, poses) ||
+			!WriteArray(file, boneKeys) ||
+			!WriteArray(file, morphKeys) ||
+			!WriteArray(file, stringData))
+		{
+			SABA_WARN("Pose Library File Write Fail. {}", filename);
+			return false;
+		}
+		return true;
+	}
+}
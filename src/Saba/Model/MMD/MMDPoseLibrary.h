@@ -0,0 +1,101 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_MODEL_MMD_MMDPOSELIBRARY_H_
+#define SABA_MODEL_MMD_MMDPOSELIBRARY_H_
+
+#include "VPDFile.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace saba
+{
+	class MMDModel;
+	class MMDNode;
+	class MMDMorph;
+
+	/*
+		複数のポーズ (VPD) を 1 つにまとめたバイナリファイル.
+		ボーン名、モーフ名はライブラリ全体で 1 つの名前テーブルに持ち、各ポーズは名前のインデックスで参照する.
+		モデルに適用する場合は Bind で名前を一度だけノード、モーフに対応付け、
+		MMDModel::LoadPose(library, poseIndex, binding) を使う.
+	*/
+	class MMDPoseLibrary
+	{
+	public:
+		static const size_t NPos = size_t(-1);
+
+		struct BoneKey
+		{
+			uint32_t	m_nameIndex;	//!< GetBoneNames() のインデックス
+			glm::vec3	m_translate;
+			glm::quat	m_quaternion;
+		};
+
+		struct MorphKey
+		{
+			uint32_t	m_nameIndex;	//!< GetMorphNames() のインデックス
+			float		m_weight;
+		};
+
+		struct Pose
+		{
+			std::string	m_name;
+			uint32_t	m_boneKeyOffset;
+			uint32_t	m_boneKeyCount;
+			uint32_t	m_morphKeyOffset;
+			uint32_t	m_morphKeyCount;
+		};
+
+		// 名前テーブルを解決した結果 (見つからない名前は nullptr)
+		struct Binding
+		{
+			std::vector<MMDNode*>	m_nodes;
+			std::vector<MMDMorph*>	m_morphs;
+		};
+
+		void Clear();
+
+		// 同じ名前のポーズがある場合も追加する. 追加したポーズのインデックスを返す
+		size_t AddPose(const std::string& name, const VPDFile& vpd);
+		bool GetPose(size_t poseIndex, VPDFile* vpd) const;
+		size_t FindPose(const std::string& name) const;
+
+		size_t GetPoseCount() const { return m_poses.size(); }
+		const Pose& GetPose(size_t poseIndex) const { return m_poses[poseIndex]; }
+		const BoneKey* GetBoneKeys(const Pose& pose) const { return m_boneKeys.data() + pose.m_boneKeyOffset; }
+		const MorphKey* GetMorphKeys(const Pose& pose) const { return m_morphKeys.data() + pose.m_morphKeyOffset; }
+
+		const std::vector<std::string>& GetBoneNames() const { return m_boneNames; }
+		const std::vector<std::string>& GetMorphNames() const { return m_morphNames; }
+
+		void Bind(MMDModel* model, Binding* binding) const;
+
+		bool Load(const char* filename);
+		bool Save(const char* filename) const;
+
+	private:
+		static uint32_t AddName(const std::string& name, std::vector<std::string>* names, std::unordered_map<std::string, uint32_t>* nameIndices);
+		void RebuildNameIndices();
+
+	private:
+		std::vector<std::string>	m_boneNames;
+		std::vector<std::string>	m_morphNames;
+		std::vector<Pose>			m_poses;
+		std::vector<BoneKey>		m_boneKeys;
+		std::vector<MorphKey>		m_morphKeys;
+
+		std::unordered_map<std::string, uint32_t>	m_boneNameIndices;
+		std::unordered_map<std::string, uint32_t>	m_morphNameIndices;
+	};
+}
+
+#endif // !SABA_MODEL_MMD_MMDPOSELIBRARY_H_
@@ -10,6 +10,7 @@
 #include <Saba/Base/Path.h>
 #include <Saba/Base/File.h>
 #include <Saba/Base/Log.h>
+#include <Saba/Base/Trace.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -77,6 +78,7 @@ namespace saba
 		for (auto& solver : (*m_ikSolverMan.GetIKSolvers()))
 		{
 			solver->Enable(true);
+			solver->ClearWarmStart();
 			solver->Solve();
 		}
 
@@ -101,10 +103,14 @@ namespace saba
 
 	void PMDModel::UpdateMorphAnimation()
 	{
+		SABA_TRACE_SCOPE("PMDModel::UpdateMorphAnimation");
+
 	}
 
 	void PMDModel::UpdateNodeAnimation(bool afterPhysicsAnim)
 	{
+		SABA_TRACE_SCOPE("PMDModel::UpdateNodeAnimation");
+
 		if (afterPhysicsAnim)
 		{
 			return;
@@ -174,6 +180,8 @@ namespace saba
 
 	void PMDModel::UpdatePhysicsAnimation(float elapsed)
 	{
+		SABA_TRACE_SCOPE("PMDModel::UpdatePhysicsAnimation");
+
 		MMDPhysicsManager* physicsMan = GetPhysicsManager();
 		auto physics = physicsMan->GetMMDPhysics();
 
@@ -211,28 +219,26 @@ namespace saba
 
 	void PMDModel::Update()
 	{
-		const auto* position = &m_positions[0];
+		// UV は変化しないので GetUpdateUVs は m_uvs を返す
+		MMDVertexSink sink;
+		sink.m_positions.m_data = m_updatePositions.data();
+		sink.m_normals.m_data = m_updateNormals.data();
+		Update(sink);
+	}
+
+	void PMDModel::Update(const MMDVertexSink& sink)
+	{
+		SABA_TRACE_SCOPE("PMDModel::Update");
+
 		const auto* normal = &m_normals[0];
 		const auto* bone = &m_bones[0];
 		const auto* boneWeight = &m_boneWeights[0];
+		// Morph を適用した位置は m_updatePositions に作る
 		auto* updatePosition = &m_updatePositions[0];
-		auto* updateNormal = &m_updateNormals[0];
 
 		// 頂点をコピー
-		auto srcPos = position;
-		auto srcNor = normal;
-		auto destPos = updatePosition;
-		auto destNor = updateNormal;
 		size_t numVertices = m_positions.size();
-		for (size_t i = 0; i < numVertices; i++)
-		{
-			*destPos = *srcPos;
-			*destNor = *srcNor;
-			srcPos++;
-			srcNor++;
-			destPos++;
-			destNor++;
-		}
+		std::copy(m_positions.begin(), m_positions.end(), m_updatePositions.begin());
 
 		// Morph の処理
 		if (m_baseMorph.m_vertices.empty())
@@ -271,35 +277,134 @@ namespace saba
 			}
 		}
 
-		// スキンメッシュに使用する変形マトリクスを事前計算
-		auto& nodes = (*m_nodeMan.GetNodes());
-		for (size_t i = 0; i < nodes.size(); i++)
-		{
-			m_transforms[i] = nodes[i]->GetGlobalTransform() * nodes[i]->GetInverseInitTransform();
-		}
+		UpdateTransforms();
 
+		const MMDVertexStreamWriter positionWriter(sink.m_positions, sizeof(glm::vec3));
+		const MMDVertexStreamWriter normalWriter(sink.m_normals, sizeof(glm::vec3));
+		const MMDVertexStreamWriter uvWriter(sink.m_uvs, sizeof(glm::vec2));
 		for (size_t i = 0; i < numVertices; i++)
 		{
-			auto node0 = m_nodeMan.GetNode(bone->x);
-			auto node1 = m_nodeMan.GetNode(bone->y);
 			auto w0 = boneWeight->x;
 			auto w1 = boneWeight->y;
 			const auto& m0 = m_transforms[bone->x];
 			const auto& m1 = m_transforms[bone->y];
 
 			auto m = m0 * w0 + m1 * w1;
-			*updatePosition = glm::vec3(m * glm::vec4(*updatePosition, 1));
-			*updateNormal = glm::normalize(glm::mat3(m) * *updateNormal);
+			positionWriter.Write(i, glm::vec3(m * glm::vec4(*updatePosition, 1)));
+			normalWriter.Write(i, glm::normalize(glm::mat3(m) * *normal));
+			uvWriter.Write(i, m_uvs[i]);
 
 			bone++;
 			boneWeight++;
 			updatePosition++;
-			updateNormal++;
+			normal++;
+		}
+	}
+
+	void PMDModel::UpdateTransforms()
+	{
+		// スキンメッシュに使用する変形マトリクスを事前計算
+		auto& nodes = (*m_nodeMan.GetNodes());
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			m_transforms[i] = nodes[i]->GetGlobalTransform() * nodes[i]->GetInverseInitTransform();
+		}
+	}
+
+	void PMDModel::GetSkinningVertices(MMDSkinningVertex* vertices) const
+	{
+		for (size_t i = 0; i < m_positions.size(); i++)
+		{
+			auto& dest = vertices[i];
+			dest.m_boneIndex[0] = m_bones[i].x;
+			dest.m_boneIndex[1] = m_bones[i].y;
+			dest.m_boneIndex[2] = 0;
+			dest.m_boneIndex[3] = 0;
+			dest.m_boneWeight[0] = m_boneWeights[i].x;
+			dest.m_boneWeight[1] = m_boneWeights[i].y;
+			dest.m_boneWeight[2] = 0;
+			dest.m_boneWeight[3] = 0;
+			dest.m_type = MMDSkinningVertex::Type::Linear;
+			dest.m_sdefC = glm::vec3(0);
+			dest.m_sdefR0 = glm::vec3(0);
+			dest.m_sdefR1 = glm::vec3(0);
 		}
 	}
 
+	void PMDModel::UpdateSkinning(MMDSkinningData* data)
+	{
+		SABA_TRACE_SCOPE("PMDModel::UpdateSkinning");
+
+		// 前回モーフで変更した範囲だけ 0 に戻す
+		std::fill(m_morphPositions.begin() + m_morphBegin, m_morphPositions.begin() + m_morphEnd, glm::vec3(0));
+		m_morphBegin = 0;
+		m_morphEnd = 0;
+		auto addMorph = [this](size_t vtxIdx, const glm::vec3& offset)
+		{
+			m_morphPositions[vtxIdx] += offset;
+			if (m_morphBegin == m_morphEnd)
+			{
+				m_morphBegin = vtxIdx;
+				m_morphEnd = vtxIdx + 1;
+			}
+			else
+			{
+				m_morphBegin = std::min(m_morphBegin, vtxIdx);
+				m_morphEnd = std::max(m_morphEnd, vtxIdx + 1);
+			}
+		};
+
+		// Update と同じ Morph を、元の位置からの移動量として求める
+		if (m_baseMorph.m_vertices.empty())
+		{
+			for (const auto& morph : (*m_morphMan.GetMorphs()))
+			{
+				float weight = morph->GetWeight();
+				if (weight == 0.0f)
+				{
+					continue;
+				}
+				for (const auto& morphVtx : morph->m_vertices)
+				{
+					addMorph(morphVtx.m_index, morphVtx.m_position * weight);
+				}
+			}
+		}
+		else
+		{
+			for (const auto& morphVtx : m_baseMorph.m_vertices)
+			{
+				addMorph(morphVtx.m_index, morphVtx.m_position - m_positions[morphVtx.m_index]);
+			}
+			for (const auto& morph : (*m_morphMan.GetMorphs()))
+			{
+				float weight = morph->GetWeight();
+				if (weight == 0.0f)
+				{
+					continue;
+				}
+				for (const auto& morphVtx : morph->m_vertices)
+				{
+					const auto& baseMorphVtx = m_baseMorph.m_vertices[morphVtx.m_index];
+					addMorph(baseMorphVtx.m_index, morphVtx.m_position * weight);
+				}
+			}
+		}
+
+		UpdateTransforms();
+
+		data->m_transforms = m_transforms.data();
+		data->m_transformCount = m_transforms.size();
+		data->m_morphPositions = m_morphPositions.data();
+		data->m_morphUVs = nullptr;
+		data->m_morphBegin = m_morphBegin;
+		data->m_morphEnd = m_morphEnd;
+	}
+
 	bool PMDModel::Load(const std::string& filepath, const std::string& mmdDataDir)
 	{
+		SABA_TRACE_SCOPE("PMDModel::Load");
+
 		Destroy();
 
 		PMDFile pmd;
@@ -335,6 +440,9 @@ namespace saba
 		}
 		m_updatePositions.resize(m_positions.size());
 		m_updateNormals.resize(m_normals.size());
+		m_morphPositions.assign(m_positions.size(), glm::vec3(0));
+		m_morphBegin = 0;
+		m_morphEnd = 0;
 
 		m_indices.reserve(pmd.m_faces.size() * 3);
 		for (const auto& face : pmd.m_faces)
@@ -528,6 +636,7 @@ namespace saba
 
 			solver->SetIterateCount(ik.m_numIteration);
 			solver->SetLimitAngle(ik.m_rotateLimit * 4.0f);
+			solver->SetupSolveMode();
 		}
 
 		if (!m_physicsMan.Create())
@@ -59,7 +59,10 @@ namespace saba
 		void UpdatePhysicsAnimation(float elapsed) override;
 		// 頂点データーを更新する
 		void Update() override;
+		void Update(const MMDVertexSink& sink) override;
 		void SetParallelUpdateHint(uint32_t) override {}
+		void GetSkinningVertices(MMDSkinningVertex* vertices) const override;
+		void UpdateSkinning(MMDSkinningData* data) override;
 
 		bool Load(const std::string& filepath, const std::string& mmdDataDir);
 		void Destroy();
@@ -69,6 +72,9 @@ namespace saba
 
 	protected:
 
+	private:
+		void UpdateTransforms();
+
 	private:
 		struct MorphVertex
 		{
@@ -92,6 +98,11 @@ namespace saba
 		std::vector<glm::vec3>	m_updateNormals;
 		std::vector<glm::mat4>	m_transforms;
 
+		// GPU スキニング用のモーフによる移動量. [m_morphBegin, m_morphEnd) の範囲外は 0
+		std::vector<glm::vec3>	m_morphPositions;
+		size_t					m_morphBegin = 0;
+		size_t					m_morphEnd = 0;
+
 		std::vector<uint16_t> m_indices;
 
 		PMDMorph					m_baseMorph;
@@ -0,0 +1,272 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "PMXCache.h"
+
+#include <Saba/Base/Log.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace saba
+{
+	namespace
+	{
+		const char CacheMagic[4] = { 'S', 'P', 'M', 'C' };
+		const uint32_t StringSectionID = 0xFFFFFFFF;
+		const uint64_t SectionAlignment = 16;
+
+		uint64_t Align(uint64_t offset)
+		{
+			return (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+		}
+
+		// FNV-1a
+		uint64_t ComputeHash(const uint8_t* data, size_t size)
+		{
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < size; i++)
+			{
+				hash ^= data[i];
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+
+		bool ComputeFileHash(const std::string& filepath, uint64_t* hash)
+		{
+			MappedFile file;
+			if (!file.Open(filepath))
+			{
+				return false;
+			}
+			*hash = ComputeHash(file.GetData(), file.GetSize());
+			return true;
+		}
+	}
+
+	std::string GetPMXCachePath(const std::string& pmxPath)
+	{
+		return pmxPath + ".sabacache";
+	}
+
+	PMXCacheString PMXCacheWriter::AddString(const std::string& str)
+	{
+		PMXCacheString cacheStr;
+		cacheStr.m_offset = uint32_t(m_strings.size());
+		cacheStr.m_length = uint32_t(str.size());
+		m_strings.insert(m_strings.end(), str.begin(), str.end());
+		return cacheStr;
+	}
+
+	void PMXCacheWriter::AddSection(uint32_t id, size_t elementSize, const void* data, size_t count)
+	{
+		Section section;
+		section.m_id = id;
+		section.m_elementSize = uint32_t(elementSize);
+		section.m_count = count;
+		const uint8_t* begin = (const uint8_t*)data;
+		section.m_data.assign(begin, begin + elementSize * count);
+		m_sections.emplace_back(std::move(section));
+	}
+
+	bool PMXCacheWriter::Write(const std::string& cachePath, const std::string& sourcePath)
+	{
+		FileStatus sourceStatus;
+		uint64_t sourceHash;
+		if (!GetFileStatus(sourcePath, &sourceStatus) || !ComputeFileHash(sourcePath, &sourceHash))
+		{
+			SABA_WARN("Failed to read PMX cache source. [{}]", sourcePath);
+			return false;
+		}
+
+		std::vector<PMXCacheSection> table;
+		table.reserve(m_sections.size() + 1);
+		uint64_t offset = Align(sizeof(PMXCacheHeader) + sizeof(PMXCacheSection) * (m_sections.size() + 1));
+		for (const auto& section : m_sections)
+		{
+			table.push_back(PMXCacheSection{ section.m_id, section.m_elementSize, offset, section.m_count });
+			offset = Align(offset + section.m_data.size());
+		}
+		table.push_back(PMXCacheSection{ StringSectionID, 1, offset, m_strings.size() });
+		offset = Align(offset + m_strings.size());
+
+		std::vector<uint8_t> buffer(size_t(offset), 0);
+		PMXCacheHeader header;
+		memcpy(header.m_magic, CacheMagic, sizeof(CacheMagic));
+		header.m_version = PMXCacheVersion;
+		header.m_headerSize = sizeof(PMXCacheHeader);
+		header.m_sectionCount = uint32_t(table.size());
+		header.m_fileSize = offset;
+		header.m_sourceSize = sourceStatus.m_size;
+		header.m_sourceTime = sourceStatus.m_lastWriteTime;
+		header.m_sourceHash = sourceHash;
+		memcpy(buffer.data(), &header, sizeof(header));
+		memcpy(buffer.data() + sizeof(header), table.data(), sizeof(PMXCacheSection) * table.size());
+		for (size_t i = 0; i < m_sections.size(); i++)
+		{
+			if (!m_sections[i].m_data.empty())
+			{
+				memcpy(buffer.data() + table[i].m_offset, m_sections[i].m_data.data(), m_sections[i].m_data.size());
+			}
+		}
+		if (!m_strings.empty())
+		{
+			memcpy(buffer.data() + table.back().m_offset, m_strings.data(), m_strings.size());
+		}
+
+		std::string tempPath = cachePath + ".tmp";
+		{
+			File file;
+			if (!file.Create(tempPath) || !file.Write(buffer.data(), buffer.size()))
+			{
+				SABA_WARN("Failed to write PMX cache. [{}]", tempPath);
+				file.Close();
+				std::remove(tempPath.c_str());
+				return false;
+			}
+		}
+#if _WIN32
+		std::remove(cachePath.c_str());
+#endif // _WIN32
+		if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0)
+		{
+			SABA_WARN("Failed to rename PMX cache. [{}]", cachePath);
+			std::remove(tempPath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	PMXCacheReader::PMXCacheReader()
+		: m_sections(nullptr)
+		, m_sectionCount(0)
+		, m_strings(nullptr)
+		, m_stringsSize(0)
+	{
+	}
+
+	bool PMXCacheReader::Open(const std::string& cachePath, const std::string& sourcePath)
+	{
+		Close();
+
+		FileStatus sourceStatus;
+		if (!GetFileStatus(sourcePath, &sourceStatus))
+		{
+			return false;
+		}
+		if (!m_file.Open(cachePath))
+		{
+			return false;
+		}
+
+		const uint8_t* data = m_file.GetData();
+		const size_t size = m_file.GetSize();
+		PMXCacheHeader header;
+		if (size < sizeof(header))
+		{
+			SABA_INFO("PMX cache is broken. [{}]", cachePath);
+			Close();
+			return false;
+		}
+		memcpy(&header, data, sizeof(header));
+		if (memcmp(header.m_magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+			header.m_version != PMXCacheVersion ||
+			header.m_headerSize != sizeof(PMXCacheHeader) ||
+			header.m_fileSize != size ||
+			header.m_sectionCount > (size - sizeof(header)) / sizeof(PMXCacheSection))
+		{
+			SABA_INFO("PMX cache version mismatch. [{}]", cachePath);
+			Close();
+			return false;
+		}
+
+		if (header.m_sourceSize != sourceStatus.m_size)
+		{
+			SABA_INFO("PMX cache is out of date. [{}]", cachePath);
+			Close();
+			return false;
+		}
+		if (header.m_sourceTime != sourceStatus.m_lastWriteTime)
+		{
+			// コピーなどで更新時刻だけ変わった場合
+			uint64_t sourceHash;
+			if (!ComputeFileHash(sourcePath, &sourceHash) || sourceHash != header.m_sourceHash)
+			{
+				SABA_INFO("PMX cache is out of date. [{}]", cachePath);
+				Close();
+				return false;
+			}
+		}
+
+		m_sections = reinterpret_cast<const PMXCacheSection*>(data + sizeof(header));
+		m_sectionCount = header.m_sectionCount;
+		for (size_t i = 0; i < m_sectionCount; i++)
+		{
+			const auto& section = m_sections[i];
+			if (section.m_offset % SectionAlignment != 0 ||
+				section.m_offset > size ||
+				section.m_elementSize == 0 ||
+				section.m_count > (size - section.m_offset) / section.m_elementSize)
+			{
+				SABA_INFO("PMX cache is broken. [{}]", cachePath);
+				Close();
+				return false;
+			}
+		}
+
+		const void* strings;
+		if (!GetSection(StringSectionID, 1, &strings, &m_stringsSize))
+		{
+			SABA_INFO("PMX cache is broken. [{}]", cachePath);
+			Close();
+			return false;
+		}
+		m_strings = reinterpret_cast<const char*>(strings);
+		return true;
+	}
+
+	void PMXCacheReader::Close()
+	{
+		m_file.Close();
+		m_sections = nullptr;
+		m_sectionCount = 0;
+		m_strings = nullptr;
+		m_stringsSize = 0;
+	}
+
+	bool PMXCacheReader::IsValidString(const PMXCacheString& str) const
+	{
+		return str.m_offset <= m_stringsSize && str.m_length <= m_stringsSize - str.m_offset;
+	}
+
+	std::string PMXCacheReader::GetString(const PMXCacheString& str) const
+	{
+		if (!IsValidString(str))
+		{
+			return "";
+		}
+		return std::string(m_strings + str.m_offset, str.m_length);
+	}
+
+	bool PMXCacheReader::GetSection(uint32_t id, size_t elementSize, const void** data, size_t* count) const
+	{
+		for (size_t i = 0; i < m_sectionCount; i++)
+		{
+			const auto& section = m_sections[i];
+			if (section.m_id == id)
+			{
+				if (section.m_elementSize != elementSize)
+				{
+					return false;
+				}
+				*data = m_file.GetData() + section.m_offset;
+				*count = size_t(section.m_count);
+				return true;
+			}
+		}
+		return false;
+	}
+}
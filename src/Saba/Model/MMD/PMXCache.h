@@ -0,0 +1,131 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_MODEL_MMD_PMXCACHE_H_
+#define SABA_MODEL_MMD_PMXCACHE_H_
+
+#include <Saba/Base/File.h>
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace saba
+{
+	/*
+		PMXModel::Load で変換したデータを保存するキャッシュファイル.
+		固定長の要素を並べたセクションの集まりで、ポインタの代わりにインデックスとオフセットを持つ.
+		読み込み時はマップしたメモリをそのまま参照する.
+
+		元のファイルとはサイズと更新時刻で照合し、更新時刻が違う場合は内容のハッシュで照合する.
+	*/
+	const uint32_t PMXCacheVersion = 2;	//!< 保存するデータの形式を変えたら上げる
+
+	struct PMXCacheString
+	{
+		uint32_t	m_offset;	//!< 文字列テーブルの位置
+		uint32_t	m_length;
+	};
+
+	struct PMXCacheHeader
+	{
+		char		m_magic[4];		//!< "SPMC"
+		uint32_t	m_version;
+		uint32_t	m_headerSize;
+		uint32_t	m_sectionCount;
+		uint64_t	m_fileSize;
+		int64_t		m_sourceSize;
+		int64_t		m_sourceTime;
+		uint64_t	m_sourceHash;
+	};
+
+	struct PMXCacheSection
+	{
+		uint32_t	m_id;
+		uint32_t	m_elementSize;
+		uint64_t	m_offset;
+		uint64_t	m_count;
+	};
+
+	// <pmx file>.sabacache
+	std::string GetPMXCachePath(const std::string& pmxPath);
+
+	class PMXCacheWriter
+	{
+	public:
+		template <typename T>
+		void AddSection(uint32_t id, const T* data, size_t count)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "PMX cache element must be trivially copyable.");
+			AddSection(id, sizeof(T), data, count);
+		}
+
+		template <typename T>
+		void AddSection(uint32_t id, const std::vector<T>& data)
+		{
+			AddSection(id, data.data(), data.size());
+		}
+
+		PMXCacheString AddString(const std::string& str);
+
+		// 一時ファイルに書き出してから置き換えるので、読み込み中の他のプロセスには影響しない
+		bool Write(const std::string& cachePath, const std::string& sourcePath);
+
+	private:
+		void AddSection(uint32_t id, size_t elementSize, const void* data, size_t count);
+
+		struct Section
+		{
+			uint32_t				m_id;
+			uint32_t				m_elementSize;
+			uint64_t				m_count;
+			std::vector<uint8_t>	m_data;
+		};
+
+	private:
+		std::vector<Section>	m_sections;
+		std::vector<char>		m_strings;
+	};
+
+	class PMXCacheReader
+	{
+	public:
+		PMXCacheReader();
+
+		// キャッシュが壊れている場合や sourcePath と一致しない場合は false
+		bool Open(const std::string& cachePath, const std::string& sourcePath);
+		void Close();
+
+		// セクションが無い場合や要素のサイズが違う場合は false
+		template <typename T>
+		bool GetSection(uint32_t id, const T** data, size_t* count) const
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "PMX cache element must be trivially copyable.");
+			const void* sectionData;
+			if (!GetSection(id, sizeof(T), &sectionData, count))
+			{
+				return false;
+			}
+			*data = reinterpret_cast<const T*>(sectionData);
+			return true;
+		}
+
+		bool IsValidString(const PMXCacheString& str) const;
+		std::string GetString(const PMXCacheString& str) const;
+
+	private:
+		bool GetSection(uint32_t id, size_t elementSize, const void** data, size_t* count) const;
+
+	private:
+		MappedFile				m_file;
+		const PMXCacheSection*	m_sections;
+		size_t					m_sectionCount;
+		const char*				m_strings;
+		size_t					m_stringsSize;
+	};
+}
+
+#endif // !SABA_MODEL_MMD_PMXCACHE_H_
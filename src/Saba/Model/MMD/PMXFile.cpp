@@ -7,8 +7,10 @@
 
 #include <Saba/Base/Log.h>
 #include <Saba/Base/File.h>
+#include <Saba/Base/Trace.h>
 #include <Saba/Base/UnicodeUtil.h>
 
+#include <limits>
 #include <vector>
 
 namespace saba
@@ -201,8 +203,8 @@ namespace saba
 					ReadIndex(&vertex.m_boneIndices[3], pmx->m_header.m_boneIndexSize, file);
 					Read(&vertex.m_boneWeights[0], file);
 					Read(&vertex.m_boneWeights[1], file);
+					Read(&vertex.m_boneWeights[2], file);
 					Read(&vertex.m_boneWeights[3], file);
-					Read(&vertex.m_boneWeights[4], file);
 					break;
 				default:
 					return false;
@@ -823,6 +825,8 @@ namespace saba
 
 	bool ReadPMXFile(PMXFile * pmxFile, const char* filename)
 	{
+		SABA_TRACE_SCOPE("ReadPMXFile");
+
 		File file;
 		if (!file.Open(filename))
 		{
@@ -840,5 +844,859 @@ namespace saba
 		return true;
 	}
 
+	namespace
+	{
+		template <typename T>
+		bool Write(const T& val, File& file)
+		{
+			return file.Write(&val);
+		}
+
+		template <typename T>
+		bool Write(const T* valArray, size_t size, File& file)
+		{
+			return file.Write(valArray, size);
+		}
+
+		bool WriteString(const PMXFile* pmx, const std::string& val, File& file)
+		{
+			if (pmx->m_header.m_encode == 0)
+			{
+				// UTF-16
+				std::u16string utf16Str;
+				if (!ConvU8ToU16(val, utf16Str))
+				{
+					return false;
+				}
+				Write(uint32_t(utf16Str.size() * 2), file);
+				if (!utf16Str.empty())
+				{
+					Write(utf16Str.data(), utf16Str.size(), file);
+				}
+			}
+			else
+			{
+				// UTF-8
+				Write(uint32_t(val.size()), file);
+				if (!val.empty())
+				{
+					Write(val.data(), val.size(), file);
+				}
+			}
+
+			return !file.IsBad();
+		}
+
+		// 頂点以外のインデックスは符号付き (-1 はなし)
+		bool WriteIndex(int32_t index, uint8_t indexSize, File& file)
+		{
+			switch (indexSize)
+			{
+			case 1:
+				if (index < -1 || index > std::numeric_limits<int8_t>::max())
+				{
+					SABA_ERROR("PMX index is out of range. [{}]", index);
+					return false;
+				}
+				Write(int8_t(index), file);
+				break;
+			case 2:
+				if (index < -1 || index > std::numeric_limits<int16_t>::max())
+				{
+					SABA_ERROR("PMX index is out of range. [{}]", index);
+					return false;
+				}
+				Write(int16_t(index), file);
+				break;
+			case 4:
+				if (index < -1)
+				{
+					SABA_ERROR("PMX index is out of range. [{}]", index);
+					return false;
+				}
+				Write(index, file);
+				break;
+			default:
+				return false;
+			}
+			return !file.IsBad();
+		}
+
+		// 頂点インデックスは符号なし
+		bool WriteVertexIndex(int32_t index, uint8_t indexSize, File& file)
+		{
+			switch (indexSize)
+			{
+			case 1:
+				if (index < 0 || index > std::numeric_limits<uint8_t>::max())
+				{
+					SABA_ERROR("PMX vertex index is out of range. [{}]", index);
+					return false;
+				}
+				Write(uint8_t(index), file);
+				break;
+			case 2:
+				if (index < 0 || index > std::numeric_limits<uint16_t>::max())
+				{
+					SABA_ERROR("PMX vertex index is out of range. [{}]", index);
+					return false;
+				}
+				Write(uint16_t(index), file);
+				break;
+			case 4:
+				if (index < 0)
+				{
+					SABA_ERROR("PMX vertex index is out of range. [{}]", index);
+					return false;
+				}
+				Write(uint32_t(index), file);
+				break;
+			default:
+				return false;
+			}
+			return !file.IsBad();
+		}
+
+		bool WriteHeader(const PMXFile* pmx, File& file)
+		{
+			const auto& header = pmx->m_header;
+
+			Write(header.m_magic, file);
+			Write(header.m_version, file);
+
+			Write(header.m_dataSize, file);
+
+			Write(header.m_encode, file);
+			Write(header.m_addUVNum, file);
+
+			Write(header.m_vertexIndexSize, file);
+			Write(header.m_textureIndexSize, file);
+			Write(header.m_materialIndexSize, file);
+			Write(header.m_boneIndexSize, file);
+			Write(header.m_morphIndexSize, file);
+			Write(header.m_rigidbodyIndexSize, file);
+
+			return !file.IsBad();
+		}
+
+		bool WriteInfo(const PMXFile* pmx, File& file)
+		{
+			const auto& info = pmx->m_info;
+
+			WriteString(pmx, info.m_modelName, file);
+			WriteString(pmx, info.m_englishModelName, file);
+			WriteString(pmx, info.m_comment, file);
+			WriteString(pmx, info.m_englishComment, file);
+
+			return !file.IsBad();
+		}
+
+		bool WriteVertex(const PMXFile* pmx, File& file)
+		{
+			const uint8_t boneIndexSize = pmx->m_header.m_boneIndexSize;
+
+			Write(int32_t(pmx->m_vertices.size()), file);
+			for (const auto& vertex : pmx->m_vertices)
+			{
+				Write(vertex.m_position, file);
+				Write(vertex.m_normal, file);
+				Write(vertex.m_uv, file);
+
+				for (uint8_t i = 0; i < pmx->m_header.m_addUVNum; i++)
+				{
+					Write(vertex.m_addUV[i], file);
+				}
+
+				Write(vertex.m_weightType, file);
+
+				switch (vertex.m_weightType)
+				{
+				case PMXVertexWeight::BDEF1:
+					if (!WriteIndex(vertex.m_boneIndices[0], boneIndexSize, file))
+					{
+						return false;
+					}
+					break;
+				case PMXVertexWeight::BDEF2:
+					if (!WriteIndex(vertex.m_boneIndices[0], boneIndexSize, file))
+					{
+						return false;
+					}
+					if (!WriteIndex(vertex.m_boneIndices[1], boneIndexSize, file))
+					{
+						return false;
+					}
+					Write(vertex.m_boneWeights[0], file);
+					break;
+				case PMXVertexWeight::BDEF4:
+				case PMXVertexWeight::QDEF:
+					if (!WriteIndex(vertex.m_boneIndices[0], boneIndexSize, file))
+					{
+						return false;
+					}
+					if (!WriteIndex(vertex.m_boneIndices[1], boneIndexSize, file))
+					{
+						return false;
+					}
+					if (!WriteIndex(vertex.m_boneIndices[2], boneIndexSize, file))
+					{
+						return false;
+					}
+					if (!WriteIndex(vertex.m_boneIndices[3], boneIndexSize, file))
+					{
+						return false;
+					}
+					Write(vertex.m_boneWeights[0], file);
+					Write(vertex.m_boneWeights[1], file);
+					Write(vertex.m_boneWeights[2], file);
+					Write(vertex.m_boneWeights[3], file);
+					break;
+				case PMXVertexWeight::SDEF:
+					if (!WriteIndex(vertex.m_boneIndices[0], boneIndexSize, file))
+					{
+						return false;
+					}
+					if (!WriteIndex(vertex.m_boneIndices[1], boneIndexSize, file))
+					{
+						return false;
+					}
+					Write(vertex.m_boneWeights[0], file);
+					Write(vertex.m_sdefC, file);
+					Write(vertex.m_sdefR0, file);
+					Write(vertex.m_sdefR1, file);
+					break;
+				default:
+					return false;
+				}
+				Write(vertex.m_edgeMag, file);
+			}
+
+			return !file.IsBad();
+		}
+
+		template <typename T>
+		bool WriteFaceIndices(const PMXFile* pmx, File& file)
+		{
+			std::vector<T> vertices(pmx->m_faces.size() * 3);
+			for (size_t faceIdx = 0; faceIdx < pmx->m_faces.size(); faceIdx++)
+			{
+				for (size_t i = 0; i < 3; i++)
+				{
+					uint32_t vi = pmx->m_faces[faceIdx].m_vertices[i];
+					if (vi > std::numeric_limits<T>::max())
+					{
+						SABA_ERROR("PMX vertex index is out of range. [{}]", vi);
+						return false;
+					}
+					vertices[faceIdx * 3 + i] = T(vi);
+				}
+			}
+			if (!vertices.empty())
+			{
+				Write(vertices.data(), vertices.size(), file);
+			}
+			return true;
+		}
+
+		bool WriteFace(const PMXFile* pmx, File& file)
+		{
+			Write(int32_t(pmx->m_faces.size() * 3), file);
+
+			switch (pmx->m_header.m_vertexIndexSize)
+			{
+			case 1:
+				if (!WriteFaceIndices<uint8_t>(pmx, file))
+				{
+					return false;
+				}
+				break;
+			case 2:
+				if (!WriteFaceIndices<uint16_t>(pmx, file))
+				{
+					return false;
+				}
+				break;
+			case 4:
+				if (!WriteFaceIndices<uint32_t>(pmx, file))
+				{
+					return false;
+				}
+				break;
+			default:
+				return false;
+			}
+
+			return !file.IsBad();
+		}
+
+		bool WriteTexture(const PMXFile* pmx, File& file)
+		{
+			Write(int32_t(pmx->m_textures.size()), file);
+			for (const auto& tex : pmx->m_textures)
+			{
+				WriteString(pmx, tex.m_textureName, file);
+			}
+
+			return !file.IsBad();
+		}
+
+		bool WriteMaterial(const PMXFile* pmx, File& file)
+		{
+			const uint8_t textureIndexSize = pmx->m_header.m_textureIndexSize;
+
+			Write(int32_t(pmx->m_materials.size()), file);
+			for (const auto& mat : pmx->m_materials)
+			{
+				WriteString(pmx, mat.m_name, file);
+				WriteString(pmx, mat.m_englishName, file);
+
+				Write(mat.m_diffuse, file);
+				Write(mat.m_specular, file);
+				Write(mat.m_specularPower, file);
+				Write(mat.m_ambient, file);
+
+				Write(mat.m_drawMode, file);
+
+				Write(mat.m_edgeColor, file);
+				Write(mat.m_edgeSize, file);
+
+				if (!WriteIndex(mat.m_textureIndex, textureIndexSize, file))
+				{
+					return false;
+				}
+				if (!WriteIndex(mat.m_sphereTextureIndex, textureIndexSize, file))
+				{
+					return false;
+				}
+				Write(mat.m_sphereMode, file);
+
+				Write(mat.m_toonMode, file);
+				if (mat.m_toonMode == PMXToonMode::Separate)
+				{
+					if (!WriteIndex(mat.m_toonTextureIndex, textureIndexSize, file))
+					{
+						return false;
+					}
+				}
+				else if (mat.m_toonMode == PMXToonMode::Common)
+				{
+					Write(uint8_t(mat.m_toonTextureIndex), file);
+				}
+				else
+				{
+					return false;
+				}
+
+				WriteString(pmx, mat.m_memo, file);
+
+				Write(mat.m_numFaceVertices, file);
+			}
+
+			return !file.IsBad();
+		}
+
+		bool WriteBone(const PMXFile* pmx, File& file)
+		{
+			const uint8_t boneIndexSize = pmx->m_header.m_boneIndexSize;
+
+			Write(int32_t(pmx->m_bones.size()), file);
+			for (const auto& bone : pmx->m_bones)
+			{
+				WriteString(pmx, bone.m_name, file);
+				WriteString(pmx, bone.m_englishName, file);
+
+				Write(bone.m_position, file);
+				if (!WriteIndex(bone.m_parentBoneIndex, boneIndexSize, file))
+				{
+					return false;
+				}
+				Write(bone.m_deformDepth, file);
+
+				Write(bone.m_boneFlag, file);
+
+				const uint16_t boneFlag = (uint16_t)bone.m_boneFlag;
+				if ((boneFlag & (uint16_t)PMXBoneFlags::TargetShowMode) == 0)
+				{
+					Write(bone.m_positionOffset, file);
+				}
+				else
+				{
+					if (!WriteIndex(bone.m_linkBoneIndex, boneIndexSize, file))
+					{
+						return false;
+					}
+				}
+
+				if ((boneFlag & (uint16_t)PMXBoneFlags::AppendRotate) ||
+					(boneFlag & (uint16_t)PMXBoneFlags::AppendTranslate))
+				{
+					if (!WriteIndex(bone.m_appendBoneIndex, boneIndexSize, file))
+					{
+						return false;
+					}
+					Write(bone.m_appendWeight, file);
+				}
+
+				if (boneFlag & (uint16_t)PMXBoneFlags::FixedAxis)
+				{
+					Write(bone.m_fixedAxis, file);
+				}
+
+				if (boneFlag & (uint16_t)PMXBoneFlags::LocalAxis)
+				{
+					Write(bone.m_localXAxis, file);
+					Write(bone.m_localZAxis, file);
+				}
+
+				if (boneFlag & (uint16_t)PMXBoneFlags::DeformOuterParent)
+				{
+					Write(bone.m_keyValue, file);
+				}
+
+				if (boneFlag & (uint16_t)PMXBoneFlags::IK)
+				{
+					if (!WriteIndex(bone.m_ikTargetBoneIndex, boneIndexSize, file))
+					{
+						return false;
+					}
+					Write(bone.m_ikIterationCount, file);
+					Write(bone.m_ikLimit, file);
+
+					Write(int32_t(bone.m_ikLinks.size()), file);
+					for (const auto& ikLink : bone.m_ikLinks)
+					{
+						if (!WriteIndex(ikLink.m_ikBoneIndex, boneIndexSize, file))
+						{
+							return false;
+						}
+						Write(ikLink.m_enableLimit, file);
+
+						if (ikLink.m_enableLimit != 0)
+						{
+							Write(ikLink.m_limitMin, file);
+							Write(ikLink.m_limitMax, file);
+						}
+					}
+				}
+			}
+
+			return !file.IsBad();
+		}
+
+		bool WriteMorph(const PMXFile* pmx, File& file)
+		{
+			const auto& header = pmx->m_header;
+
+			Write(int32_t(pmx->m_morphs.size()), file);
+			for (const auto& morph : pmx->m_morphs)
+			{
+				WriteString(pmx, morph.m_name, file);
+				WriteString(pmx, morph.m_englishName, file);
+
+				Write(morph.m_controlPanel, file);
+				Write(morph.m_morphType, file);
+
+				if (morph.m_morphType == PMXMorphType::Position)
+				{
+					Write(int32_t(morph.m_positionMorph.size()), file);
+					for (const auto& data : morph.m_positionMorph)
+					{
+						if (!WriteVertexIndex(data.m_vertexIndex, header.m_vertexIndexSize, file))
+						{
+							return false;
+						}
+						Write(data.m_position, file);
+					}
+				}
+				else if (morph.m_morphType == PMXMorphType::UV ||
+					morph.m_morphType == PMXMorphType::AddUV1 ||
+					morph.m_morphType == PMXMorphType::AddUV2 ||
+					morph.m_morphType == PMXMorphType::AddUV3 ||
+					morph.m_morphType == PMXMorphType::AddUV4
+					)
+				{
+					Write(int32_t(morph.m_uvMorph.size()), file);
+					for (const auto& data : morph.m_uvMorph)
+					{
+						if (!WriteVertexIndex(data.m_vertexIndex, header.m_vertexIndexSize, file))
+						{
+							return false;
+						}
+						Write(data.m_uv, file);
+					}
+				}
+				else if (morph.m_morphType == PMXMorphType::Bone)
+				{
+					Write(int32_t(morph.m_boneMorph.size()), file);
+					for (const auto& data : morph.m_boneMorph)
+					{
+						if (!WriteIndex(data.m_boneIndex, header.m_boneIndexSize, file))
+						{
+							return false;
+						}
+						Write(data.m_position, file);
+						Write(data.m_quaternion, file);
+					}
+				}
+				else if (morph.m_morphType == PMXMorphType::Material)
+				{
+					Write(int32_t(morph.m_materialMorph.size()), file);
+					for (const auto& data : morph.m_materialMorph)
+					{
+						if (!WriteIndex(data.m_materialIndex, header.m_materialIndexSize, file))
+						{
+							return false;
+						}
+						Write(data.m_opType, file);
+						Write(data.m_diffuse, file);
+						Write(data.m_specular, file);
+						Write(data.m_specularPower, file);
+						Write(data.m_ambient, file);
+						Write(data.m_edgeColor, file);
+						Write(data.m_edgeSize, file);
+						Write(data.m_textureFactor, file);
+						Write(data.m_sphereTextureFactor, file);
+						Write(data.m_toonTextureFactor, file);
+					}
+				}
+				else if (morph.m_morphType == PMXMorphType::Group)
+				{
+					Write(int32_t(morph.m_groupMorph.size()), file);
+					for (const auto& data : morph.m_groupMorph)
+					{
+						if (!WriteIndex(data.m_morphIndex, header.m_morphIndexSize, file))
+						{
+							return false;
+						}
+						Write(data.m_weight, file);
+					}
+				}
+				else if (morph.m_morphType == PMXMorphType::Flip)
+				{
+					Write(int32_t(morph.m_flipMorph.size()), file);
+					for (const auto& data : morph.m_flipMorph)
+					{
+						if (!WriteIndex(data.m_morphIndex, header.m_morphIndexSize, file))
+						{
+							return false;
+						}
+						Write(data.m_weight, file);
+					}
+				}
+				else if (morph.m_morphType == PMXMorphType::Impluse)
+				{
+					Write(int32_t(morph.m_impulseMorph.size()), file);
+					for (const auto& data : morph.m_impulseMorph)
+					{
+						if (!WriteIndex(data.m_rigidbodyIndex, header.m_rigidbodyIndexSize, file))
+						{
+							return false;
+						}
+						Write(data.m_localFlag, file);
+						Write(data.m_translateVelocity, file);
+						Write(data.m_rotateTorque, file);
+					}
+				}
+				else
+				{
+					SABA_ERROR("Unsupported Morph Type:[{}]", (int)morph.m_morphType);
+					return false;
+				}
+			}
+
+			return !file.IsBad();
+		}
+
+		bool WriteDisplayFrame(const PMXFile* pmx, File& file)
+		{
+			Write(int32_t(pmx->m_displayFrames.size()), file);
+			for (const auto& displayFrame : pmx->m_displayFrames)
+			{
+				WriteString(pmx, displayFrame.m_name, file);
+				WriteString(pmx, displayFrame.m_englishName, file);
+
+				Write(displayFrame.m_flag, file);
+				Write(int32_t(displayFrame.m_targets.size()), file);
+				for (const auto& target : displayFrame.m_targets)
+				{
+					Write(target.m_type, file);
+					if (target.m_type == PMXDispalyFrame::TargetType::BoneIndex)
+					{
+						if (!WriteIndex(target.m_index, pmx->m_header.m_boneIndexSize, file))
+						{
+							return false;
+						}
+					}
+					else if (target.m_type == PMXDispalyFrame::TargetType::MorphIndex)
+					{
+						if (!WriteIndex(target.m_index, pmx->m_header.m_morphIndexSize, file))
+						{
+							return false;
+						}
+					}
+					else
+					{
+						return false;
+					}
+				}
+			}
+
+			return !file.IsBad();
+		}
+
+		bool WriteRigidbody(const PMXFile* pmx, File& file)
+		{
+			Write(int32_t(pmx->m_rigidbodies.size()), file);
+			for (const auto& rb : pmx->m_rigidbodies)
+			{
+				WriteString(pmx, rb.m_name, file);
+				WriteString(pmx, rb.m_englishName, file);
+
+				if (!WriteIndex(rb.m_boneIndex, pmx->m_header.m_boneIndexSize, file))
+				{
+					return false;
+				}
+				Write(rb.m_group, file);
+				Write(rb.m_collisionGroup, file);
+
+				Write(rb.m_shape, file);
+				Write(rb.m_shapeSize, file);
+
+				Write(rb.m_translate, file);
+				Write(rb.m_rotate, file);
+
+				Write(rb.m_mass, file);
+				Write(rb.m_translateDimmer, file);
+				Write(rb.m_rotateDimmer, file);
+				Write(rb.m_repulsion, file);
+				Write(rb.m_friction, file);
+
+				Write(rb.m_op, file);
+			}
+
+			return !file.IsBad();
+		}
+
+		bool WriteJoint(const PMXFile* pmx, File& file)
+		{
+			Write(int32_t(pmx->m_joints.size()), file);
+			for (const auto& joint : pmx->m_joints)
+			{
+				WriteString(pmx, joint.m_name, file);
+				WriteString(pmx, joint.m_englishName, file);
+
+				Write(joint.m_type, file);
+				if (!WriteIndex(joint.m_rigidbodyAIndex, pmx->m_header.m_rigidbodyIndexSize, file))
+				{
+					return false;
+				}
+				if (!WriteIndex(joint.m_rigidbodyBIndex, pmx->m_header.m_rigidbodyIndexSize, file))
+				{
+					return false;
+				}
+
+				Write(joint.m_translate, file);
+				Write(joint.m_rotate, file);
+
+				Write(joint.m_translateLowerLimit, file);
+				Write(joint.m_translateUpperLimit, file);
+				Write(joint.m_rotateLowerLimit, file);
+				Write(joint.m_rotateUpperLimit, file);
+
+				Write(joint.m_springTranslateFactor, file);
+				Write(joint.m_springRotateFactor, file);
+			}
+
+			return !file.IsBad();
+		}
+
+		bool WriteSoftbody(const PMXFile* pmx, File& file)
+		{
+			const auto& header = pmx->m_header;
+
+			Write(int32_t(pmx->m_softbodies.size()), file);
+			for (const auto& sb : pmx->m_softbodies)
+			{
+				WriteString(pmx, sb.m_name, file);
+				WriteString(pmx, sb.m_englishName, file);
+
+				Write(sb.m_type, file);
+
+				if (!WriteIndex(sb.m_materialIndex, header.m_materialIndexSize, file))
+				{
+					return false;
+				}
+
+				Write(sb.m_group, file);
+				Write(sb.m_collisionGroup, file);
+
+				Write(sb.m_flag, file);
+
+				Write(sb.m_BLinkLength, file);
+				Write(sb.m_numClusters, file);
+
+				Write(sb.m_totalMass, file);
+				Write(sb.m_collisionMargin, file);
+
+				Write(sb.m_aeroModel, file);
+
+				Write(sb.m_VCF, file);
+				Write(sb.m_DP, file);
+				Write(sb.m_DG, file);
+				Write(sb.m_LF, file);
+				Write(sb.m_PR, file);
+				Write(sb.m_VC, file);
+				Write(sb.m_DF, file);
+				Write(sb.m_MT, file);
+				Write(sb.m_CHR, file);
+				Write(sb.m_KHR, file);
+				Write(sb.m_SHR, file);
+				Write(sb.m_AHR, file);
+
+				Write(sb.m_SRHR_CL, file);
+				Write(sb.m_SKHR_CL, file);
+				Write(sb.m_SSHR_CL, file);
+				Write(sb.m_SR_SPLT_CL, file);
+				Write(sb.m_SK_SPLT_CL, file);
+				Write(sb.m_SS_SPLT_CL, file);
+
+				Write(sb.m_V_IT, file);
+				Write(sb.m_P_IT, file);
+				Write(sb.m_D_IT, file);
+				Write(sb.m_C_IT, file);
+
+				Write(sb.m_LST, file);
+				Write(sb.m_AST, file);
+				Write(sb.m_VST, file);
+
+				Write(int32_t(sb.m_anchorRigidbodies.size()), file);
+				for (const auto& ar : sb.m_anchorRigidbodies)
+				{
+					if (!WriteIndex(ar.m_rigidBodyIndex, header.m_rigidbodyIndexSize, file))
+					{
+						return false;
+					}
+					if (!WriteVertexIndex(ar.m_vertexIndex, header.m_vertexIndexSize, file))
+					{
+						return false;
+					}
+					Write(ar.m_nearMode, file);
+				}
+
+				Write(int32_t(sb.m_pinVertexIndices.size()), file);
+				for (auto pv : sb.m_pinVertexIndices)
+				{
+					if (!WriteVertexIndex(pv, header.m_vertexIndexSize, file))
+					{
+						return false;
+					}
+				}
+			}
+
+			return !file.IsBad();
+		}
+
+		bool WritePMXFile(const PMXFile* pmxFile, File& file)
+		{
+			if (!WriteHeader(pmxFile, file))
+			{
+				SABA_ERROR("WriteHeader Fail.");
+				return false;
+			}
+
+			if (!WriteInfo(pmxFile, file))
+			{
+				SABA_ERROR("WriteInfo Fail.");
+				return false;
+			}
+
+			if (!WriteVertex(pmxFile, file))
+			{
+				SABA_ERROR("WriteVertex Fail.");
+				return false;
+			}
+
+			if (!WriteFace(pmxFile, file))
+			{
+				SABA_ERROR("WriteFace Fail.");
+				return false;
+			}
+
+			if (!WriteTexture(pmxFile, file))
+			{
+				SABA_ERROR("WriteTexture Fail.");
+				return false;
+			}
+
+			if (!WriteMaterial(pmxFile, file))
+			{
+				SABA_ERROR("WriteMaterial Fail.");
+				return false;
+			}
+
+			if (!WriteBone(pmxFile, file))
+			{
+				SABA_ERROR("WriteBone Fail.");
+				return false;
+			}
+
+			if (!WriteMorph(pmxFile, file))
+			{
+				SABA_ERROR("WriteMorph Fail.");
+				return false;
+			}
+
+			if (!WriteDisplayFrame(pmxFile, file))
+			{
+				SABA_ERROR("WriteDisplayFrame Fail.");
+				return false;
+			}
+
+			if (!WriteRigidbody(pmxFile, file))
+			{
+				SABA_ERROR("WriteRigidbody Fail.");
+				return false;
+			}
+
+			if (!WriteJoint(pmxFile, file))
+			{
+				SABA_ERROR("WriteJoint Fail.");
+				return false;
+			}
+
+			// ソフトボディは PMX 2.1 の拡張なので、ある場合だけ書く
+			if (!pmxFile->m_softbodies.empty())
+			{
+				if (!WriteSoftbody(pmxFile, file))
+				{
+					SABA_ERROR("WriteSoftbody Fail.");
+					return false;
+				}
+			}
+
+			return true;
+		}
+	}
+
+	bool WritePMXFile(const PMXFile * pmxFile, const char * filename)
+	{
+		SABA_TRACE_SCOPE("WritePMXFile");
+
+		File file;
+		if (!file.Create(filename))
+		{
+			SABA_WARN("PMX File Create Fail. {}", filename);
+			return false;
+		}
+
+		if (!WritePMXFile(pmxFile, file))
+		{
+			SABA_WARN("PMX File Write Fail. {}", filename);
+			return false;
+		}
+
+		return true;
+	}
+
 
 }
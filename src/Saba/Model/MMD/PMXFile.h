@@ -594,6 +594,8 @@ namespace saba
 	};
 
 	bool ReadPMXFile(PMXFile* pmdFile, const char* filename);
+	// m_header のインデックスサイズと文字コードに従って書き出す
+	bool WritePMXFile(const PMXFile* pmxFile, const char* filename);
 }
 
 #endif // !SABA_MODEL_PMXFILE_H_
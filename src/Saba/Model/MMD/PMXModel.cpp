@@ -6,13 +6,17 @@
 
 #include "PMXModel.h"
 
+#include "PMXCache.h"
 #include "PMXFile.h"
 #include "MMDPhysics.h"
+#include "MMDMeshLOD.h"
+#include "../MeshUtil.h"
 
 #include <Saba/Base/Path.h>
 #include <Saba/Base/File.h>
 #include <Saba/Base/Log.h>
 #include <Saba/Base/Singleton.h>
+#include <Saba/Base/Trace.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -30,8 +34,259 @@
 
 namespace saba
 {
+	namespace
+	{
+		enum PMXCacheSectionID : uint32_t
+		{
+			CacheModelInfoSection,
+			CachePositionSection,
+			CacheNormalSection,
+			CacheUVSection,
+			CacheVertexBoneInfoSection,
+			CacheIndexSection,
+			CacheTextureSection,
+			CacheMaterialSection,
+			CacheBoneSection,
+			CacheIKLinkSection,
+			CacheMorphSection,
+			CachePositionMorphSection,
+			CacheUVMorphSection,
+			CacheMaterialMorphSection,
+			CacheBoneMorphSection,
+			CacheGroupMorphSection,
+			CacheRigidbodySection,
+			CacheJointSection,
+		};
+
+		template <typename T>
+		struct CacheArray
+		{
+			const T*	m_data = nullptr;
+			size_t		m_count = 0;
+
+			bool Read(const PMXCacheReader& cache, uint32_t id)
+			{
+				return cache.GetSection(id, &m_data, &m_count);
+			}
+
+			// share の場合はコピーせずに、マップしたメモリを参照する
+			template <typename Array>
+			void Store(Array* dst, size_t offset, size_t count, bool share) const
+			{
+				if (share)
+				{
+					dst->Reference(m_data + offset, count);
+				}
+				else
+				{
+					dst->Assign(std::vector<T>(m_data + offset, m_data + offset + count));
+				}
+			}
+		};
+
+		struct CacheModelInfo
+		{
+			uint32_t	m_vertexCount;
+			uint32_t	m_indexCount;
+			uint32_t	m_indexElementSize;
+			uint32_t	m_vertexCacheOptimized;	//!< インデックスを頂点キャッシュ向けに並べ替えた場合は 1
+			glm::vec3	m_bboxMin;
+			glm::vec3	m_bboxMax;
+		};
+
+		// 以下は PMXFile の構造体から文字列を取り除いたもの
+		struct CacheMaterial
+		{
+			glm::vec4			m_diffuse;
+			glm::vec3			m_specular;
+			float				m_specularPower;
+			glm::vec3			m_ambient;
+			PMXDrawModeFlags	m_drawMode;
+			glm::vec4			m_edgeColor;
+			float				m_edgeSize;
+			int32_t				m_textureIndex;
+			int32_t				m_sphereTextureIndex;
+			PMXSphereMode		m_sphereMode;
+			PMXToonMode			m_toonMode;
+			int32_t				m_toonTextureIndex;
+			int32_t				m_numFaceVertices;
+		};
+
+		struct CacheBone
+		{
+			PMXCacheString	m_name;
+			glm::vec3		m_position;
+			int32_t			m_parentBoneIndex;
+			int32_t			m_deformDepth;
+			PMXBoneFlags	m_boneFlag;
+			int32_t			m_appendBoneIndex;
+			float			m_appendWeight;
+			int32_t			m_ikTargetBoneIndex;
+			int32_t			m_ikIterationCount;
+			float			m_ikLimit;
+			uint32_t		m_ikLinkOffset;	//!< IK リンクのセクションの位置
+			uint32_t		m_ikLinkCount;
+		};
+
+		struct CacheMorph
+		{
+			PMXCacheString	m_name;
+			uint32_t		m_morphType;	//!< PMXModel::MorphType
+			uint32_t		m_dataOffset;	//!< 種類ごとのセクションの位置
+			uint32_t		m_dataCount;
+		};
+
+		// 座標系を変換した後の値
+		struct CacheBoneMorph
+		{
+			int32_t		m_boneIndex;
+			glm::vec3	m_position;
+			glm::quat	m_rotate;
+		};
+
+		struct CacheRigidbody
+		{
+			PMXCacheString			m_name;
+			int32_t					m_boneIndex;
+			uint8_t					m_group;
+			uint16_t				m_collisionGroup;
+			PMXRigidbody::Shape		m_shape;
+			glm::vec3				m_shapeSize;
+			glm::vec3				m_translate;
+			glm::vec3				m_rotate;
+			float					m_mass;
+			float					m_translateDimmer;
+			float					m_rotateDimmer;
+			float					m_repulsion;
+			float					m_friction;
+			PMXRigidbody::Operation	m_op;
+
+			void FromPMX(const PMXRigidbody& rb)
+			{
+				m_boneIndex = rb.m_boneIndex;
+				m_group = rb.m_group;
+				m_collisionGroup = rb.m_collisionGroup;
+				m_shape = rb.m_shape;
+				m_shapeSize = rb.m_shapeSize;
+				m_translate = rb.m_translate;
+				m_rotate = rb.m_rotate;
+				m_mass = rb.m_mass;
+				m_translateDimmer = rb.m_translateDimmer;
+				m_rotateDimmer = rb.m_rotateDimmer;
+				m_repulsion = rb.m_repulsion;
+				m_friction = rb.m_friction;
+				m_op = rb.m_op;
+			}
+
+			PMXRigidbody ToPMX() const
+			{
+				PMXRigidbody rb;
+				rb.m_boneIndex = m_boneIndex;
+				rb.m_group = m_group;
+				rb.m_collisionGroup = m_collisionGroup;
+				rb.m_shape = m_shape;
+				rb.m_shapeSize = m_shapeSize;
+				rb.m_translate = m_translate;
+				rb.m_rotate = m_rotate;
+				rb.m_mass = m_mass;
+				rb.m_translateDimmer = m_translateDimmer;
+				rb.m_rotateDimmer = m_rotateDimmer;
+				rb.m_repulsion = m_repulsion;
+				rb.m_friction = m_friction;
+				rb.m_op = m_op;
+				return rb;
+			}
+		};
+
+		struct CacheJoint
+		{
+			PMXCacheString		m_name;
+			PMXJoint::JointType	m_type;
+			int32_t				m_rigidbodyAIndex;
+			int32_t				m_rigidbodyBIndex;
+			glm::vec3			m_translate;
+			glm::vec3			m_rotate;
+			glm::vec3			m_translateLowerLimit;
+			glm::vec3			m_translateUpperLimit;
+			glm::vec3			m_rotateLowerLimit;
+			glm::vec3			m_rotateUpperLimit;
+			glm::vec3			m_springTranslateFactor;
+			glm::vec3			m_springRotateFactor;
+
+			void FromPMX(const PMXJoint& joint)
+			{
+				m_type = joint.m_type;
+				m_rigidbodyAIndex = joint.m_rigidbodyAIndex;
+				m_rigidbodyBIndex = joint.m_rigidbodyBIndex;
+				m_translate = joint.m_translate;
+				m_rotate = joint.m_rotate;
+				m_translateLowerLimit = joint.m_translateLowerLimit;
+				m_translateUpperLimit = joint.m_translateUpperLimit;
+				m_rotateLowerLimit = joint.m_rotateLowerLimit;
+				m_rotateUpperLimit = joint.m_rotateUpperLimit;
+				m_springTranslateFactor = joint.m_springTranslateFactor;
+				m_springRotateFactor = joint.m_springRotateFactor;
+			}
+
+			PMXJoint ToPMX() const
+			{
+				PMXJoint joint;
+				joint.m_type = m_type;
+				joint.m_rigidbodyAIndex = m_rigidbodyAIndex;
+				joint.m_rigidbodyBIndex = m_rigidbodyBIndex;
+				joint.m_translate = m_translate;
+				joint.m_rotate = m_rotate;
+				joint.m_translateLowerLimit = m_translateLowerLimit;
+				joint.m_translateUpperLimit = m_translateUpperLimit;
+				joint.m_rotateLowerLimit = m_rotateLowerLimit;
+				joint.m_rotateUpperLimit = m_rotateUpperLimit;
+				joint.m_springTranslateFactor = m_springTranslateFactor;
+				joint.m_springRotateFactor = m_springRotateFactor;
+				return joint;
+			}
+		};
+
+		template <typename T>
+		bool IsValidVertexIndices(const T* indices, size_t indexCount, size_t vertexCount)
+		{
+			return std::all_of(indices, indices + indexCount, [vertexCount](T vi) { return size_t(vi) < vertexCount; });
+		}
+
+		// 材質ごとに三角形を並べ替える (材質の範囲は変えない)
+		template <typename T>
+		void OptimizeVertexCacheOrder(T* indices, size_t indexCount, size_t vertexCount, const std::vector<PMXMaterial>& materials)
+		{
+			std::vector<uint32_t> workIndices(indices, indices + indexCount);
+			if (std::any_of(workIndices.begin(), workIndices.end(), [vertexCount](uint32_t vi) { return vi >= vertexCount; }))
+			{
+				SABA_WARN("Vertex index is out of range. Skip vertex cache optimization.");
+				return;
+			}
+			VertexCacheOptimizer optimizer(vertexCount);
+			size_t beginIndex = 0;
+			for (const auto& mat : materials)
+			{
+				size_t count = std::min(size_t(std::max(mat.m_numFaceVertices, 0)), indexCount - beginIndex);
+				optimizer.Optimize(&workIndices[beginIndex], count - count % 3);
+				beginIndex += count;
+			}
+			for (size_t i = 0; i < indexCount; i++)
+			{
+				indices[i] = T(workIndices[i]);
+			}
+		}
+	}
+
 	PMXModel::PMXModel()
-		: m_parallelUpdateCount(0)
+		: m_morphBegin(0)
+		, m_morphEnd(0)
+		, m_parallelUpdateCount(0)
+		, m_useCache(false)
+		, m_shareCache(false)
+		, m_optimizeVertexCache(false)
+		, m_lodHint(1)
+		, m_lod(0)
+		, m_approximateSkinning(false)
 	{
 	}
 
@@ -65,6 +320,7 @@ namespace saba
 		for (auto& ikSolver : (*m_ikSolverMan.GetIKSolvers()))
 		{
 			ikSolver->Enable(true);
+			ikSolver->ClearWarmStart();
 		}
 
 		for (const auto& node : (*m_nodeMan.GetNodes()))
@@ -109,12 +365,14 @@ namespace saba
 		{
 			node->BeginUpdateTransform();
 		}
-		size_t vtxCount = m_morphPositions.size();
-		for (size_t vtxIdx = 0; vtxIdx < vtxCount; vtxIdx++)
+		// 前回モーフで変更した範囲だけ 0 に戻す
+		for (size_t vtxIdx = m_morphBegin; vtxIdx < m_morphEnd; vtxIdx++)
 		{
 			m_morphPositions[vtxIdx] = glm::vec3(0);
 			m_morphUVs[vtxIdx] = glm::vec4(0);
 		}
+		m_morphBegin = 0;
+		m_morphEnd = 0;
 	}
 
 	void PMXModel::EndAnimation()
@@ -127,6 +385,8 @@ namespace saba
 
 	void PMXModel::UpdateMorphAnimation()
 	{
+		SABA_TRACE_SCOPE("PMXModel::UpdateMorphAnimation");
+
 		// Morph の処理
 		BeginMorphMaterial();
 
@@ -142,6 +402,8 @@ namespace saba
 
 	void PMXModel::UpdateNodeAnimation(bool afterPhysicsAnim)
 	{
+		SABA_TRACE_SCOPE("PMXModel::UpdateNodeAnimation");
+
 		for (auto pmxNode : m_sortedNodes)
 		{
 			if (pmxNode->IsDeformAfterPhysics() != afterPhysicsAnim)
@@ -244,6 +506,8 @@ namespace saba
 
 	void PMXModel::UpdatePhysicsAnimation(float elapsed)
 	{
+		SABA_TRACE_SCOPE("PMXModel::UpdatePhysicsAnimation");
+
 		MMDPhysicsManager* physicsMan = GetPhysicsManager();
 		auto physics = physicsMan->GetMMDPhysics();
 
@@ -281,13 +545,18 @@ namespace saba
 
 	void PMXModel::Update()
 	{
-		auto& nodes = (*m_nodeMan.GetNodes());
+		MMDVertexSink sink;
+		sink.m_positions.m_data = m_updatePositions.data();
+		sink.m_normals.m_data = m_updateNormals.data();
+		sink.m_uvs.m_data = m_updateUVs.data();
+		Update(sink);
+	}
 
-		// スキンメッシュに使用する変形マトリクスを事前計算
-		for (size_t i = 0; i < nodes.size(); i++)
-		{
-			m_transforms[i] = nodes[i]->GetGlobalTransform() * nodes[i]->GetInverseInitTransform();
-		}
+	void PMXModel::Update(const MMDVertexSink& sink)
+	{
+		SABA_TRACE_SCOPE("PMXModel::Update");
+
+		UpdateTransforms();
 
 		if (m_parallelUpdateCount != m_updateRanges.size())
 		{
@@ -302,12 +571,12 @@ namespace saba
 			{
 				m_parallelUpdateFutures[i] = std::async(
 					std::launch::async,
-					[this, rangeIndex]() { this->Update(this->m_updateRanges[rangeIndex]); }
+					[this, rangeIndex, &sink]() { this->Update(this->m_updateRanges[rangeIndex], sink); }
 				);
 			}
 		}
 
-		Update(m_updateRanges[0]);
+		Update(m_updateRanges[0], sink);
 
 		for (size_t i = 0; i < futureCount; i++)
 		{
@@ -326,21 +595,88 @@ namespace saba
 
 	bool PMXModel::Load(const std::string& filepath, const std::string& mmdDataDir)
 	{
+		SABA_TRACE_SCOPE("PMXModel::Load");
+
 		Destroy();
 
+		std::string dirPath = PathUtil::GetDirectoryName(filepath);
+		std::string cachePath = GetPMXCachePath(filepath);
+
+		// キャッシュがある場合、PMXFile には材質、ボーン、剛体、ジョイントだけを読み込む
 		PMXFile pmx;
-		if (!ReadPMXFile(&pmx, filepath.c_str()))
+		std::unique_ptr<PMXCacheReader> cache(new PMXCacheReader());
+		bool shareCache = m_useCache && m_shareCache;
+		bool useCache = m_useCache && LoadCache(cache.get(), cachePath, filepath, &pmx, shareCache);
+		if (!useCache)
+		{
+			if (!ReadPMXFile(&pmx, filepath.c_str()))
+			{
+				return false;
+			}
+			if (!LoadMesh(pmx))
+			{
+				return false;
+			}
+		}
+		m_morphPositions.assign(m_positions.size(), glm::vec3(0));
+		m_morphUVs.assign(m_positions.size(), glm::vec4(0));
+		m_morphBegin = 0;
+		m_morphEnd = 0;
+		m_updatePositions.resize(m_positions.size());
+		m_updateNormals.resize(m_normals.size());
+		m_updateUVs.resize(m_uvs.size());
+
+		LoadMaterials(pmx, dirPath, mmdDataDir);
+		LoadNodes(pmx);
+		if (useCache)
+		{
+			LoadCacheMorphs(*cache, shareCache);
+			if (shareCache)
+			{
+				m_sharedCache = std::move(cache);
+			}
+			else
+			{
+				cache->Close();
+			}
+		}
+		else
+		{
+			LoadMorphs(pmx);
+			if (m_useCache && !SaveCache(cachePath, filepath, pmx))
+			{
+				SABA_WARN("PMX Cache Save Fail. [{}]", cachePath);
+			}
+		}
+
+		if (!LoadPhysics(pmx))
 		{
 			return false;
 		}
 
-		std::string dirPath = PathUtil::GetDirectoryName(filepath);
+		ResetPhysics();
 
+		if (m_lodHint > 1)
+		{
+			BuildLOD(m_lodHint);
+		}
+
+		SetupParallelUpdate();
+
+		return true;
+	}
+
+	bool PMXModel::LoadMesh(const PMXFile& pmx)
+	{
 		size_t vertexCount = pmx.m_vertices.size();
-		m_positions.reserve(vertexCount);
-		m_normals.reserve(vertexCount);
-		m_uvs.reserve(vertexCount);
-		m_vertexBoneInfos.reserve(vertexCount);
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> uvs;
+		std::vector<VertexBoneInfo> vertexBoneInfos;
+		positions.reserve(vertexCount);
+		normals.reserve(vertexCount);
+		uvs.reserve(vertexCount);
+		vertexBoneInfos.reserve(vertexCount);
 		m_bboxMax = glm::vec3(-std::numeric_limits<float>::max());
 		m_bboxMin = glm::vec3(std::numeric_limits<float>::max());
 
@@ -351,9 +687,9 @@ namespace saba
 			glm::vec3 pos = v.m_position * glm::vec3(1, 1, -1);
 			glm::vec3 nor = v.m_normal * glm::vec3(1, 1, -1);
 			glm::vec2 uv = glm::vec2(v.m_uv.x, 1.0f - v.m_uv.y);
-			m_positions.push_back(pos);
-			m_normals.push_back(nor);
-			m_uvs.push_back(uv);
+			positions.push_back(pos);
+			normals.push_back(nor);
+			uvs.push_back(uv);
 			VertexBoneInfo vtxBoneInfo;
 			if (PMXVertexWeight::SDEF != v.m_weightType)
 			{
@@ -423,27 +759,26 @@ namespace saba
 				SABA_ERROR("Unknown PMX Vertex Weight Type: {}", (int)v.m_weightType);
 				break;
 			}
-			m_vertexBoneInfos.push_back(vtxBoneInfo);
+			vertexBoneInfos.push_back(vtxBoneInfo);
 
 			m_bboxMax = glm::max(m_bboxMax, pos);
 			m_bboxMin = glm::min(m_bboxMin, pos);
 		}
-		m_morphPositions.resize(m_positions.size());
-		m_morphUVs.resize(m_positions.size());
-		m_updatePositions.resize(m_positions.size());
-		m_updateNormals.resize(m_normals.size());
-		m_updateUVs.resize(m_uvs.size());
 
+		m_positions.Assign(std::move(positions));
+		m_normals.Assign(std::move(normals));
+		m_uvs.Assign(std::move(uvs));
+		m_vertexBoneInfos.Assign(std::move(vertexBoneInfos));
 
 		m_indexElementSize = pmx.m_header.m_vertexIndexSize;
-		m_indices.resize(pmx.m_faces.size() * 3 * m_indexElementSize);
+		std::vector<char> indexData(pmx.m_faces.size() * 3 * m_indexElementSize);
 		m_indexCount = pmx.m_faces.size() * 3;
 		switch (m_indexElementSize)
 		{
 		case 1:
 		{
 			int idx = 0;
-			uint8_t* indices = (uint8_t*)m_indices.data();
+			uint8_t* indices = (uint8_t*)indexData.data();
 			for (const auto& face : pmx.m_faces)
 			{
 				for (int i = 0; i < 3; i++)
@@ -458,7 +793,7 @@ namespace saba
 		case 2:
 		{
 			int idx = 0;
-			uint16_t* indices = (uint16_t*)m_indices.data();
+			uint16_t* indices = (uint16_t*)indexData.data();
 			for (const auto& face : pmx.m_faces)
 			{
 				for (int i = 0; i < 3; i++)
@@ -473,7 +808,7 @@ namespace saba
 		case 4:
 		{
 			int idx = 0;
-			uint32_t* indices = (uint32_t*)m_indices.data();
+			uint32_t* indices = (uint32_t*)indexData.data();
 			for (const auto& face : pmx.m_faces)
 			{
 				for (int i = 0; i < 3; i++)
@@ -489,7 +824,22 @@ namespace saba
 			SABA_ERROR("Unsupported Index Size: [{}]", m_indexElementSize);
 			return false;
 		}
+		if (m_optimizeVertexCache)
+		{
+			switch (m_indexElementSize)
+			{
+			case 1: OptimizeVertexCacheOrder((uint8_t*)indexData.data(), m_indexCount, vertexCount, pmx.m_materials); break;
+			case 2: OptimizeVertexCacheOrder((uint16_t*)indexData.data(), m_indexCount, vertexCount, pmx.m_materials); break;
+			case 4: OptimizeVertexCacheOrder((uint32_t*)indexData.data(), m_indexCount, vertexCount, pmx.m_materials); break;
+			}
+		}
+		m_indices.Assign(std::move(indexData));
+
+		return true;
+	}
 
+	void PMXModel::LoadMaterials(const PMXFile& pmx, const std::string& dirPath, const std::string& mmdDataDir)
+	{
 		std::vector<std::string> texturePaths;
 		texturePaths.reserve(pmx.m_textures.size());
 		for (const auto& pmxTex : pmx.m_textures)
@@ -575,7 +925,10 @@ namespace saba
 		m_initMaterials = m_materials;
 		m_mulMaterialFactors.resize(m_materials.size());
 		m_addMaterialFactors.resize(m_materials.size());
+	}
 
+	void PMXModel::LoadNodes(const PMXFile& pmx)
+	{
 		// Node
 		m_nodeMan.GetNodes()->reserve(pmx.m_bones.size());
 		for (const auto& bone : pmx.m_bones)
@@ -674,9 +1027,23 @@ namespace saba
 
 				solver->SetIterateCount(bone.m_ikIterationCount);
 				solver->SetLimitAngle(bone.m_ikLimit);
+
+				// 付与のあるチェインはローカル変換が変わるため、解析解は使わない
+				bool hasAppend = targetNode->GetAppendNode() != nullptr;
+				for (const auto& ikLink : bone.m_ikLinks)
+				{
+					hasAppend = hasAppend || m_nodeMan.GetNode(ikLink.m_ikBoneIndex)->GetAppendNode() != nullptr;
+				}
+				if (!hasAppend)
+				{
+					solver->SetupSolveMode();
+				}
 			}
 		}
+	}
 
+	void PMXModel::LoadMorphs(const PMXFile& pmx)
+	{
 		// Morph
 		for (const auto& pmxMorph : pmx.m_morphs)
 		{
@@ -688,28 +1055,34 @@ namespace saba
 			{
 				morph->m_morphType = MorphType::Position;
 				morph->m_dataIndex = m_positionMorphDatas.size();
-				PositionMorphData morphData;
+				std::vector<PositionMorph> morphVertices;
+				morphVertices.reserve(pmxMorph.m_positionMorph.size());
 				for (const auto& vtx : pmxMorph.m_positionMorph)
 				{
 					PositionMorph morphVtx;
 					morphVtx.m_index = vtx.m_vertexIndex;
 					morphVtx.m_position = vtx.m_position * glm::vec3(1, 1, -1);
-					morphData.m_morphVertices.push_back(morphVtx);
+					morphVertices.push_back(morphVtx);
 				}
+				PositionMorphData morphData;
+				morphData.m_morphVertices.Assign(std::move(morphVertices));
 				m_positionMorphDatas.emplace_back(std::move(morphData));
 			}
 			else if (pmxMorph.m_morphType == PMXMorphType::UV)
 			{
 				morph->m_morphType = MorphType::UV;
 				morph->m_dataIndex = m_uvMorphDatas.size();
-				UVMorphData morphData;
+				std::vector<UVMorph> morphUVs;
+				morphUVs.reserve(pmxMorph.m_uvMorph.size());
 				for (const auto& uv : pmxMorph.m_uvMorph)
 				{
 					UVMorph morphUV;
 					morphUV.m_index = uv.m_vertexIndex;
 					morphUV.m_uv = uv.m_uv;
-					morphData.m_morphUVs.push_back(morphUV);
+					morphUVs.push_back(morphUV);
 				}
+				UVMorphData morphData;
+				morphData.m_morphUVs.Assign(std::move(morphUVs));
 				m_uvMorphDatas.emplace_back(std::move(morphData));
 			}
 			else if (pmxMorph.m_morphType == PMXMorphType::Material)
@@ -804,7 +1177,10 @@ namespace saba
 			}
 
 		}
+	}
 
+	bool PMXModel::LoadPhysics(const PMXFile& pmx)
+	{
 		// Physics
 		if (!m_physicsMan.Create())
 		{
@@ -855,13 +1231,505 @@ namespace saba
 			}
 		}
 
-		ResetPhysics();
+		return true;
+	}
 
-		SetupParallelUpdate();
+	bool PMXModel::LoadCache(PMXCacheReader* cache, const std::string& cachePath, const std::string& filepath, PMXFile* pmx, bool share)
+	{
+		SABA_TRACE_SCOPE("PMXModel::LoadCache");
+
+		if (!cache->Open(cachePath, filepath))
+		{
+			return false;
+		}
+
+		CacheArray<CacheModelInfo> info;
+		CacheArray<glm::vec3> positions;
+		CacheArray<glm::vec3> normals;
+		CacheArray<glm::vec2> uvs;
+		CacheArray<VertexBoneInfo> vertexBoneInfos;
+		CacheArray<char> indices;
+		CacheArray<PMXCacheString> textures;
+		CacheArray<CacheMaterial> materials;
+		CacheArray<CacheBone> bones;
+		CacheArray<PMXIKLink> ikLinks;
+		CacheArray<CacheMorph> morphs;
+		CacheArray<PositionMorph> positionMorphs;
+		CacheArray<UVMorph> uvMorphs;
+		CacheArray<saba::PMXMorph::MaterialMorph> materialMorphs;
+		CacheArray<CacheBoneMorph> boneMorphs;
+		CacheArray<saba::PMXMorph::GroupMorph> groupMorphs;
+		CacheArray<CacheRigidbody> rigidbodies;
+		CacheArray<CacheJoint> joints;
+		bool valid =
+			info.Read(*cache, CacheModelInfoSection) && info.m_count == 1 &&
+			positions.Read(*cache, CachePositionSection) &&
+			normals.Read(*cache, CacheNormalSection) &&
+			uvs.Read(*cache, CacheUVSection) &&
+			vertexBoneInfos.Read(*cache, CacheVertexBoneInfoSection) &&
+			indices.Read(*cache, CacheIndexSection) &&
+			textures.Read(*cache, CacheTextureSection) &&
+			materials.Read(*cache, CacheMaterialSection) &&
+			bones.Read(*cache, CacheBoneSection) &&
+			ikLinks.Read(*cache, CacheIKLinkSection) &&
+			morphs.Read(*cache, CacheMorphSection) &&
+			positionMorphs.Read(*cache, CachePositionMorphSection) &&
+			uvMorphs.Read(*cache, CacheUVMorphSection) &&
+			materialMorphs.Read(*cache, CacheMaterialMorphSection) &&
+			boneMorphs.Read(*cache, CacheBoneMorphSection) &&
+			groupMorphs.Read(*cache, CacheGroupMorphSection) &&
+			rigidbodies.Read(*cache, CacheRigidbodySection) &&
+			joints.Read(*cache, CacheJointSection);
+
+		// 壊れたキャッシュで範囲外を参照しないように、インデックスを確認しておく
+		if (valid)
+		{
+			const auto& modelInfo = info.m_data[0];
+			const size_t vertexCount = modelInfo.m_vertexCount;
+			const size_t indexSize = modelInfo.m_indexElementSize;
+			valid =
+				positions.m_count == vertexCount &&
+				normals.m_count == vertexCount &&
+				uvs.m_count == vertexCount &&
+				vertexBoneInfos.m_count == vertexCount &&
+				(indexSize == 1 || indexSize == 2 || indexSize == 4) &&
+				indices.m_count == size_t(modelInfo.m_indexCount) * indexSize &&
+				modelInfo.m_vertexCacheOptimized == (m_optimizeVertexCache ? 1u : 0u);
+			switch (valid ? indexSize : 0)
+			{
+			case 1: valid = IsValidVertexIndices(reinterpret_cast<const uint8_t*>(indices.m_data), modelInfo.m_indexCount, vertexCount); break;
+			case 2: valid = IsValidVertexIndices(reinterpret_cast<const uint16_t*>(indices.m_data), modelInfo.m_indexCount, vertexCount); break;
+			case 4: valid = IsValidVertexIndices(reinterpret_cast<const uint32_t*>(indices.m_data), modelInfo.m_indexCount, vertexCount); break;
+			default: break;
+			}
+		}
+		auto isValidIndex = [](int32_t index, size_t count, bool allowNone)
+		{
+			return (allowNone && index == -1) || (index >= 0 && size_t(index) < count);
+		};
+		for (size_t i = 0; valid && i < vertexBoneInfos.m_count; i++)
+		{
+			const auto& vtxInfo = vertexBoneInfos.m_data[i];
+			size_t boneIndexCount = 0;
+			switch (vtxInfo.m_skinningType)
+			{
+			case SkinningType::Weight1: boneIndexCount = 1; break;
+			case SkinningType::Weight2: boneIndexCount = 2; break;
+			case SkinningType::Weight4: boneIndexCount = 4; break;
+			case SkinningType::SDEF: boneIndexCount = 2; break;
+			case SkinningType::DualQuaternion: boneIndexCount = 4; break;
+			default: valid = false; break;
+			}
+			// SDEF の m_sdef.m_boneIndex は m_boneIndex の先頭 2 つと同じ位置にある
+			for (size_t bi = 0; valid && bi < boneIndexCount; bi++)
+			{
+				valid = isValidIndex(vtxInfo.m_boneIndex[bi], bones.m_count, false);
+			}
+		}
+		for (size_t i = 0; valid && i < textures.m_count; i++)
+		{
+			valid = cache->IsValidString(textures.m_data[i]);
+		}
+		// サブメッシュがインデックスバッファをはみ出さないようにする
+		size_t faceVertexRemain = valid ? size_t(info.m_data[0].m_indexCount) : 0;
+		for (size_t i = 0; valid && i < materials.m_count; i++)
+		{
+			const auto& mat = materials.m_data[i];
+			valid =
+				isValidIndex(mat.m_textureIndex, textures.m_count, true) &&
+				isValidIndex(mat.m_sphereTextureIndex, textures.m_count, true) &&
+				(mat.m_toonMode != PMXToonMode::Separate || isValidIndex(mat.m_toonTextureIndex, textures.m_count, true)) &&
+				mat.m_numFaceVertices >= 0 &&
+				size_t(mat.m_numFaceVertices) <= faceVertexRemain;
+			if (valid)
+			{
+				faceVertexRemain -= size_t(mat.m_numFaceVertices);
+			}
+		}
+		for (size_t i = 0; valid && i < bones.m_count; i++)
+		{
+			const auto& bone = bones.m_data[i];
+			valid =
+				cache->IsValidString(bone.m_name) &&
+				isValidIndex(bone.m_parentBoneIndex, bones.m_count, true) &&
+				isValidIndex(bone.m_appendBoneIndex, bones.m_count, true) &&
+				bone.m_ikLinkOffset <= ikLinks.m_count &&
+				bone.m_ikLinkCount <= ikLinks.m_count - bone.m_ikLinkOffset;
+			if (valid && ((uint16_t)bone.m_boneFlag & (uint16_t)PMXBoneFlags::IK) != 0)
+			{
+				valid = isValidIndex(bone.m_ikTargetBoneIndex, bones.m_count, false);
+			}
+		}
+		for (size_t i = 0; valid && i < ikLinks.m_count; i++)
+		{
+			valid = isValidIndex(ikLinks.m_data[i].m_ikBoneIndex, bones.m_count, false);
+		}
+		for (size_t i = 0; valid && i < morphs.m_count; i++)
+		{
+			const auto& morph = morphs.m_data[i];
+			size_t dataCount = 0;
+			switch (MorphType(morph.m_morphType))
+			{
+			case MorphType::None: dataCount = 0; break;
+			case MorphType::Position: dataCount = positionMorphs.m_count; break;
+			case MorphType::UV: dataCount = uvMorphs.m_count; break;
+			case MorphType::Material: dataCount = materialMorphs.m_count; break;
+			case MorphType::Bone: dataCount = boneMorphs.m_count; break;
+			case MorphType::Group: dataCount = groupMorphs.m_count; break;
+			default: valid = false; break;
+			}
+			valid = valid &&
+				cache->IsValidString(morph.m_name) &&
+				morph.m_dataOffset <= dataCount &&
+				morph.m_dataCount <= dataCount - morph.m_dataOffset;
+		}
+		for (size_t i = 0; valid && i < positionMorphs.m_count; i++)
+		{
+			valid = positionMorphs.m_data[i].m_index < positions.m_count;
+		}
+		for (size_t i = 0; valid && i < uvMorphs.m_count; i++)
+		{
+			valid = uvMorphs.m_data[i].m_index < positions.m_count;
+		}
+		for (size_t i = 0; valid && i < boneMorphs.m_count; i++)
+		{
+			valid = isValidIndex(boneMorphs.m_data[i].m_boneIndex, bones.m_count, false);
+		}
+		for (size_t i = 0; valid && i < materialMorphs.m_count; i++)
+		{
+			valid = isValidIndex(materialMorphs.m_data[i].m_materialIndex, materials.m_count, true);
+		}
+		for (size_t i = 0; valid && i < groupMorphs.m_count; i++)
+		{
+			valid = isValidIndex(groupMorphs.m_data[i].m_morphIndex, morphs.m_count, true);
+		}
+		for (size_t i = 0; valid && i < rigidbodies.m_count; i++)
+		{
+			valid =
+				cache->IsValidString(rigidbodies.m_data[i].m_name) &&
+				isValidIndex(rigidbodies.m_data[i].m_boneIndex, bones.m_count, true);
+		}
+		for (size_t i = 0; valid && i < joints.m_count; i++)
+		{
+			valid =
+				cache->IsValidString(joints.m_data[i].m_name) &&
+				isValidIndex(joints.m_data[i].m_rigidbodyAIndex, rigidbodies.m_count, true) &&
+				isValidIndex(joints.m_data[i].m_rigidbodyBIndex, rigidbodies.m_count, true);
+		}
+		if (!valid)
+		{
+			SABA_WARN("PMX Cache is broken. [{}]", cachePath);
+			cache->Close();
+			return false;
+		}
+
+		// 頂点データはそのままコピーする (share の場合は参照する)
+		const auto& modelInfo = info.m_data[0];
+		positions.Store(&m_positions, 0, positions.m_count, share);
+		normals.Store(&m_normals, 0, normals.m_count, share);
+		uvs.Store(&m_uvs, 0, uvs.m_count, share);
+		vertexBoneInfos.Store(&m_vertexBoneInfos, 0, vertexBoneInfos.m_count, share);
+		indices.Store(&m_indices, 0, indices.m_count, share);
+		m_indexCount = modelInfo.m_indexCount;
+		m_indexElementSize = modelInfo.m_indexElementSize;
+		m_bboxMin = modelInfo.m_bboxMin;
+		m_bboxMax = modelInfo.m_bboxMax;
+
+		pmx->m_textures.resize(textures.m_count);
+		for (size_t i = 0; i < textures.m_count; i++)
+		{
+			pmx->m_textures[i].m_textureName = cache->GetString(textures.m_data[i]);
+		}
+
+		pmx->m_materials.resize(materials.m_count);
+		for (size_t i = 0; i < materials.m_count; i++)
+		{
+			const auto& src = materials.m_data[i];
+			auto& dst = pmx->m_materials[i];
+			dst.m_diffuse = src.m_diffuse;
+			dst.m_specular = src.m_specular;
+			dst.m_specularPower = src.m_specularPower;
+			dst.m_ambient = src.m_ambient;
+			dst.m_drawMode = src.m_drawMode;
+			dst.m_edgeColor = src.m_edgeColor;
+			dst.m_edgeSize = src.m_edgeSize;
+			dst.m_textureIndex = src.m_textureIndex;
+			dst.m_sphereTextureIndex = src.m_sphereTextureIndex;
+			dst.m_sphereMode = src.m_sphereMode;
+			dst.m_toonMode = src.m_toonMode;
+			dst.m_toonTextureIndex = src.m_toonTextureIndex;
+			dst.m_numFaceVertices = src.m_numFaceVertices;
+		}
+
+		pmx->m_bones.resize(bones.m_count);
+		for (size_t i = 0; i < bones.m_count; i++)
+		{
+			const auto& src = bones.m_data[i];
+			auto& dst = pmx->m_bones[i];
+			dst.m_name = cache->GetString(src.m_name);
+			dst.m_position = src.m_position;
+			dst.m_parentBoneIndex = src.m_parentBoneIndex;
+			dst.m_deformDepth = src.m_deformDepth;
+			dst.m_boneFlag = src.m_boneFlag;
+			dst.m_appendBoneIndex = src.m_appendBoneIndex;
+			dst.m_appendWeight = src.m_appendWeight;
+			dst.m_ikTargetBoneIndex = src.m_ikTargetBoneIndex;
+			dst.m_ikIterationCount = src.m_ikIterationCount;
+			dst.m_ikLimit = src.m_ikLimit;
+			dst.m_ikLinks.assign(ikLinks.m_data + src.m_ikLinkOffset, ikLinks.m_data + src.m_ikLinkOffset + src.m_ikLinkCount);
+		}
 
+		pmx->m_rigidbodies.resize(rigidbodies.m_count);
+		for (size_t i = 0; i < rigidbodies.m_count; i++)
+		{
+			pmx->m_rigidbodies[i] = rigidbodies.m_data[i].ToPMX();
+			pmx->m_rigidbodies[i].m_name = cache->GetString(rigidbodies.m_data[i].m_name);
+		}
+
+		pmx->m_joints.resize(joints.m_count);
+		for (size_t i = 0; i < joints.m_count; i++)
+		{
+			pmx->m_joints[i] = joints.m_data[i].ToPMX();
+			pmx->m_joints[i].m_name = cache->GetString(joints.m_data[i].m_name);
+		}
+
+		SABA_INFO("PMX Cache Read Successed. {}", cachePath);
 		return true;
 	}
 
+	void PMXModel::LoadCacheMorphs(const PMXCacheReader& cache, bool share)
+	{
+		// LoadCache で確認済み
+		CacheArray<CacheMorph> morphs;
+		CacheArray<PositionMorph> positionMorphs;
+		CacheArray<UVMorph> uvMorphs;
+		CacheArray<saba::PMXMorph::MaterialMorph> materialMorphs;
+		CacheArray<CacheBoneMorph> boneMorphs;
+		CacheArray<saba::PMXMorph::GroupMorph> groupMorphs;
+		morphs.Read(cache, CacheMorphSection);
+		positionMorphs.Read(cache, CachePositionMorphSection);
+		uvMorphs.Read(cache, CacheUVMorphSection);
+		materialMorphs.Read(cache, CacheMaterialMorphSection);
+		boneMorphs.Read(cache, CacheBoneMorphSection);
+		groupMorphs.Read(cache, CacheGroupMorphSection);
+
+		for (size_t i = 0; i < morphs.m_count; i++)
+		{
+			const auto& cacheMorph = morphs.m_data[i];
+			const size_t begin = cacheMorph.m_dataOffset;
+			const size_t end = begin + cacheMorph.m_dataCount;
+
+			auto morph = m_morphMan.AddMorph();
+			morph->SetName(cache.GetString(cacheMorph.m_name));
+			morph->SetWeight(0.0f);
+			morph->m_morphType = MorphType(cacheMorph.m_morphType);
+			switch (morph->m_morphType)
+			{
+			case MorphType::Position:
+				morph->m_dataIndex = m_positionMorphDatas.size();
+				m_positionMorphDatas.emplace_back();
+				positionMorphs.Store(&m_positionMorphDatas.back().m_morphVertices, begin, end - begin, share);
+				break;
+			case MorphType::UV:
+				morph->m_dataIndex = m_uvMorphDatas.size();
+				m_uvMorphDatas.emplace_back();
+				uvMorphs.Store(&m_uvMorphDatas.back().m_morphUVs, begin, end - begin, share);
+				break;
+			case MorphType::Material:
+				morph->m_dataIndex = m_materialMorphDatas.size();
+				m_materialMorphDatas.emplace_back();
+				m_materialMorphDatas.back().m_materialMorphs.assign(materialMorphs.m_data + begin, materialMorphs.m_data + end);
+				break;
+			case MorphType::Bone:
+				morph->m_dataIndex = m_boneMorphDatas.size();
+				m_boneMorphDatas.emplace_back();
+				for (size_t j = begin; j < end; j++)
+				{
+					BoneMorphElement elem;
+					elem.m_node = m_nodeMan.GetMMDNode(boneMorphs.m_data[j].m_boneIndex);
+					elem.m_position = boneMorphs.m_data[j].m_position;
+					elem.m_rotate = boneMorphs.m_data[j].m_rotate;
+					m_boneMorphDatas.back().m_boneMorphs.push_back(elem);
+				}
+				break;
+			case MorphType::Group:
+				morph->m_dataIndex = m_groupMorphDatas.size();
+				m_groupMorphDatas.emplace_back();
+				m_groupMorphDatas.back().m_groupMorphs.assign(groupMorphs.m_data + begin, groupMorphs.m_data + end);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	bool PMXModel::SaveCache(const std::string& cachePath, const std::string& filepath, const PMXFile& pmx)
+	{
+		SABA_TRACE_SCOPE("PMXModel::SaveCache");
+
+		PMXCacheWriter writer;
+
+		CacheModelInfo info = {};
+		info.m_vertexCount = uint32_t(m_positions.size());
+		info.m_indexCount = uint32_t(m_indexCount);
+		info.m_indexElementSize = uint32_t(m_indexElementSize);
+		info.m_vertexCacheOptimized = m_optimizeVertexCache ? 1 : 0;
+		info.m_bboxMin = m_bboxMin;
+		info.m_bboxMax = m_bboxMax;
+		writer.AddSection(CacheModelInfoSection, &info, 1);
+		writer.AddSection(CachePositionSection, m_positions.data(), m_positions.size());
+		writer.AddSection(CacheNormalSection, m_normals.data(), m_normals.size());
+		writer.AddSection(CacheUVSection, m_uvs.data(), m_uvs.size());
+		writer.AddSection(CacheVertexBoneInfoSection, m_vertexBoneInfos.data(), m_vertexBoneInfos.size());
+		writer.AddSection(CacheIndexSection, m_indices.data(), m_indices.size());
+
+		std::vector<PMXCacheString> textures;
+		for (const auto& tex : pmx.m_textures)
+		{
+			textures.push_back(writer.AddString(tex.m_textureName));
+		}
+		writer.AddSection(CacheTextureSection, textures);
+
+		std::vector<CacheMaterial> materials;
+		for (const auto& src : pmx.m_materials)
+		{
+			CacheMaterial dst = {};
+			dst.m_diffuse = src.m_diffuse;
+			dst.m_specular = src.m_specular;
+			dst.m_specularPower = src.m_specularPower;
+			dst.m_ambient = src.m_ambient;
+			dst.m_drawMode = src.m_drawMode;
+			dst.m_edgeColor = src.m_edgeColor;
+			dst.m_edgeSize = src.m_edgeSize;
+			dst.m_textureIndex = src.m_textureIndex;
+			dst.m_sphereTextureIndex = src.m_sphereTextureIndex;
+			dst.m_sphereMode = src.m_sphereMode;
+			dst.m_toonMode = src.m_toonMode;
+			dst.m_toonTextureIndex = src.m_toonTextureIndex;
+			dst.m_numFaceVertices = src.m_numFaceVertices;
+			materials.push_back(dst);
+		}
+		writer.AddSection(CacheMaterialSection, materials);
+
+		std::vector<CacheBone> bones;
+		std::vector<PMXIKLink> ikLinks;
+		for (const auto& src : pmx.m_bones)
+		{
+			CacheBone dst = {};
+			dst.m_name = writer.AddString(src.m_name);
+			dst.m_position = src.m_position;
+			dst.m_parentBoneIndex = src.m_parentBoneIndex;
+			dst.m_deformDepth = src.m_deformDepth;
+			dst.m_boneFlag = src.m_boneFlag;
+			dst.m_appendBoneIndex = src.m_appendBoneIndex;
+			dst.m_appendWeight = src.m_appendWeight;
+			dst.m_ikTargetBoneIndex = src.m_ikTargetBoneIndex;
+			dst.m_ikIterationCount = src.m_ikIterationCount;
+			dst.m_ikLimit = src.m_ikLimit;
+			dst.m_ikLinkOffset = uint32_t(ikLinks.size());
+			dst.m_ikLinkCount = uint32_t(src.m_ikLinks.size());
+			ikLinks.insert(ikLinks.end(), src.m_ikLinks.begin(), src.m_ikLinks.end());
+			bones.push_back(dst);
+		}
+		writer.AddSection(CacheBoneSection, bones);
+		writer.AddSection(CacheIKLinkSection, ikLinks);
+
+		// 無限ループを修正した後のグループモーフを保存する
+		std::vector<CacheMorph> morphs;
+		std::vector<PositionMorph> positionMorphs;
+		std::vector<UVMorph> uvMorphs;
+		std::vector<saba::PMXMorph::MaterialMorph> materialMorphs;
+		std::vector<CacheBoneMorph> boneMorphs;
+		std::vector<saba::PMXMorph::GroupMorph> groupMorphs;
+		for (const auto& morph : (*m_morphMan.GetMorphs()))
+		{
+			CacheMorph dst = {};
+			dst.m_name = writer.AddString(morph->GetName());
+			dst.m_morphType = uint32_t(morph->m_morphType);
+			switch (morph->m_morphType)
+			{
+			case MorphType::Position:
+			{
+				const auto& data = m_positionMorphDatas[morph->m_dataIndex].m_morphVertices;
+				dst.m_dataOffset = uint32_t(positionMorphs.size());
+				dst.m_dataCount = uint32_t(data.size());
+				positionMorphs.insert(positionMorphs.end(), data.begin(), data.end());
+				break;
+			}
+			case MorphType::UV:
+			{
+				const auto& data = m_uvMorphDatas[morph->m_dataIndex].m_morphUVs;
+				dst.m_dataOffset = uint32_t(uvMorphs.size());
+				dst.m_dataCount = uint32_t(data.size());
+				uvMorphs.insert(uvMorphs.end(), data.begin(), data.end());
+				break;
+			}
+			case MorphType::Material:
+			{
+				const auto& data = m_materialMorphDatas[morph->m_dataIndex].m_materialMorphs;
+				dst.m_dataOffset = uint32_t(materialMorphs.size());
+				dst.m_dataCount = uint32_t(data.size());
+				materialMorphs.insert(materialMorphs.end(), data.begin(), data.end());
+				break;
+			}
+			case MorphType::Bone:
+			{
+				const auto& data = m_boneMorphDatas[morph->m_dataIndex].m_boneMorphs;
+				dst.m_dataOffset = uint32_t(boneMorphs.size());
+				dst.m_dataCount = uint32_t(data.size());
+				for (const auto& elem : data)
+				{
+					CacheBoneMorph boneMorph = {};
+					boneMorph.m_boneIndex = int32_t(elem.m_node->GetIndex());
+					boneMorph.m_position = elem.m_position;
+					boneMorph.m_rotate = elem.m_rotate;
+					boneMorphs.push_back(boneMorph);
+				}
+				break;
+			}
+			case MorphType::Group:
+			{
+				const auto& data = m_groupMorphDatas[morph->m_dataIndex].m_groupMorphs;
+				dst.m_dataOffset = uint32_t(groupMorphs.size());
+				dst.m_dataCount = uint32_t(data.size());
+				groupMorphs.insert(groupMorphs.end(), data.begin(), data.end());
+				break;
+			}
+			default:
+				break;
+			}
+			morphs.push_back(dst);
+		}
+		writer.AddSection(CacheMorphSection, morphs);
+		writer.AddSection(CachePositionMorphSection, positionMorphs);
+		writer.AddSection(CacheUVMorphSection, uvMorphs);
+		writer.AddSection(CacheMaterialMorphSection, materialMorphs);
+		writer.AddSection(CacheBoneMorphSection, boneMorphs);
+		writer.AddSection(CacheGroupMorphSection, groupMorphs);
+
+		std::vector<CacheRigidbody> rigidbodies;
+		for (const auto& src : pmx.m_rigidbodies)
+		{
+			CacheRigidbody dst = {};
+			dst.FromPMX(src);
+			dst.m_name = writer.AddString(src.m_name);
+			rigidbodies.push_back(dst);
+		}
+		writer.AddSection(CacheRigidbodySection, rigidbodies);
+
+		std::vector<CacheJoint> joints;
+		for (const auto& src : pmx.m_joints)
+		{
+			CacheJoint dst = {};
+			dst.FromPMX(src);
+			dst.m_name = writer.AddString(src.m_name);
+			joints.push_back(dst);
+		}
+		writer.AddSection(CacheJointSection, joints);
+
+		return writer.Write(cachePath, filepath);
+	}
+
 	void PMXModel::Destroy()
 	{
 		m_materials.clear();
@@ -871,9 +1739,24 @@ namespace saba
 		m_normals.clear();
 		m_uvs.clear();
 		m_vertexBoneInfos.clear();
+		m_approxBoneInfos.clear();
 
 		m_indices.clear();
 
+		m_positionMorphDatas.clear();
+		m_uvMorphDatas.clear();
+		m_materialMorphDatas.clear();
+		m_boneMorphDatas.clear();
+		m_groupMorphDatas.clear();
+		m_morphMan.GetMorphs()->clear();
+
+		// 参照している配列を消した後で閉じる
+		m_sharedCache.reset();
+
+		m_meshLODs.clear();
+		m_lod = 0;
+		m_approximateSkinning = false;
+
 		m_nodeMan.GetNodes()->clear();
 
 		m_updateRanges.clear();
@@ -897,7 +1780,13 @@ namespace saba
 		m_updateRanges.resize(m_parallelUpdateCount);
 		m_parallelUpdateFutures.resize(m_parallelUpdateCount - 1);
 
-		const size_t vertexCount = m_positions.size();
+		SetupUpdateRanges();
+	}
+
+	void PMXModel::SetupUpdateRanges()
+	{
+		// LOD が参照する頂点だけを分割する
+		const size_t vertexCount = m_lod == 0 ? m_positions.size() : m_meshLODs[m_lod - 1].m_vertices.size();
 		const size_t LowerVertexCount = 1000;
 		if (vertexCount < m_updateRanges.size() * LowerVertexCount)
 		{
@@ -935,138 +1824,396 @@ namespace saba
 		}
 	}
 
-	void PMXModel::Update(const UpdateRange & range)
+	void PMXModel::UpdateTransforms()
 	{
-		const auto* position = m_positions.data() + range.m_vertexOffset;
-		const auto* normal = m_normals.data() + range.m_vertexOffset;
-		const auto* uv = m_uvs.data() + range.m_vertexOffset;
-		const auto* morphPos = m_morphPositions.data() + range.m_vertexOffset;
-		const auto* morphUV = m_morphUVs.data() + range.m_vertexOffset;
-		const auto* vtxInfo = m_vertexBoneInfos.data() + range.m_vertexOffset;
-		const auto* transforms = m_transforms.data();
-		auto* updatePosition = m_updatePositions.data() + range.m_vertexOffset;
-		auto* updateNormal = m_updateNormals.data() + range.m_vertexOffset;
-		auto* updateUV = m_updateUVs.data() + range.m_vertexOffset;
+		// スキンメッシュに使用する変形マトリクスを事前計算
+		auto& nodes = (*m_nodeMan.GetNodes());
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			m_transforms[i] = nodes[i]->GetGlobalTransform() * nodes[i]->GetInverseInitTransform();
+		}
+	}
 
-		for (size_t i = 0; i < range.m_vertexCount; i++)
+	void PMXModel::GetSkinningVertices(MMDSkinningVertex* vertices) const
+	{
+		for (size_t i = 0; i < m_vertexBoneInfos.size(); i++)
 		{
-			glm::mat4 m;
-			switch (vtxInfo->m_skinningType)
+			const auto& vtxInfo = m_vertexBoneInfos[i];
+			auto& dest = vertices[i];
+			for (int bi = 0; bi < 4; bi++)
 			{
-			case PMXModel::SkinningType::Weight1:
+				dest.m_boneIndex[bi] = 0;
+				dest.m_boneWeight[bi] = 0;
+			}
+			dest.m_type = MMDSkinningVertex::Type::Linear;
+			dest.m_sdefC = glm::vec3(0);
+			dest.m_sdefR0 = glm::vec3(0);
+			dest.m_sdefR1 = glm::vec3(0);
+			switch (vtxInfo.m_skinningType)
 			{
-				const auto i0 = vtxInfo->m_boneIndex[0];
-				const auto& m0 = transforms[i0];
-				m = m0;
+			case SkinningType::Weight1:
+				dest.m_boneIndex[0] = vtxInfo.m_boneIndex[0];
+				dest.m_boneWeight[0] = 1.0f;
+				break;
+			case SkinningType::Weight2:
+				for (int bi = 0; bi < 2; bi++)
+				{
+					dest.m_boneIndex[bi] = vtxInfo.m_boneIndex[bi];
+					dest.m_boneWeight[bi] = vtxInfo.m_boneWeight[bi];
+				}
+				break;
+			case SkinningType::Weight4:
+			case SkinningType::DualQuaternion:
+				for (int bi = 0; bi < 4; bi++)
+				{
+					if (vtxInfo.m_boneIndex[bi] != -1)
+					{
+						dest.m_boneIndex[bi] = vtxInfo.m_boneIndex[bi];
+						dest.m_boneWeight[bi] = vtxInfo.m_boneWeight[bi];
+					}
+				}
+				if (vtxInfo.m_skinningType == SkinningType::DualQuaternion)
+				{
+					dest.m_type = MMDSkinningVertex::Type::DualQuaternion;
+				}
+				break;
+			case SkinningType::SDEF:
+				dest.m_type = MMDSkinningVertex::Type::SDEF;
+				dest.m_boneIndex[0] = vtxInfo.m_sdef.m_boneIndex[0];
+				dest.m_boneIndex[1] = vtxInfo.m_sdef.m_boneIndex[1];
+				dest.m_boneWeight[0] = vtxInfo.m_sdef.m_boneWeight;
+				dest.m_boneWeight[1] = 1.0f - vtxInfo.m_sdef.m_boneWeight;
+				dest.m_sdefC = vtxInfo.m_sdef.m_sdefC;
+				dest.m_sdefR0 = vtxInfo.m_sdef.m_sdefR0;
+				dest.m_sdefR1 = vtxInfo.m_sdef.m_sdefR1;
+				break;
+			default:
 				break;
 			}
-			case PMXModel::SkinningType::Weight2:
+		}
+	}
+
+	void PMXModel::UpdateSkinning(MMDSkinningData* data)
+	{
+		SABA_TRACE_SCOPE("PMXModel::UpdateSkinning");
+
+		UpdateTransforms();
+
+		data->m_transforms = m_transforms.data();
+		data->m_transformCount = m_transforms.size();
+		data->m_morphPositions = m_morphPositions.data();
+		data->m_morphUVs = m_morphUVs.data();
+		data->m_morphBegin = m_morphBegin;
+		data->m_morphEnd = m_morphEnd;
+	}
+
+	void PMXModel::Update(const UpdateRange & range, const MMDVertexSink& sink)
+	{
+		SABA_TRACE_SCOPE("PMXModel::UpdateRange");
+
+		const MMDVertexStreamWriter positionWriter(sink.m_positions, sizeof(glm::vec3));
+		const MMDVertexStreamWriter normalWriter(sink.m_normals, sizeof(glm::vec3));
+		const MMDVertexStreamWriter uvWriter(sink.m_uvs, sizeof(glm::vec2));
+		const uint32_t* lodVertices = m_lod == 0 ? nullptr : m_meshLODs[m_lod - 1].m_vertices.data();
+		for (size_t i = 0; i < range.m_vertexCount; i++)
+		{
+			size_t vtxIdx = range.m_vertexOffset + i;
+			if (lodVertices != nullptr)
 			{
-				const auto i0 = vtxInfo->m_boneIndex[0];
-				const auto i1 = vtxInfo->m_boneIndex[1];
-				const auto w0 = vtxInfo->m_boneWeight[0];
-				const auto w1 = vtxInfo->m_boneWeight[1];
-				const auto& m0 = transforms[i0];
-				const auto& m1 = transforms[i1];
-				m = m0 * w0 + m1 * w1;
-				break;
+				vtxIdx = lodVertices[vtxIdx];
 			}
-			case PMXModel::SkinningType::Weight4:
-			{
-				const auto i0 = vtxInfo->m_boneIndex[0];
-				const auto i1 = vtxInfo->m_boneIndex[1];
-				const auto i2 = vtxInfo->m_boneIndex[2];
-				const auto i3 = vtxInfo->m_boneIndex[3];
-				const auto w0 = vtxInfo->m_boneWeight[0];
-				const auto w1 = vtxInfo->m_boneWeight[1];
-				const auto w2 = vtxInfo->m_boneWeight[2];
-				const auto w3 = vtxInfo->m_boneWeight[3];
-				const auto& m0 = transforms[i0];
-				const auto& m1 = transforms[i1];
-				const auto& m2 = transforms[i2];
-				const auto& m3 = transforms[i3];
-				m = m0 * w0 + m1 * w1 + m2 * w2 + m3 * w3;
-				break;
+			glm::vec3 position;
+			glm::vec3 normal;
+			glm::vec2 uv;
+			if (m_approximateSkinning)
+			{
+				UpdateVertexApprox(vtxIdx, &position, &normal, &uv);
 			}
-			case PMXModel::SkinningType::SDEF:
+			else
 			{
-				// https://github.com/powroupi/blender_mmd_tools/blob/dev_test/mmd_tools/core/sdef.py
+				UpdateVertex(vtxIdx, &position, &normal, &uv);
+			}
+			positionWriter.Write(vtxIdx, position);
+			normalWriter.Write(vtxIdx, normal);
+			uvWriter.Write(vtxIdx, uv);
+		}
+	}
+
+	void PMXModel::UpdateVertex(size_t vtxIdx, glm::vec3* updatePosition, glm::vec3* updateNormal, glm::vec2* updateUV)
+	{
+		const auto* position = &m_positions[vtxIdx];
+		const auto* normal = &m_normals[vtxIdx];
+		const auto* uv = &m_uvs[vtxIdx];
+		const auto* morphPos = &m_morphPositions[vtxIdx];
+		const auto* morphUV = &m_morphUVs[vtxIdx];
+		const auto* vtxInfo = &m_vertexBoneInfos[vtxIdx];
+		const auto* transforms = m_transforms.data();
+
+		glm::mat4 m;
+		switch (vtxInfo->m_skinningType)
+		{
+		case PMXModel::SkinningType::Weight1:
+		{
+			const auto i0 = vtxInfo->m_boneIndex[0];
+			const auto& m0 = transforms[i0];
+			m = m0;
+			break;
+		}
+		case PMXModel::SkinningType::Weight2:
+		{
+			const auto i0 = vtxInfo->m_boneIndex[0];
+			const auto i1 = vtxInfo->m_boneIndex[1];
+			const auto w0 = vtxInfo->m_boneWeight[0];
+			const auto w1 = vtxInfo->m_boneWeight[1];
+			const auto& m0 = transforms[i0];
+			const auto& m1 = transforms[i1];
+			m = m0 * w0 + m1 * w1;
+			break;
+		}
+		case PMXModel::SkinningType::Weight4:
+		{
+			const auto i0 = vtxInfo->m_boneIndex[0];
+			const auto i1 = vtxInfo->m_boneIndex[1];
+			const auto i2 = vtxInfo->m_boneIndex[2];
+			const auto i3 = vtxInfo->m_boneIndex[3];
+			const auto w0 = vtxInfo->m_boneWeight[0];
+			const auto w1 = vtxInfo->m_boneWeight[1];
+			const auto w2 = vtxInfo->m_boneWeight[2];
+			const auto w3 = vtxInfo->m_boneWeight[3];
+			const auto& m0 = transforms[i0];
+			const auto& m1 = transforms[i1];
+			const auto& m2 = transforms[i2];
+			const auto& m3 = transforms[i3];
+			m = m0 * w0 + m1 * w1 + m2 * w2 + m3 * w3;
+			break;
+		}
+		case PMXModel::SkinningType::SDEF:
+		{
+			// https://github.com/powroupi/blender_mmd_tools/blob/dev_test/mmd_tools/core/sdef.py
 
-				auto& nodes = (*m_nodeMan.GetNodes());
-				const auto i0 = vtxInfo->m_sdef.m_boneIndex[0];
-				const auto i1 = vtxInfo->m_sdef.m_boneIndex[1];
-				const auto w0 = vtxInfo->m_sdef.m_boneWeight;
-				const auto w1 = 1.0f - w0;
-				const auto center = vtxInfo->m_sdef.m_sdefC;
-				const auto cr0 = vtxInfo->m_sdef.m_sdefR0;
-				const auto cr1 = vtxInfo->m_sdef.m_sdefR1;
-				const auto q0 = glm::quat_cast(nodes[i0]->GetGlobalTransform());
-				const auto q1 = glm::quat_cast(nodes[i1]->GetGlobalTransform());
-				const auto m0 = transforms[i0];
-				const auto m1 = transforms[i1];
+			auto& nodes = (*m_nodeMan.GetNodes());
+			const auto i0 = vtxInfo->m_sdef.m_boneIndex[0];
+			const auto i1 = vtxInfo->m_sdef.m_boneIndex[1];
+			const auto w0 = vtxInfo->m_sdef.m_boneWeight;
+			const auto w1 = 1.0f - w0;
+			const auto center = vtxInfo->m_sdef.m_sdefC;
+			const auto cr0 = vtxInfo->m_sdef.m_sdefR0;
+			const auto cr1 = vtxInfo->m_sdef.m_sdefR1;
+			const auto q0 = glm::quat_cast(nodes[i0]->GetGlobalTransform());
+			const auto q1 = glm::quat_cast(nodes[i1]->GetGlobalTransform());
+			const auto m0 = transforms[i0];
+			const auto m1 = transforms[i1];
 
-				const auto pos = *position + *morphPos;
-				const auto rot_mat = glm::mat3_cast(glm::slerp(q0, q1, w1));
+			const auto pos = *position + *morphPos;
+			const auto rot_mat = glm::mat3_cast(glm::slerp(q0, q1, w1));
 
-				*updatePosition = glm::mat3(rot_mat) * (pos - center) + glm::vec3(m0 * glm::vec4(cr0, 1)) * w0 + glm::vec3(m1 * glm::vec4(cr1, 1)) * w1;
-				*updateNormal = rot_mat * *normal;
+			*updatePosition = glm::mat3(rot_mat) * (pos - center) + glm::vec3(m0 * glm::vec4(cr0, 1)) * w0 + glm::vec3(m1 * glm::vec4(cr1, 1)) * w1;
+			*updateNormal = rot_mat * *normal;
 
-				break;
+			break;
+		}
+		case PMXModel::SkinningType::DualQuaternion:
+		{
+			//
+			// Skinning with Dual Quaternions
+			// https://www.cs.utah.edu/~ladislav/dq/index.html
+			//
+			glm::dualquat dq[4];
+			float w[4] = { 0 };
+			for (int bi = 0; bi < 4; bi++)
+			{
+				auto boneID = vtxInfo->m_boneIndex[bi];
+				if (boneID != -1)
+				{ 
+					dq[bi] = glm::dualquat_cast(glm::mat3x4(glm::transpose(transforms[boneID])));
+					dq[bi] = glm::normalize(dq[bi]);
+					w[bi] = vtxInfo->m_boneWeight[bi];
+				}
+				else
+				{
+					w[bi] = 0;
+				}
 			}
-			case PMXModel::SkinningType::DualQuaternion:
+			if (glm::dot(dq[0].real, dq[1].real) < 0) { w[1] *= -1.0f; }
+			if (glm::dot(dq[0].real, dq[2].real) < 0) { w[2] *= -1.0f; }
+			if (glm::dot(dq[0].real, dq[3].real) < 0) { w[3] *= -1.0f; }
+			auto blendDQ = w[0] * dq[0]
+				+ w[1] * dq[1]
+				+ w[2] * dq[2]
+				+ w[3] * dq[3];
+			blendDQ = glm::normalize(blendDQ);
+			m = glm::transpose(glm::mat3x4_cast(blendDQ));
+			break;
+		}
+		default:
+			break;
+		}
+
+		if (PMXModel::SkinningType::SDEF != vtxInfo->m_skinningType)
+		{
+			*updatePosition = glm::vec3(m * glm::vec4(*position + *morphPos, 1));
+			*updateNormal = glm::normalize(glm::mat3(m) * *normal);
+		}
+		*updateUV = *uv + glm::vec2((*morphUV).x, (*morphUV).y);
+	}
+
+	void PMXModel::UpdateVertexApprox(size_t vtxIdx, glm::vec3* updatePosition, glm::vec3* updateNormal, glm::vec2* updateUV)
+	{
+		const auto& approx = m_approxBoneInfos[vtxIdx];
+		const auto& m0 = m_transforms[approx.m_boneIndex[0]];
+		const auto& m1 = m_transforms[approx.m_boneIndex[1]];
+		const auto w0 = approx.m_boneWeight;
+		const auto w1 = 1.0f - w0;
+		glm::mat4 m = m0 * w0 + m1 * w1;
+
+		*updatePosition = glm::vec3(m * glm::vec4(m_positions[vtxIdx] + m_morphPositions[vtxIdx], 1));
+		*updateNormal = glm::normalize(glm::mat3(m) * m_normals[vtxIdx]);
+		const auto& morphUV = m_morphUVs[vtxIdx];
+		*updateUV = m_uvs[vtxIdx] + glm::vec2(morphUV.x, morphUV.y);
+	}
+
+	const MMDMeshLOD* PMXModel::GetMeshLOD(size_t lod) const
+	{
+		if (lod == 0 || lod > m_meshLODs.size())
+		{
+			return nullptr;
+		}
+		return &m_meshLODs[lod - 1];
+	}
+
+	void PMXModel::SetLOD(size_t lod, bool approximateSkinning)
+	{
+		lod = std::min(lod, m_meshLODs.size());
+		// 近似用のウェイトは BuildLOD で作る
+		m_approximateSkinning = approximateSkinning && !m_approxBoneInfos.empty();
+		if (m_lod != lod)
+		{
+			m_lod = lod;
+			SetupUpdateRanges();
+		}
+	}
+
+	bool PMXModel::BuildLOD(size_t lodCount)
+	{
+		m_meshLODs.clear();
+
+		// ボーンウェイト
+		const size_t vertexCount = m_positions.size();
+		std::vector<MMDLODVertexWeight> weights(vertexCount);
+		m_approxBoneInfos.resize(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			const auto& vtxInfo = m_vertexBoneInfos[i];
+			auto& w = weights[i];
+			for (int bi = 0; bi < 4; bi++)
 			{
-				//
-				// Skinning with Dual Quaternions
-				// https://www.cs.utah.edu/~ladislav/dq/index.html
-				//
-				glm::dualquat dq[4];
-				float w[4] = { 0 };
+				w.m_boneIndex[bi] = -1;
+				w.m_boneWeight[bi] = 0;
+			}
+			switch (vtxInfo.m_skinningType)
+			{
+			case SkinningType::Weight1:
+				w.m_boneIndex[0] = vtxInfo.m_boneIndex[0];
+				w.m_boneWeight[0] = 1.0f;
+				break;
+			case SkinningType::Weight2:
+				for (int bi = 0; bi < 2; bi++)
+				{
+					w.m_boneIndex[bi] = vtxInfo.m_boneIndex[bi];
+					w.m_boneWeight[bi] = vtxInfo.m_boneWeight[bi];
+				}
+				break;
+			case SkinningType::Weight4:
+			case SkinningType::DualQuaternion:
 				for (int bi = 0; bi < 4; bi++)
 				{
-					auto boneID = vtxInfo->m_boneIndex[bi];
-					if (boneID != -1)
-					{ 
-						dq[bi] = glm::dualquat_cast(glm::mat3x4(glm::transpose(transforms[boneID])));
-						dq[bi] = glm::normalize(dq[bi]);
-						w[bi] = vtxInfo->m_boneWeight[bi];
-					}
-					else
+					if (vtxInfo.m_boneIndex[bi] != -1)
 					{
-						w[bi] = 0;
+						w.m_boneIndex[bi] = vtxInfo.m_boneIndex[bi];
+						w.m_boneWeight[bi] = vtxInfo.m_boneWeight[bi];
 					}
 				}
-				if (glm::dot(dq[0].real, dq[1].real) < 0) { w[1] *= -1.0f; }
-				if (glm::dot(dq[0].real, dq[2].real) < 0) { w[2] *= -1.0f; }
-				if (glm::dot(dq[0].real, dq[3].real) < 0) { w[3] *= -1.0f; }
-				auto blendDQ = w[0] * dq[0]
-					+ w[1] * dq[1]
-					+ w[2] * dq[2]
-					+ w[3] * dq[3];
-				blendDQ = glm::normalize(blendDQ);
-				m = glm::transpose(glm::mat3x4_cast(blendDQ));
 				break;
-			}
+			case SkinningType::SDEF:
+				w.m_boneIndex[0] = vtxInfo.m_sdef.m_boneIndex[0];
+				w.m_boneIndex[1] = vtxInfo.m_sdef.m_boneIndex[1];
+				w.m_boneWeight[0] = vtxInfo.m_sdef.m_boneWeight;
+				w.m_boneWeight[1] = 1.0f - vtxInfo.m_sdef.m_boneWeight;
+				break;
 			default:
 				break;
 			}
 
-			if (PMXModel::SkinningType::SDEF != vtxInfo->m_skinningType)
+			// 重みの大きい 2 つのボーンで近似する
+			int first = 0;
+			for (int bi = 1; bi < 4; bi++)
+			{
+				if (w.m_boneWeight[bi] > w.m_boneWeight[first]) { first = bi; }
+			}
+			int second = first == 0 ? 1 : 0;
+			for (int bi = 0; bi < 4; bi++)
+			{
+				if (bi != first && w.m_boneWeight[bi] > w.m_boneWeight[second]) { second = bi; }
+			}
+			auto& approx = m_approxBoneInfos[i];
+			approx.m_boneIndex[0] = w.m_boneIndex[first];
+			approx.m_boneIndex[1] = w.m_boneIndex[second];
+			float weightSum = w.m_boneWeight[first] + w.m_boneWeight[second];
+			if (approx.m_boneIndex[1] == -1 || weightSum <= 0)
+			{
+				approx.m_boneIndex[1] = approx.m_boneIndex[0];
+				approx.m_boneWeight = 1.0f;
+			}
+			else
+			{
+				approx.m_boneWeight = w.m_boneWeight[first] / weightSum;
+			}
+			if (approx.m_boneIndex[0] == -1)
+			{
+				approx.m_boneIndex[0] = 0;
+				approx.m_boneIndex[1] = 0;
+				approx.m_boneWeight = 1.0f;
+			}
+		}
+
+		std::vector<uint32_t> indices(m_indexCount);
+		for (size_t i = 0; i < m_indexCount; i++)
+		{
+			switch (m_indexElementSize)
 			{
-				*updatePosition = glm::vec3(m * glm::vec4(*position + *morphPos, 1));
-				*updateNormal = glm::normalize(glm::mat3(m) * *normal);
+			case 1: indices[i] = ((const uint8_t*)m_indices.data())[i]; break;
+			case 2: indices[i] = ((const uint16_t*)m_indices.data())[i]; break;
+			case 4: indices[i] = ((const uint32_t*)m_indices.data())[i]; break;
+			default: return false;
 			}
-			*updateUV = *uv + glm::vec2((*morphUV).x, (*morphUV).y);
+		}
 
-			vtxInfo++;
-			position++;
-			normal++;
-			uv++;
-			updatePosition++;
-			updateNormal++;
-			updateUV++;
-			morphPos++;
-			morphUV++;
+		// LOD ごとに三角形を半分にする
+		float ratio = 1.0f;
+		for (size_t lod = 1; lod < lodCount; lod++)
+		{
+			ratio *= 0.5f;
+			MMDMeshLOD meshLOD;
+			if (!BuildMMDMeshLOD(
+				m_positions.data(),
+				weights.data(),
+				vertexCount,
+				indices.data(),
+				m_subMeshes.data(),
+				m_subMeshes.size(),
+				ratio,
+				&meshLOD
+			))
+			{
+				SABA_WARN("Build LOD Fail. [{}]", lod);
+				m_meshLODs.clear();
+				return false;
+			}
+			SABA_INFO("PMX LOD {} : Index {} -> {} Vertex {} -> {}",
+				lod, m_indexCount, meshLOD.m_indices.size(), vertexCount, meshLOD.m_vertices.size());
+			m_meshLODs.emplace_back(std::move(meshLOD));
 		}
+		return true;
 	}
 
 	void PMXModel::Morph(PMXMorph* morph, float weight)
@@ -1123,6 +2270,7 @@ namespace saba
 		for (const auto& morphVtx : morphData.m_morphVertices)
 		{
 			m_morphPositions[morphVtx.m_index] += morphVtx.m_position * weight;
+			AddMorphVertex(morphVtx.m_index);
 		}
 	}
 
@@ -1136,6 +2284,21 @@ namespace saba
 		for (const auto& morphUV : morphData.m_morphUVs)
 		{
 			m_morphUVs[morphUV.m_index] += morphUV.m_uv * weight;
+			AddMorphVertex(morphUV.m_index);
+		}
+	}
+
+	void PMXModel::AddMorphVertex(size_t vtxIdx)
+	{
+		if (m_morphBegin == m_morphEnd)
+		{
+			m_morphBegin = vtxIdx;
+			m_morphEnd = vtxIdx + 1;
+		}
+		else
+		{
+			m_morphBegin = std::min(m_morphBegin, vtxIdx);
+			m_morphEnd = std::max(m_morphEnd, vtxIdx + 1);
 		}
 	}
 
@@ -18,9 +18,12 @@
 #include <string>
 #include <algorithm>
 #include <future>
+#include <memory>
 
 namespace saba
 {
+	class PMXCacheReader;
+
 	class PMXNode : public MMDNode
 	{
 	public:
@@ -93,7 +96,7 @@ namespace saba
 
 		size_t GetIndexElementSize() const override { return m_indexElementSize; }
 		size_t GetIndexCount() const override { return m_indexCount; }
-		const void* GetIndices() const override { return &m_indices[0]; }
+		const void* GetIndices() const override { return m_indices.data(); }
 
 		size_t GetMaterialCount() const override { return m_materials.size(); }
 		const MMDMaterial* GetMaterials() const override { return &m_materials[0]; }
@@ -116,7 +119,32 @@ namespace saba
 		void UpdatePhysicsAnimation(float elapsed) override;
 		// 頂点データーを更新する
 		void Update() override;
+		void Update(const MMDVertexSink& sink) override;
 		void SetParallelUpdateHint(uint32_t parallelCount) override;
+		void GetSkinningVertices(MMDSkinningVertex* vertices) const override;
+		void UpdateSkinning(MMDSkinningData* data) override;
+
+		// Load の前に呼ぶ. LOD の数 (1 : LOD を作らない)
+		void SetLODHint(size_t lodCount) { m_lodHint = lodCount; }
+		size_t GetLODCount() const override { return m_meshLODs.size() + 1; }
+		const MMDMeshLOD* GetMeshLOD(size_t lod) const override;
+		void SetLOD(size_t lod, bool approximateSkinning) override;
+		size_t GetLOD() const override { return m_lod; }
+		bool IsApproximateSkinning() const override { return m_approximateSkinning; }
+
+		// Load の前に呼ぶ. 変換済みのデータを <filepath>.sabacache に保存し、次回からはそちらを読み込む
+		void EnableCache(bool enable) { m_useCache = enable; }
+		bool IsCacheEnabled() const { return m_useCache; }
+		// Load の前に呼ぶ. キャッシュから読み込んだ頂点、インデックス、モーフのデータをコピーせず、マップしたメモリを参照する.
+		// 同じキャッシュを読み込んだプロセス同士で物理メモリを共有する (EnableCache が必要)
+		void EnableSharedCache(bool enable) { m_shareCache = enable; }
+		bool IsSharedCacheEnabled() const { return m_shareCache; }
+		// キャッシュを参照している場合は true
+		bool IsSharingCache() const { return m_sharedCache != nullptr; }
+
+		// Load の前に呼ぶ. 材質ごとにインデックスを頂点キャッシュのヒット率が上がる順に並べ替える (材質の中の三角形の順番が変わる)
+		void EnableVertexCacheOptimization(bool enable) { m_optimizeVertexCache = enable; }
+		bool IsVertexCacheOptimizationEnabled() const { return m_optimizeVertexCache; }
 
 		bool Load(const std::string& filepath, const std::string& mmdDataDir);
 		void Destroy();
@@ -156,6 +184,63 @@ namespace saba
 		};
 
 	private:
+		// 自分で持っている配列か、キャッシュをマップしたメモリを参照する読み込み専用の配列
+		template <typename T>
+		class ImmutableArray
+		{
+		public:
+			ImmutableArray()
+				: m_data(nullptr)
+				, m_size(0)
+			{
+			}
+
+			ImmutableArray(const ImmutableArray&) = delete;
+			ImmutableArray& operator = (const ImmutableArray&) = delete;
+
+			ImmutableArray(ImmutableArray&& rhs) noexcept
+				: m_storage(std::move(rhs.m_storage))
+				, m_data(rhs.m_data)
+				, m_size(rhs.m_size)
+			{
+				rhs.m_data = nullptr;
+				rhs.m_size = 0;
+			}
+
+			void Assign(std::vector<T>&& data)
+			{
+				m_storage = std::move(data);
+				m_data = m_storage.data();
+				m_size = m_storage.size();
+			}
+
+			void Reference(const T* data, size_t size)
+			{
+				std::vector<T>().swap(m_storage);
+				m_data = data;
+				m_size = size;
+			}
+
+			void clear()
+			{
+				std::vector<T>().swap(m_storage);
+				m_data = nullptr;
+				m_size = 0;
+			}
+
+			const T* data() const { return m_data; }
+			size_t size() const { return m_size; }
+			bool empty() const { return m_size == 0; }
+			const T& operator[](size_t i) const { return m_data[i]; }
+			const T* begin() const { return m_data; }
+			const T* end() const { return m_data + m_size; }
+
+		private:
+			std::vector<T>	m_storage;
+			const T*		m_data;
+			size_t			m_size;
+		};
+
 		struct PositionMorph
 		{
 			uint32_t	m_index;
@@ -164,7 +249,7 @@ namespace saba
 
 		struct PositionMorphData
 		{
-			std::vector<PositionMorph>	m_morphVertices;
+			ImmutableArray<PositionMorph>	m_morphVertices;
 		};
 
 		struct UVMorph
@@ -175,7 +260,7 @@ namespace saba
 
 		struct UVMorphData
 		{
-			std::vector<UVMorph>	m_morphUVs;
+			ImmutableArray<UVMorph>	m_morphUVs;
 		};
 
 		struct MaterialFactor
@@ -243,15 +328,40 @@ namespace saba
 			size_t	m_vertexCount;
 		};
 
+		// BDEF2 で近似したウェイト
+		struct ApproxBoneInfo
+		{
+			int32_t	m_boneIndex[2];
+			float	m_boneWeight;
+		};
+
 	private:
 		void SetupParallelUpdate();
-		void Update(const UpdateRange& range);
+		void SetupUpdateRanges();
+		void UpdateTransforms();
+		void Update(const UpdateRange& range, const MMDVertexSink& sink);
+		void UpdateVertex(size_t vtxIdx, glm::vec3* position, glm::vec3* normal, glm::vec2* uv);
+		void UpdateVertexApprox(size_t vtxIdx, glm::vec3* position, glm::vec3* normal, glm::vec2* uv);
+
+		bool BuildLOD(size_t lodCount);
+
+		bool LoadMesh(const PMXFile& pmx);
+		void LoadMaterials(const PMXFile& pmx, const std::string& dirPath, const std::string& mmdDataDir);
+		void LoadNodes(const PMXFile& pmx);
+		void LoadMorphs(const PMXFile& pmx);
+		bool LoadPhysics(const PMXFile& pmx);
+
+		// Cache
+		bool LoadCache(PMXCacheReader* cache, const std::string& cachePath, const std::string& filepath, PMXFile* pmx, bool share);
+		void LoadCacheMorphs(const PMXCacheReader& cache, bool share);
+		bool SaveCache(const std::string& cachePath, const std::string& filepath, const PMXFile& pmx);
 
 		void Morph(PMXMorph* morph, float weight);
 
 		void MorphPosition(const PositionMorphData& morphData, float weight);
 
 		void MorphUV(const UVMorphData& morphData, float weight);
+		void AddMorphVertex(size_t vtxIdx);
 
 		void BeginMorphMaterial();
 		void EndMorphMaterial();
@@ -260,16 +370,17 @@ namespace saba
 		void MorphBone(const BoneMorphData& morphData, float weight);
 
 	private:
-		std::vector<glm::vec3>	m_positions;
-		std::vector<glm::vec3>	m_normals;
-		std::vector<glm::vec2>	m_uvs;
-		std::vector<VertexBoneInfo>	m_vertexBoneInfos;
+		ImmutableArray<glm::vec3>	m_positions;
+		ImmutableArray<glm::vec3>	m_normals;
+		ImmutableArray<glm::vec2>	m_uvs;
+		ImmutableArray<VertexBoneInfo>	m_vertexBoneInfos;
+		std::vector<ApproxBoneInfo>	m_approxBoneInfos;
 		std::vector<glm::vec3>	m_updatePositions;
 		std::vector<glm::vec3>	m_updateNormals;
 		std::vector<glm::vec2>	m_updateUVs;
 		std::vector<glm::mat4>	m_transforms;
 
-		std::vector<char>	m_indices;
+		ImmutableArray<char>	m_indices;
 		size_t				m_indexCount;
 		size_t				m_indexElementSize;
 
@@ -282,6 +393,9 @@ namespace saba
 		// PositionMorph用
 		std::vector<glm::vec3>	m_morphPositions;
 		std::vector<glm::vec4>	m_morphUVs;
+		// m_morphPositions, m_morphUVs を変更した頂点の範囲 [m_morphBegin, m_morphEnd) (範囲外は 0)
+		size_t					m_morphBegin;
+		size_t					m_morphEnd;
 
 		// マテリアルMorph用
 		std::vector<MMDMaterial>	m_initMaterials;
@@ -303,6 +417,17 @@ namespace saba
 		uint32_t							m_parallelUpdateCount;
 		std::vector<UpdateRange>			m_updateRanges;
 		std::vector<std::future<void>>		m_parallelUpdateFutures;
+
+		bool					m_useCache;
+		bool					m_shareCache;
+		std::unique_ptr<PMXCacheReader>	m_sharedCache;	//!< 参照している間は開いたままにする
+		bool					m_optimizeVertexCache;
+
+		// LOD
+		size_t					m_lodHint;
+		std::vector<MMDMeshLOD>	m_meshLODs;		//!< LOD 1 以降
+		size_t					m_lod;
+		bool					m_approximateSkinning;
 	};
 }
 
@@ -7,27 +7,19 @@
 #include "VMDAnimationCommon.h"
 
 #include <Saba/Base/Log.h>
+#include <Saba/Base/ThreadPool.h>
+#include <Saba/Base/Trace.h>
 
 #include <algorithm>
 #include <iterator>
 #include <map>
+#include <type_traits>
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace saba
 {
 	namespace
 	{
-		void SetVMDBezier(VMDBezier& bezier, const unsigned char* cp)
-		{
-			int x0 = cp[0];
-			int y0 = cp[4];
-			int x1 = cp[8];
-			int y1 = cp[12];
-
-			bezier.m_cp1 = glm::vec2((float)x0 / 127.0f, (float)y0 / 127.0f);
-			bezier.m_cp2 = glm::vec2((float)x1 / 127.0f, (float)y1 / 127.0f);
-		}
-
 		glm::mat3 InvZ(const glm::mat3& m)
 		{
 			const glm::mat3 invZ = glm::scale(glm::mat4(1), glm::vec3(1, 1, -1));
@@ -116,47 +108,16 @@ namespace saba
 		{
 			return;
 		}
-		if (m_keys.empty())
+		if (m_keys.IsEmpty())
 		{
 			m_node->SetAnimationTranslate(glm::vec3(0));
 			m_node->SetAnimationRotate(glm::quat(1, 0, 0, 0));
 			return;
 		}
 
-		auto boundIt = FindBoundKey(m_keys, int32_t(t), m_startKeyIndex);
 		glm::vec3 vt;
 		glm::quat q;
-		if (boundIt == std::end(m_keys))
-		{
-			vt = m_keys[m_keys.size() - 1].m_translate;
-			q = m_keys[m_keys.size() - 1].m_rotate;
-		}
-		else
-		{
-			vt = (*boundIt).m_translate;
-			q = (*boundIt).m_rotate;
-			if (boundIt != std::begin(m_keys))
-			{
-				const auto& key0 = *(boundIt - 1);
-				const auto& key1 = *boundIt;
-
-				float timeRange = float(key1.m_time - key0.m_time);
-				float time = (t - float(key0.m_time)) / timeRange;
-				float tx_x = key0.m_txBezier.FindBezierX(time);
-				float ty_x = key0.m_tyBezier.FindBezierX(time);
-				float tz_x = key0.m_tzBezier.FindBezierX(time);
-				float rot_x = key0.m_rotBezier.FindBezierX(time);
-				float tx_y = key0.m_txBezier.EvalY(tx_x);
-				float ty_y = key0.m_tyBezier.EvalY(ty_x);
-				float tz_y = key0.m_tzBezier.EvalY(tz_x);
-				float rot_y = key0.m_rotBezier.EvalY(rot_x);
-
-				vt = glm::mix(key0.m_translate, key1.m_translate, glm::vec3(tx_y, ty_y, tz_y));
-				q = glm::slerp(key0.m_rotate, key1.m_rotate, rot_y);
-
-				m_startKeyIndex = std::distance(m_keys.cbegin(), boundIt);
-			}
-		}
+		Sample(t, &vt, &q, &m_startKeyIndex);
 
 		if (weight == 1.0f)
 		{
@@ -172,16 +133,167 @@ namespace saba
 		}
 	}
 
+	void VMDNodeController::Sample(float t, glm::vec3* translate, glm::quat* rotate, size_t* keyHint) const
+	{
+		if (m_keys.IsEmpty())
+		{
+			*translate = glm::vec3(0);
+			*rotate = glm::quat(1, 0, 0, 0);
+			return;
+		}
+
+		const auto& times = m_keys.GetTimes();
+		size_t boundIdx = FindBoundKeyIndex(times, int32_t(t), *keyHint);
+		glm::vec3 vt;
+		glm::quat q;
+		if (boundIdx == times.size())
+		{
+			vt = m_keys.GetTranslate(times.size() - 1);
+			q = m_keys.GetRotate(times.size() - 1);
+		}
+		else
+		{
+			vt = m_keys.GetTranslate(boundIdx);
+			q = m_keys.GetRotate(boundIdx);
+			if (boundIdx != 0)
+			{
+				const size_t idx0 = boundIdx - 1;
+				const size_t idx1 = boundIdx;
+				const auto& ip = m_keys.GetInterpolation(idx0);
+				const VMDBezier txBezier = ip.GetBezier(VMDNodeInterpolation::TranslateX);
+				const VMDBezier tyBezier = ip.GetBezier(VMDNodeInterpolation::TranslateY);
+				const VMDBezier tzBezier = ip.GetBezier(VMDNodeInterpolation::TranslateZ);
+				const VMDBezier rotBezier = ip.GetBezier(VMDNodeInterpolation::Rotate);
+
+				float timeRange = float(times[idx1] - times[idx0]);
+				float time = (t - float(times[idx0])) / timeRange;
+				float tx_x = txBezier.FindBezierX(time);
+				float ty_x = tyBezier.FindBezierX(time);
+				float tz_x = tzBezier.FindBezierX(time);
+				float rot_x = rotBezier.FindBezierX(time);
+				float tx_y = txBezier.EvalY(tx_x);
+				float ty_y = tyBezier.EvalY(ty_x);
+				float tz_y = tzBezier.EvalY(tz_x);
+				float rot_y = rotBezier.EvalY(rot_x);
+
+				vt = glm::mix(m_keys.GetTranslate(idx0), m_keys.GetTranslate(idx1), glm::vec3(tx_y, ty_y, tz_y));
+				q = glm::slerp(m_keys.GetRotate(idx0), m_keys.GetRotate(idx1), rot_y);
+
+				*keyHint = boundIdx;
+			}
+		}
+		*translate = vt;
+		*rotate = q;
+	}
+
 	void VMDNodeController::SortKeys()
 	{
-		std::sort(
-			std::begin(m_keys),
-			std::end(m_keys),
-			[](const KeyType& a, const KeyType& b) { return a.m_time < b.m_time; }
+		m_keys.Sort();
+		m_keys.ShrinkToFit();
+	}
+
+	void VMDNodeInterpolation::Set(const uint8_t* interpolation)
+	{
+		// VMD の補間パラメータは 4 バイトごとに x1, y1, x2, y2 が並んでいる
+		for (int ch = 0; ch < 4; ch++)
+		{
+			m_cp[ch * 4 + 0] = interpolation[ch + 0];
+			m_cp[ch * 4 + 1] = interpolation[ch + 4];
+			m_cp[ch * 4 + 2] = interpolation[ch + 8];
+			m_cp[ch * 4 + 3] = interpolation[ch + 12];
+		}
+	}
+
+	VMDBezier VMDNodeInterpolation::GetBezier(Channel channel) const
+	{
+		const uint8_t* cp = &m_cp[int(channel) * 4];
+		VMDBezier bezier;
+		bezier.m_cp1 = glm::vec2((float)cp[0] / 127.0f, (float)cp[1] / 127.0f);
+		bezier.m_cp2 = glm::vec2((float)cp[2] / 127.0f, (float)cp[3] / 127.0f);
+		return bezier;
+	}
+
+	void VMDNodeKeyStore::Add(const VMDNodeAnimationKey & key)
+	{
+		m_times.push_back(key.m_time);
+		m_translates.push_back(key.m_translate);
+		m_rotates.push_back(key.m_rotate);
+		m_interpolations.push_back(key.m_interpolation);
+	}
+
+	void VMDNodeKeyStore::Sort()
+	{
+		if (std::is_sorted(m_times.begin(), m_times.end()))
+		{
+			return;
+		}
+
+		std::vector<size_t> order(m_times.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			order[i] = i;
+		}
+		std::stable_sort(
+			order.begin(),
+			order.end(),
+			[this](size_t a, size_t b) { return m_times[a] < m_times[b]; }
 		);
+
+		auto reorder = [&order](auto& values)
+		{
+			typename std::remove_reference<decltype(values)>::type sorted;
+			sorted.reserve(order.size());
+			for (size_t idx : order)
+			{
+				sorted.push_back(values[idx]);
+			}
+			values.swap(sorted);
+		};
+		reorder(m_times);
+		reorder(m_translates);
+		reorder(m_rotates);
+		reorder(m_interpolations);
+	}
+
+	void VMDNodeKeyStore::ShrinkToFit()
+	{
+		m_times.shrink_to_fit();
+		m_translates.shrink_to_fit();
+		m_rotates.shrink_to_fit();
+		m_interpolations.shrink_to_fit();
+	}
+
+	void VMDNodeKeyStore::Clear()
+	{
+		m_times.clear();
+		m_translates.clear();
+		m_rotates.clear();
+		m_interpolations.clear();
+	}
+
+	VMDNodeAnimationKey VMDNodeKeyStore::GetKey(size_t idx) const
+	{
+		VMDNodeAnimationKey key;
+		key.m_time = m_times[idx];
+		key.m_translate = m_translates[idx];
+		key.m_rotate = m_rotates[idx];
+		key.m_interpolation = m_interpolations[idx];
+		return key;
+	}
+
+	size_t VMDNodeKeyStore::GetMemorySize() const
+	{
+		return m_times.capacity() * sizeof(int32_t) +
+			m_translates.capacity() * sizeof(glm::vec3) +
+			m_rotates.capacity() * sizeof(glm::quat) +
+			m_interpolations.capacity() * sizeof(VMDNodeInterpolation);
 	}
 
 	VMDAnimation::VMDAnimation()
+		: m_maxKeyTime(0)
+		, m_threadPool(nullptr)
+		, m_parallelThreshold(DefaultParallelEvaluateThreshold)
+		, m_lastEvaluateParallel(false)
 	{
 	}
 
@@ -193,6 +305,8 @@ namespace saba
 
 	bool VMDAnimation::Add(const VMDFile & vmd)
 	{
+		SABA_TRACE_SCOPE("VMDAnimation::Add");
+
 		// Node Controller
 		std::map<std::string, NodeControllerPtr> nodeCtrlMap;
 		for (auto& nodeCtrl : m_nodeControllers)
@@ -201,28 +315,39 @@ namespace saba
 			nodeCtrlMap.emplace(std::make_pair(name, std::move(nodeCtrl)));
 		}
 		m_nodeControllers.clear();
+		// 名前の変換と検索は、名前ごとに一度だけ行う
+		MMDFileStringMap<15, VMDNodeController*> nodeNameTable;
 		for (const auto& motion : vmd.m_motions)
 		{
-			std::string nodeName = motion.m_boneName.ToUtf8String();
-			auto findIt = nodeCtrlMap.find(nodeName);
 			VMDNodeController* nodeCtrl = nullptr;
-			if (findIt == std::end(nodeCtrlMap))
+			auto nameIt = nodeNameTable.find(motion.m_boneName);
+			if (nameIt != std::end(nodeNameTable))
 			{
-				auto node = m_model->GetNodeManager()->GetMMDNode(nodeName);
-				if (node != nullptr)
-				{
-					auto val = std::make_pair(
-						nodeName,
-						std::make_unique<VMDNodeController>()
-					);
-					nodeCtrl = val.second.get();
-					nodeCtrl->SetNode(node);
-					nodeCtrlMap.emplace(std::move(val));
-				}
+				nodeCtrl = (*nameIt).second;
 			}
 			else
 			{
-				nodeCtrl = (*findIt).second.get();
+				std::string nodeName = motion.m_boneName.ToUtf8String();
+				auto findIt = nodeCtrlMap.find(nodeName);
+				if (findIt == std::end(nodeCtrlMap))
+				{
+					auto node = m_model->GetNodeManager()->GetMMDNode(nodeName);
+					if (node != nullptr)
+					{
+						auto val = std::make_pair(
+							nodeName,
+							std::make_unique<VMDNodeController>()
+						);
+						nodeCtrl = val.second.get();
+						nodeCtrl->SetNode(node);
+						nodeCtrlMap.emplace(std::move(val));
+					}
+				}
+				else
+				{
+					nodeCtrl = (*findIt).second.get();
+				}
+				nodeNameTable.emplace(motion.m_boneName, nodeCtrl);
 			}
 
 			if (nodeCtrl != nullptr)
@@ -248,30 +373,40 @@ namespace saba
 			ikCtrlMap.emplace(std::make_pair(name, std::move(ikCtrl)));
 		}
 		m_ikControllers.clear();
+		MMDFileStringMap<20, VMDIKController*> ikNameTable;
 		for (const auto& ik : vmd.m_iks)
 		{
 			for (const auto& ikInfo : ik.m_ikInfos)
 			{
-				std::string ikName = ikInfo.m_name.ToUtf8String();
-				auto findIt = ikCtrlMap.find(ikName);
 				VMDIKController* ikCtrl = nullptr;
-				if (findIt == std::end(ikCtrlMap))
+				auto nameIt = ikNameTable.find(ikInfo.m_name);
+				if (nameIt != std::end(ikNameTable))
 				{
-					auto* ikSolver = m_model->GetIKManager()->GetMMDIKSolver(ikName);
-					if (ikSolver != nullptr)
-					{
-						auto val = std::make_pair(
-							ikName,
-							std::make_unique<VMDIKController>()
-						);
-						ikCtrl = val.second.get();
-						ikCtrl->SetIKSolver(ikSolver);
-						ikCtrlMap.emplace(std::move(val));
-					}
+					ikCtrl = (*nameIt).second;
 				}
 				else
 				{
-					ikCtrl = (*findIt).second.get();
+					std::string ikName = ikInfo.m_name.ToUtf8String();
+					auto findIt = ikCtrlMap.find(ikName);
+					if (findIt == std::end(ikCtrlMap))
+					{
+						auto* ikSolver = m_model->GetIKManager()->GetMMDIKSolver(ikName);
+						if (ikSolver != nullptr)
+						{
+							auto val = std::make_pair(
+								ikName,
+								std::make_unique<VMDIKController>()
+							);
+							ikCtrl = val.second.get();
+							ikCtrl->SetIKSolver(ikSolver);
+							ikCtrlMap.emplace(std::move(val));
+						}
+					}
+					else
+					{
+						ikCtrl = (*findIt).second.get();
+					}
+					ikNameTable.emplace(ikInfo.m_name, ikCtrl);
 				}
 
 				if (ikCtrl != nullptr)
@@ -299,28 +434,38 @@ namespace saba
 			morphCtrlMap.emplace(std::make_pair(name, std::move(morphCtrl)));
 		}
 		m_morphControllers.clear();
+		MMDFileStringMap<15, VMDMorphController*> morphNameTable;
 		for (const auto& morph : vmd.m_morphs)
 		{
-			std::string morphName = morph.m_blendShapeName.ToUtf8String();
-			auto findIt = morphCtrlMap.find(morphName);
 			VMDMorphController* morphCtrl = nullptr;
-			if (findIt == std::end(morphCtrlMap))
+			auto nameIt = morphNameTable.find(morph.m_blendShapeName);
+			if (nameIt != std::end(morphNameTable))
 			{
-				auto* mmdMorph = m_model->GetMorphManager()->GetMorph(morphName);
-				if (mmdMorph != nullptr)
-				{
-					auto val = std::make_pair(
-						morphName,
-						std::make_unique<VMDMorphController>()
-					);
-					morphCtrl = val.second.get();
-					morphCtrl->SetBlendKeyShape(mmdMorph);
-					morphCtrlMap.emplace(std::move(val));
-				}
+				morphCtrl = (*nameIt).second;
 			}
 			else
 			{
-				morphCtrl = (*findIt).second.get();
+				std::string morphName = morph.m_blendShapeName.ToUtf8String();
+				auto findIt = morphCtrlMap.find(morphName);
+				if (findIt == std::end(morphCtrlMap))
+				{
+					auto* mmdMorph = m_model->GetMorphManager()->GetMorph(morphName);
+					if (mmdMorph != nullptr)
+					{
+						auto val = std::make_pair(
+							morphName,
+							std::make_unique<VMDMorphController>()
+						);
+						morphCtrl = val.second.get();
+						morphCtrl->SetBlendKeyShape(mmdMorph);
+						morphCtrlMap.emplace(std::move(val));
+					}
+				}
+				else
+				{
+					morphCtrl = (*findIt).second.get();
+				}
+				morphNameTable.emplace(morph.m_blendShapeName, morphCtrl);
 			}
 
 			if (morphCtrl != nullptr)
@@ -353,8 +498,46 @@ namespace saba
 		m_maxKeyTime = 0;
 	}
 
+	void VMDAnimation::SetParallelEvaluate(ThreadPool * pool, size_t threshold)
+	{
+		m_threadPool = pool;
+		m_parallelThreshold = threshold;
+	}
+
 	void VMDAnimation::Evaluate(float t, float weight)
 	{
+		SABA_TRACE_SCOPE("VMDAnimation::Evaluate");
+
+		const size_t nodeCount = m_nodeControllers.size();
+		const size_t ikCount = m_ikControllers.size();
+		const size_t morphCount = m_morphControllers.size();
+		const size_t ctrlCount = nodeCount + ikCount + morphCount;
+		m_lastEvaluateParallel = m_threadPool != nullptr && m_threadPool->GetThreadCount() > 1 && ctrlCount >= m_parallelThreshold;
+		if (m_lastEvaluateParallel)
+		{
+			// コントローラーはそれぞれ別のノード/IK/モーフに書き込むので、分割して評価できる
+			const size_t grainSize = std::max(ctrlCount / (m_threadPool->GetThreadCount() * 4), size_t(16));
+			m_threadPool->ParallelFor(ctrlCount, grainSize, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					if (i < nodeCount)
+					{
+						m_nodeControllers[i]->Evaluate(t, weight);
+					}
+					else if (i < nodeCount + ikCount)
+					{
+						m_ikControllers[i - nodeCount]->Evaluate(t, weight);
+					}
+					else
+					{
+						m_morphControllers[i - nodeCount - ikCount]->Evaluate(t, weight);
+					}
+				}
+			});
+			return;
+		}
+
 		for (auto& nodeCtrl : m_nodeControllers)
 		{
 			nodeCtrl->Evaluate(t, weight);
@@ -371,6 +554,96 @@ namespace saba
 		}
 	}
 
+	void VMDAnimation::EvaluatePoses(
+		const float*	times,
+		size_t			timeCount,
+		glm::vec3*		translates,
+		glm::quat*		rotates,
+		float*			morphWeights,
+		uint8_t*		ikEnables,
+		ThreadPool*		pool
+	) const
+	{
+		if (pool == nullptr || pool->GetThreadCount() <= 1 || timeCount <= 1)
+		{
+			EvaluatePosesRange(times, 0, timeCount, translates, rotates, morphWeights, ikEnables);
+			return;
+		}
+
+		// 連続した時間をまとめて評価した方がキーの検索が速いので、スレッド数で分割する
+		const size_t taskCount = std::min(timeCount, pool->GetThreadCount());
+		std::vector<std::future<void>> futures;
+		futures.reserve(taskCount);
+		for (size_t taskIdx = 0; taskIdx < taskCount; taskIdx++)
+		{
+			size_t beginIdx = timeCount * taskIdx / taskCount;
+			size_t endIdx = timeCount * (taskIdx + 1) / taskCount;
+			futures.emplace_back(pool->Enqueue([=]()
+			{
+				EvaluatePosesRange(times, beginIdx, endIdx, translates, rotates, morphWeights, ikEnables);
+			}));
+		}
+		for (auto& future : futures)
+		{
+			future.wait();
+		}
+	}
+
+	void VMDAnimation::EvaluatePosesRange(
+		const float*	times,
+		size_t			beginIdx,
+		size_t			endIdx,
+		glm::vec3*		translates,
+		glm::quat*		rotates,
+		float*			morphWeights,
+		uint8_t*		ikEnables
+	) const
+	{
+		const size_t nodeCount = m_nodeControllers.size();
+		const size_t ikCount = m_ikControllers.size();
+		const size_t morphCount = m_morphControllers.size();
+
+		// 検索開始位置はコントローラーごとに持つ
+		std::vector<size_t> nodeKeyHints(nodeCount, 0);
+		std::vector<size_t> ikKeyHints(ikCount, 0);
+		std::vector<size_t> morphKeyHints(morphCount, 0);
+		for (size_t timeIdx = beginIdx; timeIdx < endIdx; timeIdx++)
+		{
+			const float t = times[timeIdx];
+			if (translates != nullptr || rotates != nullptr)
+			{
+				for (size_t i = 0; i < nodeCount; i++)
+				{
+					glm::vec3 vt;
+					glm::quat q;
+					m_nodeControllers[i]->Sample(t, &vt, &q, &nodeKeyHints[i]);
+					if (translates != nullptr)
+					{
+						translates[timeIdx * nodeCount + i] = vt;
+					}
+					if (rotates != nullptr)
+					{
+						rotates[timeIdx * nodeCount + i] = q;
+					}
+				}
+			}
+			if (ikEnables != nullptr)
+			{
+				for (size_t i = 0; i < ikCount; i++)
+				{
+					ikEnables[timeIdx * ikCount + i] = m_ikControllers[i]->Sample(t, &ikKeyHints[i]) ? 1 : 0;
+				}
+			}
+			if (morphWeights != nullptr)
+			{
+				for (size_t i = 0; i < morphCount; i++)
+				{
+					morphWeights[timeIdx * morphCount + i] = m_morphControllers[i]->Sample(t, &morphKeyHints[i]);
+				}
+			}
+		}
+	}
+
 	void VMDAnimation::SyncPhysics(float t, int frameCount)
 	{
 		/*
@@ -400,15 +673,43 @@ namespace saba
 		}
 	}
 
+	VMDAnimation::MemoryUsage VMDAnimation::GetMemoryUsage() const
+	{
+		MemoryUsage usage = {};
+		for (const auto& nodeController : m_nodeControllers)
+		{
+			const auto& keys = nodeController->GetKeys();
+			usage.m_nodeKeyCount += keys.GetKeyCount();
+			usage.m_nodeKeyMemory += keys.GetMemorySize();
+		}
+		for (const auto& ikController : m_ikControllers)
+		{
+			const auto& keys = ikController->GetKeys();
+			usage.m_ikKeyCount += keys.size();
+			usage.m_ikKeyMemory += keys.capacity() * sizeof(VMDIKAnimationKey);
+		}
+		for (const auto& morphController : m_morphControllers)
+		{
+			const auto& keys = morphController->GetKeys();
+			usage.m_morphKeyCount += keys.size();
+			usage.m_morphKeyMemory += keys.capacity() * sizeof(VMDMorphAnimationKey);
+		}
+		usage.m_controllerMemory =
+			m_nodeControllers.capacity() * sizeof(NodeControllerPtr) + m_nodeControllers.size() * sizeof(VMDNodeController) +
+			m_ikControllers.capacity() * sizeof(IKControllerPtr) + m_ikControllers.size() * sizeof(VMDIKController) +
+			m_morphControllers.capacity() * sizeof(MorphControllerPtr) + m_morphControllers.size() * sizeof(VMDMorphController);
+		return usage;
+	}
+
 	int32_t VMDAnimation::CalculateMaxKeyTime() const
 	{
 		int32_t maxTime = 0;
 		for (const auto& nodeController : m_nodeControllers)
 		{
-			const auto& keys = nodeController->GetKeys();
-			if (!keys.empty())
+			const auto& times = nodeController->GetKeys().GetTimes();
+			if (!times.empty())
 			{
-				maxTime = std::max(maxTime, keys.rbegin()->m_time);
+				maxTime = std::max(maxTime, times.back());
 			}
 		}
 
@@ -444,10 +745,7 @@ namespace saba
 		auto rot1 = InvZ(rot0);
 		m_rotate = glm::quat_cast(rot1);
 
-		SetVMDBezier(m_txBezier, &motion.m_interpolation[0]);
-		SetVMDBezier(m_tyBezier, &motion.m_interpolation[1]);
-		SetVMDBezier(m_tzBezier, &motion.m_interpolation[2]);
-		SetVMDBezier(m_rotBezier, &motion.m_interpolation[3]);
+		m_interpolation.Set(motion.m_interpolation.data());
 	}
 
 	VMDIKController::VMDIKController()
@@ -473,23 +771,7 @@ namespace saba
 			return;
 		}
 
-		auto boundIt = FindBoundKey(m_keys, int32_t(t), m_startKeyIndex);
-		bool enable = true;
-		if (boundIt == std::end(m_keys))
-		{
-			enable = m_keys.rbegin()->m_enable;
-		}
-		else
-		{
-			enable = m_keys.begin()->m_enable;
-			if (boundIt != std::begin(m_keys))
-			{
-				const auto& key = *(boundIt - 1);
-				enable = key.m_enable;
-
-				m_startKeyIndex = std::distance(m_keys.cbegin(), boundIt);
-			}
-		}
+		bool enable = Sample(t, &m_startKeyIndex);
 
 		if (weight == 1.0f)
 		{
@@ -508,6 +790,33 @@ namespace saba
 		}
 	}
 
+	bool VMDIKController::Sample(float t, size_t* keyHint) const
+	{
+		if (m_keys.empty())
+		{
+			return true;
+		}
+
+		auto boundIt = FindBoundKey(m_keys, int32_t(t), *keyHint);
+		bool enable = true;
+		if (boundIt == std::end(m_keys))
+		{
+			enable = m_keys.rbegin()->m_enable;
+		}
+		else
+		{
+			enable = m_keys.begin()->m_enable;
+			if (boundIt != std::begin(m_keys))
+			{
+				const auto& key = *(boundIt - 1);
+				enable = key.m_enable;
+
+				*keyHint = std::distance(m_keys.cbegin(), boundIt);
+			}
+		}
+		return enable;
+	}
+
 	void VMDIKController::SortKeys()
 	{
 		std::sort(
@@ -515,6 +824,7 @@ namespace saba
 			std::end(m_keys),
 			[](const KeyType& a, const KeyType& b) { return a.m_time < b.m_time; }
 		);
+		m_keys.shrink_to_fit();
 	}
 
 	VMDMorphController::VMDMorphController()
@@ -540,8 +850,27 @@ namespace saba
 			return;
 		}
 
+		float weight = Sample(t, &m_startKeyIndex);
+
+		if (animWeight == 1.0f)
+		{
+			m_morph->SetWeight(weight);
+		}
+		else
+		{
+			m_morph->SetWeight(glm::mix(m_morph->GetBaseAnimationWeight(), weight, animWeight));
+		}
+	}
+
+	float VMDMorphController::Sample(float t, size_t* keyHint) const
+	{
+		if (m_keys.empty())
+		{
+			return 0.0f;
+		}
+
 		float weight;
-		auto boundIt = FindBoundKey(m_keys, int32_t(t), m_startKeyIndex);
+		auto boundIt = FindBoundKey(m_keys, int32_t(t), *keyHint);
 		if (boundIt == std::end(m_keys))
 		{
 			weight = m_keys.rbegin()->m_weight;
@@ -558,18 +887,10 @@ namespace saba
 				float time = (t - float(key0.m_time)) / timeRange;
 				weight = (key1.m_weight - key0.m_weight) * time + key0.m_weight;
 
-				m_startKeyIndex = std::distance(m_keys.cbegin(), boundIt);
+				*keyHint = std::distance(m_keys.cbegin(), boundIt);
 			}
 		}
-
-		if (animWeight == 1.0f)
-		{
-			m_morph->SetWeight(weight);
-		}
-		else
-		{
-			m_morph->SetWeight(glm::mix(m_morph->GetBaseAnimationWeight(), weight, animWeight));
-		}
+		return weight;
 	}
 
 	void VMDMorphController::SortKeys()
@@ -579,5 +900,6 @@ namespace saba
 			std::end(m_keys),
 			[](const KeyType& a, const KeyType& b) { return a.m_time < b.m_time; }
 		);
+		m_keys.shrink_to_fit();
 	}
 }
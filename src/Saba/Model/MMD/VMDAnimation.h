@@ -20,6 +20,8 @@
 
 namespace saba
 {
+	class ThreadPool;
+
 	struct VMDBezier
 	{
 		float EvalX(float t) const;
@@ -32,18 +34,66 @@ namespace saba
 		glm::vec2	m_cp2;
 	};
 
+	/*
+		VMD の補間パラメータを 8bit のまま保持する.
+		m_cp[channel * 4 + (0:x1, 1:y1, 2:x2, 3:y2)]
+		channel は 0:tx 1:ty 2:tz 3:rot
+	*/
+	struct VMDNodeInterpolation
+	{
+		enum Channel
+		{
+			TranslateX,
+			TranslateY,
+			TranslateZ,
+			Rotate,
+		};
+
+		void Set(const uint8_t* interpolation);
+		VMDBezier GetBezier(Channel channel) const;
+
+		uint8_t	m_cp[16];
+	};
+
 	struct VMDNodeAnimationKey
 	{
 		void Set(const VMDMotion& motion);
 
-		int32_t		m_time;
-		glm::vec3	m_translate;
-		glm::quat	m_rotate;
+		int32_t					m_time;
+		glm::vec3				m_translate;
+		glm::quat				m_rotate;
+		VMDNodeInterpolation	m_interpolation;
+	};
+
+	/*
+		ノードのアニメーションキーを要素ごとの配列で保持する.
+		キーの検索は時間の配列だけを見る.
+	*/
+	class VMDNodeKeyStore
+	{
+	public:
+		void Add(const VMDNodeAnimationKey& key);
+		void Sort();
+		void ShrinkToFit();
+		void Clear();
+
+		size_t GetKeyCount() const { return m_times.size(); }
+		bool IsEmpty() const { return m_times.empty(); }
 
-		VMDBezier	m_txBezier;
-		VMDBezier	m_tyBezier;
-		VMDBezier	m_tzBezier;
-		VMDBezier	m_rotBezier;
+		VMDNodeAnimationKey GetKey(size_t idx) const;
+		const std::vector<int32_t>& GetTimes() const { return m_times; }
+		const glm::vec3& GetTranslate(size_t idx) const { return m_translates[idx]; }
+		const glm::quat& GetRotate(size_t idx) const { return m_rotates[idx]; }
+		const VMDNodeInterpolation& GetInterpolation(size_t idx) const { return m_interpolations[idx]; }
+
+		// 確保しているメモリ量 (byte)
+		size_t GetMemorySize() const;
+
+	private:
+		std::vector<int32_t>				m_times;
+		std::vector<glm::vec3>				m_translates;
+		std::vector<glm::quat>				m_rotates;
+		std::vector<VMDNodeInterpolation>	m_interpolations;
 	};
 
 	struct VMDMorphAnimationKey
@@ -67,20 +117,22 @@ namespace saba
 
 		void SetNode(MMDNode* node);
 		void Evaluate(float t, float weight = 1.0f);
+		// ノードを変更せずに時間 t の値を求める. keyHint は検索開始位置 (呼び出し側で保持する)
+		void Sample(float t, glm::vec3* translate, glm::quat* rotate, size_t* keyHint) const;
 		
 		void AddKey(const KeyType& key)
 		{
-			m_keys.push_back(key);
+			m_keys.Add(key);
 		}
 		void SortKeys();
-		const  std::vector<KeyType>& GetKeys() const { return m_keys; }
+		const VMDNodeKeyStore& GetKeys() const { return m_keys; }
 
 		MMDNode* GetNode() const { return m_node; }
 
 	private:
-		MMDNode*				m_node;
-		std::vector<KeyType>	m_keys;
-		size_t					m_startKeyIndex;
+		MMDNode*		m_node;
+		VMDNodeKeyStore	m_keys;
+		size_t			m_startKeyIndex;
 	};
 
 	class VMDMorphController
@@ -92,6 +144,7 @@ namespace saba
 
 		void SetBlendKeyShape(MMDMorph* morph);
 		void Evaluate(float t, float weight = 1.0f);
+		float Sample(float t, size_t* keyHint) const;
 
 		void AddKey(const KeyType& key)
 		{
@@ -117,6 +170,7 @@ namespace saba
 
 		void SetIKSolver(MMDIkSolver* ikSolver);
 		void Evaluate(float t, float weight = 1.0f);
+		bool Sample(float t, size_t* keyHint) const;
 
 		void AddKey(const KeyType& key)
 		{
@@ -144,12 +198,71 @@ namespace saba
 
 		void Evaluate(float t, float weight = 1.0f);
 
+		/*
+			Evaluate でコントローラーを pool で並列に評価する. (nullptr で直列)
+			コントローラー数が threshold 未満の場合は直列に評価する.
+		*/
+		void SetParallelEvaluate(ThreadPool* pool, size_t threshold = DefaultParallelEvaluateThreshold);
+		static const size_t DefaultParallelEvaluateThreshold = 128;
+		// 最後の Evaluate を並列に評価したか
+		bool WasLastEvaluateParallel() const { return m_lastEvaluateParallel; }
+
+		/*
+			モデルを変更せずに、times の各時間のポーズを求める.
+			結果は時間ごとにコントローラーの順で並べる. (translates[timeIdx * GetNodeControllerCount() + ctrlIdx])
+			不要な出力は nullptr でよい.
+			pool を指定すると時間を分割して並列に評価する. (pool のタスク内からは呼ばないこと)
+		*/
+		void EvaluatePoses(
+			const float*	times,
+			size_t			timeCount,
+			glm::vec3*		translates,
+			glm::quat*		rotates,
+			float*			morphWeights,
+			uint8_t*		ikEnables,
+			ThreadPool*		pool = nullptr
+		) const;
+
+		size_t GetNodeControllerCount() const { return m_nodeControllers.size(); }
+		const VMDNodeController* GetNodeController(size_t idx) const { return m_nodeControllers[idx].get(); }
+		size_t GetIKControllerCount() const { return m_ikControllers.size(); }
+		const VMDIKController* GetIKController(size_t idx) const { return m_ikControllers[idx].get(); }
+		size_t GetMorphControllerCount() const { return m_morphControllers.size(); }
+		const VMDMorphController* GetMorphController(size_t idx) const { return m_morphControllers[idx].get(); }
+
 		// Physics を同期させる
 		void SyncPhysics(float t, int frameCount = 30);
 
 		int32_t GetMaxKeyTime() const { return m_maxKeyTime; };
+
+		struct MemoryUsage
+		{
+			size_t	m_nodeKeyCount;
+			size_t	m_ikKeyCount;
+			size_t	m_morphKeyCount;
+			size_t	m_nodeKeyMemory;		//!< byte
+			size_t	m_ikKeyMemory;			//!< byte
+			size_t	m_morphKeyMemory;		//!< byte
+			size_t	m_controllerMemory;		//!< byte
+
+			size_t GetTotalMemory() const
+			{
+				return m_nodeKeyMemory + m_ikKeyMemory + m_morphKeyMemory + m_controllerMemory;
+			}
+		};
+		MemoryUsage GetMemoryUsage() const;
+
 	private:
 		int32_t CalculateMaxKeyTime() const;
+		void EvaluatePosesRange(
+			const float*	times,
+			size_t			beginIdx,
+			size_t			endIdx,
+			glm::vec3*		translates,
+			glm::quat*		rotates,
+			float*			morphWeights,
+			uint8_t*		ikEnables
+		) const;
 
 	private:
 		using NodeControllerPtr = std::unique_ptr<VMDNodeController>;
@@ -161,6 +274,10 @@ namespace saba
 		std::vector<IKControllerPtr>		m_ikControllers;
 		std::vector<MorphControllerPtr>		m_morphControllers;
 		uint32_t	m_maxKeyTime;
+
+		ThreadPool*	m_threadPool;
+		size_t		m_parallelThreshold;
+		bool		m_lastEvaluateParallel;
 	};
 
 }
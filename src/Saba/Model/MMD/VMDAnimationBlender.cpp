@@ -0,0 +1,549 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "VMDAnimationBlender.h"
+
+#include <Saba/Base/Log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace saba
+{
+	namespace
+	{
+		const float VMDFrameRate = 30.0f;
+
+		void MarkNode(
+			MMDNode*										node,
+			bool											includeChildren,
+			const std::unordered_map<MMDNode*, size_t>&		nodeIndices,
+			std::vector<float>*								mask
+		)
+		{
+			auto findIt = nodeIndices.find(node);
+			if (findIt != nodeIndices.end())
+			{
+				(*mask)[findIt->second] = 1.0f;
+			}
+			if (includeChildren)
+			{
+				for (auto child = node->GetChild(); child != nullptr; child = child->GetNext())
+				{
+					MarkNode(child, includeChildren, nodeIndices, mask);
+				}
+			}
+		}
+	}
+
+	void VMDAnimationBlender::Pose::Resize(size_t nodeCount, size_t morphCount, size_t ikCount)
+	{
+		m_translates.resize(nodeCount);
+		m_rotates.resize(nodeCount);
+		m_nodeValid.resize(nodeCount);
+		m_morphWeights.resize(morphCount);
+		m_morphValid.resize(morphCount);
+		m_ikEnables.resize(ikCount);
+		m_ikValid.resize(ikCount);
+		Reset();
+	}
+
+	void VMDAnimationBlender::Pose::Reset()
+	{
+		std::fill(m_nodeValid.begin(), m_nodeValid.end(), 0);
+		std::fill(m_morphValid.begin(), m_morphValid.end(), 0);
+		std::fill(m_ikValid.begin(), m_ikValid.end(), 0);
+	}
+
+	float VMDAnimationBlender::Clip::GetFadeWeight() const
+	{
+		if (m_fadeTime <= 0.0f)
+		{
+			return 1.0f;
+		}
+		return std::min(m_fadeElapsed / m_fadeTime, 1.0f);
+	}
+
+	VMDAnimationBlender::VMDAnimationBlender()
+	{
+	}
+
+	bool VMDAnimationBlender::Create(std::shared_ptr<MMDModel> model)
+	{
+		if (model == nullptr)
+		{
+			return false;
+		}
+		m_model = model;
+		m_layers.clear();
+
+		size_t nodeCount = m_model->GetNodeManager()->GetNodeCount();
+		size_t morphCount = m_model->GetMorphManager()->GetMorphCount();
+		size_t ikCount = m_model->GetIKManager()->GetIKSolverCount();
+		m_pose.Resize(nodeCount, morphCount, ikCount);
+		m_layerPose.Resize(nodeCount, morphCount, ikCount);
+		m_clipPose.Resize(nodeCount, morphCount, ikCount);
+		return true;
+	}
+
+	void VMDAnimationBlender::Destroy()
+	{
+		m_layers.clear();
+		m_model.reset();
+	}
+
+	size_t VMDAnimationBlender::AddLayer(BlendMode mode, float weight)
+	{
+		Layer layer;
+		layer.m_mode = mode;
+		layer.m_weight = weight;
+		layer.m_startWeight = weight;
+		layer.m_targetWeight = weight;
+		layer.m_weightFadeTime = 0.0f;
+		layer.m_weightFadeElapsed = 0.0f;
+		m_layers.emplace_back(std::move(layer));
+		return m_layers.size() - 1;
+	}
+
+	void VMDAnimationBlender::SetLayerBlendMode(size_t layerIdx, BlendMode mode)
+	{
+		m_layers[layerIdx].m_mode = mode;
+	}
+
+	void VMDAnimationBlender::SetLayerWeight(size_t layerIdx, float weight, float fadeTime)
+	{
+		auto& layer = m_layers[layerIdx];
+		if (fadeTime <= 0.0f)
+		{
+			layer.m_weight = weight;
+		}
+		layer.m_startWeight = layer.m_weight;
+		layer.m_targetWeight = weight;
+		layer.m_weightFadeTime = fadeTime;
+		layer.m_weightFadeElapsed = 0.0f;
+	}
+
+	float VMDAnimationBlender::GetLayerWeight(size_t layerIdx) const
+	{
+		return m_layers[layerIdx].m_weight;
+	}
+
+	void VMDAnimationBlender::SetLayerNodeMask(size_t layerIdx, const std::vector<std::string>& nodeNames, bool includeChildren)
+	{
+		auto nodeMan = m_model->GetNodeManager();
+		size_t nodeCount = nodeMan->GetNodeCount();
+		std::unordered_map<MMDNode*, size_t> nodeIndices;
+		for (size_t i = 0; i < nodeCount; i++)
+		{
+			nodeIndices.emplace(nodeMan->GetMMDNode(i), i);
+		}
+
+		auto& mask = m_layers[layerIdx].m_nodeMask;
+		mask.assign(nodeCount, 0.0f);
+		for (const auto& nodeName : nodeNames)
+		{
+			auto node = nodeMan->GetMMDNode(nodeName);
+			if (node == nullptr)
+			{
+				SABA_WARN("VMDAnimationBlender : Node not found. [{}]", nodeName);
+				continue;
+			}
+			MarkNode(node, includeChildren, nodeIndices, &mask);
+		}
+	}
+
+	void VMDAnimationBlender::SetLayerNodeMaskWeight(size_t layerIdx, const std::string& nodeName, float weight)
+	{
+		auto nodeMan = m_model->GetNodeManager();
+		auto nodeIdx = nodeMan->FindNodeIndex(nodeName);
+		if (nodeIdx == MMDNodeManager::NPos)
+		{
+			SABA_WARN("VMDAnimationBlender : Node not found. [{}]", nodeName);
+			return;
+		}
+
+		auto& mask = m_layers[layerIdx].m_nodeMask;
+		if (mask.empty())
+		{
+			mask.assign(nodeMan->GetNodeCount(), 1.0f);
+		}
+		mask[nodeIdx] = weight;
+	}
+
+	void VMDAnimationBlender::SetLayerMorphMask(size_t layerIdx, const std::vector<std::string>& morphNames)
+	{
+		auto morphMan = m_model->GetMorphManager();
+		auto& mask = m_layers[layerIdx].m_morphMask;
+		mask.assign(morphMan->GetMorphCount(), 0.0f);
+		for (const auto& morphName : morphNames)
+		{
+			auto morphIdx = morphMan->FindMorphIndex(morphName);
+			if (morphIdx == MMDMorphManager::NPos)
+			{
+				SABA_WARN("VMDAnimationBlender : Morph not found. [{}]", morphName);
+				continue;
+			}
+			mask[morphIdx] = 1.0f;
+		}
+	}
+
+	void VMDAnimationBlender::ClearLayerMask(size_t layerIdx)
+	{
+		m_layers[layerIdx].m_nodeMask.clear();
+		m_layers[layerIdx].m_morphMask.clear();
+	}
+
+	void VMDAnimationBlender::Play(
+		size_t							layerIdx,
+		std::shared_ptr<VMDAnimation>	anim,
+		float							fadeTime,
+		float							startFrame,
+		bool							loop,
+		float							speed
+	)
+	{
+		auto& layer = m_layers[layerIdx];
+
+		Clip clip;
+		clip.m_anim = anim;
+		clip.m_frame = startFrame;
+		clip.m_speed = speed;
+		clip.m_loop = loop;
+		// 再生中のクリップが無い場合はレストポーズからフェードする
+		clip.m_fadeTime = fadeTime;
+		clip.m_fadeElapsed = 0.0f;
+		SetupClip(&clip);
+
+		if (clip.m_fadeTime <= 0.0f)
+		{
+			layer.m_clips.clear();
+		}
+		if (clip.m_anim != nullptr || !layer.m_clips.empty())
+		{
+			layer.m_clips.emplace_back(std::move(clip));
+		}
+	}
+
+	void VMDAnimationBlender::Stop(size_t layerIdx, float fadeTime)
+	{
+		Play(layerIdx, nullptr, fadeTime);
+	}
+
+	float VMDAnimationBlender::GetLayerFrame(size_t layerIdx) const
+	{
+		const auto& clips = m_layers[layerIdx].m_clips;
+		return clips.empty() ? 0.0f : clips.back().m_frame;
+	}
+
+	bool VMDAnimationBlender::IsFading(size_t layerIdx) const
+	{
+		const auto& layer = m_layers[layerIdx];
+		if (layer.m_clips.size() > 1 || layer.m_weight != layer.m_targetWeight)
+		{
+			return true;
+		}
+		return !layer.m_clips.empty() && layer.m_clips[0].GetFadeWeight() < 1.0f;
+	}
+
+	void VMDAnimationBlender::SetupClip(Clip * clip)
+	{
+		const auto anim = clip->m_anim.get();
+		if (anim == nullptr)
+		{
+			return;
+		}
+
+		auto nodeMan = m_model->GetNodeManager();
+		clip->m_nodeIndices.resize(anim->GetNodeControllerCount());
+		for (size_t i = 0; i < clip->m_nodeIndices.size(); i++)
+		{
+			auto node = anim->GetNodeController(i)->GetNode();
+			clip->m_nodeIndices[i] = nodeMan->FindNodeIndex(node->GetName());
+		}
+
+		auto morphMan = m_model->GetMorphManager();
+		clip->m_morphIndices.resize(anim->GetMorphControllerCount());
+		for (size_t i = 0; i < clip->m_morphIndices.size(); i++)
+		{
+			auto morph = anim->GetMorphController(i)->GetMorph();
+			clip->m_morphIndices[i] = morphMan->FindMorphIndex(morph->GetName());
+		}
+
+		auto ikMan = m_model->GetIKManager();
+		clip->m_ikIndices.resize(anim->GetIKControllerCount());
+		for (size_t i = 0; i < clip->m_ikIndices.size(); i++)
+		{
+			auto ikSolver = anim->GetIKController(i)->GetIkSolver();
+			clip->m_ikIndices[i] = ikMan->FindIKSolverIndex(ikSolver->GetName());
+		}
+
+		clip->m_nodeKeyHints.assign(clip->m_nodeIndices.size(), 0);
+		clip->m_morphKeyHints.assign(clip->m_morphIndices.size(), 0);
+		clip->m_ikKeyHints.assign(clip->m_ikIndices.size(), 0);
+	}
+
+	void VMDAnimationBlender::Update(float elapsed)
+	{
+		for (auto& layer : m_layers)
+		{
+			// Layer weight
+			if (layer.m_weight != layer.m_targetWeight)
+			{
+				layer.m_weightFadeElapsed += elapsed;
+				float t = layer.m_weightFadeTime <= 0.0f ? 1.0f :
+					std::min(layer.m_weightFadeElapsed / layer.m_weightFadeTime, 1.0f);
+				layer.m_weight = glm::mix(layer.m_startWeight, layer.m_targetWeight, t);
+				if (t >= 1.0f)
+				{
+					layer.m_weight = layer.m_targetWeight;
+				}
+			}
+
+			// Clip time
+			for (auto& clip : layer.m_clips)
+			{
+				clip.m_fadeElapsed += elapsed;
+				if (clip.m_anim == nullptr)
+				{
+					continue;
+				}
+				clip.m_frame += elapsed * VMDFrameRate * clip.m_speed;
+				float maxFrame = float(clip.m_anim->GetMaxKeyTime());
+				if (clip.m_loop && maxFrame > 0.0f)
+				{
+					clip.m_frame = std::fmod(clip.m_frame, maxFrame);
+					if (clip.m_frame < 0.0f)
+					{
+						clip.m_frame += maxFrame;
+					}
+				}
+				else
+				{
+					clip.m_frame = glm::clamp(clip.m_frame, 0.0f, maxFrame);
+				}
+			}
+
+			// フェードが終わったクリップより前のクリップは不要
+			auto& clips = layer.m_clips;
+			for (size_t i = clips.size(); i > 1; i--)
+			{
+				if (clips[i - 1].GetFadeWeight() >= 1.0f)
+				{
+					clips.erase(clips.begin(), clips.begin() + (i - 1));
+					break;
+				}
+			}
+			if (clips.size() == 1 && clips[0].m_anim == nullptr && clips[0].GetFadeWeight() >= 1.0f)
+			{
+				clips.clear();
+			}
+		}
+	}
+
+	void VMDAnimationBlender::SampleClip(Clip * clip, Pose * pose) const
+	{
+		pose->Reset();
+		const auto anim = clip->m_anim.get();
+		if (anim == nullptr)
+		{
+			return;
+		}
+
+		const float t = clip->m_frame;
+		for (size_t i = 0; i < clip->m_nodeIndices.size(); i++)
+		{
+			size_t nodeIdx = clip->m_nodeIndices[i];
+			if (nodeIdx == MMDNodeManager::NPos)
+			{
+				continue;
+			}
+			anim->GetNodeController(i)->Sample(t, &pose->m_translates[nodeIdx], &pose->m_rotates[nodeIdx], &clip->m_nodeKeyHints[i]);
+			pose->m_nodeValid[nodeIdx] = 1;
+		}
+		for (size_t i = 0; i < clip->m_morphIndices.size(); i++)
+		{
+			size_t morphIdx = clip->m_morphIndices[i];
+			if (morphIdx == MMDMorphManager::NPos)
+			{
+				continue;
+			}
+			pose->m_morphWeights[morphIdx] = anim->GetMorphController(i)->Sample(t, &clip->m_morphKeyHints[i]);
+			pose->m_morphValid[morphIdx] = 1;
+		}
+		for (size_t i = 0; i < clip->m_ikIndices.size(); i++)
+		{
+			size_t ikIdx = clip->m_ikIndices[i];
+			if (ikIdx == MMDIKManager::NPos)
+			{
+				continue;
+			}
+			pose->m_ikEnables[ikIdx] = anim->GetIKController(i)->Sample(t, &clip->m_ikKeyHints[i]) ? 1 : 0;
+			pose->m_ikValid[ikIdx] = 1;
+		}
+	}
+
+	void VMDAnimationBlender::MixPose(Pose * dst, const Pose & src, float t)
+	{
+		// 片方にしか無い値はレストポーズとして補間する
+		for (size_t i = 0; i < dst->m_nodeValid.size(); i++)
+		{
+			if (dst->m_nodeValid[i] == 0 && src.m_nodeValid[i] == 0)
+			{
+				continue;
+			}
+			glm::vec3 t0 = dst->m_nodeValid[i] != 0 ? dst->m_translates[i] : glm::vec3(0);
+			glm::quat q0 = dst->m_nodeValid[i] != 0 ? dst->m_rotates[i] : glm::quat(1, 0, 0, 0);
+			glm::vec3 t1 = src.m_nodeValid[i] != 0 ? src.m_translates[i] : glm::vec3(0);
+			glm::quat q1 = src.m_nodeValid[i] != 0 ? src.m_rotates[i] : glm::quat(1, 0, 0, 0);
+			dst->m_translates[i] = glm::mix(t0, t1, t);
+			dst->m_rotates[i] = glm::slerp(q0, q1, t);
+			dst->m_nodeValid[i] = 1;
+		}
+		for (size_t i = 0; i < dst->m_morphValid.size(); i++)
+		{
+			if (dst->m_morphValid[i] == 0 && src.m_morphValid[i] == 0)
+			{
+				continue;
+			}
+			float w0 = dst->m_morphValid[i] != 0 ? dst->m_morphWeights[i] : 0.0f;
+			float w1 = src.m_morphValid[i] != 0 ? src.m_morphWeights[i] : 0.0f;
+			dst->m_morphWeights[i] = glm::mix(w0, w1, t);
+			dst->m_morphValid[i] = 1;
+		}
+		for (size_t i = 0; i < dst->m_ikValid.size(); i++)
+		{
+			if (dst->m_ikValid[i] == 0 && src.m_ikValid[i] == 0)
+			{
+				continue;
+			}
+			// IK の有効/無効は補間できないので、半分を過ぎたら切り替える
+			uint8_t e0 = dst->m_ikValid[i] != 0 ? dst->m_ikEnables[i] : 1;
+			uint8_t e1 = src.m_ikValid[i] != 0 ? src.m_ikEnables[i] : 1;
+			dst->m_ikEnables[i] = t < 0.5f ? e0 : e1;
+			dst->m_ikValid[i] = 1;
+		}
+	}
+
+	void VMDAnimationBlender::BlendLayer(const Layer & layer, const Pose & layerPose)
+	{
+		const bool additive = layer.m_mode == BlendMode::Additive;
+		for (size_t i = 0; i < layerPose.m_nodeValid.size(); i++)
+		{
+			if (layerPose.m_nodeValid[i] == 0)
+			{
+				continue;
+			}
+			float w = layer.m_weight * (layer.m_nodeMask.empty() ? 1.0f : layer.m_nodeMask[i]);
+			if (w <= 0.0f)
+			{
+				continue;
+			}
+			glm::vec3 baseT = m_pose.m_nodeValid[i] != 0 ? m_pose.m_translates[i] : glm::vec3(0);
+			glm::quat baseQ = m_pose.m_nodeValid[i] != 0 ? m_pose.m_rotates[i] : glm::quat(1, 0, 0, 0);
+			if (additive)
+			{
+				m_pose.m_translates[i] = baseT + layerPose.m_translates[i] * w;
+				m_pose.m_rotates[i] = baseQ * glm::slerp(glm::quat(1, 0, 0, 0), layerPose.m_rotates[i], w);
+			}
+			else
+			{
+				m_pose.m_translates[i] = glm::mix(baseT, layerPose.m_translates[i], w);
+				m_pose.m_rotates[i] = glm::slerp(baseQ, layerPose.m_rotates[i], w);
+			}
+			m_pose.m_nodeValid[i] = 1;
+		}
+
+		for (size_t i = 0; i < layerPose.m_morphValid.size(); i++)
+		{
+			if (layerPose.m_morphValid[i] == 0)
+			{
+				continue;
+			}
+			float w = layer.m_weight * (layer.m_morphMask.empty() ? 1.0f : layer.m_morphMask[i]);
+			if (w <= 0.0f)
+			{
+				continue;
+			}
+			float base = m_pose.m_morphValid[i] != 0 ? m_pose.m_morphWeights[i] : 0.0f;
+			if (additive)
+			{
+				m_pose.m_morphWeights[i] = base + layerPose.m_morphWeights[i] * w;
+			}
+			else
+			{
+				m_pose.m_morphWeights[i] = glm::mix(base, layerPose.m_morphWeights[i], w);
+			}
+			m_pose.m_morphValid[i] = 1;
+		}
+
+		if (!additive)
+		{
+			for (size_t i = 0; i < layerPose.m_ikValid.size(); i++)
+			{
+				if (layerPose.m_ikValid[i] == 0 || layer.m_weight < 0.5f)
+				{
+					continue;
+				}
+				m_pose.m_ikEnables[i] = layerPose.m_ikEnables[i];
+				m_pose.m_ikValid[i] = 1;
+			}
+		}
+	}
+
+	void VMDAnimationBlender::Evaluate()
+	{
+		if (m_model == nullptr)
+		{
+			return;
+		}
+
+		m_pose.Reset();
+		for (auto& layer : m_layers)
+		{
+			if (layer.m_clips.empty() || layer.m_weight <= 0.0f)
+			{
+				continue;
+			}
+
+			// 古いクリップから順にクロスフェードする
+			m_layerPose.Reset();
+			for (auto& clip : layer.m_clips)
+			{
+				SampleClip(&clip, &m_clipPose);
+				MixPose(&m_layerPose, m_clipPose, clip.GetFadeWeight());
+			}
+			BlendLayer(layer, m_layerPose);
+		}
+
+		// ノードへの書き込みは一度だけ行う
+		auto nodeMan = m_model->GetNodeManager();
+		for (size_t i = 0; i < m_pose.m_nodeValid.size(); i++)
+		{
+			if (m_pose.m_nodeValid[i] != 0)
+			{
+				auto node = nodeMan->GetMMDNode(i);
+				node->SetAnimationTranslate(m_pose.m_translates[i]);
+				node->SetAnimationRotate(m_pose.m_rotates[i]);
+			}
+		}
+		auto morphMan = m_model->GetMorphManager();
+		for (size_t i = 0; i < m_pose.m_morphValid.size(); i++)
+		{
+			if (m_pose.m_morphValid[i] != 0)
+			{
+				morphMan->GetMorph(i)->SetWeight(m_pose.m_morphWeights[i]);
+			}
+		}
+		auto ikMan = m_model->GetIKManager();
+		for (size_t i = 0; i < m_pose.m_ikValid.size(); i++)
+		{
+			if (m_pose.m_ikValid[i] != 0)
+			{
+				ikMan->GetMMDIKSolver(i)->Enable(m_pose.m_ikEnables[i] != 0);
+			}
+		}
+	}
+}
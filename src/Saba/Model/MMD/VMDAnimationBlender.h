@@ -0,0 +1,156 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_MODEL_MMD_VMDANIMATIONBLENDER_H_
+#define SABA_MODEL_MMD_VMDANIMATIONBLENDER_H_
+
+#include "MMDModel.h"
+#include "VMDAnimation.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace saba
+{
+	/*
+		複数の VMDAnimation をレイヤーとして重ね、結果を一度だけノードに書き込む.
+		レイヤーは追加した順に評価する.
+		- Override : 下のレイヤーの結果に対してレイヤーの重み x マスクで補間する
+		- Additive : 下のレイヤーの結果に加算する (回転は下のレイヤーの回転の後に掛ける)
+		Play でクリップを切り替えると fadeTime 秒かけてクロスフェードする.
+		レイヤーが何も再生していない場合はレストポーズからフェードする.
+		(下のレイヤーのポーズからフェードする場合は SetLayerWeight の fadeTime を使う)
+		どのレイヤーのクリップにも含まれないノード / モーフ / IK は変更しない.
+
+		使い方
+			blender.Update(elapsed);
+			model->BeginAnimation();
+			blender.Evaluate();
+			model->UpdateAllAnimation(nullptr, 0, elapsed);
+			model->EndAnimation();
+	*/
+	class VMDAnimationBlender
+	{
+	public:
+		enum class BlendMode
+		{
+			Override,
+			Additive,
+		};
+
+		VMDAnimationBlender();
+
+		bool Create(std::shared_ptr<MMDModel> model);
+		void Destroy();
+
+		size_t AddLayer(BlendMode mode = BlendMode::Override, float weight = 1.0f);
+		size_t GetLayerCount() const { return m_layers.size(); }
+
+		void SetLayerBlendMode(size_t layerIdx, BlendMode mode);
+		// fadeTime (秒) かけて重みを変える
+		void SetLayerWeight(size_t layerIdx, float weight, float fadeTime = 0.0f);
+		float GetLayerWeight(size_t layerIdx) const;
+
+		/*
+			レイヤーが影響するノードを制限する.
+			nodeNames 以外のノードの重みは 0 になる. includeChildren が true なら子ノードも含める.
+		*/
+		void SetLayerNodeMask(size_t layerIdx, const std::vector<std::string>& nodeNames, bool includeChildren = true);
+		void SetLayerNodeMaskWeight(size_t layerIdx, const std::string& nodeName, float weight);
+		// morphNames 以外のモーフの重みを 0 にする
+		void SetLayerMorphMask(size_t layerIdx, const std::vector<std::string>& morphNames);
+		void ClearLayerMask(size_t layerIdx);
+
+		/*
+			レイヤーのクリップを anim に切り替える.
+			anim は Create で同じモデルを指定したもの. nullptr の場合はクリップを止める.
+			startFrame, GetLayerFrame は VMD のフレーム (30fps)
+		*/
+		void Play(
+			size_t							layerIdx,
+			std::shared_ptr<VMDAnimation>	anim,
+			float							fadeTime = 0.0f,
+			float							startFrame = 0.0f,
+			bool							loop = true,
+			float							speed = 1.0f
+		);
+		void Stop(size_t layerIdx, float fadeTime = 0.0f);
+		float GetLayerFrame(size_t layerIdx) const;
+		bool IsFading(size_t layerIdx) const;
+
+		// 再生時間とフェードを進める (秒)
+		void Update(float elapsed);
+		// 現在の時間でブレンドしたポーズをノード / モーフ / IK に書き込む
+		void Evaluate();
+
+	private:
+		// モデルのノード / モーフ / IK の並びのポーズ
+		struct Pose
+		{
+			std::vector<glm::vec3>	m_translates;
+			std::vector<glm::quat>	m_rotates;
+			std::vector<uint8_t>	m_nodeValid;
+			std::vector<float>		m_morphWeights;
+			std::vector<uint8_t>	m_morphValid;
+			std::vector<uint8_t>	m_ikEnables;
+			std::vector<uint8_t>	m_ikValid;
+
+			void Resize(size_t nodeCount, size_t morphCount, size_t ikCount);
+			void Reset();
+		};
+
+		struct Clip
+		{
+			std::shared_ptr<VMDAnimation>	m_anim;		//!< nullptr : 停止 (レストポーズへフェードする)
+			float				m_frame;
+			float				m_speed;
+			bool				m_loop;
+			float				m_fadeTime;
+			float				m_fadeElapsed;
+			// コントローラーからモデルのインデックスへの対応
+			std::vector<size_t>	m_nodeIndices;
+			std::vector<size_t>	m_morphIndices;
+			std::vector<size_t>	m_ikIndices;
+			// キーの検索開始位置
+			std::vector<size_t>	m_nodeKeyHints;
+			std::vector<size_t>	m_morphKeyHints;
+			std::vector<size_t>	m_ikKeyHints;
+
+			float GetFadeWeight() const;
+		};
+
+		struct Layer
+		{
+			BlendMode			m_mode;
+			float				m_weight;
+			float				m_startWeight;
+			float				m_targetWeight;
+			float				m_weightFadeTime;
+			float				m_weightFadeElapsed;
+			std::vector<float>	m_nodeMask;		//!< 空の場合は全て 1
+			std::vector<float>	m_morphMask;	//!< 空の場合は全て 1
+			std::vector<Clip>	m_clips;		//!< 後ろほど新しい
+		};
+
+		void SetupClip(Clip* clip);
+		void SampleClip(Clip* clip, Pose* pose) const;
+		static void MixPose(Pose* dst, const Pose& src, float t);
+		void BlendLayer(const Layer& layer, const Pose& layerPose);
+
+	private:
+		std::shared_ptr<MMDModel>	m_model;
+		std::vector<Layer>			m_layers;
+
+		// 作業用
+		Pose	m_pose;
+		Pose	m_layerPose;
+		Pose	m_clipPose;
+	};
+}
+
+#endif // !SABA_MODEL_MMD_VMDANIMATIONBLENDER_H_
@@ -6,7 +6,9 @@
 #ifndef SABA_MODEL_MMD_VMDANIMATIONCOMMON_H_
 #define SABA_MODEL_MMD_VMDANIMATIONCOMMON_H_
 
+#include <algorithm>
 #include <cstdint>
+#include <iterator>
 #include <vector>
 
 namespace saba
@@ -59,6 +61,50 @@ namespace saba
 		});
 		return bundIt;
 	}
+
+	// FindBoundKey の時間配列版. 見つからない場合は times.size() を返す
+	inline size_t FindBoundKeyIndex(
+		const std::vector<int32_t>&	times,
+		int32_t						t,
+		size_t						startIdx
+	) {
+		if (times.empty() || times.size() <= startIdx)
+		{
+			return times.size();
+		}
+
+		if (times[startIdx] <= t)
+		{
+			if (startIdx + 1 < times.size())
+			{
+				if (times[startIdx + 1] > t)
+				{
+					return startIdx + 1;
+				}
+			}
+			else
+			{
+				return times.size();
+			}
+		}
+		else
+		{
+			if (startIdx != 0)
+			{
+				if (times[startIdx - 1] <= t)
+				{
+					return startIdx;
+				}
+			}
+			else
+			{
+				return 0;
+			}
+		}
+
+		auto boundIt = std::upper_bound(times.begin(), times.end(), t);
+		return size_t(std::distance(times.begin(), boundIt));
+	}
 }
 
 #endif // !SABA_MODEL_MMD_VMDANIMATIONCOMMON_H_
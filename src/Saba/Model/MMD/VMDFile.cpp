@@ -7,6 +7,7 @@
 
 #include <Saba/Base/Log.h>
 #include <Saba/Base/File.h>
+#include <Saba/Base/Trace.h>
 
 namespace saba
 {
@@ -229,6 +230,8 @@ namespace saba
 
 	bool ReadVMDFile(VMDFile * vmd, const char * filename)
 	{
+		SABA_TRACE_SCOPE("ReadVMDFile");
+
 		File file;
 		if (!file.Open(filename))
 		{
@@ -239,4 +242,100 @@ namespace saba
 		return ReadVMDFile(vmd, file);
 	}
 
+	namespace
+	{
+		template <typename T>
+		bool Write(const T& val, File& file)
+		{
+			return file.Write(&val);
+		}
+
+		bool WriteVMDFile(const VMDFile* vmd, File& file)
+		{
+			Write(vmd->m_header.m_header, file);
+			Write(vmd->m_header.m_modelName, file);
+
+			Write(uint32_t(vmd->m_motions.size()), file);
+			for (const auto& motion : vmd->m_motions)
+			{
+				Write(motion.m_boneName, file);
+				Write(motion.m_frame, file);
+				Write(motion.m_translate, file);
+				Write(motion.m_quaternion, file);
+				Write(motion.m_interpolation, file);
+			}
+
+			Write(uint32_t(vmd->m_morphs.size()), file);
+			for (const auto& morph : vmd->m_morphs)
+			{
+				Write(morph.m_blendShapeName, file);
+				Write(morph.m_frame, file);
+				Write(morph.m_weight, file);
+			}
+
+			Write(uint32_t(vmd->m_cameras.size()), file);
+			for (const auto& camera : vmd->m_cameras)
+			{
+				Write(camera.m_frame, file);
+				Write(camera.m_distance, file);
+				Write(camera.m_interest, file);
+				Write(camera.m_rotate, file);
+				Write(camera.m_interpolation, file);
+				Write(camera.m_viewAngle, file);
+				Write(camera.m_isPerspective, file);
+			}
+
+			Write(uint32_t(vmd->m_lights.size()), file);
+			for (const auto& light : vmd->m_lights)
+			{
+				Write(light.m_frame, file);
+				Write(light.m_color, file);
+				Write(light.m_position, file);
+			}
+
+			Write(uint32_t(vmd->m_shadows.size()), file);
+			for (const auto& shadow : vmd->m_shadows)
+			{
+				Write(shadow.m_frame, file);
+				Write(shadow.m_shadowType, file);
+				Write(shadow.m_distance, file);
+			}
+
+			Write(uint32_t(vmd->m_iks.size()), file);
+			for (const auto& ik : vmd->m_iks)
+			{
+				Write(ik.m_frame, file);
+				Write(ik.m_show, file);
+				Write(uint32_t(ik.m_ikInfos.size()), file);
+				for (const auto& ikInfo : ik.m_ikInfos)
+				{
+					Write(ikInfo.m_name, file);
+					Write(ikInfo.m_enable, file);
+				}
+			}
+
+			return !file.IsBad();
+		}
+	}
+
+	bool WriteVMDFile(const VMDFile * vmd, const char * filename)
+	{
+		SABA_TRACE_SCOPE("WriteVMDFile");
+
+		File file;
+		if (!file.Create(filename))
+		{
+			SABA_WARN("VMD File Create Fail. {}", filename);
+			return false;
+		}
+
+		if (!WriteVMDFile(vmd, file))
+		{
+			SABA_WARN("VMD File Write Fail. {}", filename);
+			return false;
+		}
+
+		return true;
+	}
+
 }
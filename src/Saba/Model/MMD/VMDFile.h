@@ -93,6 +93,7 @@ namespace saba
 	};
 
 	bool ReadVMDFile(VMDFile* vmd, const char* filename);
+	bool WriteVMDFile(const VMDFile* vmd, const char* filename);
 }
 
 #endif // !SABA_MODEL_MMD_VMDFILE_H_
@@ -6,362 +6,296 @@
 #include "VPDFile.h"
 
 #include <algorithm>
+#include <cstring>
 
 #include <Saba/Base/Log.h>
 #include <Saba/Base/File.h>
+#include <Saba/Base/NumberParser.h>
 #include <Saba/Base/UnicodeUtil.h>
 
 #include "SjisToUnicode.h"
 
 namespace saba
 {
-	bool ReadVPDFile(VPDFile * vpd, const char * filename)
+	namespace
 	{
-		
-		TextFileReader file;
-		if (!file.Open(filename))
-		{
-			SABA_INFO("VPD File Open Fail. {}", filename);
-			return false;
-		}
-
-		std::vector<std::string> lines;
-		file.ReadAllLines(lines);
-
-		if (lines.empty() || lines[0] != "Vocaloid Pose Data file")
-		{
-			SABA_INFO("VPD File Format Error.");
-			return false;
-		}
+		const char VPDHeader[] = "Vocaloid Pose Data file";
 
-		// remove comment
-		for (auto it = lines.begin() + 1; it != lines.end(); ++it)
+		/*
+			行ごとに文字列を作らず、バッファを先頭から 1 回だけ走査する.
+			空白、改行、"//" から行末までのコメントは区切りとして読み飛ばす.
+		*/
+		class VPDParser
 		{
-			auto& line = (*it);
-			auto commentPos = line.find("//");
-			line = line.substr(0, commentPos);
-		}
-
-		auto lineIt = lines.begin() + 1;
-		// parent file name
-		lineIt = std::find_if(lineIt, lines.end(), [](const std::string& line) {
-			return !line.empty();
-		});
-		if (lineIt == lines.end())
-		{
-			SABA_INFO("VPD File Parse Error.[parent fil name]");
-			return false;
-		}
-		lineIt++;
-
-		// num bones
-		lineIt = std::find_if(lineIt, lines.end(), [](const std::string& line) {
-			return !line.empty();
-		});
-		if (lineIt == lines.end())
-		{
-			SABA_INFO("VPD File Parse Error.[num bones]");
-			return false;
-		}
-		int numBones = 0;
-		try
-		{
-			const auto& line = (*lineIt);
-			auto numStr = line.substr(0, line.find(';'));
-			numBones = std::stoi(numStr);
-		}
-		catch (std::exception& e)
-		{
-			SABA_INFO("VPD File Parse Error. {}:[{}]", size_t(lineIt - lines.begin()), e.what());
-			return false;
-		}
-		std::vector<VPDBone> bones(numBones);
-
-		lineIt++;
+		public:
+			VPDParser(const char* begin, const char* end)
+				: m_begin(begin)
+				, m_cur(begin)
+				, m_end(end)
+			{
+			}
 
-		lineIt = std::find_if(lineIt, lines.end(), [](const std::string& line) {
-			return !line.empty();
-		});
-		int boneCount = 0;
-		while (boneCount < numBones && lineIt != lines.end())
-		{
-			int boneIdx = 0;
+			bool IsEnd()
 			{
-				const auto& line = (*lineIt);
-				auto delimPos1 = line.find("Bone");
-				if (delimPos1 == line.npos)
-				{
-					SABA_INFO("VPD File Parse Error. {}:[Not Found Bone]", size_t(lineIt - lines.begin()));
-					return false;
-				}
-				delimPos1 += 4;
+				SkipSpace();
+				return m_cur == m_end;
+			}
 
-				auto delimPos2 = line.find('{', delimPos1);
-				if (delimPos2 == line.npos)
-				{
-					SABA_INFO("VPD File Parse Error. {}:[Not Found Bone]", size_t(lineIt - lines.begin()));
-					return false;
-				}
+			// 現在位置の行番号 (エラー表示用)
+			size_t GetLineNumber() const
+			{
+				return size_t(std::count(m_begin, m_cur, '\n')) + 1;
+			}
 
-				auto numStr = line.substr(delimPos1, delimPos2 - delimPos1);
-				try
-				{
-					boneIdx = std::stoi(numStr);
-				}
-				catch (std::exception& e)
-				{
-					SABA_INFO("VPD File Parse Error. {}:[{}]", size_t(lineIt - lines.begin()), e.what());
-					return false;
-				}
-				if (boneIdx >= numBones)
+			bool ReadHeader()
+			{
+				const size_t headerSize = sizeof(VPDHeader) - 1;
+				if (size_t(m_end - m_cur) < headerSize || memcmp(m_cur, VPDHeader, headerSize) != 0)
 				{
-					SABA_INFO("VPD File Parse Error. {}:[Bone Index over]", size_t(lineIt - lines.begin()));
 					return false;
 				}
-				bones[boneIdx].m_boneName = line.substr(delimPos2 + 1);
+				m_cur += headerSize;
+				return m_cur == m_end || *m_cur == '\r' || *m_cur == '\n';
 			}
-			++lineIt;;
-			lineIt = std::find_if(lineIt, lines.end(), [](const std::string& line) {
-				return !line.empty();
-			});
-			
+
+			// 空でない行を 1 行読み飛ばす
+			bool SkipLine()
 			{
-				const auto& line = (*lineIt);
-				auto delim1 = line.find_first_not_of(" \t");
-				auto delim2 = line.find_first_of(" \t,", delim1);
-				if (line.npos == delim1 || line.npos == delim2)
+				if (IsEnd())
 				{
-					SABA_INFO("VPD File Parse Error. {}:[Split error]", size_t(lineIt - lines.begin()));
 					return false;
 				}
-
-				auto delim3 = line.find_first_not_of(" \t,", delim2);
-				auto delim4 = line.find_first_of(" \t,", delim3);
-				if (line.npos == delim3 || line.npos == delim4)
+				while (m_cur != m_end && *m_cur != '\r' && *m_cur != '\n')
 				{
-					SABA_INFO("VPD File Parse Error. {}:[Split error]", size_t(lineIt - lines.begin()));
-					return false;
+					m_cur++;
 				}
+				return true;
+			}
 
-				auto delim5 = line.find_first_not_of(" \t,", delim4);
-				auto delim6 = line.find_first_of(" \t;", delim5);
-				if (line.npos == delim5 || line.npos == delim6)
+			bool Expect(char ch)
+			{
+				SkipSpace();
+				if (m_cur == m_end || *m_cur != ch)
 				{
-					SABA_INFO("VPD File Parse Error. {}:[Split error]", size_t(lineIt - lines.begin()));
 					return false;
 				}
+				m_cur++;
+				return true;
+			}
 
-				auto delim7 = line.find_first_of(";", delim5);
-				if (line.npos == delim7)
+			bool ExpectKeyword(const char* keyword)
+			{
+				SkipSpace();
+				size_t len = strlen(keyword);
+				if (size_t(m_end - m_cur) < len || memcmp(m_cur, keyword, len) != 0)
 				{
-					SABA_INFO("VPD File Parse Error. {}:[Split error]", size_t(lineIt - lines.begin()));
 					return false;
 				}
+				m_cur += len;
+				return true;
+			}
 
-				try
-				{
-					auto numStr1 = line.substr(delim1, delim2 - delim1);
-					auto numStr2 = line.substr(delim3, delim4 - delim3);
-					auto numStr3 = line.substr(delim5, delim6 - delim5);
-					bones[boneIdx].m_translate.x = std::stof(numStr1);
-					bones[boneIdx].m_translate.y = std::stof(numStr2);
-					bones[boneIdx].m_translate.z = std::stof(numStr3);
-				}
-				catch (std::exception& e)
-				{
-					SABA_INFO("VPD File Parse Error. {}:[{}]", size_t(lineIt - lines.begin()), e.what());
-					return false;
-				}
+			bool ReadInt(int* value)
+			{
+				SkipSpace();
+				return Advance(ParseInt(m_cur, m_end, value));
 			}
-			++lineIt;;
-			lineIt = std::find_if(lineIt, lines.end(), [](const std::string& line) {
-				return !line.empty();
-			});
 
+			bool ReadFloat(float* value)
 			{
-				const auto& line = (*lineIt);
-				auto delim1 = line.find_first_not_of(" \t");
-				auto delim2 = line.find_first_of(" \t,", delim1);
-				if (line.npos == delim1 || line.npos == delim2)
-				{
-					SABA_INFO("VPD File Parse Error. {}:[Split error]", size_t(lineIt - lines.begin()));
-					return false;
-				}
+				SkipSpace();
+				return Advance(ParseFloat(m_cur, m_end, value));
+			}
 
-				auto delim3 = line.find_first_not_of(" \t,", delim2);
-				auto delim4 = line.find_first_of(" \t,", delim3);
-				if (line.npos == delim3 || line.npos == delim4)
+			// x,y,z; の形式. 区切りには空白も使える
+			bool ReadFloats(float* values, size_t count)
+			{
+				for (size_t i = 0; i < count; i++)
 				{
-					SABA_INFO("VPD File Parse Error. {}:[Split error]", size_t(lineIt - lines.begin()));
-					return false;
+					if (!ReadFloat(&values[i]))
+					{
+						return false;
+					}
+					SkipBlank();
+					if (i + 1 < count && m_cur != m_end && *m_cur == ',')
+					{
+						m_cur++;
+					}
 				}
+				return Expect(';');
+			}
 
-				auto delim5 = line.find_first_not_of(" \t,", delim4);
-				auto delim6 = line.find_first_of(" \t,", delim5);
-				if (line.npos == delim5 || line.npos == delim6)
+			// "{" の後ろから行末 (またはコメント) までを名前とする
+			void ReadName(const char** begin, const char** end)
+			{
+				*begin = m_cur;
+				while (m_cur != m_end && *m_cur != '\r' && *m_cur != '\n' &&
+					!(*m_cur == '/' && m_cur + 1 != m_end && m_cur[1] == '/'))
 				{
-					SABA_INFO("VPD File Parse Error. {}:[Split error]", size_t(lineIt - lines.begin()));
-					return false;
+					m_cur++;
 				}
+				*end = m_cur;
+			}
 
-				auto delim7 = line.find_first_not_of(" \t,", delim6);
-				auto delim8 = line.find_first_of(" \t;", delim7);
-				if (line.npos == delim7 || line.npos == delim8)
+		private:
+			bool Advance(const char* next)
+			{
+				if (next == nullptr)
 				{
-					SABA_INFO("VPD File Parse Error. {}:[Split error]", size_t(lineIt - lines.begin()));
 					return false;
 				}
+				m_cur = next;
+				return true;
+			}
 
-				auto delim9 = line.find_first_of(";", delim7);
-				if (line.npos == delim7)
+			void SkipBlank()
+			{
+				while (m_cur != m_end && (*m_cur == ' ' || *m_cur == '\t'))
 				{
-					SABA_INFO("VPD File Parse Error. {}:[Split error]", size_t(lineIt - lines.begin()));
-					return false;
+					m_cur++;
 				}
+			}
 
-				try
-				{
-					auto numStr1 = line.substr(delim1, delim2 - delim1);
-					auto numStr2 = line.substr(delim3, delim4 - delim3);
-					auto numStr3 = line.substr(delim5, delim6 - delim5);
-					auto numStr4 = line.substr(delim7, delim8 - delim7);
-					bones[boneIdx].m_quaternion.x = std::stof(numStr1);
-					bones[boneIdx].m_quaternion.y = std::stof(numStr2);
-					bones[boneIdx].m_quaternion.z = std::stof(numStr3);
-					bones[boneIdx].m_quaternion.w = std::stof(numStr4);
-				}
-				catch (std::exception& e)
+			void SkipSpace()
+			{
+				while (m_cur != m_end)
 				{
-					SABA_INFO("VPD File Parse Error. {}:[{}]", size_t(lineIt - lines.begin()), e.what());
-					return false;
+					char ch = *m_cur;
+					if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n')
+					{
+						m_cur++;
+					}
+					else if (ch == '/' && m_cur + 1 != m_end && m_cur[1] == '/')
+					{
+						while (m_cur != m_end && *m_cur != '\n')
+						{
+							m_cur++;
+						}
+					}
+					else
+					{
+						break;
+					}
 				}
 			}
-			++lineIt;;
-			lineIt = std::find_if(lineIt, lines.end(), [](const std::string& line) {
-				return !line.empty();
-			});
 
+		private:
+			const char*	m_begin;
+			const char*	m_cur;
+			const char*	m_end;
+		};
+
+		// ASCII だけの名前 (英語名のボーンなど) は変換しない
+		void ConvertName(const char* begin, const char* end, std::string* name)
+		{
+			bool isAscii = std::all_of(begin, end, [](char ch) { return (ch & 0x80) == 0; });
+			if (isAscii)
 			{
-				const auto& line = (*lineIt);
-				if (line.find(('}')) == line.npos)
-				{
-					SABA_INFO("VPD File Parse Error. {}:[Split error]", size_t(lineIt - lines.begin()));
-					return false;
-				}
+				name->assign(begin, end);
+				return;
 			}
-			++lineIt;;
-			lineIt = std::find_if(lineIt, lines.end(), [](const std::string& line) {
-				return !line.empty();
-			});
-			boneCount++;
+			std::string sjisStr(begin, end);
+			std::u16string u16Str = saba::ConvertSjisToU16String(sjisStr.c_str());
+			saba::ConvU16ToU8(u16Str, *name);
 		}
+	}
 
-		for (auto& bone : bones)
+	bool ReadVPDFile(VPDFile * vpd, const char * filename)
+	{
+		MappedFile file;
+		if (!file.Open(filename))
 		{
-			std::u16string u16Str = saba::ConvertSjisToU16String(bone.m_boneName.c_str());
-			std::string u8Str;
-			saba::ConvU16ToU8(u16Str, u8Str);
-			bone.m_boneName = u8Str;
+			SABA_INFO("VPD File Open Fail. {}", filename);
+			return false;
 		}
 
-		vpd->m_bones = std::move(bones);
+		const char* data = reinterpret_cast<const char*>(file.GetData());
+		return ReadVPDFile(vpd, data, file.GetSize());
+	}
 
-		std::vector<VPDMorph> morphs;
-		while (lineIt != lines.end())
+	bool ReadVPDFile(VPDFile* vpd, const char* data, size_t size)
+	{
+		VPDParser parser(data, data + size);
+		if (!parser.ReadHeader())
 		{
-			VPDMorph morph;
-			{
-				const auto& line = (*lineIt);
-				auto delimPos1 = line.find("Morph");
-				if (delimPos1 == line.npos)
-				{
-					SABA_INFO("VPD File Parse Error. {}:[Not Found Morph]", size_t(lineIt - lines.begin()));
-					return false;
-				}
-				delimPos1 += sizeof("Morph") - 1;
+			SABA_INFO("VPD File Format Error.");
+			return false;
+		}
 
-				auto delimPos2 = line.find('{', delimPos1);
-				if (delimPos2 == line.npos)
-				{
-					SABA_INFO("VPD File Parse Error. {}:[Not Found Morph]", size_t(lineIt - lines.begin()));
-					return false;
-				}
+		// parent file name
+		if (!parser.SkipLine())
+		{
+			SABA_INFO("VPD File Parse Error.[parent fil name]");
+			return false;
+		}
 
-				auto numStr = line.substr(delimPos1, delimPos2 - delimPos1);
-				try
-				{
-					int morphIndex = std::stoi(numStr);
-				}
-				catch (std::exception& e)
-				{
-					SABA_INFO("VPD File Parse Error. {}:[{}]", size_t(lineIt - lines.begin()), e.what());
-					return false;
-				}
-				morph.m_morphName = line.substr(delimPos2 + 1);
-			}
-			++lineIt;;
-			lineIt = std::find_if(lineIt, lines.end(), [](const std::string& line) {
-				return !line.empty();
-			});
+		// num bones
+		int numBones = 0;
+		if (!parser.ReadInt(&numBones) || numBones < 0 || !parser.Expect(';'))
+		{
+			SABA_INFO("VPD File Parse Error. {}:[num bones]", parser.GetLineNumber());
+			return false;
+		}
 
+		std::vector<VPDBone> bones(numBones);
+		int boneCount = 0;
+		while (boneCount < numBones && !parser.IsEnd())
+		{
+			int boneIdx = 0;
+			if (!parser.ExpectKeyword("Bone") || !parser.ReadInt(&boneIdx) || !parser.Expect('{'))
 			{
-				const auto& line = (*lineIt);
-				auto delim1 = line.find_first_not_of(" \t");
-				auto delim2 = line.find_first_of(" \t;", delim1);
-				if (line.npos == delim1 || line.npos == delim2)
-				{
-					SABA_INFO("VPD File Parse Error. {}:[Split error]", size_t(lineIt - lines.begin()));
-					return false;
-				}
-
-				auto delim3 = line.find_first_of(";", delim2);
-				if (line.npos == delim2)
-				{
-					SABA_INFO("VPD File Parse Error. {}:[Split error]", size_t(lineIt - lines.begin()));
-					return false;
-				}
+				SABA_INFO("VPD File Parse Error. {}:[Not Found Bone]", parser.GetLineNumber());
+				return false;
+			}
+			if (boneIdx < 0 || boneIdx >= numBones)
+			{
+				SABA_INFO("VPD File Parse Error. {}:[Bone Index over]", parser.GetLineNumber());
+				return false;
+			}
 
-				try
-				{
-					auto numStr1 = line.substr(delim1, delim2 - delim1);
-					morph.m_weight = std::stof(numStr1);
-				}
-				catch (std::exception& e)
-				{
-					SABA_INFO("VPD File Parse Error. {}:[{}]", size_t(lineIt - lines.begin()), e.what());
-					return false;
-				}
-				++lineIt;;
-				lineIt = std::find_if(lineIt, lines.end(), [](const std::string& line) {
-					return !line.empty();
-				});
+			auto& bone = bones[boneIdx];
+			const char* nameBegin;
+			const char* nameEnd;
+			parser.ReadName(&nameBegin, &nameEnd);
+			ConvertName(nameBegin, nameEnd, &bone.m_boneName);
 
-				{
-					const auto& line = (*lineIt);
-					if (line.find(('}')) == line.npos)
-					{
-						SABA_INFO("VPD File Parse Error. {}:[Split error]", size_t(lineIt - lines.begin()));
-						return false;
-					}
-				}
-				++lineIt;;
-				lineIt = std::find_if(lineIt, lines.end(), [](const std::string& line) {
-					return !line.empty();
-				});
-				boneCount++;
+			float t[3];
+			float q[4];
+			if (!parser.ReadFloats(t, 3) || !parser.ReadFloats(q, 4) || !parser.Expect('}'))
+			{
+				SABA_INFO("VPD File Parse Error. {}:[Split error]", parser.GetLineNumber());
+				return false;
 			}
-
-			morphs.emplace_back(std::move(morph));
+			bone.m_translate = glm::vec3(t[0], t[1], t[2]);
+			bone.m_quaternion = glm::quat(q[3], q[0], q[1], q[2]);
+			boneCount++;
 		}
 
-		for (auto& morph : morphs)
+		std::vector<VPDMorph> morphs;
+		while (!parser.IsEnd())
 		{
-			std::u16string u16Str = saba::ConvertSjisToU16String(morph.m_morphName.c_str());
-			std::string u8Str;
-			saba::ConvU16ToU8(u16Str, u8Str);
-			morph.m_morphName = u8Str;
+			int morphIdx = 0;
+			if (!parser.ExpectKeyword("Morph") || !parser.ReadInt(&morphIdx) || !parser.Expect('{'))
+			{
+				SABA_INFO("VPD File Parse Error. {}:[Not Found Morph]", parser.GetLineNumber());
+				return false;
+			}
+
+			VPDMorph morph;
+			const char* nameBegin;
+			const char* nameEnd;
+			parser.ReadName(&nameBegin, &nameEnd);
+			ConvertName(nameBegin, nameEnd, &morph.m_morphName);
+
+			if (!parser.ReadFloats(&morph.m_weight, 1) || !parser.Expect('}'))
+			{
+				SABA_INFO("VPD File Parse Error. {}:[Split error]", parser.GetLineNumber());
+				return false;
+			}
+			morphs.emplace_back(std::move(morph));
 		}
 
+		vpd->m_bones = std::move(bones);
 		vpd->m_morphs = std::move(morphs);
 
 		return true;
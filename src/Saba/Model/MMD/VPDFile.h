@@ -34,6 +34,8 @@ namespace saba
 	};
 
 	bool ReadVPDFile(VPDFile* vpd, const char* filename);
+	// メモリ上の VPD (Shift-JIS のテキスト) を読み込む
+	bool ReadVPDFile(VPDFile* vpd, const char* data, size_t size);
 }
 
 #endif // !SABA_MODEL_MMD_VPDFILE_H_
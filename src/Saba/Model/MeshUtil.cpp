@@ -0,0 +1,329 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "MeshUtil.h"
+#include "../Base/Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace saba
+{
+	namespace
+	{
+		const uint32_t InvalidIndex = uint32_t(-1);
+
+		struct MeshVertex
+		{
+			glm::vec3	m_position;
+			glm::vec3	m_normal;
+			glm::vec2	m_uv;
+		};
+
+		struct MeshVertexHash
+		{
+			size_t operator()(const MeshVertex& vtx) const
+			{
+				uint32_t words[sizeof(MeshVertex) / sizeof(uint32_t)];
+				memcpy(words, &vtx, sizeof(words));
+				uint64_t h = 14695981039346656037ULL;
+				for (auto word : words)
+				{
+					h = (h ^ word) * 1099511628211ULL;
+				}
+				return size_t(h ^ (h >> 32));
+			}
+		};
+
+		// 値のビットが同じものを同じ頂点とする
+		struct MeshVertexEqual
+		{
+			bool operator()(const MeshVertex& a, const MeshVertex& b) const
+			{
+				return memcmp(&a, &b, sizeof(MeshVertex)) == 0;
+			}
+		};
+
+		bool IsValidFaceIndex(int index, size_t count)
+		{
+			return index == -1 || (index >= 0 && size_t(index) < count);
+		}
+	}
+
+	bool BuildIndexedMesh(
+		const glm::vec3*	positions,
+		size_t				positionCount,
+		const glm::vec3*	normals,
+		size_t				normalCount,
+		const glm::vec2*	uvs,
+		size_t				uvCount,
+		const MeshFace*		faces,
+		size_t				faceCount,
+		IndexedMesh*		mesh
+	)
+	{
+		mesh->m_positions.clear();
+		mesh->m_normals.clear();
+		mesh->m_uvs.clear();
+		mesh->m_indices.clear();
+		mesh->m_subMeshes.clear();
+
+		for (size_t faceIdx = 0; faceIdx < faceCount; faceIdx++)
+		{
+			const auto& face = faces[faceIdx];
+			for (int i = 0; i < 3; i++)
+			{
+				if (!IsValidFaceIndex(face.m_position[i], positionCount) ||
+					!IsValidFaceIndex(face.m_normal[i], normalCount) ||
+					!IsValidFaceIndex(face.m_uv[i], uvCount))
+				{
+					SABA_WARN("Face index is out of range. [{}]", faceIdx);
+					return false;
+				}
+			}
+		}
+		if (faceCount * 3 > size_t(InvalidIndex))
+		{
+			SABA_WARN("Too many faces. [{}]", faceCount);
+			return false;
+		}
+
+		// 材質ごとにまとめる (同じ材質の中では元の順番を保つ)
+		std::vector<uint32_t> faceOrder(faceCount);
+		std::iota(faceOrder.begin(), faceOrder.end(), 0);
+		std::stable_sort(faceOrder.begin(), faceOrder.end(), [faces](uint32_t a, uint32_t b)
+		{
+			return faces[a].m_material < faces[b].m_material;
+		});
+
+		std::vector<MeshVertex> vertices;
+		std::unordered_map<MeshVertex, uint32_t, MeshVertexHash, MeshVertexEqual> vertexIndices;
+		vertexIndices.reserve(faceCount * 3);
+		mesh->m_indices.reserve(faceCount * 3);
+		for (auto faceIdx : faceOrder)
+		{
+			const auto& face = faces[faceIdx];
+			if (mesh->m_subMeshes.empty() || mesh->m_subMeshes.back().m_material != face.m_material)
+			{
+				IndexedMesh::SubMesh subMesh;
+				subMesh.m_beginIndex = uint32_t(mesh->m_indices.size());
+				subMesh.m_indexCount = 0;
+				subMesh.m_material = face.m_material;
+				mesh->m_subMeshes.push_back(subMesh);
+			}
+			mesh->m_subMeshes.back().m_indexCount += 3;
+
+			for (int i = 0; i < 3; i++)
+			{
+				// 属性が無い場合は 0 にする
+				MeshVertex vtx;
+				vtx.m_position = face.m_position[i] != -1 ? positions[face.m_position[i]] : glm::vec3(0);
+				vtx.m_normal = face.m_normal[i] != -1 ? normals[face.m_normal[i]] : glm::vec3(0);
+				vtx.m_uv = face.m_uv[i] != -1 ? uvs[face.m_uv[i]] : glm::vec2(0);
+
+				auto inserted = vertexIndices.insert(std::make_pair(vtx, uint32_t(vertices.size())));
+				if (inserted.second)
+				{
+					vertices.push_back(vtx);
+				}
+				mesh->m_indices.push_back(inserted.first->second);
+			}
+		}
+
+		VertexCacheOptimizer optimizer(vertices.size());
+		for (const auto& subMesh : mesh->m_subMeshes)
+		{
+			optimizer.Optimize(&mesh->m_indices[subMesh.m_beginIndex], subMesh.m_indexCount);
+		}
+
+		// 頂点を最初に参照される順に並べ替える
+		std::vector<uint32_t> remap(vertices.size(), InvalidIndex);
+		mesh->m_positions.reserve(vertices.size());
+		mesh->m_normals.reserve(vertices.size());
+		mesh->m_uvs.reserve(vertices.size());
+		for (auto& index : mesh->m_indices)
+		{
+			if (remap[index] == InvalidIndex)
+			{
+				remap[index] = uint32_t(mesh->m_positions.size());
+				const auto& vtx = vertices[index];
+				mesh->m_positions.push_back(vtx.m_position);
+				mesh->m_normals.push_back(vtx.m_normal);
+				mesh->m_uvs.push_back(vtx.m_uv);
+			}
+			index = remap[index];
+		}
+
+		return true;
+	}
+
+	VertexCacheOptimizer::VertexCacheOptimizer(size_t vertexCount, size_t cacheSize)
+		: m_cacheSize(cacheSize)
+		, m_time(0)
+		, m_cursor(0)
+		, m_liveCount(vertexCount)
+		, m_cacheTime(vertexCount)
+		, m_adjOffset(vertexCount)
+		, m_adjCount(vertexCount)
+	{
+	}
+
+	void VertexCacheOptimizer::Optimize(uint32_t* indices, size_t indexCount)
+	{
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		// 作業用のバッファは、このサブメッシュが使う頂点の分だけ初期化する
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			auto vi = indices[i];
+			m_liveCount[vi] = 0;
+			m_cacheTime[vi] = 0;
+			m_adjOffset[vi] = InvalidIndex;
+			m_adjCount[vi] = 0;
+		}
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			m_liveCount[indices[i]]++;
+		}
+
+		// 頂点ごとの隣接する三角形のリスト
+		uint32_t adjOffset = 0;
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			auto vi = indices[i];
+			if (m_adjOffset[vi] == InvalidIndex)
+			{
+				m_adjOffset[vi] = adjOffset;
+				adjOffset += m_liveCount[vi];
+			}
+		}
+		m_adjTriangles.resize(triangleCount * 3);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+		{
+			auto vi = indices[i];
+			m_adjTriangles[m_adjOffset[vi] + m_adjCount[vi]] = uint32_t(i / 3);
+			m_adjCount[vi]++;
+		}
+
+		m_emitted.assign(triangleCount, 0);
+		m_deadEnd.clear();
+		m_output.clear();
+		m_output.reserve(triangleCount * 3);
+		m_time = uint32_t(m_cacheSize) + 1;
+		m_cursor = 0;
+
+		uint32_t fanningVertex = indices[0];
+		while (fanningVertex != InvalidIndex)
+		{
+			m_candidates.clear();
+			const uint32_t* adjBegin = &m_adjTriangles[m_adjOffset[fanningVertex]];
+			const uint32_t* adjEnd = adjBegin + m_adjCount[fanningVertex];
+			for (auto adj = adjBegin; adj != adjEnd; adj++)
+			{
+				auto tri = *adj;
+				if (m_emitted[tri])
+				{
+					continue;
+				}
+				m_emitted[tri] = 1;
+				for (int i = 0; i < 3; i++)
+				{
+					auto vi = indices[tri * 3 + i];
+					m_output.push_back(vi);
+					m_deadEnd.push_back(vi);
+					m_candidates.push_back(vi);
+					m_liveCount[vi]--;
+					if (m_time - m_cacheTime[vi] > m_cacheSize)
+					{
+						m_cacheTime[vi] = m_time;
+						m_time++;
+					}
+				}
+			}
+			fanningVertex = FindNextVertex(indices, triangleCount * 3);
+		}
+
+		std::copy(m_output.begin(), m_output.end(), indices);
+	}
+
+	uint32_t VertexCacheOptimizer::FindNextVertex(const uint32_t* indices, size_t indexCount)
+	{
+		// 三角形を出力した後もキャッシュに残っている頂点のうち、最も古いもの
+		uint32_t bestVertex = InvalidIndex;
+		int64_t bestPriority = -1;
+		for (auto vi : m_candidates)
+		{
+			if (m_liveCount[vi] == 0)
+			{
+				continue;
+			}
+			int64_t priority = 0;
+			int64_t age = int64_t(m_time) - int64_t(m_cacheTime[vi]);
+			if (age + 2 * int64_t(m_liveCount[vi]) <= int64_t(m_cacheSize))
+			{
+				priority = age;
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				bestVertex = vi;
+			}
+		}
+		if (bestVertex != InvalidIndex)
+		{
+			return bestVertex;
+		}
+
+		// 行き止まりの場合は、最近出力した頂点、それも無ければ入力順で次の頂点から続ける
+		while (!m_deadEnd.empty())
+		{
+			auto vi = m_deadEnd.back();
+			m_deadEnd.pop_back();
+			if (m_liveCount[vi] != 0)
+			{
+				return vi;
+			}
+		}
+		while (m_cursor < indexCount)
+		{
+			auto vi = indices[m_cursor];
+			m_cursor++;
+			if (m_liveCount[vi] != 0)
+			{
+				return vi;
+			}
+		}
+		return InvalidIndex;
+	}
+
+	float ComputeACMR(const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t cacheSize)
+	{
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+		{
+			return 0.0f;
+		}
+
+		// FIFO なので、キャッシュに入った時刻だけで判定できる (0 はキャッシュに入っていない)
+		std::vector<size_t> insertTime(vertexCount, 0);
+		size_t missCount = 0;
+		for (size_t i = 0; i < triangleCount * 3; i++)
+		{
+			auto vi = indices[i];
+			if (insertTime[vi] == 0 || missCount - insertTime[vi] >= cacheSize)
+			{
+				missCount++;
+				insertTime[vi] = missCount;
+			}
+		}
+		return float(missCount) / float(triangleCount);
+	}
+}
@@ -0,0 +1,97 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_MODEL_MESHUTIL_H_
+#define SABA_MODEL_MESHUTIL_H_
+
+#include <cstdint>
+#include <vector>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+namespace saba
+{
+	// 位置、法線、UV を別々のインデックスで参照する三角形 (-1 は属性が無い)
+	struct MeshFace
+	{
+		int	m_position[3];
+		int	m_normal[3];
+		int	m_uv[3];
+		int	m_material;
+	};
+
+	// 1 つのインデックスで参照するメッシュ
+	struct IndexedMesh
+	{
+		struct SubMesh
+		{
+			uint32_t	m_beginIndex;
+			uint32_t	m_indexCount;
+			int			m_material;
+		};
+
+		std::vector<glm::vec3>	m_positions;
+		std::vector<glm::vec3>	m_normals;
+		std::vector<glm::vec2>	m_uvs;
+		std::vector<uint32_t>	m_indices;
+		std::vector<SubMesh>	m_subMeshes;	//!< 材質の順に並ぶ
+	};
+
+	/*
+		面からインデックス付きのメッシュを作る.
+		- (位置, 法線, UV) が同じ頂点は 1 つにまとめる
+		- 面は材質ごとにまとめ、サブメッシュごとに頂点キャッシュ向けに並べ替える
+		- 頂点は最初に参照される順に並べる
+	*/
+	bool BuildIndexedMesh(
+		const glm::vec3*	positions,
+		size_t				positionCount,
+		const glm::vec3*	normals,
+		size_t				normalCount,
+		const glm::vec2*	uvs,
+		size_t				uvCount,
+		const MeshFace*		faces,
+		size_t				faceCount,
+		IndexedMesh*		mesh
+	);
+
+	/*
+		Tipsify (Sander et al. 2007) で三角形の順番を並べ替え、頂点キャッシュのヒット率を上げる.
+		作業用のバッファを使いまわすので、同じメッシュのサブメッシュは同じインスタンスで処理する.
+	*/
+	class VertexCacheOptimizer
+	{
+	public:
+		static const size_t DefaultCacheSize = 16;
+
+		explicit VertexCacheOptimizer(size_t vertexCount, size_t cacheSize = DefaultCacheSize);
+
+		// indices の三角形を並べ替える (indexCount は 3 の倍数)
+		void Optimize(uint32_t* indices, size_t indexCount);
+
+	private:
+		uint32_t FindNextVertex(const uint32_t* indices, size_t indexCount);
+
+	private:
+		size_t		m_cacheSize;
+		uint32_t	m_time;
+		size_t		m_cursor;
+
+		std::vector<uint32_t>	m_liveCount;
+		std::vector<uint32_t>	m_cacheTime;
+		std::vector<uint32_t>	m_adjOffset;
+		std::vector<uint32_t>	m_adjCount;
+		std::vector<uint32_t>	m_adjTriangles;
+		std::vector<char>		m_emitted;
+		std::vector<uint32_t>	m_deadEnd;
+		std::vector<uint32_t>	m_candidates;
+		std::vector<uint32_t>	m_output;
+	};
+
+	// FIFO の頂点キャッシュで、三角形あたりに頂点を処理する回数 (ACMR) を求める
+	float ComputeACMR(const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t cacheSize = VertexCacheOptimizer::DefaultCacheSize);
+}
+
+#endif // !SABA_MODEL_MESHUTIL_H_
@@ -7,8 +7,12 @@
 #include "../../Base/Path.h"
 #include "../../Base/Log.h"
 #include "../../Base/File.h"
+#include "../../Base/NumberParser.h"
+#include "../../Base/Singleton.h"
+#include "../../Base/ThreadPool.h"
 
-#include <iostream>
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 #include <limits>
 #include <glm/glm.hpp>
@@ -18,87 +22,511 @@ namespace saba
 {
 	namespace
 	{
-		class SabaMaterialReader : public tinyobj::MaterialReader
+		// 並列に読むときのチャンクの大きさの目安 (チャンクは行の境界で区切る)
+		const size_t OBJChunkSize = 512 * 1024;
+
+		struct OBJLine
+		{
+			const char*	m_begin;
+			const char*	m_end;
+		};
+
+		struct OBJChunk
+		{
+			const char*	m_begin;
+			const char*	m_end;
+
+			// 1 回目の走査で数える
+			size_t	m_positionCount;
+			size_t	m_normalCount;
+			size_t	m_uvCount;
+			size_t	m_faceCount;
+			OBJLine	m_lastUseMtl;	//!< チャンク内の最後の usemtl の名前 (無ければ m_begin が nullptr)
+			std::vector<OBJLine>	m_mtlLibs;
+
+			// 2 回目の走査で使う
+			size_t	m_positionOffset;
+			size_t	m_normalOffset;
+			size_t	m_uvOffset;
+			size_t	m_faceOffset;
+			int		m_material;		//!< チャンクの先頭で有効な材質
+			bool	m_useEmptyMaterial;
+			OBJLine	m_errorLine;	//!< 読めなかった行 (無ければ m_begin が nullptr)
+		};
+
+		enum class OBJLineType
+		{
+			Unknown,
+			Position,
+			Normal,
+			UV,
+			Face,
+			UseMtl,
+			MtlLib,
+		};
+
+		bool IsBlank(char ch)
+		{
+			return ch == ' ' || ch == '\t' || ch == '\r';
+		}
+
+		const char* SkipBlank(const char* p, const char* end)
 		{
-		public:
-			SabaMaterialReader(const std::string objPath)
-				: m_objPath(objPath)
+			while (p != end && IsBlank(*p))
 			{
+				p++;
 			}
+			return p;
+		}
 
-			bool operator()(
-				const std::string& matId,
-				std::vector<tinyobj::material_t>* materials,
-				std::map<std::string, int>* matMap,
-				std::string* err
-				) override
+		const char* SkipToken(const char* p, const char* end)
+		{
+			while (p != end && !IsBlank(*p))
 			{
-				std::string fileDir = PathUtil::GetDirectoryName(m_objPath);
-				std::string mtlPath = PathUtil::Combine(fileDir, matId);
-				TextFileReader fr;
-				if (!fr.Open(mtlPath))
+				p++;
+			}
+			return p;
+		}
+
+		const char* FindLineEnd(const char* p, const char* end)
+		{
+			auto lineEnd = (const char*)memchr(p, '\n', size_t(end - p));
+			return lineEnd != nullptr ? lineEnd : end;
+		}
+
+		// 行頭のキーワードを読んで、その後ろに進める
+		OBJLineType ReadLineType(const char** p, const char* end)
+		{
+			const char* keyword = SkipBlank(*p, end);
+			const char* keywordEnd = SkipToken(keyword, end);
+			*p = keywordEnd;
+
+			auto isKeyword = [keyword, keywordEnd](const char* str)
+			{
+				size_t len = strlen(str);
+				return size_t(keywordEnd - keyword) == len && memcmp(keyword, str, len) == 0;
+			};
+			switch (keywordEnd - keyword)
+			{
+			case 1:
+				if (*keyword == 'v') { return OBJLineType::Position; }
+				if (*keyword == 'f') { return OBJLineType::Face; }
+				break;
+			case 2:
+				if (isKeyword("vn")) { return OBJLineType::Normal; }
+				if (isKeyword("vt")) { return OBJLineType::UV; }
+				break;
+			case 6:
+				if (isKeyword("usemtl")) { return OBJLineType::UseMtl; }
+				if (isKeyword("mtllib")) { return OBJLineType::MtlLib; }
+				break;
+			default:
+				break;
+			}
+			return OBJLineType::Unknown;
+		}
+
+		/*
+			行末までに最大 count 個の数値を読む. 無い成分は 0 のままにする.
+			余分な成分 (v の w や頂点カラーなど) は無視する.
+		*/
+		bool ReadFloats(const char* p, const char* end, float* values, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				values[i] = 0.0f;
+			}
+			for (size_t i = 0; i < count; i++)
+			{
+				p = SkipBlank(p, end);
+				if (p == end)
 				{
-					SABA_WARN("Failed to open MTL file.");
-					SABA_INFO("Try obj name + .mtl.");
-					std::string objFileName = PathUtil::GetFilenameWithoutExt(m_objPath);
-					mtlPath = PathUtil::Combine(fileDir, objFileName + ".mtl");
-					if (!fr.Open(mtlPath))
+					break;
+				}
+				p = ParseFloat(p, end, &values[i]);
+				if (p == nullptr)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// 1 から始まるインデックス (負の値は直前の要素からの相対位置) を 0 から始まるインデックスにする
+		const char* ReadIndex(const char* p, const char* end, size_t count, int* index)
+		{
+			int value;
+			p = ParseInt(p, end, &value);
+			if (p == nullptr || value == 0)
+			{
+				return nullptr;
+			}
+			int64_t result = value > 0 ? int64_t(value) - 1 : int64_t(count) + value;
+			if (result < 0 || result > int64_t(std::numeric_limits<int>::max()))
+			{
+				return nullptr;
+			}
+			*index = int(result);
+			return p;
+		}
+
+		void CountChunk(OBJChunk* chunk)
+		{
+			chunk->m_positionCount = 0;
+			chunk->m_normalCount = 0;
+			chunk->m_uvCount = 0;
+			chunk->m_faceCount = 0;
+			chunk->m_lastUseMtl = OBJLine{ nullptr, nullptr };
+
+			const char* lineBegin = chunk->m_begin;
+			while (lineBegin != chunk->m_end)
+			{
+				const char* lineEnd = FindLineEnd(lineBegin, chunk->m_end);
+				const char* p = lineBegin;
+				switch (ReadLineType(&p, lineEnd))
+				{
+				case OBJLineType::Position:
+					chunk->m_positionCount++;
+					break;
+				case OBJLineType::Normal:
+					chunk->m_normalCount++;
+					break;
+				case OBJLineType::UV:
+					chunk->m_uvCount++;
+					break;
+				case OBJLineType::Face:
+				{
+					// 多角形は扇形に三角形に分割する
+					size_t vertexCount = 0;
+					p = SkipBlank(p, lineEnd);
+					while (p != lineEnd)
+					{
+						vertexCount++;
+						p = SkipBlank(SkipToken(p, lineEnd), lineEnd);
+					}
+					if (vertexCount >= 3)
+					{
+						chunk->m_faceCount += vertexCount - 2;
+					}
+					break;
+				}
+				case OBJLineType::UseMtl:
+				{
+					const char* name = SkipBlank(p, lineEnd);
+					chunk->m_lastUseMtl = OBJLine{ name, SkipToken(name, lineEnd) };
+					break;
+				}
+				case OBJLineType::MtlLib:
+					chunk->m_mtlLibs.push_back(OBJLine{ p, lineEnd });
+					break;
+				default:
+					break;
+				}
+				lineBegin = lineEnd != chunk->m_end ? lineEnd + 1 : lineEnd;
+			}
+		}
+
+		struct OBJParseContext
+		{
+			const std::map<std::string, int>*	m_materialMap;
+			int			m_emptyMaterial;
+			glm::vec3*	m_positions;
+			glm::vec3*	m_normals;
+			glm::vec2*	m_uvs;
+			MeshFace*	m_faces;
+		};
+
+		int FindMaterial(const std::map<std::string, int>& materialMap, const char* begin, const char* end)
+		{
+			auto it = materialMap.find(std::string(begin, end));
+			return it != materialMap.end() ? it->second : -1;
+		}
+
+		// CountChunk で数えた位置に、各要素を直接書き込む
+		void ParseChunk(OBJChunk* chunk, const OBJParseContext& ctxt)
+		{
+			struct FaceVertex
+			{
+				int	m_position;
+				int	m_normal;
+				int	m_uv;
+			};
+			std::vector<FaceVertex> faceVertices;
+
+			size_t positionCount = chunk->m_positionOffset;
+			size_t normalCount = chunk->m_normalOffset;
+			size_t uvCount = chunk->m_uvOffset;
+			size_t faceCount = chunk->m_faceOffset;
+			int material = chunk->m_material;
+			chunk->m_useEmptyMaterial = false;
+			chunk->m_errorLine = OBJLine{ nullptr, nullptr };
+
+			const char* lineBegin = chunk->m_begin;
+			while (lineBegin != chunk->m_end)
+			{
+				const char* lineEnd = FindLineEnd(lineBegin, chunk->m_end);
+				const char* p = lineBegin;
+				bool ok = true;
+				switch (ReadLineType(&p, lineEnd))
+				{
+				case OBJLineType::Position:
+					ok = ReadFloats(p, lineEnd, &ctxt.m_positions[positionCount].x, 3);
+					positionCount++;
+					break;
+				case OBJLineType::Normal:
+					ok = ReadFloats(p, lineEnd, &ctxt.m_normals[normalCount].x, 3);
+					normalCount++;
+					break;
+				case OBJLineType::UV:
+				{
+					auto& uv = ctxt.m_uvs[uvCount];
+					ok = ReadFloats(p, lineEnd, &uv.x, 2);
+					uv.y = 1.0f - uv.y;
+					uvCount++;
+					break;
+				}
+				case OBJLineType::Face:
+				{
+					// v, v/vt, v//vn, v/vt/vn
+					faceVertices.clear();
+					p = SkipBlank(p, lineEnd);
+					while (ok && p != lineEnd)
+					{
+						FaceVertex fv = { -1, -1, -1 };
+						p = ReadIndex(p, lineEnd, positionCount, &fv.m_position);
+						if (p != nullptr && p != lineEnd && *p == '/')
+						{
+							p++;
+							if (p != lineEnd && *p != '/')
+							{
+								p = ReadIndex(p, lineEnd, uvCount, &fv.m_uv);
+							}
+							if (p != nullptr && p != lineEnd && *p == '/')
+							{
+								p = ReadIndex(p + 1, lineEnd, normalCount, &fv.m_normal);
+							}
+						}
+						ok = p != nullptr && (p == lineEnd || IsBlank(*p));
+						if (ok)
+						{
+							faceVertices.push_back(fv);
+							p = SkipBlank(p, lineEnd);
+						}
+					}
+					if (!ok || faceVertices.size() < 3)
+					{
+						break;
+					}
+
+					int faceMaterial = material;
+					if (faceMaterial == -1)
+					{
+						faceMaterial = ctxt.m_emptyMaterial;
+						chunk->m_useEmptyMaterial = true;
+					}
+					for (size_t i = 1; i + 1 < faceVertices.size(); i++)
 					{
-						SABA_WARN("Failed to open MTL file.");
-						if (err)
+						const FaceVertex* fvs[3] = { &faceVertices[0], &faceVertices[i], &faceVertices[i + 1] };
+						auto& face = ctxt.m_faces[faceCount];
+						for (int vi = 0; vi < 3; vi++)
 						{
-							*err = "Failed to open MTL file.";
+							face.m_position[vi] = fvs[vi]->m_position;
+							face.m_normal[vi] = fvs[vi]->m_normal;
+							face.m_uv[vi] = fvs[vi]->m_uv;
 						}
-						return false;
+						face.m_material = faceMaterial;
+						faceCount++;
 					}
+					break;
+				}
+				case OBJLineType::UseMtl:
+				{
+					const char* name = SkipBlank(p, lineEnd);
+					material = FindMaterial(*ctxt.m_materialMap, name, SkipToken(name, lineEnd));
+					break;
+				}
+				default:
+					break;
 				}
-				std::string allText = fr.ReadAll();
-				std::stringstream mtlSS(allText);
 
-				tinyobj::MaterialStreamReader msr(mtlSS);
+				if (!ok)
+				{
+					chunk->m_errorLine = OBJLine{ lineBegin, lineEnd };
+					return;
+				}
+				lineBegin = lineEnd != chunk->m_end ? lineEnd + 1 : lineEnd;
+			}
+		}
 
-				if (!msr(matId, materials, matMap, err))
+		// MTL ファイルが見つからない場合は、OBJ と同じ名前の MTL ファイルを試す
+		bool LoadMTLFile(
+			const std::string&					objPath,
+			const std::string&					matId,
+			std::vector<tinyobj::material_t>*	materials,
+			std::map<std::string, int>*			materialMap
+		)
+		{
+			std::string fileDir = PathUtil::GetDirectoryName(objPath);
+			std::string mtlPath = PathUtil::Combine(fileDir, matId);
+			TextFileReader fr;
+			if (!fr.Open(mtlPath))
+			{
+				SABA_WARN("Failed to open MTL file.");
+				SABA_INFO("Try obj name + .mtl.");
+				std::string objFileName = PathUtil::GetFilenameWithoutExt(objPath);
+				mtlPath = PathUtil::Combine(fileDir, objFileName + ".mtl");
+				if (!fr.Open(mtlPath))
 				{
+					SABA_WARN("Failed to open MTL file.");
 					return false;
 				}
-				return true;
 			}
+			std::string allText = fr.ReadAll();
+			std::stringstream mtlSS(allText);
 
-		private:
-			std::string	m_objPath;
-		};
+			std::string warning;
+			tinyobj::LoadMtl(materialMap, materials, &mtlSS, &warning);
+			if (!warning.empty())
+			{
+				SABA_WARN("MTL : {}", warning);
+			}
+			return true;
+		}
 	}
 
 	bool OBJModel::Load(const char * filepath)
 	{
 		SABA_INFO("Open OBJ file. {}", filepath);
 
-		TextFileReader textFileReader;
-		if (!textFileReader.Open(filepath))
+		MappedFile file;
+		if (!file.Open(filepath))
 		{
 			SABA_WARN("Failed to open OBJ file. {}", filepath);
 			return false;
 		}
+		const char* data = (const char*)file.GetData();
+		const size_t dataSize = data != nullptr ? file.GetSize() : 0;
 
-		tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> shapes;
+		// 行の境界でチャンクに分けて、チャンクごとに並列に読む
+		std::vector<OBJChunk> chunks(std::max(dataSize / OBJChunkSize, size_t(1)));
+		const char* chunkBegin = data;
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			const char* chunkEnd = data + dataSize;
+			if (i + 1 < chunks.size())
+			{
+				chunkEnd = std::max(data + dataSize / chunks.size() * (i + 1), chunkBegin);
+				chunkEnd = FindLineEnd(chunkEnd, data + dataSize);
+				chunkEnd = chunkEnd != data + dataSize ? chunkEnd + 1 : chunkEnd;
+			}
+			chunks[i].m_begin = chunkBegin;
+			chunks[i].m_end = chunkEnd;
+			chunkBegin = chunkEnd;
+		}
+
+		auto threadPool = Singleton<ThreadPool>::Get();
+		threadPool->ParallelFor(chunks.size(), 1, [&chunks](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				CountChunk(&chunks[i]);
+			}
+		});
+
+		size_t posCount = 0;
+		size_t norCount = 0;
+		size_t uvCount = 0;
+		size_t faceCount = 0;
+		for (auto& chunk : chunks)
+		{
+			chunk.m_positionOffset = posCount;
+			chunk.m_normalOffset = norCount;
+			chunk.m_uvOffset = uvCount;
+			chunk.m_faceOffset = faceCount;
+			posCount += chunk.m_positionCount;
+			norCount += chunk.m_normalCount;
+			uvCount += chunk.m_uvCount;
+			faceCount += chunk.m_faceCount;
+		}
+		if (std::max(std::max(posCount, norCount), uvCount) > size_t(std::numeric_limits<int>::max()))
+		{
+			SABA_WARN("Too many vertices. {}", filepath);
+			return false;
+		}
+
+		// mtllib は先頭から順に読む (1 行に複数ある場合は、読めたところまで)
 		std::vector<tinyobj::material_t> materials;
-		std::string err;
+		std::map<std::string, int> materialMap;
+		for (const auto& chunk : chunks)
+		{
+			for (const auto& mtlLib : chunk.m_mtlLibs)
+			{
+				const char* p = SkipBlank(mtlLib.m_begin, mtlLib.m_end);
+				bool found = p == mtlLib.m_end;
+				while (!found && p != mtlLib.m_end)
+				{
+					const char* nameEnd = SkipToken(p, mtlLib.m_end);
+					found = LoadMTLFile(filepath, std::string(p, nameEnd), &materials, &materialMap);
+					p = SkipBlank(nameEnd, mtlLib.m_end);
+				}
+				if (!found)
+				{
+					SABA_WARN("Failed to load material file(s). Use default material.");
+				}
+			}
+		}
 
-		std::string allText = textFileReader.ReadAll();
-		std::stringstream objSS(allText);
-		SabaMaterialReader smr(filepath);
-		auto ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, &objSS, &smr, true);
+		// 各チャンクの先頭で有効な材質は、それより前の最後の usemtl
+		int material = -1;
+		for (auto& chunk : chunks)
+		{
+			chunk.m_material = material;
+			if (chunk.m_lastUseMtl.m_begin != nullptr)
+			{
+				material = FindMaterial(materialMap, chunk.m_lastUseMtl.m_begin, chunk.m_lastUseMtl.m_end);
+			}
+		}
 
-		std::string fileDir = PathUtil::GetDirectoryName(filepath);
-		fileDir += PathUtil::GetDelimiter();
+		m_positions.resize(posCount);
+		m_normals.resize(norCount);
+		m_uvs.resize(uvCount);
+		m_faces.resize(faceCount);
+
+		OBJParseContext ctxt;
+		ctxt.m_materialMap = &materialMap;
+		ctxt.m_emptyMaterial = int(materials.size());
+		ctxt.m_positions = m_positions.data();
+		ctxt.m_normals = m_normals.data();
+		ctxt.m_uvs = m_uvs.data();
+		ctxt.m_faces = m_faces.data();
+		threadPool->ParallelFor(chunks.size(), 1, [&chunks, &ctxt](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				ParseChunk(&chunks[i], ctxt);
+			}
+		});
 
-		if (!ret)
+		bool useEmptyMaterial = false;
+		for (const auto& chunk : chunks)
 		{
-			SABA_WARN("Failed to load OBJ file. {}", filepath);
-			return false;
+			if (chunk.m_errorLine.m_begin != nullptr)
+			{
+				const char* lineEnd = chunk.m_errorLine.m_end;
+				while (lineEnd != chunk.m_errorLine.m_begin && IsBlank(lineEnd[-1]))
+				{
+					lineEnd--;
+				}
+				SABA_WARN("Failed to parse OBJ line. [{}]", std::string(chunk.m_errorLine.m_begin, lineEnd));
+				SABA_WARN("OBJ File Fail. {}", filepath);
+				return false;
+			}
+			useEmptyMaterial = useEmptyMaterial || chunk.m_useEmptyMaterial;
 		}
 
+		std::string fileDir = PathUtil::GetDirectoryName(filepath);
+		fileDir += PathUtil::GetDelimiter();
+
 		// Materialをコピー
 		m_materials.clear();
 		m_materials.reserve(materials.size());
@@ -143,32 +571,6 @@ namespace saba
 			m_materials.push_back(mat);
 		}
 
-		// Meshを作成
-		size_t posCount = attrib.vertices.size() / 3;
-		size_t norCount = attrib.normals.size() / 3;
-		size_t uvCount = attrib.texcoords.size() / 2;
-		m_positions.resize(posCount);
-		m_normals.resize(norCount);
-		m_uvs.resize(uvCount);
-
-		for (size_t posIdx = 0; posIdx < posCount; posIdx++)
-		{
-			m_positions[posIdx].x = attrib.vertices[posIdx * 3 + 0];
-			m_positions[posIdx].y = attrib.vertices[posIdx * 3 + 1];
-			m_positions[posIdx].z = attrib.vertices[posIdx * 3 + 2];
-		}
-		for (size_t norIdx = 0; norIdx < norCount; norIdx++)
-		{
-			m_normals[norIdx].x = attrib.normals[norIdx * 3 + 0];
-			m_normals[norIdx].y = attrib.normals[norIdx * 3 + 1];
-			m_normals[norIdx].z = attrib.normals[norIdx * 3 + 2];
-		}
-		for (size_t uvIdx = 0; uvIdx < uvCount; uvIdx++)
-		{
-			m_uvs[uvIdx].x = attrib.texcoords[uvIdx * 2 + 0];
-			m_uvs[uvIdx].y = 1.0f - attrib.texcoords[uvIdx * 2 + 1];
-		}
-
 		if (!m_positions.empty())
 		{
 			m_bboxMin = glm::vec3(std::numeric_limits<float>::max());
@@ -185,57 +587,27 @@ namespace saba
 			m_bboxMax = glm::vec3(0);
 		}
 
-		int emptyMatIdx = -1;
-		for (const auto& shape : shapes)
+		if (useEmptyMaterial)
 		{
-			int indexOffset = 0;
-			for (size_t faceIdx = 0; faceIdx < shape.mesh.num_face_vertices.size(); faceIdx++)
-			{
-				auto numFaceVertices = shape.mesh.num_face_vertices[faceIdx];
-				if (numFaceVertices != 3)
-				{
-					SABA_WARN("[num_face_vertices] != 3");
-					SABA_WARN("OBJ File Fail. {}", filepath);
-					return false;
-				}
-
-				auto vi0 = shape.mesh.indices[indexOffset + 0];
-				auto vi1 = shape.mesh.indices[indexOffset + 1];
-				auto vi2 = shape.mesh.indices[indexOffset + 2];
-				auto material = shape.mesh.material_ids[faceIdx];
-
-				if (material == -1)
-				{
-					if (emptyMatIdx == -1)
-					{
-						SABA_INFO("Material Not Assigned.");
-						Material emptyMat;
-						emptyMatIdx = (int)m_materials.size();
-						emptyMat.m_ambient = glm::vec3(0.2f);
-						emptyMat.m_diffuse = glm::vec3(0.5f);
-						emptyMat.m_specularPower = 1.0f;
-						m_materials.push_back(emptyMat);
-					}
-					material = emptyMatIdx;
-				}
-
-				Face face;
-				face.m_position[0] = vi0.vertex_index;
-				face.m_position[1] = vi1.vertex_index;
-				face.m_position[2] = vi2.vertex_index;
-				face.m_normal[0] = vi0.normal_index;
-				face.m_normal[1] = vi1.normal_index;
-				face.m_normal[2] = vi2.normal_index;
-				face.m_uv[0] = vi0.texcoord_index;
-				face.m_uv[1] = vi1.texcoord_index;
-				face.m_uv[2] = vi2.texcoord_index;
-				face.m_material = material;
-
-				m_faces.emplace_back(std::move(face));
+			SABA_INFO("Material Not Assigned.");
+			Material emptyMat;
+			emptyMat.m_ambient = glm::vec3(0.2f);
+			emptyMat.m_diffuse = glm::vec3(0.5f);
+			emptyMat.m_specularPower = 1.0f;
+			m_materials.push_back(emptyMat);
+		}
 
-				indexOffset += 3;
-			}
+		if (!BuildIndexedMesh(
+			m_positions.data(), m_positions.size(),
+			m_normals.data(), m_normals.size(),
+			m_uvs.data(), m_uvs.size(),
+			m_faces.data(), m_faces.size(),
+			&m_mesh))
+		{
+			SABA_WARN("OBJ File Fail. {}", filepath);
+			return false;
 		}
+		SABA_INFO("OBJ Mesh : Vertex {} (Face Vertex {})", m_mesh.m_positions.size(), m_mesh.m_indices.size());
 
 		SABA_INFO("OBJ File Success. {}", filepath);
 		return true;
@@ -248,6 +620,7 @@ namespace saba
 		m_uvs.clear();
 		m_materials.clear();
 		m_faces.clear();
+		m_mesh = IndexedMesh();
 	}
 
 }
@@ -6,6 +6,8 @@
 #ifndef SABA_MODEL_OBJ_OBJMODEL_H_
 #define SABA_MODEL_OBJ_OBJMODEL_H_
 
+#include "../MeshUtil.h"
+
 #include <vector>
 #include <string>
 #include <glm/vec2.hpp>
@@ -32,13 +34,7 @@ namespace saba
 			std::string	m_transparencyTex;
 		};
 
-		struct Face
-		{
-			int	m_position[3];
-			int	m_normal[3];
-			int	m_uv[3];
-			int m_material;
-		};
+		using Face = MeshFace;
 
 	public:
 		bool Load(const char* filepath);
@@ -49,6 +45,8 @@ namespace saba
 		const std::vector<glm::vec2>& GetUVs() const { return m_uvs; }
 		const std::vector<Material>& GetMaterials() const { return m_materials; }
 		const std::vector<Face>& GetFaces() const { return m_faces; }
+		// Load で面から作るインデックス付きのメッシュ
+		const IndexedMesh& GetMesh() const { return m_mesh; }
 
 		const glm::vec3& GetBBoxMin() const { return m_bboxMin; }
 		const glm::vec3& GetBBoxMax() const { return m_bboxMax; }
@@ -63,6 +61,7 @@ namespace saba
 
 		std::vector<Material>	m_materials;
 		std::vector<Face>		m_faces;
+		IndexedMesh				m_mesh;
 	};
 }
 
@@ -212,6 +212,17 @@ namespace saba
 
 					mesh->m_faces.emplace_back(face);
 				}
+
+				if (!BuildIndexedMesh(
+					mesh->m_positions.data(), mesh->m_positions.size(),
+					mesh->m_normals.data(), mesh->m_normals.size(),
+					mesh->m_uvs.data(), mesh->m_uvs.size(),
+					mesh->m_faces.data(), mesh->m_faces.size(),
+					&mesh->m_indexedMesh))
+				{
+					SABA_ERROR("XFile mesh build error.");
+					return false;
+				}
 			}
 		}
 
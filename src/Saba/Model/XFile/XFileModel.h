@@ -7,6 +7,8 @@
 #ifndef SABA_MODEL_XFILE_OBJMODEL_H_
 #define SABA_MODEL_XFILE_OBJMODEL_H_
 
+#include "../MeshUtil.h"
+
 #include <vector>
 #include <memory>
 #include <string>
@@ -39,13 +41,7 @@ namespace saba
 			std::string	m_spTexture;
 		};
 
-		struct Face
-		{
-			int	m_position[3];
-			int	m_normal[3];
-			int	m_uv[3];
-			int	m_material;
-		};
+		using Face = MeshFace;
 
 		struct Mesh
 		{
@@ -55,6 +51,7 @@ namespace saba
 			std::vector<glm::vec2>	m_uvs;
 			std::vector<Material>	m_materials;
 			std::vector<Face>		m_faces;
+			IndexedMesh				m_indexedMesh;	//!< m_faces から作るインデックス付きのメッシュ
 		};
 
 		struct Frame
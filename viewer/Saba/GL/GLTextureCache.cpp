@@ -0,0 +1,280 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "GLTextureCache.h"
+#include "GLTextureTranscoder.h"
+#include <Saba/Base/Path.h>
+#include <Saba/Base/Log.h>
+
+#include <vector>
+
+namespace saba
+{
+	namespace
+	{
+		const size_t DefaultMemoryBudget = 512 * 1024 * 1024;
+
+		// 区切り文字をそろえ、"." と ".." を取り除く
+		std::string CanonicalizePath(const std::string& filename)
+		{
+			std::string path = PathUtil::Normalize(filename);
+			const std::string delimiter = PathUtil::GetDelimiter();
+			const char delim = delimiter[0];
+
+			std::vector<std::string> parts;
+			size_t pos = 0;
+			while (pos <= path.size())
+			{
+				size_t next = path.find(delim, pos);
+				if (next == std::string::npos)
+				{
+					next = path.size();
+				}
+				std::string part = path.substr(pos, next - pos);
+				if (part == "..")
+				{
+					if (!parts.empty() && parts.back() != ".." && !parts.back().empty())
+					{
+						parts.pop_back();
+					}
+					else
+					{
+						parts.push_back(part);
+					}
+				}
+				else if (part != "." && !(part.empty() && !parts.empty()))
+				{
+					parts.push_back(part);
+				}
+				pos = next + 1;
+			}
+
+			std::string result;
+			for (size_t i = 0; i < parts.size(); i++)
+			{
+				if (i != 0)
+				{
+					result += delim;
+				}
+				result += parts[i];
+			}
+			if (parts.size() == 1 && parts[0].empty())
+			{
+				result = delimiter;
+			}
+#if _WIN32
+			for (auto& ch : result)
+			{
+				if ('A' <= ch && ch <= 'Z')
+				{
+					ch = ch - 'A' + 'a';
+				}
+			}
+#endif // _WIN32
+			return result;
+		}
+
+		size_t EstimateMemorySize(const TextureImage& image, bool genMipMap)
+		{
+			size_t size = image.m_data.size();
+			if (image.m_format != TextureImage::Format::DDS && genMipMap)
+			{
+				// ミップマップ分 (約 1/3)
+				size += size / 3;
+			}
+			return size;
+		}
+	}
+
+	GLTextureCache::GLTextureCache()
+		: m_memorySize(0)
+		, m_memoryBudget(DefaultMemoryBudget)
+		, m_useDiskCache(false)
+		, m_useCompression(false)
+		, m_hitCount(0)
+		, m_missCount(0)
+		, m_evictCount(0)
+	{
+	}
+
+	GLTextureCache::~GLTextureCache()
+	{
+		if (!m_entries.empty())
+		{
+			SABA_WARN("GLTextureCache is not cleared. [{}]", m_entries.size());
+		}
+	}
+
+	std::string GLTextureCache::MakeKey(const std::string & filename, bool genMipMap, bool rgba)
+	{
+		return CanonicalizePath(filename) + ":" +
+			std::to_string(genMipMap) + ":" +
+			std::to_string(rgba);
+	}
+
+	GLTextureRef GLTextureCache::Get(const std::string & filename, bool genMipMap, bool rgba)
+	{
+		std::string key = MakeKey(filename, genMipMap, rgba);
+		auto tex = Find(key);
+		if (tex != 0)
+		{
+			return tex;
+		}
+
+		TextureImage image;
+		if (!LoadImage(&image, filename, rgba))
+		{
+			SABA_WARN("LoadTexture: [{}] Fail", filename);
+			return GLTextureRef();
+		}
+		GLTextureRef newTex = CreateTextureFromImage(image, genMipMap);
+		if (newTex == 0)
+		{
+			SABA_WARN("LoadTexture: [{}] Fail", filename);
+			return GLTextureRef();
+		}
+		SABA_INFO("LoadTexture: [{}] Success", filename);
+		return Insert(key, std::move(newTex), EstimateMemorySize(image, genMipMap));
+	}
+
+	GLTextureRef GLTextureCache::Add(const std::string & filename, bool genMipMap, bool rgba, const TextureImage & image)
+	{
+		std::string key = MakeKey(filename, genMipMap, rgba);
+		auto tex = Find(key);
+		if (tex != 0)
+		{
+			return tex;
+		}
+
+		GLTextureRef newTex = CreateTextureFromImage(image, genMipMap);
+		if (newTex == 0)
+		{
+			return GLTextureRef();
+		}
+		return Insert(key, std::move(newTex), EstimateMemorySize(image, genMipMap));
+	}
+
+	bool GLTextureCache::LoadImage(TextureImage * image, const std::string & filename, bool rgba) const
+	{
+		// BC1 / BC3 は RGBA に展開できないので、rgba を指定された場合は変換しない
+		if (m_useCompression && !rgba)
+		{
+			return LoadTextureImageFromFileCompressed(image, filename, m_useDiskCache);
+		}
+		if (m_useDiskCache)
+		{
+			return LoadTextureImageFromFileCached(image, filename, rgba);
+		}
+		return LoadTextureImageFromFile(image, filename, rgba);
+	}
+
+	bool GLTextureCache::Contains(const std::string & filename, bool genMipMap, bool rgba) const
+	{
+		std::string key = MakeKey(filename, genMipMap, rgba);
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_entries.find(key) != m_entries.end();
+	}
+
+	GLTextureRef GLTextureCache::Find(const std::string & key)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto findIt = m_entries.find(key);
+		if (findIt == m_entries.end())
+		{
+			m_missCount++;
+			return GLTextureRef();
+		}
+
+		auto& entry = findIt->second;
+		m_lru.splice(m_lru.begin(), m_lru, entry.m_lruIt);
+		m_hitCount++;
+		return entry.m_texture;
+	}
+
+	GLTextureRef GLTextureCache::Insert(const std::string & key, GLTextureRef texture, size_t memorySize)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto findIt = m_entries.find(key);
+		if (findIt != m_entries.end())
+		{
+			// 読み込み中に他で登録された
+			m_lru.splice(m_lru.begin(), m_lru, findIt->second.m_lruIt);
+			return findIt->second.m_texture;
+		}
+
+		// 新しく追加するテクスチャ分の空きを作る
+		EvictLocked(m_memoryBudget > memorySize ? m_memoryBudget - memorySize : 0);
+
+		m_lru.push_front(key);
+		Entry entry;
+		entry.m_texture = texture;
+		entry.m_memorySize = memorySize;
+		entry.m_lruIt = m_lru.begin();
+		m_entries.emplace(key, std::move(entry));
+		m_memorySize += memorySize;
+		return texture;
+	}
+
+	void GLTextureCache::SetMemoryBudget(size_t budget)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_memoryBudget = budget;
+		EvictLocked(m_memoryBudget);
+	}
+
+	void GLTextureCache::Evict()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		EvictLocked(m_memoryBudget);
+	}
+
+	void GLTextureCache::EvictLocked(size_t budget)
+	{
+		auto lruIt = m_lru.end();
+		while (m_memorySize > budget && lruIt != m_lru.begin())
+		{
+			--lruIt;
+			auto findIt = m_entries.find(*lruIt);
+			// キャッシュ以外から参照されているものは破棄しない
+			if (findIt->second.m_texture.GetRefCount() > 1)
+			{
+				continue;
+			}
+			m_memorySize -= findIt->second.m_memorySize;
+			m_entries.erase(findIt);
+			lruIt = m_lru.erase(lruIt);
+			m_evictCount++;
+		}
+	}
+
+	void GLTextureCache::Clear()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_entries.clear();
+		m_lru.clear();
+		m_memorySize = 0;
+	}
+
+	GLTextureCache::Stats GLTextureCache::GetStats() const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		Stats stats;
+		stats.m_hitCount = m_hitCount;
+		stats.m_missCount = m_missCount;
+		stats.m_evictCount = m_evictCount;
+		stats.m_textureCount = m_entries.size();
+		stats.m_memorySize = m_memorySize;
+		stats.m_memoryBudget = m_memoryBudget;
+		return stats;
+	}
+
+	void GLTextureCache::ResetStats()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_hitCount = 0;
+		m_missCount = 0;
+		m_evictCount = 0;
+	}
+}
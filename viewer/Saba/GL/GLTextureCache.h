@@ -0,0 +1,99 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_GL_TEXTURECACHE_H_
+#define SABA_GL_TEXTURECACHE_H_
+
+#include "GLObject.h"
+#include "GLTextureUtil.h"
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace saba
+{
+	/*
+		プロセス全体で共有するテクスチャキャッシュ (Singleton<GLTextureCache>::Get()).
+		キーはファイルパスの正規化とオプションで作る.
+		どのモデルからも参照されていないテクスチャは、メモリ量が予算を超えたら古い順に破棄する.
+		GL オブジェクトの作成は GL コンテキストのスレッドで行うこと. Contains はどのスレッドからも呼べる.
+	*/
+	class GLTextureCache
+	{
+	public:
+		GLTextureCache();
+		~GLTextureCache();
+
+		GLTextureCache(const GLTextureCache&) = delete;
+		GLTextureCache& operator = (const GLTextureCache&) = delete;
+
+		struct Stats
+		{
+			size_t	m_hitCount;
+			size_t	m_missCount;
+			size_t	m_evictCount;
+			size_t	m_textureCount;
+			size_t	m_memorySize;		//!< キャッシュしているテクスチャの推定メモリ量 (byte)
+			size_t	m_memoryBudget;
+		};
+
+		// キャッシュになければファイルから読み込む
+		GLTextureRef Get(const std::string& filename, bool genMipMap = true, bool rgba = false);
+		// デコード済みの画像から作成して登録する (既に登録済みならそれを返す)
+		GLTextureRef Add(const std::string& filename, bool genMipMap, bool rgba, const TextureImage& image);
+		bool Contains(const std::string& filename, bool genMipMap = true, bool rgba = false) const;
+
+		// デコード済みの画像をディスクにキャッシュする (LoadTextureImageFromFileCached)
+		void EnableDiskCache(bool enable) { m_useDiskCache = enable; }
+		bool IsDiskCacheEnabled() const { return m_useDiskCache; }
+		// ミップマップ付きの BC1 / BC3 に変換して読み込む (LoadTextureImageFromFileCompressed). rgba を指定した読み込みは変換しない
+		void EnableCompression(bool enable) { m_useCompression = enable; }
+		bool IsCompressionEnabled() const { return m_useCompression; }
+		// 設定に従って画像をデコードする. GL を使わないのでどのスレッドからも呼べる
+		bool LoadImage(TextureImage* image, const std::string& filename, bool rgba = false) const;
+
+		void SetMemoryBudget(size_t budget);
+		size_t GetMemoryBudget() const { return m_memoryBudget; }
+
+		// 参照されていないテクスチャを予算内に収まるまで破棄する
+		void Evict();
+		// GL コンテキストを破棄する前に呼ぶこと
+		void Clear();
+
+		Stats GetStats() const;
+		void ResetStats();
+
+	private:
+		struct Entry
+		{
+			GLTextureRef						m_texture;
+			size_t								m_memorySize;
+			std::list<std::string>::iterator	m_lruIt;
+		};
+
+		static std::string MakeKey(const std::string& filename, bool genMipMap, bool rgba);
+		GLTextureRef Find(const std::string& key);
+		GLTextureRef Insert(const std::string& key, GLTextureRef texture, size_t memorySize);
+		void EvictLocked(size_t budget);
+
+	private:
+		mutable std::mutex						m_mutex;
+		std::unordered_map<std::string, Entry>	m_entries;
+		std::list<std::string>					m_lru;	//!< 先頭が最近使ったもの
+		size_t									m_memorySize;
+		size_t									m_memoryBudget;
+		std::atomic<bool>						m_useDiskCache;
+		std::atomic<bool>						m_useCompression;
+
+		size_t	m_hitCount;
+		size_t	m_missCount;
+		size_t	m_evictCount;
+	};
+}
+
+#endif // !SABA_GL_TEXTURECACHE_H_
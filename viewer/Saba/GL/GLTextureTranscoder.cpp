@@ -0,0 +1,453 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "GLTextureTranscoder.h"
+#include <Saba/Base/File.h>
+#include <Saba/Base/Path.h>
+#include <Saba/Base/Log.h>
+#include <Saba/Base/Singleton.h>
+#include <Saba/Base/ThreadPool.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+#include <tinyddsloader.h>
+
+namespace saba
+{
+	namespace
+	{
+		using DDSHeader = tinyddsloader::DDSFile::Header;
+
+		const uint32_t DDSFlagCaps = 0x00000001;
+		const uint32_t DDSFlagPixelFormat = 0x00001000;
+		const uint32_t DDSCapsComplex = 0x00000008;
+		const uint32_t DDSCapsTexture = 0x00001000;
+		const uint32_t DDSCapsMipmap = 0x00400000;
+
+		// DDS ヘッダーの m_reserved1 に書き込む変換元の情報
+		const uint32_t TranscodeStampVersion = 1;
+
+		struct TranscodeStamp
+		{
+			uint32_t	m_magic;		//!< "SABA"
+			uint32_t	m_version;
+			int64_t		m_sourceSize;
+			int64_t		m_sourceTime;
+		};
+		static_assert(sizeof(TranscodeStamp) <= sizeof(DDSHeader::m_reserved1), "TranscodeStamp is too large.");
+
+		uint32_t MakeFourCC(char ch0, char ch1, char ch2, char ch3)
+		{
+			return uint32_t(uint8_t(ch0)) |
+				(uint32_t(uint8_t(ch1)) << 8) |
+				(uint32_t(uint8_t(ch2)) << 16) |
+				(uint32_t(uint8_t(ch3)) << 24);
+		}
+
+		bool IsPowerOfTwo(int value)
+		{
+			return value > 0 && (value & (value - 1)) == 0;
+		}
+
+		// R8G8B8A8 で上の行から並ぶ画像
+		struct MipLevel
+		{
+			int						m_width = 0;
+			int						m_height = 0;
+			std::vector<uint8_t>	m_pixels;
+		};
+
+		void MakeTopLevel(const TextureImage& image, MipLevel* level)
+		{
+			const size_t srcPixelSize = image.m_format == TextureImage::Format::R8G8B8A8 ? 4 : 3;
+			level->m_width = image.m_width;
+			level->m_height = image.m_height;
+			level->m_pixels.resize(size_t(image.m_width) * size_t(image.m_height) * 4);
+			for (int y = 0; y < image.m_height; y++)
+			{
+				const uint8_t* src = image.m_data.data() + srcPixelSize * image.m_width * (image.m_height - y - 1);
+				uint8_t* dst = level->m_pixels.data() + size_t(4) * image.m_width * y;
+				for (int x = 0; x < image.m_width; x++)
+				{
+					dst[0] = src[0];
+					dst[1] = src[1];
+					dst[2] = src[2];
+					dst[3] = srcPixelSize == 4 ? src[3] : 255;
+					src += srcPixelSize;
+					dst += 4;
+				}
+			}
+		}
+
+		bool HasTransparentPixel(const MipLevel& level)
+		{
+			for (size_t i = 3; i < level.m_pixels.size(); i += 4)
+			{
+				if (level.m_pixels[i] != 255)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// 2x2 の平均で縮小する (奇数の場合は端のピクセルを繰り返す)
+		void DownSample(const MipLevel& src, MipLevel* dst)
+		{
+			dst->m_width = std::max(src.m_width / 2, 1);
+			dst->m_height = std::max(src.m_height / 2, 1);
+			dst->m_pixels.resize(size_t(dst->m_width) * size_t(dst->m_height) * 4);
+			for (int y = 0; y < dst->m_height; y++)
+			{
+				int y0 = std::min(y * 2, src.m_height - 1);
+				int y1 = std::min(y * 2 + 1, src.m_height - 1);
+				for (int x = 0; x < dst->m_width; x++)
+				{
+					int x0 = std::min(x * 2, src.m_width - 1);
+					int x1 = std::min(x * 2 + 1, src.m_width - 1);
+					const uint8_t* p00 = &src.m_pixels[(size_t(y0) * src.m_width + x0) * 4];
+					const uint8_t* p01 = &src.m_pixels[(size_t(y0) * src.m_width + x1) * 4];
+					const uint8_t* p10 = &src.m_pixels[(size_t(y1) * src.m_width + x0) * 4];
+					const uint8_t* p11 = &src.m_pixels[(size_t(y1) * src.m_width + x1) * 4];
+					uint8_t* d = &dst->m_pixels[(size_t(y) * dst->m_width + x) * 4];
+					for (int c = 0; c < 4; c++)
+					{
+						d[c] = uint8_t((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+					}
+				}
+			}
+		}
+
+		size_t GetCompressedLevelSize(int width, int height, bool alpha)
+		{
+			size_t blockCount = size_t((width + 3) / 4) * size_t((height + 3) / 4);
+			return blockCount * (alpha ? 16 : 8);
+		}
+
+		size_t GetCompressedDataSize(int width, int height, uint32_t mipCount, bool alpha)
+		{
+			size_t size = sizeof(tinyddsloader::DDSFile::Magic) + sizeof(DDSHeader);
+			for (uint32_t mip = 0; mip < mipCount; mip++)
+			{
+				size += GetCompressedLevelSize(width, height, alpha);
+				width = std::max(width / 2, 1);
+				height = std::max(height / 2, 1);
+			}
+			return size;
+		}
+
+		// stb_dxt のテーブルの初期化はスレッドセーフではないので、最初の 1 回だけは排他する
+		void InitializeDXT()
+		{
+			static std::once_flag initFlag;
+			std::call_once(initFlag, []()
+			{
+				uint8_t block[16 * 4] = {};
+				uint8_t dst[16];
+				stb_compress_dxt_block(dst, block, 0, STB_DXT_NORMAL);
+			});
+		}
+
+		void CompressLevel(const MipLevel& level, bool alpha, uint8_t* dst)
+		{
+			const int blockCountX = (level.m_width + 3) / 4;
+			const int blockCountY = (level.m_height + 3) / 4;
+			const size_t blockSize = alpha ? 16 : 8;
+			auto compressRows = [&](size_t begin, size_t end)
+			{
+				uint8_t block[16 * 4];
+				for (size_t by = begin; by < end; by++)
+				{
+					uint8_t* blockDst = dst + blockSize * blockCountX * by;
+					for (int bx = 0; bx < blockCountX; bx++)
+					{
+						// 端のブロックは最後の行、列を繰り返して埋める
+						for (int py = 0; py < 4; py++)
+						{
+							int y = std::min(int(by) * 4 + py, level.m_height - 1);
+							for (int px = 0; px < 4; px++)
+							{
+								int x = std::min(bx * 4 + px, level.m_width - 1);
+								memcpy(&block[(py * 4 + px) * 4], &level.m_pixels[(size_t(y) * level.m_width + x) * 4], 4);
+							}
+						}
+						stb_compress_dxt_block(blockDst, block, alpha ? 1 : 0, STB_DXT_NORMAL);
+						blockDst += blockSize;
+					}
+				}
+			};
+
+			// 小さいミップレベルはタスクに分けない
+			if (blockCountX * blockCountY < 256)
+			{
+				compressRows(0, blockCountY);
+			}
+			else
+			{
+				size_t grainSize = std::max<size_t>(1, 256 / blockCountX);
+				Singleton<ThreadPool>::Get()->ParallelFor(blockCountY, grainSize, compressRows);
+			}
+		}
+
+		bool ReadCompressedTexture(TextureImage* image, const std::string& ddsPath, const FileStatus& sourceStatus, TextureCompression compression)
+		{
+			File file;
+			if (!file.Open(ddsPath))
+			{
+				return false;
+			}
+
+			std::vector<uint8_t> data;
+			if (!file.ReadAll(&data))
+			{
+				return false;
+			}
+			if (data.size() < sizeof(tinyddsloader::DDSFile::Magic) + sizeof(DDSHeader) ||
+				memcmp(data.data(), tinyddsloader::DDSFile::Magic, sizeof(tinyddsloader::DDSFile::Magic)) != 0)
+			{
+				return false;
+			}
+
+			DDSHeader header;
+			memcpy(&header, data.data() + sizeof(tinyddsloader::DDSFile::Magic), sizeof(header));
+			TranscodeStamp stamp;
+			memcpy(&stamp, header.m_reserved1, sizeof(stamp));
+			if (stamp.m_magic != MakeFourCC('S', 'A', 'B', 'A') ||
+				stamp.m_version != TranscodeStampVersion ||
+				stamp.m_sourceSize != sourceStatus.m_size ||
+				stamp.m_sourceTime != sourceStatus.m_lastWriteTime)
+			{
+				return false;
+			}
+			const bool alpha = header.m_pixelFormat.m_fourCC == MakeFourCC('D', 'X', 'T', '5');
+			if ((!alpha && header.m_pixelFormat.m_fourCC != MakeFourCC('D', 'X', 'T', '1')) ||
+				data.size() != GetCompressedDataSize(int(header.m_width), int(header.m_height), header.m_mipMapCount, alpha))
+			{
+				SABA_WARN("Compressed texture is broken. [{}]", ddsPath);
+				return false;
+			}
+			// 指定された形式と違う場合は変換し直す (Auto はどちらでも良い)
+			if ((compression == TextureCompression::BC1 && alpha) ||
+				(compression == TextureCompression::BC3 && !alpha))
+			{
+				return false;
+			}
+
+			image->m_format = TextureImage::Format::DDS;
+			image->m_width = 0;
+			image->m_height = 0;
+			image->m_data = std::move(data);
+			return true;
+		}
+
+		bool WriteCompressedTexture(const TextureImage& dds, const std::string& ddsPath)
+		{
+			// 他のプロセスが読み込み中でも壊れないように、一時ファイルに書き出してから置き換える
+			std::string tempPath = ddsPath + ".tmp";
+			{
+				File file;
+				if (!file.Create(tempPath) ||
+					!file.Write(dds.m_data.data(), dds.m_data.size()))
+				{
+					file.Close();
+					std::remove(tempPath.c_str());
+					return false;
+				}
+			}
+#if _WIN32
+			std::remove(ddsPath.c_str());
+#endif // _WIN32
+			if (std::rename(tempPath.c_str(), ddsPath.c_str()) != 0)
+			{
+				std::remove(tempPath.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		void SetTranscodeStamp(TextureImage* dds, const FileStatus& sourceStatus)
+		{
+			TranscodeStamp stamp;
+			stamp.m_magic = MakeFourCC('S', 'A', 'B', 'A');
+			stamp.m_version = TranscodeStampVersion;
+			stamp.m_sourceSize = sourceStatus.m_size;
+			stamp.m_sourceTime = sourceStatus.m_lastWriteTime;
+			memcpy(dds->m_data.data() + sizeof(tinyddsloader::DDSFile::Magic) + offsetof(DDSHeader, m_reserved1), &stamp, sizeof(stamp));
+		}
+
+		bool IsTranscodeTarget(const std::string& filename, FileStatus* status)
+		{
+			return PathUtil::GetExt(filename) != "dds" && GetFileStatus(filename, status);
+		}
+	}
+
+	bool CanCompressTextureImage(const TextureImage& image)
+	{
+		if (image.m_format != TextureImage::Format::R8G8B8 &&
+			image.m_format != TextureImage::Format::R8G8B8A8)
+		{
+			return false;
+		}
+		if (image.m_width <= 0 || !IsPowerOfTwo(image.m_height))
+		{
+			return false;
+		}
+		const size_t pixelSize = image.m_format == TextureImage::Format::R8G8B8A8 ? 4 : 3;
+		return image.m_data.size() == size_t(image.m_width) * size_t(image.m_height) * pixelSize;
+	}
+
+	bool CompressTextureImage(const TextureImage& image, TextureCompression compression, TextureImage* dds)
+	{
+		if (!CanCompressTextureImage(image))
+		{
+			return false;
+		}
+
+		InitializeDXT();
+
+		std::vector<MipLevel> levels(1);
+		MakeTopLevel(image, &levels[0]);
+		while (levels.back().m_width > 1 || levels.back().m_height > 1)
+		{
+			MipLevel next;
+			DownSample(levels.back(), &next);
+			levels.emplace_back(std::move(next));
+		}
+
+		bool alpha = compression == TextureCompression::BC3;
+		if (compression == TextureCompression::Auto)
+		{
+			alpha = HasTransparentPixel(levels[0]);
+		}
+
+		const size_t headerSize = sizeof(tinyddsloader::DDSFile::Magic) + sizeof(DDSHeader);
+		const size_t dataSize = GetCompressedDataSize(image.m_width, image.m_height, uint32_t(levels.size()), alpha);
+
+		DDSHeader header;
+		memset(&header, 0, sizeof(header));
+		header.m_size = sizeof(DDSHeader);
+		header.m_flags = DDSFlagCaps |
+			uint32_t(tinyddsloader::DDSFile::HeaderFlagBits::Height) |
+			uint32_t(tinyddsloader::DDSFile::HeaderFlagBits::Width) |
+			DDSFlagPixelFormat |
+			uint32_t(tinyddsloader::DDSFile::HeaderFlagBits::Mipmap) |
+			uint32_t(tinyddsloader::DDSFile::HeaderFlagBits::LinearSize);
+		header.m_height = uint32_t(image.m_height);
+		header.m_width = uint32_t(image.m_width);
+		header.m_pitchOrLinerSize = uint32_t(GetCompressedLevelSize(image.m_width, image.m_height, alpha));
+		header.m_depth = 0;
+		header.m_mipMapCount = uint32_t(levels.size());
+		header.m_pixelFormat.m_size = sizeof(tinyddsloader::DDSFile::PixelFormat);
+		header.m_pixelFormat.m_flags = uint32_t(tinyddsloader::DDSFile::PixelFormatFlagBits::FourCC);
+		header.m_pixelFormat.m_fourCC = alpha ? MakeFourCC('D', 'X', 'T', '5') : MakeFourCC('D', 'X', 'T', '1');
+		header.m_caps = DDSCapsTexture | DDSCapsMipmap | DDSCapsComplex;
+
+		dds->m_format = TextureImage::Format::DDS;
+		dds->m_width = 0;
+		dds->m_height = 0;
+		dds->m_data.resize(dataSize);
+		memcpy(dds->m_data.data(), tinyddsloader::DDSFile::Magic, sizeof(tinyddsloader::DDSFile::Magic));
+		memcpy(dds->m_data.data() + sizeof(tinyddsloader::DDSFile::Magic), &header, sizeof(header));
+
+		uint8_t* dst = dds->m_data.data() + headerSize;
+		for (const auto& level : levels)
+		{
+			CompressLevel(level, alpha, dst);
+			dst += GetCompressedLevelSize(level.m_width, level.m_height, alpha);
+		}
+		return true;
+	}
+
+	std::string GetCompressedTexturePath(const std::string& filename)
+	{
+		return filename + ".saba.dds";
+	}
+
+	bool LoadTextureImageFromFileCompressed(TextureImage* image, const std::string& filename, bool useDiskCache)
+	{
+		FileStatus status;
+		if (!IsTranscodeTarget(filename, &status))
+		{
+			return LoadTextureImageFromFile(image, filename);
+		}
+
+		std::string ddsPath = GetCompressedTexturePath(filename);
+		if (ReadCompressedTexture(image, ddsPath, status, TextureCompression::Auto))
+		{
+			return true;
+		}
+
+		TextureImage decoded;
+		bool loaded = useDiskCache ?
+			LoadTextureImageFromFileCached(&decoded, filename) :
+			LoadTextureImageFromFile(&decoded, filename);
+		if (!loaded)
+		{
+			return false;
+		}
+
+		if (!CompressTextureImage(decoded, TextureCompression::Auto, image))
+		{
+			*image = std::move(decoded);
+			return true;
+		}
+		SetTranscodeStamp(image, status);
+		if (!WriteCompressedTexture(*image, ddsPath))
+		{
+			SABA_WARN("Failed to write compressed texture. [{}]", ddsPath);
+		}
+		return true;
+	}
+
+	TranscodeResult TranscodeTextureFile(const std::string& filename, TextureCompression compression)
+	{
+		if (PathUtil::GetExt(filename) == "dds")
+		{
+			return TranscodeResult::Skipped;
+		}
+		FileStatus status;
+		if (!GetFileStatus(filename, &status))
+		{
+			SABA_WARN("Texture not found. [{}]", filename);
+			return TranscodeResult::Failed;
+		}
+
+		std::string ddsPath = GetCompressedTexturePath(filename);
+		TextureImage dds;
+		if (ReadCompressedTexture(&dds, ddsPath, status, compression))
+		{
+			return TranscodeResult::Succeeded;
+		}
+
+		TextureImage decoded;
+		if (!LoadTextureImageFromFile(&decoded, filename))
+		{
+			return TranscodeResult::Failed;
+		}
+		if (!CanCompressTextureImage(decoded))
+		{
+			SABA_INFO("Texture can not compress. [{}] ({}x{})", filename, decoded.m_width, decoded.m_height);
+			return TranscodeResult::Skipped;
+		}
+		if (!CompressTextureImage(decoded, compression, &dds))
+		{
+			return TranscodeResult::Failed;
+		}
+		SetTranscodeStamp(&dds, status);
+		if (!WriteCompressedTexture(dds, ddsPath))
+		{
+			SABA_WARN("Failed to write compressed texture. [{}]", ddsPath);
+			return TranscodeResult::Failed;
+		}
+		return TranscodeResult::Succeeded;
+	}
+}
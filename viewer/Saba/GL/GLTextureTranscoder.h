@@ -0,0 +1,60 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_GL_TEXTURETRANSCODER_H_
+#define SABA_GL_TEXTURETRANSCODER_H_
+
+#include "GLTextureUtil.h"
+
+#include <string>
+
+namespace saba
+{
+	/*
+		テクスチャをミップマップ付きの BC1 / BC3 (DXT1 / DXT5) に変換して DDS にする.
+		GL を使わないのでワーカースレッドや GL コンテキストの無いツールからも呼べる.
+
+		変換したファイルは <filename>.saba.dds として元の画像の隣に保存する.
+		DDS ヘッダーの予約領域に元の画像のサイズと更新時刻を記録し、一致しない場合は変換し直す.
+	*/
+	enum class TextureCompression
+	{
+		BC1,	//!< アルファを持たない
+		BC3,
+		Auto,	//!< 不透明でないピクセルがあれば BC3
+	};
+
+	/*
+		R8G8B8 / R8G8B8A8 の画像 (下の行から並ぶ) を変換して、image に TextureImage::Format::DDS で返す.
+		DDS は上の行から並べて保存する. (読み込み時に上下反転する)
+		ブロック単位の上下反転でずれないように、高さが 2 のべき乗でない画像は変換しない.
+	*/
+	bool CompressTextureImage(const TextureImage& image, TextureCompression compression, TextureImage* dds);
+	bool CanCompressTextureImage(const TextureImage& image);
+
+	std::string GetCompressedTexturePath(const std::string& filename);
+
+	/*
+		変換済みのファイルがあればそれを読み込み、無ければ変換して保存する.
+		変換できない画像 (DDS, HDR, 高さが 2 のべき乗でない) はデコードした画像をそのまま返す.
+		useDiskCache : デコードに LoadTextureImageFromFileCached を使う
+	*/
+	bool LoadTextureImageFromFileCompressed(TextureImage* image, const std::string& filename, bool useDiskCache = false);
+
+	enum class TranscodeResult
+	{
+		Succeeded,	//!< 変換した、または変換済みで更新が不要
+		Skipped,	//!< 変換できない画像 (DDS, HDR, 高さが 2 のべき乗でない)
+		Failed,
+	};
+
+	/*
+		変換だけを行う (オフラインで変換しておく場合).
+		変換済みのファイルの形式が compression と違う場合は変換し直す. (Auto は BC1 / BC3 のどちらでも良い)
+	*/
+	TranscodeResult TranscodeTextureFile(const std::string& filename, TextureCompression compression = TextureCompression::Auto);
+}
+
+#endif // !SABA_GL_TEXTURETRANSCODER_H_
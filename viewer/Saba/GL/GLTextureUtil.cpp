@@ -9,6 +9,8 @@
 #include <Saba/Base/Log.h>
 
 #include <iostream>
+#include <cstdio>
+#include <cstring>
 
 #define ENABLE_GLI 0
 
@@ -307,6 +309,8 @@ namespace saba
 			glTexParameteri(target, GL_TEXTURE_SWIZZLE_G, format.m_swizzle.m_g);
 			glTexParameteri(target, GL_TEXTURE_SWIZZLE_B, format.m_swizzle.m_b);
 			glTexParameteri(target, GL_TEXTURE_SWIZZLE_A, format.m_swizzle.m_a);
+			glTexParameteri(target, GL_TEXTURE_MIN_FILTER, dds.GetMipCount() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+			glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 			switch (target)
 			{
@@ -402,39 +406,83 @@ namespace saba
 			return true;
 		}
 
-		bool LoadTextureFromDDS(const GLTextureObject& tex, const char * filename)
+		bool LoadTextureFromDDS(const GLTextureObject& tex, const TextureImage& image)
 		{
-			File file;
-			if (!file.Open(filename))
+			// tinyddsloader は読み込み時にデータを保持するのでコピーする
+			std::vector<uint8_t> data = image.m_data;
+			tinyddsloader::DDSFile dds;
+			if (tinyddsloader::Result::Success != dds.Load(std::move(data)))
 			{
 				return false;
 			}
-			std::vector<uint8_t> data;
-			if (!file.ReadAll(&data))
+
+			if (!LoadGLTexture(tex, dds))
 			{
 				return false;
 			}
 
-			tinyddsloader::DDSFile dds;
-			if (tinyddsloader::Result::Success != dds.Load(std::move(data)))
+			return true;
+		}
+
+		bool LoadTextureFromPixels(const GLTextureObject& tex, const TextureImage& image, bool genMipMap)
+		{
+			glBindTexture(GL_TEXTURE_2D, tex);
+
+			switch (image.m_format)
 			{
+			case TextureImage::Format::R8G8B8:
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.m_width, image.m_height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.m_data.data());
+				break;
+			case TextureImage::Format::R8G8B8A8:
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.m_width, image.m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.m_data.data());
+				break;
+			case TextureImage::Format::R32G32B32F:
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, image.m_width, image.m_height, 0, GL_RGB, GL_FLOAT, image.m_data.data());
+				break;
+			case TextureImage::Format::R32G32B32A32F:
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, image.m_width, image.m_height, 0, GL_RGBA, GL_FLOAT, image.m_data.data());
+				break;
+			default:
 				return false;
 			}
 
-			if (!LoadGLTexture(tex, dds))
+			if (genMipMap)
 			{
-				return false;
+				glGenerateMipmap(GL_TEXTURE_2D);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			}
+			else
+			{
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 			}
 
 			return true;
 		}
 
-		bool LoadTextureFromStb(const GLTextureObject& tex, const char * filename, bool genMipMap, bool rgba)
+		// stbi_set_flip_vertically_on_load はグローバルな設定でスレッドセーフではないため、
+		// デコード後に自前で上下反転する
+		void FlipImageVertically(uint8_t* pixels, size_t rowSize, int height)
 		{
-			glBindTexture(GL_TEXTURE_2D, tex);
-
-			stbi_set_flip_vertically_on_load(true);
+			std::vector<uint8_t> tmp(rowSize);
+			for (int y = 0; y < height / 2; y++)
+			{
+				uint8_t* row0 = pixels + rowSize * y;
+				uint8_t* row1 = pixels + rowSize * (height - y - 1);
+				memcpy(tmp.data(), row0, rowSize);
+				memcpy(row0, row1, rowSize);
+				memcpy(row1, tmp.data(), rowSize);
+			}
+		}
 
+		bool LoadTextureImageFromStb(TextureImage* image, const char * filename, bool rgba)
+		{
 			File file;
 			if (!file.Open(filename))
 			{
@@ -468,63 +516,267 @@ namespace saba
 			if (stbi_is_hdr_from_file(file.GetFilePointer()))
 			{
 				file.Seek(0, File::SeekDir::Begin);
-				float* image = stbi_loadf_from_file(file.GetFilePointer(), &x, &y, &comp, reqComp);
-				if (image == nullptr)
+				float* pixels = stbi_loadf_from_file(file.GetFilePointer(), &x, &y, &comp, reqComp);
+				if (pixels == nullptr)
 				{
 					return false;
 				}
 
-				if (reqComp == STBI_rgb_alpha)
-				{
-					glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, x, y, 0, GL_RGBA, GL_FLOAT, image);
-				}
-				else
-				{
-					glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, x, y, 0, GL_RGB, GL_FLOAT, image);
-				}
-
-				stbi_image_free(image);
+				size_t rowSize = sizeof(float) * reqComp * x;
+				image->m_format = reqComp == STBI_rgb_alpha ?
+					TextureImage::Format::R32G32B32A32F :
+					TextureImage::Format::R32G32B32F;
+				image->m_width = x;
+				image->m_height = y;
+				image->m_data.assign((uint8_t*)pixels, (uint8_t*)pixels + rowSize * y);
+				stbi_image_free(pixels);
+				FlipImageVertically(image->m_data.data(), rowSize, y);
 			}
 			else
 			{
 				file.Seek(0, File::SeekDir::Begin);
-				uint8_t* image = stbi_load_from_file(file.GetFilePointer(), &x, &y, &comp, reqComp);
-				if (image == nullptr)
+				uint8_t* pixels = stbi_load_from_file(file.GetFilePointer(), &x, &y, &comp, reqComp);
+				if (pixels == nullptr)
 				{
 					return false;
 				}
 
-				if (reqComp == STBI_rgb_alpha)
-				{
-					glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, x, y, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-				}
-				else
+				size_t rowSize = reqComp * x;
+				image->m_format = reqComp == STBI_rgb_alpha ?
+					TextureImage::Format::R8G8B8A8 :
+					TextureImage::Format::R8G8B8;
+				image->m_width = x;
+				image->m_height = y;
+				image->m_data.assign(pixels, pixels + rowSize * y);
+				stbi_image_free(pixels);
+				FlipImageVertically(image->m_data.data(), rowSize, y);
+			}
+
+			return true;
+		}
+
+		const char TextureImageCacheMagic[4] = { 'S', 'P', 'T', 'C' };
+		const uint32_t TextureImageCacheVersion = 1;
+
+		struct TextureImageCacheHeader
+		{
+			char		m_magic[4];		//!< "SPTC"
+			uint32_t	m_version;
+			uint32_t	m_format;
+			uint32_t	m_rgba;
+			int32_t		m_width;
+			int32_t		m_height;
+			int64_t		m_sourceSize;
+			int64_t		m_sourceTime;
+			uint64_t	m_dataSize;
+		};
+
+		size_t GetPixelSize(TextureImage::Format format)
+		{
+			switch (format)
+			{
+			case TextureImage::Format::R8G8B8: return 3;
+			case TextureImage::Format::R8G8B8A8: return 4;
+			case TextureImage::Format::R32G32B32F: return sizeof(float) * 3;
+			case TextureImage::Format::R32G32B32A32F: return sizeof(float) * 4;
+			default: return 0;
+			}
+		}
+
+		bool ReadTextureImageCache(TextureImage* image, const std::string& cachePath, const FileStatus& sourceStatus, bool rgba)
+		{
+			File file;
+			if (!file.Open(cachePath))
+			{
+				return false;
+			}
+
+			TextureImageCacheHeader header;
+			if (!file.Read(&header))
+			{
+				return false;
+			}
+			if (memcmp(header.m_magic, TextureImageCacheMagic, sizeof(TextureImageCacheMagic)) != 0 ||
+				header.m_version != TextureImageCacheVersion ||
+				header.m_rgba != uint32_t(rgba) ||
+				header.m_sourceSize != sourceStatus.m_size ||
+				header.m_sourceTime != sourceStatus.m_lastWriteTime)
+			{
+				return false;
+			}
+
+			auto format = TextureImage::Format(header.m_format);
+			size_t pixelSize = GetPixelSize(format);
+			if (pixelSize == 0 || header.m_width <= 0 || header.m_height <= 0 ||
+				header.m_dataSize != uint64_t(header.m_width) * uint64_t(header.m_height) * pixelSize ||
+				header.m_dataSize != uint64_t(file.GetSize()) - sizeof(header))
+			{
+				SABA_WARN("Texture cache is broken. [{}]", cachePath);
+				return false;
+			}
+
+			image->m_data.resize(size_t(header.m_dataSize));
+			if (!file.Read(image->m_data.data(), image->m_data.size()))
+			{
+				return false;
+			}
+			image->m_format = format;
+			image->m_width = header.m_width;
+			image->m_height = header.m_height;
+			return true;
+		}
+
+		bool WriteTextureImageCache(const TextureImage& image, const std::string& cachePath, const FileStatus& sourceStatus, bool rgba)
+		{
+			TextureImageCacheHeader header;
+			memcpy(header.m_magic, TextureImageCacheMagic, sizeof(TextureImageCacheMagic));
+			header.m_version = TextureImageCacheVersion;
+			header.m_format = uint32_t(image.m_format);
+			header.m_rgba = uint32_t(rgba);
+			header.m_width = image.m_width;
+			header.m_height = image.m_height;
+			header.m_sourceSize = sourceStatus.m_size;
+			header.m_sourceTime = sourceStatus.m_lastWriteTime;
+			header.m_dataSize = image.m_data.size();
+
+			// 他のプロセスが読み込み中でも壊れないように、一時ファイルに書き出してから置き換える
+			std::string tempPath = cachePath + ".tmp";
+			{
+				File file;
+				if (!file.Create(tempPath) ||
+					!file.Write(&header) ||
+					!file.Write(image.m_data.data(), image.m_data.size()))
 				{
-					glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, x, y, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+					file.Close();
+					std::remove(tempPath.c_str());
+					return false;
 				}
+			}
+#if _WIN32
+			std::remove(cachePath.c_str());
+#endif // _WIN32
+			if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0)
+			{
+				std::remove(tempPath.c_str());
+				return false;
+			}
+			return true;
+		}
 
-				stbi_image_free(image);
+		bool LoadTextureImageFromDDS(TextureImage* image, const char * filename)
+		{
+			File file;
+			if (!file.Open(filename))
+			{
+				return false;
+			}
+			if (!file.ReadAll(&image->m_data))
+			{
+				return false;
 			}
+			image->m_format = TextureImage::Format::DDS;
+			image->m_width = 0;
+			image->m_height = 0;
+			return true;
+		}
+	}
 
-			if (genMipMap)
+	bool LoadTextureImageFromFile(TextureImage* image, const char* filename, bool rgba)
+	{
+		std::string ext = PathUtil::GetExt(filename);
+		if (ext == "dds")
+		{
+			if (!LoadTextureImageFromDDS(image, filename))
 			{
-				glGenerateMipmap(GL_TEXTURE_2D);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				SABA_WARN("LoadTextureImageFromDDS fail. [{}]", filename);
+				return false;
 			}
-			else
+		}
+		else
+		{
+			if (!LoadTextureImageFromStb(image, filename, rgba))
 			{
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				SABA_WARN("LoadTextureImageFromStb fail. [{}]", filename);
+				return false;
 			}
+		}
+		return true;
+	}
+
+	bool LoadTextureImageFromFile(TextureImage* image, const std::string& filename, bool rgba)
+	{
+		return LoadTextureImageFromFile(image, filename.c_str(), rgba);
+	}
+
+	std::string GetTextureImageCachePath(const std::string& filename)
+	{
+		return filename + ".sabatex";
+	}
 
+	bool LoadTextureImageFromFileCached(TextureImage* image, const std::string& filename, bool rgba)
+	{
+		FileStatus status;
+		if (PathUtil::GetExt(filename) == "dds" || !GetFileStatus(filename, &status))
+		{
+			return LoadTextureImageFromFile(image, filename, rgba);
+		}
+
+		std::string cachePath = GetTextureImageCachePath(filename);
+		if (ReadTextureImageCache(image, cachePath, status, rgba))
+		{
 			return true;
 		}
+
+		if (!LoadTextureImageFromFile(image, filename, rgba))
+		{
+			return false;
+		}
+		if (GetPixelSize(image->m_format) != 0 && !WriteTextureImageCache(*image, cachePath, status, rgba))
+		{
+			SABA_WARN("Failed to write texture cache. [{}]", cachePath);
+		}
+		return true;
+	}
+
+	GLTextureObject CreateTextureFromImage(const TextureImage& image, bool genMipMap)
+	{
+		GLTextureObject tex;
+		if (!tex.Create())
+		{
+			SABA_ERROR("Texture Create fail.");
+			return GLTextureObject();
+		}
+
+		bool ret = LoadTextureFromImage(tex, image, genMipMap);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		if (!ret)
+		{
+			return GLTextureObject();
+		}
+
+		return tex;
+	}
+
+	bool LoadTextureFromImage(const GLTextureObject& tex, const TextureImage& image, bool genMipMap)
+	{
+		if (image.m_format == TextureImage::Format::DDS)
+		{
+			if (!LoadTextureFromDDS(tex, image))
+			{
+				SABA_WARN("LoadTextureFromDDS fail.");
+				return false;
+			}
+		}
+		else
+		{
+			if (!LoadTextureFromPixels(tex, image, genMipMap))
+			{
+				SABA_WARN("LoadTextureFromPixels fail.");
+				return false;
+			}
+		}
+		return true;
 	}
 
 	GLTextureObject CreateTextureFromFile(const char * filename, bool genMipMap, bool rgba)
@@ -566,20 +818,16 @@ namespace saba
 				SABA_WARN("LoadTextureFromGLI fail.");
 			}
 #else // ENABLE_GLI
-			successed = LoadTextureFromDDS(tex, filename);
-			if (!successed)
-			{
-				SABA_WARN("LoadTextureFromDDS fail.");
-			}
+			TextureImage image;
+			successed = LoadTextureImageFromFile(&image, filename) &&
+				LoadTextureFromImage(tex, image);
 #endif // ENABLE_GLI
 		}
 		else
 		{
-			successed = LoadTextureFromStb(tex, filename, genMipMap, rgba);
-			if (!successed)
-			{
-				SABA_WARN("LoadTextureFromStb fail.");
-			}
+			TextureImage image;
+			successed = LoadTextureImageFromFile(&image, filename, rgba) &&
+				LoadTextureFromImage(tex, image, genMipMap);
 		}
 
 		if (successed)
@@ -9,9 +9,46 @@
 #include "GLObject.h"
 
 #include <string>
+#include <vector>
+#include <cstdint>
 
 namespace saba
 {
+	/*
+		GL に転送する前のデコード済み画像.
+		LoadTextureImageFromFile は GL を使わないのでワーカースレッドから呼べる.
+	*/
+	struct TextureImage
+	{
+		enum class Format
+		{
+			Unknown,
+			R8G8B8,
+			R8G8B8A8,
+			R32G32B32F,
+			R32G32B32A32F,
+			DDS,	//!< DDS ファイルのデータそのまま
+		};
+
+		Format					m_format = Format::Unknown;
+		int						m_width = 0;
+		int						m_height = 0;
+		std::vector<uint8_t>	m_data;
+	};
+
+	bool LoadTextureImageFromFile(TextureImage* image, const char* filename, bool rgba = false);
+	bool LoadTextureImageFromFile(TextureImage* image, const std::string& filename, bool rgba = false);
+
+	/*
+		デコード済みの画像を <filename>.sabatex に保存しておき、次回からは PNG などをデコードせずに読み込む.
+		元のファイルとサイズ、更新時刻が一致しない場合はデコードし直して保存する. DDS はそのまま読み込む.
+	*/
+	std::string GetTextureImageCachePath(const std::string& filename);
+	bool LoadTextureImageFromFileCached(TextureImage* image, const std::string& filename, bool rgba = false);
+
+	GLTextureObject CreateTextureFromImage(const TextureImage& image, bool genMipMap = true);
+	bool LoadTextureFromImage(const GLTextureObject& tex, const TextureImage& image, bool genMipMap = true);
+
 	GLTextureObject CreateTextureFromFile(const char* filename, bool genMipMap = true, bool rgba = false);
 	GLTextureObject CreateTextureFromFile(const std::string& filename, bool genMipMap = true, bool rgba = false);
 
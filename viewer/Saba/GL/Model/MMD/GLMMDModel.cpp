@@ -6,12 +6,18 @@
 #include "GLMMDModel.h"
 #include <Saba/GL/GLVertexUtil.h>
 #include <Saba/GL/GLTextureUtil.h>
+#include <Saba/GL/GLTextureCache.h>
 #include <Saba/Base/Log.h>
+#include <Saba/Base/Singleton.h>
+#include <Saba/Base/ThreadPool.h>
 #include <Saba/Base/Time.h>
+#include <Saba/Base/Trace.h>
 
+#include <algorithm>
+#include <cstddef>
 #include <string>
-#include <map>
 #include <memory>
+#include <vector>
 
 namespace saba
 {
@@ -19,7 +25,24 @@ namespace saba
 		: m_animTime(0)
 		, m_indexType(0)
 		, m_indexTypeSize(0)
+		, m_lod(0)
+		, m_lodDistance(30.0f)
+		, m_approxSkinningDistance(60.0f)
+		, m_updateInterval(1)
+		, m_updatePhase(0)
+		, m_autoUpdateInterval(false)
+		, m_updateFrameCount(0)
+		, m_skippedElapsed(0)
+		, m_interpValid(false)
+		, m_interpFrame(0)
+		, m_enableGPUSkinning(false)
+		, m_morphBegin(0)
+		, m_morphEnd(0)
 		, m_enablePhysics(true)
+		, m_enableParallelEvaluate(true)
+		, m_enableIKWarmStart(false)
+		, m_enableIKTwoBoneSolve(false)
+		, m_ikTolerance(0)
 		, m_enableEdge(true)
 		, m_enableGroundShadow(true)
 	{
@@ -32,33 +55,83 @@ namespace saba
 
 	namespace
 	{
-		using TextureManager = std::map<std::string, GLTextureRef>;
-		GLTextureRef CreateMMDTexture(
-			TextureManager& texMan,
-			const std::string& filename,
-			bool genMipmap = true,
-			bool rgba = false
-		)
-		{
-			std::string key = filename + ":" +
-				std::to_string(genMipmap) + ":" +
-				std::to_string(rgba);
-			auto findIt = texMan.find(key);
-			if (findIt != texMan.end())
+		// LOD 0 のインデックスの後ろに LOD 1 以降のインデックスを並べた IBO を作る
+		template <typename T>
+		GLBufferObject CreateMMDIBO(const MMDModel& mmdModel)
+		{
+			const T* indices = (const T*)mmdModel.GetIndices();
+			size_t indexCount = mmdModel.GetIndexCount();
+			size_t lodCount = mmdModel.GetLODCount();
+			if (lodCount <= 1)
 			{
-				return (*findIt).second;
+				return CreateIBO(indices, indexCount, GL_STATIC_DRAW);
 			}
-			else
+
+			std::vector<T> buf(indices, indices + indexCount);
+			for (size_t lod = 1; lod < lodCount; lod++)
 			{
-				auto tex = CreateTextureFromFile(filename.c_str());
-				GLTextureRef texRef = std::move(tex);
-				texMan.emplace(std::make_pair(key, texRef));
-				return texRef;
+				const MMDMeshLOD* meshLOD = mmdModel.GetMeshLOD(lod);
+				for (uint32_t idx : meshLOD->m_indices)
+				{
+					buf.push_back(T(idx));
+				}
+			}
+			return CreateIBO(buf, GL_STATIC_DRAW);
+		}
+
+		/*
+			キャッシュに無いテクスチャをスレッドプールで並列にデコードし、このスレッドで転送してキャッシュに登録する.
+			デコード済みの画像を同時に持つのはスレッド数分まで.
+		*/
+		void PreloadMMDTextures(const MMDModel& mmdModel)
+		{
+			SABA_TRACE_SCOPE("GLMMDModel::PreloadTextures");
+
+			auto texCache = Singleton<GLTextureCache>::Get();
+			std::vector<std::string> filenames;
+			const MMDMaterial* materials = mmdModel.GetMaterials();
+			for (size_t matIdx = 0; matIdx < mmdModel.GetMaterialCount(); matIdx++)
+			{
+				const auto& mat = materials[matIdx];
+				for (const auto* filename : { &mat.m_texture, &mat.m_spTexture, &mat.m_toonTexture })
+				{
+					if (!filename->empty() &&
+						!texCache->Contains(*filename) &&
+						std::find(filenames.begin(), filenames.end(), *filename) == filenames.end())
+					{
+						filenames.push_back(*filename);
+					}
+				}
+			}
+
+			auto pool = Singleton<ThreadPool>::Get();
+			size_t batchSize = std::max(pool->GetThreadCount(), size_t(1));
+			std::vector<TextureImage> images(batchSize);
+			std::vector<char> successed(batchSize);
+			for (size_t batch = 0; batch < filenames.size(); batch += batchSize)
+			{
+				size_t count = std::min(batchSize, filenames.size() - batch);
+				pool->ParallelFor(count, 1, [&](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						successed[i] = texCache->LoadImage(&images[i], filenames[batch + i]);
+					}
+				});
+				// 失敗したものは後の GLTextureCache::Get で警告を出す
+				for (size_t i = 0; i < count; i++)
+				{
+					if (successed[i])
+					{
+						texCache->Add(filenames[batch + i], true, false, images[i]);
+					}
+					images[i] = TextureImage();
+				}
 			}
 		}
 	}
 
-	bool GLMMDModel::Create(std::shared_ptr<MMDModel> mmdModel)
+	bool GLMMDModel::Create(std::shared_ptr<MMDModel> mmdModel, bool loadTexture)
 	{
 		Destroy();
 
@@ -74,23 +147,21 @@ namespace saba
 		m_norBinder = MakeVertexBinder<glm::vec3>();
 		m_uvBinder = MakeVertexBinder<glm::vec2>();
 
-		const void* iboBuf = mmdModel->GetIndices();
-		size_t indexCount = mmdModel->GetIndexCount();
 		size_t indexElemSize = mmdModel->GetIndexElementSize();
 		switch (indexElemSize)
 		{
 		case 1:
-			m_ibo = CreateIBO((uint8_t*)iboBuf, indexCount, GL_STATIC_DRAW);
+			m_ibo = CreateMMDIBO<uint8_t>(*mmdModel);
 			m_indexType = GL_UNSIGNED_BYTE;
 			m_indexTypeSize = 1;
 			break;
 		case 2:
-			m_ibo = CreateIBO((uint16_t*)iboBuf, indexCount, GL_STATIC_DRAW);
+			m_ibo = CreateMMDIBO<uint16_t>(*mmdModel);
 			m_indexType = GL_UNSIGNED_SHORT;
 			m_indexTypeSize = 2;
 			break;
 		case 4:
-			m_ibo = CreateIBO((uint32_t*)iboBuf, indexCount, GL_STATIC_DRAW);
+			m_ibo = CreateMMDIBO<uint32_t>(*mmdModel);
 			m_indexType = GL_UNSIGNED_INT;
 			m_indexTypeSize = 4;
 			break;
@@ -103,7 +174,11 @@ namespace saba
 		size_t matCount = mmdModel->GetMaterialCount();
 		auto materials = mmdModel->GetMaterials();
 		m_materials.resize(matCount);
-		TextureManager texMan;
+		if (loadTexture)
+		{
+			PreloadMMDTextures(*mmdModel);
+		}
+		auto texCache = Singleton<GLTextureCache>::Get();
 		for (size_t matIdx = 0; matIdx < matCount; matIdx++)
 		{
 			auto& dest = m_materials[matIdx];
@@ -117,25 +192,25 @@ namespace saba
 			dest.m_edgeFlag = src.m_edgeFlag != 0;
 			dest.m_edgeSize = src.m_edgeSize;
 			dest.m_edgeColor = src.m_edgeColor;
-			if (!src.m_texture.empty())
+			if (loadTexture && !src.m_texture.empty())
 			{
-				dest.m_texture = CreateMMDTexture(texMan, src.m_texture, true, true);
+				dest.m_texture = texCache->Get(src.m_texture);
 				dest.m_textureHaveAlpha = IsAlphaTexture(dest.m_texture);
 			}
 			dest.m_textureMulFactor = src.m_textureMulFactor;
 			dest.m_textureAddFactor = src.m_textureAddFactor;
 
-			if (!src.m_spTexture.empty())
+			if (loadTexture && !src.m_spTexture.empty())
 			{
-				dest.m_spTexture = CreateMMDTexture(texMan, src.m_spTexture);
+				dest.m_spTexture = texCache->Get(src.m_spTexture);
 			}
 			dest.m_spTextureMode = src.m_spTextureMode;
 			dest.m_spTextureMulFactor = src.m_spTextureMulFactor;
 			dest.m_spTextureAddFactor = src.m_spTextureAddFactor;
 
-			if (!src.m_toonTexture.empty())
+			if (loadTexture && !src.m_toonTexture.empty())
 			{
-				dest.m_toonTexture = CreateMMDTexture(texMan, src.m_toonTexture);
+				dest.m_toonTexture = texCache->Get(src.m_toonTexture);
 			}
 			dest.m_toonTextureMulFactor = src.m_toonTextureMulFactor;
 			dest.m_toonTextureAddFactor = src.m_toonTextureAddFactor;
@@ -160,7 +235,28 @@ namespace saba
 			dest.m_materialID = src.m_materialID;
 		}
 
+		// LOD のサブメッシュ (IBO 内の位置に変換する)
+		size_t lodIndexOffset = mmdModel->GetIndexCount();
+		for (size_t lod = 1; lod < mmdModel->GetLODCount(); lod++)
+		{
+			const MMDMeshLOD* meshLOD = mmdModel->GetMeshLOD(lod);
+			std::vector<MMDSubMesh> lodSubMeshes = meshLOD->m_subMeshes;
+			for (auto& lodSubMesh : lodSubMeshes)
+			{
+				lodSubMesh.m_beginIndex += int(lodIndexOffset);
+			}
+			m_lodSubMeshes.emplace_back(std::move(lodSubMeshes));
+			lodIndexOffset += meshLOD->m_indices.size();
+		}
+		m_lod = mmdModel->GetLOD();
+
 		m_mmdModel = mmdModel;
+		SetupIKSolvers();
+
+		if (m_enableGPUSkinning)
+		{
+			CreateSkinningBuffers();
+		}
 
 		return true;
 	}
@@ -173,6 +269,50 @@ namespace saba
 		m_norVBO.Destroy();
 		m_uvVBO.Destroy();
 		m_ibo.Destroy();
+
+		m_lodSubMeshes.clear();
+		m_lod = 0;
+
+		m_interpValid = false;
+		m_prevPositions.clear();
+		m_prevNormals.clear();
+		m_currPositions.clear();
+		m_currNormals.clear();
+		m_interpPositions.clear();
+		m_interpNormals.clear();
+
+		m_skinningVBO.Destroy();
+		m_morphPosVBO.Destroy();
+		m_morphUVVBO.Destroy();
+		m_boneTBO.Destroy();
+		m_boneTex.Destroy();
+		m_boneRows.clear();
+		m_morphBegin = 0;
+		m_morphEnd = 0;
+	}
+
+	void GLMMDModel::SetMaterialTexture(size_t materialIndex, TextureSlot slot, GLTextureRef tex)
+	{
+		if (materialIndex >= m_materials.size())
+		{
+			SABA_WARN("Material index out of range. [{}]", materialIndex);
+			return;
+		}
+
+		auto& mat = m_materials[materialIndex];
+		switch (slot)
+		{
+		case TextureSlot::Texture:
+			mat.m_textureHaveAlpha = tex != 0 ? IsAlphaTexture(tex) : false;
+			mat.m_texture = std::move(tex);
+			break;
+		case TextureSlot::SphereTexture:
+			mat.m_spTexture = std::move(tex);
+			break;
+		case TextureSlot::ToonTexture:
+			mat.m_toonTexture = std::move(tex);
+			break;
+		}
 	}
 
 	bool GLMMDModel::LoadAnimation(const VMDFile& vmd)
@@ -191,6 +331,7 @@ namespace saba
 				m_vmdAnim.reset();
 				return false;
 			}
+			EnableParallelEvaluate(m_enableParallelEvaluate);
 		}
 
 		if (!m_vmdAnim->Add(vmd))
@@ -215,6 +356,7 @@ namespace saba
 
 	void GLMMDModel::ResetAnimation()
 	{
+		m_interpValid = false;
 		m_mmdModel->InitializeAnimation();
 		if (m_vmdAnim != nullptr)
 		{
@@ -226,6 +368,7 @@ namespace saba
 	{
 		m_vmdAnim.reset();
 		m_animTime = 0;
+		m_interpValid = false;
 		m_mmdModel->InitializeAnimation();
 	}
 
@@ -239,6 +382,65 @@ namespace saba
 		return m_animTime;
 	}
 
+	void GLMMDModel::EnableParallelEvaluate(bool enable)
+	{
+		m_enableParallelEvaluate = enable;
+		if (m_vmdAnim != nullptr)
+		{
+			m_vmdAnim->SetParallelEvaluate(enable ? Singleton<ThreadPool>::Get() : nullptr);
+		}
+	}
+
+	void GLMMDModel::EnableIKWarmStart(bool enable)
+	{
+		m_enableIKWarmStart = enable;
+		SetupIKSolvers();
+	}
+
+	void GLMMDModel::EnableIKTwoBoneSolve(bool enable)
+	{
+		m_enableIKTwoBoneSolve = enable;
+		SetupIKSolvers();
+	}
+
+	void GLMMDModel::SetIKTolerance(float tolerance)
+	{
+		m_ikTolerance = tolerance;
+		SetupIKSolvers();
+	}
+
+	void GLMMDModel::SetupIKSolvers()
+	{
+		if (m_mmdModel == nullptr)
+		{
+			return;
+		}
+		auto ikMan = m_mmdModel->GetIKManager();
+		for (size_t i = 0; i < ikMan->GetIKSolverCount(); i++)
+		{
+			auto ikSolver = ikMan->GetMMDIKSolver(i);
+			ikSolver->EnableWarmStart(m_enableIKWarmStart);
+			ikSolver->EnableTwoBoneSolve(m_enableIKTwoBoneSolve);
+			ikSolver->SetTolerance(m_ikTolerance);
+		}
+	}
+
+	void GLMMDModel::UpdateIKPerfInfo()
+	{
+		m_perfInfo.m_ikSolveCount = 0;
+		m_perfInfo.m_ikIterateCount = 0;
+		auto ikMan = m_mmdModel->GetIKManager();
+		for (size_t i = 0; i < ikMan->GetIKSolverCount(); i++)
+		{
+			auto ikSolver = ikMan->GetMMDIKSolver(i);
+			if (ikSolver->Enabled())
+			{
+				m_perfInfo.m_ikSolveCount++;
+				m_perfInfo.m_ikIterateCount += ikSolver->GetLastIterateCount();
+			}
+		}
+	}
+
 	void GLMMDModel::EvaluateAnimation(double animTime)
 	{
 		if (m_vmdAnim != 0)
@@ -276,6 +478,8 @@ namespace saba
 	}
 	void GLMMDModel::UpdateAnimation(double animTime, double elapsed)
 	{
+		SABA_TRACE_SCOPE("GLMMDModel::UpdateAnimation");
+
 		Perf setupAnimPerf;
 		Perf updateMorphAnimPerf;
 		Perf updateNodeAnimPerf;
@@ -287,8 +491,11 @@ namespace saba
 		setupAnimPerf.Stop();
 
 		// Evaluate VMD aniamtion (update morph and node parameter)
+		Perf evaluateAnimPerf;
 		setupAnimPerf.Start();
+		evaluateAnimPerf.Start();
 		EvaluateAnimation(animTime);
+		evaluateAnimPerf.Stop();
 		setupAnimPerf.Stop();
 
 		// Update morph animation
@@ -320,13 +527,18 @@ namespace saba
 		setupAnimPerf.Stop();
 
 		m_perfInfo.m_setupAnimTime = setupAnimPerf.GetPerfTime();
+		m_perfInfo.m_evaluateAnimTime = evaluateAnimPerf.GetPerfTime();
+		m_perfInfo.m_parallelEvaluate = m_vmdAnim != nullptr && m_vmdAnim->WasLastEvaluateParallel();
 		m_perfInfo.m_updateMorphAnimTime = updateMorphAnimPerf.GetPerfTime();
 		m_perfInfo.m_updateNodeAnimTime = updateNodeAnimPerf.GetPerfTime();
 		m_perfInfo.m_updatePhysicsAnimTime = updatePhysicsAnimPerf.GetPerfTime();
+		UpdateIKPerfInfo();
 	}
 
 	void GLMMDModel::UpdateAnimationIgnoreVMD(double elapsed)
 	{
+		SABA_TRACE_SCOPE("GLMMDModel::UpdateAnimationIgnoreVMD");
+
 		Perf setupAnimPerf;
 		Perf updateMorphAnimPerf;
 		Perf updateNodeAnimPerf;
@@ -376,9 +588,12 @@ namespace saba
 		setupAnimPerf.Stop();
 
 		m_perfInfo.m_setupAnimTime = setupAnimPerf.GetPerfTime();
+		m_perfInfo.m_evaluateAnimTime = 0;
+		m_perfInfo.m_parallelEvaluate = false;
 		m_perfInfo.m_updateMorphAnimTime = updateMorphAnimPerf.GetPerfTime();
 		m_perfInfo.m_updateNodeAnimTime = updateNodeAnimPerf.GetPerfTime();
 		m_perfInfo.m_updatePhysicsAnimTime = updatePhysicsAnimPerf.GetPerfTime();
+		UpdateIKPerfInfo();
 	}
 
 	void GLMMDModel::UpdateMorph()
@@ -397,6 +612,351 @@ namespace saba
 		m_mmdModel->EndAnimation();
 	}
 
+	void GLMMDModel::SetLOD(size_t lod, bool approximateSkinning)
+	{
+		if (m_mmdModel == nullptr)
+		{
+			return;
+		}
+		m_mmdModel->SetLOD(lod, approximateSkinning);
+		if (m_lod != m_mmdModel->GetLOD())
+		{
+			// 前の LOD で更新していない頂点を補間しないように、次のフレームで全体を更新する
+			m_lod = m_mmdModel->GetLOD();
+			m_interpValid = false;
+		}
+	}
+
+	void GLMMDModel::SelectLOD(float distance)
+	{
+		if (m_mmdModel == nullptr || m_lodSubMeshes.empty())
+		{
+			return;
+		}
+		size_t lod = 0;
+		if (m_lodDistance > 0.0f)
+		{
+			lod = std::min(size_t(std::max(distance, 0.0f) / m_lodDistance), m_lodSubMeshes.size());
+		}
+		bool approx = m_approxSkinningDistance > 0.0f && distance >= m_approxSkinningDistance;
+		SetLOD(lod, approx);
+	}
+
+	void GLMMDModel::SetUpdateInterval(uint32_t interval)
+	{
+		interval = std::max(interval, uint32_t(1));
+		if (m_updateInterval != interval)
+		{
+			m_updateInterval = interval;
+			m_interpValid = false;
+		}
+	}
+
+	void GLMMDModel::SelectUpdateInterval(float screenSize)
+	{
+		if (!m_autoUpdateInterval)
+		{
+			return;
+		}
+		if (screenSize >= 0.5f)
+		{
+			SetUpdateInterval(1);
+		}
+		else if (screenSize >= 0.25f)
+		{
+			SetUpdateInterval(2);
+		}
+		else
+		{
+			SetUpdateInterval(4);
+		}
+	}
+
+	bool GLMMDModel::StepUpdateFrame(double elapsed, double* updateElapsed)
+	{
+		m_skippedElapsed += elapsed;
+		bool update = m_updateInterval <= 1 || !m_interpValid ||
+			((m_updateFrameCount + m_updatePhase) % m_updateInterval) == 0;
+		m_updateFrameCount++;
+		if (update)
+		{
+			if (updateElapsed != nullptr)
+			{
+				*updateElapsed = m_skippedElapsed;
+			}
+			m_skippedElapsed = 0;
+		}
+		return update;
+	}
+
+	void GLMMDModel::UpdateInterpolation()
+	{
+		// GPU スキニングは補間せず、前回転送したボーンの変形行列のまま描画する
+		if (!m_interpValid || m_enableGPUSkinning)
+		{
+			return;
+		}
+
+		Perf updateGLBufferPerf;
+		updateGLBufferPerf.Start();
+		m_interpFrame++;
+		UpdateInterpolatedVBO();
+		updateGLBufferPerf.Stop();
+
+		m_perfInfo.m_updateGLBufferTime = updateGLBufferPerf.GetPerfTime();
+	}
+
+	void GLMMDModel::UpdateInterpolatedVBO()
+	{
+		SABA_TRACE_SCOPE("GLMMDModel::UpdateInterpolatedVBO");
+
+		float t = float(m_interpFrame + 1) / float(m_updateInterval);
+		if (t >= 1.0f)
+		{
+			UpdateVBO(m_posVBO, m_currPositions);
+			UpdateVBO(m_norVBO, m_currNormals);
+			return;
+		}
+
+		size_t vtxCount = m_currPositions.size();
+		m_interpPositions.resize(vtxCount);
+		m_interpNormals.resize(vtxCount);
+		auto lerp = [this, t](size_t i)
+		{
+			m_interpPositions[i] = glm::mix(m_prevPositions[i], m_currPositions[i], t);
+			m_interpNormals[i] = glm::mix(m_prevNormals[i], m_currNormals[i], t);
+		};
+		// LOD を使用している場合は、描画する頂点だけ補間する
+		const MMDMeshLOD* meshLOD = m_lod != 0 ? m_mmdModel->GetMeshLOD(m_lod) : nullptr;
+		if (meshLOD != nullptr)
+		{
+			for (uint32_t vi : meshLOD->m_vertices)
+			{
+				lerp(vi);
+			}
+		}
+		else
+		{
+			for (size_t vi = 0; vi < vtxCount; vi++)
+			{
+				lerp(vi);
+			}
+		}
+		UpdateVBO(m_posVBO, m_interpPositions);
+		UpdateVBO(m_norVBO, m_interpNormals);
+	}
+
+	bool GLMMDModel::UpdateMappedVBO()
+	{
+		SABA_TRACE_SCOPE("GLMMDModel::UpdateMappedVBO");
+
+		// スキニングの結果を、マップした VBO に直接書き込む
+		size_t vtxCount = m_mmdModel->GetVertexCount();
+		if (vtxCount == 0)
+		{
+			return false;
+		}
+		const GLuint vbos[] = { m_posVBO, m_norVBO, m_uvVBO };
+		const size_t elementSizes[] = { sizeof(glm::vec3), sizeof(glm::vec3), sizeof(glm::vec2) };
+		void* mapped[] = { nullptr, nullptr, nullptr };
+		bool succeeded = true;
+		for (size_t i = 0; i < 3 && succeeded; i++)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, vbos[i]);
+			// LOD を使用している場合、書き込まない頂点は描画しないので、以前の内容は破棄してよい
+			mapped[i] = glMapBufferRange(
+				GL_ARRAY_BUFFER, 0, GLsizeiptr(elementSizes[i] * vtxCount),
+				GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT
+			);
+			succeeded = mapped[i] != nullptr;
+		}
+		if (succeeded)
+		{
+			MMDVertexSink sink;
+			sink.m_positions.m_data = mapped[0];
+			sink.m_normals.m_data = mapped[1];
+			sink.m_uvs.m_data = mapped[2];
+			m_mmdModel->Update(sink);
+		}
+		for (size_t i = 0; i < 3; i++)
+		{
+			if (mapped[i] != nullptr)
+			{
+				glBindBuffer(GL_ARRAY_BUFFER, vbos[i]);
+				succeeded = (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE) && succeeded;
+			}
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return succeeded;
+	}
+
+	void GLMMDModel::EnableGPUSkinning(bool enable)
+	{
+		if (m_enableGPUSkinning == enable)
+		{
+			return;
+		}
+		m_enableGPUSkinning = enable;
+		m_interpValid = false;
+		if (m_mmdModel == nullptr)
+		{
+			return;
+		}
+
+		if (enable)
+		{
+			// 頂点シェーダーには変形前の頂点を渡す
+			size_t vtxCount = m_mmdModel->GetVertexCount();
+			UpdateVBO(m_posVBO, m_mmdModel->GetPositions(), vtxCount);
+			UpdateVBO(m_norVBO, m_mmdModel->GetNormals(), vtxCount);
+			UpdateVBO(m_uvVBO, m_mmdModel->GetUVs(), vtxCount);
+			CreateSkinningBuffers();
+		}
+		// 切り替えたフレームから現在のポーズで描画できるようにする
+		Update();
+	}
+
+	namespace
+	{
+		struct SkinningAttribute
+		{
+			const char*	m_name;
+			GLint		m_elementNum;
+			GLenum		m_elementType;
+			size_t		m_offset;
+		};
+	}
+
+	void GLMMDModel::BindSkinningVertexAttributes(GLuint prog) const
+	{
+		const SkinningAttribute skinningAttributes[] =
+		{
+			{ "in_BoneIndex", 4, GL_INT, offsetof(MMDSkinningVertex, m_boneIndex) },
+			{ "in_BoneWeight", 4, GL_FLOAT, offsetof(MMDSkinningVertex, m_boneWeight) },
+			{ "in_SkinningType", 1, GL_INT, offsetof(MMDSkinningVertex, m_type) },
+			{ "in_SdefC", 3, GL_FLOAT, offsetof(MMDSkinningVertex, m_sdefC) },
+			{ "in_SdefR0", 3, GL_FLOAT, offsetof(MMDSkinningVertex, m_sdefR0) },
+			{ "in_SdefR1", 3, GL_FLOAT, offsetof(MMDSkinningVertex, m_sdefR1) },
+		};
+		glBindBuffer(GL_ARRAY_BUFFER, m_skinningVBO);
+		for (const auto& skinningAttr : skinningAttributes)
+		{
+			GLint attr = glGetAttribLocation(prog, skinningAttr.m_name);
+			if (attr == -1)
+			{
+				continue;
+			}
+			const GLsizei stride = sizeof(MMDSkinningVertex);
+			const void* offset = (const void*)skinningAttr.m_offset;
+			if (skinningAttr.m_elementType == GL_INT)
+			{
+				glVertexAttribIPointer(attr, skinningAttr.m_elementNum, GL_INT, stride, offset);
+			}
+			else
+			{
+				glVertexAttribPointer(attr, skinningAttr.m_elementNum, skinningAttr.m_elementType, GL_FALSE, stride, offset);
+			}
+			glEnableVertexAttribArray(attr);
+		}
+
+		GLint morphPosAttr = glGetAttribLocation(prog, "in_MorphPos");
+		if (morphPosAttr != -1)
+		{
+			MakeVertexBinder<glm::vec3>().Bind(morphPosAttr, m_morphPosVBO);
+			glEnableVertexAttribArray(morphPosAttr);
+		}
+		GLint morphUVAttr = glGetAttribLocation(prog, "in_MorphUV");
+		if (morphUVAttr != -1)
+		{
+			MakeVertexBinder<glm::vec4>().Bind(morphUVAttr, m_morphUVVBO);
+			glEnableVertexAttribArray(morphUVAttr);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	void GLMMDModel::CreateSkinningBuffers()
+	{
+		size_t vtxCount = m_mmdModel->GetVertexCount();
+		if (m_skinningVBO == 0)
+		{
+			std::vector<MMDSkinningVertex> skinningVertices(vtxCount);
+			m_mmdModel->GetSkinningVertices(skinningVertices.data());
+			m_skinningVBO = CreateVBO(skinningVertices.data(), vtxCount, GL_STATIC_DRAW);
+
+			std::vector<glm::vec3> zeroPositions(vtxCount, glm::vec3(0));
+			std::vector<glm::vec4> zeroUVs(vtxCount, glm::vec4(0));
+			m_morphPosVBO = CreateVBO(zeroPositions.data(), vtxCount, GL_DYNAMIC_DRAW);
+			m_morphUVVBO = CreateVBO(zeroUVs.data(), vtxCount, GL_DYNAMIC_DRAW);
+
+			size_t boneCount = m_mmdModel->GetNodeManager()->GetNodeCount();
+			m_boneTBO.Create();
+			glBindBuffer(GL_TEXTURE_BUFFER, m_boneTBO);
+			glBufferData(GL_TEXTURE_BUFFER, GLsizeiptr(sizeof(glm::vec4) * 3 * boneCount), nullptr, GL_STREAM_DRAW);
+			glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+			m_boneTex.Create();
+			glBindTexture(GL_TEXTURE_BUFFER, m_boneTex);
+			glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_boneTBO);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+		}
+		// モーフの移動量の VBO は、次の Update で全体を転送する
+		m_morphBegin = 0;
+		m_morphEnd = vtxCount;
+	}
+
+	void GLMMDModel::UpdateSkinningBuffers(const MMDSkinningData& data)
+	{
+		SABA_TRACE_SCOPE("GLMMDModel::UpdateSkinningBuffers");
+
+		// ボーンの変形行列は 0 ～ 2 行目だけ転送する (1 ボーン 48 バイト)
+		m_boneRows.resize(data.m_transformCount * 3);
+		for (size_t i = 0; i < data.m_transformCount; i++)
+		{
+			const auto& m = data.m_transforms[i];
+			for (int row = 0; row < 3; row++)
+			{
+				m_boneRows[i * 3 + row] = glm::vec4(m[0][row], m[1][row], m[2][row], m[3][row]);
+			}
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, m_boneTBO);
+		glBufferData(GL_TEXTURE_BUFFER, GLsizeiptr(sizeof(glm::vec4) * m_boneRows.size()), m_boneRows.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		// モーフの移動量は範囲外が 0 なので、前回と今回の範囲だけ転送する
+		bool hasMorph = data.m_morphBegin != data.m_morphEnd;
+		bool hadMorph = m_morphBegin != m_morphEnd;
+		size_t begin = hasMorph ? data.m_morphBegin : m_morphBegin;
+		size_t end = hasMorph ? data.m_morphEnd : m_morphEnd;
+		if (hasMorph && hadMorph)
+		{
+			begin = std::min(begin, m_morphBegin);
+			end = std::max(end, m_morphEnd);
+		}
+		if (begin != end)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, m_morphPosVBO);
+			glBufferSubData(
+				GL_ARRAY_BUFFER,
+				GLintptr(sizeof(glm::vec3) * begin),
+				GLsizeiptr(sizeof(glm::vec3) * (end - begin)),
+				data.m_morphPositions + begin
+			);
+			if (data.m_morphUVs != nullptr)
+			{
+				glBindBuffer(GL_ARRAY_BUFFER, m_morphUVVBO);
+				glBufferSubData(
+					GL_ARRAY_BUFFER,
+					GLintptr(sizeof(glm::vec4) * begin),
+					GLsizeiptr(sizeof(glm::vec4) * (end - begin)),
+					data.m_morphUVs + begin
+				);
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+		m_morphBegin = data.m_morphBegin;
+		m_morphEnd = data.m_morphEnd;
+	}
+
 	void GLMMDModel::Update()
 	{
 		if (m_mmdModel == nullptr)
@@ -404,11 +964,27 @@ namespace saba
 			return;
 		}
 
+		SABA_TRACE_SCOPE("GLMMDModel::Update");
+
 		Perf updateModelPerf;
 		Perf updateGLBufferPerf;
 
 		updateModelPerf.Start();
-		m_mmdModel->Update();
+		MMDSkinningData skinningData;
+		bool updatedVBO = false;
+		if (m_enableGPUSkinning)
+		{
+			m_mmdModel->UpdateSkinning(&skinningData);
+		}
+		else
+		{
+			// 補間しない場合は VBO に直接書き込む (マップできない場合は、これまで通り転送する)
+			updatedVBO = m_updateInterval <= 1 && UpdateMappedVBO();
+			if (!updatedVBO)
+			{
+				m_mmdModel->Update();
+			}
+		}
 
 		size_t matCount = m_mmdModel->GetMaterialCount();
 		for (size_t mi = 0; mi < matCount; mi++)
@@ -428,12 +1004,56 @@ namespace saba
 		}
 		updateModelPerf.Stop();
 
-		updateGLBufferPerf.Start();
-		size_t vtxCount = m_mmdModel->GetVertexCount();
-		UpdateVBO(m_posVBO, m_mmdModel->GetUpdatePositions(), vtxCount);
-		UpdateVBO(m_norVBO, m_mmdModel->GetUpdateNormals(), vtxCount);
-		UpdateVBO(m_uvVBO, m_mmdModel->GetUpdateUVs(), vtxCount);
-		updateGLBufferPerf.Stop();
+		{
+			SABA_TRACE_SCOPE("GLMMDModel::UpdateGLBuffer");
+
+			updateGLBufferPerf.Start();
+			size_t vtxCount = m_mmdModel->GetVertexCount();
+			const glm::vec3* positions = m_mmdModel->GetUpdatePositions();
+			const glm::vec3* normals = m_mmdModel->GetUpdateNormals();
+			if (m_enableGPUSkinning)
+			{
+				// 更新しないフレームは転送済みのボーンの変形行列を使う
+				m_interpValid = true;
+				UpdateSkinningBuffers(skinningData);
+			}
+			else if (updatedVBO)
+			{
+				m_interpValid = false;
+			}
+			else if (m_updateInterval <= 1)
+			{
+				m_interpValid = false;
+				UpdateVBO(m_posVBO, positions, vtxCount);
+				UpdateVBO(m_norVBO, normals, vtxCount);
+			}
+			else
+			{
+				// 補間用に直前の 2 回の結果を保持する
+				if (m_interpValid)
+				{
+					m_prevPositions.swap(m_currPositions);
+					m_prevNormals.swap(m_currNormals);
+					m_currPositions.assign(positions, positions + vtxCount);
+					m_currNormals.assign(normals, normals + vtxCount);
+				}
+				else
+				{
+					m_currPositions.assign(positions, positions + vtxCount);
+					m_currNormals.assign(normals, normals + vtxCount);
+					m_prevPositions = m_currPositions;
+					m_prevNormals = m_currNormals;
+					m_interpValid = true;
+				}
+				m_interpFrame = 0;
+				UpdateInterpolatedVBO();
+			}
+			if (!updatedVBO && !m_enableGPUSkinning)
+			{
+				UpdateVBO(m_uvVBO, m_mmdModel->GetUpdateUVs(), vtxCount);
+			}
+			updateGLBufferPerf.Stop();
+		}
 
 		m_perfInfo.m_updateModelTime = updateModelPerf.GetPerfTime();
 		m_perfInfo.m_updateGLBufferTime = updateGLBufferPerf.GetPerfTime();
@@ -442,6 +1062,10 @@ namespace saba
 	void GLMMDModel::PerfInfo::Clear()
 	{
 		m_setupAnimTime = 0;
+		m_evaluateAnimTime = 0;
+		m_parallelEvaluate = false;
+		m_ikSolveCount = 0;
+		m_ikIterateCount = 0;
 		m_updateMorphAnimTime = 0;
 		m_updateNodeAnimTime = 0;
 		m_updatePhysicsAnimTime = 0;
@@ -51,9 +51,22 @@ namespace saba
 		GLMMDModel();
 		~GLMMDModel();
 
-		bool Create(std::shared_ptr<MMDModel> mmdModel);
+		enum class TextureSlot
+		{
+			Texture,
+			SphereTexture,
+			ToonTexture,
+		};
+
+		/*
+		loadTexture が false の場合、テクスチャは読み込まない。
+		後から SetMaterialTexture で設定する。(非同期読み込み用)
+		*/
+		bool Create(std::shared_ptr<MMDModel> mmdModel, bool loadTexture = true);
 		void Destroy();
 
+		void SetMaterialTexture(size_t materialIndex, TextureSlot slot, GLTextureRef tex);
+
 		bool LoadAnimation(const VMDFile& vmd);
 		void LoadPose(const VPDFile& vpd, int frameCount = 30);
 
@@ -88,12 +101,17 @@ namespace saba
 
 		MMDModel* GetMMDModel() const { return m_mmdModel.get(); }
 		const std::vector<GLMMDMaterial>& GetMaterials() const { return m_materials; }
-		const std::vector<MMDSubMesh>& GetSubMeshes() const { return m_subMeshes; }
+		// 現在の LOD のサブメッシュ (m_beginIndex は IBO 内の位置)
+		const std::vector<MMDSubMesh>& GetSubMeshes() const { return m_lod == 0 ? m_subMeshes : m_lodSubMeshes[m_lod - 1]; }
 
 		struct PerfInfo
 		{
 			// Update animation
 			double	m_setupAnimTime;
+			double	m_evaluateAnimTime;		//!< m_setupAnimTime のうち VMD の評価時間
+			bool	m_parallelEvaluate;		//!< VMD を並列に評価したか
+			uint32_t	m_ikSolveCount;		//!< IK を解いた回数
+			uint32_t	m_ikIterateCount;	//!< IK の反復回数の合計
 			double	m_updateMorphAnimTime;
 			double	m_updateNodeAnimTime;
 			double	m_updatePhysicsAnimTime;
@@ -111,6 +129,58 @@ namespace saba
 
 		VMDAnimation* GetVMDAnimation() const { return m_vmdAnim.get(); }
 
+		// VMD のコントローラーを共有のスレッドプールで評価する (コントローラー数が少ない場合は直列)
+		void EnableParallelEvaluate(bool enable);
+		bool IsEnabledParallelEvaluate() const { return m_enableParallelEvaluate; }
+
+		// IK を前回のフレームの解から解く
+		void EnableIKWarmStart(bool enable);
+		bool IsEnabledIKWarmStart() const { return m_enableIKWarmStart; }
+		// ひざ + 足の 2 リンクの IK を解析的に解く (MMDIkSolver::EnableTwoBoneSolve)
+		void EnableIKTwoBoneSolve(bool enable);
+		bool IsEnabledIKTwoBoneSolve() const { return m_enableIKTwoBoneSolve; }
+		// IK の反復を打ち切る距離 (0 : 無効. ウォームスタートの場合はチェインの長さから決める)
+		void SetIKTolerance(float tolerance);
+		float GetIKTolerance() const { return m_ikTolerance; }
+
+		/*
+		LOD (MMDModel::GetLODCount が 2 以上の場合のみ有効)
+		SelectLOD は視点からの距離で LOD を選ぶ.
+		LOD n は距離 lodDistance * n 以上で使用し、approxSkinningDistance 以上で近似スキニングにする.
+		lodDistance が 0 の場合は常に LOD 0 を使用する.
+		*/
+		size_t GetLODCount() const { return m_lodSubMeshes.size() + 1; }
+		size_t GetLOD() const { return m_lod; }
+		void SetLOD(size_t lod, bool approximateSkinning = false);
+		void SelectLOD(float distance);
+		void SetLODDistance(float lodDistance) { m_lodDistance = lodDistance; }
+		float GetLODDistance() const { return m_lodDistance; }
+		void SetApproxSkinningDistance(float distance) { m_approxSkinningDistance = distance; }
+		float GetApproxSkinningDistance() const { return m_approxSkinningDistance; }
+
+		/*
+		アニメーションの更新間隔 (フレーム数)
+		interval が 2 以上の場合、StepUpdateFrame が true を返すフレームだけアニメーションと頂点を更新し、
+		それ以外のフレームは UpdateInterpolation で直前の 2 回の更新結果を補間する.
+		(補間するので表示は interval - 1 フレーム遅れる)
+		phase で更新するフレームをずらし、複数のモデルの更新が同じフレームに集中しないようにする.
+		*/
+		void SetUpdateInterval(uint32_t interval);
+		uint32_t GetUpdateInterval() const { return m_updateInterval; }
+		void SetUpdatePhase(uint32_t phase) { m_updatePhase = phase; }
+		uint32_t GetUpdatePhase() const { return m_updatePhase; }
+		// 有効な場合、SelectUpdateInterval で画面上の大きさから更新間隔を選ぶ
+		void EnableAutoUpdateInterval(bool enable) { m_autoUpdateInterval = enable; }
+		bool IsEnabledAutoUpdateInterval() const { return m_autoUpdateInterval; }
+		// screenSize : 画面の高さに対するモデルの大きさ
+		void SelectUpdateInterval(float screenSize);
+		/*
+		フレームを進め、このフレームでアニメーションを更新するかを返す.
+		true の場合、updateElapsed に前回の更新からの経過時間を返す.
+		*/
+		bool StepUpdateFrame(double elapsed, double* updateElapsed);
+		void UpdateInterpolation();
+
 		void EnablePhysics(bool enable) { m_enablePhysics = enable; }
 		bool IsEnabledPhysics() const { return m_enablePhysics; }
 
@@ -120,6 +190,28 @@ namespace saba
 		void EnableGroundShadow(bool enable) { m_enableGroundShadow = enable; }
 		bool IsEnableGroundShadow() const { return m_enableGroundShadow; }
 
+		/*
+		頂点シェーダーでスキニングする (シェーダーに MMD_SKINNING を定義して描画する).
+		Update はボーンの変形行列と、変化した範囲のモーフの移動量だけを転送し、
+		位置、法線、UV の VBO はモデルを読み込んだ時の値のままにする.
+		有効な場合、近似スキニングは使わない. 更新間隔は有効だが補間はせず、
+		更新しないフレームは前回転送したボーンの変形行列のまま描画する.
+		*/
+		void EnableGPUSkinning(bool enable);
+		bool IsEnabledGPUSkinning() const { return m_enableGPUSkinning; }
+		// スキニング用の頂点属性を、現在バインドしている VAO に設定する (prog に無い属性は設定しない)
+		void BindSkinningVertexAttributes(GLuint prog) const;
+		// ボーンの変形行列 (GL_TEXTURE_BUFFER, ボーンごとに 0 ～ 2 行目の 3 テクセル)
+		GLuint GetBoneTransformTexture() const { return m_boneTex; }
+
+	private:
+		void SetupIKSolvers();
+		void UpdateIKPerfInfo();
+		void UpdateInterpolatedVBO();
+		bool UpdateMappedVBO();
+		void CreateSkinningBuffers();
+		void UpdateSkinningBuffers(const MMDSkinningData& data);
+
 	private:
 		std::shared_ptr<MMDModel>		m_mmdModel;
 
@@ -140,10 +232,44 @@ namespace saba
 
 		std::vector<GLMMDMaterial>	m_materials;
 		std::vector<MMDSubMesh>		m_subMeshes;
+		std::vector<std::vector<MMDSubMesh>>	m_lodSubMeshes;	//!< LOD 1 以降
+		size_t						m_lod;
+		float						m_lodDistance;
+		float						m_approxSkinningDistance;
+
+		// 更新間隔
+		uint32_t				m_updateInterval;
+		uint32_t				m_updatePhase;
+		bool					m_autoUpdateInterval;
+		uint32_t				m_updateFrameCount;
+		double					m_skippedElapsed;
+		bool					m_interpValid;	//!< 前回の更新結果がある (GPU スキニングでは補間しない)
+		uint32_t				m_interpFrame;	//!< 最後の更新からのフレーム数
+		std::vector<glm::vec3>	m_prevPositions;
+		std::vector<glm::vec3>	m_prevNormals;
+		std::vector<glm::vec3>	m_currPositions;
+		std::vector<glm::vec3>	m_currNormals;
+		std::vector<glm::vec3>	m_interpPositions;
+		std::vector<glm::vec3>	m_interpNormals;
+
+		// GPU スキニング
+		bool					m_enableGPUSkinning;
+		GLBufferObject			m_skinningVBO;
+		GLBufferObject			m_morphPosVBO;
+		GLBufferObject			m_morphUVVBO;
+		GLBufferObject			m_boneTBO;
+		GLTextureObject			m_boneTex;
+		std::vector<glm::vec4>	m_boneRows;
+		size_t					m_morphBegin;	//!< 前回転送したモーフの範囲
+		size_t					m_morphEnd;
 
 		PerfInfo					m_perfInfo;
 
 		bool	m_enablePhysics;
+		bool	m_enableParallelEvaluate;
+		bool	m_enableIKWarmStart;
+		bool	m_enableIKTwoBoneSolve;
+		float	m_ikTolerance;
 		bool	m_enableEdge;
 		bool	m_enableGroundShadow;
 	};
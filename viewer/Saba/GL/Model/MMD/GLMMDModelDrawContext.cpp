@@ -54,6 +54,8 @@ namespace saba
 		m_uShadowMap2 = glGetUniformLocation(m_prog, "u_ShadowMap2");
 		m_uShadowMap3 = glGetUniformLocation(m_prog, "u_ShadowMap3");
 		m_uShadowMapEnabled = glGetUniformLocation(m_prog, "u_ShadowMapEnabled");
+
+		m_uBoneTransforms = glGetUniformLocation(m_prog, "u_BoneTransforms");
 	}
 
 	void GLMMDEdgeShader::Initialize()
@@ -68,6 +70,8 @@ namespace saba
 		m_uScreenSize = glGetUniformLocation(m_prog, "u_ScreenSize");
 		m_uEdgeSize = glGetUniformLocation(m_prog, "u_EdgeSize");
 		m_uEdgeColor = glGetUniformLocation(m_prog, "u_EdgeColor");
+
+		m_uBoneTransforms = glGetUniformLocation(m_prog, "u_BoneTransforms");
 	}
 
 	void GLMMDGroundShadowShader::Initialize()
@@ -78,6 +82,19 @@ namespace saba
 		// uniform
 		m_uWVP = glGetUniformLocation(m_prog, "u_WVP");
 		m_uShadowColor = glGetUniformLocation(m_prog, "u_ShadowColor");
+
+		m_uBoneTransforms = glGetUniformLocation(m_prog, "u_BoneTransforms");
+	}
+
+	void GLMMDShadowShader::Initialize()
+	{
+		// attribute
+		m_inPos = glGetAttribLocation(m_prog, "in_Pos");
+
+		// uniform
+		m_uWVP = glGetUniformLocation(m_prog, "u_WVP");
+
+		m_uBoneTransforms = glGetUniformLocation(m_prog, "u_BoneTransforms");
 	}
 
 	GLMMDModelDrawContext::GLMMDModelDrawContext(ViewerContext * ctxt)
@@ -231,6 +248,54 @@ namespace saba
 		return m_groundShadowShaders[groundShadowShaderIndex].get();
 	}
 
+	int GLMMDModelDrawContext::GetShadowShaderIndex(const GLSLDefine & define)
+	{
+		if (m_viewerContext == nullptr)
+		{
+			return -1;
+		}
+
+		auto findIt = std::find_if(
+			m_shadowShaders.begin(),
+			m_shadowShaders.end(),
+			[&define](const MMDShadowShaderPtr& shader) {return shader->m_define == define; }
+		);
+
+		if (findIt == m_shadowShaders.end())
+		{
+			MMDShadowShaderPtr shader = std::make_unique<GLMMDShadowShader>();
+			shader->m_define = define;
+			GLSLShaderUtil glslShaderUtil;
+			glslShaderUtil.SetShaderDir(m_viewerContext->GetShaderDir());
+			glslShaderUtil.SetGLSLDefine(define);
+			shader->m_prog = glslShaderUtil.CreateProgram("shadow_shader");
+			if (shader->m_prog == 0)
+			{
+				SABA_ERROR("Shader Create fail.");
+				return -1;
+			}
+
+			shader->Initialize();
+			m_shadowShaders.emplace_back(std::move(shader));
+			return (int)(m_shadowShaders.size() - 1);
+		}
+		else
+		{
+			return (int)(findIt - m_shadowShaders.begin());
+		}
+	}
+
+	GLMMDShadowShader * GLMMDModelDrawContext::GetShadowShader(int shadowShaderIndex) const
+	{
+		if (shadowShaderIndex < 0)
+		{
+			SABA_ERROR("shaderIndex < 0");
+			return nullptr;
+		}
+
+		return m_shadowShaders[shadowShaderIndex].get();
+	}
+
 	ViewerContext * GLMMDModelDrawContext::GetViewerContext() const
 	{
 		return m_viewerContext;
@@ -62,6 +62,8 @@ namespace saba
 		GLint	m_uShadowMap3;
 		GLint	m_uShadowMapEnabled;
 
+		GLint	m_uBoneTransforms;
+
 		void Initialize();
 	};
 
@@ -82,6 +84,8 @@ namespace saba
 
 		GLint	m_uEdgeColor;
 
+		GLint	m_uBoneTransforms;
+
 		void Initialize();
 	};
 
@@ -97,6 +101,25 @@ namespace saba
 		GLint	m_uWVP;
 		GLint	m_uShadowColor;
 
+		GLint	m_uBoneTransforms;
+
+		void Initialize();
+	};
+
+	// シャドウマップ用 (ShadowMapShader に GLSLDefine を指定できるようにしたもの)
+	struct GLMMDShadowShader
+	{
+		GLSLDefine		m_define;
+		GLProgramObject	m_prog;
+
+		// attribute
+		GLint	m_inPos;
+
+		// uniform
+		GLint	m_uWVP;
+
+		GLint	m_uBoneTransforms;
+
 		void Initialize();
 	};
 
@@ -117,16 +140,21 @@ namespace saba
 		int GetGroundShadowShaderIndex(const GLSLDefine& define);
 		GLMMDGroundShadowShader* GetGroundShadowShader(int groundShadowShaderIndex) const;
 
+		int GetShadowShaderIndex(const GLSLDefine& define);
+		GLMMDShadowShader* GetShadowShader(int shadowShaderIndex) const;
+
 		ViewerContext* GetViewerContext() const;
 
 	private:
 		using MMDShaderPtr = std::unique_ptr<GLMMDShader>;
 		using MMDEdgeShaderPtr = std::unique_ptr<GLMMDEdgeShader>;
 		using MMDGroundShadowShaderPtr = std::unique_ptr<GLMMDGroundShadowShader>;
+		using MMDShadowShaderPtr = std::unique_ptr<GLMMDShadowShader>;
 		ViewerContext*				m_viewerContext;
 		std::vector<MMDShaderPtr>	m_shaders;
 		std::vector<MMDEdgeShaderPtr>	m_edgeShaders;
 		std::vector<MMDGroundShadowShaderPtr>	m_groundShadowShaders;
+		std::vector<MMDShadowShaderPtr>	m_shadowShaders;
 	};
 }
 
@@ -8,17 +8,27 @@
 #include "GLMMDModelDrawContext.h"
 
 #include <Saba/Base/Log.h>
+#include <Saba/Base/Trace.h>
 #include <Saba/GL/GLShaderUtil.h>
 #include <Saba/GL/GLTextureUtil.h>
 #include <Saba/Model/MMD/MMDPhysics.h>
 
 #include <imgui.h>
 
+#include <algorithm>
+
 namespace saba
 {
+	namespace
+	{
+		// 0 - 2 : 材質のテクスチャ, 3 - 6 : シャドウマップ
+		const GLint BoneTransformTextureUnit = 7;
+	}
+
 	GLMMDModelDrawer::GLMMDModelDrawer(GLMMDModelDrawContext * ctxt, std::shared_ptr<GLMMDModel> mmdModel)
 		: m_drawContext(ctxt)
 		, m_mmdModel(mmdModel)
+		, m_gpuSkinning(false)
 		, m_clipElapsed(true)
 		, m_viewLocal(true)
 		, m_selectedNode(nullptr)
@@ -34,10 +44,15 @@ namespace saba
 
 	bool GLMMDModelDrawer::Create()
 	{
+		m_gpuSkinning = m_mmdModel->IsEnabledGPUSkinning();
 		int matIdx = 0;
 		for (const auto& mat : m_mmdModel->GetMaterials())
 		{
 			GLSLDefine define;
+			if (m_gpuSkinning)
+			{
+				define.Define("MMD_SKINNING");
+			}
 
 			MaterialShader matShader;
 			matShader.m_mmdMaterialIndex = matIdx;
@@ -71,6 +86,11 @@ namespace saba
 				glEnableVertexAttribArray(shader->m_inUV);
 			}
 
+			if (m_gpuSkinning)
+			{
+				m_mmdModel->BindSkinningVertexAttributes(shader->m_prog);
+			}
+
 			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mmdModel->GetIBO());
 
 			glBindVertexArray(0);
@@ -98,11 +118,22 @@ namespace saba
 			m_mmdModel->GetNormalBinder().Bind(edgeShader->m_inNor, m_mmdModel->GetNormalVBO());
 			glEnableVertexAttribArray(edgeShader->m_inNor);
 
+			if (m_gpuSkinning)
+			{
+				m_mmdModel->BindSkinningVertexAttributes(edgeShader->m_prog);
+			}
+
 			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mmdModel->GetIBO());
 
 			glBindVertexArray(0);
 
 			// Shadow
+			matShader.m_shadowShaderIndex = m_drawContext->GetShadowShaderIndex(define);
+			if (matShader.m_shadowShaderIndex == -1)
+			{
+				SABA_ERROR("MMD Shadow Shader not found.");
+				return false;
+			}
 			if (!matShader.m_shadowVao.Create())
 			{
 				SABA_ERROR("Vertex Array Object Create fail.");
@@ -110,11 +141,16 @@ namespace saba
 			}
 
 			glBindVertexArray(matShader.m_shadowVao);
-			auto shadowShader = m_drawContext->GetViewerContext()->GetShadowMap()->GetShader();
+			auto shadowShader = m_drawContext->GetShadowShader(matShader.m_shadowShaderIndex);
 
 			m_mmdModel->GetPositionBinder().Bind(shadowShader->m_inPos, m_mmdModel->GetPositionVBO());
 			glEnableVertexAttribArray(shadowShader->m_inPos);
 
+			if (m_gpuSkinning)
+			{
+				m_mmdModel->BindSkinningVertexAttributes(shadowShader->m_prog);
+			}
+
 			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mmdModel->GetIBO());
 
 			glBindVertexArray(0);
@@ -138,9 +174,14 @@ namespace saba
 
 			glBindVertexArray(matShader.m_mmdGroundShadowVao);
 
-			m_mmdModel->GetPositionBinder().Bind(edgeShader->m_inPos, m_mmdModel->GetPositionVBO());
+			m_mmdModel->GetPositionBinder().Bind(groundShadowShader->m_inPos, m_mmdModel->GetPositionVBO());
 			glEnableVertexAttribArray(groundShadowShader->m_inPos);
 
+			if (m_gpuSkinning)
+			{
+				m_mmdModel->BindSkinningVertexAttributes(groundShadowShader->m_prog);
+			}
+
 			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mmdModel->GetIBO());
 
 			glBindVertexArray(0);
@@ -159,6 +200,23 @@ namespace saba
 		m_selectedNode = nullptr;
 	}
 
+	void GLMMDModelDrawer::SyncGPUSkinning()
+	{
+		if (m_gpuSkinning == m_mmdModel->IsEnabledGPUSkinning())
+		{
+			return;
+		}
+
+		m_materialShaders.clear();
+		if (!Create() && m_gpuSkinning)
+		{
+			SABA_WARN("GPU Skinning Shader Create fail. Use CPU Skinning.");
+			m_mmdModel->EnableGPUSkinning(false);
+			m_materialShaders.clear();
+			Create();
+		}
+	}
+
 	void GLMMDModelDrawer::DrawUI(ViewerContext * ctxt)
 	{
 		if (ImGui::TreeNode("Bone"))
@@ -305,12 +363,56 @@ namespace saba
 			}
 			ImGui::TreePop();
 		}
+		if (m_mmdModel->GetLODCount() > 1 && ImGui::TreeNode("LOD"))
+		{
+			ImGui::Text("LOD : %d / %d", (int)m_mmdModel->GetLOD(), (int)m_mmdModel->GetLODCount());
+			ImGui::Text("Approximate Skinning : %s",
+				m_mmdModel->GetMMDModel()->IsApproximateSkinning() ? "On" : "Off");
+			float lodDistance = m_mmdModel->GetLODDistance();
+			if (ImGui::InputFloat("LOD Distance", &lodDistance, 0, 0, 1))
+			{
+				m_mmdModel->SetLODDistance(std::max(lodDistance, 0.0f));
+			}
+			float approxDistance = m_mmdModel->GetApproxSkinningDistance();
+			if (ImGui::InputFloat("Approx Skinning Distance", &approxDistance, 0, 0, 1))
+			{
+				m_mmdModel->SetApproxSkinningDistance(std::max(approxDistance, 0.0f));
+			}
+			ImGui::TreePop();
+		}
+		if (ImGui::TreeNode("Skinning"))
+		{
+			bool gpuSkinning = m_mmdModel->IsEnabledGPUSkinning();
+			if (ImGui::Checkbox("GPU Skinning", &gpuSkinning))
+			{
+				m_mmdModel->EnableGPUSkinning(gpuSkinning);
+				SyncGPUSkinning();
+			}
+			ImGui::TreePop();
+		}
+		if (ImGui::TreeNode("Update Interval"))
+		{
+			bool autoInterval = m_mmdModel->IsEnabledAutoUpdateInterval();
+			if (ImGui::Checkbox("Auto", &autoInterval))
+			{
+				m_mmdModel->EnableAutoUpdateInterval(autoInterval);
+			}
+			int interval = int(m_mmdModel->GetUpdateInterval());
+			if (ImGui::SliderInt("Interval", &interval, 1, 8))
+			{
+				m_mmdModel->SetUpdateInterval(uint32_t(interval));
+			}
+			ImGui::TreePop();
+		}
 	}
 
 	void GLMMDModelDrawer::DrawShadowMap(ViewerContext * ctxt, size_t csmIdx)
 	{
+		SABA_TRACE_SCOPE("GLMMDModelDrawer::DrawShadowMap");
+
+		SyncGPUSkinning();
+
 		const auto shadowMap = ctxt->GetShadowMap();
-		const auto shader = shadowMap->GetShader();
 		const auto& clipSpace = shadowMap->GetClipSpace(csmIdx);
 
 		const auto& world = GetTransform();
@@ -318,8 +420,12 @@ namespace saba
 		const auto& proj = clipSpace.m_projection;
 		auto wvp = proj * view * world;
 
-		glUseProgram(shader->m_prog);
-		SetUniform(shader->m_uWVP, wvp);
+		if (m_gpuSkinning)
+		{
+			glActiveTexture(GL_TEXTURE0 + BoneTransformTextureUnit);
+			glBindTexture(GL_TEXTURE_BUFFER, m_mmdModel->GetBoneTransformTexture());
+			glActiveTexture(GL_TEXTURE0);
+		}
 
 		for (const auto& subMesh : m_mmdModel->GetSubMeshes())
 		{
@@ -331,6 +437,11 @@ namespace saba
 				continue;
 			}
 
+			auto shader = m_drawContext->GetShadowShader(matShader.m_shadowShaderIndex);
+			glUseProgram(shader->m_prog);
+			SetUniform(shader->m_uWVP, wvp);
+			SetUniform(shader->m_uBoneTransforms, BoneTransformTextureUnit);
+
 			glBindVertexArray(matShader.m_shadowVao);
 
 			if (mmdMat.m_bothFace)
@@ -355,6 +466,13 @@ namespace saba
 		}
 
 		glUseProgram(0);
+
+		if (m_gpuSkinning)
+		{
+			glActiveTexture(GL_TEXTURE0 + BoneTransformTextureUnit);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+			glActiveTexture(GL_TEXTURE0);
+		}
 	}
 
 	void GLMMDModelDrawer::Play()
@@ -372,10 +490,28 @@ namespace saba
 
 	void GLMMDModelDrawer::Update(ViewerContext * ctxt)
 	{
+		SABA_TRACE_SCOPE("GLMMDModelDrawer::Update");
+
+		SyncGPUSkinning();
+
 		m_mmdModel->ClearPerfInfo();
 
+		// 視点からバウンディングボックスの中心までの距離で LOD と更新間隔を選ぶ
+		const auto& transform = GetTransform();
+		glm::vec3 center = glm::vec3(transform * glm::vec4((GetBBoxMin() + GetBBoxMax()) * 0.5f, 1.0f));
+		float distance = glm::length(ctxt->GetCamera()->GetEyePostion() - center);
+		float radius = glm::length(GetBBoxMax() - GetBBoxMin()) * 0.5f * glm::length(glm::vec3(transform[0]));
+		float screenSize = radius * ctxt->GetCamera()->GetProjectionMatrix()[1][1] / std::max(distance, 0.001f);
+		m_mmdModel->SelectUpdateInterval(screenSize);
+
 		double animTime = ctxt->GetAnimationTime();
 		double elapsed = ctxt->GetElapsed();
+		if (!m_mmdModel->StepUpdateFrame(elapsed, &elapsed))
+		{
+			m_mmdModel->UpdateInterpolation();
+			return;
+		}
+
 		if (ctxt->GetPlayMode() != ViewerContext::PlayMode::Stop)
 		{
 			m_mmdModel->UpdateAnimation(animTime, elapsed);
@@ -385,12 +521,18 @@ namespace saba
 			m_mmdModel->UpdateAnimationIgnoreVMD(elapsed);
 		}
 
+		m_mmdModel->SelectLOD(distance);
+
 		m_mmdModel->Update();
 	}
 
 
 	void GLMMDModelDrawer::Draw(ViewerContext * ctxt)
 	{
+		SABA_TRACE_SCOPE("GLMMDModelDrawer::Draw");
+
+		SyncGPUSkinning();
+
 		const auto& view = ctxt->GetCamera()->GetViewMatrix();
 		const auto& proj = ctxt->GetCamera()->GetProjectionMatrix();
 
@@ -440,6 +582,12 @@ namespace saba
 			}
 		}
 
+		if (m_gpuSkinning)
+		{
+			glActiveTexture(GL_TEXTURE0 + BoneTransformTextureUnit);
+			glBindTexture(GL_TEXTURE_BUFFER, m_mmdModel->GetBoneTransformTexture());
+		}
+
 		for (const auto& subMesh : m_mmdModel->GetSubMeshes())
 		{
 			int matID = subMesh.m_materialID;
@@ -457,6 +605,7 @@ namespace saba
 
 			SetUniform(shader->m_uWV, wv);
 			SetUniform(shader->m_uWVP, wvp);
+			SetUniform(shader->m_uBoneTransforms, BoneTransformTextureUnit);
 
 			bool alphaBlend = true;
 
@@ -628,6 +777,7 @@ namespace saba
 				SetUniform(shader->m_uScreenSize, screenSize);
 				SetUniform(shader->m_uEdgeSize, mmdMat.m_edgeSize);
 				SetUniform(shader->m_uEdgeColor, mmdMat.m_edgeColor);
+				SetUniform(shader->m_uBoneTransforms, BoneTransformTextureUnit);
 
 				bool alphaBlend = true;
 
@@ -724,6 +874,7 @@ namespace saba
 
 				SetUniform(shader->m_uWVP, wsvp);
 				SetUniform(shader->m_uShadowColor, shadowColor);
+				SetUniform(shader->m_uBoneTransforms, BoneTransformTextureUnit);
 
 				size_t offset = subMesh.m_beginIndex * m_mmdModel->GetIndexTypeSize();
 				glDrawElements(
@@ -742,6 +893,13 @@ namespace saba
 			glDisable(GL_BLEND);
 		}
 
+		if (m_gpuSkinning)
+		{
+			glActiveTexture(GL_TEXTURE0 + BoneTransformTextureUnit);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+			glActiveTexture(GL_TEXTURE0);
+		}
+
 		glBindVertexArray(0);
 		glUseProgram(0);
 
@@ -52,17 +52,22 @@ namespace saba
 			int					m_mmdEdgeShaderIndex = -1;
 			GLVertexArrayObject	m_mmdEdgeVao;
 
+			int					m_shadowShaderIndex = -1;
 			GLVertexArrayObject	m_shadowVao;
 
 			int					m_mmdGroundShadowShaderIndex = -1;
 			GLVertexArrayObject	m_mmdGroundShadowVao;
 		};
 
+		// GLMMDModel の GPU スキニングを切り替えた場合、シェーダーと VAO を作り直す
+		void SyncGPUSkinning();
+
 	private:
 		GLMMDModelDrawContext*		m_drawContext;
 		std::shared_ptr<GLMMDModel>	m_mmdModel;
 
 		std::vector<MaterialShader>	m_materialShaders;
+		bool						m_gpuSkinning;	//!< m_materialShaders が MMD_SKINNING 用か
 
 		// IMGui
 		bool		m_clipElapsed;
@@ -0,0 +1,370 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "GLMMDModelLoader.h"
+#include <Saba/GL/GLTextureUtil.h>
+#include <Saba/GL/GLTextureCache.h>
+#include <Saba/Base/Log.h>
+#include <Saba/Base/Path.h>
+#include <Saba/Base/Singleton.h>
+#include <Saba/Base/ThreadPool.h>
+#include <Saba/Base/Time.h>
+#include <Saba/Model/MMD/PMDModel.h>
+#include <Saba/Model/MMD/PMXModel.h>
+
+#include <chrono>
+#include <deque>
+#include <future>
+#include <map>
+#include <mutex>
+
+namespace saba
+{
+	namespace
+	{
+		struct TextureSlotRef
+		{
+			size_t					m_materialIndex;
+			GLMMDModel::TextureSlot	m_slot;
+		};
+
+		struct TextureJob
+		{
+			std::string					m_filename;
+			std::vector<TextureSlotRef>	m_slots;
+			TextureImage				m_image;
+			bool						m_success = false;
+			bool						m_cached = false;	//!< キャッシュ済みなのでデコードしていない
+		};
+	}
+
+	// ワーカースレッドと共有するデータ (GL オブジェクトは持たない)
+	struct GLMMDModelLoader::Job
+	{
+		std::string	m_filepath;
+		std::string	m_mmdDataDir;
+		size_t		m_parallelUpdateCount = 0;
+		size_t		m_lodCount = 1;
+		bool		m_useCache = false;
+		bool		m_shareCache = false;
+		bool		m_optimizeVertexCache = false;
+
+		std::future<bool>			m_loadFuture;
+		std::shared_ptr<MMDModel>	m_mmdModel;
+		glm::vec3					m_bboxMin;
+		glm::vec3					m_bboxMax;
+
+		std::vector<std::shared_ptr<TextureJob>>	m_textures;
+
+		std::mutex								m_decodedMutex;
+		std::deque<std::shared_ptr<TextureJob>>	m_decodedTextures;
+		size_t									m_remainTextureCount = 0;
+	};
+
+	namespace
+	{
+		void AddTextureSlot(
+			std::map<std::string, std::shared_ptr<TextureJob>>& textureMap,
+			const std::string& filename,
+			size_t materialIndex,
+			GLMMDModel::TextureSlot slot
+		)
+		{
+			if (filename.empty())
+			{
+				return;
+			}
+			auto& texJob = textureMap[filename];
+			if (texJob == nullptr)
+			{
+				texJob = std::make_shared<TextureJob>();
+				texJob->m_filename = filename;
+			}
+			texJob->m_slots.push_back(TextureSlotRef{ materialIndex, slot });
+		}
+
+		// LOD とキャッシュは PMX のみ対応
+		void SetLODHint(PMXModel* model, size_t lodCount) { model->SetLODHint(lodCount); }
+		void SetLODHint(MMDModel*, size_t) {}
+		void EnableCache(PMXModel* model, bool useCache, bool shareCache)
+		{
+			model->EnableCache(useCache);
+			model->EnableSharedCache(shareCache);
+		}
+		void EnableCache(MMDModel*, bool, bool) {}
+		void EnableVertexCacheOptimization(PMXModel* model, bool enable) { model->EnableVertexCacheOptimization(enable); }
+		void EnableVertexCacheOptimization(MMDModel*, bool) {}
+
+		template <typename ModelType>
+		std::shared_ptr<MMDModel> LoadMMDModel(
+			const std::string& filepath,
+			const std::string& mmdDataDir,
+			size_t parallelUpdateCount,
+			size_t lodCount,
+			bool useCache,
+			bool shareCache,
+			bool optimizeVertexCache,
+			glm::vec3* bboxMin,
+			glm::vec3* bboxMax
+		)
+		{
+			auto model = std::make_shared<ModelType>();
+			model->SetParallelUpdateHint(uint32_t(parallelUpdateCount));
+			SetLODHint(model.get(), lodCount);
+			EnableCache(model.get(), useCache, shareCache);
+			EnableVertexCacheOptimization(model.get(), optimizeVertexCache);
+			if (!model->Load(filepath, mmdDataDir))
+			{
+				return nullptr;
+			}
+			*bboxMin = model->GetBBoxMin();
+			*bboxMax = model->GetBBoxMax();
+			return model;
+		}
+	}
+
+	GLMMDModelLoader::GLMMDModelLoader()
+	{
+	}
+
+	GLMMDModelLoader::~GLMMDModelLoader()
+	{
+		// ワーカーは Job の共有ポインタを持っているので、ここでは完了を待たない
+		m_entries.clear();
+	}
+
+	void GLMMDModelLoader::Load(const std::string& filepath, const std::string& mmdDataDir, size_t parallelUpdateCount, size_t lodCount, bool useCache, bool shareCache, bool optimizeVertexCache)
+	{
+		auto job = std::make_shared<Job>();
+		job->m_filepath = filepath;
+		job->m_mmdDataDir = mmdDataDir;
+		job->m_parallelUpdateCount = parallelUpdateCount;
+		job->m_lodCount = lodCount;
+		job->m_useCache = useCache;
+		job->m_shareCache = shareCache;
+		job->m_optimizeVertexCache = optimizeVertexCache;
+
+		auto pool = Singleton<ThreadPool>::Get();
+		job->m_loadFuture = pool->Enqueue([job, pool]()
+		{
+			double loadStart = GetTime();
+			std::string ext = PathUtil::GetExt(job->m_filepath);
+			if (ext == "pmx")
+			{
+				job->m_mmdModel = LoadMMDModel<PMXModel>(
+					job->m_filepath, job->m_mmdDataDir, job->m_parallelUpdateCount, job->m_lodCount, job->m_useCache, job->m_shareCache, job->m_optimizeVertexCache,
+					&job->m_bboxMin, &job->m_bboxMax);
+			}
+			else if (ext == "pmd")
+			{
+				job->m_mmdModel = LoadMMDModel<PMDModel>(
+					job->m_filepath, job->m_mmdDataDir, job->m_parallelUpdateCount, job->m_lodCount, job->m_useCache, job->m_shareCache, job->m_optimizeVertexCache,
+					&job->m_bboxMin, &job->m_bboxMax);
+			}
+			else
+			{
+				SABA_WARN("Unknown MMD model ext. [{}]", ext);
+			}
+			if (job->m_mmdModel == nullptr)
+			{
+				return false;
+			}
+			SABA_INFO("MMD Model Load: {} [{} ms]", job->m_filepath, (GetTime() - loadStart) * 1000.0);
+
+			// 同じファイルは一度だけデコードする
+			std::map<std::string, std::shared_ptr<TextureJob>> textureMap;
+			size_t matCount = job->m_mmdModel->GetMaterialCount();
+			const MMDMaterial* materials = job->m_mmdModel->GetMaterials();
+			for (size_t matIdx = 0; matIdx < matCount; matIdx++)
+			{
+				const auto& mat = materials[matIdx];
+				AddTextureSlot(textureMap, mat.m_texture, matIdx, GLMMDModel::TextureSlot::Texture);
+				AddTextureSlot(textureMap, mat.m_spTexture, matIdx, GLMMDModel::TextureSlot::SphereTexture);
+				AddTextureSlot(textureMap, mat.m_toonTexture, matIdx, GLMMDModel::TextureSlot::ToonTexture);
+			}
+			for (auto& tex : textureMap)
+			{
+				job->m_textures.push_back(tex.second);
+			}
+			job->m_remainTextureCount = job->m_textures.size();
+
+			auto texCache = Singleton<GLTextureCache>::Get();
+			for (auto& texJob : job->m_textures)
+			{
+				if (texCache->Contains(texJob->m_filename))
+				{
+					texJob->m_cached = true;
+					std::unique_lock<std::mutex> lock(job->m_decodedMutex);
+					job->m_decodedTextures.push_back(texJob);
+					continue;
+				}
+				pool->Enqueue([job, texJob, texCache]()
+				{
+					texJob->m_success = texCache->LoadImage(&texJob->m_image, texJob->m_filename);
+					std::unique_lock<std::mutex> lock(job->m_decodedMutex);
+					job->m_decodedTextures.push_back(texJob);
+				});
+			}
+			return true;
+		});
+
+		Entry entry;
+		entry.m_job = std::move(job);
+		m_entries.emplace_back(std::move(entry));
+	}
+
+	bool GLMMDModelLoader::CreateModel(Entry* entry, std::vector<LoadedModel>* loadedModels)
+	{
+		auto& job = entry->m_job;
+		if (!job->m_loadFuture.get())
+		{
+			SABA_WARN("MMD Model Load Fail. [{}]", job->m_filepath);
+			return false;
+		}
+
+		auto glMMDModel = std::make_shared<GLMMDModel>();
+		if (!glMMDModel->Create(job->m_mmdModel, false))
+		{
+			SABA_WARN("GLMMDModel Create Fail.");
+			return false;
+		}
+
+		if (m_dummyTexture == 0)
+		{
+			TextureImage white;
+			white.m_format = TextureImage::Format::R8G8B8;
+			white.m_width = 1;
+			white.m_height = 1;
+			white.m_data.assign(3, 255);
+			m_dummyTexture = CreateTextureFromImage(white, false);
+		}
+
+		// 転送が終わるまでは白いテクスチャで描画する
+		// スフィアテクスチャは加算モードがあるので設定しない
+		for (const auto& texJob : job->m_textures)
+		{
+			for (const auto& slot : texJob->m_slots)
+			{
+				if (slot.m_slot != GLMMDModel::TextureSlot::SphereTexture)
+				{
+					glMMDModel->SetMaterialTexture(slot.m_materialIndex, slot.m_slot, m_dummyTexture);
+				}
+			}
+		}
+
+		entry->m_model = glMMDModel;
+
+		LoadedModel loadedModel;
+		loadedModel.m_filepath = job->m_filepath;
+		loadedModel.m_model = glMMDModel;
+		loadedModel.m_bboxMin = job->m_bboxMin;
+		loadedModel.m_bboxMax = job->m_bboxMax;
+		loadedModels->emplace_back(std::move(loadedModel));
+		return true;
+	}
+
+	void GLMMDModelLoader::Update(double uploadTimeBudget, std::vector<LoadedModel>* loadedModels)
+	{
+		double startTime = GetTime();
+		bool uploaded = false;
+		for (auto entryIt = m_entries.begin(); entryIt != m_entries.end();)
+		{
+			auto& entry = *entryIt;
+			auto& job = entry.m_job;
+			if (entry.m_model == nullptr)
+			{
+				auto status = job->m_loadFuture.wait_for(std::chrono::seconds(0));
+				if (status != std::future_status::ready)
+				{
+					++entryIt;
+					continue;
+				}
+				if (!CreateModel(&entry, loadedModels))
+				{
+					entryIt = m_entries.erase(entryIt);
+					continue;
+				}
+			}
+
+			while (job->m_remainTextureCount != 0)
+			{
+				if (uploaded && (GetTime() - startTime) > uploadTimeBudget)
+				{
+					break;
+				}
+
+				std::shared_ptr<TextureJob> texJob;
+				{
+					std::unique_lock<std::mutex> lock(job->m_decodedMutex);
+					if (job->m_decodedTextures.empty())
+					{
+						break;
+					}
+					texJob = job->m_decodedTextures.front();
+					job->m_decodedTextures.pop_front();
+				}
+
+				GLTextureRef tex;
+				auto texCache = Singleton<GLTextureCache>::Get();
+				if (texJob->m_cached)
+				{
+					// デコード後に破棄されていた場合はここで読み込む
+					tex = texCache->Get(texJob->m_filename);
+				}
+				else if (texJob->m_success)
+				{
+					tex = texCache->Add(texJob->m_filename, true, false, texJob->m_image);
+					SABA_INFO("LoadTexture: [{}] Success", texJob->m_filename);
+				}
+				else
+				{
+					SABA_WARN("LoadTexture: [{}] Fail", texJob->m_filename);
+				}
+				for (const auto& slot : texJob->m_slots)
+				{
+					entry.m_model->SetMaterialTexture(slot.m_materialIndex, slot.m_slot, tex);
+				}
+				texJob->m_image = TextureImage();
+				job->m_remainTextureCount--;
+				uploaded = true;
+			}
+
+			if (job->m_remainTextureCount == 0)
+			{
+				SABA_INFO("MMD Model Textures Ready: {}", job->m_filepath);
+				entryIt = m_entries.erase(entryIt);
+			}
+			else
+			{
+				++entryIt;
+			}
+		}
+	}
+
+	bool GLMMDModelLoader::IsLoadingModel() const
+	{
+		for (const auto& entry : m_entries)
+		{
+			if (entry.m_model == nullptr)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	size_t GLMMDModelLoader::GetPendingTextureCount() const
+	{
+		size_t count = 0;
+		for (const auto& entry : m_entries)
+		{
+			if (entry.m_model != nullptr)
+			{
+				count += entry.m_job->m_remainTextureCount;
+			}
+		}
+		return count;
+	}
+}
@@ -0,0 +1,77 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_GL_MODEL_MMD_GLMMDMODELLOADER_H_
+#define SABA_GL_MODEL_MMD_GLMMDMODELLOADER_H_
+
+#include "GLMMDModel.h"
+#include <Saba/GL/GLObject.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+namespace saba
+{
+	/*
+		PMX/PMD の読み込みとテクスチャのデコードをワーカースレッドで行う.
+		GL オブジェクトの作成とテクスチャの転送は Update を呼んだスレッド(GL コンテキスト)で行う.
+		テクスチャは転送が終わるまで仮のテクスチャを使い、1 フレームあたりの転送時間を制限する.
+	*/
+	class GLMMDModelLoader
+	{
+	public:
+		GLMMDModelLoader();
+		~GLMMDModelLoader();
+
+		GLMMDModelLoader(const GLMMDModelLoader&) = delete;
+		GLMMDModelLoader& operator = (const GLMMDModelLoader&) = delete;
+
+		struct LoadedModel
+		{
+			std::string					m_filepath;
+			std::shared_ptr<GLMMDModel>	m_model;
+			glm::vec3					m_bboxMin;
+			glm::vec3					m_bboxMax;
+		};
+
+		// lodCount : PMX の LOD 数 (1 : LOD を作らない)
+		// useCache : PMX の変換済みキャッシュを使う (PMXModel::EnableCache)
+		// shareCache : キャッシュを他のプロセスと共有する (PMXModel::EnableSharedCache)
+		// optimizeVertexCache : インデックスを頂点キャッシュ向けに並べ替える (PMXModel::EnableVertexCacheOptimization)
+		void Load(const std::string& filepath, const std::string& mmdDataDir, size_t parallelUpdateCount, size_t lodCount = 1, bool useCache = false, bool shareCache = false, bool optimizeVertexCache = false);
+
+		/*
+		読み込みが完了したモデルを loadedModels に追加し、
+		デコード済みのテクスチャを uploadTimeBudget (秒) の範囲で転送する.
+		時間が足りなくても最低 1 枚は転送する.
+		*/
+		void Update(double uploadTimeBudget, std::vector<LoadedModel>* loadedModels);
+
+		// モデル本体の読み込み待ちがあるか
+		bool IsLoadingModel() const;
+		// テクスチャの転送待ちも含めて処理中か
+		bool IsBusy() const { return !m_entries.empty(); }
+		size_t GetPendingTextureCount() const;
+
+	private:
+		struct Job;
+		struct Entry
+		{
+			std::shared_ptr<Job>		m_job;
+			std::shared_ptr<GLMMDModel>	m_model;
+		};
+
+		bool CreateModel(Entry* entry, std::vector<LoadedModel>* loadedModels);
+
+	private:
+		std::vector<Entry>	m_entries;
+		GLTextureRef		m_dummyTexture;
+	};
+}
+
+#endif // !SABA_GL_MODEL_MMD_GLMMDMODELLOADER_H_
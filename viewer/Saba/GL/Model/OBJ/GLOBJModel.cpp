@@ -60,56 +60,35 @@ namespace saba
 			m_materials.push_back(mat);
 		}
 
-		// Meshを作成
-		using MB = MeshBuilder;
-		MB mb;
-		auto objPos = objModel.GetPositions();
-		auto objNor = objModel.GetNormals();
-		auto objUV = objModel.GetUVs();
-		std::vector<glm::vec3>* positions;
-		std::vector<glm::vec3>* normals;
-		std::vector<glm::vec2>* uvs;
-		auto posID = mb.AddComponent(&positions);
-		auto norID = mb.AddComponent(&normals);
-		auto uvID = mb.AddComponent(&uvs);
-		*positions = objPos;
-		*normals = objNor;
-		*uvs = objUV;
+		// Meshを作成 (頂点の重複を取り除いたインデックス付きのメッシュ)
+		const auto& mesh = objModel.GetMesh();
 		m_bboxMin = objModel.GetBBoxMin();
 		m_bboxMax = objModel.GetBBoxMax();
 
-		auto objFaces = objModel.GetFaces();
-		for (const auto& face : objFaces)
-		{
-			auto polyID = mb.AddPolygon();
-			mb.SetPolygon(polyID, posID, face.m_position[0], face.m_position[1], face.m_position[2]);
-			mb.SetPolygon(polyID, norID, face.m_normal[0], face.m_normal[1], face.m_normal[2]);
-			mb.SetPolygon(polyID, uvID, face.m_uv[0], face.m_uv[1], face.m_uv[2]);
-			mb.SetFaceMaterial(polyID, face.m_material);
-		}
-		mb.SortFaces();
-
-		std::vector<MB::SubMesh> objSubMeshes;
-		mb.MakeSubMeshList(&objSubMeshes);
-
 		m_subMeshes.clear();
-		m_subMeshes.reserve(objSubMeshes.size());
-		for (const auto& objSubMesh : objSubMeshes)
+		m_subMeshes.reserve(mesh.m_subMeshes.size());
+		for (const auto& objSubMesh : mesh.m_subMeshes)
 		{
 			SubMesh subMesh;
-			subMesh.m_beginIndex = (int)objSubMesh.m_startIndex;
-			subMesh.m_vertexCount = (int)objSubMesh.m_numVertices;
+			subMesh.m_beginIndex = (int)objSubMesh.m_beginIndex;
+			subMesh.m_vertexCount = (int)objSubMesh.m_indexCount;
 			subMesh.m_materialID = objSubMesh.m_material;
 			m_subMeshes.push_back(subMesh);
 		}
 
-		m_posVBO = mb.CreateVBO(posID);
-		m_norVBO = mb.CreateVBO(norID);
-		m_uvVBO = mb.CreateVBO(uvID);
+		if (mesh.m_indices.empty())
+		{
+			return true;
+		}
+
+		m_posVBO = CreateVBO(mesh.m_positions);
+		m_norVBO = CreateVBO(mesh.m_normals);
+		m_uvVBO = CreateVBO(mesh.m_uvs);
+		m_ibo = CreateIBO(mesh.m_indices);
 
-		m_posBinder = mb.MakeVertexBinder(posID);
-		m_norBinder = mb.MakeVertexBinder(norID);
-		m_uvBinder = mb.MakeVertexBinder(uvID);
+		m_posBinder = MakeVertexBinder<glm::vec3>();
+		m_norBinder = MakeVertexBinder<glm::vec3>();
+		m_uvBinder = MakeVertexBinder<glm::vec2>();
 
 		return true;
 	}
@@ -119,6 +98,7 @@ namespace saba
 		m_posVBO.Destroy();
 		m_norVBO.Destroy();
 		m_uvVBO.Destroy();
+		m_ibo.Destroy();
 		m_materials.clear();
 		m_subMeshes.clear();
 	}
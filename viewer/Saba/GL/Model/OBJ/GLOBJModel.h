@@ -31,6 +31,7 @@ namespace saba
 			GLTextureRef	m_transparencyTex;
 		};
 
+		// m_beginIndex, m_vertexCount は IBO (uint32_t) 内の位置と数
 		struct SubMesh
 		{
 			int	m_beginIndex;
@@ -51,6 +52,7 @@ namespace saba
 		const GLBufferObject& GetPositionVBO() const { return m_posVBO; }
 		const GLBufferObject& GetNormalVBO() const { return m_norVBO; }
 		const GLBufferObject& GetUVVBO() const { return m_uvVBO; }
+		const GLBufferObject& GetIBO() const { return m_ibo; }
 
 		const VertexBinder& GetPositionBinder() const { return m_posBinder; }
 		const VertexBinder& GetNormalBinder() const { return m_norBinder; }
@@ -63,6 +65,7 @@ namespace saba
 		GLBufferObject	m_posVBO;
 		GLBufferObject	m_norVBO;
 		GLBufferObject	m_uvVBO;
+		GLBufferObject	m_ibo;
 
 		VertexBinder	m_posBinder;
 		VertexBinder	m_norBinder;
@@ -93,6 +93,8 @@ namespace saba
 				glEnableVertexAttribArray(objShader->m_inUV);
 			}
 
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_objModel->GetIBO());
+
 			glBindVertexArray(0);
 
 			m_materialShaders.emplace_back(std::move(matShader));
@@ -186,7 +188,13 @@ namespace saba
 				glUniform1i(objShader->m_uTransparencyTex, 3);
 			}
 
-			glDrawArrays(GL_TRIANGLES, subMesh.m_beginIndex, subMesh.m_vertexCount);
+			size_t offset = subMesh.m_beginIndex * sizeof(uint32_t);
+			glDrawElements(
+				GL_TRIANGLES,
+				subMesh.m_vertexCount,
+				GL_UNSIGNED_INT,
+				(GLvoid*)offset
+			);
 
 			glActiveTexture(GL_TEXTURE0 + 3);
 			glBindTexture(GL_TEXTURE_2D, 0);
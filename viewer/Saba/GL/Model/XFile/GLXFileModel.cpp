@@ -71,47 +71,30 @@ namespace saba
 				mesh->m_materials.emplace_back(std::move(mat));
 			}
 
-			// build mesh
-			using MB = MeshBuilder;
-			MB mb;
-			std::vector<glm::vec3>* positions;
-			std::vector<glm::vec3>* normals;
-			std::vector<glm::vec2>* uvs;
-			auto posID = mb.AddComponent(&positions);
-			auto norID = mb.AddComponent(&normals);
-			auto uvID = mb.AddComponent(&uvs);
-			*positions = xmesh->m_positions;
-			*normals = xmesh->m_normals;
-			*uvs = xmesh->m_uvs;
-
-			for (const auto& xface : xmesh->m_faces)
+			// build mesh (頂点の重複を取り除いたインデックス付きのメッシュ)
+			const auto& indexedMesh = xmesh->m_indexedMesh;
+			for (const auto& xsubMesh : indexedMesh.m_subMeshes)
 			{
-				auto polyID = mb.AddPolygon();
-				mb.SetPolygon(polyID, posID, xface.m_position[0], xface.m_position[1], xface.m_position[2]);
-				mb.SetPolygon(polyID, norID, xface.m_normal[0], xface.m_normal[1], xface.m_normal[2]);
-				mb.SetPolygon(polyID, uvID, xface.m_uv[0], xface.m_uv[1], xface.m_uv[2]);
-				mb.SetFaceMaterial(polyID, xface.m_material);
+				SubMesh subMesh;
+				subMesh.m_beginIndex = (int)xsubMesh.m_beginIndex;
+				subMesh.m_vertexCount = (int)xsubMesh.m_indexCount;
+				subMesh.m_materialID = xsubMesh.m_material;
+				mesh->m_subMeshes.emplace_back(std::move(subMesh));
 			}
-			mb.SortFaces();
 
-			std::vector<MB::SubMesh> mbSubMeshes;
-			mb.MakeSubMeshList(&mbSubMeshes);
-			for (const auto& mbSubMesh : mbSubMeshes)
+			if (indexedMesh.m_indices.empty())
 			{
-				SubMesh subMesh;
-				subMesh.m_beginIndex = (int)mbSubMesh.m_startIndex;
-				subMesh.m_vertexCount = (int)mbSubMesh.m_numVertices;
-				subMesh.m_materialID = mbSubMesh.m_material;
-				mesh->m_subMeshes.emplace_back(std::move(subMesh));
+				continue;
 			}
 
-			mesh->m_posVBO = mb.CreateVBO(posID);
-			mesh->m_norVBO = mb.CreateVBO(norID);
-			mesh->m_uvVBO = mb.CreateVBO(uvID);
+			mesh->m_posVBO = CreateVBO(indexedMesh.m_positions);
+			mesh->m_norVBO = CreateVBO(indexedMesh.m_normals);
+			mesh->m_uvVBO = CreateVBO(indexedMesh.m_uvs);
+			mesh->m_ibo = CreateIBO(indexedMesh.m_indices);
 
-			mesh->m_posBinder = mb.MakeVertexBinder(posID);
-			mesh->m_norBinder = mb.MakeVertexBinder(norID);
-			mesh->m_uvBinder = mb.MakeVertexBinder(uvID);
+			mesh->m_posBinder = MakeVertexBinder<glm::vec3>();
+			mesh->m_norBinder = MakeVertexBinder<glm::vec3>();
+			mesh->m_uvBinder = MakeVertexBinder<glm::vec2>();
 		}
 
 		m_bboxMax = xfileModel.GetBBoxMax();
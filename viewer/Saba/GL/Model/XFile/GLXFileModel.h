@@ -30,6 +30,7 @@ namespace saba
 			GLTextureRef	m_spTexture;
 		};
 
+		// m_beginIndex, m_vertexCount は IBO (uint32_t) 内の位置と数
 		struct SubMesh
 		{
 			int	m_beginIndex;
@@ -42,6 +43,7 @@ namespace saba
 			GLBufferObject	m_posVBO;
 			GLBufferObject	m_norVBO;
 			GLBufferObject	m_uvVBO;
+			GLBufferObject	m_ibo;
 
 			VertexBinder	m_posBinder;
 			VertexBinder	m_norBinder;
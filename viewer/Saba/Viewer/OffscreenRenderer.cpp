@@ -0,0 +1,468 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#include "OffscreenRenderer.h"
+#include "VMDCameraOverrider.h"
+
+#include <Saba/Base/Log.h>
+#include <Saba/Base/Path.h>
+#include <Saba/Base/Singleton.h>
+#include <Saba/GL/GLTextureCache.h>
+#include <Saba/GL/Model/MMD/GLMMDModel.h>
+#include <Saba/Model/MMD/PMDModel.h>
+#include <Saba/Model/MMD/PMXModel.h>
+#include <Saba/Model/MMD/VMDFile.h>
+
+#include <algorithm>
+
+namespace saba
+{
+	OffscreenRenderer::OffscreenRenderer()
+		: m_bboxMin(-1)
+		, m_bboxMax(1)
+		, m_readbackHead(0)
+		, m_readbackCount(0)
+		, m_bgColor(1.0f)
+		, m_fps(30.0)
+		, m_frame(0)
+	{
+	}
+
+	OffscreenRenderer::~OffscreenRenderer()
+	{
+	}
+
+	bool OffscreenRenderer::Initialize(const InitializeParameter& param)
+	{
+		m_param = param;
+		m_param.m_readbackBufferCount = std::max(m_param.m_readbackBufferCount, size_t(1));
+		if (m_param.m_width <= 0 || m_param.m_height <= 0)
+		{
+			SABA_ERROR("Invalid frame size. [{} x {}]", m_param.m_width, m_param.m_height);
+			return false;
+		}
+
+		if (!m_param.m_resourceDir.empty())
+		{
+			m_context.m_resourceDir = m_param.m_resourceDir;
+			m_context.m_shaderDir = PathUtil::Combine(m_param.m_resourceDir, u8"shader");
+		}
+		m_context.SetFrameBufferSize(m_param.m_width, m_param.m_height);
+		m_context.SetWindowSize(m_param.m_width, m_param.m_height);
+		m_context.EnableMSAA(m_param.m_msaaCount > 0);
+		m_context.SetMSAACount(m_param.m_msaaCount);
+		m_context.EnableUI(false);
+		Singleton<GLTextureCache>::Get()->EnableDiskCache(m_param.m_textureDiskCache);
+		Singleton<GLTextureCache>::Get()->EnableCompression(m_param.m_textureCompression);
+		m_context.SetClipElapsed(false);
+		m_context.SetPlayMode(ViewerContext::PlayMode::Play);
+		if (!m_context.Initialize())
+		{
+			SABA_ERROR("Failed to initialize ViewerContext.");
+			return false;
+		}
+
+		m_context.m_camera.SetSize(float(m_param.m_width), float(m_param.m_height));
+		if (m_param.m_shadowMapSize > 0)
+		{
+			if (!m_context.m_shadowmap.InitializeShader(&m_context))
+			{
+				SABA_ERROR("shadowmap InitializeShader Fail.");
+				return false;
+			}
+			if (!m_context.m_shadowmap.Setup(m_param.m_shadowMapSize, m_param.m_shadowMapSize, 4))
+			{
+				SABA_ERROR("shadowmap Setup Fail.");
+				return false;
+			}
+			m_context.EnableShadow(true);
+		}
+
+		m_mmdModelDrawContext = std::make_unique<GLMMDModelDrawContext>(&m_context);
+
+		if (!SetupFramebuffer())
+		{
+			return false;
+		}
+
+		size_t bufferSize = size_t(m_param.m_width) * size_t(m_param.m_height) * 4;
+		m_readbacks.resize(m_param.m_readbackBufferCount);
+		for (auto& readback : m_readbacks)
+		{
+			readback.m_pbo.Create();
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.m_pbo);
+			glBufferData(GL_PIXEL_PACK_BUFFER, bufferSize, nullptr, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		m_readbackHead = 0;
+		m_readbackCount = 0;
+
+		SetupCamera();
+
+		return true;
+	}
+
+	void OffscreenRenderer::Uninitialize()
+	{
+		for (auto& readback : m_readbacks)
+		{
+			if (readback.m_fence != nullptr)
+			{
+				glDeleteSync(readback.m_fence);
+			}
+		}
+		m_readbacks.clear();
+		m_readbackCount = 0;
+
+		m_cameraOverrider.reset();
+		m_modelDrawers.clear();
+		m_mmdModelDrawContext.reset();
+
+		m_frameBuffer.Destroy();
+		m_colorTarget.Destroy();
+		m_depthTarget.Destroy();
+		m_msaaFrameBuffer.Destroy();
+		m_msaaColorTarget.Destroy();
+		m_msaaDepthTarget.Destroy();
+
+		m_context.Uninitialize();
+	}
+
+	bool OffscreenRenderer::SetupFramebuffer()
+	{
+		const int w = m_param.m_width;
+		const int h = m_param.m_height;
+
+		// 読み出し用 (MSAA の場合は解決先)
+		m_colorTarget.Create();
+		glBindTexture(GL_TEXTURE_2D, m_colorTarget);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		m_frameBuffer.Create();
+		glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTarget, 0);
+		if (m_param.m_msaaCount <= 0)
+		{
+			m_depthTarget.Create();
+			glBindRenderbuffer(GL_RENDERBUFFER, m_depthTarget);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
+			glBindRenderbuffer(GL_RENDERBUFFER, 0);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthTarget);
+		}
+		auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (GL_FRAMEBUFFER_COMPLETE != status)
+		{
+			SABA_ERROR("Framebuffer Status : {}", status);
+			return false;
+		}
+
+		if (m_param.m_msaaCount > 0)
+		{
+			m_msaaColorTarget.Create();
+			glBindRenderbuffer(GL_RENDERBUFFER, m_msaaColorTarget);
+			glRenderbufferStorageMultisample(GL_RENDERBUFFER, m_param.m_msaaCount, GL_RGBA8, w, h);
+			m_msaaDepthTarget.Create();
+			glBindRenderbuffer(GL_RENDERBUFFER, m_msaaDepthTarget);
+			glRenderbufferStorageMultisample(GL_RENDERBUFFER, m_param.m_msaaCount, GL_DEPTH24_STENCIL8, w, h);
+			glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+			m_msaaFrameBuffer.Create();
+			glBindFramebuffer(GL_FRAMEBUFFER, m_msaaFrameBuffer);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_msaaColorTarget);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_msaaDepthTarget);
+			status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			if (GL_FRAMEBUFFER_COMPLETE != status)
+			{
+				SABA_ERROR("MSAA Framebuffer Status : {}", status);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void OffscreenRenderer::SetupCamera()
+	{
+		if (!m_modelDrawers.empty())
+		{
+			m_bboxMin = m_modelDrawers[0]->GetBBoxMin();
+			m_bboxMax = m_modelDrawers[0]->GetBBoxMax();
+			for (const auto& modelDrawer : m_modelDrawers)
+			{
+				m_bboxMin = glm::min(m_bboxMin, modelDrawer->GetBBoxMin());
+				m_bboxMax = glm::max(m_bboxMax, modelDrawer->GetBBoxMax());
+			}
+		}
+
+		auto center = (m_bboxMax + m_bboxMin) * 0.5f;
+		auto radius = glm::length(m_bboxMax - center);
+		m_context.m_camera.Initialize(center, radius);
+		m_context.m_camera.SetSize(float(m_param.m_width), float(m_param.m_height));
+		m_context.m_shadowmap.SetClip(
+			m_context.m_camera.GetNearClip() * 10.0f, m_context.m_camera.GetFarClip() * 0.1f
+		);
+	}
+
+	bool OffscreenRenderer::LoadModel(const std::string& filepath)
+	{
+		std::string mmdDataDir = PathUtil::Combine(m_context.GetResourceDir(), "mmd");
+		std::string ext = PathUtil::GetExt(filepath);
+		std::shared_ptr<MMDModel> mmdModel;
+		glm::vec3 bboxMin;
+		glm::vec3 bboxMax;
+		if (ext == "pmx")
+		{
+			auto pmxModel = std::make_shared<PMXModel>();
+			pmxModel->EnableCache(m_param.m_modelCache);
+			pmxModel->EnableSharedCache(m_param.m_shareModelCache);
+			if (!pmxModel->Load(filepath, mmdDataDir))
+			{
+				SABA_WARN("PMX Load Fail. [{}]", filepath);
+				return false;
+			}
+			bboxMin = pmxModel->GetBBoxMin();
+			bboxMax = pmxModel->GetBBoxMax();
+			mmdModel = pmxModel;
+		}
+		else if (ext == "pmd")
+		{
+			auto pmdModel = std::make_shared<PMDModel>();
+			if (!pmdModel->Load(filepath, mmdDataDir))
+			{
+				SABA_WARN("PMD Load Fail. [{}]", filepath);
+				return false;
+			}
+			bboxMin = pmdModel->GetBBoxMin();
+			bboxMax = pmdModel->GetBBoxMax();
+			mmdModel = pmdModel;
+		}
+		else
+		{
+			SABA_WARN("Unknown MMD model ext. [{}]", ext);
+			return false;
+		}
+
+		auto glMMDModel = std::make_shared<GLMMDModel>();
+		if (!glMMDModel->Create(mmdModel))
+		{
+			SABA_WARN("GLMMDModel Create Fail.");
+			return false;
+		}
+
+		auto mmdDrawer = std::make_unique<GLMMDModelDrawer>(m_mmdModelDrawContext.get(), glMMDModel);
+		if (!mmdDrawer->Create())
+		{
+			SABA_WARN("GLMMDModelDrawer Create Fail.");
+			return false;
+		}
+		mmdDrawer->SetBBox(bboxMin, bboxMax);
+		m_modelDrawers.emplace_back(std::move(mmdDrawer));
+
+		SetupCamera();
+
+		return true;
+	}
+
+	bool OffscreenRenderer::LoadAnimation(const std::string& filepath)
+	{
+		if (m_modelDrawers.empty())
+		{
+			SABA_WARN("MMD Model not loaded.");
+			return false;
+		}
+
+		VMDFile vmd;
+		if (!ReadVMDFile(&vmd, filepath.c_str()))
+		{
+			return false;
+		}
+
+		if (!vmd.m_cameras.empty())
+		{
+			auto vmdCamOverrider = std::make_unique<VMDCameraOverrider>();
+			if (!vmdCamOverrider->Create(vmd))
+			{
+				return false;
+			}
+			m_cameraOverrider = std::move(vmdCamOverrider);
+		}
+
+		auto& mmdDrawer = m_modelDrawers.back();
+		if (!mmdDrawer->GetModel()->LoadAnimation(vmd))
+		{
+			return false;
+		}
+		mmdDrawer->ResetAnimation(&m_context);
+		return true;
+	}
+
+	double OffscreenRenderer::GetAnimationLength() const
+	{
+		int32_t maxKeyTime = 0;
+		for (const auto& modelDrawer : m_modelDrawers)
+		{
+			auto vmdAnim = modelDrawer->GetModel()->GetVMDAnimation();
+			if (vmdAnim != nullptr)
+			{
+				maxKeyTime = std::max(maxKeyTime, vmdAnim->GetMaxKeyTime());
+			}
+		}
+		return double(maxKeyTime) / 30.0;
+	}
+
+	void OffscreenRenderer::RenderFrame()
+	{
+		m_context.SetElapsedTime(m_frame == 0 ? 0.0 : 1.0 / m_fps);
+		m_context.SetAnimationTime(double(m_frame) / m_fps);
+
+		if (m_cameraOverrider)
+		{
+			Camera overrideCam = *m_context.GetCamera();
+			m_cameraOverrider->Override(&m_context, &overrideCam);
+			m_context.SetCamera(overrideCam);
+		}
+		m_context.m_camera.SetSize(float(m_param.m_width), float(m_param.m_height));
+		m_context.m_camera.UpdateMatrix();
+
+		for (auto& modelDrawer : m_modelDrawers)
+		{
+			modelDrawer->Update(&m_context);
+		}
+
+		if (m_context.IsShadowEnabled())
+		{
+			m_context.m_shadowmap.CalcShadowMap(m_context.GetCamera(), m_context.GetLight());
+			DrawShadowMap();
+		}
+		Draw();
+		ReadPixels();
+
+		m_frame++;
+	}
+
+	void OffscreenRenderer::Finish()
+	{
+		while (m_readbackCount != 0)
+		{
+			ReceiveFrame();
+		}
+	}
+
+	void OffscreenRenderer::DrawShadowMap()
+	{
+		auto shadowMap = m_context.GetShadowMap();
+		glDisable(GL_MULTISAMPLE);
+		glViewport(0, 0, shadowMap->GetWidth(), shadowMap->GetHeight());
+		size_t csmCount = shadowMap->GetClipSpaceCount();
+		for (size_t i = 0; i < csmCount; i++)
+		{
+			const auto& clipSpace = shadowMap->GetClipSpace(i);
+			glBindFramebuffer(GL_FRAMEBUFFER, clipSpace.m_shadowmapFBO);
+			glClear(GL_DEPTH_BUFFER_BIT);
+
+			for (auto& modelDrawer : m_modelDrawers)
+			{
+				modelDrawer->DrawShadowMap(&m_context, i);
+			}
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void OffscreenRenderer::Draw()
+	{
+		const bool msaa = m_param.m_msaaCount > 0;
+		glBindFramebuffer(GL_FRAMEBUFFER, msaa ? GLuint(m_msaaFrameBuffer) : GLuint(m_frameBuffer));
+		if (msaa)
+		{
+			glEnable(GL_MULTISAMPLE);
+		}
+		glViewport(0, 0, m_param.m_width, m_param.m_height);
+		glClearColor(m_bgColor.r, m_bgColor.g, m_bgColor.b, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+		glEnable(GL_DEPTH_TEST);
+		for (auto& modelDrawer : m_modelDrawers)
+		{
+			modelDrawer->Draw(&m_context);
+		}
+
+		if (msaa)
+		{
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, m_msaaFrameBuffer);
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_frameBuffer);
+			glBlitFramebuffer(
+				0, 0, m_param.m_width, m_param.m_height,
+				0, 0, m_param.m_width, m_param.m_height,
+				GL_COLOR_BUFFER_BIT, GL_NEAREST
+			);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void OffscreenRenderer::ReadPixels()
+	{
+		// 空いている PBO が無ければ、最も古い読み出しを受け取る
+		if (m_readbackCount == m_readbacks.size())
+		{
+			ReceiveFrame();
+		}
+
+		auto& readback = m_readbacks[(m_readbackHead + m_readbackCount) % m_readbacks.size()];
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_frameBuffer);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.m_pbo);
+		glReadPixels(0, 0, m_param.m_width, m_param.m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+		readback.m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		readback.m_frame = m_frame;
+		m_readbackCount++;
+	}
+
+	void OffscreenRenderer::ReceiveFrame()
+	{
+		auto& readback = m_readbacks[m_readbackHead];
+		m_readbackHead = (m_readbackHead + 1) % m_readbacks.size();
+		m_readbackCount--;
+
+		if (readback.m_fence != nullptr)
+		{
+			GLenum result = GL_TIMEOUT_EXPIRED;
+			while (result == GL_TIMEOUT_EXPIRED)
+			{
+				result = glClientWaitSync(readback.m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000);
+			}
+			glDeleteSync(readback.m_fence);
+			readback.m_fence = nullptr;
+			if (result == GL_WAIT_FAILED)
+			{
+				SABA_WARN("Failed to wait readback. [{}]", readback.m_frame);
+				return;
+			}
+		}
+
+		size_t bufferSize = size_t(m_param.m_width) * size_t(m_param.m_height) * 4;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.m_pbo);
+		auto pixels = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bufferSize, GL_MAP_READ_BIT);
+		if (pixels != nullptr)
+		{
+			if (m_frameCallback)
+			{
+				m_frameCallback(pixels, m_param.m_width, m_param.m_height, readback.m_frame);
+			}
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		else
+		{
+			SABA_WARN("Failed to map readback buffer. [{}]", readback.m_frame);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+}
@@ -0,0 +1,123 @@
+﻿//
+// Copyright(c) 2016-2017 benikabocha.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#ifndef SABA_VIEWER_OFFSCREENRENDERER_H_
+#define SABA_VIEWER_OFFSCREENRENDERER_H_
+
+#include "ViewerContext.h"
+#include "CameraOverrider.h"
+
+#include <Saba/GL/GLObject.h>
+#include <Saba/GL/Model/MMD/GLMMDModelDrawContext.h>
+#include <Saba/GL/Model/MMD/GLMMDModelDrawer.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace saba
+{
+	/*
+		ウィンドウを使わずに FBO へ MMD モデルを描画する.
+		GL コンテキスト (3.2 Core 以上) は呼び出し側で作成し、gl3wInit を済ませておくこと.
+
+		RenderFrame を呼ぶたびに 1 / fps 秒ずつアニメーションを進めて描画し、
+		結果を PBO に非同期で読み出す. 読み出した画像は PBO の数と同じフレーム数だけ遅れて
+		FrameCallback に渡すので、その間の描画と転送が重なる. 残りは Finish で受け取る.
+	*/
+	class OffscreenRenderer
+	{
+	public:
+		struct InitializeParameter
+		{
+			int		m_width = 1280;
+			int		m_height = 720;
+			int		m_msaaCount = 0;			//!< 0 : MSAA 無効
+			int		m_shadowMapSize = 1024;		//!< 0 : 影を描画しない
+			size_t	m_readbackBufferCount = 3;	//!< PBO の数
+			std::string	m_resourceDir;			//!< 空の場合はカレントディレクトリの resource
+			bool	m_modelCache = false;		//!< PMX の変換済みキャッシュを読み書きする
+			bool	m_shareModelCache = false;	//!< キャッシュを他のプロセスと共有する (PMXModel::EnableSharedCache)
+			bool	m_textureDiskCache = false;	//!< デコード済みのテクスチャをディスクにキャッシュする
+			bool	m_textureCompression = false;	//!< テクスチャを BC1 / BC3 に変換して使う
+		};
+
+		/*
+		rgba は幅 x 高さ x 4 バイトで、下の行から並ぶ. (glReadPixels と同じ)
+		コールバックから戻るとバッファは無効になる.
+		*/
+		using FrameCallback = std::function<void(const uint8_t* rgba, int width, int height, size_t frame)>;
+
+		OffscreenRenderer();
+		~OffscreenRenderer();
+
+		OffscreenRenderer(const OffscreenRenderer&) = delete;
+		OffscreenRenderer& operator = (const OffscreenRenderer&) = delete;
+
+		bool Initialize(const InitializeParameter& param);
+		void Uninitialize();
+
+		// PMX / PMD を読み込み、カメラをモデル全体が映る位置にする
+		bool LoadModel(const std::string& filepath);
+		// 最後に読み込んだモデルに VMD を設定する. カメラのキーがあればカメラも動かす
+		bool LoadAnimation(const std::string& filepath);
+
+		void SetBGColor(const glm::vec3& color) { m_bgColor = color; }
+		void SetFPS(double fps) { m_fps = fps; }
+		double GetFPS() const { return m_fps; }
+		void SetFrameCallback(FrameCallback callback) { m_frameCallback = std::move(callback); }
+
+		// 読み込んだ VMD の長さ (秒)
+		double GetAnimationLength() const;
+
+		size_t GetFrame() const { return m_frame; }
+		void RenderFrame();
+		void Finish();
+
+	private:
+		bool SetupFramebuffer();
+		void SetupCamera();
+		void DrawShadowMap();
+		void Draw();
+		void ReadPixels();
+		void ReceiveFrame();
+
+	private:
+		struct Readback
+		{
+			GLBufferObject	m_pbo;
+			GLsync			m_fence = nullptr;
+			size_t			m_frame = 0;
+		};
+
+		InitializeParameter	m_param;
+		ViewerContext		m_context;
+		std::unique_ptr<GLMMDModelDrawContext>			m_mmdModelDrawContext;
+		std::vector<std::unique_ptr<GLMMDModelDrawer>>	m_modelDrawers;
+		std::unique_ptr<CameraOverrider>				m_cameraOverrider;
+		glm::vec3	m_bboxMin;
+		glm::vec3	m_bboxMax;
+
+		GLFramebufferObject		m_frameBuffer;
+		GLTextureObject			m_colorTarget;
+		GLRenderbufferObject	m_depthTarget;
+		GLFramebufferObject		m_msaaFrameBuffer;
+		GLRenderbufferObject	m_msaaColorTarget;
+		GLRenderbufferObject	m_msaaDepthTarget;
+
+		std::vector<Readback>	m_readbacks;
+		size_t					m_readbackHead;		//!< 最も古い読み出し
+		size_t					m_readbackCount;	//!< 読み出し中の数
+
+		FrameCallback	m_frameCallback;
+		glm::vec3		m_bgColor;
+		double			m_fps;
+		size_t			m_frame;
+	};
+}
+
+#endif // !SABA_VIEWER_OFFSCREENRENDERER_H_
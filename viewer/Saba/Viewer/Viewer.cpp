@@ -11,8 +11,10 @@
 #include <Saba/Base/Log.h>
 #include <Saba/Base/Path.h>
 #include <Saba/Base/Time.h>
+#include <Saba/Base/Trace.h>
 #include <Saba/GL/GLSLUtil.h>
 #include <Saba/GL/GLShaderUtil.h>
+#include <Saba/GL/GLTextureCache.h>
 
 #include <Saba/Model/OBJ/OBJModel.h>
 #include <Saba/GL/Model/OBJ/GLOBJModel.h>
@@ -107,6 +109,23 @@ namespace saba
 
 	Viewer::MMDModelConfig::MMDModelConfig()
 		: m_parallelUpdateCount(0)
+		, m_asyncLoad(false)
+		, m_textureUploadBudget(4.0)
+		, m_textureCacheBudget(512)
+		, m_textureDiskCache(false)
+		, m_textureCompress(false)
+		, m_parallelEvaluate(true)
+		, m_ikWarmStart(false)
+		, m_ikTwoBoneSolve(false)
+		, m_ikTolerance(0)
+		, m_lodCount(1)
+		, m_lodDistance(30.0f)
+		, m_approxSkinningDistance(60.0f)
+		, m_updateInterval(1)
+		, m_gpuSkinning(false)
+		, m_modelCache(false)
+		, m_shareModelCache(false)
+		, m_optimizeVertexCache(false)
 	{
 	}
 
@@ -290,6 +309,11 @@ namespace saba
 		ImGui_ImplGlfw_Shutdown();
 		ImGui::DestroyContext();
 
+		m_mmdModelLoader.reset();
+		m_selectedModelDrawer.reset();
+		m_modelDrawers.clear();
+		Singleton<GLTextureCache>::Get()->Clear();
+
 		m_context.Uninitialize();
 	}
 
@@ -448,11 +472,15 @@ namespace saba
 
 	void Viewer::Update()
 	{
+		SABA_TRACE_SCOPE("Viewer::Update");
+
 		if (m_context.IsUIEnabled())
 		{
 			DrawUI();
 		}
 
+		UpdateMMDModelLoader();
+
 		m_context.SetClipElapsed(m_clipElapsed);
 		m_context.EnableCameraOverride(m_cameraOverride);
 		bool update = true;
@@ -520,6 +548,8 @@ namespace saba
 
 	void Viewer::DrawShadowMap()
 	{
+		SABA_TRACE_SCOPE("Viewer::DrawShadowMap");
+
 		auto shadowMap = m_context.GetShadowMap();
 		glDisable(GL_MULTISAMPLE);
 		glViewport(0, 0, shadowMap->GetWidth(), shadowMap->GetHeight());
@@ -541,6 +571,8 @@ namespace saba
 
 	void Viewer::Draw()
 	{
+		SABA_TRACE_SCOPE("Viewer::Draw");
+
 		DrawBegin();
 
 		glViewport(0, 0, m_context.GetFrameBufferWidth(), m_context.GetFrameBufferHeight());
@@ -983,6 +1015,16 @@ namespace saba
 		if (m_enableMoreInfoUI)
 		{
 			ImGui::Text("FPS ave:%.2f min:%.2f max time:%.2f[ms]", aveFps, minFps, 1000.0f / minFps);
+
+			auto texCacheStats = Singleton<GLTextureCache>::Get()->GetStats();
+			ImGui::Text("Texture Cache %d tex %.1f/%.1f[MB] hit:%d miss:%d evict:%d",
+				int(texCacheStats.m_textureCount),
+				float(texCacheStats.m_memorySize / (1024.0 * 1024.0)),
+				float(texCacheStats.m_memoryBudget / (1024.0 * 1024.0)),
+				int(texCacheStats.m_hitCount),
+				int(texCacheStats.m_missCount),
+				int(texCacheStats.m_evictCount)
+			);
 		}
 
 		if (m_selectedModelDrawer != nullptr && m_selectedModelDrawer->GetType() == ModelDrawerType::MMDModelDrawer)
@@ -995,6 +1037,7 @@ namespace saba
 				const auto& perfInfo = mmdModel->GetPerfInfo();
 
 				PushPerfLap(m_perfMMDSetupAnimTimeLap, perfInfo.m_setupAnimTime);
+				PushPerfLap(m_perfMMDEvaluateAnimTimeLap, perfInfo.m_evaluateAnimTime);
 				PushPerfLap(m_perfMMDUpdateMorphAnimTimeLap, perfInfo.m_updateMorphAnimTime);
 				PushPerfLap(m_perfMMDUpdateNodeAnimTimeLap, perfInfo.m_updateNodeAnimTime);
 				PushPerfLap(m_perfMMDUpdatePhysicsAnimTimeLap, perfInfo.m_updatePhysicsAnimTime);
@@ -1009,6 +1052,12 @@ namespace saba
 						float(GetPerfLapMax(m_perfMMDSetupAnimTimeLap) * 1000.0),
 						float(perfInfo.m_setupAnimTime * 1000.0)
 					);
+					ImGui::Text(" (Eval ave:%.2f max:%.2f now:%.2f [ms] %s)",
+						float(GetPerfLapAve(m_perfMMDEvaluateAnimTimeLap) * 1000.0),
+						float(GetPerfLapMax(m_perfMMDEvaluateAnimTimeLap) * 1000.0),
+						float(perfInfo.m_evaluateAnimTime * 1000.0),
+						perfInfo.m_parallelEvaluate ? "parallel" : "serial"
+					);
 
 					// Morph animation
 					ImGui::Text("Morph  ave:%.2f max:%.2f now:%.2f [ms]",
@@ -1023,6 +1072,12 @@ namespace saba
 						float(GetPerfLapMax(m_perfMMDUpdateNodeAnimTimeLap) * 1000.0),
 						float(perfInfo.m_updateNodeAnimTime * 1000.0)
 					);
+					ImGui::Text(" (IK solve:%d iterate:%d %s%s)",
+						int(perfInfo.m_ikSolveCount),
+						int(perfInfo.m_ikIterateCount),
+						mmdModel->IsEnabledIKWarmStart() ? "warm" : "cold",
+						mmdModel->IsEnabledIKTwoBoneSolve() ? " two-bone" : ""
+					);
 
 					// Physics animation
 					ImGui::Text("Phyics ave:%.2f max:%.2f now:%.2f [ms]",
@@ -1044,6 +1099,19 @@ namespace saba
 						float(GetPerfLapMax(m_perfMMDUpdateGLBufferTimeLap) * 1000.0),
 						float(perfInfo.m_updateGLBufferTime * 1000.0)
 					);
+
+					// VMD animation keys
+					auto vmdAnim = mmdModel->GetVMDAnimation();
+					if (vmdAnim != nullptr)
+					{
+						auto usage = vmdAnim->GetMemoryUsage();
+						ImGui::Text("VMD Keys node:%d ik:%d morph:%d %.2f[MB]",
+							int(usage.m_nodeKeyCount),
+							int(usage.m_ikKeyCount),
+							int(usage.m_morphKeyCount),
+							float(usage.GetTotalMemory() / (1024.0 * 1024.0))
+						);
+					}
 				}
 			}
 		}
@@ -1674,6 +1742,31 @@ namespace saba
 		}
 	}
 
+	void Viewer::UpdateMMDModelLoader()
+	{
+		if (m_mmdModelLoader == nullptr || !m_mmdModelLoader->IsBusy())
+		{
+			return;
+		}
+
+		std::vector<GLMMDModelLoader::LoadedModel> loadedModels;
+		m_mmdModelLoader->Update(m_mmdModelConfig.m_textureUploadBudget / 1000.0, &loadedModels);
+		for (auto& loadedModel : loadedModels)
+		{
+			AddMMDModelDrawer(loadedModel.m_model, loadedModel.m_bboxMin, loadedModel.m_bboxMax);
+		}
+
+		if (!m_mmdModelLoader->IsLoadingModel() && !m_deferredOpenFiles.empty())
+		{
+			auto deferredOpenFiles = std::move(m_deferredOpenFiles);
+			m_deferredOpenFiles.clear();
+			for (const auto& filepath : deferredOpenFiles)
+			{
+				CmdOpen(std::vector<std::string>{ filepath });
+			}
+		}
+	}
+
 	void Viewer::InitializeAnimation()
 	{
 		m_context.SetAnimationTime(0);
@@ -1706,6 +1799,7 @@ namespace saba
 		m_commands.emplace_back(Command{ "clearSceneAnimation", [this](const Args& args) { return CmdClearSceneAnimation(args); } });
 		m_commands.emplace_back(Command{ "setMMDConfig", [this](const Args& args) { return CmdSetMMDConfig(args); } });
 		m_commands.emplace_back(Command{ "setMSAA", [this](const Args& args) {return CmdSetMSAA(args); } });
+		m_commands.emplace_back(Command{ "trace", [this](const Args& args) { return CmdTrace(args); } });
 	}
 
 	void Viewer::RefreshCustomCommand()
@@ -1916,6 +2010,15 @@ namespace saba
 		std::string filepath = args[0];
 		std::string ext = PathUtil::GetExt(filepath);
 		SABA_INFO("Open File. [{}]", filepath);
+		if ((ext == "vmd" || ext == "vpd") &&
+			m_mmdModelLoader != nullptr && m_mmdModelLoader->IsLoadingModel())
+		{
+			// 読み込み中のモデルに適用する
+			SABA_INFO("Defer until MMD model loaded. [{}]", filepath);
+			m_deferredOpenFiles.push_back(filepath);
+			return true;
+		}
+
 		if (ext == "obj")
 		{
 			if (!LoadOBJFile(filepath))
@@ -1926,6 +2029,10 @@ namespace saba
 		else if (ext == "pmd")
 		{
 			InitializeAnimation();
+			if (m_mmdModelConfig.m_asyncLoad)
+			{
+				return LoadMMDFileAsync(filepath);
+			}
 			if (!LoadPMDFile(filepath))
 			{
 				return false;
@@ -1942,6 +2049,10 @@ namespace saba
 		else if (ext == "pmx")
 		{
 			InitializeAnimation();
+			if (m_mmdModelConfig.m_asyncLoad)
+			{
+				return LoadMMDFileAsync(filepath);
+			}
 			if (!LoadPMXFile(filepath))
 			{
 				return false;
@@ -2006,6 +2117,9 @@ namespace saba
 
 		InitializeAnimation();
 
+		// 使われなくなったテクスチャを予算内に収める
+		Singleton<GLTextureCache>::Get()->Evict();
+
 		return true;
 	}
 
@@ -2273,6 +2387,23 @@ namespace saba
 		if (args.empty())
 		{
 			SABA_INFO("Parallel : {}", m_mmdModelConfig.m_parallelUpdateCount);
+			SABA_INFO("Async : {}", m_mmdModelConfig.m_asyncLoad);
+			SABA_INFO("Upload Budget : {} ms", m_mmdModelConfig.m_textureUploadBudget);
+			SABA_INFO("Texture Cache Budget : {} MB", m_mmdModelConfig.m_textureCacheBudget);
+			SABA_INFO("Texture Disk Cache : {}", m_mmdModelConfig.m_textureDiskCache);
+			SABA_INFO("Texture Compress : {}", m_mmdModelConfig.m_textureCompress);
+			SABA_INFO("Parallel Evaluate : {}", m_mmdModelConfig.m_parallelEvaluate);
+			SABA_INFO("IK Warm Start : {}", m_mmdModelConfig.m_ikWarmStart);
+			SABA_INFO("IK Two Bone Solve : {}", m_mmdModelConfig.m_ikTwoBoneSolve);
+			SABA_INFO("IK Tolerance : {}", m_mmdModelConfig.m_ikTolerance);
+			SABA_INFO("LOD : {}", m_mmdModelConfig.m_lodCount);
+			SABA_INFO("LOD Distance : {}", m_mmdModelConfig.m_lodDistance);
+			SABA_INFO("Approx Skinning Distance : {}", m_mmdModelConfig.m_approxSkinningDistance);
+			SABA_INFO("Update Interval : {}", m_mmdModelConfig.m_updateInterval);
+			SABA_INFO("GPU Skinning : {}", m_mmdModelConfig.m_gpuSkinning);
+			SABA_INFO("Model Cache : {}", m_mmdModelConfig.m_modelCache);
+			SABA_INFO("Share Model Cache : {}", m_mmdModelConfig.m_shareModelCache);
+			SABA_INFO("Vertex Cache Optimization : {}", m_mmdModelConfig.m_optimizeVertexCache);
 		}
 		auto argIt = args.begin();
 		for (; argIt != args.end(); ++argIt)
@@ -2310,6 +2441,351 @@ namespace saba
 					return false;
 				}
 			}
+			else if ((*argIt) == "-async" || (*argIt) == "-a")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				bool asyncLoad;
+				if (!ToBool(std::vector<std::string>{ *argIt }, 0, &asyncLoad))
+				{
+					return false;
+				}
+				m_mmdModelConfig.m_asyncLoad = asyncLoad;
+			}
+			else if ((*argIt) == "-cache")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				// 読み込み済みのモデルには影響しない
+				bool modelCache;
+				if (!ToBool(std::vector<std::string>{ *argIt }, 0, &modelCache))
+				{
+					return false;
+				}
+				m_mmdModelConfig.m_modelCache = modelCache;
+			}
+			else if ((*argIt) == "-shareCache")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				bool shareModelCache;
+				if (!ToBool(std::vector<std::string>{ *argIt }, 0, &shareModelCache))
+				{
+					return false;
+				}
+				m_mmdModelConfig.m_shareModelCache = shareModelCache;
+			}
+			else if ((*argIt) == "-vertexCache")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				// 読み込み済みのモデルには影響しない
+				bool optimizeVertexCache;
+				if (!ToBool(std::vector<std::string>{ *argIt }, 0, &optimizeVertexCache))
+				{
+					return false;
+				}
+				m_mmdModelConfig.m_optimizeVertexCache = optimizeVertexCache;
+			}
+			else if ((*argIt) == "-upload" || (*argIt) == "-u")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				try
+				{
+					double uploadBudget = std::stod(*argIt);
+					if (uploadBudget < 0)
+					{
+						SABA_WARN("upload : >= 0 [ms]");
+						return false;
+					}
+					m_mmdModelConfig.m_textureUploadBudget = uploadBudget;
+				}
+				catch (std::exception e)
+				{
+					SABA_WARN("exception : {}", e.what());
+					return false;
+				}
+			}
+			else if ((*argIt) == "-textureDiskCache")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				bool textureDiskCache;
+				if (!ToBool(std::vector<std::string>{ *argIt }, 0, &textureDiskCache))
+				{
+					return false;
+				}
+				m_mmdModelConfig.m_textureDiskCache = textureDiskCache;
+				Singleton<GLTextureCache>::Get()->EnableDiskCache(textureDiskCache);
+			}
+			else if ((*argIt) == "-textureCompress")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				bool textureCompress;
+				if (!ToBool(std::vector<std::string>{ *argIt }, 0, &textureCompress))
+				{
+					return false;
+				}
+				m_mmdModelConfig.m_textureCompress = textureCompress;
+				Singleton<GLTextureCache>::Get()->EnableCompression(textureCompress);
+			}
+			else if ((*argIt) == "-textureCache" || (*argIt) == "-t")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				try
+				{
+					auto cacheBudget = std::stoul(*argIt);
+					m_mmdModelConfig.m_textureCacheBudget = cacheBudget;
+					Singleton<GLTextureCache>::Get()->SetMemoryBudget(cacheBudget * 1024 * 1024);
+				}
+				catch (std::exception e)
+				{
+					SABA_WARN("exception : {}", e.what());
+					return false;
+				}
+			}
+			else if ((*argIt) == "-evaluate" || (*argIt) == "-e")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				bool parallelEvaluate;
+				if (!ToBool(std::vector<std::string>{ *argIt }, 0, &parallelEvaluate))
+				{
+					return false;
+				}
+				m_mmdModelConfig.m_parallelEvaluate = parallelEvaluate;
+				for (auto& modelDrawer : m_modelDrawers)
+				{
+					if (modelDrawer->GetType() == ModelDrawerType::MMDModelDrawer)
+					{
+						auto mmdModelDrawer = reinterpret_cast<GLMMDModelDrawer*>(modelDrawer.get());
+						mmdModelDrawer->GetModel()->EnableParallelEvaluate(parallelEvaluate);
+					}
+				}
+			}
+			else if ((*argIt) == "-ikWarmStart" || (*argIt) == "-w")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				bool ikWarmStart;
+				if (!ToBool(std::vector<std::string>{ *argIt }, 0, &ikWarmStart))
+				{
+					return false;
+				}
+				m_mmdModelConfig.m_ikWarmStart = ikWarmStart;
+				for (auto& modelDrawer : m_modelDrawers)
+				{
+					if (modelDrawer->GetType() == ModelDrawerType::MMDModelDrawer)
+					{
+						auto mmdModelDrawer = reinterpret_cast<GLMMDModelDrawer*>(modelDrawer.get());
+						mmdModelDrawer->GetModel()->EnableIKWarmStart(ikWarmStart);
+					}
+				}
+			}
+			else if ((*argIt) == "-ikTwoBone")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				bool ikTwoBoneSolve;
+				if (!ToBool(std::vector<std::string>{ *argIt }, 0, &ikTwoBoneSolve))
+				{
+					return false;
+				}
+				m_mmdModelConfig.m_ikTwoBoneSolve = ikTwoBoneSolve;
+				for (auto& modelDrawer : m_modelDrawers)
+				{
+					if (modelDrawer->GetType() == ModelDrawerType::MMDModelDrawer)
+					{
+						auto mmdModelDrawer = reinterpret_cast<GLMMDModelDrawer*>(modelDrawer.get());
+						mmdModelDrawer->GetModel()->EnableIKTwoBoneSolve(ikTwoBoneSolve);
+					}
+				}
+			}
+			else if ((*argIt) == "-ikTolerance" || (*argIt) == "-i")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				try
+				{
+					float ikTolerance = std::stof(*argIt);
+					if (ikTolerance < 0)
+					{
+						SABA_WARN("ikTolerance : >= 0");
+						return false;
+					}
+					m_mmdModelConfig.m_ikTolerance = ikTolerance;
+					for (auto& modelDrawer : m_modelDrawers)
+					{
+						if (modelDrawer->GetType() == ModelDrawerType::MMDModelDrawer)
+						{
+							auto mmdModelDrawer = reinterpret_cast<GLMMDModelDrawer*>(modelDrawer.get());
+							mmdModelDrawer->GetModel()->SetIKTolerance(ikTolerance);
+						}
+					}
+				}
+				catch (std::exception e)
+				{
+					SABA_WARN("exception : {}", e.what());
+					return false;
+				}
+			}
+			else if ((*argIt) == "-lod")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				try
+				{
+					// 読み込み済みのモデルには影響しない
+					auto lodCount = std::stoul(*argIt);
+					if (lodCount < 1 || lodCount > 8)
+					{
+						SABA_WARN("lod : 1 - 8");
+						return false;
+					}
+					m_mmdModelConfig.m_lodCount = uint32_t(lodCount);
+				}
+				catch (std::exception e)
+				{
+					SABA_WARN("exception : {}", e.what());
+					return false;
+				}
+			}
+			else if ((*argIt) == "-lodDistance" || (*argIt) == "-approxDistance")
+			{
+				bool lodDistance = (*argIt) == "-lodDistance";
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				try
+				{
+					float distance = std::stof(*argIt);
+					if (distance < 0)
+					{
+						SABA_WARN("distance : >= 0");
+						return false;
+					}
+					if (lodDistance)
+					{
+						m_mmdModelConfig.m_lodDistance = distance;
+					}
+					else
+					{
+						m_mmdModelConfig.m_approxSkinningDistance = distance;
+					}
+					for (auto& modelDrawer : m_modelDrawers)
+					{
+						if (modelDrawer->GetType() == ModelDrawerType::MMDModelDrawer)
+						{
+							auto mmdModelDrawer = reinterpret_cast<GLMMDModelDrawer*>(modelDrawer.get());
+							auto mmdModel = mmdModelDrawer->GetModel();
+							mmdModel->SetLODDistance(m_mmdModelConfig.m_lodDistance);
+							mmdModel->SetApproxSkinningDistance(m_mmdModelConfig.m_approxSkinningDistance);
+						}
+					}
+				}
+				catch (std::exception e)
+				{
+					SABA_WARN("exception : {}", e.what());
+					return false;
+				}
+			}
+			else if ((*argIt) == "-updateInterval" || (*argIt) == "-u")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				try
+				{
+					auto interval = std::stoul(*argIt);
+					if (interval > 8)
+					{
+						SABA_WARN("updateInterval : 0 - 8 (0:auto)");
+						return false;
+					}
+					m_mmdModelConfig.m_updateInterval = uint32_t(interval);
+					for (auto& modelDrawer : m_modelDrawers)
+					{
+						if (modelDrawer->GetType() == ModelDrawerType::MMDModelDrawer)
+						{
+							auto mmdModelDrawer = reinterpret_cast<GLMMDModelDrawer*>(modelDrawer.get());
+							SetupUpdateInterval(mmdModelDrawer->GetModel());
+						}
+					}
+				}
+				catch (std::exception e)
+				{
+					SABA_WARN("exception : {}", e.what());
+					return false;
+				}
+			}
+			else if ((*argIt) == "-gpuSkinning")
+			{
+				++argIt;
+				if (argIt == args.end())
+				{
+					return false;
+				}
+				bool gpuSkinning;
+				if (!ToBool(std::vector<std::string>{ *argIt }, 0, &gpuSkinning))
+				{
+					return false;
+				}
+				m_mmdModelConfig.m_gpuSkinning = gpuSkinning;
+				for (auto& modelDrawer : m_modelDrawers)
+				{
+					if (modelDrawer->GetType() == ModelDrawerType::MMDModelDrawer)
+					{
+						auto mmdModelDrawer = reinterpret_cast<GLMMDModelDrawer*>(modelDrawer.get());
+						mmdModelDrawer->GetModel()->EnableGPUSkinning(gpuSkinning);
+					}
+				}
+			}
 			else
 			{
 				SABA_WARN("unknown arg : {}", *argIt);
@@ -2344,6 +2820,52 @@ namespace saba
 		return true;
 	}
 
+	/*
+		trace start			: 記録を消去して計測を開始する
+		trace stop			: 計測を停止する
+		trace save <file>	: Chrome のトレース形式で保存する
+	*/
+	bool Viewer::CmdTrace(const std::vector<std::string>& args)
+	{
+		if (args.empty())
+		{
+			SABA_INFO("Cmd Trace Args Empty.");
+			return false;
+		}
+
+		if (args[0] == "start")
+		{
+			Trace::Clear();
+			Trace::Enable(true);
+			SABA_INFO("Trace Start.");
+		}
+		else if (args[0] == "stop")
+		{
+			Trace::Enable(false);
+			SABA_INFO("Trace Stop. {} events", Trace::GetEventCount());
+		}
+		else if (args[0] == "save")
+		{
+			if (args.size() < 2)
+			{
+				SABA_INFO("Cmd Trace Save Filepath Empty.");
+				return false;
+			}
+			if (!Trace::WriteChromeTrace(args[1]))
+			{
+				return false;
+			}
+			SABA_INFO("Trace Save. [{}]", args[1]);
+		}
+		else
+		{
+			SABA_INFO("Unknown arg [{}]", args[0]);
+			return false;
+		}
+
+		return true;
+	}
+
 	bool Viewer::LoadOBJFile(const std::string & filename)
 	{
 		OBJModel objModel;
@@ -2402,25 +2924,7 @@ namespace saba
 			return false;
 		}
 
-		auto mmdDrawer = std::make_unique<GLMMDModelDrawer>(
-			m_mmdModelDrawContext.get(),
-			glMMDModel
-			);
-		if (!mmdDrawer->Create())
-		{
-			SABA_WARN("GLMMDModelDrawer Create Fail.");
-			return false;
-		}
-		m_modelDrawers.emplace_back(std::move(mmdDrawer));
-		m_selectedModelDrawer = m_modelDrawers[m_modelDrawers.size() - 1];
-		m_selectedModelDrawer->SetName(GetNewModelName());
-		m_selectedModelDrawer->SetBBox(pmdModel->GetBBoxMin(), pmdModel->GetBBoxMax());
-
-		InitializeScene();
-
-		m_prevTime = GetTime();
-
-		return true;
+		return AddMMDModelDrawer(glMMDModel, pmdModel->GetBBoxMin(), pmdModel->GetBBoxMax());
 	}
 
 	bool Viewer::LoadPMXFile(const std::string & filename)
@@ -2431,6 +2935,10 @@ namespace saba
 			"mmd"
 		);
 		pmxModel->SetParallelUpdateHint(m_mmdModelConfig.m_parallelUpdateCount);
+		pmxModel->SetLODHint(m_mmdModelConfig.m_lodCount);
+		pmxModel->EnableCache(m_mmdModelConfig.m_modelCache);
+		pmxModel->EnableSharedCache(m_mmdModelConfig.m_shareModelCache);
+		pmxModel->EnableVertexCacheOptimization(m_mmdModelConfig.m_optimizeVertexCache);
 		if (!pmxModel->Load(filename, mmdDataDir))
 		{
 			SABA_WARN("PMD Load Fail.");
@@ -2444,6 +2952,49 @@ namespace saba
 			return false;
 		}
 
+		return AddMMDModelDrawer(glMMDModel, pmxModel->GetBBoxMin(), pmxModel->GetBBoxMax());
+	}
+
+	bool Viewer::LoadMMDFileAsync(const std::string & filename)
+	{
+		if (m_mmdModelLoader == nullptr)
+		{
+			m_mmdModelLoader = std::make_unique<GLMMDModelLoader>();
+		}
+
+		std::string mmdDataDir = PathUtil::Combine(
+			m_context.GetResourceDir(),
+			"mmd"
+		);
+		m_mmdModelLoader->Load(filename, mmdDataDir, m_mmdModelConfig.m_parallelUpdateCount, m_mmdModelConfig.m_lodCount, m_mmdModelConfig.m_modelCache, m_mmdModelConfig.m_shareModelCache, m_mmdModelConfig.m_optimizeVertexCache);
+		return true;
+	}
+
+	void Viewer::SetupUpdateInterval(GLMMDModel* glMMDModel)
+	{
+		if (m_mmdModelConfig.m_updateInterval == 0)
+		{
+			glMMDModel->EnableAutoUpdateInterval(true);
+		}
+		else
+		{
+			glMMDModel->EnableAutoUpdateInterval(false);
+			glMMDModel->SetUpdateInterval(m_mmdModelConfig.m_updateInterval);
+		}
+	}
+
+	bool Viewer::AddMMDModelDrawer(std::shared_ptr<GLMMDModel> glMMDModel, const glm::vec3& bboxMin, const glm::vec3& bboxMax)
+	{
+		glMMDModel->EnableParallelEvaluate(m_mmdModelConfig.m_parallelEvaluate);
+		glMMDModel->EnableIKWarmStart(m_mmdModelConfig.m_ikWarmStart);
+		glMMDModel->EnableIKTwoBoneSolve(m_mmdModelConfig.m_ikTwoBoneSolve);
+		glMMDModel->SetIKTolerance(m_mmdModelConfig.m_ikTolerance);
+		glMMDModel->SetLODDistance(m_mmdModelConfig.m_lodDistance);
+		glMMDModel->SetApproxSkinningDistance(m_mmdModelConfig.m_approxSkinningDistance);
+		glMMDModel->EnableGPUSkinning(m_mmdModelConfig.m_gpuSkinning);
+		// 更新するフレームをモデルごとにずらす
+		glMMDModel->SetUpdatePhase(uint32_t(m_modelDrawers.size()));
+		SetupUpdateInterval(glMMDModel.get());
 		auto mmdDrawer = std::make_unique<GLMMDModelDrawer>(
 			m_mmdModelDrawContext.get(),
 			glMMDModel
@@ -2456,7 +3007,7 @@ namespace saba
 		m_modelDrawers.emplace_back(std::move(mmdDrawer));
 		m_selectedModelDrawer = m_modelDrawers[m_modelDrawers.size() - 1];
 		m_selectedModelDrawer->SetName(GetNewModelName());
-		m_selectedModelDrawer->SetBBox(pmxModel->GetBBoxMin(), pmxModel->GetBBoxMax());
+		m_selectedModelDrawer->SetBBox(bboxMin, bboxMax);
 
 		InitializeScene();
 
@@ -17,6 +17,7 @@
 
 #include <Saba/GL/GLObject.h>
 #include <Saba/GL/Model/MMD/GLMMDModel.h>
+#include <Saba/GL/Model/MMD/GLMMDModelLoader.h>
 #include <Saba/GL/Model/OBJ/GLOBJModelDrawContext.h>
 #include <Saba/GL/Model/MMD/GLMMDModelDrawContext.h>
 #include <Saba/GL/Model/XFile/GLXFileModelDrawContext.h>
@@ -138,6 +139,23 @@ namespace saba
 		{
 			MMDModelConfig();
 			uint32_t	m_parallelUpdateCount;	//!< 0 - 16 (0:auto)
+			bool		m_asyncLoad;			//!< PMX/PMD をバックグラウンドで読み込む
+			double		m_textureUploadBudget;	//!< 1 フレームあたりのテクスチャ転送時間 (ms)
+			size_t		m_textureCacheBudget;	//!< テクスチャキャッシュのメモリ予算 (MB)
+			bool		m_textureDiskCache;		//!< デコード済みのテクスチャをディスクにキャッシュする
+			bool		m_textureCompress;		//!< テクスチャを BC1 / BC3 に変換して使う
+			bool		m_parallelEvaluate;		//!< VMD のコントローラーを並列に評価する
+			bool		m_ikWarmStart;			//!< IK を前回のフレームの解から解く
+			bool		m_ikTwoBoneSolve;		//!< ひざ + 足の IK を解析的に解く
+			float		m_ikTolerance;			//!< IK の反復を打ち切る距離 (0 : 無効. ウォームスタートの場合は自動)
+			uint32_t	m_lodCount;				//!< PMX の LOD 数 (1 : LOD を作らない)
+			float		m_lodDistance;			//!< LOD を 1 段下げる距離 (0 : 無効)
+			float		m_approxSkinningDistance;	//!< 近似スキニングにする距離 (0 : 無効)
+			uint32_t	m_updateInterval;		//!< アニメーションの更新間隔 (0 : 画面上の大きさで決める)
+			bool		m_gpuSkinning;			//!< 頂点シェーダーでスキニングする
+			bool		m_modelCache;			//!< PMX の変換済みキャッシュを読み書きする
+			bool		m_shareModelCache;		//!< キャッシュを他のプロセスと共有する
+			bool		m_optimizeVertexCache;	//!< PMX のインデックスを頂点キャッシュ向けに並べ替える
 		};
 
 	private:
@@ -167,6 +185,7 @@ namespace saba
 		void DrawModelCtrl();
 		void DrawBGCtrl();
 		void UpdateAnimation();
+		void UpdateMMDModelLoader();
 		void InitializeAnimation();
 		void ResetAnimation();
 		void RegisterCommand();
@@ -186,10 +205,14 @@ namespace saba
 		bool CmdClearSceneAnimation(const std::vector<std::string>& args);
 		bool CmdSetMMDConfig(const std::vector<std::string>& args);
 		bool CmdSetMSAA(const std::vector<std::string>& args);
+		bool CmdTrace(const std::vector<std::string>& args);
 
 		bool LoadOBJFile(const std::string& filename);
 		bool LoadPMDFile(const std::string& filename);
 		bool LoadPMXFile(const std::string& filename);
+		bool LoadMMDFileAsync(const std::string& filename);
+		bool AddMMDModelDrawer(std::shared_ptr<GLMMDModel> glMMDModel, const glm::vec3& bboxMin, const glm::vec3& bboxMax);
+		void SetupUpdateInterval(GLMMDModel* glMMDModel);
 		bool LoadVMDFile(const std::string& filename);
 		bool LoadVPDFile(const std::string& filename);
 		bool LoadXFile(const std::string& filename);
@@ -264,9 +287,14 @@ namespace saba
 		// MMDModelConfig
 		MMDModelConfig	m_mmdModelConfig;
 
+		// Async MMD model load
+		std::unique_ptr<GLMMDModelLoader>	m_mmdModelLoader;
+		std::vector<std::string>			m_deferredOpenFiles;	//!< モデル読み込み待ちの VMD/VPD
+
 		// Performance
 		std::deque<float>	m_perfFramerateLap;
 		std::deque<double>	m_perfMMDSetupAnimTimeLap;
+		std::deque<double>	m_perfMMDEvaluateAnimTimeLap;
 		std::deque<double>	m_perfMMDUpdateMorphAnimTimeLap;
 		std::deque<double>	m_perfMMDUpdateNodeAnimTimeLap;
 		std::deque<double>	m_perfMMDUpdatePhysicsAnimTimeLap;
@@ -21,6 +21,7 @@ namespace saba
 	class ViewerContext
 	{
 		friend class Viewer;
+		friend class OffscreenRenderer;
 	public:
 		enum class PlayMode
 		{
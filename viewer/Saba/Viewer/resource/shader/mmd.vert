@@ -6,6 +6,11 @@ in vec3 in_Pos;
 in vec3 in_Nor;
 in vec2 in_UV;
 
+#ifdef MMD_SKINNING
+#include "mmd_skinning.glsl"
+in vec4 in_MorphUV;
+#endif
+
 out vec3 vs_Pos;
 out vec3 vs_Nor;
 out vec2 vs_UV;
@@ -18,13 +23,21 @@ uniform mat4 u_LightWVP[NUM_SHADOWMAP];
 
 void main()
 {
-    gl_Position = u_WVP * vec4(in_Pos, 1.0);
-    vs_Pos = (u_WV * vec4(in_Pos, 1.0)).xyz;
-    vs_Nor = mat3(u_WV) * in_Nor;
-    vs_UV = in_UV;
+    vec3 pos = in_Pos;
+    vec3 nor = in_Nor;
+    vec2 uv = in_UV;
+#ifdef MMD_SKINNING
+    SkinVertex(pos, nor);
+    uv += in_MorphUV.xy;
+#endif
+
+    gl_Position = u_WVP * vec4(pos, 1.0);
+    vs_Pos = (u_WV * vec4(pos, 1.0)).xyz;
+    vs_Nor = mat3(u_WV) * nor;
+    vs_UV = uv;
 
     for (int i = 0; i < NUM_SHADOWMAP; i++)
     {
-        vs_shadowMapCoord[i] = u_LightWVP[i] * vec4(in_Pos, 1.0);
+        vs_shadowMapCoord[i] = u_LightWVP[i] * vec4(pos, 1.0);
     }
 }
@@ -3,10 +3,19 @@
 // Input
 in vec3	in_Pos;
 
+#ifdef MMD_SKINNING
+#include "mmd_skinning.glsl"
+#endif
+
 // Uniform
 uniform	mat4	u_WVP;
 
 void main()
 {
-	gl_Position = u_WVP * vec4(in_Pos, 1.0);
+	vec3 pos = in_Pos;
+#ifdef MMD_SKINNING
+	vec3 nor = vec3(0.0);
+	SkinVertex(pos, nor);
+#endif
+	gl_Position = u_WVP * vec4(pos, 1.0);
 }
@@ -0,0 +1,177 @@
+// Vertex shader skinning (same as MMDModel::Update)
+// Include when MMD_SKINNING is defined.
+
+// Input
+in ivec4	in_BoneIndex;
+in vec4		in_BoneWeight;
+in int		in_SkinningType;
+in vec3		in_SdefC;
+in vec3		in_SdefR0;
+in vec3		in_SdefR1;
+in vec3		in_MorphPos;
+
+// Uniform
+// Rows 0-2 of each bone transform (3 texels per bone)
+uniform samplerBuffer	u_BoneTransforms;
+
+// MMDSkinningVertex::Type
+const int SkinningLinear = 0;
+const int SkinningSDEF = 1;
+const int SkinningDualQuaternion = 2;
+
+mat4 GetBoneTransform(int boneIndex)
+{
+	vec4 r0 = texelFetch(u_BoneTransforms, boneIndex * 3 + 0);
+	vec4 r1 = texelFetch(u_BoneTransforms, boneIndex * 3 + 1);
+	vec4 r2 = texelFetch(u_BoneTransforms, boneIndex * 3 + 2);
+	return transpose(mat4(r0, r1, r2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+// Quaternion : (x, y, z, w)
+
+// glm::quat_cast
+vec4 QuatFromMat3(mat3 m)
+{
+	float fourXSquaredMinus1 = m[0][0] - m[1][1] - m[2][2];
+	float fourYSquaredMinus1 = m[1][1] - m[0][0] - m[2][2];
+	float fourZSquaredMinus1 = m[2][2] - m[0][0] - m[1][1];
+	float fourWSquaredMinus1 = m[0][0] + m[1][1] + m[2][2];
+
+	int biggestIndex = 0;
+	float fourBiggestSquaredMinus1 = fourWSquaredMinus1;
+	if (fourXSquaredMinus1 > fourBiggestSquaredMinus1)
+	{
+		fourBiggestSquaredMinus1 = fourXSquaredMinus1;
+		biggestIndex = 1;
+	}
+	if (fourYSquaredMinus1 > fourBiggestSquaredMinus1)
+	{
+		fourBiggestSquaredMinus1 = fourYSquaredMinus1;
+		biggestIndex = 2;
+	}
+	if (fourZSquaredMinus1 > fourBiggestSquaredMinus1)
+	{
+		fourBiggestSquaredMinus1 = fourZSquaredMinus1;
+		biggestIndex = 3;
+	}
+
+	float biggestVal = sqrt(fourBiggestSquaredMinus1 + 1.0) * 0.5;
+	float mult = 0.25 / biggestVal;
+	if (biggestIndex == 0)
+	{
+		return vec4((m[1][2] - m[2][1]) * mult, (m[2][0] - m[0][2]) * mult, (m[0][1] - m[1][0]) * mult, biggestVal);
+	}
+	else if (biggestIndex == 1)
+	{
+		return vec4(biggestVal, (m[0][1] + m[1][0]) * mult, (m[2][0] + m[0][2]) * mult, (m[1][2] - m[2][1]) * mult);
+	}
+	else if (biggestIndex == 2)
+	{
+		return vec4((m[0][1] + m[1][0]) * mult, biggestVal, (m[1][2] + m[2][1]) * mult, (m[2][0] - m[0][2]) * mult);
+	}
+	else
+	{
+		return vec4((m[2][0] + m[0][2]) * mult, (m[1][2] + m[2][1]) * mult, biggestVal, (m[0][1] - m[1][0]) * mult);
+	}
+}
+
+// glm::mat3_cast (q must be normalized)
+mat3 QuatToMat3(vec4 q)
+{
+	float qxx = q.x * q.x;
+	float qyy = q.y * q.y;
+	float qzz = q.z * q.z;
+	float qxz = q.x * q.z;
+	float qxy = q.x * q.y;
+	float qyz = q.y * q.z;
+	float qwx = q.w * q.x;
+	float qwy = q.w * q.y;
+	float qwz = q.w * q.z;
+	return mat3(
+		1.0 - 2.0 * (qyy + qzz), 2.0 * (qxy + qwz), 2.0 * (qxz - qwy),
+		2.0 * (qxy - qwz), 1.0 - 2.0 * (qxx + qzz), 2.0 * (qyz + qwx),
+		2.0 * (qxz + qwy), 2.0 * (qyz - qwx), 1.0 - 2.0 * (qxx + qyy)
+	);
+}
+
+// glm::slerp
+vec4 QuatSlerp(vec4 x, vec4 y, float a)
+{
+	vec4 z = y;
+	float cosTheta = dot(x, y);
+	if (cosTheta < 0.0)
+	{
+		z = -y;
+		cosTheta = -cosTheta;
+	}
+	if (cosTheta > 1.0 - 1.192092896e-07)
+	{
+		return mix(x, z, a);
+	}
+	float angle = acos(cosTheta);
+	return (sin((1.0 - a) * angle) * x + sin(a * angle) * z) / sin(angle);
+}
+
+void SkinVertex(inout vec3 pos, inout vec3 nor)
+{
+	pos += in_MorphPos;
+
+	if (in_SkinningType == SkinningSDEF)
+	{
+		// https://github.com/powroupi/blender_mmd_tools/blob/dev_test/mmd_tools/core/sdef.py
+		mat4 m0 = GetBoneTransform(in_BoneIndex.x);
+		mat4 m1 = GetBoneTransform(in_BoneIndex.y);
+		float w0 = in_BoneWeight.x;
+		float w1 = in_BoneWeight.y;
+		vec4 q = QuatSlerp(QuatFromMat3(mat3(m0)), QuatFromMat3(mat3(m1)), w1);
+		mat3 rot = QuatToMat3(q);
+		pos = rot * (pos - in_SdefC) + (m0 * vec4(in_SdefR0, 1.0)).xyz * w0 + (m1 * vec4(in_SdefR1, 1.0)).xyz * w1;
+		nor = rot * nor;
+	}
+	else if (in_SkinningType == SkinningDualQuaternion)
+	{
+		// Skinning with Dual Quaternions
+		// https://www.cs.utah.edu/~ladislav/dq/index.html
+		vec4 real0 = vec4(0.0);
+		vec4 blendReal = vec4(0.0);
+		vec4 blendDual = vec4(0.0);
+		for (int i = 0; i < 4; i++)
+		{
+			mat4 m = GetBoneTransform(in_BoneIndex[i]);
+			vec4 real = QuatFromMat3(mat3(m));
+			vec3 t = m[3].xyz;
+			vec4 dual = 0.5 * vec4(t * real.w + cross(t, real.xyz), -dot(t, real.xyz));
+			float len = length(real);
+			real /= len;
+			dual /= len;
+			if (i == 0)
+			{
+				real0 = real;
+			}
+			float w = in_BoneWeight[i];
+			if (dot(real0, real) < 0.0)
+			{
+				w = -w;
+			}
+			blendReal += real * w;
+			blendDual += dual * w;
+		}
+		float len = length(blendReal);
+		blendReal /= len;
+		blendDual /= len;
+		mat3 rot = QuatToMat3(blendReal);
+		vec3 t = 2.0 * (blendReal.w * blendDual.xyz - blendDual.w * blendReal.xyz + cross(blendReal.xyz, blendDual.xyz));
+		pos = rot * pos + t;
+		nor = normalize(rot * nor);
+	}
+	else
+	{
+		mat4 m =
+			GetBoneTransform(in_BoneIndex.x) * in_BoneWeight.x +
+			GetBoneTransform(in_BoneIndex.y) * in_BoneWeight.y +
+			GetBoneTransform(in_BoneIndex.z) * in_BoneWeight.z +
+			GetBoneTransform(in_BoneIndex.w) * in_BoneWeight.w;
+		pos = (m * vec4(pos, 1.0)).xyz;
+		nor = normalize(mat3(m) * nor);
+	}
+}